@@ -19,6 +19,59 @@
     event loops, and scalable concurrent I/O processing
     suitable for servers and high-performance applications.
 
+    on Linux the context can also be backed by io_uring:
+    reads, writes, accepts, connects and sendfile (as a pair
+    of splices through a cached pipe) are submitted as SQEs
+    and completions are reaped in batches, so an operation
+    costs a share of one io_uring_enter() instead of an
+    epoll_wait() plus the I/O syscall, and regular files are
+    truly asynchronous. the backend is chosen at creation and
+    falls back to epoll when io_uring is unavailable.
+
+    timers (one-shot and periodic) live in a hierarchical
+    timing wheel owned by the context: six levels of 32
+    slots at 1 ms resolution, so arming and disarming are
+    O(1) linked-list operations on caller-owned timer
+    structs and millions of idle connection timeouts cost
+    nothing until their slot comes up. the nearest deadline
+    bounds the epoll/kqueue/io_uring wait.
+
+    a context belongs to the thread that polls it, but any
+    thread may hand it work with commc_async_post(): tasks go
+    on a lock-free multi-producer stack and the producer that
+    finds it empty wakes the loop (eventfd on Linux, an
+    EVFILT_USER event on kqueue, an event object on Windows).
+    the loop runs them, oldest first, from its next poll.
+    commc_async_stop() uses the same wakeup and is safe to
+    call from other threads.
+
+    work that cannot be waited on with readiness runs on a
+    small helper thread pool owned by the context, created on
+    first use: regular-file reads and writes on epoll and
+    kqueue (which report files as always ready, so the call
+    would block the loop), fsync (native on io_uring), and
+    arbitrary blocking functions such as getaddrinfo() handed
+    over with commc_async_offload(). a helper pushes the
+    finished operation on a lock-free stack and wakes the
+    loop through the same wakeup as posts; the callback then
+    runs on the loop thread like any other completion.
+
+    two opt-in modes trade convenience for fewer syscalls and
+    calls on busy readiness loops:
+
+    - edge-triggered registration (EPOLLET on epoll, EV_CLEAR
+      on kqueue): a handle is registered once for both
+      directions and never modified again. the context
+      remembers which sides are ready and keeps reading or
+      writing until the kernel reports EAGAIN, attempting
+      operations at submit time while a side is known ready,
+      so a busy socket is not reported on every wait.
+      COMMC_ASYNC_EVENT_ONESHOT makes a watch fire once until
+      it is re-armed with commc_async_modify_events().
+    - batched completions: results that would go to the
+      default callback are collected and handed over as one
+      array per poll.
+
 */
 
 #ifndef COMMC_ASYNC_H
@@ -39,11 +92,11 @@ extern "C" {
 
 #ifdef _WIN32
     #include <windows.h>
-#else
+#elif defined(__linux__)
     #include <sys/epoll.h>  /* for Linux epoll */
-    #ifdef __APPLE__
-        #include <sys/event.h>  /* for macOS/BSD kqueue */
-    #endif
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+    #include <sys/types.h>
+    #include <sys/event.h>  /* for macOS/BSD kqueue */
 #endif
 
 /*
@@ -55,6 +108,8 @@ extern "C" {
 #define COMMC_ASYNC_MAX_EVENTS      1024    /* MAX EVENTS PER POLL */
 #define COMMC_ASYNC_DEFAULT_TIMEOUT 1000    /* DEFAULT TIMEOUT MS */
 #define COMMC_ASYNC_INFINITE        -1      /* INFINITE TIMEOUT */
+#define COMMC_ASYNC_URING_ENTRIES   256     /* IO_URING SUBMISSION QUEUE SIZE */
+#define COMMC_ASYNC_HELPER_THREADS  4       /* DEFAULT BLOCKING-WORK THREADS */
 
 /*
 	==================================
@@ -78,7 +133,8 @@ typedef enum {
     COMMC_ASYNC_EVENT_CONNECT  = 0x08,  /* CONNECTION COMPLETED */
     COMMC_ASYNC_EVENT_CLOSE    = 0x10,  /* CONNECTION CLOSED */
     COMMC_ASYNC_EVENT_ERROR    = 0x20,  /* ERROR OCCURRED */
-    COMMC_ASYNC_EVENT_TIMEOUT  = 0x40   /* OPERATION TIMED OUT */
+    COMMC_ASYNC_EVENT_TIMEOUT  = 0x40,  /* OPERATION TIMED OUT */
+    COMMC_ASYNC_EVENT_ONESHOT  = 0x80   /* WATCH FLAG: DISARM AFTER ONE NOTIFICATION */
 } commc_async_event_type_t;
 
 /*
@@ -97,15 +153,40 @@ typedef enum {
     COMMC_ASYNC_OP_CONNECT   = 4,  /* CONNECT OPERATION */
     COMMC_ASYNC_OP_SENDFILE  = 5,  /* SENDFILE OPERATION */
     COMMC_ASYNC_OP_RECV      = 6,  /* RECEIVE OPERATION */
-    COMMC_ASYNC_OP_SEND      = 7   /* SEND OPERATION */
+    COMMC_ASYNC_OP_SEND      = 7,  /* SEND OPERATION */
+    COMMC_ASYNC_OP_POLL      = 8,  /* READINESS NOTIFICATION FOR A WATCHED HANDLE */
+    COMMC_ASYNC_OP_TIMER     = 9,  /* TIMER EXPIRY */
+    COMMC_ASYNC_OP_FSYNC     = 10, /* FILE SYNC */
+    COMMC_ASYNC_OP_WORK      = 11  /* BLOCKING FUNCTION ON A HELPER THREAD */
 } commc_async_operation_type_t;
 
+/*
+
+         commc_async_backend_t
+	       ---
+	       event backend of a context. DEFAULT picks io_uring
+	       on Linux when the kernel supports it, otherwise the
+	       platform's native readiness or completion API.
+
+*/
+
+typedef enum {
+    COMMC_ASYNC_BACKEND_DEFAULT  = 0,  /* BEST AVAILABLE */
+    COMMC_ASYNC_BACKEND_EPOLL    = 1,  /* LINUX READINESS */
+    COMMC_ASYNC_BACKEND_IO_URING = 2,  /* LINUX COMPLETION QUEUE */
+    COMMC_ASYNC_BACKEND_KQUEUE   = 3,  /* BSD/MACOS READINESS */
+    COMMC_ASYNC_BACKEND_IOCP     = 4   /* WINDOWS COMPLETION PORT */
+} commc_async_backend_t;
+
 /*
 
          commc_async_result_t
 	       ---
 	       result structure containing information about
-	       completed asynchronous operation.
+	       completed asynchronous operation. error_code is an
+	       errno value on unix. for COMMC_ASYNC_OP_POLL the
+	       bytes_transferred field holds the ready
+	       commc_async_event_type_t mask.
 
 */
 
@@ -133,6 +214,89 @@ typedef struct {
 
 typedef void (*commc_async_callback_t)(const commc_async_result_t* result);
 
+/*
+
+         commc_async_batch_callback_t
+	       ---
+	       receives the results collected in batch mode. the
+	       array is only valid during the call.
+
+*/
+
+typedef void (*commc_async_batch_callback_t)(const commc_async_result_t* results,
+                                             size_t count,
+                                             void* user_data);
+
+/* internal per-handle and io_uring state, defined in async.c */
+
+struct commc_async_operation_t;
+struct commc_async_fd_state_t;
+struct commc_async_uring_t;
+struct commc_async_timer_wheel_t;
+
+/*
+
+         commc_async_timer_t
+	       ---
+	       timer embedded in caller-owned memory, so arming
+	       and disarming never allocate. set up with
+	       commc_async_timer_init(); the remaining fields are
+	       managed by the context while the timer is active.
+	       expiry is delivered to the callback as a
+	       COMMC_ASYNC_OP_TIMER result whose buffer is the
+	       timer and whose bytes_transferred counts the
+	       periods elapsed (more than 1 if the loop fell
+	       behind a periodic timer).
+
+*/
+
+typedef struct commc_async_timer_t {
+    struct commc_async_timer_t* next;      /* WHEEL SLOT LINK */
+    struct commc_async_timer_t* prev;
+    unsigned long               expires;   /* DEADLINE IN WHEEL TICKS */
+    unsigned long               remaining; /* MS BEYOND THE WHEEL RANGE */
+    unsigned long               period_ms; /* 0 FOR ONE-SHOT */
+    int                         level;     /* WHEEL LEVEL, -1 OFF-WHEEL */
+    int                         slot;      /* SLOT WITHIN LEVEL */
+    int                         active;    /* ARMED */
+    commc_async_callback_t      callback;  /* EXPIRY CALLBACK */
+    void*                       user_data; /* USER-PROVIDED DATA */
+} commc_async_timer_t;
+
+/*
+
+         commc_async_task_fn / commc_async_task_t
+	       ---
+	       work handed to a context from any thread. the task
+	       is embedded in caller-owned memory, so posting with
+	       commc_async_post_task() never allocates; it must
+	       stay valid until fn has started on the loop thread,
+	       and may be posted again from then on.
+
+*/
+
+typedef void (*commc_async_task_fn)(void* arg);
+
+/*
+
+         commc_async_work_fn
+	       ---
+	       blocking function run by commc_async_offload() on a
+	       helper thread. it may set *bytes_transferred and
+	       returns 0 or an errno value, which become the
+	       result of the COMMC_ASYNC_OP_WORK operation.
+
+*/
+
+typedef int (*commc_async_work_fn)(void* arg, size_t* bytes_transferred);
+
+typedef struct commc_async_task_t {
+    struct commc_async_task_t* next;      /* POST STACK LINK */
+    commc_async_task_fn        fn;        /* RUNS ON THE LOOP THREAD */
+    void*                      arg;       /* PASSED TO FN */
+    int                        allocated; /* FREED AFTER RUNNING (COMMC_ASYNC_POST) */
+} commc_async_task_t;
+
 /*
 
          commc_async_context_t
@@ -147,19 +311,49 @@ typedef struct {
     int                      max_events;      /* MAXIMUM EVENTS PER POLL */
     int                      timeout_ms;      /* POLLING TIMEOUT */
     commc_async_callback_t   default_callback; /* DEFAULT EVENT CALLBACK */
+    commc_async_backend_t    backend;         /* ACTIVE BACKEND */
     
     /* operation tracking */
     void**                   operations;      /* PENDING OPERATIONS */
     size_t                   operation_count; /* NUMBER OF OPERATIONS */
     size_t                   operation_capacity; /* OPERATIONS ARRAY SIZE */
     
+    struct commc_async_timer_wheel_t* timers; /* TIMING WHEEL (CREATED ON FIRST USE) */
+    
+    commc_async_task_t*      posted;          /* CROSS-THREAD TASKS, NEWEST FIRST */
+    
+    /* helper threads for blocking work */
+    struct commc_threadpool_t* helpers;       /* CREATED ON FIRST OFFLOAD */
+    size_t                   helper_count;    /* THREADS TO START */
+    struct commc_async_operation_t* offloaded; /* FINISHED ON A HELPER, NEWEST FIRST */
+    
+    /* batch mode */
+    commc_async_batch_callback_t batch_callback; /* NULL WHEN DISABLED */
+    void*                    batch_user_data; /* PASSED TO BATCH_CALLBACK */
+    commc_async_result_t*    batch;           /* COLLECTED RESULTS (MAX_EVENTS) */
+    size_t                   batch_count;     /* RESULTS IN BATCH */
+    int                      batch_flushing;  /* INSIDE BATCH_CALLBACK */
+    
+#ifndef _WIN32
+    /* readiness bookkeeping (epoll/kqueue) and synchronous completions */
+    struct commc_async_fd_state_t*  fd_states;      /* PER-HANDLE STATE, INDEXED BY FD */
+    int                             fd_state_count; /* FD_STATES ARRAY SIZE */
+    struct commc_async_operation_t* ready_head;     /* COMPLETED AT NEXT POLL */
+    struct commc_async_operation_t* ready_tail;
+    int                             edge_triggered; /* EPOLLET / EV_CLEAR REGISTRATION */
+    int                             edge_backlog;   /* FIRST HANDLE LEFT READY BY THE DRAIN LIMIT, -1 NONE */
+#endif
+    
 #ifdef _WIN32
     HANDLE                   completion_port; /* I/O COMPLETION PORT */
     HANDLE*                  threads;         /* WORKER THREADS */
     int                      thread_count;    /* NUMBER OF THREADS */
+    HANDLE                   wake_event;      /* SIGNALED BY POSTS AND STOP */
 #elif defined(__linux__)
     int                      epoll_fd;        /* EPOLL FILE DESCRIPTOR */
     struct epoll_event*      events;          /* EVENT ARRAY */
+    struct commc_async_uring_t* uring;        /* IO_URING STATE (NULL FOR EPOLL) */
+    int                      wake_fd;         /* EVENTFD SIGNALED BY POSTS AND STOP */
 #elif defined(__APPLE__) || defined(__FreeBSD__)
     int                      kqueue_fd;       /* KQUEUE FILE DESCRIPTOR */
     struct kevent*           events;          /* EVENT ARRAY */
@@ -177,12 +371,13 @@ typedef struct {
 
 */
 
-typedef struct {
+typedef struct commc_async_operation_t {
     commc_async_operation_type_t  type;        /* OPERATION TYPE */
     int                          handle;       /* FILE/SOCKET HANDLE */
     void*                        buffer;       /* DATA BUFFER */
     size_t                       buffer_size;  /* BUFFER SIZE */
     size_t                       offset;       /* FILE OFFSET */
+    int                          source_handle; /* SENDFILE INPUT HANDLE */
     commc_async_callback_t       callback;     /* COMPLETION CALLBACK */
     void*                        user_data;    /* USER-PROVIDED DATA */
     
@@ -193,6 +388,23 @@ typedef struct {
     /* timing */
     int                          timeout_ms;   /* OPERATION TIMEOUT */
     
+    /* engine bookkeeping, managed by the context */
+    struct commc_async_operation_t* next;      /* HANDLE QUEUE / READY LIST LINK */
+    size_t                       slot;         /* INDEX IN CONTEXT OPERATIONS */
+    int*                         result_handle; /* ACCEPTED HANDLE OUTPUT */
+    unsigned int                 address_length; /* ACCEPT ADDRESS LENGTH IN/OUT */
+    int                          owns_address; /* ADDRESS WAS COPIED */
+    int                          has_offset;   /* OFFSET IS EXPLICIT (FILE OPS) */
+    int                          stage;        /* MULTI-STEP OPERATION STATE */
+    int                          cancelled;    /* CANCEL REQUESTED */
+    size_t                       transferred;  /* BYTES DONE SO FAR */
+    size_t                       staged;       /* BYTES BUFFERED IN A SPLICE PIPE */
+    int                          error_code;   /* ERROR FOR READY-LIST COMPLETION */
+    int                          pipe_slot;    /* SPLICE PIPE INDEX OR -1 */
+    unsigned int                 watch_events; /* POLL MASK OF A WATCH OPERATION */
+    commc_async_work_fn          work;         /* COMMC_ASYNC_OP_WORK FUNCTION */
+    void*                        owner;        /* CONTEXT WHILE ON A HELPER THREAD */
+    
 #ifdef _WIN32
     OVERLAPPED                   overlapped;   /* WINDOWS OVERLAPPED */
 #endif
@@ -216,6 +428,33 @@ typedef struct {
 commc_async_context_t* commc_async_context_create(int max_events,
                                                   int timeout_ms);
 
+/*
+
+         commc_async_context_create_with_backend()
+	       ---
+	       creates an async context on a specific backend.
+	       requesting io_uring on a kernel without it (or
+	       without IORING_FEAT_EXT_ARG, 5.11+) falls back to
+	       epoll; requesting a backend of another platform
+	       returns NULL. check commc_async_get_backend() for
+	       the backend actually in use.
+
+*/
+
+commc_async_context_t* commc_async_context_create_with_backend(int max_events,
+                                                               int timeout_ms,
+                                                               commc_async_backend_t backend);
+
+/*
+
+         commc_async_get_backend()
+	       ---
+	       returns the backend the context is running on.
+
+*/
+
+commc_async_backend_t commc_async_get_backend(const commc_async_context_t* ctx);
+
 /*
 
          commc_async_context_destroy()
@@ -239,13 +478,63 @@ void commc_async_context_destroy(commc_async_context_t* ctx);
 void commc_async_context_set_callback(commc_async_context_t* ctx,
                                      commc_async_callback_t callback);
 
+/*
+
+         commc_async_set_edge_triggered()
+	       ---
+	       switches the epoll/kqueue backends to edge-triggered
+	       registration. only possible before the first handle
+	       or operation. in this mode a handle that is closed
+	       must first be removed with commc_async_remove_handle()
+	       unless its number comes back through accept or is
+	       reused for a connect; watchers are notified on
+	       edges only and must read or write until EAGAIN.
+
+	       returns:
+	       - 0 on success
+	       - -1 if handles are already registered, or on
+	         io_uring and IOCP, which are completion based
+	         and never re-report readiness
+
+*/
+
+int commc_async_set_edge_triggered(commc_async_context_t* ctx,
+                                   int enabled);
+
+/*
+
+         commc_async_set_batch_callback()
+	       ---
+	       enables batch mode: every result that would go to
+	       the default callback (operations submitted without
+	       a callback, watch notifications, timers without a
+	       callback) is collected and passed to callback at
+	       the end of each poll, or earlier once max_events
+	       results are waiting. results produced from inside
+	       the batch callback are passed on at once in a
+	       batch of one. NULL disables batch mode.
+
+	       returns:
+	       - 0 on success
+	       - -1 on allocation failure, or on IOCP, whose
+	         completions run on worker threads
+
+*/
+
+int commc_async_set_batch_callback(commc_async_context_t* ctx,
+                                   commc_async_batch_callback_t callback,
+                                   void* user_data);
+
 /*
 
          commc_async_add_handle()
 	       ---
 	       adds file descriptor or handle to async context
 	       for event monitoring. enables async operations
-	       on the specified handle.
+	       on the specified handle. readiness of a watched
+	       handle is reported to the default callback as
+	       COMMC_ASYNC_OP_POLL results. operations do not
+	       require the handle to be added first.
 
 */
 
@@ -258,7 +547,8 @@ int commc_async_add_handle(commc_async_context_t* ctx,
          commc_async_remove_handle()
 	       ---
 	       removes handle from async context and cancels
-	       any pending operations on that handle.
+	       any pending operations on that handle. call it
+	       before closing a descriptor that may be reused.
 
 */
 
@@ -350,6 +640,9 @@ int commc_async_write_file(commc_async_context_t* ctx,
 	       ---
 	       initiates asynchronous accept operation on
 	       listening socket with callback notification.
+	       the new non-blocking handle is stored through
+	       accept_handle and bytes_transferred holds the
+	       peer address length.
 
 */
 
@@ -377,12 +670,65 @@ int commc_async_connect(commc_async_context_t* ctx,
                        commc_async_callback_t callback,
                        void* user_data);
 
+/*
+
+         commc_async_fsync()
+	       ---
+	       flushes a file's data and metadata to storage
+	       without blocking the loop (IORING_OP_FSYNC on
+	       io_uring, a helper thread elsewhere).
+
+*/
+
+int commc_async_fsync(commc_async_context_t* ctx,
+                     int handle,
+                     commc_async_callback_t callback,
+                     void* user_data);
+
+/*
+
+         commc_async_offload()
+	       ---
+	       runs work(arg, &bytes) on a helper thread and
+	       delivers a COMMC_ASYNC_OP_WORK result with handle
+	       -1 on the loop thread. arg must stay valid until
+	       then. cancel_all() skips work that has not started
+	       yet, which then completes with ECANCELED.
+
+	       returns:
+	       - 0 if queued
+	       - -1 on invalid parameters, or if the helper pool
+	         could not be started
+
+*/
+
+int commc_async_offload(commc_async_context_t* ctx,
+                       commc_async_work_fn work,
+                       void* arg,
+                       commc_async_callback_t callback,
+                       void* user_data);
+
+/*
+
+         commc_async_set_helper_threads()
+	       ---
+	       sets the number of helper threads (default
+	       COMMC_ASYNC_HELPER_THREADS). only possible before
+	       the pool is started by the first offload.
+
+*/
+
+int commc_async_set_helper_threads(commc_async_context_t* ctx,
+                                   size_t count);
+
 /*
 
          commc_async_sendfile()
 	       ---
 	       initiates asynchronous sendfile operation
 	       (zero-copy file transmission) with callback.
+	       completes when count bytes were sent or the
+	       file ended.
 
 */
 
@@ -412,7 +758,8 @@ int commc_async_cancel(commc_async_context_t* ctx,
          commc_async_cancel_all()
 	       ---
 	       cancels all pending asynchronous operations
-	       in the context.
+	       in the context. on unix their callbacks run
+	       with ECANCELED as for commc_async_cancel().
 
 */
 
@@ -461,6 +808,8 @@ void commc_async_run(commc_async_context_t* ctx);
 	       ---
 	       stops running event loop gracefully.
 	       allows current operations to complete.
+	       may be called from any thread; the loop is
+	       woken if it is waiting.
 
 */
 
@@ -510,6 +859,97 @@ void commc_async_set_timeout(commc_async_context_t* ctx,
 
 int commc_async_get_timeout(const commc_async_context_t* ctx);
 
+/*
+
+         commc_async_timer_init()
+	       ---
+	       prepares a timer for use. callback NULL uses the
+	       context default callback.
+
+*/
+
+void commc_async_timer_init(commc_async_timer_t* timer,
+                            commc_async_callback_t callback,
+                            void* user_data);
+
+/*
+
+         commc_async_timer_start()
+	       ---
+	       arms a timer to fire after timeout_ms and then,
+	       if period_ms is non-zero, every period_ms. an
+	       active timer is re-armed. a timeout of 0 fires at
+	       the next poll. callable from any callback of the
+	       same context, including the timer's own.
+
+*/
+
+int commc_async_timer_start(commc_async_context_t* ctx,
+                            commc_async_timer_t* timer,
+                            unsigned long timeout_ms,
+                            unsigned long period_ms);
+
+/*
+
+         commc_async_timer_stop()
+	       ---
+	       disarms a timer. stopping an inactive timer is a
+	       no-op; a stopped timer never calls back.
+
+*/
+
+int commc_async_timer_stop(commc_async_context_t* ctx,
+                           commc_async_timer_t* timer);
+
+/*
+
+         commc_async_timer_is_active()
+	       ---
+	       checks whether a timer is armed.
+
+*/
+
+int commc_async_timer_is_active(const commc_async_timer_t* timer);
+
+/*
+
+         commc_async_task_init()
+	       ---
+	       prepares an embedded task for posting.
+
+*/
+
+void commc_async_task_init(commc_async_task_t* task,
+                           commc_async_task_fn fn,
+                           void* arg);
+
+/*
+
+         commc_async_post_task()
+	       ---
+	       queues task to run on the context's loop thread and
+	       wakes the loop. safe to call from any thread. tasks
+	       run in posting order from the next poll; tasks still
+	       queued when the context is destroyed never run.
+
+*/
+
+int commc_async_post_task(commc_async_context_t* ctx,
+                          commc_async_task_t* task);
+
+/*
+
+         commc_async_post()
+	       ---
+	       like commc_async_post_task() with a task allocated
+	       by the context and freed once fn has run.
+
+*/
+
+int commc_async_post(commc_async_context_t* ctx,
+                     commc_async_task_fn fn,
+                     void* arg);
+
 /*
 
          commc_async_operation_create()
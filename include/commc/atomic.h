@@ -0,0 +1,204 @@
+/*
+   ===================================
+   C O M M O N - C
+   ATOMIC OPERATIONS MODULE
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+            --- ATOMIC MODULE ---
+
+    this module provides a small set of atomic operation macros
+    with explicit memory ordering for the lock-free parts of the
+    library (lock-free queue, SPSC circular buffer, and friends).
+
+    the sequentially-consistent COMMC_ATOMIC_* macros mirror the
+    original lock-free queue abstraction. the ordered variants
+    (*_RELAXED, *_ACQUIRE, *_RELEASE) let hot paths ask for only
+    the ordering they need:
+
+    - relaxed:  atomicity only, no ordering (counters, statistics)
+    - acquire:  later reads/writes cannot move above the load
+    - release:  earlier reads/writes cannot move below the store
+
+    on x86 an acquire load and a release store are plain moves,
+    whereas the legacy __sync emulation paid a locked RMW or a
+    full fence for every access.
+
+    backends, in order of preference:
+
+    - GCC 4.7+ / clang __atomic builtins (detected through the
+      predefined __ATOMIC_ACQUIRE macro)
+    - GCC 4.1+ __sync builtins (ordered variants degrade to full
+      barriers, which is always correct)
+    - MSVC Interlocked intrinsics
+    - a volatile fallback that is NOT atomic
+
+    all backends are compiler builtins or intrinsics, so sources
+    using these macros remain valid C89.
+
+*/
+
+#ifndef   COMMC_ATOMIC_H
+#define   COMMC_ATOMIC_H
+
+/*
+	==================================
+             --- BACKEND SELECTION ---
+	==================================
+*/
+
+#if defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+
+  /* GCC 4.7+ / clang __atomic builtins */
+
+  #define COMMC_ATOMIC_LOAD(ptr)               __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+  #define COMMC_ATOMIC_STORE(ptr, val)         __atomic_exchange_n((ptr), (val), __ATOMIC_SEQ_CST)
+  #define COMMC_ATOMIC_CAS(ptr, old, new)      __sync_bool_compare_and_swap((ptr), (old), (new))
+  #define COMMC_ATOMIC_INC(ptr)                __atomic_add_fetch((ptr), 1, __ATOMIC_SEQ_CST)
+  #define COMMC_ATOMIC_DEC(ptr)                __atomic_sub_fetch((ptr), 1, __ATOMIC_SEQ_CST)
+  #define COMMC_ATOMIC_ADD(ptr, val)           __atomic_add_fetch((ptr), (val), __ATOMIC_SEQ_CST)
+  #define COMMC_ATOMIC_SUB(ptr, val)           __atomic_sub_fetch((ptr), (val), __ATOMIC_SEQ_CST)
+  #define COMMC_MEMORY_BARRIER()               __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+  #define COMMC_ATOMIC_LOAD_RELAXED(ptr)       __atomic_load_n((ptr), __ATOMIC_RELAXED)
+  #define COMMC_ATOMIC_LOAD_ACQUIRE(ptr)       __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+  #define COMMC_ATOMIC_STORE_RELAXED(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+  #define COMMC_ATOMIC_STORE_RELEASE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+  #define COMMC_ATOMIC_STORE_SEQ_CST(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_SEQ_CST)
+  #define COMMC_ATOMIC_EXCHANGE(ptr, val)      __atomic_exchange_n((ptr), (val), __ATOMIC_ACQ_REL)
+  #define COMMC_ATOMIC_ADD_RELAXED(ptr, val)   __atomic_add_fetch((ptr), (val), __ATOMIC_RELAXED)
+  #define COMMC_ATOMIC_SUB_RELAXED(ptr, val)   __atomic_sub_fetch((ptr), (val), __ATOMIC_RELAXED)
+  #define COMMC_ATOMIC_FENCE_ACQUIRE()         __atomic_thread_fence(__ATOMIC_ACQUIRE)
+  #define COMMC_ATOMIC_FENCE_RELEASE()         __atomic_thread_fence(__ATOMIC_RELEASE)
+
+  #define COMMC_HAS_ATOMICS         1
+  #define COMMC_HAS_ORDERED_ATOMICS 1
+
+#elif defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+
+  /* GCC built-in atomics (GCC 4.1+) */
+
+  #define COMMC_ATOMIC_LOAD(ptr)               __sync_add_and_fetch((ptr), 0)
+  #define COMMC_ATOMIC_STORE(ptr, val)         (__sync_synchronize(), __sync_lock_test_and_set((ptr), (val)))
+  #define COMMC_ATOMIC_CAS(ptr, old, new)      __sync_bool_compare_and_swap((ptr), (old), (new))
+  #define COMMC_ATOMIC_INC(ptr)                __sync_add_and_fetch((ptr), 1)
+  #define COMMC_ATOMIC_DEC(ptr)                __sync_sub_and_fetch((ptr), 1)
+  #define COMMC_ATOMIC_ADD(ptr, val)           __sync_add_and_fetch((ptr), (val))
+  #define COMMC_ATOMIC_SUB(ptr, val)           __sync_sub_and_fetch((ptr), (val))
+  #define COMMC_MEMORY_BARRIER()               __sync_synchronize()
+
+  #define COMMC_ATOMIC_LOAD_RELAXED(ptr)       COMMC_ATOMIC_LOAD(ptr)
+  #define COMMC_ATOMIC_LOAD_ACQUIRE(ptr)       COMMC_ATOMIC_LOAD(ptr)
+  #define COMMC_ATOMIC_STORE_RELAXED(ptr, val) ((void)COMMC_ATOMIC_STORE((ptr), (val)))
+  #define COMMC_ATOMIC_STORE_RELEASE(ptr, val) ((void)COMMC_ATOMIC_STORE((ptr), (val)))
+  #define COMMC_ATOMIC_STORE_SEQ_CST(ptr, val) ((void)COMMC_ATOMIC_STORE((ptr), (val)))
+  #define COMMC_ATOMIC_EXCHANGE(ptr, val)      COMMC_ATOMIC_STORE((ptr), (val))
+  #define COMMC_ATOMIC_ADD_RELAXED(ptr, val)   COMMC_ATOMIC_ADD((ptr), (val))
+  #define COMMC_ATOMIC_SUB_RELAXED(ptr, val)   COMMC_ATOMIC_SUB((ptr), (val))
+  #define COMMC_ATOMIC_FENCE_ACQUIRE()         __sync_synchronize()
+  #define COMMC_ATOMIC_FENCE_RELEASE()         __sync_synchronize()
+
+  #define COMMC_HAS_ATOMICS         1
+  #define COMMC_HAS_ORDERED_ATOMICS 0
+
+#elif defined(_MSC_VER) && (_MSC_VER >= 1300)
+
+  /* Microsoft Visual C++ intrinsics */
+
+  #include <intrin.h>
+
+  #define COMMC_ATOMIC_LOAD(ptr)               (*(volatile long*)(ptr))
+  #define COMMC_ATOMIC_STORE(ptr, val)         _InterlockedExchange((volatile long*)(ptr), (long)(val))
+  #define COMMC_ATOMIC_CAS(ptr, old, new)      (_InterlockedCompareExchange((volatile long*)(ptr), (long)(new), (long)(old)) == (long)(old))
+  #define COMMC_ATOMIC_INC(ptr)                _InterlockedIncrement((volatile long*)(ptr))
+  #define COMMC_ATOMIC_DEC(ptr)                _InterlockedDecrement((volatile long*)(ptr))
+  #define COMMC_ATOMIC_ADD(ptr, val)           (_InterlockedExchangeAdd((volatile long*)(ptr), (long)(val)) + (long)(val))
+  #define COMMC_ATOMIC_SUB(ptr, val)           (_InterlockedExchangeAdd((volatile long*)(ptr), -(long)(val)) - (long)(val))
+  #define COMMC_MEMORY_BARRIER()               _ReadWriteBarrier()
+
+  /* msvc volatile accesses carry acquire/release semantics */
+
+  #define COMMC_ATOMIC_LOAD_RELAXED(ptr)       (*(volatile long*)(ptr))
+  #define COMMC_ATOMIC_LOAD_ACQUIRE(ptr)       (*(volatile long*)(ptr))
+  #define COMMC_ATOMIC_STORE_RELAXED(ptr, val) ((void)(*(volatile long*)(ptr) = (long)(val)))
+  #define COMMC_ATOMIC_STORE_RELEASE(ptr, val) ((void)(*(volatile long*)(ptr) = (long)(val)))
+  #define COMMC_ATOMIC_STORE_SEQ_CST(ptr, val) ((void)_InterlockedExchange((volatile long*)(ptr), (long)(val)))
+  #define COMMC_ATOMIC_EXCHANGE(ptr, val)      _InterlockedExchange((volatile long*)(ptr), (long)(val))
+  #define COMMC_ATOMIC_ADD_RELAXED(ptr, val)   COMMC_ATOMIC_ADD((ptr), (val))
+  #define COMMC_ATOMIC_SUB_RELAXED(ptr, val)   COMMC_ATOMIC_SUB((ptr), (val))
+  #define COMMC_ATOMIC_FENCE_ACQUIRE()         _ReadWriteBarrier()
+  #define COMMC_ATOMIC_FENCE_RELEASE()         _ReadWriteBarrier()
+
+  #define COMMC_HAS_ATOMICS         1
+  #define COMMC_HAS_ORDERED_ATOMICS 1
+
+#else
+
+  /* fallback: use volatile and hope for the best */
+  /* note: this is not truly atomic and should not be used in production */
+
+  #define COMMC_ATOMIC_LOAD(ptr)               (*(volatile void**)(ptr))
+  #define COMMC_ATOMIC_STORE(ptr, val)         (*(volatile void**)(ptr) = (val))
+  #define COMMC_ATOMIC_CAS(ptr, old, new)      ((*(volatile void**)(ptr) == (old)) ? (*(volatile void**)(ptr) = (new), 1) : 0)
+  #define COMMC_ATOMIC_INC(ptr)                (++(*(volatile long*)(ptr)))
+  #define COMMC_ATOMIC_DEC(ptr)                (--(*(volatile long*)(ptr)))
+  #define COMMC_ATOMIC_ADD(ptr, val)           ((*(volatile long*)(ptr)) += (long)(val))
+  #define COMMC_ATOMIC_SUB(ptr, val)           ((*(volatile long*)(ptr)) -= (long)(val))
+  #define COMMC_MEMORY_BARRIER()               /* no-op */
+
+  #define COMMC_ATOMIC_LOAD_RELAXED(ptr)       (*(ptr))
+  #define COMMC_ATOMIC_LOAD_ACQUIRE(ptr)       (*(ptr))
+  #define COMMC_ATOMIC_STORE_RELAXED(ptr, val) ((void)(*(ptr) = (val)))
+  #define COMMC_ATOMIC_STORE_RELEASE(ptr, val) ((void)(*(ptr) = (val)))
+  #define COMMC_ATOMIC_STORE_SEQ_CST(ptr, val) ((void)(*(ptr) = (val)))
+  #define COMMC_ATOMIC_EXCHANGE(ptr, val)      COMMC_ATOMIC_STORE((ptr), (val))
+  #define COMMC_ATOMIC_ADD_RELAXED(ptr, val)   COMMC_ATOMIC_ADD((ptr), (val))
+  #define COMMC_ATOMIC_SUB_RELAXED(ptr, val)   COMMC_ATOMIC_SUB((ptr), (val))
+  #define COMMC_ATOMIC_FENCE_ACQUIRE()         /* no-op */
+  #define COMMC_ATOMIC_FENCE_RELEASE()         /* no-op */
+
+  #define COMMC_HAS_ATOMICS         0
+  #define COMMC_HAS_ORDERED_ATOMICS 0
+
+  #ifdef __STDC_VERSION__
+    #if __STDC_VERSION__ >= 201112L
+      #warning "Lock-free queue fallback: using volatile operations (not truly atomic)"
+    #endif
+  #endif
+
+#endif
+
+/*
+	==================================
+             --- SPIN HINT ---
+	==================================
+*/
+
+/*
+
+         COMMC_CPU_RELAX()
+	       ---
+	       hint to the processor that the caller is spinning on a
+	       shared location. lowers power and frees pipeline
+	       resources for a sibling hyperthread.
+
+*/
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+  #define COMMC_CPU_RELAX()  __builtin_ia32_pause()
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  #define COMMC_CPU_RELAX()  _mm_pause()
+#else
+  #define COMMC_CPU_RELAX()  /* no-op */
+#endif
+
+#endif /* COMMC_ATOMIC_H */
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
@@ -0,0 +1,262 @@
+/*
+   ===================================
+   B U F R E A D E R . H
+   BUFFERED SOCKET READER HEADER
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    buffered reader for line- and length-framed
+	    protocols. every receive asks for as much as the
+	    buffer has room for, and lines, delimited records
+	    and fixed-size reads are then cut out of the buffer,
+	    so reading a header block costs a couple of
+	    syscalls instead of one per byte.
+
+	    lines and delimited records are handed out as
+	    pointers into the buffer (valid until the next call
+	    on the reader); read_exact copies, and goes straight
+	    to the socket once the buffered bytes are used up.
+	    the buffer grows on demand up to a fixed limit, so
+	    a peer cannot make a line arbitrarily long.
+
+	    a reader reads either a commc_socket_t or a raw
+	    socket descriptor. it is not thread-safe.
+
+*/
+
+#ifndef COMMC_BUFREADER_H
+#define COMMC_BUFREADER_H
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#include <stddef.h>
+
+#include "error.h"
+#include "socket.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	==================================
+           --- CONSTANTS ---
+	==================================
+*/
+
+#define COMMC_BUFREADER_DEFAULT_SIZE      4096     /* INITIAL BUFFER SIZE */
+#define COMMC_BUFREADER_DEFAULT_MAX_SIZE  65536    /* LONGEST LINE OR PEEK */
+
+/*
+	==================================
+           --- STRUCTURES ---
+	==================================
+*/
+
+/*
+
+         commc_bufreader_t
+	       ---
+	       opaque reader state: the source and the window
+	       of unread bytes in its buffer.
+
+*/
+
+typedef struct commc_bufreader_t commc_bufreader_t;
+
+/*
+	==================================
+             --- CORE ---
+	==================================
+*/
+
+/*
+
+         commc_bufreader_create()
+	       ---
+	       creates a reader over a connected socket. the
+	       buffer starts at initial_size bytes and never
+	       grows past max_size; 0 picks the defaults. the
+	       socket is not owned: destroy the reader first.
+
+*/
+
+commc_error_t commc_bufreader_create(commc_bufreader_t** reader,
+                                     commc_socket_t*     socket,
+                                     size_t              initial_size,
+                                     size_t              max_size);
+
+/*
+
+         commc_bufreader_create_fd()
+	       ---
+	       like commc_bufreader_create() for a raw socket
+	       descriptor, read with recv().
+
+*/
+
+commc_error_t commc_bufreader_create_fd(commc_bufreader_t** reader,
+                                        int                 socket_fd,
+                                        size_t              initial_size,
+                                        size_t              max_size);
+
+/*
+
+         commc_bufreader_destroy()
+	       ---
+	       frees the reader. unread bytes are lost.
+
+*/
+
+void commc_bufreader_destroy(commc_bufreader_t* reader);
+
+/*
+	==================================
+             --- READING ---
+	==================================
+*/
+
+/*
+
+         commc_bufreader_read_line()
+	       ---
+	       returns the next line, without its LF or CRLF,
+	       as a NUL-terminated pointer into the buffer. a
+	       last line the peer ended without LF is returned
+	       as is.
+
+	       returns:
+	       - COMMC_SUCCESS with *line and *length set
+	       - COMMC_ERROR_CONNECTION_CLOSED at end of stream
+	       - COMMC_ERROR_BUFFER_TOO_SMALL if no LF appears
+	         within max_size bytes
+	       - the receive error otherwise
+
+*/
+
+commc_error_t commc_bufreader_read_line(commc_bufreader_t* reader,
+                                        char**             line,
+                                        size_t*            length);
+
+/*
+
+         commc_bufreader_read_until()
+	       ---
+	       returns everything up to and including the next
+	       occurrence of delimiter, as a pointer into the
+	       buffer. errors as for commc_bufreader_read_line(),
+	       except that bytes without a delimiter before end
+	       of stream are an error too.
+
+*/
+
+commc_error_t commc_bufreader_read_until(commc_bufreader_t* reader,
+                                         const char*        delimiter,
+                                         size_t             delimiter_length,
+                                         const char**       data,
+                                         size_t*            length);
+
+/*
+
+         commc_bufreader_read_exact()
+	       ---
+	       copies exactly length bytes into buffer, or fails
+	       with COMMC_ERROR_CONNECTION_CLOSED if the stream
+	       ends first.
+
+*/
+
+commc_error_t commc_bufreader_read_exact(commc_bufreader_t* reader,
+                                         void*              buffer,
+                                         size_t             length);
+
+/*
+
+         commc_bufreader_read()
+	       ---
+	       copies up to size bytes: whatever is buffered, or
+	       else the result of one receive.
+
+*/
+
+commc_error_t commc_bufreader_read(commc_bufreader_t* reader,
+                                   void*              buffer,
+                                   size_t             size,
+                                   size_t*            bytes_read);
+
+/*
+
+         commc_bufreader_peek()
+	       ---
+	       waits until at least length bytes are buffered
+	       (length at most max_size) and points *data at
+	       them without consuming anything.
+
+*/
+
+commc_error_t commc_bufreader_peek(commc_bufreader_t* reader,
+                                   size_t             length,
+                                   const char**       data);
+
+/*
+	==================================
+          --- BUFFER ACCESS ---
+	==================================
+*/
+
+/*
+
+         commc_bufreader_fill()
+	       ---
+	       receives once into the free end of the buffer,
+	       growing it if it is full.
+
+*/
+
+commc_error_t commc_bufreader_fill(commc_bufreader_t* reader);
+
+/*
+
+         commc_bufreader_data()
+	       ---
+	       points *data at the buffered, unread bytes and
+	       returns how many there are. pair with
+	       commc_bufreader_consume() to parse in place.
+
+*/
+
+size_t commc_bufreader_data(const commc_bufreader_t* reader,
+                            const char**             data);
+
+/*
+
+         commc_bufreader_consume()
+	       ---
+	       marks length buffered bytes as read (at most
+	       what is buffered).
+
+*/
+
+void commc_bufreader_consume(commc_bufreader_t* reader,
+                             size_t             length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMMC_BUFREADER_H */
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
@@ -26,6 +26,13 @@
     - lock-free single producer/single consumer
     - automatic overflow handling
 
+    buffers created with commc_circular_buffer_create_spsc() run in
+    a wait-free single-producer/single-consumer mode: one thread may
+    push while another pops without any external lock. the producer
+    and consumer indices live on separate cache lines and each side
+    caches the opposite index, so the shared lines are only touched
+    when the cached view says the buffer is full (or empty).
+
 */
 
 #ifndef COMMC_CIRCULAR_BUFFER_H
@@ -61,6 +68,17 @@ extern "C" {
 
 #define COMMC_CIRCULAR_BUFFER_DEFAULT_CAPACITY 1024
 
+/*
+
+         COMMC_CIRCULAR_BUFFER_CACHE_LINE_SIZE
+	       ---
+	       padding used to keep the producer and consumer
+	       indices of an SPSC buffer on separate cache lines.
+
+*/
+
+#define COMMC_CIRCULAR_BUFFER_CACHE_LINE_SIZE 64
+
 /* 
 	==================================
              --- TYPES ---
@@ -87,6 +105,25 @@ typedef enum {
   
 } commc_circular_buffer_overflow_policy_t;
 
+/*
+
+         commc_circular_buffer_mode_t
+	       ---
+	       defines the concurrency contract of a buffer:
+	       
+	       LOCAL: single-threaded use (or externally locked)
+	       SPSC:  one producer thread and one consumer thread,
+	              wait-free without external locking
+
+*/
+
+typedef enum {
+
+  COMMC_CIRCULAR_BUFFER_MODE_LOCAL = 0,
+  COMMC_CIRCULAR_BUFFER_MODE_SPSC  = 1
+
+} commc_circular_buffer_mode_t;
+
 /*
 
          commc_circular_buffer_t
@@ -180,6 +217,31 @@ commc_circular_buffer_t* commc_circular_buffer_create_with_policy(size_t capacit
                                                                   size_t element_size,
                                                                   commc_circular_buffer_overflow_policy_t policy);
 
+/*
+
+         commc_circular_buffer_create_spsc()
+	       ---
+	       creates buffer in wait-free single-producer/
+	       single-consumer mode.
+	       
+	       parameters:
+	       - capacity: maximum number of elements
+	       - element_size: size of each element in bytes
+	       
+	       returns:
+	       - pointer to new buffer, or NULL on error
+	       
+	       note: exactly one thread may call push/push_bulk and
+	       exactly one thread may call pop/pop_bulk/peek/peek_at.
+	       the overflow policy is always REJECT, since only the
+	       consumer is allowed to move the head. clear() and the
+	       iterators require both sides to be quiescent.
+
+*/
+
+commc_circular_buffer_t* commc_circular_buffer_create_spsc(size_t capacity,
+                                                           size_t element_size);
+
 /*
 
          commc_circular_buffer_destroy()
@@ -262,7 +324,8 @@ int commc_circular_buffer_is_full(const commc_circular_buffer_t* buffer);
 	       - COMMC_ARGUMENT_ERROR for invalid parameters
 	       
 	       note: with OVERWRITE policy, always succeeds but may 
-	       overwrite oldest data
+	       overwrite oldest data. SPSC buffers always reject
+	       when full.
 
 */
 
@@ -362,7 +425,9 @@ void commc_circular_buffer_clear(commc_circular_buffer_t* buffer);
 	       - number of elements actually added
 	       
 	       note: may add fewer than requested if buffer becomes full
-	       and overflow policy is REJECT
+	       and overflow policy is REJECT. in SPSC mode the whole
+	       batch is published to the consumer with a single
+	       release store of the tail index.
 
 */
 
@@ -383,7 +448,9 @@ size_t commc_circular_buffer_push_bulk(commc_circular_buffer_t* buffer,
 	       returns:
 	       - number of elements actually removed
 	       
-	       note: if data is NULL, elements are discarded
+	       note: if data is NULL, elements are discarded. in SPSC
+	       mode the freed slots are handed back to the producer
+	       with a single release store of the head index.
 
 */
 
@@ -473,7 +540,8 @@ commc_circular_buffer_overflow_policy_t commc_circular_buffer_get_overflow_polic
 	       
 	       returns:
 	       - COMMC_SUCCESS if policy updated
-	       - COMMC_ARGUMENT_ERROR for invalid policy
+	       - COMMC_ARGUMENT_ERROR for invalid policy, or for any
+	         policy other than REJECT on an SPSC buffer
 
 */
 
@@ -490,6 +558,16 @@ commc_error_t commc_circular_buffer_set_overflow_policy(commc_circular_buffer_t*
 
 size_t commc_circular_buffer_element_size(const commc_circular_buffer_t* buffer);
 
+/*
+
+         commc_circular_buffer_get_mode()
+	       ---
+	       returns the concurrency mode the buffer was created with.
+
+*/
+
+commc_circular_buffer_mode_t commc_circular_buffer_get_mode(const commc_circular_buffer_t* buffer);
+
 /*
 
          commc_circular_buffer_memory_usage()
@@ -0,0 +1,386 @@
+/*
+   ===================================
+   C O M M O N - C
+   STACKLESS COROUTINE MODULE
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+            --- STACKLESS COROUTINE MODULE ---
+
+    sequential-looking protocol handlers on top of the
+    commc_async callbacks, in plain C89. a coroutine is a
+    function that is re-entered from the top every time it
+    resumes; COMMC_CORO_BEGIN() switches on the line number
+    saved by the last await and jumps straight back into the
+    middle of the body (Duff's device, as in Dunkels'
+    protothreads). there is no separate stack: a suspended
+    session costs one commc_coro_t plus whatever state the
+    handler keeps in its own struct, so tens of thousands of
+    concurrent sessions fit in a few megabytes.
+
+        typedef struct {
+          commc_coro_t co;          (first member)
+          int          fd;
+          char         buf[512];
+        } session_t;
+
+        static int echo(commc_coro_t* co) {
+          session_t* s = (session_t*)co;
+          COMMC_CORO_BEGIN(co);
+          for (;;) {
+            COMMC_CORO_READ(co, s->fd, s->buf, sizeof(s->buf));
+            if (co->result.error_code || co->result.bytes_transferred == 0)
+              break;
+            COMMC_CORO_WRITE(co, s->fd, s->buf, co->result.bytes_transferred);
+          }
+          COMMC_CORO_END(co);
+        }
+
+    the usual protothread rules apply:
+
+    - local variables do not survive an await; keep state in
+      the struct that embeds the commc_coro_t.
+    - at most one await per source line, and no await inside
+      a switch statement of the body.
+    - each await has one operation in flight; the result of
+      the last one is in co->result.
+    - a done hook that closes the session's descriptor calls
+      commc_async_remove_handle() first, as for any handle.
+
+    completions must arrive on the loop thread, which holds
+    for epoll, kqueue and io_uring. IOCP delivers them on
+    worker threads and cannot drive coroutines.
+
+*/
+
+#ifndef COMMC_CORO_H
+#define COMMC_CORO_H
+
+/*
+	==================================
+             --- INCLUDES ---
+	==================================
+*/
+
+#include "commc/async.h"
+#include "commc/error.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	==================================
+             --- CONSTANTS ---
+	==================================
+*/
+
+#define COMMC_CORO_WAITING        0    /* BODY SUSPENDED ON AN AWAIT */
+#define COMMC_CORO_DONE           1    /* BODY RAN TO COMMC_CORO_END */
+#define COMMC_CORO_SUBMIT_FAILED  -1   /* RESULT ERROR WHEN AN AWAIT COULD NOT START */
+
+/*
+	==================================
+             --- TYPES ---
+	==================================
+*/
+
+typedef struct commc_coro_t commc_coro_t;
+
+/*
+
+         commc_coro_fn
+	       ---
+	       coroutine body. returns COMMC_CORO_WAITING from an
+	       await and COMMC_CORO_DONE from COMMC_CORO_END; the
+	       macros produce both.
+
+*/
+
+typedef int (*commc_coro_fn)(commc_coro_t* co);
+
+/*
+
+         commc_coro_done_fn
+	       ---
+	       called once the body has finished. it may free the
+	       memory holding the coroutine.
+
+*/
+
+typedef void (*commc_coro_done_fn)(commc_coro_t* co);
+
+/*
+
+         commc_coro_t
+	       ---
+	       coroutine state, usually the first member of a
+	       session struct. set up with commc_coro_start().
+
+*/
+
+struct commc_coro_t {
+
+  unsigned int           line;        /* RESUME POINT, 0 BEFORE THE FIRST RUN */
+  int                    finished;    /* BODY RAN TO COMMC_CORO_END */
+  commc_coro_fn          fn;          /* BODY */
+  commc_coro_done_fn     on_done;     /* COMPLETION HOOK (MAY BE NULL) */
+  commc_async_context_t* ctx;         /* CONTEXT THE AWAITS RUN ON */
+  void*                  user_data;   /* FREE FOR THE CALLER */
+  commc_async_result_t   result;      /* RESULT OF THE LAST AWAIT */
+
+  /* await bookkeeping */
+
+  commc_async_timer_t    timer;       /* SLEEPS AND I/O TIMEOUTS */
+  commc_async_task_t     task;        /* YIELD RE-POST */
+  unsigned long          timeout_ms;  /* I/O TIMEOUT, 0 FOR NONE */
+  int                    wait_handle; /* HANDLE OF THE PENDING I/O, OR -1 */
+  int                    timed_out;   /* TIMEOUT CANCELLED THE PENDING I/O */
+
+};
+
+/*
+	==================================
+             --- MACROS ---
+	==================================
+*/
+
+/*
+
+         COMMC_CORO_BEGIN() / COMMC_CORO_END()
+	       ---
+	       open and close a coroutine body. END marks the
+	       coroutine finished and returns COMMC_CORO_DONE.
+
+*/
+
+#define COMMC_CORO_BEGIN(co)  switch ((co)->line) { case 0:
+
+#define COMMC_CORO_END(co)    } (co)->line = 0; return COMMC_CORO_DONE
+
+/*
+
+         COMMC_CORO_AWAIT()
+	       ---
+	       starts an operation with one of the commc_coro_*
+	       submit functions below and suspends until its
+	       callback resumes the body. if the submission fails
+	       the body continues at once with result.error_code
+	       set to COMMC_CORO_SUBMIT_FAILED.
+
+*/
+
+#define COMMC_CORO_AWAIT(co, submit)                          \
+  do {                                                        \
+    (co)->line = __LINE__;                                    \
+    if (commc_coro_suspend((co), (submit))) {                 \
+      return COMMC_CORO_WAITING;                              \
+    }                                                         \
+    case __LINE__:;                                           \
+  } while (0)
+
+/*
+
+         COMMC_CORO_EXIT()
+	       ---
+	       finishes the coroutine from anywhere in the body.
+
+*/
+
+#define COMMC_CORO_EXIT(co)   do { (co)->line = 0; return COMMC_CORO_DONE; } while (0)
+
+/* shorthands for the common awaits */
+
+#define COMMC_CORO_READ(co, handle, buffer, size) \
+  COMMC_CORO_AWAIT((co), commc_coro_read((co), (handle), (buffer), (size)))
+
+#define COMMC_CORO_WRITE(co, handle, buffer, size) \
+  COMMC_CORO_AWAIT((co), commc_coro_write((co), (handle), (buffer), (size)))
+
+#define COMMC_CORO_ACCEPT(co, listen_handle, accept_handle, address, address_size) \
+  COMMC_CORO_AWAIT((co), commc_coro_accept((co), (listen_handle), (accept_handle), \
+                                           (address), (address_size)))
+
+#define COMMC_CORO_CONNECT(co, handle, address, address_size) \
+  COMMC_CORO_AWAIT((co), commc_coro_connect((co), (handle), (address), (address_size)))
+
+#define COMMC_CORO_SLEEP(co, ms) \
+  COMMC_CORO_AWAIT((co), commc_coro_sleep((co), (ms)))
+
+#define COMMC_CORO_YIELD(co) \
+  COMMC_CORO_AWAIT((co), commc_coro_yield(co))
+
+/*
+	==================================
+             --- CORE API ---
+	==================================
+*/
+
+/*
+
+         commc_coro_start()
+	       ---
+	       initializes co and runs its body up to the first
+	       await. on_done runs when the body finishes, which
+	       may already happen inside this call.
+
+	       returns:
+	       - COMMC_SUCCESS if the coroutine was started
+	       - COMMC_ARGUMENT_ERROR for invalid parameters
+
+*/
+
+commc_error_t commc_coro_start(commc_coro_t* co,
+                               commc_async_context_t* ctx,
+                               commc_coro_fn fn,
+                               commc_coro_done_fn on_done);
+
+/*
+
+         commc_coro_resume()
+	       ---
+	       runs the body from its last await. the await
+	       callbacks call this; it is public so a coroutine
+	       can also wait on events of its own (set co->line
+	       with an await of a custom submit function that
+	       returns 0 and resume it later).
+
+*/
+
+void commc_coro_resume(commc_coro_t* co);
+
+/*
+
+         commc_coro_set_timeout()
+	       ---
+	       bounds every following read, write, accept and
+	       connect await by timeout_ms (0 removes the bound).
+	       an await that runs out cancels its handle's
+	       operations and resumes with error ETIMEDOUT.
+
+*/
+
+void commc_coro_set_timeout(commc_coro_t* co,
+                            unsigned long timeout_ms);
+
+/*
+
+         commc_coro_suspend()
+	       ---
+	       used by COMMC_CORO_AWAIT: takes the return value of
+	       a submit function and tells whether the body must
+	       suspend (1) or continue because submission failed
+	       (0, with result.error_code set).
+
+*/
+
+int commc_coro_suspend(commc_coro_t* co,
+                       int submit_status);
+
+/*
+	==================================
+             --- AWAITABLE OPERATIONS ---
+	==================================
+*/
+
+/*
+
+         commc_coro_read() / commc_coro_write()
+	       ---
+	       commc_async_read()/commc_async_write() resuming co.
+	       a write completes once something was written;
+	       result.bytes_transferred may be short.
+
+	       returns:
+	       - 0 if submitted, -1 on error
+
+*/
+
+int commc_coro_read(commc_coro_t* co,
+                    int handle,
+                    void* buffer,
+                    size_t size);
+
+int commc_coro_write(commc_coro_t* co,
+                     int handle,
+                     const void* buffer,
+                     size_t size);
+
+/*
+
+         commc_coro_accept()
+	       ---
+	       commc_async_accept() resuming co; the new handle is
+	       stored in *accept_handle.
+
+	       returns:
+	       - 0 if submitted, -1 on error
+
+*/
+
+int commc_coro_accept(commc_coro_t* co,
+                      int listen_handle,
+                      int* accept_handle,
+                      void* address,
+                      size_t address_size);
+
+/*
+
+         commc_coro_connect()
+	       ---
+	       commc_async_connect() resuming co.
+
+	       returns:
+	       - 0 if submitted, -1 on error
+
+*/
+
+int commc_coro_connect(commc_coro_t* co,
+                       int handle,
+                       const void* address,
+                       size_t address_size);
+
+/*
+
+         commc_coro_sleep()
+	       ---
+	       resumes co after ms milliseconds on the context's
+	       timing wheel.
+
+	       returns:
+	       - 0 if armed, -1 on error
+
+*/
+
+int commc_coro_sleep(commc_coro_t* co,
+                     unsigned long ms);
+
+/*
+
+         commc_coro_yield()
+	       ---
+	       resumes co from the next poll, letting other
+	       sessions run first.
+
+	       returns:
+	       - 0 if posted, -1 on error
+
+*/
+
+int commc_coro_yield(commc_coro_t* co);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMMC_CORO_H */
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
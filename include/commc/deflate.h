@@ -14,10 +14,6 @@
     LZ77 and Huffman coding in a two-stage pipeline for
     maximum compression efficiency.
 
-    this module follows the deflate algorithm specification
-    used in gzip, zip, and PNG formats, providing industry-
-    standard compression with excellent ratios and speed.
-
     stage 1: LZ77 compression reduces redundancy by finding
              repeated sequences and replacing them with
              back-references.
@@ -26,6 +22,24 @@
              to the LZ77 symbol stream, further reducing
              the data size.
 
+    deprecated: this module's output is not the RFC 1951
+    DEFLATE format, so gzip, zlib, zip and PNG tools cannot
+    read it, nor it theirs. new code should use flate.h,
+    which reads and writes real DEFLATE (bare, zlib or
+    gzip) as a stream:
+
+      commc_deflate_context_create()  ->  commc_flate_encoder_create()
+                                          or commc_flate_decoder_create()
+                                          with COMMC_FLATE_RAW
+      commc_deflate_compress()        ->  commc_flate_encoder_write()
+                                          then commc_flate_encoder_finish()
+      commc_deflate_decompress()      ->  commc_flate_decoder_write()
+                                          then commc_flate_decoder_finish()
+      commc_deflate_set_level()       ->  the level given at creation
+
+    flate.h cannot read data compressed here; keep this
+    module only to read such data back.
+
 */
 
 #ifndef COMMC_DEFLATE_H
@@ -225,6 +239,8 @@ typedef struct {
 	       ---
 	       creates and initializes a deflate compression
 	       context with specified parameters.
+	       deprecated: use commc_flate_encoder_create()
+	       or commc_flate_decoder_create() (flate.h).
 	       
 	       parameters:
 	         window_size - LZ77 sliding window size
@@ -260,6 +276,8 @@ void commc_deflate_context_destroy(commc_deflate_context_t* ctx);
 	       ---
 	       compresses input data using the two-stage
 	       LZ77+Huffman deflate algorithm.
+	       deprecated: use commc_flate_encoder_write()
+	       (flate.h), which writes RFC 1951 DEFLATE.
 	       
 	       parameters:
 	         ctx - compression context
@@ -283,6 +301,9 @@ int commc_deflate_compress(commc_deflate_context_t* ctx,
 	       ---
 	       decompresses deflate-compressed data back to
 	       the original uncompressed form.
+	       deprecated: use commc_flate_decoder_write()
+	       (flate.h) for RFC 1951 DEFLATE; this only reads
+	       what commc_deflate_compress() wrote.
 	       
 	       parameters:
 	         ctx - decompression context
@@ -19,6 +19,12 @@
 	    production-ready error handling and
 	    C89 compliance throughout.
 
+	    commc_email_parse_message() takes the whole
+	    message in memory. for large messages,
+	    commc_email_parse_from_file() streams the file
+	    through commc_mime_parser_t (mime.h), which can
+	    also be used directly to walk every part.
+
 */
 
 #ifndef COMMC_EMAIL_H
@@ -606,7 +612,12 @@ commc_error_t commc_email_create_simple(commc_email_message_t** message,
          commc_email_parse_from_file()
 	       ---
 	       parses email message from file
-	       on disk.
+	       on disk without loading it whole.
+	       headers are read as by
+	       commc_email_parse_headers(); the body
+	       is the decoded text of the first
+	       text/plain part that is not an
+	       attachment.
 
 */
 
@@ -0,0 +1,282 @@
+/*
+   ===================================
+   C O M M O N - C
+   EPOCH-BASED RECLAMATION MODULE
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+            --- EPOCH RECLAMATION MODULE ---
+
+    deferred memory reclamation for lock-free data structures.
+    an object unlinked from a shared structure is "retired"
+    instead of freed; it is released once every thread that
+    might still hold a reference has moved on.
+
+    a domain keeps a global epoch and one record per thread.
+    two flavors are supported:
+
+    - EBR (epoch-based reclamation): readers bracket accesses
+      with commc_epoch_enter() / commc_epoch_exit(). threads
+      outside a critical section never delay reclamation.
+    - QSBR (quiescent-state-based reclamation): threads are
+      considered inside a critical section whenever they are
+      online and report commc_epoch_quiescent() at points where
+      they hold no references. readers pay no fence at all, but
+      an online thread that stops reporting blocks reclamation
+      until it goes offline.
+
+    compared with hazard pointers, protection costs one store
+    (plus one fence for EBR) per operation rather than per
+    node, and the number of threads is unbounded. the price is
+    that retired memory is only bounded while every thread
+    makes progress: a thread stalled inside a critical section
+    pins everything retired after it entered.
+
+    objects embed a commc_epoch_entry_t, so retiring never
+    allocates. per-thread records are found through thread-
+    local storage and released automatically on thread exit.
+
+*/
+
+#ifndef COMMC_EPOCH_H
+#define COMMC_EPOCH_H
+
+/*
+	==================================
+             --- INCLUDES ---
+	==================================
+*/
+
+#include "commc/error.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	==================================
+             --- CONSTANTS ---
+	==================================
+*/
+
+#define COMMC_EPOCH_RECLAIM_THRESHOLD  64   /* RETIRES BETWEEN RECLAIM ATTEMPTS */
+
+/*
+	==================================
+             --- TYPES ---
+	==================================
+*/
+
+/*
+
+         commc_epoch_flavor_t
+	       ---
+	       reclamation scheme of a domain.
+
+*/
+
+typedef enum {
+
+  COMMC_EPOCH_EBR  = 0,   /* EXPLICIT ENTER/EXIT CRITICAL SECTIONS */
+  COMMC_EPOCH_QSBR = 1    /* QUIESCENT-STATE ANNOUNCEMENTS */
+
+} commc_epoch_flavor_t;
+
+/*
+
+         commc_epoch_entry_t
+	       ---
+	       intrusive retire link embedded in reclaimable
+	       objects. free_fn receives the entry and recovers
+	       the enclosing object from it.
+
+*/
+
+typedef struct commc_epoch_entry_t {
+
+  struct commc_epoch_entry_t*  next;                                   /* LIMBO LIST LINK */
+  void                       (*free_fn)(struct commc_epoch_entry_t*);  /* DESTRUCTOR */
+
+} commc_epoch_entry_t;
+
+typedef void (*commc_epoch_free_fn)(commc_epoch_entry_t* entry);
+
+/*
+
+         commc_epoch_domain_t / commc_epoch_record_t
+	       ---
+	       opaque domain and per-thread record.
+
+*/
+
+typedef struct commc_epoch_domain_t commc_epoch_domain_t;
+typedef struct commc_epoch_record_t commc_epoch_record_t;
+
+/*
+	==================================
+             --- DOMAIN API ---
+	==================================
+*/
+
+/*
+
+         commc_epoch_create()
+	       ---
+	       creates a reclamation domain of the given flavor.
+
+	       returns:
+	       - pointer to new domain, or NULL on error
+
+*/
+
+commc_epoch_domain_t* commc_epoch_create(commc_epoch_flavor_t flavor);
+
+/*
+
+         commc_epoch_destroy()
+	       ---
+	       frees every pending object and all records. no
+	       thread may use the domain concurrently.
+
+*/
+
+void commc_epoch_destroy(commc_epoch_domain_t* domain);
+
+/*
+
+         commc_epoch_get_flavor()
+	       ---
+	       returns the flavor the domain was created with.
+
+*/
+
+commc_epoch_flavor_t commc_epoch_get_flavor(const commc_epoch_domain_t* domain);
+
+/*
+
+         commc_epoch_pending()
+	       ---
+	       returns the number of retired objects not yet
+	       freed, summed over all records. approximate while
+	       other threads are running.
+
+*/
+
+size_t commc_epoch_pending(const commc_epoch_domain_t* domain);
+
+/*
+	==================================
+             --- THREAD API ---
+	==================================
+*/
+
+/*
+
+         commc_epoch_self()
+	       ---
+	       returns the calling thread's record, claiming a free
+	       one or allocating a new one on first use. in QSBR
+	       domains a new record starts online.
+
+	       returns:
+	       - record pointer, or NULL if allocation failed
+
+*/
+
+commc_epoch_record_t* commc_epoch_self(commc_epoch_domain_t* domain);
+
+/*
+
+         commc_epoch_unregister()
+	       ---
+	       releases the calling thread's record for reuse. its
+	       pending objects stay with the record and are freed
+	       by the next owner. done automatically at thread exit.
+
+*/
+
+void commc_epoch_unregister(commc_epoch_domain_t* domain);
+
+/*
+
+         commc_epoch_enter() / commc_epoch_exit()
+	       ---
+	       brackets an EBR critical section. sections nest.
+	       no-ops in QSBR domains.
+
+*/
+
+void commc_epoch_enter(commc_epoch_record_t* record);
+void commc_epoch_exit(commc_epoch_record_t* record);
+
+/*
+
+         commc_epoch_quiescent()
+	       ---
+	       QSBR: announces that the thread holds no references
+	       to shared objects. no-op in EBR domains.
+
+*/
+
+void commc_epoch_quiescent(commc_epoch_record_t* record);
+
+/*
+
+         commc_epoch_online() / commc_epoch_offline()
+	       ---
+	       QSBR: an offline thread never delays reclamation and
+	       must not access shared objects. threads that block
+	       or idle for long should go offline first. going
+	       online while already online does nothing. no-ops in
+	       EBR domains.
+
+*/
+
+void commc_epoch_online(commc_epoch_record_t* record);
+void commc_epoch_offline(commc_epoch_record_t* record);
+
+/*
+
+         commc_epoch_retire()
+	       ---
+	       schedules entry for free_fn once no thread can still
+	       reference it. must be called after the object has been
+	       unlinked. every COMMC_EPOCH_RECLAIM_THRESHOLD retires
+	       the record tries to advance the epoch and free its
+	       expired objects.
+
+*/
+
+void commc_epoch_retire(commc_epoch_record_t* record,
+                        commc_epoch_entry_t* entry,
+                        commc_epoch_free_fn free_fn);
+
+/*
+
+         commc_epoch_reclaim()
+	       ---
+	       tries to advance the global epoch and frees the
+	       record's expired objects.
+
+	       returns:
+	       - number of objects freed
+
+*/
+
+size_t commc_epoch_reclaim(commc_epoch_record_t* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMMC_EPOCH_H */
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
@@ -0,0 +1,314 @@
+/*
+   ===================================
+   F L A T E . H
+   STREAMING DEFLATE, ZLIB AND GZIP HEADER
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    streaming encoder and decoder for the DEFLATE
+	    format (RFC 1951), bare or in a zlib (RFC 1950) or
+	    gzip (RFC 1952) wrapper, as used by HTTP
+	    Content-Encoding and most file formats.
+
+	    both sides are push-style: input goes in through
+	    write() in pieces of any size, and output leaves
+	    through a callback as it is produced, so neither
+	    side ever holds a whole payload. a decoder keeps
+	    the 32 KB window the format needs; an encoder a
+	    64 KB window, its hash chains and one block of
+	    symbols (about 240 KB in all).
+
+	    the encoder searches hash chains for matches
+	    (longer chains at higher levels) and writes each
+	    block stored, with the fixed codes or with codes
+	    built for it, whichever is smallest. level 0 only
+	    stores.
+
+	    this module replaces the deprecated
+	    commc_deflate_* functions (deflate.h), whose
+	    output is not RFC 1951 and cannot be read here;
+	    deflate.h lists what to use for each of them.
+
+*/
+
+#ifndef COMMC_FLATE_H
+#define COMMC_FLATE_H
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#include <stddef.h>
+
+#include "error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	==================================
+           --- CONSTANTS ---
+	==================================
+*/
+
+#define COMMC_FLATE_LEVEL_STORE     0      /* NO COMPRESSION */
+#define COMMC_FLATE_LEVEL_FAST      1      /* SHORTEST MATCH SEARCH */
+#define COMMC_FLATE_LEVEL_DEFAULT   6      /* BALANCED SPEED AND RATIO */
+#define COMMC_FLATE_LEVEL_BEST      9      /* LONGEST MATCH SEARCH */
+
+/*
+	==================================
+             --- ENUMS ---
+	==================================
+*/
+
+/*
+
+         commc_flate_format_t
+	       ---
+	       the wrapper around the DEFLATE data. AUTO is for
+	       decoders only: it takes gzip or zlib when the
+	       stream starts with their header and bare DEFLATE
+	       otherwise, which covers HTTP's "deflate" coding
+	       as servers actually send it.
+
+*/
+
+typedef enum {
+
+    COMMC_FLATE_RAW,      /* BARE RFC 1951 */
+    COMMC_FLATE_ZLIB,     /* RFC 1950: 2-BYTE HEADER, ADLER-32 */
+    COMMC_FLATE_GZIP,     /* RFC 1952: 10-BYTE HEADER, CRC-32, SIZE */
+    COMMC_FLATE_AUTO      /* DECODER: DETECT FROM THE FIRST BYTES */
+
+} commc_flate_format_t;
+
+/*
+	==================================
+           --- STRUCTURES ---
+	==================================
+*/
+
+/*
+
+         commc_flate_output_t
+	       ---
+	       receives output as it is produced. data is only
+	       valid during the call. returning anything but
+	       COMMC_SUCCESS stops the stream with that error.
+
+*/
+
+typedef commc_error_t (*commc_flate_output_t)(const char* data,
+                                              size_t      length,
+                                              void*       user_data);
+
+/*
+
+         commc_flate_decoder_t / commc_flate_encoder_t
+	       ---
+	       opaque stream states.
+
+*/
+
+typedef struct commc_flate_decoder_t commc_flate_decoder_t;
+typedef struct commc_flate_encoder_t commc_flate_encoder_t;
+
+/*
+	==================================
+            --- DECODING ---
+	==================================
+*/
+
+/*
+
+         commc_flate_decoder_create()
+	       ---
+	       creates a decoder handing what it decodes to
+	       output.
+
+*/
+
+commc_error_t commc_flate_decoder_create(commc_flate_decoder_t** decoder,
+                                         commc_flate_format_t    format,
+                                         commc_flate_output_t    output,
+                                         void*                   user_data);
+
+/*
+
+         commc_flate_decoder_destroy()
+	       ---
+	       frees a decoder.
+
+*/
+
+void commc_flate_decoder_destroy(commc_flate_decoder_t* decoder);
+
+/*
+
+         commc_flate_decoder_reset()
+	       ---
+	       readies a decoder for a new stream of the format
+	       it was created for, keeping its output.
+
+*/
+
+void commc_flate_decoder_reset(commc_flate_decoder_t* decoder);
+
+/*
+
+         commc_flate_decoder_write()
+	       ---
+	       decodes the next length bytes of the stream.
+	       everything they complete is passed to output
+	       before it returns. bytes after the end of the
+	       stream are ignored.
+
+	       returns:
+	       - COMMC_SUCCESS if the bytes were consumed
+	       - COMMC_FORMAT_ERROR for a corrupt stream or a
+	         checksum mismatch (the decoder stays failed)
+	       - the output callback's error
+
+*/
+
+commc_error_t commc_flate_decoder_write(commc_flate_decoder_t* decoder,
+                                        const void*            data,
+                                        size_t                 length);
+
+/*
+
+         commc_flate_decoder_finish()
+	       ---
+	       checks that the stream has ended.
+
+	       returns:
+	       - COMMC_SUCCESS if it ended, checksums matching
+	       - COMMC_FORMAT_ERROR if it was cut short or
+	         failed earlier
+
+*/
+
+commc_error_t commc_flate_decoder_finish(commc_flate_decoder_t* decoder);
+
+/*
+	==================================
+            --- ENCODING ---
+	==================================
+*/
+
+/*
+
+         commc_flate_encoder_create()
+	       ---
+	       creates an encoder for format (not AUTO) at
+	       level 0 to 9, handing the compressed stream to
+	       output.
+
+*/
+
+commc_error_t commc_flate_encoder_create(commc_flate_encoder_t** encoder,
+                                         commc_flate_format_t    format,
+                                         int                     level,
+                                         commc_flate_output_t    output,
+                                         void*                   user_data);
+
+/*
+
+         commc_flate_encoder_destroy()
+	       ---
+	       frees an encoder.
+
+*/
+
+void commc_flate_encoder_destroy(commc_flate_encoder_t* encoder);
+
+/*
+
+         commc_flate_encoder_reset()
+	       ---
+	       readies an encoder for a new stream with the
+	       same format, level and output, sparing the
+	       allocation of a new one.
+
+*/
+
+void commc_flate_encoder_reset(commc_flate_encoder_t* encoder);
+
+/*
+
+         commc_flate_encoder_write()
+	       ---
+	       compresses the next length bytes. output is
+	       produced a block at a time, so most calls pass
+	       nothing on yet.
+
+*/
+
+commc_error_t commc_flate_encoder_write(commc_flate_encoder_t* encoder,
+                                        const void*            data,
+                                        size_t                 length);
+
+/*
+
+         commc_flate_encoder_finish()
+	       ---
+	       compresses what is left, ends the stream and
+	       passes the rest of it to output. nothing may be
+	       written afterwards.
+
+*/
+
+commc_error_t commc_flate_encoder_finish(commc_flate_encoder_t* encoder);
+
+/*
+	==================================
+           --- CHECKSUMS ---
+	==================================
+*/
+
+/*
+
+         commc_flate_crc32()
+	       ---
+	       continues the gzip CRC-32 crc (0 to start) over
+	       length bytes.
+
+*/
+
+unsigned long commc_flate_crc32(unsigned long crc,
+                                const void*   data,
+                                size_t        length);
+
+/*
+
+         commc_flate_adler32()
+	       ---
+	       continues the zlib Adler-32 adler (1 to start)
+	       over length bytes.
+
+*/
+
+unsigned long commc_flate_adler32(unsigned long adler,
+                                  const void*   data,
+                                  size_t        length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMMC_FLATE_H */
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
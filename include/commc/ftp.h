@@ -19,6 +19,23 @@
 	    download, directory listing, and remote file
 	    management operations with C89 compliance.
 
+	    large binary downloads can be split into byte
+	    ranges fetched over parallel connections (REST
+	    and RETR on each), which fills high-latency links
+	    that a single TCP stream cannot.
+
+	    transfers move through one reusable buffer per
+	    client (COMMC_FTP_TRANSFER_BUFFER_SIZE unless the
+	    caller supplies one), and segmented downloads take
+	    theirs from a pool kept with the client, so a
+	    transfer of any size allocates nothing once
+	    warmed up. binary uploads go from the file to the
+	    socket with sendfile; ASCII uploads convert line
+	    ends straight out of a mapping of the file. the
+	    stream variants hand data to and from callbacks
+	    instead of files, and a progress callback hears
+	    bytes moved and throughput as transfers run.
+
 */
 
 #ifndef COMMC_FTP_H
@@ -30,7 +47,11 @@
 	==================================
 */
 
+#include <stddef.h>
+
 #include "error.h"
+#include "bufreader.h"
+#include "memory.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +72,11 @@ extern "C" {
 #define COMMC_FTP_DEFAULT_PORT          21
 #define COMMC_FTP_DEFAULT_TIMEOUT       30
 #define COMMC_FTP_BUFFER_SIZE          8192
+#define COMMC_FTP_MAX_SEGMENTS          16        /* Connections of a segmented download */
+#define COMMC_FTP_SEGMENT_MIN_SIZE      1048576   /* Smallest range worth its own connection */
+#define COMMC_FTP_SEGMENT_RETRIES       3         /* Resumes of a failed segment */
+#define COMMC_FTP_TRANSFER_BUFFER_SIZE  262144    /* Default transfer buffer */
+#define COMMC_FTP_PROGRESS_INTERVAL_MS  250       /* Least time between progress reports */
 
 /* 
 	==================================
@@ -144,6 +170,66 @@ typedef struct {
     char group[64];                        /* File group */
 } commc_ftp_file_info_t;
 
+/*
+
+         commc_ftp_progress_t
+	       ---
+	       how far a transfer got. total is 0 when the
+	       size is not known in advance.
+
+*/
+
+typedef struct {
+    size_t        transferred;       /* Bytes moved so far */
+    size_t        total;             /* Bytes expected, or 0 */
+    unsigned long elapsed_ms;        /* Time since the transfer began */
+    double        bytes_per_second;  /* Average throughput */
+} commc_ftp_progress_t;
+
+/*
+
+         commc_ftp_progress_callback_t
+	       ---
+	       receives progress during a transfer, at most
+	       every COMMC_FTP_PROGRESS_INTERVAL_MS and once at
+	       its end. returning anything but COMMC_SUCCESS
+	       aborts the transfer with that error.
+
+*/
+
+typedef commc_error_t (*commc_ftp_progress_callback_t)(const commc_ftp_progress_t* progress,
+                                                       void*                       user_data);
+
+/*
+
+         commc_ftp_sink_t
+	       ---
+	       receives downloaded data as it arrives. data is
+	       only valid during the call; returning anything
+	       but COMMC_SUCCESS aborts the transfer.
+
+*/
+
+typedef commc_error_t (*commc_ftp_sink_t)(const char* data,
+                                          size_t      length,
+                                          void*       user_data);
+
+/*
+
+         commc_ftp_source_t
+	       ---
+	       fills buffer with up to size bytes to upload
+	       and sets *length to how many; 0 ends the
+	       upload. returning anything but COMMC_SUCCESS
+	       aborts the transfer.
+
+*/
+
+typedef commc_error_t (*commc_ftp_source_t)(char*   buffer,
+                                            size_t  size,
+                                            size_t* length,
+                                            void*   user_data);
+
 /*
 
          commc_ftp_client_t
@@ -155,6 +241,7 @@ typedef struct {
 
 typedef struct {
     int                     control_socket;    /* Control connection socket */
+    commc_bufreader_t*      control_reader;    /* Buffered control replies */
     int                     data_socket;       /* Data connection socket */
     char                    hostname[COMMC_FTP_MAX_HOSTNAME_LENGTH];
     int                     port;              /* Server port */
@@ -166,6 +253,14 @@ typedef struct {
     int                     timeout;          /* Operation timeout */
     commc_ftp_response_t    last_response;    /* Last server response */
     char                    current_dir[COMMC_FTP_MAX_PATH_LENGTH];
+    char*                   buffer;           /* Transfer buffer */
+    size_t                  buffer_size;
+    int                     buffer_owned;     /* Allocated by the client */
+    commc_memory_pool_t*    segment_buffers;  /* Buffers of segmented downloads */
+    size_t                  segment_buffer_count;
+    commc_ftp_progress_callback_t progress;   /* Progress callback, or NULL */
+    void*                   progress_data;
+    commc_ftp_progress_t    last_transfer;    /* Totals of the last transfer */
 } commc_ftp_client_t;
 
 /* 
@@ -232,6 +327,50 @@ commc_error_t commc_ftp_set_mode(commc_ftp_client_t* client,
 commc_error_t commc_ftp_set_type(commc_ftp_client_t* client,
                                  commc_ftp_type_t    type);
 
+/*
+
+         commc_ftp_set_buffer()
+	       ---
+	       sets the buffer transfers read into and write
+	       from. a caller's buffer is not freed by the
+	       client and must outlive it; NULL has the client
+	       allocate size bytes (0 for the default) on first
+	       use. segmented downloads pool further buffers of
+	       the same size.
+
+*/
+
+commc_error_t commc_ftp_set_buffer(commc_ftp_client_t* client,
+                                   void*               buffer,
+                                   size_t              size);
+
+/*
+
+         commc_ftp_set_progress()
+	       ---
+	       sets the callback every transfer reports its
+	       progress to, or none with NULL. segmented
+	       downloads report the sum of their ranges from
+	       the calling thread.
+
+*/
+
+commc_error_t commc_ftp_set_progress(commc_ftp_client_t*            client,
+                                     commc_ftp_progress_callback_t callback,
+                                     void*                          user_data);
+
+/*
+
+         commc_ftp_get_transfer_stats()
+	       ---
+	       copies the totals of the last transfer: bytes
+	       moved, time taken and average throughput.
+
+*/
+
+commc_error_t commc_ftp_get_transfer_stats(const commc_ftp_client_t* client,
+                                           commc_ftp_progress_t*     progress);
+
 /* 
 	==================================
         --- CONNECTION MANAGEMENT ---
@@ -294,12 +433,27 @@ commc_error_t commc_ftp_upload_file(commc_ftp_client_t* client,
                                     const char*         local_path,
                                     const char*         remote_path);
 
+/*
+
+         commc_ftp_upload_stream()
+	       ---
+	       uploads what source produces to remote_path,
+	       a transfer buffer at a time, until it reports
+	       a length of 0.
+
+*/
+
+commc_error_t commc_ftp_upload_stream(commc_ftp_client_t* client,
+                                      const char*         remote_path,
+                                      commc_ftp_source_t  source,
+                                      void*               user_data);
+
 /*
 
          commc_ftp_download_file()
 	       ---
 	       downloads remote file to local system
-	       with progress tracking capability.
+	       over one passive data connection.
 
 */
 
@@ -307,6 +461,61 @@ commc_error_t commc_ftp_download_file(commc_ftp_client_t* client,
                                       const char*         remote_path,
                                       const char*         local_path);
 
+/*
+
+         commc_ftp_download_stream()
+	       ---
+	       downloads a remote file into sink as it
+	       arrives, a transfer buffer at a time. the
+	       progress total is the size the server announces
+	       when it starts sending, if it does.
+
+*/
+
+commc_error_t commc_ftp_download_stream(commc_ftp_client_t* client,
+                                        const char*         remote_path,
+                                        commc_ftp_sink_t    sink,
+                                        void*               user_data);
+
+/*
+
+         commc_ftp_download_segmented()
+	       ---
+	       downloads a binary file as up to segments
+	       disjoint byte ranges at once. each range gets
+	       its own login with the client's host and
+	       credentials, and its own thread, which sends
+	       REST and RETR and writes what arrives straight
+	       at the range's offset in local_path, created at
+	       full size first. a range that fails is resumed
+	       where it stopped, up to COMMC_FTP_SEGMENT_RETRIES
+	       times.
+
+	       ranges are at least COMMC_FTP_SEGMENT_MIN_SIZE
+	       bytes; ASCII type, a single segment, a small file
+	       or a server without SIZE fall back to
+	       commc_ftp_download_file(), and so does a system
+	       that cannot start the threads. the server must
+	       allow segments + 1 logins at once and support
+	       REST. the first range to fail for good stops the
+	       others, and a download that fails removes
+	       local_path rather than leave it at full size.
+
+	       returns:
+	       - COMMC_SUCCESS once every range is written
+	       - COMMC_IO_ERROR if local_path cannot be
+	         created or written
+	       - the error of the first range that failed
+	         (COMMC_NOT_IMPLEMENTED_ERROR if REST was
+	         refused)
+
+*/
+
+commc_error_t commc_ftp_download_segmented(commc_ftp_client_t* client,
+                                           const char*         remote_path,
+                                           const char*         local_path,
+                                           int                 segments);
+
 /*
 
          commc_ftp_delete_file()
@@ -426,7 +635,9 @@ commc_error_t commc_ftp_list_directory(commc_ftp_client_t*    client,
          commc_ftp_send_command()
 	       ---
 	       sends raw FTP command to server
-	       and retrieves response.
+	       and retrieves response. the CRLF is
+	       added here; a command holding CR or LF
+	       is refused with COMMC_ERROR_INVALID_ARGUMENT.
 
 */
 
@@ -19,6 +19,17 @@
 	    maintaining C89 compliance and cross-platform
 	    socket compatibility.
 
+	    batches of requests can run concurrently through a
+	    commc_http_multi_t, which spreads them over the
+	    client's pooled connections on a commc_async_context_t
+	    and can pipeline several on each.
+
+	    response bodies sent with gzip or deflate
+	    Content-Encoding are decoded as they arrive (the
+	    client asks for them with Accept-Encoding), and
+	    request bodies above a set size can be sent
+	    gzipped.
+
 */
 
 #ifndef COMMC_HTTP_H
@@ -31,6 +42,7 @@
 */
 
 #include "error.h"
+#include "socketpool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,6 +61,9 @@ extern "C" {
 #define COMMC_HTTP_DEFAULT_TIMEOUT     30     /* DEFAULT TIMEOUT SECONDS */
 #define COMMC_HTTP_DEFAULT_PORT        80     /* DEFAULT HTTP PORT */
 #define COMMC_HTTP_DEFAULT_HTTPS_PORT  443    /* DEFAULT HTTPS PORT */
+#define COMMC_HTTP_KEEPALIVE_IDLE_MS   4000UL /* IDLE CONNECTION LIFETIME MS */
+#define COMMC_HTTP_MULTI_CONNECTIONS   8      /* DEFAULT CONCURRENT CONNECTIONS PER HOST */
+#define COMMC_HTTP_MULTI_PIPELINE      1      /* DEFAULT REQUESTS IN FLIGHT PER CONNECTION */
 
 /* 
 	==================================
@@ -176,6 +191,10 @@ typedef struct {
     char*                body;                            /* REQUEST BODY */
     size_t               body_length;                     /* BODY LENGTH */
     
+    int                  body_file;                       /* FILE BODY, -1 FOR NONE */
+    size_t               body_file_offset;                /* FILE BODY START */
+    size_t               body_file_length;                /* FILE BODY LENGTH */
+    
     int                  timeout_seconds;                 /* REQUEST TIMEOUT */
     int                  follow_redirects;                /* REDIRECT FLAG */
     int                  max_redirects;                   /* MAX REDIRECTS */
@@ -212,6 +231,22 @@ typedef struct {
 
 } commc_http_response_t;
 
+/*
+
+         commc_http_body_callback_t
+	       ---
+	       receives a response body piece by piece as it
+	       arrives (chunked framing already removed). data
+	       is only valid during the call. returning
+	       anything but COMMC_SUCCESS aborts the request
+	       with that error.
+
+*/
+
+typedef commc_error_t (*commc_http_body_callback_t)(const char* data,
+                                                    size_t      length,
+                                                    void*       user_data);
+
 /*
 
          commc_http_client_t
@@ -233,6 +268,10 @@ typedef struct {
     int  follow_redirects;                                /* REDIRECT HANDLING */
     int  max_redirects;                                   /* MAX REDIRECTS */
     
+    commc_socketpool_t* pool;                             /* IDLE KEEP-ALIVE CONNECTIONS */
+    int                 decompress;                       /* ACCEPT AND DECODE GZIP/DEFLATE */
+    size_t              compress_threshold;               /* GZIP REQUEST BODIES THIS LARGE, 0 NEVER */
+    
     commc_http_header_t default_headers[COMMC_HTTP_MAX_HEADERS]; /* DEFAULT HEADERS */
     int                 default_header_count;             /* DEFAULT HEADER COUNT */
     
@@ -240,6 +279,34 @@ typedef struct {
 
 } commc_http_client_t;
 
+/*
+
+         commc_http_multi_t
+	       ---
+	       opaque set of requests executed concurrently
+	       over a client's pooled connections.
+
+*/
+
+typedef struct commc_http_multi_t commc_http_multi_t;
+
+/*
+
+         commc_http_completion_callback_t
+	       ---
+	       reports a request added to a commc_http_multi_t
+	       as finished, with the result
+	       commc_http_client_execute() would have returned.
+	       runs on the context's loop thread; it may add
+	       more requests.
+
+*/
+
+typedef void (*commc_http_completion_callback_t)(commc_http_request_t*  request,
+                                                 commc_http_response_t* response,
+                                                 commc_error_t          result,
+                                                 void*                  user_data);
+
 /* 
 	==================================
              --- CORE ---
@@ -293,6 +360,47 @@ commc_error_t commc_http_client_set_timeout(commc_http_client_t* client,
                                              int                  connection_timeout,
                                              int                  request_timeout);
 
+/*
+
+         commc_http_client_set_keep_alive()
+	       ---
+	       enables (the default) or disables connection
+	       reuse. with it on, a connection whose response
+	       was read in full and that the server did not
+	       close is parked per host:port for the next
+	       request; with it off every request sends
+	       "Connection: close" and closes its connection.
+
+*/
+
+commc_error_t commc_http_client_set_keep_alive(commc_http_client_t* client,
+                                                int                  enabled);
+
+/*
+
+         commc_http_client_set_compression()
+	       ---
+	       sets the Content-Encoding policy. with
+	       decompress on (the default) requests carry
+	       "Accept-Encoding: gzip, deflate" and bodies
+	       coded so are decoded on the fly, before the body
+	       callback or response->body see them; response
+	       headers stay as received. a request with its
+	       own Accept-Encoding header gets its body as
+	       sent. in-memory request bodies of at least
+	       request_threshold bytes (0, the default, for
+	       none) are gzipped as they are sent, in
+	       chunked framing, unless the request already
+	       sets Content-Length, Content-Encoding or
+	       Transfer-Encoding; file bodies are always sent
+	       as they are.
+
+*/
+
+commc_error_t commc_http_client_set_compression(commc_http_client_t* client,
+                                                 int                  decompress,
+                                                 size_t               request_threshold);
+
 /*
 
          commc_http_client_add_default_header()
@@ -384,6 +492,24 @@ commc_error_t commc_http_request_set_body(commc_http_request_t* request,
                                            const char*           body,
                                            size_t                body_length);
 
+/*
+
+         commc_http_request_set_body_file()
+	       ---
+	       sends length bytes of an open file, starting at
+	       offset, as the request body. the bytes go from
+	       the file to the socket without being read into
+	       memory (see commc_socket_send_file()). the
+	       request does not own file_handle; it must stay
+	       open until the request has been executed.
+
+*/
+
+commc_error_t commc_http_request_set_body_file(commc_http_request_t* request,
+                                                int                   file_handle,
+                                                size_t                offset,
+                                                size_t                length);
+
 /*
 
          commc_http_request_set_form_data()
@@ -472,6 +598,13 @@ commc_http_status_class_t commc_http_response_get_status_class(commc_http_respon
 	       executes an HTTP request using the client,
 	       handling connection, transmission, and response
 	       processing with timeout and redirect support.
+	       the body is collected, NUL-terminated, in
+	       response->body. it is read by Content-Length or chunked
+	       framing, so a kept-alive connection ends
+	       exactly at the end of the response; a reused
+	       connection the server had already closed is
+	       retried once on a new one for requests that
+	       are safe to repeat.
 
 */
 
@@ -479,6 +612,38 @@ commc_error_t commc_http_client_execute(commc_http_client_t*  client,
                                          commc_http_request_t* request,
                                          commc_http_response_t* response);
 
+/*
+
+         commc_http_client_execute_stream()
+	       ---
+	       like commc_http_client_execute(), but the body
+	       is handed to callback as it is received instead
+	       of being collected: response gets the status
+	       and headers, and memory use stays the same
+	       whatever the size of the body.
+
+*/
+
+commc_error_t commc_http_client_execute_stream(commc_http_client_t*       client,
+                                                commc_http_request_t*      request,
+                                                commc_http_response_t*     response,
+                                                commc_http_body_callback_t callback,
+                                                void*                      user_data);
+
+/*
+
+         commc_http_sink_file()
+	       ---
+	       a body callback for commc_http_client_execute_stream()
+	       that writes the body to the FILE* passed as
+	       user_data.
+
+*/
+
+commc_error_t commc_http_sink_file(const char* data,
+                                   size_t      length,
+                                   void*       user_data);
+
 /*
 
          commc_http_get()
@@ -531,6 +696,134 @@ commc_error_t commc_http_post_form(const char*            url,
                                     const char*            form_data,
                                     commc_http_response_t* response);
 
+/* 
+	==================================
+     --- CONCURRENT EXECUTION ---
+	==================================
+*/
+
+/*
+
+         commc_http_multi_create()
+	       ---
+	       creates an empty request set for client. its
+	       connections run on ctx, or on a private context
+	       driven by commc_http_multi_wait() when ctx is
+	       NULL. connections come from the client's pool,
+	       so they are shared with, and kept alive for,
+	       commc_http_client_execute().
+
+*/
+
+commc_error_t commc_http_multi_create(commc_http_multi_t**   multi,
+                                      commc_http_client_t*   client,
+                                      commc_async_context_t* ctx);
+
+/*
+
+         commc_http_multi_destroy()
+	       ---
+	       closes the set's connections and frees it.
+	       requests still outstanding complete with
+	       COMMC_ERROR_INVALID_STATE. the context is polled
+	       until every operation and connection attempt has
+	       reported back, so call it from outside the
+	       context's callbacks.
+
+*/
+
+void commc_http_multi_destroy(commc_http_multi_t* multi);
+
+/*
+
+         commc_http_multi_set_limits()
+	       ---
+	       sets how many connections per host the set
+	       opens (the pool's max_per_host caps it too) and
+	       how many requests may be in flight on each.
+	       a depth above 1 pipelines: further GET, HEAD,
+	       PUT, DELETE and OPTIONS requests are written
+	       behind ones still unanswered. POST, PATCH and
+	       file bodies always travel alone.
+
+*/
+
+commc_error_t commc_http_multi_set_limits(commc_http_multi_t* multi,
+                                          size_t              max_connections,
+                                          size_t              pipeline_depth);
+
+/*
+
+         commc_http_multi_add()
+	       ---
+	       queues request and starts it as soon as a
+	       connection to its host has room. response
+	       collects the status, headers and the
+	       NUL-terminated body as with
+	       commc_http_client_execute(); both must stay
+	       valid until callback (which may be NULL) has
+	       run. requests to one host start in the order
+	       added. when a connection is lost before any of
+	       a request's response arrived, the request is
+	       sent once more if it is safe to repeat.
+
+*/
+
+commc_error_t commc_http_multi_add(commc_http_multi_t*              multi,
+                                   commc_http_request_t*            request,
+                                   commc_http_response_t*           response,
+                                   commc_http_completion_callback_t callback,
+                                   void*                            user_data);
+
+/*
+
+         commc_http_multi_wait()
+	       ---
+	       polls the context until every request added so
+	       far has completed.
+
+	       returns:
+	       - COMMC_SUCCESS once nothing is outstanding
+	       - COMMC_SYSTEM_ERROR if polling fails
+
+*/
+
+commc_error_t commc_http_multi_wait(commc_http_multi_t* multi);
+
+/*
+
+         commc_http_multi_get_outstanding()
+	       ---
+	       returns the number of requests added and not
+	       yet completed.
+
+*/
+
+size_t commc_http_multi_get_outstanding(const commc_http_multi_t* multi);
+
+/*
+
+         commc_http_client_execute_all()
+	       ---
+	       executes count requests concurrently on a
+	       private context, at most COMMC_HTTP_MULTI_CONNECTIONS
+	       connections per host with pipeline_depth
+	       requests in flight on each, and stores each
+	       request's result in results.
+
+	       returns:
+	       - COMMC_SUCCESS if every request succeeded
+	       - otherwise the first failing request's result
+
+*/
+
+commc_error_t commc_http_client_execute_all(commc_http_client_t*    client,
+                                            commc_http_request_t**  requests,
+                                            commc_http_response_t** responses,
+                                            commc_error_t*          results,
+                                            size_t                  count,
+                                            size_t                  pipeline_depth);
+
 /* 
 	==================================
            --- UTILITIES ---
@@ -0,0 +1,221 @@
+/*
+   ===================================
+   H T T P P A R S E R . H
+   HTTP/1.X MESSAGE HEAD PARSER HEADER
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    incremental parser for the head (start line and
+	    header fields) of HTTP/1.0 and HTTP/1.1 requests
+	    and responses. nothing is copied: the method,
+	    target, reason phrase and every header name and
+	    value come back as (pointer, length) views into the
+	    caller's buffer.
+
+	    the head may arrive in any number of fragments: the
+	    caller appends each one to the same buffer (a
+	    commc_bufreader_t does this) and calls
+	    commc_http_parser_execute() again with everything
+	    received so far. a head that arrives whole is parsed
+	    in a single pass; after a call that ran out of
+	    input, only the new bytes are searched for the end
+	    of the head, and the head is parsed again once.
+
+	    header values are scanned sixteen bytes at a time
+	    with SSE2 where the compiler targets it, a machine
+	    word at a time elsewhere. define
+	    COMMC_HTTP_PARSER_NO_SSE2 to force the word-wide
+	    scanner.
+
+	    CRLF and bare LF line ends are both accepted;
+	    folded (obs-fold) header lines are rejected.
+
+*/
+
+#ifndef COMMC_HTTPPARSER_H
+#define COMMC_HTTPPARSER_H
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#include <stddef.h>
+
+#include "error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	==================================
+           --- CONSTANTS ---
+	==================================
+*/
+
+#define COMMC_HTTP_PARSER_MAX_HEADERS  64     /* HEADER FIELDS PER HEAD */
+
+/*
+	==================================
+             --- ENUMS ---
+	==================================
+*/
+
+/*
+
+         commc_http_parser_type_t
+	       ---
+	       which kind of start line the parser expects.
+
+*/
+
+typedef enum {
+
+    COMMC_HTTP_PARSER_REQUEST,     /* METHOD TARGET HTTP/1.X */
+    COMMC_HTTP_PARSER_RESPONSE     /* HTTP/1.X CODE REASON */
+
+} commc_http_parser_type_t;
+
+/*
+	==================================
+           --- STRUCTURES ---
+	==================================
+*/
+
+/*
+
+         commc_http_header_view_t
+	       ---
+	       one header field as views into the parsed
+	       buffer. the value has surrounding whitespace
+	       trimmed; neither part is NUL-terminated.
+
+*/
+
+typedef struct {
+
+    const char* name;              /* FIELD NAME */
+    size_t      name_length;
+    const char* value;             /* FIELD VALUE */
+    size_t      value_length;
+
+} commc_http_header_view_t;
+
+/*
+
+         commc_http_parser_t
+	       ---
+	       parser state and, once the head is complete,
+	       its parts. the views stay valid as long as the
+	       parsed bytes do.
+
+*/
+
+typedef struct {
+
+    commc_http_parser_type_t type;                 /* REQUEST OR RESPONSE */
+    int                      partial;              /* AN EARLIER CALL RAN OUT OF INPUT */
+    size_t                   scanned;              /* BYTES SEARCHED FOR THE END OF THE HEAD */
+    size_t                   head_length;          /* HEAD SIZE, BLANK LINE INCLUDED */
+
+    const char*              method;               /* REQUEST METHOD */
+    size_t                   method_length;
+    const char*              target;               /* REQUEST TARGET */
+    size_t                   target_length;
+
+    int                      minor_version;        /* 0 OR 1, FROM HTTP/1.X */
+    int                      status_code;          /* RESPONSE STATUS */
+    const char*              reason;               /* RESPONSE REASON PHRASE */
+    size_t                   reason_length;
+
+    commc_http_header_view_t headers[COMMC_HTTP_PARSER_MAX_HEADERS];
+    size_t                   header_count;
+
+} commc_http_parser_t;
+
+/*
+	==================================
+             --- CORE ---
+	==================================
+*/
+
+/*
+
+         commc_http_parser_init()
+	       ---
+	       prepares a parser for one message head. call it
+	       again before parsing the next one.
+
+*/
+
+void commc_http_parser_init(commc_http_parser_t*     parser,
+                            commc_http_parser_type_t type);
+
+/*
+
+         commc_http_parser_execute()
+	       ---
+	       parses the head at the start of data, which holds
+	       every byte received so far (earlier calls' bytes
+	       included, in the same order).
+
+	       returns:
+	       - COMMC_SUCCESS once the head is complete, with
+	         head_length and the views filled in
+	       - COMMC_ERROR_WOULD_BLOCK if the head is not
+	         complete yet
+	       - COMMC_FORMAT_ERROR for a malformed head (once
+	         a call has run out of input, only when the
+	         blank line ending the head has arrived)
+	       - COMMC_ERROR_BUFFER_TOO_SMALL for more than
+	         COMMC_HTTP_PARSER_MAX_HEADERS header fields
+
+*/
+
+commc_error_t commc_http_parser_execute(commc_http_parser_t* parser,
+                                        const char*          data,
+                                        size_t               length);
+
+/*
+
+         commc_http_parser_find_header()
+	       ---
+	       returns the first header field named name,
+	       compared without regard to case, or NULL.
+
+*/
+
+const commc_http_header_view_t* commc_http_parser_find_header(const commc_http_parser_t* parser,
+                                                              const char*                name);
+
+/*
+
+         commc_http_parser_view_equals()
+	       ---
+	       compares a view with a NUL-terminated string
+	       without regard to case.
+
+*/
+
+int commc_http_parser_view_equals(const char* view,
+                                  size_t      view_length,
+                                  const char* string);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMMC_HTTPPARSER_H */
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
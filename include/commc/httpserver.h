@@ -0,0 +1,390 @@
+/*
+   ===================================
+   H T T P S E R V E R . H
+   EMBEDDED HTTP/1.1 SERVER HEADER
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    small HTTP/1.1 server for health, metrics and admin
+	    endpoints, running on a commc_async_context_t. it
+	    never blocks the loop: accepts, receives, sends and
+	    file transfers are all async operations, and request
+	    heads are parsed in place with commc_http_parser_t.
+
+	    - connections are persistent (HTTP/1.1 keep-alive,
+	      HTTP/1.0 with "Connection: keep-alive"); pipelined
+	      requests that arrive together are all answered
+	      and their responses leave in one send.
+	    - every connection owns one input and one output
+	      buffer. the input buffer grows to fit one request
+	      (head up to max_head, body up to max_body) and
+	      shrinks back once drained; larger requests are
+	      answered with 431 or 413 and the connection closed.
+	    - handlers are matched by method and path and answer
+	      from inside the call with commc_http_server_respond()
+	      or commc_http_server_respond_file(). files go out
+	      with sendfile (commc_async_sendfile()).
+	    - idle connections close after idle_timeout_ms, and a
+	      connection limit pauses accepting until one closes.
+
+	    - with compress_threshold set, in-memory responses
+	      at least that large with a textual Content-Type
+	      are gzipped for clients that accept it (and keep
+	      going out as they are when that does not shrink
+	      them). files are never compressed, so they keep
+	      going out with sendfile.
+	    - gzip and deflate request bodies are decoded
+	      before the handler sees them, the decoded size
+	      also held to max_body; other codings get 415.
+
+	    request bodies carry Content-Length or chunked
+	    framing; chunks are joined before the handler sees
+	    them and other transfer codings get 501. a sendfile on a
+	    connection the peer reset raises SIGPIPE on some
+	    systems, so processes serving files should ignore it.
+
+	    one server belongs to one context and its loop thread.
+	    to use several cores, create one server per loop of a
+	    commc_reactor_t and hand it accepted connections with
+	    commc_http_server_adopt().
+
+*/
+
+#ifndef COMMC_HTTPSERVER_H
+#define COMMC_HTTPSERVER_H
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#include <stddef.h>
+
+#include "error.h"
+#include "async.h"
+#include "httpparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	==================================
+           --- CONSTANTS ---
+	==================================
+*/
+
+#define COMMC_HTTP_SERVER_MAX_HEAD          8192       /* DEFAULT LARGEST REQUEST HEAD */
+#define COMMC_HTTP_SERVER_MAX_BODY          1048576    /* DEFAULT LARGEST REQUEST BODY */
+#define COMMC_HTTP_SERVER_IDLE_TIMEOUT_MS   5000UL     /* DEFAULT IDLE CONNECTION LIFETIME */
+#define COMMC_HTTP_SERVER_MAX_CONNECTIONS   4096       /* DEFAULT CONNECTION LIMIT */
+#define COMMC_HTTP_SERVER_BACKLOG           1024       /* DEFAULT LISTEN BACKLOG */
+#define COMMC_HTTP_SERVER_ACCEPT_BACKOFF_MS 100UL      /* RETRY DELAY WHEN OUT OF DESCRIPTORS */
+#define COMMC_HTTP_SERVER_COMPRESS_LEVEL    6          /* DEFAULT GZIP LEVEL OF RESPONSES */
+
+/*
+	==================================
+           --- STRUCTURES ---
+	==================================
+*/
+
+/*
+
+         commc_http_server_t
+	       ---
+	       opaque server state: listener, routes and open
+	       connections.
+
+*/
+
+typedef struct commc_http_server_t commc_http_server_t;
+
+/*
+
+         commc_http_server_connection_t
+	       ---
+	       opaque per-connection state.
+
+*/
+
+typedef struct commc_http_server_connection_t commc_http_server_connection_t;
+
+/*
+
+         commc_http_server_request_t
+	       ---
+	       one request as handed to a handler. every pointer
+	       refers to the connection's input buffer (or the
+	       server's decoding buffer for a compressed body)
+	       and is only valid during the handler call.
+
+*/
+
+typedef struct {
+
+    const commc_http_parser_t*      head;          /* METHOD, TARGET, VERSION, HEADERS */
+    const char*                     path;          /* TARGET UP TO '?' */
+    size_t                          path_length;
+    const char*                     query;         /* TARGET AFTER '?', EMPTY IF NONE */
+    size_t                          query_length;
+    const char*                     body;          /* CONTENT-LENGTH BYTES, DECODED IF GZIP OR DEFLATE */
+    size_t                          body_length;
+    int                             keep_alive;    /* CONNECTION STAYS OPEN AFTERWARDS */
+    int                             responded;     /* A RESPONSE WAS QUEUED */
+    commc_http_server_connection_t* connection;    /* WHERE THE RESPONSE GOES */
+
+} commc_http_server_request_t;
+
+/*
+
+         commc_http_server_handler_t
+	       ---
+	       route callback. it should respond before it
+	       returns; a request left unanswered gets a 500.
+
+*/
+
+typedef void (*commc_http_server_handler_t)(commc_http_server_request_t* request,
+                                            void*                        user_data);
+
+/*
+
+         commc_http_server_config_t
+	       ---
+	       creation parameters. fill with
+	       commc_http_server_config_init() and override
+	       fields.
+
+*/
+
+typedef struct {
+
+    size_t        max_head;              /* LARGEST REQUEST HEAD */
+    size_t        max_body;              /* LARGEST REQUEST BODY, ALSO ONCE DECODED */
+    unsigned long idle_timeout_ms;       /* CLOSE CONNECTIONS QUIET THIS LONG */
+    size_t        max_connections;       /* STOP ACCEPTING AT THIS MANY */
+    int           backlog;               /* LISTEN BACKLOG */
+    size_t        compress_threshold;    /* GZIP RESPONSE BODIES THIS LARGE, 0 NEVER */
+    int           compress_level;        /* GZIP LEVEL, 1 TO 9 */
+
+} commc_http_server_config_t;
+
+/*
+	==================================
+             --- CORE ---
+	==================================
+*/
+
+/*
+
+         commc_http_server_config_init()
+	       ---
+	       fills config with the COMMC_HTTP_SERVER_*
+	       defaults.
+
+*/
+
+void commc_http_server_config_init(commc_http_server_config_t* config);
+
+/*
+
+         commc_http_server_create()
+	       ---
+	       creates a server on ctx. config NULL uses the
+	       defaults. nothing is accepted until
+	       commc_http_server_listen() or adopt().
+
+*/
+
+commc_error_t commc_http_server_create(commc_http_server_t**             server,
+                                       commc_async_context_t*            ctx,
+                                       const commc_http_server_config_t* config);
+
+/*
+
+         commc_http_server_destroy()
+	       ---
+	       closes the listener and every connection and
+	       frees the server. on io_uring the context is
+	       polled until the cancelled operations have
+	       reported back, so call it from outside the
+	       context's callbacks.
+
+*/
+
+void commc_http_server_destroy(commc_http_server_t* server);
+
+/*
+
+         commc_http_server_listen()
+	       ---
+	       binds a TCP listener to host (NULL for every
+	       interface) and port (0 for an ephemeral one) and
+	       starts accepting on the context.
+
+	       returns:
+	       - COMMC_SUCCESS if listening
+	       - COMMC_ERROR_INVALID_STATE if already listening
+	       - COMMC_IO_ERROR if the address does not resolve
+	         or the socket cannot be bound
+	       - COMMC_SYSTEM_ERROR if the accept cannot be
+	         submitted
+
+*/
+
+commc_error_t commc_http_server_listen(commc_http_server_t* server,
+                                       const char*          host,
+                                       int                  port);
+
+/*
+
+         commc_http_server_get_port()
+	       ---
+	       returns the port the listener is bound to, or 0.
+
+*/
+
+int commc_http_server_get_port(const commc_http_server_t* server);
+
+/*
+
+         commc_http_server_adopt()
+	       ---
+	       serves a connection accepted elsewhere (for
+	       example by a commc_reactor_t listener). the server
+	       owns and closes the handle, also when adopting
+	       fails.
+
+*/
+
+commc_error_t commc_http_server_adopt(commc_http_server_t* server,
+                                      int                  handle);
+
+/*
+
+         commc_http_server_get_connection_count()
+	       ---
+	       returns the number of open connections.
+
+*/
+
+size_t commc_http_server_get_connection_count(const commc_http_server_t* server);
+
+/*
+	==================================
+             --- ROUTES ---
+	==================================
+*/
+
+/*
+
+         commc_http_server_route()
+	       ---
+	       adds a handler for method (NULL for any) and
+	       pattern: an exact path, or a prefix when it ends
+	       with '*'. routes are tried in the order added.
+
+*/
+
+commc_error_t commc_http_server_route(commc_http_server_t*        server,
+                                      const char*                 method,
+                                      const char*                 pattern,
+                                      commc_http_server_handler_t handler,
+                                      void*                       user_data);
+
+/*
+
+         commc_http_server_serve_directory()
+	       ---
+	       serves GET and HEAD requests under prefix from
+	       files in directory, with sendfile. a path ending
+	       in '/' serves its index.html; ".." segments are
+	       refused.
+
+*/
+
+commc_error_t commc_http_server_serve_directory(commc_http_server_t* server,
+                                                const char*          prefix,
+                                                const char*          directory);
+
+/*
+	==================================
+            --- RESPONSES ---
+	==================================
+*/
+
+/*
+
+         commc_http_server_add_header()
+	       ---
+	       adds a header field to the response about to be
+	       sent. call before responding.
+
+*/
+
+commc_error_t commc_http_server_add_header(commc_http_server_request_t* request,
+                                           const char*                  name,
+                                           const char*                  value);
+
+/*
+
+         commc_http_server_respond()
+	       ---
+	       queues the response with a copy of body (omitted
+	       for HEAD requests). content_type may be NULL.
+	       the body goes out gzipped when compress_threshold
+	       allows it and the client accepts gzip.
+
+	       returns:
+	       - COMMC_SUCCESS if queued
+	       - COMMC_ERROR_INVALID_STATE if the request was
+	         already answered
+	       - COMMC_MEMORY_ERROR if the output buffer cannot
+	         grow
+
+*/
+
+commc_error_t commc_http_server_respond(commc_http_server_request_t* request,
+                                        int                          status,
+                                        const char*                  content_type,
+                                        const void*                  body,
+                                        size_t                       length);
+
+/*
+
+         commc_http_server_respond_file()
+	       ---
+	       queues a response whose body is the regular file
+	       at path, sent with sendfile. content_type NULL
+	       guesses it from the extension.
+
+	       returns:
+	       - COMMC_SUCCESS if queued
+	       - COMMC_IO_ERROR if path is not a readable regular
+	         file (nothing is queued; respond otherwise)
+	       - errors as for commc_http_server_respond()
+
+*/
+
+commc_error_t commc_http_server_respond_file(commc_http_server_request_t* request,
+                                             int                          status,
+                                             const char*                  content_type,
+                                             const char*                  path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMMC_HTTPSERVER_H */
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
@@ -18,12 +18,15 @@
     key features:
     - non-blocking enqueue/dequeue operations
     - ABA problem prevention through tagged pointers
-    - memory-safe reclamation using hazard pointers
+    - memory-safe reclamation using hazard pointers, or epoch-
+      based reclamation (EBR/QSBR) chosen at creation time
     - linearizable operations with progress guarantees
     - scalable performance under contention
     
-    this implementation is designed for C89 compatibility by providing
-    platform-specific atomic operation abstractions.
+    this implementation is designed for C89 compatibility by using
+    the platform-specific atomic operation abstractions in
+    commc/atomic.h, with explicit acquire/release ordering on
+    the hot paths.
 
 */
 
@@ -36,6 +39,8 @@
 	==================================
 */
 
+#include "commc/atomic.h"   /* COMMC_ATOMIC_* PLATFORM ABSTRACTION */
+#include "commc/epoch.h"    /* EPOCH-BASED RECLAMATION */
 #include "commc/error.h"
 #include <stddef.h>
 
@@ -45,76 +50,37 @@ extern "C" {
 
 /*
 	==================================
-             --- PLATFORM ATOMIC ABSTRACTION ---
+             --- DATA STRUCTURES ---
 	==================================
 */
 
 /*
 
-    atomic operation macros for C89 compatibility.
-    these provide a uniform interface across different
-    compilers and platforms for atomic pointer operations.
+    memory reclamation scheme. hazard pointers bound retired
+    memory even when a thread stalls, but cost a fenced
+    publication per protected node and cap the thread count at
+    max_threads. EBR costs one fence per operation and QSBR
+    none; both accept any number of threads, but a stalled
+    thread delays reclamation. QSBR threads that stop using the
+    queue for a while should call commc_lf_queue_thread_offline().
 
 */
 
-/* detect compiler and platform for atomic operations */
+typedef enum {
 
-#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+  COMMC_LF_QUEUE_RECLAIM_HAZARD = 0,   /* per-node hazard pointers */
+  COMMC_LF_QUEUE_RECLAIM_EBR    = 1,   /* epoch-based, enter/exit per operation */
+  COMMC_LF_QUEUE_RECLAIM_QSBR   = 2    /* quiescent state after each operation */
 
-  /* GCC built-in atomics (GCC 4.1+) */
-  
-  #define COMMC_ATOMIC_LOAD(ptr)           __sync_add_and_fetch((ptr), 0)
-  #define COMMC_ATOMIC_STORE(ptr, val)     __sync_lock_test_and_set((ptr), (val))
-  #define COMMC_ATOMIC_CAS(ptr, old, new)  __sync_bool_compare_and_swap((ptr), (old), (new))
-  #define COMMC_ATOMIC_INC(ptr)            __sync_add_and_fetch((ptr), 1)
-  #define COMMC_ATOMIC_DEC(ptr)            __sync_sub_and_fetch((ptr), 1)
-  #define COMMC_MEMORY_BARRIER()           __sync_synchronize()
-  
-  #define COMMC_HAS_ATOMICS 1
-  
-#elif defined(_MSC_VER) && (_MSC_VER >= 1300)
+} commc_lf_queue_reclaim_t;
 
-  /* Microsoft Visual C++ intrinsics */
-  
-  #include <intrin.h>
-  
-  #define COMMC_ATOMIC_LOAD(ptr)           (*(volatile long*)(ptr))
-  #define COMMC_ATOMIC_STORE(ptr, val)     _InterlockedExchange((volatile long*)(ptr), (long)(val))
-  #define COMMC_ATOMIC_CAS(ptr, old, new)  (_InterlockedCompareExchange((volatile long*)(ptr), (long)(new), (long)(old)) == (long)(old))
-  #define COMMC_ATOMIC_INC(ptr)            _InterlockedIncrement((volatile long*)(ptr))
-  #define COMMC_ATOMIC_DEC(ptr)            _InterlockedDecrement((volatile long*)(ptr))
-  #define COMMC_MEMORY_BARRIER()           _ReadWriteBarrier()
-  
-  #define COMMC_HAS_ATOMICS 1
-  
-#else
+/* scheme used by commc_lf_queue_create(); override at build time
+   with -DCOMMC_LF_QUEUE_DEFAULT_RECLAIM=COMMC_LF_QUEUE_RECLAIM_EBR */
 
-  /* fallback: use volatile and hope for the best */
-  /* note: this is not truly atomic and should not be used in production */
-  
-  #define COMMC_ATOMIC_LOAD(ptr)           (*(volatile void**)(ptr))
-  #define COMMC_ATOMIC_STORE(ptr, val)     (*(volatile void**)(ptr) = (val))
-  #define COMMC_ATOMIC_CAS(ptr, old, new) ((*(volatile void**)(ptr) == (old)) ? (*(volatile void**)(ptr) = (new), 1) : 0)
-  #define COMMC_ATOMIC_INC(ptr)            (++(*(volatile long*)(ptr)))
-  #define COMMC_ATOMIC_DEC(ptr)            (--(*(volatile long*)(ptr)))
-  #define COMMC_MEMORY_BARRIER()           /* no-op */
-  
-  #define COMMC_HAS_ATOMICS 0
-  
-  #ifdef __STDC_VERSION__
-    #if __STDC_VERSION__ >= 201112L
-      #warning "Lock-free queue fallback: using volatile operations (not truly atomic)"
-    #endif
-  #endif
-  
+#ifndef COMMC_LF_QUEUE_DEFAULT_RECLAIM
+#define COMMC_LF_QUEUE_DEFAULT_RECLAIM  COMMC_LF_QUEUE_RECLAIM_HAZARD
 #endif
 
-/*
-	==================================
-             --- DATA STRUCTURES ---
-	==================================
-*/
-
 /*
 
     tagged pointer structure to prevent ABA problems.
@@ -142,7 +108,9 @@ typedef struct commc_lf_queue_node {
 
   void*                           data;           /* stored element data */
   commc_lf_queue_tagged_ptr_t     next;           /* atomic next pointer with tag */
-  volatile unsigned long          ref_count;      /* reference count for safe reclamation */
+  volatile unsigned long          ref_count;      /* external pin count; reclamation itself relies on hazards */
+  struct commc_lf_queue_node*     retired_next;   /* retired list link (never aliases next) */
+  commc_epoch_entry_t             epoch_entry;    /* retire link in epoch modes */
   
 } commc_lf_queue_node_t;
 
@@ -206,6 +174,11 @@ typedef struct {
   commc_lf_queue_node_t*           retired_nodes; /* nodes pending cleanup */
   volatile unsigned long           retired_count; /* number of retired nodes */
   
+  /* epoch reclamation (unused in hazard mode) */
+  
+  commc_lf_queue_reclaim_t         reclaim;       /* reclamation scheme */
+  commc_epoch_domain_t*            epoch;         /* epoch domain */
+  
 } commc_lf_queue_t;
 
 /*
@@ -228,6 +201,44 @@ typedef struct {
 
 commc_lf_queue_t* commc_lf_queue_create(unsigned long max_threads);
 
+/*
+
+         commc_lf_queue_create_with_reclaim()
+	       ---
+	       creates a new lock-free queue using the given memory
+	       reclamation scheme. max_threads only applies to
+	       COMMC_LF_QUEUE_RECLAIM_HAZARD; the epoch schemes accept
+	       any number of threads and ignore it.
+
+*/
+
+commc_lf_queue_t* commc_lf_queue_create_with_reclaim(unsigned long max_threads,
+                                                     commc_lf_queue_reclaim_t reclaim);
+
+/*
+
+         commc_lf_queue_get_reclaim()
+	       ---
+	       returns the reclamation scheme of the queue.
+
+*/
+
+commc_lf_queue_reclaim_t commc_lf_queue_get_reclaim(const commc_lf_queue_t* queue);
+
+/*
+
+         commc_lf_queue_thread_offline()
+	       ---
+	       tells a QSBR queue that the calling thread will not
+	       touch it for a while, so it no longer holds back
+	       reclamation. the next operation brings the thread
+	       back online. no-op for the other schemes; exiting
+	       threads are taken offline automatically.
+
+*/
+
+void commc_lf_queue_thread_offline(commc_lf_queue_t* queue);
+
 /*
 
          commc_lf_queue_destroy()
@@ -269,6 +280,43 @@ commc_error_t commc_lf_queue_enqueue(commc_lf_queue_t* queue, void* data);
 
 commc_error_t commc_lf_queue_dequeue(commc_lf_queue_t* queue, void** data);
 
+/*
+
+         commc_lf_queue_enqueue_batch()
+	       ---
+	       adds count elements to the tail of the queue in order.
+	       
+	       the nodes are allocated and linked into a private chain
+	       first, then the whole chain is published with a single
+	       CAS on the last node's next pointer, so a batch costs one
+	       hazard acquisition and one contended CAS instead of one
+	       per element. the batch appears contiguously in the queue.
+	       returns COMMC_MEMORY_ERROR without enqueuing anything if
+	       the chain cannot be allocated.
+
+*/
+
+commc_error_t commc_lf_queue_enqueue_batch(commc_lf_queue_t* queue, 
+                                           void** items, size_t count);
+
+/*
+
+         commc_lf_queue_dequeue_batch()
+	       ---
+	       removes up to max_items elements from the head of the
+	       queue, storing them in items and their number in
+	       dequeued.
+	       
+	       the available prefix is claimed with a single CAS on the
+	       head, walking the chain under one re-pointed hazard.
+	       returns COMMC_SUCCESS if at least one element was removed,
+	       COMMC_FAILURE if the queue is empty.
+
+*/
+
+commc_error_t commc_lf_queue_dequeue_batch(commc_lf_queue_t* queue, void** items,
+                                           size_t max_items, size_t* dequeued);
+
 /*
 
          commc_lf_queue_is_empty()
@@ -338,6 +386,8 @@ void commc_lf_queue_release_hazard(commc_lf_queue_hazard_t* hazard);
 	       
 	       this function is used internally during dequeue operations
 	       to safely reclaim memory in the presence of concurrent access.
+	       in the epoch schemes the node is handed to the queue's
+	       epoch domain instead.
 
 */
 
@@ -351,7 +401,9 @@ void commc_lf_queue_retire_node(commc_lf_queue_t* queue, commc_lf_queue_node_t*
 	       no longer referenced by any hazard pointers.
 	       
 	       this is called periodically during queue operations
-	       to prevent unbounded memory usage.
+	       to prevent unbounded memory usage. in the epoch schemes
+	       it tries to advance the epoch and frees the calling
+	       thread's expired nodes.
 
 */
 
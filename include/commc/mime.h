@@ -0,0 +1,350 @@
+/*
+   ===================================
+   M I M E . H
+   STREAMING MIME MESSAGE PARSER HEADER
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    one-pass parser for RFC 5322 messages with MIME
+	    (RFC 2045, 2046) bodies, nested multiparts and
+	    message/rfc822 parts included. the message goes in
+	    through write() in pieces of any size, or whole
+	    from a buffer or a mapped file, and comes out as a
+	    stream of events: a part begins, each of its header
+	    fields, its body begins, its decoded body data, it
+	    ends.
+
+	    nothing the size of a part is ever held. header
+	    fields are unfolded one at a time into a bounded
+	    buffer; base64 and quoted-printable bodies are
+	    decoded on the fly through a 4 KB output buffer;
+	    other bodies are handed on as views into the
+	    caller's input, unchanged. every header field and
+	    part also reports its (offset, length) span in the
+	    input, so with a mapped file a part's raw bytes are
+	    at hand without the parser copying them.
+
+	    a parser takes about 20 KB, allocated once when it
+	    is created, and keeps it across messages.
+
+*/
+
+#ifndef COMMC_MIME_H
+#define COMMC_MIME_H
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#include <stddef.h>
+
+#include "error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	==================================
+           --- CONSTANTS ---
+	==================================
+*/
+
+#define COMMC_MIME_MAX_DEPTH       16       /* NESTED PARTS, THE MESSAGE INCLUDED */
+#define COMMC_MIME_MAX_FIELD       8192     /* LONGEST HEADER FIELD, UNFOLDED */
+#define COMMC_MIME_MAX_BOUNDARY    70       /* RFC 2046 BOUNDARY LIMIT */
+#define COMMC_MIME_MAX_TYPE        128      /* LONGEST TYPE/SUBTYPE KEPT */
+#define COMMC_MIME_MAX_CHARSET     64       /* LONGEST CHARSET KEPT */
+#define COMMC_MIME_MAX_FILENAME    256      /* LONGEST FILENAME KEPT */
+#define COMMC_MIME_OUTPUT_SIZE     4096     /* DECODED BYTES PER BODY_DATA EVENT */
+#define COMMC_MIME_READ_SIZE       65536    /* READS OF A FILE THAT CANNOT BE MAPPED */
+
+/*
+	==================================
+             --- ENUMS ---
+	==================================
+*/
+
+/*
+
+         commc_mime_encoding_t
+	       ---
+	       a part's Content-Transfer-Encoding. only
+	       BASE64 and QUOTED_PRINTABLE are decoded; the
+	       others, unknown ones included, pass through.
+
+*/
+
+typedef enum {
+
+    COMMC_MIME_ENCODING_7BIT,                /* DEFAULT */
+    COMMC_MIME_ENCODING_8BIT,
+    COMMC_MIME_ENCODING_BINARY,
+    COMMC_MIME_ENCODING_BASE64,
+    COMMC_MIME_ENCODING_QUOTED_PRINTABLE,
+    COMMC_MIME_ENCODING_UNKNOWN              /* PASSED THROUGH AS IT IS */
+
+} commc_mime_encoding_t;
+
+/*
+
+         commc_mime_event_type_t
+	       ---
+	       what an event reports. for every part, in
+	       order: PART_BEGIN, a HEADER per field,
+	       BODY_BEGIN, then either BODY_DATA for a leaf
+	       part or the PART_BEGIN to PART_END events of
+	       its children for a multipart or message/rfc822
+	       one, and PART_END.
+
+*/
+
+typedef enum {
+
+    COMMC_MIME_EVENT_PART_BEGIN,     /* HEADERS START; OFFSET IS WHERE */
+    COMMC_MIME_EVENT_HEADER,         /* ONE FIELD; SPAN OF THE RAW FIELD */
+    COMMC_MIME_EVENT_BODY_BEGIN,     /* HEADERS DONE, PART DESCRIBED; OFFSET OF THE BODY */
+    COMMC_MIME_EVENT_BODY_DATA,      /* DECODED BODY BYTES OF A LEAF PART */
+    COMMC_MIME_EVENT_PART_END        /* SPAN OF THE WHOLE PART */
+
+} commc_mime_event_type_t;
+
+/*
+	==================================
+           --- STRUCTURES ---
+	==================================
+*/
+
+/*
+
+         commc_mime_part_t
+	       ---
+	       one part as known so far: the message itself at
+	       depth 0, its parts below. the Content-* fields
+	       are filled in as their headers arrive, so they
+	       are complete from BODY_BEGIN on. values longer
+	       than their field are cut short, except the
+	       boundary: a part whose boundary does not fit is
+	       not split.
+
+*/
+
+typedef struct {
+
+    int                   depth;                     /* 0 FOR THE MESSAGE */
+    size_t                index;                     /* PARTS BEGUN BEFORE THIS ONE */
+    size_t                offset;                    /* WHERE ITS HEADERS START */
+    size_t                body_offset;               /* WHERE ITS BODY STARTS */
+    size_t                body_length;               /* RAW BODY BYTES, SET AT PART_END */
+    size_t                decoded_length;            /* BODY_DATA BYTES SO FAR */
+
+    char                  content_type[COMMC_MIME_MAX_TYPE];       /* LOWERCASE TYPE/SUBTYPE */
+    char                  charset[COMMC_MIME_MAX_CHARSET];
+    char                  boundary[COMMC_MIME_MAX_BOUNDARY + 1];   /* MULTIPART ONLY */
+    char                  filename[COMMC_MIME_MAX_FILENAME];       /* DISPOSITION FILENAME OR TYPE NAME */
+    commc_mime_encoding_t encoding;
+    int                   is_multipart;              /* ITS BODY IS SPLIT INTO PARTS */
+    int                   is_attachment;             /* CONTENT-DISPOSITION: ATTACHMENT */
+
+} commc_mime_part_t;
+
+/*
+
+         commc_mime_event_t
+	       ---
+	       one event. every pointer is only valid during
+	       the callback. offset and length are positions
+	       in the whole input (counted over all writes):
+	       for HEADER the raw field, folds and line end
+	       included; for BODY_DATA of a part that is not
+	       decoded the bytes in data (decoded data has no
+	       span of its own, length 0); for PART_END the
+	       part from its first header to the end of its
+	       body.
+
+*/
+
+typedef struct {
+
+    commc_mime_event_type_t  type;
+    const commc_mime_part_t* part;           /* THE PART IT CONCERNS */
+
+    const char*              name;           /* HEADER: FIELD NAME */
+    size_t                   name_length;
+    const char*              value;          /* HEADER: UNFOLDED, TRIMMED VALUE */
+    size_t                   value_length;
+
+    const char*              data;           /* BODY_DATA: DECODED BYTES */
+    size_t                   data_length;
+
+    size_t                   offset;         /* SPAN IN THE INPUT */
+    size_t                   length;
+
+} commc_mime_event_t;
+
+/*
+
+         commc_mime_callback_t
+	       ---
+	       receives the events. returning anything but
+	       COMMC_SUCCESS stops the parser with that error.
+
+*/
+
+typedef commc_error_t (*commc_mime_callback_t)(const commc_mime_event_t* event,
+                                               void*                     user_data);
+
+/*
+
+         commc_mime_parser_t
+	       ---
+	       opaque parser state.
+
+*/
+
+typedef struct commc_mime_parser_t commc_mime_parser_t;
+
+/*
+	==================================
+             --- CORE ---
+	==================================
+*/
+
+/*
+
+         commc_mime_parser_create()
+	       ---
+	       creates a parser handing its events to
+	       callback.
+
+*/
+
+commc_error_t commc_mime_parser_create(commc_mime_parser_t** parser,
+                                       commc_mime_callback_t callback,
+                                       void*                 user_data);
+
+/*
+
+         commc_mime_parser_destroy()
+	       ---
+	       frees a parser.
+
+*/
+
+void commc_mime_parser_destroy(commc_mime_parser_t* parser);
+
+/*
+
+         commc_mime_parser_reset()
+	       ---
+	       readies a parser for a new message, keeping its
+	       callback.
+
+*/
+
+void commc_mime_parser_reset(commc_mime_parser_t* parser);
+
+/*
+
+         commc_mime_parser_write()
+	       ---
+	       parses the next length bytes of the message.
+	       the events they complete are delivered before
+	       it returns, decoded data included.
+
+	       returns:
+	       - COMMC_SUCCESS if the bytes were consumed
+	       - COMMC_ERROR_BUFFER_TOO_SMALL for a header
+	         field longer than COMMC_MIME_MAX_FIELD
+	       - COMMC_ERROR_INVALID_STATE after finish()
+	       - the callback's error
+	       the parser stays failed until reset.
+
+*/
+
+commc_error_t commc_mime_parser_write(commc_mime_parser_t* parser,
+                                      const void*          data,
+                                      size_t               length);
+
+/*
+
+         commc_mime_parser_finish()
+	       ---
+	       ends the message: a last line without a line
+	       end is parsed, and every part still open ends
+	       there. multiparts missing their closing
+	       delimiter are not an error.
+
+*/
+
+commc_error_t commc_mime_parser_finish(commc_mime_parser_t* parser);
+
+/*
+
+         commc_mime_parser_skip_body()
+	       ---
+	       called from the callback (on BODY_BEGIN or
+	       during the body), stops decoding and reporting
+	       the current part's body. the parser still scans
+	       it for the boundary that ends it.
+
+*/
+
+void commc_mime_parser_skip_body(commc_mime_parser_t* parser);
+
+/*
+	==================================
+           --- WHOLE INPUT ---
+	==================================
+*/
+
+/*
+
+         commc_mime_parser_parse()
+	       ---
+	       resets the parser and parses a message held
+	       whole in memory, a mapped file for instance, in
+	       one write. spans are then offsets into data.
+
+*/
+
+commc_error_t commc_mime_parser_parse(commc_mime_parser_t* parser,
+                                      const void*          data,
+                                      size_t               length);
+
+/*
+
+         commc_mime_parser_parse_file()
+	       ---
+	       resets the parser and parses the message in the
+	       file at path, mapped read-only where the system
+	       allows it, otherwise read COMMC_MIME_READ_SIZE
+	       bytes at a time.
+
+	       returns:
+	       - COMMC_IO_ERROR if the file cannot be read
+	       - as for commc_mime_parser_write() otherwise
+
+*/
+
+commc_error_t commc_mime_parser_parse_file(commc_mime_parser_t* parser,
+                                           const char*          path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMMC_MIME_H */
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
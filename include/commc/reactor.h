@@ -0,0 +1,350 @@
+/*
+   ===================================
+   C O M M O N - C
+   MULTI-REACTOR MODULE
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+            --- MULTI-REACTOR MODULE ---
+
+    runs one commc_async_context_t event loop per thread so a
+    server scales past the single core commc_async_run() can
+    use. every loop owns its context exclusively: handles,
+    operations and timers created on a loop stay there and
+    need no locking.
+
+    - threads can be pinned, loop i to the i-th CPU the
+      process may run on, which keeps a connection's cache
+      lines and the kernel's socket state on one core.
+    - commc_reactor_listen() opens one listening socket per
+      loop on the same address with SO_REUSEPORT, so the
+      kernel spreads incoming connections across loops with
+      no shared accept queue. where SO_REUSEPORT does not
+      balance load, all loops accept from a single socket.
+    - work moves between loops with commc_reactor_post(),
+      which uses the lock-free post stack and wakeup of the
+      target context (see commc_async_post()).
+
+    threads are POSIX threads on unix and Win32 threads on
+    windows. CPU pinning is implemented on Linux and windows
+    and ignored elsewhere.
+
+*/
+
+#ifndef COMMC_REACTOR_H
+#define COMMC_REACTOR_H
+
+/*
+	==================================
+             --- INCLUDES ---
+	==================================
+*/
+
+#include "commc/async.h"
+#include "commc/error.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	==================================
+             --- CONSTANTS ---
+	==================================
+*/
+
+#define COMMC_REACTOR_MAX_LOOPS           256   /* UPPER BOUND ON LOOP COUNT */
+#define COMMC_REACTOR_DEFAULT_BACKLOG     1024  /* LISTEN BACKLOG WHEN 0 IS GIVEN */
+#define COMMC_REACTOR_ACCEPT_BACKOFF_MS   100   /* RETRY DELAY WHEN OUT OF DESCRIPTORS */
+
+/*
+	==================================
+             --- TYPES ---
+	==================================
+*/
+
+/*
+
+         commc_reactor_t
+	       ---
+	       opaque multi-reactor structure.
+
+*/
+
+typedef struct commc_reactor_t commc_reactor_t;
+
+/*
+
+         commc_reactor_loop_fn
+	       ---
+	       per-loop hook, called on the loop's own thread
+	       with its index and context.
+
+*/
+
+typedef void (*commc_reactor_loop_fn)(commc_reactor_t* reactor,
+                                      size_t index,
+                                      commc_async_context_t* ctx,
+                                      void* user_data);
+
+/*
+
+         commc_reactor_accept_fn
+	       ---
+	       called on the accepting loop's thread with a new
+	       non-blocking connection, which the callee owns.
+
+*/
+
+typedef void (*commc_reactor_accept_fn)(commc_reactor_t* reactor,
+                                        size_t index,
+                                        commc_async_context_t* ctx,
+                                        int handle,
+                                        void* user_data);
+
+/*
+
+         commc_reactor_config_t
+	       ---
+	       creation parameters. fill with
+	       commc_reactor_config_init() and override fields.
+
+*/
+
+typedef struct {
+
+  size_t                 loop_count;   /* 0: ONE PER USABLE CPU */
+  int                    pin_threads;  /* PIN LOOP I TO THE I-TH USABLE CPU */
+  int                    max_events;   /* EVENTS PER POLL, 0 FOR DEFAULT */
+  commc_async_backend_t  backend;      /* BACKEND OF EVERY CONTEXT */
+  commc_reactor_loop_fn  on_start;     /* BEFORE A LOOP STARTS (MAY BE NULL) */
+  commc_reactor_loop_fn  on_stop;      /* AFTER A LOOP ENDS (MAY BE NULL) */
+  void*                  user_data;    /* PASSED TO ON_START/ON_STOP */
+
+} commc_reactor_config_t;
+
+/*
+	==================================
+             --- CORE API ---
+	==================================
+*/
+
+/*
+
+         commc_reactor_config_init()
+	       ---
+	       fills config with defaults: one pinned loop per
+	       usable CPU on the default backend, no hooks.
+
+*/
+
+void commc_reactor_config_init(commc_reactor_config_t* config);
+
+/*
+
+         commc_reactor_create()
+	       ---
+	       creates the contexts of every loop. no thread runs
+	       until commc_reactor_start(). config NULL uses the
+	       defaults.
+
+	       returns:
+	       - pointer to new reactor, or NULL on error
+
+*/
+
+commc_reactor_t* commc_reactor_create(const commc_reactor_config_t* config);
+
+/*
+
+         commc_reactor_destroy()
+	       ---
+	       stops and joins the loops, then destroys their
+	       contexts (pending operations are dropped without
+	       callbacks) and closes the listening sockets. must
+	       not be called from a loop thread.
+
+*/
+
+void commc_reactor_destroy(commc_reactor_t* reactor);
+
+/*
+
+         commc_reactor_start()
+	       ---
+	       starts one thread per loop. each runs on_start,
+	       commc_async_run() on its context, then on_stop.
+
+	       returns:
+	       - COMMC_SUCCESS if every thread started
+	       - COMMC_ARGUMENT_ERROR for invalid parameters
+	       - COMMC_ERROR_INVALID_STATE if already started
+	         or stopped
+	       - COMMC_SYSTEM_ERROR if a thread could not be
+	         created (the others are stopped and joined)
+
+*/
+
+commc_error_t commc_reactor_start(commc_reactor_t* reactor);
+
+/*
+
+         commc_reactor_stop()
+	       ---
+	       asks every loop to return from its run once the
+	       current iteration is done. safe to call from any
+	       thread, including loop threads, and more than once.
+
+*/
+
+void commc_reactor_stop(commc_reactor_t* reactor);
+
+/*
+
+         commc_reactor_join()
+	       ---
+	       waits for every loop thread to exit. must not be
+	       called from a loop thread.
+
+*/
+
+void commc_reactor_join(commc_reactor_t* reactor);
+
+/*
+
+         commc_reactor_loop_count()
+	       ---
+	       returns the number of loops.
+
+*/
+
+size_t commc_reactor_loop_count(const commc_reactor_t* reactor);
+
+/*
+
+         commc_reactor_context()
+	       ---
+	       returns the context of loop index, or NULL. once
+	       the loops run, a context may only be used from its
+	       own thread, except for posting and stopping.
+
+*/
+
+commc_async_context_t* commc_reactor_context(const commc_reactor_t* reactor,
+                                             size_t index);
+
+/*
+
+         commc_reactor_current_loop()
+	       ---
+	       returns the index of the calling loop thread, or -1
+	       if the caller is not one of this reactor's loops.
+
+*/
+
+int commc_reactor_current_loop(const commc_reactor_t* reactor);
+
+/*
+	==================================
+             --- CROSS-LOOP API ---
+	==================================
+*/
+
+/*
+
+         commc_reactor_post()
+	       ---
+	       runs fn(arg) on loop index. safe to call from any
+	       thread; tasks from one poster run in order.
+
+	       returns:
+	       - COMMC_SUCCESS if queued
+	       - COMMC_ARGUMENT_ERROR for invalid parameters
+	       - COMMC_MEMORY_ERROR if the task could not be
+	         allocated
+
+*/
+
+commc_error_t commc_reactor_post(commc_reactor_t* reactor,
+                                 size_t index,
+                                 commc_async_task_fn fn,
+                                 void* arg);
+
+/*
+
+         commc_reactor_post_task()
+	       ---
+	       posts an embedded task to loop index without
+	       allocating. see commc_async_post_task() for the
+	       lifetime rules.
+
+	       returns:
+	       - COMMC_SUCCESS if queued
+	       - COMMC_ARGUMENT_ERROR for invalid parameters
+
+*/
+
+commc_error_t commc_reactor_post_task(commc_reactor_t* reactor,
+                                      size_t index,
+                                      commc_async_task_t* task);
+
+/*
+	==================================
+             --- LISTENER API ---
+	==================================
+*/
+
+/*
+
+         commc_reactor_listen()
+	       ---
+	       binds a TCP listener per loop to address (a
+	       struct sockaddr of address_size bytes) and keeps an
+	       accept pending on each, calling on_accept for every
+	       connection. a port of 0 binds the first socket to
+	       an ephemeral port and the rest to the same one.
+	       accepting starts with the loops; may be called
+	       before or after commc_reactor_start(), but not
+	       concurrently with itself or destroy.
+
+	       parameters:
+	       - reactor: multi-reactor
+	       - address, address_size: local address
+	       - backlog: listen backlog (0 for the default)
+	       - on_accept: connection callback
+	       - user_data: passed to on_accept
+	       - handle: optional output, the first listening
+	         socket (e.g. for getsockname())
+
+	       returns:
+	       - COMMC_SUCCESS if listening
+	       - COMMC_ARGUMENT_ERROR for invalid parameters
+	       - COMMC_MEMORY_ERROR on allocation failure
+	       - COMMC_IO_ERROR if a socket could not be
+	         created, bound or put into listening state
+
+*/
+
+commc_error_t commc_reactor_listen(commc_reactor_t* reactor,
+                                   const void* address,
+                                   size_t address_size,
+                                   int backlog,
+                                   commc_reactor_accept_fn on_accept,
+                                   void* user_data,
+                                   int* handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMMC_REACTOR_H */
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
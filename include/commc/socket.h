@@ -31,6 +31,7 @@
 */
 
 #include "error.h"
+#include "async.h"
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -59,6 +60,8 @@ extern "C" {
 #define COMMC_SOCKET_MAX_BACKLOG           128
 #define COMMC_SOCKET_BUFFER_SIZE          8192
 #define COMMC_SOCKET_DEFAULT_TIMEOUT        30
+#define COMMC_SOCKET_MAX_IOVEC              64
+#define COMMC_SOCKET_MAX_BATCH              64
 
 #ifdef _WIN32
 #define COMMC_INVALID_SOCKET (-1)
@@ -147,7 +150,10 @@ typedef struct {
          commc_socket_options_t
 	       ---
 	       structure containing socket configuration
-	       options and behavioral settings.
+	       options and behavioral settings. flags are
+	       applied when set and cleared again when reset;
+	       options the platform lacks are skipped and read
+	       back as 0 by commc_socket_get_options().
 
 */
 
@@ -158,8 +164,15 @@ typedef struct {
     int  broadcast;           /* SO_BROADCAST option */
     int  receive_timeout;     /* Receive timeout in seconds */
     int  send_timeout;        /* Send timeout in seconds */
-    int  receive_buffer_size; /* SO_RCVBUF size */
-    int  send_buffer_size;    /* SO_SNDBUF size */
+    int  receive_buffer_size; /* SO_RCVBUF size, 0 for the system default */
+    int  send_buffer_size;    /* SO_SNDBUF size, 0 for the system default */
+    int  cork;                /* TCP_CORK (Linux) / TCP_NOPUSH (BSD): hold partial frames */
+    int  quick_ack;           /* TCP_QUICKACK (Linux), cleared by the kernel as it sees fit */
+    int  busy_poll;           /* SO_BUSY_POLL microseconds (Linux) */
+    int  fast_open;           /* TCP_FASTOPEN queue length for a listener */
+    int  fast_open_connect;   /* TCP_FASTOPEN_CONNECT: data in the SYN (Linux) */
+    int  reuse_port;          /* SO_REUSEPORT, set before bind */
+    int  zero_copy;           /* SO_ZEROCOPY for commc_socket_send_zerocopy() (Linux) */
 } commc_socket_options_t;
 
 /*
@@ -180,8 +193,45 @@ typedef struct {
     commc_socket_address_t     remote_addr;  /* Remote address info */
     commc_socket_options_t     options;      /* Socket options */
     int                        last_error;   /* Last error code */
+    unsigned long              zerocopy_sent;      /* Zero-copy sends issued */
+    unsigned long              zerocopy_completed; /* Zero-copy sends the kernel let go of */
 } commc_socket_t;
 
+/*
+
+         commc_socket_iovec_t
+	       ---
+	       one piece of a scattered buffer for the
+	       vectored and batched transfer functions.
+
+*/
+
+typedef struct {
+    void*  base;                  /* Start of the piece */
+    size_t length;                /* Bytes in the piece */
+} commc_socket_iovec_t;
+
+/*
+
+         commc_socket_message_t
+	       ---
+	       one datagram of a batched send or receive.
+	       address is a system sockaddr (NULL sends to the
+	       connected peer or skips the sender's address);
+	       address_length is its size going in and the
+	       sender's address length coming out of a receive.
+
+*/
+
+typedef struct {
+    commc_socket_iovec_t* iov;            /* Datagram pieces */
+    int                   iov_count;      /* At most COMMC_SOCKET_MAX_IOVEC */
+    void*                 address;        /* struct sockaddr or NULL */
+    size_t                address_length; /* Size of *address */
+    size_t                transferred;    /* Bytes sent or received */
+    int                   truncated;      /* Received datagram did not fit */
+} commc_socket_message_t;
+
 /*
 
          commc_socket_server_t
@@ -271,7 +321,10 @@ commc_error_t commc_socket_set_options(commc_socket_t*              socket,
 
          commc_socket_get_options()
 	       ---
-	       retrieves current socket option settings.
+	       retrieves current socket option settings, as far
+	       as possible from the kernel. buffer sizes are what
+	       the kernel reports, which on Linux is double the
+	       size asked for.
 
 */
 
@@ -425,6 +478,42 @@ commc_error_t commc_socket_receive_all(commc_socket_t* socket,
                                        void*           buffer,
                                        size_t          expected_length);
 
+/*
+
+         commc_socket_send_zerocopy()
+	       ---
+	       sends with MSG_ZEROCOPY when the zero_copy option
+	       is on: the kernel pins data instead of copying it,
+	       so it must stay untouched until
+	       commc_socket_reap_zerocopy() reports *send_id
+	       complete. without zero-copy support it is a plain
+	       send that completes at once. worth it for sends
+	       of roughly 10 KB and more.
+
+*/
+
+commc_error_t commc_socket_send_zerocopy(commc_socket_t* socket,
+                                         const void*     data,
+                                         size_t          data_length,
+                                         size_t*         bytes_sent,
+                                         unsigned long*  send_id);
+
+/*
+
+         commc_socket_reap_zerocopy()
+	       ---
+	       collects zero-copy completions without blocking.
+	       every send with an id below *completed may have
+	       its buffer reused. *copied (if not NULL) is set
+	       when the kernel fell back to copying, as it does
+	       on loopback, where zero_copy only costs.
+
+*/
+
+commc_error_t commc_socket_reap_zerocopy(commc_socket_t* socket,
+                                         unsigned long*  completed,
+                                         int*            copied);
+
 /* 
 	==================================
          --- UDP OPERATIONS ---
@@ -461,6 +550,123 @@ commc_error_t commc_socket_receivefrom(commc_socket_t*         socket,
                                        commc_socket_address_t* src_address,
                                        size_t*                 bytes_received);
 
+/* 
+	==================================
+     --- VECTORED AND BATCHED I/O ---
+	==================================
+*/
+
+/*
+
+         commc_socket_sendv()
+	       ---
+	       gathers the pieces into one send (sendmsg, or
+	       WSASend on Windows), so a header and a payload
+	       leave in one syscall without being copied
+	       together. like commc_socket_send() the send may
+	       be partial; pieces past COMMC_SOCKET_MAX_IOVEC
+	       wait for the next call.
+
+*/
+
+commc_error_t commc_socket_sendv(commc_socket_t*             socket,
+                                 const commc_socket_iovec_t* iov,
+                                 int                         iov_count,
+                                 size_t*                     bytes_sent);
+
+/*
+
+         commc_socket_receivev()
+	       ---
+	       scatters one receive across the pieces, filling
+	       them in order.
+
+*/
+
+commc_error_t commc_socket_receivev(commc_socket_t*             socket,
+                                    const commc_socket_iovec_t* iov,
+                                    int                         iov_count,
+                                    size_t*                     bytes_received);
+
+/*
+
+         commc_socket_sendv_all()
+	       ---
+	       commc_socket_sendv() until every piece is sent,
+	       waiting on a non-blocking socket as
+	       commc_socket_send_all() does.
+
+*/
+
+commc_error_t commc_socket_sendv_all(commc_socket_t*             socket,
+                                     const commc_socket_iovec_t* iov,
+                                     int                         iov_count);
+
+/*
+
+         commc_socket_send_batch()
+	       ---
+	       sends up to COMMC_SOCKET_MAX_BATCH datagrams with
+	       one sendmmsg() where Linux has it, and a loop of
+	       sendmsg() calls elsewhere. *messages_sent tells how
+	       many left; an error after the first message ends
+	       the batch early but still returns COMMC_SUCCESS,
+	       as sendmmsg() does.
+
+*/
+
+commc_error_t commc_socket_send_batch(commc_socket_t*         socket,
+                                      commc_socket_message_t* messages,
+                                      int                     message_count,
+                                      int*                    messages_sent);
+
+/*
+
+         commc_socket_receive_batch()
+	       ---
+	       receives up to message_count datagrams with one
+	       recvmmsg() (or a loop): waits for the first like
+	       commc_socket_receive() and then only takes what
+	       is already queued.
+
+*/
+
+commc_error_t commc_socket_receive_batch(commc_socket_t*         socket,
+                                         commc_socket_message_t* messages,
+                                         int                     message_count,
+                                         int*                    messages_received);
+
+/* 
+	==================================
+          --- FILE TRANSFER ---
+	==================================
+*/
+
+/*
+
+         commc_socket_send_file()
+	       ---
+	       sends length bytes of file_handle, starting at
+	       offset, without copying them through user space:
+	       sendfile() on Linux, or splice() through a pipe
+	       when file_handle is a socket or a pipe (which are
+	       read from where they stand, ignoring offset), so
+	       one connection can be proxied into another.
+	       elsewhere the bytes go through a read/send loop.
+
+	       blocks until everything is sent, waiting on a
+	       non-blocking socket as commc_socket_send_all()
+	       does. *bytes_sent is less than length only if
+	       the source ended first, or on error.
+
+*/
+
+commc_error_t commc_socket_send_file(commc_socket_t* socket,
+                                     int             file_handle,
+                                     size_t          offset,
+                                     size_t          length,
+                                     size_t*         bytes_sent);
+
 /* 
 	==================================
         --- ADDRESS UTILITIES ---
@@ -494,6 +700,28 @@ commc_error_t commc_socket_address_resolve(const commc_socket_address_t* address
                                            char*                         resolved_ip,
                                            size_t                        ip_buffer_size);
 
+/*
+
+         commc_socket_address_resolve_async()
+	       ---
+	       runs commc_socket_address_resolve() on a helper
+	       thread of ctx so DNS lookups do not stall the
+	       event loop. callback runs on the loop thread with
+	       a COMMC_ASYNC_OP_WORK result whose buffer is
+	       resolved_ip and whose error_code is 0, ENOENT if
+	       the name did not resolve, or EAGAIN for a
+	       temporary resolver failure. address is copied;
+	       resolved_ip must stay valid until the callback.
+
+*/
+
+commc_error_t commc_socket_address_resolve_async(commc_async_context_t*        ctx,
+                                                 const commc_socket_address_t* address,
+                                                 char*                         resolved_ip,
+                                                 size_t                        ip_buffer_size,
+                                                 commc_async_callback_t        callback,
+                                                 void*                         user_data);
+
 /*
 
          commc_socket_get_local_address()
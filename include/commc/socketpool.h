@@ -1,4 +1,4 @@
-/* 	
+/*
    ===================================
    SOCKETPOOL.H
    SOCKET CONNECTION POOLING HEADER
@@ -10,13 +10,29 @@
 
 	                  --- ABOUT ---
 
-	    socket connection pooling system for efficient
-	    reuse and management of TCP/UDP socket resources.
-	    provides thread-safe pool creation, acquisition,
-	    release, and cleanup for high-performance networking.
-	       
-	    designed for educational clarity, C89 compliance,
-	    and cross-platform compatibility.
+	    connection pool keyed by destination. every
+	    (host, port, protocol) triple gets its own list of
+	    idle connections, its own limit and its own queue of
+	    callers waiting for a connection, all found through
+	    one hash lookup; acquire and release are O(1) apart
+	    from closing connections that went stale.
+
+	    an idle connection is closed once it has been idle
+	    longer than the pool's idle timeout, and every TCP
+	    connection is probed with a non-blocking MSG_PEEK
+	    before it is handed out: a peer that closed it (or
+	    sent data nobody asked for) makes it unusable, and
+	    the pool moves on to the next one or connects anew.
+
+	    when a destination is at its limit, blocking callers
+	    sleep in commc_socketpool_acquire() and async callers
+	    are queued by commc_socketpool_acquire_async(); a
+	    released connection (or the slot of a closed one) is
+	    handed straight to the longest waiter. the async
+	    variant connects on the context's helper threads and
+	    always calls back on the loop thread.
+
+	    the pool is thread-safe.
 
 */
 
@@ -28,78 +44,147 @@ extern "C" {
 #endif
 
 #include "commc/socket.h"
+#include "commc/async.h"
 #include "commc/error.h"
 
-#define COMMC_SOCKETPOOL_MAX_SOCKETS 128
+#define COMMC_SOCKETPOOL_DEFAULT_MAX_PER_HOST   8        /* CONNECTIONS PER DESTINATION */
+#define COMMC_SOCKETPOOL_DEFAULT_IDLE_TIMEOUT   60000UL  /* MS BEFORE AN IDLE CONNECTION IS CLOSED */
+#define COMMC_SOCKETPOOL_HOST_BUCKETS           64       /* DESTINATION HASH BUCKETS */
 
 /*
          commc_socketpool_t
 	       ---
-	       socket pool structure for managing
-	       multiple reusable socket connections.
+	       opaque pool of connections to any number of
+	       destinations.
+*/
+
+typedef struct commc_socketpool_t commc_socketpool_t;
+
+/*
+         commc_socketpool_callback_t
+	       ---
+	       completion of commc_socketpool_acquire_async(),
+	       called on the loop thread. socket is NULL unless
+	       status is COMMC_SUCCESS.
 */
 
-typedef struct {
-    commc_socket_t* sockets[COMMC_SOCKETPOOL_MAX_SOCKETS];
-    int            in_use[COMMC_SOCKETPOOL_MAX_SOCKETS];
-    int            socket_count;
-    int            max_sockets;
-    int            pool_type; /* 0: TCP, 1: UDP */
-    int            port;
-    char           hostname[256];
-} commc_socketpool_t;
+typedef void (*commc_socketpool_callback_t)(commc_socketpool_t* pool,
+                                            commc_socket_t*     socket,
+                                            commc_error_t       status,
+                                            void*               user_data);
 
 /*
          commc_socketpool_create()
 	       ---
-	       creates and initializes a socket pool
-	       for specified host, port, and type.
+	       creates an empty pool. max_per_host bounds the
+	       open connections (idle or in use) of each
+	       destination; 0 picks the defaults for it and for
+	       idle_timeout_ms.
 */
 commc_error_t commc_socketpool_create(commc_socketpool_t** pool,
-                                      const char*          hostname,
-                                      int                  port,
-                                      int                  pool_type,
-                                      int                  max_sockets);
+                                      int                  max_per_host,
+                                      unsigned long        idle_timeout_ms);
 
 /*
          commc_socketpool_destroy()
 	       ---
-	       destroys socket pool and closes all
-	       managed sockets.
+	       closes every idle connection and frees the pool.
+	       acquired connections must have been released and
+	       async acquires that are connecting must have called
+	       back; queued async waiters are called back
+	       with COMMC_ERROR_INVALID_STATE and a NULL pool.
+	       callers blocked in acquire are woken with
+	       COMMC_ERROR_INVALID_STATE, and destroy returns
+	       only after all of them have left the pool. no
+	       new acquire may start once destroy is called.
 */
 void commc_socketpool_destroy(commc_socketpool_t* pool);
 
 /*
          commc_socketpool_acquire()
 	       ---
-	       acquires an available socket from the pool
-	       for use. returns pointer to socket or NULL.
+	       returns a connected socket to hostname:port, reusing
+	       an idle one when possible. at the destination's
+	       limit it waits up to timeout_ms for a release
+	       (negative waits forever, 0 does not wait).
+
+	       returns:
+	       - COMMC_SUCCESS with *socket set
+	       - COMMC_ERROR_WOULD_BLOCK / COMMC_ERROR_TIMEOUT if
+	         no connection became available in time
+	       - COMMC_ERROR_INVALID_STATE if the pool was
+	         destroyed while waiting
+	       - COMMC_SYSTEM_ERROR if connecting failed
+*/
+commc_error_t commc_socketpool_acquire(commc_socketpool_t* pool,
+                                       const char*         hostname,
+                                       int                 port,
+                                       commc_socket_type_t type,
+                                       int                 timeout_ms,
+                                       commc_socket_t**    socket);
+
+/*
+         commc_socketpool_acquire_async()
+	       ---
+	       like commc_socketpool_acquire() without blocking the
+	       calling loop: callback runs on ctx's loop thread
+	       once a connection is available, never from inside
+	       this call. new connections are made on ctx's helper
+	       threads.
 */
-commc_socket_t* commc_socketpool_acquire(commc_socketpool_t* pool);
+commc_error_t commc_socketpool_acquire_async(commc_socketpool_t*         pool,
+                                             commc_async_context_t*      ctx,
+                                             const char*                 hostname,
+                                             int                         port,
+                                             commc_socket_type_t         type,
+                                             commc_socketpool_callback_t callback,
+                                             void*                       user_data);
 
 /*
          commc_socketpool_release()
 	       ---
-	       releases a socket back to the pool after use.
+	       gives an acquired socket back. reusable = 0 (a
+	       protocol error, a half-read response, a peer that
+	       announced it will close) closes it instead of
+	       keeping it for the next caller.
 */
 commc_error_t commc_socketpool_release(commc_socketpool_t* pool,
-                                       commc_socket_t*     socket);
+                                       commc_socket_t*     socket,
+                                       int                 reusable);
+
+/*
+         commc_socketpool_evict_idle()
+	       ---
+	       closes every connection idle for longer than the
+	       idle timeout. acquire does this lazily per
+	       destination; call it periodically (from a timer,
+	       say) to also reap destinations nobody asks for
+	       anymore. returns the number closed.
+*/
+int commc_socketpool_evict_idle(commc_socketpool_t* pool);
 
 /*
          commc_socketpool_get_count()
 	       ---
-	       returns the number of sockets currently
-	       managed by the pool.
+	       returns the number of open connections, idle or
+	       in use, across all destinations.
 */
 int commc_socketpool_get_count(const commc_socketpool_t* pool);
 
+/*
+         commc_socketpool_get_idle_count()
+	       ---
+	       returns the number of idle connections.
+*/
+int commc_socketpool_get_idle_count(const commc_socketpool_t* pool);
+
 #ifdef __cplusplus
 }
 #endif
 
 #endif /* COMMC_SOCKETPOOL_H */
 
-/* 
+/*
 	==================================
              --- EOF ---
 	==================================
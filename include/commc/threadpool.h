@@ -0,0 +1,284 @@
+/*
+   ===================================
+   C O M M O N - C
+   WORK-STEALING THREAD POOL MODULE
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+            --- THREAD POOL MODULE ---
+
+    this module provides a fixed-size pool of worker threads that
+    execute short CPU-bound tasks. each worker owns a Chase-Lev
+    work-stealing deque: tasks spawned by a worker are pushed to
+    the bottom of its own deque and popped LIFO (hot in cache),
+    while idle workers steal FIFO from the top of other workers'
+    deques. tasks submitted from threads outside the pool go
+    through a shared injection queue.
+
+    on top of plain submission the module offers:
+
+    - task groups for fork/join: spawn any number of tasks into a
+      group and wait for all of them. a waiting thread executes
+      pending tasks itself instead of blocking, so nested
+      fork/join never deadlocks the pool.
+    - parallel_for over an index range, recursively split down
+      to a caller-chosen grain size.
+
+    idle workers spin briefly and then sleep on a condition
+    variable; submitters only touch the lock when a worker is
+    actually asleep.
+
+    the deque and pool counters use the ordered atomics in
+    commc/atomic.h. threads are POSIX threads on unix and
+    Win32 threads on windows.
+
+*/
+
+#ifndef COMMC_THREADPOOL_H
+#define COMMC_THREADPOOL_H
+
+/*
+	==================================
+             --- INCLUDES ---
+	==================================
+*/
+
+#include "commc/error.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	==================================
+             --- CONSTANTS ---
+	==================================
+*/
+
+#define COMMC_THREADPOOL_MAX_WORKERS      256   /* UPPER BOUND ON WORKER COUNT */
+#define COMMC_THREADPOOL_DEQUE_CAPACITY   256   /* INITIAL PER-WORKER DEQUE SIZE */
+#define COMMC_THREADPOOL_SPIN_COUNT       64    /* IDLE SPINS BEFORE SLEEPING */
+
+/*
+	==================================
+             --- TYPES ---
+	==================================
+*/
+
+/*
+
+         commc_threadpool_task_fn
+	       ---
+	       task entry point. receives the argument given at
+	       submission time.
+
+*/
+
+typedef void (*commc_threadpool_task_fn)(void* arg);
+
+/*
+
+         commc_threadpool_range_fn
+	       ---
+	       parallel_for body. called with a half-open
+	       sub-range [begin, end) of the requested range.
+
+*/
+
+typedef void (*commc_threadpool_range_fn)(void* arg, size_t begin, size_t end);
+
+/*
+
+         commc_threadpool_t
+	       ---
+	       opaque pool structure.
+
+*/
+
+typedef struct commc_threadpool_t commc_threadpool_t;
+
+/*
+
+         commc_threadpool_group_t
+	       ---
+	       fork/join group. lives on the caller's stack and
+	       must be initialized with commc_threadpool_group_init()
+	       before use. the pending counter is the only state.
+
+*/
+
+typedef struct {
+
+  commc_threadpool_t*     pool;      /* OWNING POOL */
+  volatile unsigned long  pending;   /* TASKS NOT YET FINISHED */
+
+} commc_threadpool_group_t;
+
+/*
+	==================================
+             --- CORE API ---
+	==================================
+*/
+
+/*
+
+         commc_threadpool_create()
+	       ---
+	       creates a pool with worker_count threads. a count of
+	       0 uses the number of online processors.
+
+	       returns:
+	       - pointer to new pool, or NULL on error
+
+*/
+
+commc_threadpool_t* commc_threadpool_create(size_t worker_count);
+
+/*
+
+         commc_threadpool_destroy()
+	       ---
+	       shuts the pool down cleanly: every task already
+	       submitted runs to completion, then the workers exit
+	       and are joined. must not be called from a worker.
+
+*/
+
+void commc_threadpool_destroy(commc_threadpool_t* pool);
+
+/*
+
+         commc_threadpool_submit()
+	       ---
+	       queues a fire-and-forget task. safe to call from any
+	       thread; calls from a worker go to that worker's own
+	       deque.
+
+	       returns:
+	       - COMMC_SUCCESS if queued
+	       - COMMC_ARGUMENT_ERROR for invalid parameters
+	       - COMMC_MEMORY_ERROR if the task record or deque
+	         growth could not be allocated
+	       - COMMC_ERROR_INVALID_STATE after shutdown has begun
+
+*/
+
+commc_error_t commc_threadpool_submit(commc_threadpool_t* pool,
+                                      commc_threadpool_task_fn fn,
+                                      void* arg);
+
+/*
+
+         commc_threadpool_worker_count()
+	       ---
+	       returns the number of worker threads.
+
+*/
+
+size_t commc_threadpool_worker_count(const commc_threadpool_t* pool);
+
+/*
+
+         commc_threadpool_current_worker()
+	       ---
+	       returns the index of the calling worker thread in
+	       [0, worker_count), or -1 if the caller is not one
+	       of this pool's workers.
+
+*/
+
+int commc_threadpool_current_worker(const commc_threadpool_t* pool);
+
+/*
+	==================================
+             --- FORK/JOIN API ---
+	==================================
+*/
+
+/*
+
+         commc_threadpool_group_init()
+	       ---
+	       prepares a group for spawning tasks into pool.
+
+*/
+
+void commc_threadpool_group_init(commc_threadpool_group_t* group,
+                                 commc_threadpool_t* pool);
+
+/*
+
+         commc_threadpool_group_spawn()
+	       ---
+	       submits a task that counts towards the group.
+	       tasks may themselves spawn into the same or other
+	       groups.
+
+	       returns:
+	       - same codes as commc_threadpool_submit()
+
+*/
+
+commc_error_t commc_threadpool_group_spawn(commc_threadpool_group_t* group,
+                                           commc_threadpool_task_fn fn,
+                                           void* arg);
+
+/*
+
+         commc_threadpool_group_wait()
+	       ---
+	       returns once every task spawned into the group has
+	       finished. the caller executes pending pool tasks
+	       while it waits.
+
+*/
+
+void commc_threadpool_group_wait(commc_threadpool_group_t* group);
+
+/*
+
+         commc_threadpool_parallel_for()
+	       ---
+	       calls body over [begin, end) in parallel, splitting
+	       the range in halves until pieces are at most grain
+	       indices long, and waits for completion.
+
+	       parameters:
+	       - pool: thread pool
+	       - begin, end: half-open index range
+	       - grain: largest piece handed to body (0 picks
+	         a grain that gives about 8 pieces per worker)
+	       - body: range callback
+	       - arg: passed through to body
+
+	       returns:
+	       - COMMC_SUCCESS when the whole range has run
+	       - COMMC_ARGUMENT_ERROR for invalid parameters
+
+	       if a piece cannot be allocated it is run inline, so
+	       the range is always fully covered.
+
+*/
+
+commc_error_t commc_threadpool_parallel_for(commc_threadpool_t* pool,
+                                            size_t begin,
+                                            size_t end,
+                                            size_t grain,
+                                            commc_threadpool_range_fn body,
+                                            void* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMMC_THREADPOOL_H */
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
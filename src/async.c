@@ -11,9 +11,28 @@
          --- ASYNCHRONOUS I/O OPERATIONS ---
 
     implementation of cross-platform asynchronous I/O using
-    Windows I/O Completion Ports (IOCP) and Unix epoll/kqueue.
-    provides event-driven, callback-based I/O operations for
-    high-performance applications.
+    Windows I/O Completion Ports (IOCP), Unix epoll/kqueue
+    and Linux io_uring. provides event-driven, callback-based
+    I/O operations for high-performance applications.
+
+    on the readiness backends (epoll/kqueue) every handle
+    keeps a FIFO of pending read-side and write-side
+    operations. interest is armed when a queue gains work and
+    dropped lazily, on the first wakeup nobody consumes, so a
+    request/response loop does not pay an epoll_ctl() per
+    operation. on readiness a queue is drained until the
+    kernel reports EAGAIN. writes are attempted as soon as
+    they are submitted; regular files never report readiness,
+    so their operations run synchronously at the next poll.
+
+    the io_uring backend maps each operation onto one SQE
+    whose user_data is the operation itself. SQEs are only
+    published to the kernel at poll time, so any number of
+    submissions between two polls cost a single
+    io_uring_enter(), which also waits for completions; the
+    completion ring is then drained in batches. sendfile is a
+    file->pipe splice followed by pipe->socket splices through
+    a cached pipe.
 
     see include/commc/async.h for function prototypes
     and comprehensive documentation.
@@ -26,6 +45,10 @@
 	==================================
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE    /* for accept4, pipe2, splice flags, MSG_NOSIGNAL */
+#endif
+
 #include <stdlib.h>        /* for malloc, free */
 #include <string.h>        /* for memset, memcpy */
 #include <stdio.h>         /* for sprintf */
@@ -35,23 +58,180 @@
     #include <winsock2.h>  /* for socket functions */
     #include <mswsock.h>   /* for AcceptEx */
 #else
-    #include <unistd.h>    /* for close */
+    #include <unistd.h>    /* for close, read, write, pread, pwrite */
     #include <errno.h>     /* for errno */
     #include <fcntl.h>     /* for fcntl */
+    #include <time.h>      /* for struct timespec */
     #include <sys/types.h> /* for various types */
+    #include <sys/stat.h>  /* for fstat */
     #include <sys/socket.h> /* for socket functions */
-    
+
     #ifdef __linux__
-        #include <sys/epoll.h>   /* for epoll */
+        #include <sys/epoll.h>    /* for epoll */
+        #include <sys/eventfd.h>  /* for loop wakeups */
         #include <sys/sendfile.h> /* for sendfile */
+        #include <sys/syscall.h>  /* for io_uring_setup, io_uring_enter */
+        #include <sys/mman.h>     /* for ring mappings */
+        #if defined(__NR_io_uring_setup) && !defined(COMMC_ASYNC_NO_IO_URING)
+            #include <linux/io_uring.h>
+            #ifdef IORING_FEAT_EXT_ARG
+                #define COMMC_ASYNC_HAVE_URING
+            #endif
+        #endif
     #elif defined(__APPLE__) || defined(__FreeBSD__)
         #include <sys/event.h>   /* for kqueue */
         #include <sys/uio.h>     /* for sendfile */
+        #include <sys/time.h>    /* for struct timespec */
     #endif
 #endif
 
 #include "commc/async.h"
+#include "commc/atomic.h"
 #include "commc/error.h"
+#include "commc/threadpool.h"
+
+/*
+	==================================
+             --- CONSTANTS ---
+	==================================
+*/
+
+#define ASYNC_FD_KIND_UNKNOWN   0       /* NOT YET CLASSIFIED */
+#define ASYNC_FD_KIND_POLLABLE  1       /* SOCKET, PIPE, TTY... */
+#define ASYNC_FD_KIND_FILE      2       /* REGULAR FILE OR BLOCK DEVICE */
+
+#define ASYNC_WANT_READ         0x01    /* READ-SIDE INTEREST */
+#define ASYNC_WANT_WRITE        0x02    /* WRITE-SIDE INTEREST */
+#define ASYNC_WANT_HUP          0x04    /* PEER SHUTDOWN INTEREST */
+
+#define ASYNC_STAGE_DONE        -1      /* RESULT KNOWN, DELIVER AT NEXT POLL */
+#define ASYNC_STAGE_SPLICE_IN   0       /* SENDFILE: FILE -> PIPE */
+#define ASYNC_STAGE_SPLICE_OUT  1       /* SENDFILE: PIPE -> SOCKET */
+#define ASYNC_STAGE_POLL_WAIT   0x100   /* WAITING FOR READINESS AFTER EAGAIN */
+#define ASYNC_STAGE_OFFLOAD     0x200   /* QUEUED OR RUNNING ON A HELPER THREAD */
+
+#define ASYNC_DRAIN_LIMIT       64      /* COMPLETIONS PER HANDLE PER WAKEUP */
+#define ASYNC_SPLICE_CHUNK      65536   /* DEFAULT PIPE CAPACITY */
+#define ASYNC_COPY_CHUNK        16384   /* SENDFILE EMULATION BUFFER */
+#define ASYNC_MAX_IO_SIZE       0x7ffff000UL /* LINUX PER-CALL I/O LIMIT */
+
+#define ASYNC_WHEEL_LEVELS      6       /* TIMING WHEEL LEVELS */
+#define ASYNC_WHEEL_BITS        5       /* LOG2 OF SLOTS PER LEVEL */
+#define ASYNC_WHEEL_SLOTS       32      /* SLOTS PER LEVEL */
+#define ASYNC_WHEEL_RANGE       ((1UL << 30) - 1)  /* LONGEST DISTANCE ON THE WHEEL (MS) */
+#define ASYNC_WHEEL_NONE        (~0UL)  /* NO PENDING WHEEL EVENT */
+
+#define ASYNC_URING_WAKE        1       /* USER_DATA OF THE WAKEUP POLL (NEVER AN OP ADDRESS) */
+
+/* the msvc backend of commc/atomic.h works on long, which is
+   narrower than a pointer on win64, so the post stack uses the
+   pointer intrinsics there. */
+
+#if defined(_MSC_VER)
+    #define ASYNC_LOAD_PTR(ptr)          (*(void* volatile*)(ptr))
+    #define ASYNC_CAS_PTR(ptr, old, new) \
+        (InterlockedCompareExchangePointer((PVOID volatile*)(ptr), (PVOID)(new), (PVOID)(old)) == (PVOID)(old))
+    #define ASYNC_EXCHANGE_PTR(ptr, val) InterlockedExchangePointer((PVOID volatile*)(ptr), (PVOID)(val))
+#else
+    #define ASYNC_LOAD_PTR(ptr)          COMMC_ATOMIC_LOAD_ACQUIRE(ptr)
+    #define ASYNC_CAS_PTR(ptr, old, new) COMMC_ATOMIC_CAS((ptr), (old), (new))
+    #define ASYNC_EXCHANGE_PTR(ptr, val) COMMC_ATOMIC_EXCHANGE((ptr), (val))
+#endif
+
+#ifndef _WIN32
+    #ifndef MSG_NOSIGNAL
+        #define MSG_NOSIGNAL 0
+    #endif
+    #define ASYNC_CANCELLED ECANCELED
+#else
+    #define ASYNC_CANCELLED ERROR_OPERATION_ABORTED
+#endif
+
+/*
+	==================================
+             --- TYPES ---
+	==================================
+*/
+
+#ifndef _WIN32
+
+/*
+
+         commc_async_fd_state_t
+	       ---
+	       per-handle bookkeeping, indexed by descriptor.
+	       'armed' is what the kernel currently watches and
+	       may be a superset of what the queues need.
+
+*/
+
+struct commc_async_fd_state_t {
+    commc_async_operation_t* read_head;   /* READ/RECV/ACCEPT QUEUE */
+    commc_async_operation_t* read_tail;
+    commc_async_operation_t* write_head;  /* WRITE/SEND/CONNECT/SENDFILE QUEUE */
+    commc_async_operation_t* write_tail;
+    commc_async_operation_t* watch_op;    /* IO_URING POLL FOR A WATCHED HANDLE */
+    unsigned int             watch;       /* EVENTS REQUESTED BY ADD_HANDLE */
+    unsigned int             armed;       /* ASYNC_WANT_* REGISTERED WITH KERNEL */
+    unsigned int             ready;       /* EDGE MODE: SIDES NOT YET DRAINED TO EAGAIN */
+    int                      kind;        /* ASYNC_FD_KIND_* */
+    int                      stream;      /* PIPE OR STREAM SOCKET */
+    int                      backlog_next; /* EDGE MODE: NEXT HANDLE IN THE BACKLOG */
+    int                      in_backlog;  /* EDGE MODE: LINKED INTO THE BACKLOG */
+};
+
+#endif
+
+#ifdef COMMC_ASYNC_HAVE_URING
+
+/*
+
+         commc_async_uring_t
+	       ---
+	       mapped io_uring rings plus the sendfile pipe cache.
+	       the kernel owns sq_head and cq_tail; we own sq_tail
+	       and cq_head.
+
+*/
+
+struct commc_async_uring_t {
+    int                   ring_fd;        /* IO_URING INSTANCE */
+
+    /* submission ring */
+    unsigned int*         sq_head;
+    unsigned int*         sq_tail;
+    unsigned int*         sq_array;
+    unsigned int          sq_mask;
+    unsigned int          sq_entries;
+    unsigned int          sq_local_tail;  /* SQES FILLED, PUBLISHED AT NEXT ENTER */
+    struct io_uring_sqe*  sqes;
+
+    /* completion ring */
+    unsigned int*         cq_head;
+    unsigned int*         cq_tail;
+    unsigned int          cq_mask;
+    struct io_uring_cqe*  cqes;
+    struct io_uring_cqe*  batch;          /* REAPED CQES BEING DISPATCHED */
+    unsigned int          batch_size;
+
+    /* mappings */
+    void*                 sq_ring;
+    size_t                sq_ring_size;
+    void*                 cq_ring;
+    size_t                cq_ring_size;
+    size_t                sqes_size;
+
+    /* sendfile pipes: pipe_fds[2 * slot], free slots stacked in pipe_free */
+    int*                  pipe_fds;
+    int*                  pipe_free;
+    int                   pipe_count;
+    int                   pipe_free_count;
+
+    size_t                watch_ops;      /* POLL OPERATIONS IN THE OPERATIONS ARRAY */
+    int                   wake_armed;     /* WAKEUP POLL IN FLIGHT */
+};
+
+#endif
 
 /*
 	==================================
@@ -84,7 +264,13 @@ static int validate_context(const commc_async_context_t* ctx) {
 
 static int validate_operation(const commc_async_operation_t* op) {
 
-    return (op != NULL && op->handle >= 0);
+    if (op && op->type == COMMC_ASYNC_OP_WORK) {
+        return (op->work != NULL);
+    }
+
+    return (op != NULL && op->handle >= 0 &&
+            ((op->type >= COMMC_ASYNC_OP_READ && op->type <= COMMC_ASYNC_OP_SEND) ||
+             op->type == COMMC_ASYNC_OP_FSYNC));
 }
 
 /*
@@ -121,7 +307,8 @@ static int grow_operations_array(commc_async_context_t* ctx) {
 
          add_operation()
 	       ---
-	       adds operation to context tracking array.
+	       adds operation to context tracking array and
+	       remembers its slot for constant-time removal.
 
 */
 
@@ -134,6 +321,7 @@ static int add_operation(commc_async_context_t* ctx,
         }
     }
 
+    op->slot = ctx->operation_count;
     ctx->operations[ctx->operation_count++] = op;
     return 0;
 }
@@ -149,16 +337,27 @@ static int add_operation(commc_async_context_t* ctx,
 static void remove_operation(commc_async_context_t* ctx,
                            commc_async_operation_t* op) {
 
+    commc_async_operation_t* last;
     size_t i;
 
-    for (i = 0; i < ctx->operation_count; i++) {
-        if (ctx->operations[i] == op) {
-            /* move last element to this position */
-            ctx->operations[i] = ctx->operations[ctx->operation_count - 1];
-            ctx->operation_count--;
-            break;
+    i = op->slot;
+
+    if (i >= ctx->operation_count || ctx->operations[i] != op) {
+        for (i = 0; i < ctx->operation_count; i++) {
+            if (ctx->operations[i] == op) {
+                break;
+            }
+        }
+        if (i == ctx->operation_count) {
+            return;
         }
     }
+
+    /* move last element to this position */
+    last = (commc_async_operation_t*)ctx->operations[ctx->operation_count - 1];
+    ctx->operations[i] = last;
+    last->slot = i;
+    ctx->operation_count--;
 }
 
 /*
@@ -180,10 +379,193 @@ static int set_nonblocking(int handle) {
     if (flags == -1) {
         return -1;
     }
+    if (flags & O_NONBLOCK) {
+        return 0;
+    }
     return fcntl(handle, F_SETFL, flags | O_NONBLOCK);
 #endif
 }
 
+/*
+
+         signal_wakeup()
+	       ---
+	       makes the loop's current or next wait return.
+	       callable from any thread.
+
+*/
+
+static void signal_wakeup(commc_async_context_t* ctx) {
+
+#if defined(_WIN32)
+    SetEvent(ctx->wake_event);
+#elif defined(__linux__)
+    /* EAGAIN means the counter is saturated, i.e. already signaled */
+    eventfd_write(ctx->wake_fd, 1);
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+    struct kevent change;
+
+    EV_SET(&change, 0, EVFILT_USER, 0, NOTE_TRIGGER, 0, NULL);
+    kevent(ctx->kqueue_fd, &change, 1, NULL, 0, NULL);
+#else
+    (void)ctx;
+#endif
+}
+
+#ifdef __linux__
+
+/*
+
+         drain_wakeup()
+	       ---
+	       resets the wakeup eventfd. must run before the
+	       post stack is taken, so a post that lands in
+	       between signals again instead of being missed.
+
+*/
+
+static void drain_wakeup(commc_async_context_t* ctx) {
+
+    eventfd_t value;
+
+    eventfd_read(ctx->wake_fd, &value);
+}
+
+#endif
+
+/*
+
+         run_posted()
+	       ---
+	       takes the whole post stack in one exchange,
+	       reverses it into posting order and runs it.
+	       tasks posted meanwhile wait for the next poll.
+
+*/
+
+static int run_posted(commc_async_context_t* ctx) {
+
+    commc_async_task_t* task;
+    commc_async_task_t* next;
+    commc_async_task_t* list = NULL;
+    int                 allocated;
+    int                 count = 0;
+
+    if (!ASYNC_LOAD_PTR((void**)&ctx->posted)) {
+        return 0;
+    }
+
+    task = (commc_async_task_t*)ASYNC_EXCHANGE_PTR((void**)&ctx->posted, NULL);
+
+    while (task) {
+        next = task->next;
+        task->next = list;
+        list = task;
+        task = next;
+    }
+
+    while (list) {
+
+        /* the task may be freed or posted again by its own fn */
+        task = list;
+        list = task->next;
+        task->next = NULL;
+        allocated = task->allocated;
+
+        task->fn(task->arg);
+        if (allocated) {
+            free(task);
+        }
+        count++;
+    }
+
+    return count;
+}
+
+/*
+
+         flush_batch()
+	       ---
+	       hands the collected results to the batch callback.
+
+*/
+
+static void flush_batch(commc_async_context_t* ctx) {
+
+    size_t count = ctx->batch_count;
+
+    if (count == 0) {
+        return;
+    }
+
+    ctx->batch_count = 0;
+    ctx->batch_flushing = 1;
+    ctx->batch_callback(ctx->batch, count, ctx->batch_user_data);
+    ctx->batch_flushing = 0;
+}
+
+/*
+
+         deliver_default()
+	       ---
+	       passes a result without its own callback to the
+	       batch, or to the default callback.
+
+*/
+
+static void deliver_default(commc_async_context_t* ctx,
+                           const commc_async_result_t* result) {
+
+    if (!ctx->batch_callback) {
+        if (ctx->default_callback) {
+            ctx->default_callback(result);
+        }
+        return;
+    }
+
+    /* the batch array is being read: no appending behind its back */
+    if (ctx->batch_flushing) {
+        ctx->batch_callback(result, 1, ctx->batch_user_data);
+        return;
+    }
+
+    ctx->batch[ctx->batch_count++] = *result;
+    if (ctx->batch_count == (size_t)ctx->max_events) {
+        flush_batch(ctx);
+    }
+}
+
+/*
+
+         deliver_result()
+	       ---
+	       builds the result for an operation and invokes
+	       its callback, or the context default.
+
+*/
+
+static void deliver_result(commc_async_context_t* ctx,
+                          commc_async_operation_t* op,
+                          size_t bytes_transferred,
+                          int error_code) {
+
+    commc_async_result_t   result;
+
+    memset(&result, 0, sizeof(result));
+    result.operation = op->type;
+    result.handle = op->handle;
+    result.buffer = op->buffer;
+    result.bytes_transferred = bytes_transferred;
+    result.error_code = error_code;
+    result.user_data = op->user_data;
+
+    if (op->callback) {
+        op->callback(&result);
+    } else {
+        deliver_default(ctx, &result);
+    }
+}
+
 #ifdef _WIN32
 
 /*
@@ -201,8 +583,8 @@ static DWORD WINAPI iocp_worker_thread(LPVOID param) {
     DWORD                  bytes_transferred;
     ULONG_PTR              completion_key;
     OVERLAPPED*            overlapped;
-    commc_async_result_t   result;
     commc_async_operation_t* op;
+    DWORD                  error;
 
     while (ctx->is_running) {
 
@@ -211,28 +593,17 @@ static DWORD WINAPI iocp_worker_thread(LPVOID param) {
                                       &completion_key,
                                       &overlapped,
                                       1000)) {
-            
-            DWORD error = GetLastError();
+
+            error = GetLastError();
             if (error == WAIT_TIMEOUT) {
                 continue;
             }
-            
+
             if (overlapped) {
                 /* operation failed */
                 op = (commc_async_operation_t*)completion_key;
-                
-                memset(&result, 0, sizeof(result));
-                result.operation = op->type;
-                result.handle = op->handle;
-                result.buffer = op->buffer;
-                result.bytes_transferred = 0;
-                result.error_code = error;
-                result.user_data = op->user_data;
-                
-                if (op->callback) {
-                    op->callback(&result);
-                }
-                
+
+                deliver_result(ctx, op, 0, (int)error);
                 remove_operation(ctx, op);
                 commc_async_operation_destroy(op);
             }
@@ -241,19 +612,8 @@ static DWORD WINAPI iocp_worker_thread(LPVOID param) {
 
         /* operation completed successfully */
         op = (commc_async_operation_t*)completion_key;
-        
-        memset(&result, 0, sizeof(result));
-        result.operation = op->type;
-        result.handle = op->handle;
-        result.buffer = op->buffer;
-        result.bytes_transferred = bytes_transferred;
-        result.error_code = 0;
-        result.user_data = op->user_data;
-        
-        if (op->callback) {
-            op->callback(&result);
-        }
-        
+
+        deliver_result(ctx, op, bytes_transferred, 0);
         remove_operation(ctx, op);
         commc_async_operation_destroy(op);
     }
@@ -261,681 +621,4189 @@ static DWORD WINAPI iocp_worker_thread(LPVOID param) {
     return 0;
 }
 
-#endif
-
-#if defined(__linux__)
+#else
 
 /*
 
-         convert_events_to_epoll()
+         forget_handle()
 	       ---
-	       converts generic event types to epoll-specific
-	       event flags.
+	       drops what we know about a descriptor number that
+	       has just been handed out again. the old
+	       registration vanished when it was closed, so a
+	       stale 'armed' would keep the new one unwatched.
 
 */
 
-static uint32_t convert_events_to_epoll(commc_async_event_type_t events) {
+static void forget_handle(commc_async_context_t* ctx, int handle) {
 
-    uint32_t epoll_events = 0;
+    struct commc_async_fd_state_t* state;
 
-    if (events & COMMC_ASYNC_EVENT_READ) {
-        epoll_events |= EPOLLIN;
-    }
-    if (events & COMMC_ASYNC_EVENT_WRITE) {
-        epoll_events |= EPOLLOUT;
-    }
-    if (events & COMMC_ASYNC_EVENT_CLOSE) {
-        epoll_events |= EPOLLHUP | EPOLLRDHUP;
+    if (handle < 0 || handle >= ctx->fd_state_count) {
+        return;
     }
-    if (events & COMMC_ASYNC_EVENT_ERROR) {
-        epoll_events |= EPOLLERR;
+
+    state = &ctx->fd_states[handle];
+    if (state->read_head || state->write_head) {
+        return;
     }
 
-    return epoll_events;
+    state->armed = 0;
+    state->ready = 0;
+    state->watch = 0;
+    state->kind = ASYNC_FD_KIND_UNKNOWN;
 }
 
 /*
 
-         convert_epoll_to_events()
+         edge_note_transfer()
 	       ---
-	       converts epoll event flags to generic
-	       event types.
+	       edge mode: a short read or write on a byte stream
+	       means the kernel buffer was emptied or filled, so
+	       the side is treated as drained without spending a
+	       syscall on the EAGAIN.
 
 */
 
-static commc_async_event_type_t convert_epoll_to_events(uint32_t epoll_events) {
-
-    commc_async_event_type_t events = 0;
+static void edge_note_transfer(struct commc_async_fd_state_t* state,
+                               const commc_async_operation_t* op,
+                               size_t bytes,
+                               unsigned int side) {
 
-    if (epoll_events & EPOLLIN) {
-        events |= COMMC_ASYNC_EVENT_READ;
-    }
-    if (epoll_events & EPOLLOUT) {
-        events |= COMMC_ASYNC_EVENT_WRITE;
-    }
-    if (epoll_events & (EPOLLHUP | EPOLLRDHUP)) {
-        events |= COMMC_ASYNC_EVENT_CLOSE;
-    }
-    if (epoll_events & EPOLLERR) {
-        events |= COMMC_ASYNC_EVENT_ERROR;
+    if (!state->stream || bytes == 0 ||
+        bytes >= op->buffer_size || bytes >= ASYNC_MAX_IO_SIZE) {
+        return;
     }
 
-    return events;
+    if (op->type == COMMC_ASYNC_OP_READ || op->type == COMMC_ASYNC_OP_RECV ||
+        op->type == COMMC_ASYNC_OP_WRITE || op->type == COMMC_ASYNC_OP_SEND) {
+        state->ready &= ~side;
+    }
 }
 
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-
 /*
 
-         convert_events_to_kqueue()
+         complete_operation()
 	       ---
-	       converts generic event types to kqueue-specific
-	       kevent structures.
+	       untracks an operation, delivers its result and
+	       frees it. the operation is untracked first so the
+	       callback sees an accurate pending count.
 
 */
 
-static void convert_events_to_kqueue(int handle,
-                                    commc_async_event_type_t events,
-                                    struct kevent* changes,
-                                    int* change_count) {
+static void complete_operation(commc_async_context_t* ctx,
+                              commc_async_operation_t* op,
+                              size_t bytes_transferred,
+                              int error_code) {
 
-    int count = 0;
+    remove_operation(ctx, op);
 
-    if (events & COMMC_ASYNC_EVENT_READ) {
-        EV_SET(&changes[count++], handle, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, NULL);
-    }
-    if (events & COMMC_ASYNC_EVENT_WRITE) {
-        EV_SET(&changes[count++], handle, EVFILT_WRITE, EV_ADD | EV_ENABLE, 0, 0, NULL);
+    if (op->type == COMMC_ASYNC_OP_ACCEPT &&
+        error_code == 0 && op->result_handle) {
+        forget_handle(ctx, *op->result_handle);
     }
 
-    *change_count = count;
+    deliver_result(ctx, op, bytes_transferred, error_code);
+    commc_async_operation_destroy(op);
 }
 
 /*
 
-         convert_kqueue_to_events()
+         deliver_notification()
 	       ---
-	       converts kqueue kevent to generic event types.
+	       reports readiness of a watched handle to the
+	       default callback as a COMMC_ASYNC_OP_POLL result.
 
 */
 
-static commc_async_event_type_t convert_kqueue_to_events(const struct kevent* event) {
+static void deliver_notification(commc_async_context_t* ctx,
+                                int handle,
+                                unsigned int events) {
 
-    commc_async_event_type_t events = 0;
+    commc_async_result_t result;
 
-    if (event->filter == EVFILT_READ) {
-        events |= COMMC_ASYNC_EVENT_READ;
-    }
-    if (event->filter == EVFILT_WRITE) {
-        events |= COMMC_ASYNC_EVENT_WRITE;
+    memset(&result, 0, sizeof(result));
+    result.operation = COMMC_ASYNC_OP_POLL;
+    result.handle = handle;
+    result.bytes_transferred = events;
+    deliver_default(ctx, &result);
+}
+
+/*
+
+         get_fd_state()
+	       ---
+	       returns the state slot of a descriptor, growing
+	       the table as needed. callbacks may grow the table,
+	       so pointers must be re-fetched after any callback.
+
+*/
+
+static struct commc_async_fd_state_t* get_fd_state(commc_async_context_t* ctx,
+                                                   int handle) {
+
+    struct commc_async_fd_state_t* states;
+    int                            count;
+
+    if (handle < ctx->fd_state_count) {
+        return &ctx->fd_states[handle];
     }
-    if (event->flags & EV_EOF) {
-        events |= COMMC_ASYNC_EVENT_CLOSE;
+
+    count = ctx->fd_state_count ? ctx->fd_state_count : 64;
+    while (count <= handle) {
+        count *= 2;
     }
-    if (event->flags & EV_ERROR) {
-        events |= COMMC_ASYNC_EVENT_ERROR;
+
+    states = (struct commc_async_fd_state_t*)realloc(ctx->fd_states,
+                                                    (size_t)count * sizeof(*states));
+    if (!states) {
+        return NULL;
     }
 
-    return events;
+    memset(states + ctx->fd_state_count, 0,
+           (size_t)(count - ctx->fd_state_count) * sizeof(*states));
+
+    ctx->fd_states = states;
+    ctx->fd_state_count = count;
+    return &states[handle];
 }
 
-#endif
+/*
+
+         classify_handle()
+	       ---
+	       tells regular files, which are always "ready" and
+	       cannot be registered with epoll, from pollable
+	       handles. the answer is cached until the handle is
+	       removed from the context.
+
+*/
+
+static int classify_handle(struct commc_async_fd_state_t* state, int handle) {
+
+    struct stat st;
+    int         type = 0;
+    socklen_t   length = sizeof(type);
+
+    if (state->kind == ASYNC_FD_KIND_UNKNOWN) {
+        state->stream = 0;
+        if (fstat(handle, &st) != 0) {
+            state->kind = ASYNC_FD_KIND_POLLABLE;
+        } else if (S_ISREG(st.st_mode) || S_ISBLK(st.st_mode)) {
+            state->kind = ASYNC_FD_KIND_FILE;
+        } else {
+            state->kind = ASYNC_FD_KIND_POLLABLE;
+            state->stream = S_ISFIFO(st.st_mode) ||
+                            (S_ISSOCK(st.st_mode) &&
+                             getsockopt(handle, SOL_SOCKET, SO_TYPE, (void*)&type, &length) == 0 &&
+                             type == SOCK_STREAM);
+        }
+    }
+
+    return state->kind;
+}
 
 /*
-	==================================
-             --- API ---
-	==================================
+
+         op_is_write_side()
+	       ---
+	       whether an operation waits for writability.
+
 */
 
+static int op_is_write_side(const commc_async_operation_t* op) {
+
+    return op->type == COMMC_ASYNC_OP_WRITE    ||
+           op->type == COMMC_ASYNC_OP_SEND     ||
+           op->type == COMMC_ASYNC_OP_CONNECT  ||
+           op->type == COMMC_ASYNC_OP_SENDFILE;
+}
+
 /*
 
-         commc_async_context_create()
+         queue_push()
 	       ---
-	       creates new asynchronous I/O context.
+	       appends an operation to a singly linked FIFO.
 
 */
 
-commc_async_context_t* commc_async_context_create(int max_events,
-                                                  int timeout_ms) {
+static void queue_push(commc_async_operation_t** head,
+                      commc_async_operation_t** tail,
+                      commc_async_operation_t* op) {
 
-    commc_async_context_t* ctx;
+    op->next = NULL;
 
-    ctx = (commc_async_context_t*)malloc(sizeof(commc_async_context_t));
-    if (!ctx) {
-        return NULL;
+    if (*tail) {
+        (*tail)->next = op;
+    } else {
+        *head = op;
     }
 
-    /* initialize basic fields */
-    memset(ctx, 0, sizeof(commc_async_context_t));
-    ctx->is_running = 0;
-    ctx->max_events = (max_events > 0) ? max_events : COMMC_ASYNC_MAX_EVENTS;
-    ctx->timeout_ms = (timeout_ms >= 0) ? timeout_ms : COMMC_ASYNC_DEFAULT_TIMEOUT;
-    ctx->default_callback = NULL;
-    ctx->operations = NULL;
-    ctx->operation_count = 0;
-    ctx->operation_capacity = 0;
+    *tail = op;
+}
 
-#ifdef _WIN32
-    /* create I/O completion port */
-    ctx->completion_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE,
-                                                 NULL, 0, 0);
-    if (!ctx->completion_port) {
-        free(ctx);
-        return NULL;
-    }
+/*
 
-    /* create worker threads */
-    ctx->thread_count = 4; /* default thread count */
-    ctx->threads = (HANDLE*)malloc(ctx->thread_count * sizeof(HANDLE));
-    if (!ctx->threads) {
-        CloseHandle(ctx->completion_port);
-        free(ctx);
-        return NULL;
-    }
+         ready_push()
+	       ---
+	       queues an operation for completion at the next
+	       poll. used for regular files and for operations
+	       that finished at submit time, so callbacks never
+	       run re-entrantly from inside a submit call.
 
-    for (int i = 0; i < ctx->thread_count; i++) {
-        ctx->threads[i] = CreateThread(NULL, 0, iocp_worker_thread,
-                                      ctx, 0, NULL);
-        if (!ctx->threads[i]) {
-            /* cleanup created threads */
-            for (int j = 0; j < i; j++) {
-                CloseHandle(ctx->threads[j]);
-            }
-            free(ctx->threads);
-            CloseHandle(ctx->completion_port);
-            free(ctx);
-            return NULL;
-        }
+*/
+
+static void ready_push(commc_async_context_t* ctx,
+                      commc_async_operation_t* op) {
+
+    queue_push(&ctx->ready_head, &ctx->ready_tail, op);
+}
+
+/*
+
+         finish_early()
+	       ---
+	       records an operation's result and defers delivery
+	       to the next poll.
+
+*/
+
+static void finish_early(commc_async_context_t* ctx,
+                        commc_async_operation_t* op,
+                        size_t bytes_transferred,
+                        int error_code) {
+
+    op->stage = ASYNC_STAGE_DONE;
+    op->transferred = bytes_transferred;
+    op->error_code = error_code;
+    ready_push(ctx, op);
+}
+
+/*
+
+         platform_sendfile()
+	       ---
+	       copies up to count bytes of in_handle at offset to
+	       out_handle without a user-space round trip where
+	       the platform allows it. *sent is 0 at end of file.
+
+*/
+
+static int platform_sendfile(int out_handle,
+                            int in_handle,
+                            size_t offset,
+                            size_t count,
+                            size_t* sent) {
+
+#if defined(__linux__)
+    off_t   position = (off_t)offset;
+    ssize_t n;
+
+    if (count > ASYNC_MAX_IO_SIZE) {
+        count = ASYNC_MAX_IO_SIZE;
     }
 
-#elif defined(__linux__)
-    /* create epoll instance */
-    ctx->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
-    if (ctx->epoll_fd == -1) {
-        free(ctx);
-        return NULL;
+    n = sendfile(out_handle, in_handle, &position, count);
+    if (n < 0) {
+        return -1;
     }
 
-    /* allocate events array */
-    ctx->events = (struct epoll_event*)malloc(ctx->max_events * 
-                                             sizeof(struct epoll_event));
-    if (!ctx->events) {
-        close(ctx->epoll_fd);
-        free(ctx);
-        return NULL;
+    *sent = (size_t)n;
+    return 0;
+
+#elif defined(__APPLE__)
+    off_t length = (off_t)count;
+
+    if (sendfile(in_handle, out_handle, (off_t)offset, &length, NULL, 0) != 0) {
+        if ((errno == EAGAIN || errno == EINTR) && length > 0) {
+            *sent = (size_t)length;
+            return 0;
+        }
+        return -1;
     }
 
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-    /* create kqueue */
-    ctx->kqueue_fd = kqueue();
-    if (ctx->kqueue_fd == -1) {
-        free(ctx);
-        return NULL;
+    *sent = (size_t)length;
+    return 0;
+
+#elif defined(__FreeBSD__)
+    off_t written = 0;
+
+    if (sendfile(in_handle, out_handle, (off_t)offset, count, NULL, &written, 0) != 0) {
+        if ((errno == EAGAIN || errno == EINTR || errno == EBUSY) && written > 0) {
+            *sent = (size_t)written;
+            return 0;
+        }
+        return -1;
     }
 
-    /* allocate events and changes arrays */
-    ctx->events = (struct kevent*)malloc(ctx->max_events * sizeof(struct kevent));
-    if (!ctx->events) {
-        close(ctx->kqueue_fd);
-        free(ctx);
-        return NULL;
+    *sent = (size_t)written;
+    return 0;
+
+#else
+    char    buffer[ASYNC_COPY_CHUNK];
+    ssize_t got;
+    ssize_t n;
+
+    if (count > sizeof(buffer)) {
+        count = sizeof(buffer);
     }
 
-    ctx->changes = (struct kevent*)malloc(ctx->max_events * sizeof(struct kevent));
-    if (!ctx->changes) {
-        free(ctx->events);
-        close(ctx->kqueue_fd);
-        free(ctx);
-        return NULL;
+    got = pread(in_handle, buffer, count, (off_t)offset);
+    if (got <= 0) {
+        *sent = 0;
+        return (got < 0) ? -1 : 0;
     }
 
-    ctx->change_count = 0;
+    n = send(out_handle, buffer, (size_t)got, MSG_NOSIGNAL);
+    if (n < 0) {
+        return -1;
+    }
+
+    *sent = (size_t)n;
+    return 0;
 #endif
+}
 
-    return ctx;
+/*
+
+         reactor_sendfile()
+	       ---
+	       pushes as much of a sendfile operation as the
+	       socket accepts. returns 1 when finished, 0 when
+	       the socket is full.
+
+*/
+
+static int reactor_sendfile(commc_async_operation_t* op,
+                           size_t* bytes_transferred,
+                           int* error_code) {
+
+    size_t sent;
+
+    while (op->transferred < op->buffer_size) {
+
+        sent = 0;
+
+        if (platform_sendfile(op->handle, op->source_handle,
+                              op->offset + op->transferred,
+                              op->buffer_size - op->transferred,
+                              &sent) != 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            *bytes_transferred = op->transferred;
+            *error_code = errno;
+            return 1;
+        }
+
+        if (sent == 0) {
+            break;  /* end of file */
+        }
+
+        op->transferred += sent;
+    }
+
+    *bytes_transferred = op->transferred;
+    *error_code = 0;
+    return 1;
 }
 
 /*
 
-         commc_async_context_destroy()
+         reactor_attempt()
 	       ---
-	       destroys async context and cleans up resources.
+	       performs the syscall behind an operation. returns
+	       1 with the result filled in when the operation is
+	       finished, 0 if it would block.
 
 */
 
-void commc_async_context_destroy(commc_async_context_t* ctx) {
+static int reactor_attempt(commc_async_operation_t* op,
+                          size_t* bytes_transferred,
+                          int* error_code) {
 
-    if (!validate_context(ctx)) {
-        return;
+    ssize_t   n;
+    size_t    size;
+    int       handle;
+    int       socket_error;
+    socklen_t length;
+
+    size = op->buffer_size;
+    if (size > ASYNC_MAX_IO_SIZE) {
+        size = ASYNC_MAX_IO_SIZE;
     }
 
-    /* stop event loop */
-    ctx->is_running = 0;
+    for (;;) {
 
-    /* cancel all operations */
-    commc_async_cancel_all(ctx);
+        switch (op->type) {
 
-#ifdef _WIN32
-    /* wait for worker threads to finish */
-    if (ctx->threads) {
-        WaitForMultipleObjects(ctx->thread_count, ctx->threads,
-                              TRUE, 5000);
-        for (int i = 0; i < ctx->thread_count; i++) {
-            CloseHandle(ctx->threads[i]);
+        case COMMC_ASYNC_OP_READ:
+            n = op->has_offset ? pread(op->handle, op->buffer, size, (off_t)op->offset)
+                               : read(op->handle, op->buffer, size);
+            break;
+
+        case COMMC_ASYNC_OP_RECV:
+            n = recv(op->handle, op->buffer, size, 0);
+            break;
+
+        case COMMC_ASYNC_OP_WRITE:
+            n = op->has_offset ? pwrite(op->handle, op->buffer, size, (off_t)op->offset)
+                               : write(op->handle, op->buffer, size);
+            break;
+
+        case COMMC_ASYNC_OP_SEND:
+            n = send(op->handle, op->buffer, size, MSG_NOSIGNAL);
+            break;
+
+        case COMMC_ASYNC_OP_ACCEPT:
+            length = (socklen_t)op->address_length;
+#ifdef __linux__
+            handle = accept4(op->handle, (struct sockaddr*)op->address,
+                             op->address ? &length : NULL,
+                             SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+            handle = accept(op->handle, (struct sockaddr*)op->address,
+                            op->address ? &length : NULL);
+            if (handle >= 0) {
+                set_nonblocking(handle);
+                fcntl(handle, F_SETFD, FD_CLOEXEC);
+            }
+#endif
+            n = -1;
+            if (handle >= 0) {
+                op->address_length = (unsigned int)length;
+                if (op->result_handle) {
+                    *op->result_handle = handle;
+                }
+                n = op->address ? (ssize_t)length : 0;
+            }
+            break;
+
+        case COMMC_ASYNC_OP_CONNECT:
+            /* writable: the outcome of the connect() issued at submit */
+            socket_error = 0;
+            length = (socklen_t)sizeof(socket_error);
+            if (getsockopt(op->handle, SOL_SOCKET, SO_ERROR,
+                           &socket_error, &length) != 0) {
+                socket_error = errno;
+            }
+            *bytes_transferred = 0;
+            *error_code = socket_error;
+            return 1;
+
+        case COMMC_ASYNC_OP_SENDFILE:
+            return reactor_sendfile(op, bytes_transferred, error_code);
+
+        default:
+            *bytes_transferred = 0;
+            *error_code = EINVAL;
+            return 1;
         }
-        free(ctx->threads);
+
+        if (n >= 0) {
+            *bytes_transferred = (size_t)n;
+            *error_code = 0;
+            return 1;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+
+        *bytes_transferred = 0;
+        *error_code = errno;
+        return 1;
     }
+}
 
-    /* close completion port */
-    if (ctx->completion_port) {
-        CloseHandle(ctx->completion_port);
+/*
+
+         run_ready_list()
+	       ---
+	       completes everything on the ready list. the list
+	       is detached first: operations queued by callbacks
+	       wait for the next poll instead of starving I/O.
+
+*/
+
+static int run_ready_list(commc_async_context_t* ctx) {
+
+    commc_async_operation_t* op;
+    commc_async_operation_t* next;
+    size_t                   bytes;
+    int                      error_code;
+    int                      count = 0;
+
+    op = ctx->ready_head;
+    ctx->ready_head = NULL;
+    ctx->ready_tail = NULL;
+
+    while (op) {
+
+        next = op->next;
+
+        if (op->stage == ASYNC_STAGE_DONE) {
+            bytes = op->transferred;
+            error_code = op->error_code;
+        } else if (!reactor_attempt(op, &bytes, &error_code)) {
+            bytes = 0;
+            error_code = EAGAIN;
+        }
+
+        complete_operation(ctx, op, bytes, error_code);
+        count++;
+        op = next;
     }
 
-#elif defined(__linux__)
-    /* close epoll */
-    if (ctx->epoll_fd != -1) {
-        close(ctx->epoll_fd);
+    return count;
+}
+
+/*
+
+         reactor_wanted()
+	       ---
+	       interest a handle needs for its queues and watch.
+
+*/
+
+static unsigned int reactor_wanted(const struct commc_async_fd_state_t* state) {
+
+    unsigned int want = 0;
+
+    if (state->read_head ||
+        (state->watch & (COMMC_ASYNC_EVENT_READ | COMMC_ASYNC_EVENT_ACCEPT))) {
+        want |= ASYNC_WANT_READ;
+    }
+    if (state->write_head ||
+        (state->watch & (COMMC_ASYNC_EVENT_WRITE | COMMC_ASYNC_EVENT_CONNECT))) {
+        want |= ASYNC_WANT_WRITE;
+    }
+    if (state->watch & COMMC_ASYNC_EVENT_CLOSE) {
+        want |= ASYNC_WANT_HUP;
     }
 
-    /* free events array */
-    if (ctx->events) {
-        free(ctx->events);
+    return want;
+}
+
+#if defined(__linux__)
+
+/*
+
+         convert_epoll_to_events()
+	       ---
+	       converts epoll (or poll) event flags to generic
+	       event types.
+
+*/
+
+static unsigned int convert_epoll_to_events(unsigned int epoll_events) {
+
+    unsigned int events = 0;
+
+    if (epoll_events & EPOLLIN) {
+        events |= COMMC_ASYNC_EVENT_READ | COMMC_ASYNC_EVENT_ACCEPT;
+    }
+    if (epoll_events & EPOLLOUT) {
+        events |= COMMC_ASYNC_EVENT_WRITE | COMMC_ASYNC_EVENT_CONNECT;
+    }
+    if (epoll_events & (EPOLLHUP | EPOLLRDHUP)) {
+        events |= COMMC_ASYNC_EVENT_CLOSE;
+    }
+    if (epoll_events & EPOLLERR) {
+        events |= COMMC_ASYNC_EVENT_ERROR;
     }
 
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-    /* close kqueue */
-    if (ctx->kqueue_fd != -1) {
-        close(ctx->kqueue_fd);
+    return events;
+}
+
+/*
+
+         reactor_update()
+	       ---
+	       makes the kernel watch exactly 'want' on a handle.
+	       a descriptor closed and reused behind our back is
+	       re-added. fails with errno EPERM for regular files.
+
+*/
+
+static int reactor_update(commc_async_context_t* ctx,
+                         int handle,
+                         struct commc_async_fd_state_t* state,
+                         unsigned int want) {
+
+    struct epoll_event event;
+    int                rc;
+
+    if (want == state->armed) {
+        return 0;
     }
 
-    /* free event arrays */
-    if (ctx->events) {
-        free(ctx->events);
+    if (want == 0) {
+        epoll_ctl(ctx->epoll_fd, EPOLL_CTL_DEL, handle, NULL);
+        state->armed = 0;
+        return 0;
     }
-    if (ctx->changes) {
-        free(ctx->changes);
+
+    /* edge mode: registered once for everything, never narrowed */
+    if (ctx->edge_triggered) {
+        if (state->armed) {
+            return 0;
+        }
+        want = ASYNC_WANT_READ | ASYNC_WANT_WRITE | ASYNC_WANT_HUP;
     }
-#endif
 
-    /* free operations array */
-    if (ctx->operations) {
-        free(ctx->operations);
+    memset(&event, 0, sizeof(event));
+    event.data.fd = handle;
+    if (want & ASYNC_WANT_READ) {
+        event.events |= EPOLLIN;
+    }
+    if (want & ASYNC_WANT_WRITE) {
+        event.events |= EPOLLOUT;
+    }
+    if (want & ASYNC_WANT_HUP) {
+        event.events |= EPOLLRDHUP;
+    }
+    if (ctx->edge_triggered) {
+        event.events |= EPOLLET;
     }
 
-    /* free context */
-    free(ctx);
+    rc = epoll_ctl(ctx->epoll_fd, state->armed ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                   handle, &event);
+    if (rc != 0 && errno == ENOENT) {
+        rc = epoll_ctl(ctx->epoll_fd, EPOLL_CTL_ADD, handle, &event);
+    } else if (rc != 0 && errno == EEXIST) {
+        rc = epoll_ctl(ctx->epoll_fd, EPOLL_CTL_MOD, handle, &event);
+    }
+    if (rc != 0) {
+        return -1;
+    }
+
+    if (ctx->edge_triggered && !state->armed) {
+        /* unknown until tried; the first attempt will tell */
+        state->ready = ASYNC_WANT_READ | ASYNC_WANT_WRITE;
+    }
+
+    state->armed = want;
+    return 0;
+}
+
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+
+/*
+
+         convert_kqueue_to_events()
+	       ---
+	       converts kqueue kevent to generic event types.
+
+*/
+
+static unsigned int convert_kqueue_to_events(const struct kevent* event) {
+
+    unsigned int events = 0;
+
+    if (event->filter == EVFILT_READ) {
+        events |= COMMC_ASYNC_EVENT_READ | COMMC_ASYNC_EVENT_ACCEPT;
+    }
+    if (event->filter == EVFILT_WRITE) {
+        events |= COMMC_ASYNC_EVENT_WRITE | COMMC_ASYNC_EVENT_CONNECT;
+    }
+    if (event->flags & EV_EOF) {
+        events |= COMMC_ASYNC_EVENT_CLOSE;
+    }
+    if (event->flags & EV_ERROR) {
+        events |= COMMC_ASYNC_EVENT_ERROR;
+    }
+
+    return events;
+}
+
+/*
+
+         reactor_update()
+	       ---
+	       adds or deletes the read and write filters so the
+	       kernel watches exactly 'want' on a handle. EOF is
+	       always reported on the read filter.
+
+*/
+
+static int reactor_update(commc_async_context_t* ctx,
+                         int handle,
+                         struct commc_async_fd_state_t* state,
+                         unsigned int want) {
+
+    struct kevent  changes[2];
+    int            change_count = 0;
+    unsigned int   changed;
+    unsigned short flags = EV_ADD | EV_ENABLE;
+
+    if (want & ASYNC_WANT_HUP) {
+        want |= ASYNC_WANT_READ;
+    }
+
+    /* edge mode: both filters added once with EV_CLEAR, never narrowed */
+    if (ctx->edge_triggered && want != 0) {
+        if (state->armed) {
+            return 0;
+        }
+        want = ASYNC_WANT_READ | ASYNC_WANT_WRITE | ASYNC_WANT_HUP;
+        flags |= EV_CLEAR;
+    }
+
+    changed = want ^ state->armed;
+
+    if (changed & ASYNC_WANT_READ) {
+        EV_SET(&changes[change_count++], handle, EVFILT_READ,
+               (want & ASYNC_WANT_READ) ? flags : EV_DELETE,
+               0, 0, NULL);
+    }
+    if (changed & ASYNC_WANT_WRITE) {
+        EV_SET(&changes[change_count++], handle, EVFILT_WRITE,
+               (want & ASYNC_WANT_WRITE) ? flags : EV_DELETE,
+               0, 0, NULL);
+    }
+
+    if (change_count > 0 &&
+        kevent(ctx->kqueue_fd, changes, change_count, NULL, 0, NULL) == -1 &&
+        (want & ~state->armed) != 0) {
+        return -1;
+    }
+
+    if (ctx->edge_triggered && !state->armed) {
+        state->ready = ASYNC_WANT_READ | ASYNC_WANT_WRITE;
+    }
+
+    state->armed = want;
+    return 0;
+}
+
+#endif
+
+#endif /* !_WIN32 */
+
+/*
+	==================================
+             --- HELPER THREADS ---
+	==================================
+*/
+
+/*
+
+         offload_task()
+	       ---
+	       runs one blocking operation on a helper thread.
+	       on unix the result goes back through a lock-free
+	       stack and the loop wakeup; on windows it is
+	       delivered right here, as IOCP completions are.
+
+*/
+
+static void offload_task(void* arg) {
+
+    commc_async_operation_t* op = (commc_async_operation_t*)arg;
+    commc_async_context_t*   ctx = (commc_async_context_t*)op->owner;
+    size_t                   bytes = 0;
+    int                      error_code = 0;
+#ifndef _WIN32
+    commc_async_operation_t* head;
+#endif
+
+    if (COMMC_ATOMIC_LOAD_ACQUIRE(&op->cancelled)) {
+        error_code = ASYNC_CANCELLED;
+
+    } else if (op->type == COMMC_ASYNC_OP_WORK) {
+        error_code = op->work(op->buffer, &bytes);
+
+    } else if (op->type == COMMC_ASYNC_OP_FSYNC) {
+#ifdef _WIN32
+        if (!FlushFileBuffers((HANDLE)op->handle)) {
+            error_code = (int)GetLastError();
+        }
+#else
+        while (fsync(op->handle) != 0) {
+            if (errno != EINTR) {
+                error_code = errno;
+                break;
+            }
+        }
+#endif
+
+    } else {
+#ifndef _WIN32
+        /* regular files never report EAGAIN */
+        if (!reactor_attempt(op, &bytes, &error_code)) {
+            error_code = EAGAIN;
+        }
+#endif
+    }
+
+#ifdef _WIN32
+    deliver_result(ctx, op, bytes, error_code);
+    remove_operation(ctx, op);
+    commc_async_operation_destroy(op);
+
+#else
+    op->transferred = bytes;
+    op->error_code = error_code;
+
+    do {
+        head = (commc_async_operation_t*)ASYNC_LOAD_PTR((void**)&ctx->offloaded);
+        op->next = head;
+    } while (!ASYNC_CAS_PTR((void**)&ctx->offloaded, (void*)head, (void*)op));
+
+    if (!head) {
+        signal_wakeup(ctx);
+    }
+#endif
+}
+
+/*
+
+         offload_submit()
+	       ---
+	       hands an operation to the helper pool, starting
+	       the pool on first use.
+
+*/
+
+static int offload_submit(commc_async_context_t* ctx,
+                         commc_async_operation_t* op) {
+
+    if (!ctx->helpers) {
+        ctx->helpers = commc_threadpool_create(ctx->helper_count ? ctx->helper_count
+                                                                 : COMMC_ASYNC_HELPER_THREADS);
+        if (!ctx->helpers) {
+            return -1;
+        }
+    }
+
+    op->owner = ctx;
+    op->stage = ASYNC_STAGE_OFFLOAD;
+
+    if (commc_threadpool_submit(ctx->helpers, offload_task, op) != COMMC_SUCCESS) {
+        op->stage = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+
+         offload_cancel()
+	       ---
+	       flags offloaded operations on handle (all of them
+	       for -1). those not yet started are skipped by the
+	       helper; a running call is never interrupted.
+
+*/
+
+static void offload_cancel(commc_async_context_t* ctx, int handle) {
+
+    commc_async_operation_t* op;
+    size_t                   i;
+
+    if (!ctx->helpers) {
+        return;
+    }
+
+    for (i = 0; i < ctx->operation_count; i++) {
+        op = (commc_async_operation_t*)ctx->operations[i];
+        if (op->stage == ASYNC_STAGE_OFFLOAD && (handle == -1 || op->handle == handle)) {
+            COMMC_ATOMIC_STORE_RELEASE(&op->cancelled, 1);
+        }
+    }
+}
+
+/*
+
+         offload_shutdown()
+	       ---
+	       cancels what has not started and joins the pool.
+	       on unix the finished operations stay on the stack
+	       for the caller to drop.
+
+*/
+
+static void offload_shutdown(commc_async_context_t* ctx) {
+
+    if (!ctx->helpers) {
+        return;
+    }
+
+    offload_cancel(ctx, -1);
+    commc_threadpool_destroy(ctx->helpers);
+    ctx->helpers = NULL;
+}
+
+#ifndef _WIN32
+
+/*
+
+         run_offloaded()
+	       ---
+	       completes operations finished by the helpers, in
+	       the order they finished.
+
+*/
+
+static int run_offloaded(commc_async_context_t* ctx) {
+
+    commc_async_operation_t* op;
+    commc_async_operation_t* next;
+    commc_async_operation_t* list = NULL;
+    int                      count = 0;
+
+    if (!ASYNC_LOAD_PTR((void**)&ctx->offloaded)) {
+        return 0;
+    }
+
+    op = (commc_async_operation_t*)ASYNC_EXCHANGE_PTR((void**)&ctx->offloaded, NULL);
+
+    while (op) {
+        next = op->next;
+        op->next = list;
+        list = op;
+        op = next;
+    }
+
+    while (list) {
+        op = list;
+        list = op->next;
+        op->stage = ASYNC_STAGE_DONE;
+        complete_operation(ctx, op, op->transferred, op->error_code);
+        count++;
+    }
+
+    return count;
+}
+
+/*
+
+         file_submit()
+	       ---
+	       regular files are always "ready" to epoll and
+	       kqueue, so their I/O goes to a helper thread. if
+	       the pool cannot start it runs inline at the next
+	       poll as before.
+
+*/
+
+static void file_submit(commc_async_context_t* ctx,
+                       commc_async_operation_t* op) {
+
+    if (offload_submit(ctx, op) != 0) {
+        ready_push(ctx, op);
+    }
+}
+
+#endif /* !_WIN32 */
+
+#ifndef _WIN32
+
+/*
+
+         backlog_push()
+	       ---
+	       edge mode: remembers a handle whose ready side
+	       still has queued operations after the drain limit.
+	       no new edge will come for it, so the next poll
+	       continues the drain without waiting.
+
+*/
+
+static void backlog_push(commc_async_context_t* ctx, int handle) {
+
+    struct commc_async_fd_state_t* state = &ctx->fd_states[handle];
+
+    if (state->in_backlog) {
+        return;
+    }
+
+    state->in_backlog = 1;
+    state->backlog_next = ctx->edge_backlog;
+    ctx->edge_backlog = handle;
+}
+
+/*
+
+         reactor_submit_edge()
+	       ---
+	       edge mode submit: while a side is known ready the
+	       operation is tried at once; only EAGAIN sends it
+	       to wait for the next edge.
+
+*/
+
+static int reactor_submit_edge(commc_async_context_t* ctx,
+                              commc_async_operation_t* op,
+                              unsigned int need) {
+
+    struct commc_async_fd_state_t* state;
+    commc_async_operation_t*       queued;
+    size_t                         bytes;
+    int                            error_code;
+
+    if (op->type == COMMC_ASYNC_OP_CONNECT) {
+
+        /* register only after connect() so no stale edge fires */
+        if (connect(op->handle, (const struct sockaddr*)op->address,
+                    (socklen_t)op->address_size) == 0) {
+            finish_early(ctx, op, 0, 0);
+            return 0;
+        }
+        if (errno != EINPROGRESS && errno != EINTR) {
+            finish_early(ctx, op, 0, errno);
+            return 0;
+        }
+    }
+
+    state = &ctx->fd_states[op->handle];
+
+    if (!state->armed && reactor_update(ctx, op->handle, state, need) != 0) {
+        if (errno == EPERM) {
+            state->kind = ASYNC_FD_KIND_FILE;
+            file_submit(ctx, op);
+            return 0;
+        }
+        return -1;
+    }
+
+    queued = (need == ASYNC_WANT_WRITE) ? state->write_head : state->read_head;
+
+    if (op->type == COMMC_ASYNC_OP_CONNECT) {
+        state->ready &= ~ASYNC_WANT_WRITE;
+    } else if ((state->ready & need) && !queued) {
+        if (reactor_attempt(op, &bytes, &error_code)) {
+            edge_note_transfer(state, op, bytes, need);
+            finish_early(ctx, op, bytes, error_code);
+            return 0;
+        }
+        state->ready &= ~need;
+    }
+
+    if (need == ASYNC_WANT_WRITE) {
+        queue_push(&state->write_head, &state->write_tail, op);
+    } else {
+        queue_push(&state->read_head, &state->read_tail, op);
+    }
+
+    return 0;
+}
+
+/*
+
+         reactor_submit()
+	       ---
+	       queues an operation on its handle and arms the
+	       matching interest. writes are tried immediately,
+	       since sockets are usually writable.
+
+*/
+
+static int reactor_submit(commc_async_context_t* ctx,
+                         commc_async_operation_t* op) {
+
+    struct commc_async_fd_state_t* state;
+    size_t                         bytes;
+    int                            error_code;
+    int                            write_side;
+    unsigned int                   need;
+
+    if (op->type == COMMC_ASYNC_OP_WORK || op->type == COMMC_ASYNC_OP_FSYNC) {
+        return offload_submit(ctx, op);
+    }
+
+    state = get_fd_state(ctx, op->handle);
+    if (!state) {
+        return -1;
+    }
+
+    /* a connecting socket is new, even if its number is not */
+    if (op->type == COMMC_ASYNC_OP_CONNECT) {
+        forget_handle(ctx, op->handle);
+    }
+
+    if (state->kind == ASYNC_FD_KIND_UNKNOWN &&
+        classify_handle(state, op->handle) == ASYNC_FD_KIND_POLLABLE) {
+        set_nonblocking(op->handle);
+    }
+
+    if (state->kind == ASYNC_FD_KIND_FILE) {
+        file_submit(ctx, op);
+        return 0;
+    }
+
+    write_side = op_is_write_side(op);
+
+    if (ctx->edge_triggered) {
+        return reactor_submit_edge(ctx, op, write_side ? ASYNC_WANT_WRITE : ASYNC_WANT_READ);
+    }
+
+    if (op->type == COMMC_ASYNC_OP_CONNECT) {
+        if (connect(op->handle, (const struct sockaddr*)op->address,
+                    (socklen_t)op->address_size) == 0) {
+            finish_early(ctx, op, 0, 0);
+            return 0;
+        }
+        if (errno != EINPROGRESS && errno != EINTR) {
+            finish_early(ctx, op, 0, errno);
+            return 0;
+        }
+    } else if (write_side && !state->write_head &&
+               reactor_attempt(op, &bytes, &error_code)) {
+        finish_early(ctx, op, bytes, error_code);
+        return 0;
+    }
+
+    need = write_side ? ASYNC_WANT_WRITE : ASYNC_WANT_READ;
+
+    if (!(state->armed & need) &&
+        reactor_update(ctx, op->handle, state,
+                       state->armed | reactor_wanted(state) | need) != 0) {
+        if (errno == EPERM) {
+            /* not pollable after all: treat like a regular file */
+            state->kind = ASYNC_FD_KIND_FILE;
+            file_submit(ctx, op);
+            return 0;
+        }
+        return -1;
+    }
+
+    if (write_side) {
+        queue_push(&state->write_head, &state->write_tail, op);
+    } else {
+        queue_push(&state->read_head, &state->read_tail, op);
+    }
+
+    return 0;
+}
+
+/*
+
+         reactor_run_queue()
+	       ---
+	       completes queued operations of one side of a
+	       handle until one would block.
+
+*/
+
+static int reactor_run_queue(commc_async_context_t* ctx,
+                            int handle,
+                            int write_side) {
+
+    struct commc_async_fd_state_t* state;
+    commc_async_operation_t*       op;
+    size_t                         bytes;
+    int                            error_code;
+    int                            count = 0;
+
+    while (count < ASYNC_DRAIN_LIMIT) {
+
+        state = &ctx->fd_states[handle];
+        op = write_side ? state->write_head : state->read_head;
+
+        if (!op) {
+            break;
+        }
+
+        if (!reactor_attempt(op, &bytes, &error_code)) {
+            /* drained: edge mode waits for the next edge on this side */
+            state->ready &= write_side ? ~ASYNC_WANT_WRITE : ~ASYNC_WANT_READ;
+            break;
+        }
+
+        if (ctx->edge_triggered) {
+            edge_note_transfer(state, op, bytes,
+                               write_side ? ASYNC_WANT_WRITE : ASYNC_WANT_READ);
+        }
+
+        if (write_side) {
+            state->write_head = op->next;
+            if (!state->write_head) {
+                state->write_tail = NULL;
+            }
+        } else {
+            state->read_head = op->next;
+            if (!state->read_head) {
+                state->read_tail = NULL;
+            }
+        }
+
+        complete_operation(ctx, op, bytes, error_code);
+        count++;
+    }
+
+    return count;
+}
+
+/*
+
+         reactor_dispatch()
+	       ---
+	       handles one readiness event: drains the ready
+	       sides, notifies watchers, and drops interest that
+	       woke us up without anything to do.
+
+*/
+
+static int reactor_dispatch(commc_async_context_t* ctx,
+                           int handle,
+                           unsigned int sides,
+                           unsigned int events) {
+
+    struct commc_async_fd_state_t* state;
+    unsigned int                   idle;
+    unsigned int                   want;
+    unsigned int                   fired;
+    int                            count = 0;
+
+    if (handle < 0 || handle >= ctx->fd_state_count) {
+        return 0;
+    }
+
+    state = &ctx->fd_states[handle];
+    idle = sides & ~reactor_wanted(state);
+
+    if (ctx->edge_triggered) {
+        state->ready |= sides & (ASYNC_WANT_READ | ASYNC_WANT_WRITE);
+    }
+
+    if ((sides & ASYNC_WANT_READ) && state->read_head) {
+        count += reactor_run_queue(ctx, handle, 0);
+    }
+
+    state = &ctx->fd_states[handle];
+    if ((sides & ASYNC_WANT_WRITE) && state->write_head) {
+        count += reactor_run_queue(ctx, handle, 1);
+    }
+
+    state = &ctx->fd_states[handle];
+    fired = state->watch & events;
+    if (fired) {
+        /* cleared first, so the callback can re-arm with modify_events() */
+        if (state->watch & COMMC_ASYNC_EVENT_ONESHOT) {
+            state->watch = 0;
+            idle |= sides;
+        }
+        deliver_notification(ctx, handle, fired);
+        count++;
+    }
+
+    if (ctx->edge_triggered) {
+        state = &ctx->fd_states[handle];
+        if (((state->ready & ASYNC_WANT_READ) && state->read_head) ||
+            ((state->ready & ASYNC_WANT_WRITE) && state->write_head)) {
+            backlog_push(ctx, handle);
+        }
+        return count;
+    }
+
+    if (idle) {
+        state = &ctx->fd_states[handle];
+        want = reactor_wanted(state);
+        if (state->armed & ~want) {
+            reactor_update(ctx, handle, state, want);
+        }
+    }
+
+    return count;
+}
+
+/*
+
+         run_backlog()
+	       ---
+	       edge mode: continues the drains cut short by the
+	       drain limit during the previous poll.
+
+*/
+
+static int run_backlog(commc_async_context_t* ctx) {
+
+    struct commc_async_fd_state_t* state;
+    int                            handle;
+    int                            next;
+    int                            count = 0;
+
+    handle = ctx->edge_backlog;
+    ctx->edge_backlog = -1;
+
+    while (handle != -1) {
+        state = &ctx->fd_states[handle];
+        next = state->backlog_next;
+        state->in_backlog = 0;
+        count += reactor_dispatch(ctx, handle, state->ready, 0);
+        handle = next;
+    }
+
+    return count;
+}
+
+/*
+
+         reactor_poll()
+	       ---
+	       waits for readiness and dispatches it, then runs
+	       the ready list. does not block while completions
+	       are already waiting there.
+
+*/
+
+static int reactor_poll(commc_async_context_t* ctx, int timeout_ms) {
+
+    unsigned int sides;
+    int          count = 0;
+    int          nfds;
+    int          i;
+
+#if defined(__linux__)
+    unsigned int flags;
+
+    nfds = epoll_wait(ctx->epoll_fd, ctx->events, ctx->max_events,
+                      (ctx->ready_head || ctx->edge_backlog != -1) ? 0 : timeout_ms);
+    if (nfds == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+        nfds = 0;
+    }
+
+    for (i = 0; i < nfds; i++) {
+
+        if (ctx->events[i].data.fd == ctx->wake_fd) {
+            drain_wakeup(ctx);
+            continue;
+        }
+
+        flags = ctx->events[i].events;
+        sides = 0;
+
+        if (flags & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+            sides |= ASYNC_WANT_READ;
+        }
+        if (flags & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+            sides |= ASYNC_WANT_WRITE;
+        }
+
+        count += reactor_dispatch(ctx, ctx->events[i].data.fd, sides,
+                                  convert_epoll_to_events(flags));
+    }
+
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+    struct timespec  timeout;
+    struct timespec* timeout_ptr = NULL;
+
+    if (ctx->ready_head || ctx->edge_backlog != -1) {
+        timeout_ms = 0;
+    }
+    if (timeout_ms >= 0) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        timeout_ptr = &timeout;
+    }
+
+    nfds = kevent(ctx->kqueue_fd, NULL, 0, ctx->events, ctx->max_events, timeout_ptr);
+    if (nfds == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+        nfds = 0;
+    }
+
+    for (i = 0; i < nfds; i++) {
+
+        /* EVFILT_USER wakeups clear themselves (EV_CLEAR) */
+        if (ctx->events[i].filter == EVFILT_USER) {
+            continue;
+        }
+
+        sides = (ctx->events[i].filter == EVFILT_WRITE) ? ASYNC_WANT_WRITE
+                                                        : ASYNC_WANT_READ;
+
+        count += reactor_dispatch(ctx, (int)ctx->events[i].ident, sides,
+                                  convert_kqueue_to_events(&ctx->events[i]));
+    }
+#endif
+
+    if (ctx->edge_backlog != -1) {
+        count += run_backlog(ctx);
+    }
+
+    count += run_ready_list(ctx);
+    return count;
+}
+
+/*
+
+         reactor_cancel()
+	       ---
+	       completes every queued or ready operation on a
+	       handle with ECANCELED.
+
+*/
+
+static int reactor_cancel(commc_async_context_t* ctx, int handle) {
+
+    struct commc_async_fd_state_t* state;
+    commc_async_operation_t*       victims = NULL;
+    commc_async_operation_t*       op;
+    commc_async_operation_t*       next;
+    commc_async_operation_t*       keep_head = NULL;
+    commc_async_operation_t*       keep_tail = NULL;
+
+    /* detach everything first: callbacks may queue new work */
+
+    if (handle < ctx->fd_state_count) {
+
+        state = &ctx->fd_states[handle];
+
+        if (state->write_tail) {
+            state->write_tail->next = victims;
+            victims = state->write_head;
+        }
+        if (state->read_tail) {
+            state->read_tail->next = victims;
+            victims = state->read_head;
+        }
+
+        state->read_head = state->read_tail = NULL;
+        state->write_head = state->write_tail = NULL;
+    }
+
+    for (op = ctx->ready_head; op; op = next) {
+        next = op->next;
+        if (op->handle == handle) {
+            op->next = victims;
+            victims = op;
+        } else {
+            queue_push(&keep_head, &keep_tail, op);
+        }
+    }
+
+    ctx->ready_head = keep_head;
+    ctx->ready_tail = keep_tail;
+
+    while (victims) {
+        op = victims;
+        victims = op->next;
+        complete_operation(ctx, op, 0, ECANCELED);
+    }
+
+    return 0;
+}
+
+#endif /* !_WIN32 */
+
+#ifdef COMMC_ASYNC_HAVE_URING
+
+/*
+
+         uring_destroy()
+	       ---
+	       unmaps the rings and closes the instance, which
+	       cancels anything still in flight, and the pipes.
+
+*/
+
+static void uring_destroy(struct commc_async_uring_t* ring) {
+
+    int i;
+
+    if (!ring) {
+        return;
+    }
+
+    if (ring->sqes && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring && ring->sq_ring != MAP_FAILED) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->ring_fd >= 0) {
+        close(ring->ring_fd);
+    }
+
+    for (i = 0; i < 2 * ring->pipe_count; i++) {
+        if (ring->pipe_fds[i] >= 0) {
+            close(ring->pipe_fds[i]);
+        }
+    }
+
+    free(ring->pipe_fds);
+    free(ring->pipe_free);
+    free(ring->batch);
+    free(ring);
+}
+
+/*
+
+         uring_create()
+	       ---
+	       sets up an io_uring instance with raw syscalls and
+	       maps its rings. returns NULL when the kernel lacks
+	       io_uring or IORING_FEAT_EXT_ARG (timed waits).
+
+*/
+
+static struct commc_async_uring_t* uring_create(unsigned int entries,
+                                               unsigned int batch_size) {
+
+    struct commc_async_uring_t* ring;
+    struct io_uring_params      params;
+    long                        fd;
+
+    memset(&params, 0, sizeof(params));
+
+    fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    ring = (struct commc_async_uring_t*)malloc(sizeof(*ring));
+    if (!ring) {
+        close((int)fd);
+        return NULL;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->ring_fd = (int)fd;
+
+    if (!(params.features & IORING_FEAT_EXT_ARG) ||
+        !(params.features & IORING_FEAT_NODROP)) {
+        uring_destroy(ring);
+        return NULL;
+    }
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        uring_destroy(ring);
+        return NULL;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            uring_destroy(ring);
+            return NULL;
+        }
+    }
+
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                                            IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        uring_destroy(ring);
+        return NULL;
+    }
+
+    ring->sq_head = (unsigned int*)((char*)ring->sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned int*)((char*)ring->sq_ring + params.sq_off.tail);
+    ring->sq_array = (unsigned int*)((char*)ring->sq_ring + params.sq_off.array);
+    ring->sq_mask = *(unsigned int*)((char*)ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_entries = *(unsigned int*)((char*)ring->sq_ring + params.sq_off.ring_entries);
+    ring->sq_local_tail = *ring->sq_tail;
+
+    ring->cq_head = (unsigned int*)((char*)ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned int*)((char*)ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = *(unsigned int*)((char*)ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)((char*)ring->cq_ring + params.cq_off.cqes);
+
+    ring->batch_size = batch_size;
+    ring->batch = (struct io_uring_cqe*)malloc(batch_size * sizeof(struct io_uring_cqe));
+    if (!ring->batch) {
+        uring_destroy(ring);
+        return NULL;
+    }
+
+    return ring;
+}
+
+/*
+
+         uring_enter()
+	       ---
+	       publishes filled SQEs and, if min_complete is set,
+	       waits up to timeout_ms (negative: forever) for
+	       completions in the same syscall.
+
+*/
+
+static int uring_enter(struct commc_async_uring_t* ring,
+                      unsigned int min_complete,
+                      int timeout_ms) {
+
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec      timeout;
+    unsigned int                  to_submit;
+    unsigned int                  flags = 0;
+    void*                         arg_ptr = NULL;
+    size_t                        arg_size = 0;
+    long                          rc;
+
+    COMMC_ATOMIC_STORE_RELEASE(ring->sq_tail, ring->sq_local_tail);
+    to_submit = ring->sq_local_tail - COMMC_ATOMIC_LOAD_ACQUIRE(ring->sq_head);
+
+    if (min_complete) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeout_ms >= 0) {
+            memset(&timeout, 0, sizeof(timeout));
+            memset(&arg, 0, sizeof(arg));
+            timeout.tv_sec = timeout_ms / 1000;
+            timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+            arg.ts = (__u64)(size_t)&timeout;
+            arg_ptr = &arg;
+            arg_size = sizeof(arg);
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+    }
+
+    if (to_submit == 0 && flags == 0) {
+        return 0;
+    }
+
+    rc = syscall(__NR_io_uring_enter, ring->ring_fd, to_submit, min_complete,
+                 flags, arg_ptr, arg_size);
+    if (rc < 0 && errno != ETIME && errno != EINTR &&
+        errno != EAGAIN && errno != EBUSY) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+
+         uring_get_sqe()
+	       ---
+	       claims the next submission slot, flushing the
+	       ring to the kernel first if it is full.
+
+*/
+
+static struct io_uring_sqe* uring_get_sqe(struct commc_async_uring_t* ring) {
+
+    struct io_uring_sqe* sqe;
+    unsigned int         index;
+
+    if (ring->sq_local_tail - COMMC_ATOMIC_LOAD_ACQUIRE(ring->sq_head) >= ring->sq_entries) {
+        uring_enter(ring, 0, 0);
+        if (ring->sq_local_tail - COMMC_ATOMIC_LOAD_ACQUIRE(ring->sq_head) >= ring->sq_entries) {
+            errno = EBUSY;
+            return NULL;
+        }
+    }
+
+    index = ring->sq_local_tail & ring->sq_mask;
+    sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+
+    return sqe;
+}
+
+/*
+
+         uring_acquire_pipe()
+	       ---
+	       assigns a cached splice pipe to a sendfile
+	       operation, creating one when none is free.
+
+*/
+
+static int uring_acquire_pipe(struct commc_async_uring_t* ring,
+                             commc_async_operation_t* op) {
+
+    int* fds;
+    int* free_slots;
+    int  slot;
+
+    if (ring->pipe_free_count > 0) {
+        slot = ring->pipe_free[--ring->pipe_free_count];
+    } else {
+        fds = (int*)realloc(ring->pipe_fds, 2 * (size_t)(ring->pipe_count + 1) * sizeof(int));
+        if (!fds) {
+            return -1;
+        }
+        ring->pipe_fds = fds;
+
+        free_slots = (int*)realloc(ring->pipe_free, (size_t)(ring->pipe_count + 1) * sizeof(int));
+        if (!free_slots) {
+            return -1;
+        }
+        ring->pipe_free = free_slots;
+
+        slot = ring->pipe_count++;
+        fds[2 * slot] = -1;
+        fds[2 * slot + 1] = -1;
+    }
+
+    if (ring->pipe_fds[2 * slot] < 0 && pipe2(&ring->pipe_fds[2 * slot], O_CLOEXEC) != 0) {
+        ring->pipe_fds[2 * slot] = -1;
+        ring->pipe_fds[2 * slot + 1] = -1;
+        ring->pipe_free[ring->pipe_free_count++] = slot;
+        return -1;
+    }
+
+    op->pipe_slot = slot;
+    return 0;
+}
+
+/*
+
+         uring_release_pipe()
+	       ---
+	       returns a sendfile operation's pipe to the cache.
+	       a pipe that may still hold data is closed and
+	       recreated on next use.
+
+*/
+
+static void uring_release_pipe(struct commc_async_uring_t* ring,
+                              commc_async_operation_t* op,
+                              int dirty) {
+
+    int slot = op->pipe_slot;
+
+    if (slot < 0) {
+        return;
+    }
+
+    if (dirty) {
+        close(ring->pipe_fds[2 * slot]);
+        close(ring->pipe_fds[2 * slot + 1]);
+        ring->pipe_fds[2 * slot] = -1;
+        ring->pipe_fds[2 * slot + 1] = -1;
+    }
+
+    ring->pipe_free[ring->pipe_free_count++] = slot;
+    op->pipe_slot = -1;
+}
+
+/*
+
+         uring_prepare()
+	       ---
+	       fills an SQE for the operation's current stage.
+	       the SQE reaches the kernel at the next poll.
+
+*/
+
+static int uring_prepare(commc_async_context_t* ctx,
+                        commc_async_operation_t* op) {
+
+    struct commc_async_uring_t* ring = ctx->uring;
+    struct io_uring_sqe*        sqe;
+    size_t                      size;
+
+    sqe = uring_get_sqe(ring);
+    if (!sqe) {
+        return -1;
+    }
+
+    sqe->user_data = (__u64)(size_t)op;
+    sqe->fd = op->handle;
+
+    size = op->buffer_size;
+    if (size > ASYNC_MAX_IO_SIZE) {
+        size = ASYNC_MAX_IO_SIZE;
+    }
+
+    if (op->stage & ASYNC_STAGE_POLL_WAIT) {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll32_events = op_is_write_side(op) ? EPOLLOUT : EPOLLIN;
+        return 0;
+    }
+
+    switch (op->type) {
+
+    case COMMC_ASYNC_OP_READ:
+    case COMMC_ASYNC_OP_WRITE:
+        sqe->opcode = (op->type == COMMC_ASYNC_OP_READ) ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->addr = (__u64)(size_t)op->buffer;
+        sqe->len = (__u32)size;
+        sqe->off = op->has_offset ? (__u64)op->offset : (__u64)-1;
+        break;
+
+    case COMMC_ASYNC_OP_RECV:
+    case COMMC_ASYNC_OP_SEND:
+        sqe->opcode = (op->type == COMMC_ASYNC_OP_RECV) ? IORING_OP_RECV : IORING_OP_SEND;
+        sqe->addr = (__u64)(size_t)op->buffer;
+        sqe->len = (__u32)size;
+        sqe->msg_flags = (op->type == COMMC_ASYNC_OP_SEND) ? MSG_NOSIGNAL : 0;
+        break;
+
+    case COMMC_ASYNC_OP_ACCEPT:
+        sqe->opcode = IORING_OP_ACCEPT;
+        if (op->address) {
+            sqe->addr = (__u64)(size_t)op->address;
+            sqe->addr2 = (__u64)(size_t)&op->address_length;
+        }
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        break;
+
+    case COMMC_ASYNC_OP_CONNECT:
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->addr = (__u64)(size_t)op->address;
+        sqe->off = (__u64)op->address_size;
+        break;
+
+    case COMMC_ASYNC_OP_SENDFILE:
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->splice_flags = SPLICE_F_MOVE;
+        if (op->stage == ASYNC_STAGE_SPLICE_IN) {
+            size = op->buffer_size - op->transferred;
+            if (size > ASYNC_SPLICE_CHUNK) {
+                size = ASYNC_SPLICE_CHUNK;
+            }
+            sqe->splice_fd_in = op->source_handle;
+            sqe->splice_off_in = (__u64)(op->offset + op->transferred);
+            sqe->fd = ring->pipe_fds[2 * op->pipe_slot + 1];
+            sqe->off = (__u64)-1;
+            sqe->len = (__u32)size;
+        } else {
+            sqe->splice_fd_in = ring->pipe_fds[2 * op->pipe_slot];
+            sqe->splice_off_in = (__u64)-1;
+            sqe->off = (__u64)-1;
+            sqe->len = (__u32)op->staged;
+        }
+        break;
+
+    case COMMC_ASYNC_OP_POLL:
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll32_events = op->watch_events;
+        break;
+
+    case COMMC_ASYNC_OP_FSYNC:
+        sqe->opcode = IORING_OP_FSYNC;
+        break;
+
+    default:
+        /* unreachable: submit validates the type */
+        sqe->opcode = IORING_OP_NOP;
+        break;
+    }
+
+    return 0;
+}
+
+/*
+
+         uring_arm_wakeup()
+	       ---
+	       polls the wakeup eventfd. re-armed by the next
+	       uring_poll() once it fires, or if the ring was too
+	       full to take it.
+
+*/
+
+static void uring_arm_wakeup(commc_async_context_t* ctx) {
+
+    struct io_uring_sqe* sqe;
+
+    sqe = uring_get_sqe(ctx->uring);
+    if (!sqe) {
+        return;
+    }
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = ctx->wake_fd;
+    sqe->poll32_events = EPOLLIN;
+    sqe->user_data = ASYNC_URING_WAKE;
+    ctx->uring->wake_armed = 1;
+}
+
+/*
+
+         uring_cancel_operation()
+	       ---
+	       asks the kernel to cancel an in-flight operation.
+	       its CQE (-ECANCELED, or the real result if it won
+	       the race) still arrives and frees it.
+
+*/
+
+static void uring_cancel_operation(commc_async_context_t* ctx,
+                                  commc_async_operation_t* op) {
+
+    struct io_uring_sqe* sqe;
+
+    /* offloaded work is flagged by offload_cancel() instead */
+    if (op->cancelled || op->stage == ASYNC_STAGE_DONE ||
+        op->stage == ASYNC_STAGE_OFFLOAD) {
+        return;
+    }
+
+    sqe = uring_get_sqe(ctx->uring);
+    if (!sqe) {
+        return;
+    }
+
+    op->cancelled = 1;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (__u64)(size_t)op;
+    sqe->user_data = 0;
+}
+
+/*
+
+         uring_continue()
+	       ---
+	       queues the next SQE of a multi-step operation,
+	       failing it if the ring is exhausted.
+
+*/
+
+static int uring_continue(commc_async_context_t* ctx,
+                         commc_async_operation_t* op) {
+
+    if (uring_prepare(ctx, op) == 0) {
+        return 0;
+    }
+
+    uring_release_pipe(ctx->uring, op, 1);
+    complete_operation(ctx, op, op->transferred, EBUSY);
+    return 1;
+}
+
+/*
+
+         uring_sendfile_step()
+	       ---
+	       advances a sendfile operation after one of its
+	       splices completed.
+
+*/
+
+static int uring_sendfile_step(commc_async_context_t* ctx,
+                              commc_async_operation_t* op,
+                              int res) {
+
+    struct commc_async_uring_t* ring = ctx->uring;
+
+    if (res < 0 || (res == 0 && op->stage == ASYNC_STAGE_SPLICE_OUT)) {
+        uring_release_pipe(ring, op, op->staged > 0);
+        complete_operation(ctx, op, op->transferred,
+                           op->cancelled ? ECANCELED : (res < 0 ? -res : EPIPE));
+        return 1;
+    }
+
+    if (op->stage == ASYNC_STAGE_SPLICE_IN) {
+        if (res == 0) {
+            /* end of file */
+            uring_release_pipe(ring, op, 0);
+            complete_operation(ctx, op, op->transferred, 0);
+            return 1;
+        }
+        op->staged = (size_t)res;
+        op->stage = ASYNC_STAGE_SPLICE_OUT;
+        return uring_continue(ctx, op);
+    }
+
+    op->staged -= (size_t)res;
+    op->transferred += (size_t)res;
+
+    if (op->staged == 0) {
+        if (op->transferred >= op->buffer_size || op->cancelled) {
+            uring_release_pipe(ring, op, 0);
+            complete_operation(ctx, op, op->transferred,
+                               op->transferred >= op->buffer_size ? 0 : ECANCELED);
+            return 1;
+        }
+        op->stage = ASYNC_STAGE_SPLICE_IN;
+    }
+
+    return uring_continue(ctx, op);
+}
+
+/*
+
+         uring_watch_event()
+	       ---
+	       delivers a readiness notification for a watched
+	       handle and re-arms the one-shot poll while the
+	       handle stays watched.
+
+*/
+
+static int uring_watch_event(commc_async_context_t* ctx,
+                            commc_async_operation_t* op,
+                            int res) {
+
+    struct commc_async_fd_state_t* state;
+    int                            handle = op->handle;
+    int                            cancelled = op->cancelled;
+
+    if (!cancelled) {
+
+        /* a one-shot watch ends here; the callback may arm a new one */
+        state = (handle < ctx->fd_state_count) ? &ctx->fd_states[handle] : NULL;
+        if (state && state->watch_op == op && (state->watch & COMMC_ASYNC_EVENT_ONESHOT)) {
+            state->watch = 0;
+            state->watch_op = NULL;
+        }
+
+        if (res < 0) {
+            deliver_notification(ctx, handle, COMMC_ASYNC_EVENT_ERROR);
+        } else {
+            deliver_notification(ctx, handle, convert_epoll_to_events((unsigned int)res));
+        }
+
+        state = (handle < ctx->fd_state_count) ? &ctx->fd_states[handle] : NULL;
+        if (res >= 0 && state && state->watch_op == op && !op->cancelled &&
+            uring_prepare(ctx, op) == 0) {
+            return 1;
+        }
+        if (state && state->watch_op == op) {
+            state->watch_op = NULL;
+        }
+    }
+
+    remove_operation(ctx, op);
+    ctx->uring->watch_ops--;
+    commc_async_operation_destroy(op);
+    return cancelled ? 0 : 1;
+}
+
+/*
+
+         uring_complete()
+	       ---
+	       handles one CQE. returns the number of callbacks
+	       it ran.
+
+*/
+
+static int uring_complete(commc_async_context_t* ctx,
+                         commc_async_operation_t* op,
+                         int res) {
+
+    int       socket_error;
+    socklen_t length;
+
+    if (op->type == COMMC_ASYNC_OP_POLL) {
+        return uring_watch_event(ctx, op, res);
+    }
+
+    if (op->cancelled && res == -ECANCELED) {
+        uring_release_pipe(ctx->uring, op, 1);
+        complete_operation(ctx, op, op->transferred, ECANCELED);
+        return 1;
+    }
+
+    if (op->stage & ASYNC_STAGE_POLL_WAIT) {
+
+        op->stage &= ~ASYNC_STAGE_POLL_WAIT;
+
+        if (res < 0) {
+            uring_release_pipe(ctx->uring, op, 1);
+            complete_operation(ctx, op, op->transferred, -res);
+            return 1;
+        }
+
+        if (op->type == COMMC_ASYNC_OP_CONNECT) {
+            socket_error = 0;
+            length = (socklen_t)sizeof(socket_error);
+            if (getsockopt(op->handle, SOL_SOCKET, SO_ERROR,
+                           &socket_error, &length) != 0) {
+                socket_error = errno;
+            }
+            complete_operation(ctx, op, 0, socket_error);
+            return 1;
+        }
+
+        return uring_continue(ctx, op);
+    }
+
+    /* a non-blocking handle the kernel would not wait on: poll, then retry */
+    if (res == -EAGAIN || res == -EINTR ||
+        (res == -EINPROGRESS && op->type == COMMC_ASYNC_OP_CONNECT)) {
+        if (res != -EINTR) {
+            op->stage |= ASYNC_STAGE_POLL_WAIT;
+        }
+        return uring_continue(ctx, op);
+    }
+
+    switch (op->type) {
+
+    case COMMC_ASYNC_OP_SENDFILE:
+        return uring_sendfile_step(ctx, op, res);
+
+    case COMMC_ASYNC_OP_ACCEPT:
+        if (res >= 0) {
+            if (op->result_handle) {
+                *op->result_handle = res;
+            }
+            complete_operation(ctx, op, op->address ? op->address_length : 0, 0);
+        } else {
+            complete_operation(ctx, op, 0, -res);
+        }
+        return 1;
+
+    case COMMC_ASYNC_OP_CONNECT:
+        complete_operation(ctx, op, 0, res < 0 ? -res : 0);
+        return 1;
+
+    default:
+        if (res < 0) {
+            complete_operation(ctx, op, 0, -res);
+        } else {
+            complete_operation(ctx, op, (size_t)res, 0);
+        }
+        return 1;
+    }
+}
+
+/*
+
+         uring_reap()
+	       ---
+	       drains the completion ring in batches. each batch
+	       is copied out and the head released before any
+	       callback runs, so callbacks may submit freely.
+
+*/
+
+static int uring_reap(commc_async_context_t* ctx) {
+
+    struct commc_async_uring_t* ring = ctx->uring;
+    commc_async_operation_t*    op;
+    unsigned int                head;
+    unsigned int                tail;
+    unsigned int                n;
+    unsigned int                i;
+    int                         rounds;
+    int                         count = 0;
+
+    for (rounds = 0; rounds < 4; rounds++) {
+
+        head = *ring->cq_head;
+        tail = COMMC_ATOMIC_LOAD_ACQUIRE(ring->cq_tail);
+        if (head == tail) {
+            break;
+        }
+
+        n = 0;
+        while (head != tail && n < ring->batch_size) {
+            ring->batch[n++] = ring->cqes[head & ring->cq_mask];
+            head++;
+        }
+        COMMC_ATOMIC_STORE_RELEASE(ring->cq_head, head);
+
+        for (i = 0; i < n; i++) {
+            if (ring->batch[i].user_data == ASYNC_URING_WAKE) {
+                drain_wakeup(ctx);
+                ring->wake_armed = 0;
+                continue;
+            }
+            op = (commc_async_operation_t*)(size_t)ring->batch[i].user_data;
+            if (op) {
+                count += uring_complete(ctx, op, ring->batch[i].res);
+            }
+        }
+    }
+
+    return count;
+}
+
+/*
+
+         uring_submit()
+	       ---
+	       starts an operation on the io_uring backend.
+
+*/
+
+static int uring_submit(commc_async_context_t* ctx,
+                       commc_async_operation_t* op) {
+
+    op->stage = 0;
+
+    if (op->type == COMMC_ASYNC_OP_WORK) {
+        return offload_submit(ctx, op);
+    }
+
+    if (op->type == COMMC_ASYNC_OP_SENDFILE) {
+        op->stage = ASYNC_STAGE_SPLICE_IN;
+        if (uring_acquire_pipe(ctx->uring, op) != 0) {
+            return -1;
+        }
+    }
+
+    if (uring_prepare(ctx, op) != 0) {
+        uring_release_pipe(ctx->uring, op, 0);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+
+         uring_watch()
+	       ---
+	       replaces the poll request of a watched handle
+	       according to its current watch mask.
+
+*/
+
+static int uring_watch(commc_async_context_t* ctx,
+                      int handle,
+                      struct commc_async_fd_state_t* state) {
+
+    commc_async_operation_t* op;
+    unsigned int             events = 0;
+
+    if (state->watch_op) {
+        uring_cancel_operation(ctx, state->watch_op);
+        state->watch_op = NULL;
+    }
+
+    if (state->watch & (COMMC_ASYNC_EVENT_READ | COMMC_ASYNC_EVENT_ACCEPT)) {
+        events |= EPOLLIN;
+    }
+    if (state->watch & (COMMC_ASYNC_EVENT_WRITE | COMMC_ASYNC_EVENT_CONNECT)) {
+        events |= EPOLLOUT;
+    }
+    if (state->watch & COMMC_ASYNC_EVENT_CLOSE) {
+        events |= EPOLLRDHUP;
+    }
+
+    if (events == 0) {
+        return 0;
+    }
+
+    op = commc_async_operation_create(COMMC_ASYNC_OP_POLL, handle, NULL, 0);
+    if (!op) {
+        return -1;
+    }
+
+    op->watch_events = events;
+
+    if (add_operation(ctx, op) != 0) {
+        commc_async_operation_destroy(op);
+        return -1;
+    }
+
+    if (uring_prepare(ctx, op) != 0) {
+        remove_operation(ctx, op);
+        commc_async_operation_destroy(op);
+        return -1;
+    }
+
+    ctx->uring->watch_ops++;
+    ctx->fd_states[handle].watch_op = op;
+    return 0;
+}
+
+/*
+
+         uring_poll()
+	       ---
+	       one io_uring_enter() submits everything queued
+	       since the last poll and waits for the first
+	       completion; then the completion ring is drained.
+
+*/
+
+static int uring_poll(commc_async_context_t* ctx, int timeout_ms) {
+
+    int count = 0;
+
+    if (!ctx->uring->wake_armed) {
+        uring_arm_wakeup(ctx);
+    }
+
+    if (uring_enter(ctx->uring, ctx->ready_head ? 0 : 1, timeout_ms) != 0) {
+        return -1;
+    }
+
+    count += uring_reap(ctx);
+    count += run_ready_list(ctx);
+    return count;
+}
+
+#endif /* COMMC_ASYNC_HAVE_URING */
+
+#ifndef _WIN32
+
+/*
+
+         watch_handle()
+	       ---
+	       records the events add_handle()/modify_events()
+	       asked for and (re)arms them with the backend.
+
+*/
+
+static int watch_handle(commc_async_context_t* ctx,
+                       int handle,
+                       commc_async_event_type_t events) {
+
+    struct commc_async_fd_state_t* state;
+
+    state = get_fd_state(ctx, handle);
+    if (!state) {
+        return -1;
+    }
+
+    state->kind = ASYNC_FD_KIND_POLLABLE;
+    state->watch = (unsigned int)events;
+
+#ifdef COMMC_ASYNC_HAVE_URING
+    if (ctx->uring) {
+        return uring_watch(ctx, handle, state);
+    }
+#endif
+
+    return reactor_update(ctx, handle, state, reactor_wanted(state));
+}
+
+/*
+
+         drop_operations()
+	       ---
+	       frees every operation without calling back. only
+	       safe once the kernel can no longer touch them.
+
+*/
+
+static void drop_operations(commc_async_context_t* ctx) {
+
+    size_t i;
+
+    for (i = 0; i < ctx->operation_count; i++) {
+        commc_async_operation_destroy((commc_async_operation_t*)ctx->operations[i]);
+    }
+
+    ctx->operation_count = 0;
+    ctx->ready_head = NULL;
+    ctx->ready_tail = NULL;
+    ctx->edge_backlog = -1;
+
+    free(ctx->fd_states);
+    ctx->fd_states = NULL;
+    ctx->fd_state_count = 0;
+}
+
+#endif /* !_WIN32 */
+
+/*
+	==================================
+             --- TIMERS ---
+	==================================
+*/
+
+/*
+
+         commc_async_timer_wheel_t
+	       ---
+	       hierarchical timing wheel with 1 ms ticks. a timer
+	       due in d ticks sits on the lowest level whose span
+	       (32^(level+1) ticks) exceeds d; when the wheel
+	       reaches the start of a higher-level slot, that slot
+	       is cascaded into the levels below. the occupancy
+	       bitmaps let the wheel jump straight to the next
+	       tick with work instead of stepping through idle
+	       milliseconds. ticks are the monotonic clock in ms,
+	       compared modulo ULONG_MAX + 1.
+
+*/
+
+struct commc_async_timer_wheel_t {
+    commc_async_timer_t slots[ASYNC_WHEEL_LEVELS][ASYNC_WHEEL_SLOTS]; /* LIST HEADS */
+    commc_async_timer_t due;                          /* FIRE AT THE NEXT RUN */
+    unsigned long       occupied[ASYNC_WHEEL_LEVELS]; /* NON-EMPTY SLOT BITMAPS */
+    unsigned long       current;                      /* LAST PROCESSED TICK */
+    size_t              count;                        /* ACTIVE TIMERS */
+};
+
+/*
+
+         async_now_ms()
+	       ---
+	       monotonic milliseconds, wrapping.
+
+*/
+
+static unsigned long async_now_ms(void) {
+
+#ifdef _WIN32
+    return (unsigned long)GetTickCount();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000UL + (unsigned long)(now.tv_nsec / 1000000L);
+#endif
+}
+
+/*
+
+         timer_list_init() / timer_list_append()
+	       ---
+	       circular lists with sentinel heads, so a timer
+	       unlinks itself without knowing its list.
+
+*/
+
+static void timer_list_init(commc_async_timer_t* head) {
+
+    head->next = head;
+    head->prev = head;
+}
+
+static void timer_list_append(commc_async_timer_t* head,
+                              commc_async_timer_t* timer) {
+
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+/*
+
+         timer_list_take()
+	       ---
+	       moves every timer of src onto the empty list dst
+	       and marks them off-wheel, so callbacks that stop
+	       one of them only touch dst.
+
+*/
+
+static void timer_list_take(commc_async_timer_t* dst,
+                            commc_async_timer_t* src) {
+
+    commc_async_timer_t* timer;
+
+    if (src->next == src) {
+        timer_list_init(dst);
+        return;
+    }
+
+    dst->next = src->next;
+    dst->prev = src->prev;
+    dst->next->prev = dst;
+    dst->prev->next = dst;
+    timer_list_init(src);
+
+    for (timer = dst->next; timer != dst; timer = timer->next) {
+        timer->level = -1;
+    }
+}
+
+/*
+
+         timer_unlink()
+	       ---
+	       removes a timer from whatever list holds it.
+
+*/
+
+static void timer_unlink(struct commc_async_timer_wheel_t* wheel,
+                         commc_async_timer_t* timer) {
+
+    commc_async_timer_t* head;
+
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+
+    if (timer->level >= 0) {
+        head = &wheel->slots[timer->level][timer->slot];
+        if (head->next == head) {
+            wheel->occupied[timer->level] &= ~(1UL << timer->slot);
+        }
+    }
+
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->level = -1;
+}
+
+/*
+
+         timer_insert()
+	       ---
+	       files a timer by its distance from the wheel's
+	       current tick. zero distance goes to the due list.
+
+*/
+
+static void timer_insert(struct commc_async_timer_wheel_t* wheel,
+                         commc_async_timer_t* timer) {
+
+    unsigned long delta;
+    int           level;
+    int           slot;
+
+    delta = timer->expires - wheel->current;
+
+    if (delta == 0 || delta > ASYNC_WHEEL_RANGE) {
+        timer->level = -1;
+        timer_list_append(&wheel->due, timer);
+        return;
+    }
+
+    for (level = 0; level < ASYNC_WHEEL_LEVELS - 1; level++) {
+        if (delta < (1UL << (ASYNC_WHEEL_BITS * (level + 1)))) {
+            break;
+        }
+    }
+
+    slot = (int)((timer->expires >> (ASYNC_WHEEL_BITS * level)) & (ASYNC_WHEEL_SLOTS - 1));
+
+    timer->level = level;
+    timer->slot = slot;
+    timer_list_append(&wheel->slots[level][slot], timer);
+    wheel->occupied[level] |= 1UL << slot;
+}
+
+/*
+
+         timer_arm()
+	       ---
+	       sets a timer to expire delta ticks after the
+	       wheel's current tick. distances beyond the wheel
+	       range are parked in 'remaining' and re-armed
+	       silently when the first stretch elapses.
+
+*/
+
+static void timer_arm(struct commc_async_timer_wheel_t* wheel,
+                      commc_async_timer_t* timer,
+                      unsigned long delta) {
+
+    timer->remaining = 0;
+
+    if (delta > ASYNC_WHEEL_RANGE) {
+        timer->remaining = delta - ASYNC_WHEEL_RANGE;
+        delta = ASYNC_WHEEL_RANGE;
+    }
+
+    timer->expires = wheel->current + delta;
+    timer_insert(wheel, timer);
+}
+
+/*
+
+         timer_next_event()
+	       ---
+	       ticks from the current one to the next tick that
+	       expires a level-0 slot or cascades a higher one,
+	       or ASYNC_WHEEL_NONE if the wheel is empty. the due
+	       list is not considered.
+
+*/
+
+static unsigned long timer_next_event(const struct commc_async_timer_wheel_t* wheel) {
+
+    unsigned long best = ASYNC_WHEEL_NONE;
+    unsigned long bits;
+    unsigned long index;
+    unsigned long delta;
+    unsigned long offset;
+    int           shift;
+    int           level;
+
+    for (level = 0; level < ASYNC_WHEEL_LEVELS; level++) {
+
+        bits = wheel->occupied[level];
+        if (!bits) {
+            continue;
+        }
+
+        shift = ASYNC_WHEEL_BITS * level;
+        index = wheel->current >> shift;
+
+        for (offset = 1; offset <= ASYNC_WHEEL_SLOTS; offset++) {
+            if (bits & (1UL << ((index + offset) & (ASYNC_WHEEL_SLOTS - 1)))) {
+                break;
+            }
+        }
+
+        delta = ((index + offset) << shift) - wheel->current;
+        if (delta < best) {
+            best = delta;
+        }
+    }
+
+    return best;
+}
+
+/*
+
+         timer_fire()
+	       ---
+	       expires one timer: re-arms periodic timers (once,
+	       counting missed periods) before calling back so
+	       the callback may stop or restart it.
+
+*/
+
+static int timer_fire(commc_async_context_t* ctx,
+                      commc_async_timer_t* timer,
+                      unsigned long now) {
+
+    struct commc_async_timer_wheel_t* wheel = ctx->timers;
+    commc_async_result_t              result;
+    unsigned long                     expirations = 1;
+    unsigned long                     late;
+
+    if (timer->remaining) {
+        timer_arm(wheel, timer, timer->remaining + (timer->expires - wheel->current));
+        return 0;
+    }
+
+    if (timer->period_ms) {
+        late = now - timer->expires;
+        if (late <= ASYNC_WHEEL_RANGE && late >= timer->period_ms) {
+            expirations += late / timer->period_ms;
+            timer->expires += (late / timer->period_ms) * timer->period_ms;
+        }
+        timer_arm(wheel, timer, (timer->expires - wheel->current) + timer->period_ms);
+    } else {
+        timer->active = 0;
+        wheel->count--;
+    }
+
+    memset(&result, 0, sizeof(result));
+    result.operation = COMMC_ASYNC_OP_TIMER;
+    result.handle = -1;
+    result.buffer = timer;
+    result.bytes_transferred = expirations;
+    result.user_data = timer->user_data;
+
+    if (timer->callback) {
+        timer->callback(&result);
+    } else {
+        deliver_default(ctx, &result);
+    }
+
+    return 1;
+}
+
+/*
+
+         timer_fire_list()
+	       ---
+	       fires every timer of a detached list.
+
+*/
+
+static int timer_fire_list(commc_async_context_t* ctx,
+                           commc_async_timer_t* list,
+                           unsigned long now) {
+
+    commc_async_timer_t* timer;
+    int                  count = 0;
+
+    while (list->next != list) {
+        timer = list->next;
+        timer_unlink(ctx->timers, timer);
+        count += timer_fire(ctx, timer, now);
+    }
+
+    return count;
+}
+
+/*
+
+         timer_process_tick()
+	       ---
+	       cascades the higher-level slots starting at the
+	       current tick, then expires its level-0 slot.
+
+*/
+
+static int timer_process_tick(commc_async_context_t* ctx, unsigned long now) {
+
+    struct commc_async_timer_wheel_t* wheel = ctx->timers;
+    commc_async_timer_t               list;
+    commc_async_timer_t*              timer;
+    unsigned long                     tick = wheel->current;
+    int                               level;
+    int                               top = 0;
+    int                               slot;
+
+    while (top + 1 < ASYNC_WHEEL_LEVELS &&
+           (tick & ((1UL << (ASYNC_WHEEL_BITS * (top + 1))) - 1)) == 0) {
+        top++;
+    }
+
+    for (level = top; level >= 1; level--) {
+
+        slot = (int)((tick >> (ASYNC_WHEEL_BITS * level)) & (ASYNC_WHEEL_SLOTS - 1));
+        if (!(wheel->occupied[level] & (1UL << slot))) {
+            continue;
+        }
+
+        wheel->occupied[level] &= ~(1UL << slot);
+        timer_list_take(&list, &wheel->slots[level][slot]);
+
+        while (list.next != &list) {
+            timer = list.next;
+            timer_unlink(wheel, timer);
+            timer_insert(wheel, timer);
+        }
+    }
+
+    slot = (int)(tick & (ASYNC_WHEEL_SLOTS - 1));
+    if (!(wheel->occupied[0] & (1UL << slot))) {
+        return 0;
+    }
+
+    wheel->occupied[0] &= ~(1UL << slot);
+    timer_list_take(&list, &wheel->slots[0][slot]);
+
+    return timer_fire_list(ctx, &list, now);
+}
+
+/*
+
+         run_timers()
+	       ---
+	       advances the wheel to the current time, firing
+	       what expired. timers made due by callbacks wait
+	       for the next poll, so a timer re-armed with 0 ms
+	       from its own callback cannot spin the loop.
+
+*/
+
+static int run_timers(commc_async_context_t* ctx) {
+
+    struct commc_async_timer_wheel_t* wheel = ctx->timers;
+    commc_async_timer_t               list;
+    unsigned long                     now;
+    unsigned long                     step;
+    int                               count = 0;
+
+    if (!wheel) {
+        return 0;
+    }
+
+    now = async_now_ms();
+
+    if (wheel->count == 0) {
+        wheel->current = now;
+        return 0;
+    }
+
+    while (wheel->current != now) {
+
+        /*
+           a callback that re-armed the last timer restarted
+           the emptied wheel at a later clock reading than
+           'now'; walking on would expire it early.
+        */
+        if (wheel->current - now <= ASYNC_WHEEL_RANGE) {
+            break;
+        }
+
+        step = timer_next_event(wheel);
+        if (step == ASYNC_WHEEL_NONE || step > now - wheel->current) {
+            wheel->current = now;
+            break;
+        }
+
+        wheel->current += step;
+        count += timer_process_tick(ctx, now);
+    }
+
+    timer_list_take(&list, &wheel->due);
+    count += timer_fire_list(ctx, &list, now);
+
+    return count;
+}
+
+/*
+
+         timers_wait()
+	       ---
+	       shortens a poll timeout so the wait ends at the
+	       next timer event.
+
+*/
+
+static int timers_wait(const commc_async_context_t* ctx, int timeout_ms) {
+
+    const struct commc_async_timer_wheel_t* wheel = ctx->timers;
+    unsigned long                           step;
+    unsigned long                           elapsed;
+
+    if (!wheel || wheel->count == 0) {
+        return timeout_ms;
+    }
+
+    if (wheel->due.next != &wheel->due) {
+        return 0;
+    }
+
+    step = timer_next_event(wheel);
+    if (step == ASYNC_WHEEL_NONE) {
+        return timeout_ms;
+    }
+
+    elapsed = async_now_ms() - wheel->current;
+    if (elapsed >= step) {
+        return 0;
+    }
+
+    step -= elapsed;
+    if (timeout_ms < 0 || step < (unsigned long)timeout_ms) {
+        return (int)step;
+    }
+
+    return timeout_ms;
+}
+
+/*
+
+         get_timer_wheel()
+	       ---
+	       returns the context's wheel, creating it on the
+	       first timer.
+
+*/
+
+static struct commc_async_timer_wheel_t* get_timer_wheel(commc_async_context_t* ctx) {
+
+    struct commc_async_timer_wheel_t* wheel;
+    int                               level;
+    int                               slot;
+
+    if (ctx->timers) {
+        return ctx->timers;
+    }
+
+    wheel = (struct commc_async_timer_wheel_t*)malloc(sizeof(*wheel));
+    if (!wheel) {
+        return NULL;
+    }
+
+    memset(wheel, 0, sizeof(*wheel));
+
+    for (level = 0; level < ASYNC_WHEEL_LEVELS; level++) {
+        for (slot = 0; slot < ASYNC_WHEEL_SLOTS; slot++) {
+            timer_list_init(&wheel->slots[level][slot]);
+        }
+    }
+
+    timer_list_init(&wheel->due);
+    wheel->current = async_now_ms();
+
+    ctx->timers = wheel;
+    return wheel;
+}
+
+/*
+	==================================
+             --- API ---
+	==================================
+*/
+
+/*
+
+         commc_async_context_create()
+	       ---
+	       creates new asynchronous I/O context on the
+	       best backend available.
+
+*/
+
+commc_async_context_t* commc_async_context_create(int max_events,
+                                                  int timeout_ms) {
+
+    return commc_async_context_create_with_backend(max_events, timeout_ms,
+                                                   COMMC_ASYNC_BACKEND_DEFAULT);
+}
+
+/*
+
+         commc_async_context_create_with_backend()
+	       ---
+	       creates new asynchronous I/O context on the
+	       requested backend.
+
+*/
+
+commc_async_context_t* commc_async_context_create_with_backend(int max_events,
+                                                               int timeout_ms,
+                                                               commc_async_backend_t backend) {
+
+    commc_async_context_t* ctx;
+#ifdef _WIN32
+    int                    i;
+    int                    j;
+#elif defined(__linux__)
+    struct epoll_event     wake_event;
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+    struct kevent          wake_event;
+#endif
+
+#if defined(_WIN32)
+    if (backend != COMMC_ASYNC_BACKEND_DEFAULT && backend != COMMC_ASYNC_BACKEND_IOCP) {
+        return NULL;
+    }
+#elif defined(__linux__)
+    if (backend != COMMC_ASYNC_BACKEND_DEFAULT && backend != COMMC_ASYNC_BACKEND_EPOLL &&
+        backend != COMMC_ASYNC_BACKEND_IO_URING) {
+        return NULL;
+    }
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+    if (backend != COMMC_ASYNC_BACKEND_DEFAULT && backend != COMMC_ASYNC_BACKEND_KQUEUE) {
+        return NULL;
+    }
+#endif
+
+    ctx = (commc_async_context_t*)malloc(sizeof(commc_async_context_t));
+    if (!ctx) {
+        return NULL;
+    }
+
+    /* initialize basic fields */
+    memset(ctx, 0, sizeof(commc_async_context_t));
+    ctx->is_running = 0;
+    ctx->max_events = (max_events > 0) ? max_events : COMMC_ASYNC_MAX_EVENTS;
+    ctx->timeout_ms = (timeout_ms >= 0) ? timeout_ms : COMMC_ASYNC_DEFAULT_TIMEOUT;
+    ctx->default_callback = NULL;
+    ctx->operations = NULL;
+    ctx->operation_count = 0;
+    ctx->operation_capacity = 0;
+#ifndef _WIN32
+    ctx->edge_backlog = -1;
+#endif
+
+#ifdef _WIN32
+    ctx->backend = COMMC_ASYNC_BACKEND_IOCP;
+
+    /* create I/O completion port */
+    ctx->completion_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE,
+                                                 NULL, 0, 0);
+    if (!ctx->completion_port) {
+        free(ctx);
+        return NULL;
+    }
+
+    ctx->wake_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (!ctx->wake_event) {
+        CloseHandle(ctx->completion_port);
+        free(ctx);
+        return NULL;
+    }
+
+    /* create worker threads */
+    ctx->thread_count = 4; /* default thread count */
+    ctx->threads = (HANDLE*)malloc(ctx->thread_count * sizeof(HANDLE));
+    if (!ctx->threads) {
+        CloseHandle(ctx->wake_event);
+        CloseHandle(ctx->completion_port);
+        free(ctx);
+        return NULL;
+    }
+
+    for (i = 0; i < ctx->thread_count; i++) {
+        ctx->threads[i] = CreateThread(NULL, 0, iocp_worker_thread,
+                                      ctx, 0, NULL);
+        if (!ctx->threads[i]) {
+            /* cleanup created threads */
+            for (j = 0; j < i; j++) {
+                CloseHandle(ctx->threads[j]);
+            }
+            free(ctx->threads);
+            CloseHandle(ctx->wake_event);
+            CloseHandle(ctx->completion_port);
+            free(ctx);
+            return NULL;
+        }
+    }
+
+#elif defined(__linux__)
+    ctx->epoll_fd = -1;
+
+    /* armed lazily by the first io_uring poll, registered now with epoll */
+    ctx->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ctx->wake_fd == -1) {
+        free(ctx);
+        return NULL;
+    }
+
+#ifdef COMMC_ASYNC_HAVE_URING
+    /* prefer io_uring, fall back to epoll on older kernels */
+    if (backend != COMMC_ASYNC_BACKEND_EPOLL) {
+        ctx->uring = uring_create(COMMC_ASYNC_URING_ENTRIES, (unsigned int)ctx->max_events);
+        if (ctx->uring) {
+            ctx->backend = COMMC_ASYNC_BACKEND_IO_URING;
+            return ctx;
+        }
+    }
+#endif
+
+    ctx->backend = COMMC_ASYNC_BACKEND_EPOLL;
+
+    /* create epoll instance */
+    ctx->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (ctx->epoll_fd == -1) {
+        close(ctx->wake_fd);
+        free(ctx);
+        return NULL;
+    }
+
+    /* allocate events array */
+    ctx->events = (struct epoll_event*)malloc(ctx->max_events *
+                                             sizeof(struct epoll_event));
+    if (!ctx->events) {
+        close(ctx->epoll_fd);
+        close(ctx->wake_fd);
+        free(ctx);
+        return NULL;
+    }
+
+    memset(&wake_event, 0, sizeof(wake_event));
+    wake_event.events = EPOLLIN;
+    wake_event.data.fd = ctx->wake_fd;
+    if (epoll_ctl(ctx->epoll_fd, EPOLL_CTL_ADD, ctx->wake_fd, &wake_event) != 0) {
+        free(ctx->events);
+        close(ctx->epoll_fd);
+        close(ctx->wake_fd);
+        free(ctx);
+        return NULL;
+    }
+
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+    ctx->backend = COMMC_ASYNC_BACKEND_KQUEUE;
+
+    /* create kqueue */
+    ctx->kqueue_fd = kqueue();
+    if (ctx->kqueue_fd == -1) {
+        free(ctx);
+        return NULL;
+    }
+
+    /* allocate events and changes arrays */
+    ctx->events = (struct kevent*)malloc(ctx->max_events * sizeof(struct kevent));
+    if (!ctx->events) {
+        close(ctx->kqueue_fd);
+        free(ctx);
+        return NULL;
+    }
+
+    ctx->changes = (struct kevent*)malloc(ctx->max_events * sizeof(struct kevent));
+    if (!ctx->changes) {
+        free(ctx->events);
+        close(ctx->kqueue_fd);
+        free(ctx);
+        return NULL;
+    }
+
+    /* user event 0 carries post/stop wakeups */
+    EV_SET(&wake_event, 0, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, NULL);
+    if (kevent(ctx->kqueue_fd, &wake_event, 1, NULL, 0, NULL) == -1) {
+        free(ctx->changes);
+        free(ctx->events);
+        close(ctx->kqueue_fd);
+        free(ctx);
+        return NULL;
+    }
+
+    ctx->change_count = 0;
+#endif
+
+    return ctx;
+}
+
+/*
+
+         commc_async_get_backend()
+	       ---
+	       returns the backend the context runs on.
+
+*/
+
+commc_async_backend_t commc_async_get_backend(const commc_async_context_t* ctx) {
+
+    if (!validate_context(ctx)) {
+        return COMMC_ASYNC_BACKEND_DEFAULT;
+    }
+
+    return ctx->backend;
+}
+
+/*
+
+         commc_async_context_destroy()
+	       ---
+	       destroys async context and cleans up resources.
+	       pending operations are dropped without callbacks.
+
+*/
+
+void commc_async_context_destroy(commc_async_context_t* ctx) {
+
+    commc_async_task_t* task;
+    commc_async_task_t* next;
+#ifdef _WIN32
+    int                 i;
+#endif
+
+    if (!validate_context(ctx)) {
+        return;
+    }
+
+    /* stop event loop */
+    ctx->is_running = 0;
+
+    /* helpers may still push results and signal the wakeup */
+    offload_shutdown(ctx);
+
+#ifdef _WIN32
+    /* cancel all operations */
+    commc_async_cancel_all(ctx);
+
+    /* wait for worker threads to finish */
+    if (ctx->threads) {
+        WaitForMultipleObjects(ctx->thread_count, ctx->threads,
+                              TRUE, 5000);
+        for (i = 0; i < ctx->thread_count; i++) {
+            CloseHandle(ctx->threads[i]);
+        }
+        free(ctx->threads);
+    }
+
+    /* close completion port */
+    if (ctx->completion_port) {
+        CloseHandle(ctx->completion_port);
+    }
+
+    CloseHandle(ctx->wake_event);
+
+#elif defined(__linux__)
+#ifdef COMMC_ASYNC_HAVE_URING
+    /* closing the ring cancels in-flight requests before we free them */
+    uring_destroy(ctx->uring);
+#endif
+
+    /* close epoll */
+    if (ctx->epoll_fd != -1) {
+        close(ctx->epoll_fd);
+    }
+
+    /* free events array */
+    if (ctx->events) {
+        free(ctx->events);
+    }
+
+    close(ctx->wake_fd);
+
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+    /* close kqueue */
+    if (ctx->kqueue_fd != -1) {
+        close(ctx->kqueue_fd);
+    }
+
+    /* free event arrays */
+    if (ctx->events) {
+        free(ctx->events);
+    }
+    if (ctx->changes) {
+        free(ctx->changes);
+    }
+#endif
+
+#ifndef _WIN32
+    drop_operations(ctx);
+#endif
+
+    /* free operations array */
+    if (ctx->operations) {
+        free(ctx->operations);
+    }
+
+    /* active timers are caller-owned; only the wheel is ours */
+    free(ctx->timers);
+    free(ctx->batch);
+
+    /* unrun posts are dropped; only commc_async_post() tasks are ours */
+    task = ctx->posted;
+    while (task) {
+        next = task->next;
+        if (task->allocated) {
+            free(task);
+        }
+        task = next;
+    }
+
+    /* free context */
+    free(ctx);
+}
+
+/*
+
+         commc_async_context_set_callback()
+	       ---
+	       sets default callback for operations.
+
+*/
+
+void commc_async_context_set_callback(commc_async_context_t* ctx,
+                                     commc_async_callback_t callback) {
+
+    if (!validate_context(ctx)) {
+        return;
+    }
+
+    ctx->default_callback = callback;
+}
+
+/*
+
+         commc_async_set_edge_triggered()
+	       ---
+	       selects edge-triggered registration before any
+	       handle has state in the context.
+
+*/
+
+int commc_async_set_edge_triggered(commc_async_context_t* ctx,
+                                   int enabled) {
+
+    if (!validate_context(ctx)) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    (void)enabled;
+    return -1;
+
+#else
+    if (ctx->backend == COMMC_ASYNC_BACKEND_IO_URING) {
+        return -1;
+    }
+
+    enabled = enabled ? 1 : 0;
+    if (enabled != ctx->edge_triggered &&
+        (ctx->fd_states || ctx->operation_count > 0)) {
+        return -1;
+    }
+
+    ctx->edge_triggered = enabled;
+    return 0;
+#endif
+}
+
+/*
+
+         commc_async_set_batch_callback()
+	       ---
+	       installs or removes the batch callback. results
+	       still collected when it is removed are flushed to
+	       the old one.
+
+*/
+
+int commc_async_set_batch_callback(commc_async_context_t* ctx,
+                                   commc_async_batch_callback_t callback,
+                                   void* user_data) {
+
+    if (!validate_context(ctx)) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    (void)user_data;
+    return callback ? -1 : 0;
+
+#else
+    if (callback && !ctx->batch) {
+        ctx->batch = (commc_async_result_t*)malloc((size_t)ctx->max_events *
+                                                   sizeof(commc_async_result_t));
+        if (!ctx->batch) {
+            return -1;
+        }
+    }
+
+    if (ctx->batch_callback && !ctx->batch_flushing) {
+        flush_batch(ctx);
+    }
+
+    ctx->batch_callback = callback;
+    ctx->batch_user_data = user_data;
+    return 0;
+#endif
+}
+
+/*
+
+         commc_async_set_helper_threads()
+	       ---
+	       sets the helper pool size before it starts.
+
+*/
+
+int commc_async_set_helper_threads(commc_async_context_t* ctx,
+                                   size_t count) {
+
+    if (!validate_context(ctx) || ctx->helpers) {
+        return -1;
+    }
+
+    ctx->helper_count = count;
+    return 0;
+}
+
+/*
+
+         commc_async_add_handle()
+	       ---
+	       adds handle to async context for monitoring.
+
+*/
+
+int commc_async_add_handle(commc_async_context_t* ctx,
+                          int handle,
+                          commc_async_event_type_t events) {
+
+#ifdef _WIN32
+    HANDLE result;
+#endif
+
+    if (!validate_context(ctx) || handle < 0) {
+        return -1;
+    }
+
+    /* set handle to non-blocking mode */
+    if (set_nonblocking(handle) != 0) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    /* associate handle with completion port */
+    result = CreateIoCompletionPort((HANDLE)handle,
+                                   ctx->completion_port,
+                                   (ULONG_PTR)handle, 0);
+    (void)events;
+    return (result == ctx->completion_port) ? 0 : -1;
+
+#else
+    return watch_handle(ctx, handle, events);
+#endif
+}
+
+/*
+
+         commc_async_remove_handle()
+	       ---
+	       removes handle from async context, cancelling
+	       its pending operations.
+
+*/
+
+int commc_async_remove_handle(commc_async_context_t* ctx,
+                             int handle) {
+
+#ifndef _WIN32
+    struct commc_async_fd_state_t* state;
+#endif
+
+    if (!validate_context(ctx) || handle < 0) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    /* Windows IOCP automatically removes handles when closed */
+    return 0;
+
+#else
+    commc_async_cancel(ctx, handle);
+
+    if (handle >= ctx->fd_state_count) {
+        return 0;
+    }
+
+    state = &ctx->fd_states[handle];
+    state->watch = 0;
+
+#ifdef COMMC_ASYNC_HAVE_URING
+    if (ctx->uring) {
+        uring_watch(ctx, handle, state);
+    } else
+#endif
+    {
+        reactor_update(ctx, handle, &ctx->fd_states[handle], 0);
+    }
+
+    /* the descriptor may be closed and reused for anything */
+    ctx->fd_states[handle].kind = ASYNC_FD_KIND_UNKNOWN;
+    ctx->fd_states[handle].ready = 0;
+    ctx->fd_states[handle].stream = 0;
+    return 0;
+#endif
+}
+
+/*
+
+         commc_async_modify_events()
+	       ---
+	       modifies events being monitored for handle.
+
+*/
+
+int commc_async_modify_events(commc_async_context_t* ctx,
+                             int handle,
+                             commc_async_event_type_t events) {
+
+    if (!validate_context(ctx) || handle < 0) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    /* Windows IOCP doesn't modify events, operations specify their type */
+    (void)events;
+    return 0;
+
+#else
+    return watch_handle(ctx, handle, events);
+#endif
+}
+
+/*
+
+         submit_new_operation()
+	       ---
+	       common tail of the async_* helpers: fills in the
+	       callback and submits, freeing the operation if
+	       the submission fails.
+
+*/
+
+static int submit_new_operation(commc_async_context_t* ctx,
+                               commc_async_operation_t* op,
+                               commc_async_callback_t callback,
+                               void* user_data) {
+
+    /* batch mode decides at delivery; otherwise the default in force now */
+    op->callback = (callback || ctx->batch_callback) ? callback : ctx->default_callback;
+    op->user_data = user_data;
+
+    if (commc_async_submit_operation(ctx, op) != 0) {
+        commc_async_operation_destroy(op);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+
+         commc_async_read()
+	       ---
+	       initiates asynchronous read operation.
+
+*/
+
+int commc_async_read(commc_async_context_t* ctx,
+                    int handle,
+                    void* buffer,
+                    size_t buffer_size,
+                    commc_async_callback_t callback,
+                    void* user_data) {
+
+    commc_async_operation_t* op;
+
+    if (!validate_context(ctx) || handle < 0 || !buffer || buffer_size == 0) {
+        return -1;
+    }
+
+    op = commc_async_operation_create(COMMC_ASYNC_OP_READ, handle,
+                                     buffer, buffer_size);
+    if (!op) {
+        return -1;
+    }
+
+    return submit_new_operation(ctx, op, callback, user_data);
+}
+
+/*
+
+         commc_async_write()
+	       ---
+	       initiates asynchronous write operation.
+
+*/
+
+int commc_async_write(commc_async_context_t* ctx,
+                     int handle,
+                     const void* buffer,
+                     size_t buffer_size,
+                     commc_async_callback_t callback,
+                     void* user_data) {
+
+    commc_async_operation_t* op;
+
+    if (!validate_context(ctx) || handle < 0 || !buffer || buffer_size == 0) {
+        return -1;
+    }
+
+    op = commc_async_operation_create(COMMC_ASYNC_OP_WRITE, handle,
+                                     (void*)buffer, buffer_size);
+    if (!op) {
+        return -1;
+    }
+
+    return submit_new_operation(ctx, op, callback, user_data);
+}
+
+/*
+
+         commc_async_read_file()
+	       ---
+	       initiates asynchronous file read operation.
+
+*/
+
+int commc_async_read_file(commc_async_context_t* ctx,
+                         int handle,
+                         void* buffer,
+                         size_t buffer_size,
+                         size_t offset,
+                         commc_async_callback_t callback,
+                         void* user_data) {
+
+    commc_async_operation_t* op;
+
+    if (!validate_context(ctx) || handle < 0 || !buffer || buffer_size == 0) {
+        return -1;
+    }
+
+    op = commc_async_operation_create(COMMC_ASYNC_OP_READ, handle,
+                                     buffer, buffer_size);
+    if (!op) {
+        return -1;
+    }
+
+    op->offset = offset;
+    op->has_offset = 1;
+
+    return submit_new_operation(ctx, op, callback, user_data);
+}
+
+/*
+
+         commc_async_write_file()
+	       ---
+	       initiates asynchronous file write operation.
+
+*/
+
+int commc_async_write_file(commc_async_context_t* ctx,
+                          int handle,
+                          const void* buffer,
+                          size_t buffer_size,
+                          size_t offset,
+                          commc_async_callback_t callback,
+                          void* user_data) {
+
+    commc_async_operation_t* op;
+
+    if (!validate_context(ctx) || handle < 0 || !buffer || buffer_size == 0) {
+        return -1;
+    }
+
+    op = commc_async_operation_create(COMMC_ASYNC_OP_WRITE, handle,
+                                     (void*)buffer, buffer_size);
+    if (!op) {
+        return -1;
+    }
+
+    op->offset = offset;
+    op->has_offset = 1;
+
+    return submit_new_operation(ctx, op, callback, user_data);
+}
+
+/*
+
+         commc_async_accept()
+	       ---
+	       initiates asynchronous accept operation.
+
+*/
+
+int commc_async_accept(commc_async_context_t* ctx,
+                      int listen_handle,
+                      int* accept_handle,
+                      void* address_buffer,
+                      size_t address_size,
+                      commc_async_callback_t callback,
+                      void* user_data) {
+
+    commc_async_operation_t* op;
+
+    if (!validate_context(ctx) || listen_handle < 0) {
+        return -1;
+    }
+
+    op = commc_async_operation_create(COMMC_ASYNC_OP_ACCEPT, listen_handle, NULL, 0);
+    if (!op) {
+        return -1;
+    }
+
+    op->result_handle = accept_handle;
+    op->address = address_buffer;
+    op->address_size = address_size;
+    op->address_length = address_buffer ? (unsigned int)address_size : 0;
+
+    return submit_new_operation(ctx, op, callback, user_data);
+}
+
+/*
+
+         commc_async_connect()
+	       ---
+	       initiates asynchronous connect operation. the
+	       address is copied, so it need not outlive the call.
+
+*/
+
+int commc_async_connect(commc_async_context_t* ctx,
+                       int handle,
+                       const void* address,
+                       size_t address_size,
+                       commc_async_callback_t callback,
+                       void* user_data) {
+
+    commc_async_operation_t* op;
+
+    if (!validate_context(ctx) || handle < 0 || !address || address_size == 0) {
+        return -1;
+    }
+
+    op = commc_async_operation_create(COMMC_ASYNC_OP_CONNECT, handle, NULL, 0);
+    if (!op) {
+        return -1;
+    }
+
+    op->address = malloc(address_size);
+    if (!op->address) {
+        commc_async_operation_destroy(op);
+        return -1;
+    }
+
+    memcpy(op->address, address, address_size);
+    op->address_size = address_size;
+    op->owns_address = 1;
+
+    return submit_new_operation(ctx, op, callback, user_data);
+}
+
+/*
+
+         commc_async_fsync()
+	       ---
+	       flushes a file to storage off the loop thread.
+
+*/
+
+int commc_async_fsync(commc_async_context_t* ctx,
+                     int handle,
+                     commc_async_callback_t callback,
+                     void* user_data) {
+
+    commc_async_operation_t* op;
+
+    if (!validate_context(ctx) || handle < 0) {
+        return -1;
+    }
+
+    op = commc_async_operation_create(COMMC_ASYNC_OP_FSYNC, handle, NULL, 0);
+    if (!op) {
+        return -1;
+    }
+
+    return submit_new_operation(ctx, op, callback, user_data);
+}
+
+/*
+
+         commc_async_offload()
+	       ---
+	       runs a blocking function on a helper thread.
+
+*/
+
+int commc_async_offload(commc_async_context_t* ctx,
+                       commc_async_work_fn work,
+                       void* arg,
+                       commc_async_callback_t callback,
+                       void* user_data) {
+
+    commc_async_operation_t* op;
+
+    if (!validate_context(ctx) || !work) {
+        return -1;
+    }
+
+    op = commc_async_operation_create(COMMC_ASYNC_OP_WORK, -1, arg, 0);
+    if (!op) {
+        return -1;
+    }
+
+    op->work = work;
+    return submit_new_operation(ctx, op, callback, user_data);
+}
+
+/*
+
+         commc_async_sendfile()
+	       ---
+	       initiates asynchronous sendfile operation. it
+	       completes once count bytes were sent or the file
+	       ended.
+
+*/
+
+int commc_async_sendfile(commc_async_context_t* ctx,
+                        int out_handle,
+                        int in_handle,
+                        size_t offset,
+                        size_t count,
+                        commc_async_callback_t callback,
+                        void* user_data) {
+
+    commc_async_operation_t* op;
+
+    if (!validate_context(ctx) || out_handle < 0 || in_handle < 0 || count == 0) {
+        return -1;
+    }
+
+    op = commc_async_operation_create(COMMC_ASYNC_OP_SENDFILE, out_handle, NULL, count);
+    if (!op) {
+        return -1;
+    }
+
+    op->source_handle = in_handle;
+    op->offset = offset;
+    op->has_offset = 1;
+
+    return submit_new_operation(ctx, op, callback, user_data);
+}
+
+/*
+
+         commc_async_cancel()
+	       ---
+	       cancels pending operations on a handle. their
+	       callbacks run with ECANCELED, immediately on the
+	       readiness backends and at the next poll on
+	       io_uring (an operation that already finished in
+	       the kernel reports its real result instead).
+
+*/
+
+int commc_async_cancel(commc_async_context_t* ctx,
+                      int handle) {
+
+#ifdef COMMC_ASYNC_HAVE_URING
+    commc_async_operation_t* op;
+    size_t                   i;
+#endif
+
+    if (!validate_context(ctx) || handle < 0) {
+        return -1;
+    }
+
+    offload_cancel(ctx, handle);
+
+#ifdef _WIN32
+    return CancelIo((HANDLE)handle) ? 0 : -1;
+
+#else
+#ifdef COMMC_ASYNC_HAVE_URING
+    if (ctx->uring) {
+        for (i = 0; i < ctx->operation_count; i++) {
+            op = (commc_async_operation_t*)ctx->operations[i];
+            if (op->type != COMMC_ASYNC_OP_POLL &&
+                (op->handle == handle ||
+                 (op->type == COMMC_ASYNC_OP_SENDFILE && op->source_handle == handle))) {
+                uring_cancel_operation(ctx, op);
+            }
+        }
+        return 0;
+    }
+#endif
+
+    return reactor_cancel(ctx, handle);
+#endif
+}
+
+/*
+
+         commc_async_poll()
+	       ---
+	       polls for completed operations.
+
+*/
+
+int commc_async_poll(commc_async_context_t* ctx, int timeout_ms) {
+
+    int count;
+
+    if (!validate_context(ctx)) {
+        return -1;
+    }
+
+    if (timeout_ms < 0) {
+        timeout_ms = ctx->timeout_ms;
+    }
+
+    /* never sleep past the next timer */
+    timeout_ms = timers_wait(ctx, timeout_ms);
+
+#ifdef _WIN32
+    /* Windows uses worker threads, just wait for a post or stop */
+    WaitForSingleObject(ctx->wake_event, timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms);
+    count = 0;
+
+#else
+#ifdef COMMC_ASYNC_HAVE_URING
+    if (ctx->uring) {
+        count = uring_poll(ctx, timeout_ms);
+    } else
+#endif
+    {
+        count = reactor_poll(ctx, timeout_ms);
+    }
+
+    if (count < 0) {
+        return -1;
+    }
+#endif
+
+#ifndef _WIN32
+    count += run_offloaded(ctx);
+#endif
+    count += run_posted(ctx);
+    count += run_timers(ctx);
+
+    if (ctx->batch_callback) {
+        flush_batch(ctx);
+    }
+
+    return count;
+}
+
+/*
+
+         commc_async_poll_once()
+	       ---
+	       polls for events without blocking.
+
+*/
+
+int commc_async_poll_once(commc_async_context_t* ctx) {
+
+    return commc_async_poll(ctx, 0);
 }
 
 /*
 
-         commc_async_context_set_callback()
+         commc_async_run()
 	       ---
-	       sets default callback for operations.
+	       runs event loop continuously.
 
 */
 
-void commc_async_context_set_callback(commc_async_context_t* ctx,
-                                     commc_async_callback_t callback) {
+void commc_async_run(commc_async_context_t* ctx) {
 
     if (!validate_context(ctx)) {
         return;
     }
 
-    ctx->default_callback = callback;
+    COMMC_ATOMIC_STORE_RELEASE(&ctx->is_running, 1);
+
+    while (COMMC_ATOMIC_LOAD_ACQUIRE(&ctx->is_running)) {
+        commc_async_poll(ctx, ctx->timeout_ms);
+    }
 }
 
 /*
 
-         commc_async_add_handle()
+         commc_async_stop()
 	       ---
-	       adds handle to async context for monitoring.
+	       stops running event loop.
 
 */
 
-int commc_async_add_handle(commc_async_context_t* ctx,
-                          int handle,
-                          commc_async_event_type_t events) {
-
-    if (!validate_context(ctx) || handle < 0) {
-        return -1;
-    }
+void commc_async_stop(commc_async_context_t* ctx) {
 
-    /* set handle to non-blocking mode */
-    if (set_nonblocking(handle) != 0) {
-        return -1;
+    if (!validate_context(ctx)) {
+        return;
     }
 
-#ifdef _WIN32
-    /* associate handle with completion port */
-    HANDLE result = CreateIoCompletionPort((HANDLE)handle,
-                                          ctx->completion_port,
-                                          (ULONG_PTR)handle, 0);
-    return (result == ctx->completion_port) ? 0 : -1;
-
-#elif defined(__linux__)
-    struct epoll_event event;
-    
-    memset(&event, 0, sizeof(event));
-    event.events = convert_events_to_epoll(events);
-    event.data.fd = handle;
-    
-    return epoll_ctl(ctx->epoll_fd, EPOLL_CTL_ADD, handle, &event);
-
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-    struct kevent changes[2];
-    int change_count = 0;
-    
-    convert_events_to_kqueue(handle, events, changes, &change_count);
-    
-    return kevent(ctx->kqueue_fd, changes, change_count, NULL, 0, NULL);
-#endif
+    COMMC_ATOMIC_STORE_RELEASE(&ctx->is_running, 0);
+    signal_wakeup(ctx);
 }
 
 /*
 
-         commc_async_remove_handle()
+         commc_async_set_timeout()
 	       ---
-	       removes handle from async context.
+	       sets default polling timeout.
 
 */
 
-int commc_async_remove_handle(commc_async_context_t* ctx,
-                             int handle) {
+void commc_async_set_timeout(commc_async_context_t* ctx,
+                            int timeout_ms) {
 
-    if (!validate_context(ctx) || handle < 0) {
-        return -1;
+    if (!validate_context(ctx)) {
+        return;
     }
 
-#ifdef _WIN32
-    /* Windows IOCP automatically removes handles when closed */
-    return 0;
-
-#elif defined(__linux__)
-    return epoll_ctl(ctx->epoll_fd, EPOLL_CTL_DEL, handle, NULL);
-
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-    struct kevent changes[2];
-    
-    EV_SET(&changes[0], handle, EVFILT_READ, EV_DELETE, 0, 0, NULL);
-    EV_SET(&changes[1], handle, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
-    
-    return kevent(ctx->kqueue_fd, changes, 2, NULL, 0, NULL);
-#endif
+    ctx->timeout_ms = timeout_ms;
 }
 
 /*
 
-         commc_async_modify_events()
+         commc_async_get_timeout()
 	       ---
-	       modifies events being monitored for handle.
+	       gets default polling timeout.
 
 */
 
-int commc_async_modify_events(commc_async_context_t* ctx,
-                             int handle,
-                             commc_async_event_type_t events) {
+int commc_async_get_timeout(const commc_async_context_t* ctx) {
 
-    if (!validate_context(ctx) || handle < 0) {
-        return -1;
+    if (!validate_context(ctx)) {
+        return COMMC_ASYNC_DEFAULT_TIMEOUT;
     }
 
-#ifdef _WIN32
-    /* Windows IOCP doesn't modify events, operations specify their type */
-    return 0;
-
-#elif defined(__linux__)
-    struct epoll_event event;
-    
-    memset(&event, 0, sizeof(event));
-    event.events = convert_events_to_epoll(events);
-    event.data.fd = handle;
-    
-    return epoll_ctl(ctx->epoll_fd, EPOLL_CTL_MOD, handle, &event);
-
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-    struct kevent changes[4];
-    int change_count = 0;
-    
-    /* delete existing events */
-    EV_SET(&changes[change_count++], handle, EVFILT_READ, EV_DELETE, 0, 0, NULL);
-    EV_SET(&changes[change_count++], handle, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
-    
-    /* add new events */
-    convert_events_to_kqueue(handle, events, &changes[change_count], &change_count);
-    change_count += 2;
-    
-    return kevent(ctx->kqueue_fd, changes, change_count, NULL, 0, NULL);
-#endif
+    return ctx->timeout_ms;
 }
 
 /*
 
-         commc_async_read()
+         commc_async_timer_init()
 	       ---
-	       initiates asynchronous read operation.
+	       prepares a timer for use.
 
 */
 
-int commc_async_read(commc_async_context_t* ctx,
-                    int handle,
-                    void* buffer,
-                    size_t buffer_size,
-                    commc_async_callback_t callback,
-                    void* user_data) {
-
-    commc_async_operation_t* op;
-
-    if (!validate_context(ctx) || handle < 0 || !buffer || buffer_size == 0) {
-        return -1;
-    }
+void commc_async_timer_init(commc_async_timer_t* timer,
+                            commc_async_callback_t callback,
+                            void* user_data) {
 
-    op = commc_async_operation_create(COMMC_ASYNC_OP_READ, handle,
-                                     buffer, buffer_size);
-    if (!op) {
-        return -1;
+    if (!timer) {
+        return;
     }
 
-    op->callback = callback ? callback : ctx->default_callback;
-    op->user_data = user_data;
-
-    return commc_async_submit_operation(ctx, op);
+    memset(timer, 0, sizeof(*timer));
+    timer->level = -1;
+    timer->callback = callback;
+    timer->user_data = user_data;
 }
 
 /*
 
-         commc_async_write()
+         commc_async_timer_start()
 	       ---
-	       initiates asynchronous write operation.
+	       arms or re-arms a timer.
 
 */
 
-int commc_async_write(commc_async_context_t* ctx,
-                     int handle,
-                     const void* buffer,
-                     size_t buffer_size,
-                     commc_async_callback_t callback,
-                     void* user_data) {
+int commc_async_timer_start(commc_async_context_t* ctx,
+                            commc_async_timer_t* timer,
+                            unsigned long timeout_ms,
+                            unsigned long period_ms) {
 
-    commc_async_operation_t* op;
+    struct commc_async_timer_wheel_t* wheel;
+    unsigned long                     lag;
 
-    if (!validate_context(ctx) || handle < 0 || !buffer || buffer_size == 0) {
+    if (!validate_context(ctx) || !timer) {
         return -1;
     }
 
-    op = commc_async_operation_create(COMMC_ASYNC_OP_WRITE, handle,
-                                     (void*)buffer, buffer_size);
-    if (!op) {
+    wheel = get_timer_wheel(ctx);
+    if (!wheel) {
         return -1;
     }
 
-    op->callback = callback ? callback : ctx->default_callback;
-    op->user_data = user_data;
+    if (timer->active) {
+        timer_unlink(wheel, timer);
+    } else {
+        if (wheel->count == 0) {
+            wheel->current = async_now_ms();
+        }
+        wheel->count++;
+        timer->active = 1;
+    }
+
+    /*
+       deadlines count from now, which the wheel may lag. the
+       current millisecond is partly over, so one extra tick
+       keeps a timer from firing before its timeout.
+    */
+    lag = async_now_ms() - wheel->current;
+    if (lag > ASYNC_WHEEL_RANGE) {
+        lag = 0;
+    }
+    if (timeout_ms > 0) {
+        lag++;
+    }
+    if (timeout_ms > ~0UL - lag) {
+        timeout_ms = ~0UL - lag;
+    }
 
-    return commc_async_submit_operation(ctx, op);
+    timer->period_ms = period_ms;
+    timer_arm(wheel, timer, lag + timeout_ms);
+    return 0;
 }
 
 /*
 
-         commc_async_read_file()
+         commc_async_timer_stop()
 	       ---
-	       initiates asynchronous file read operation.
+	       disarms a timer.
 
 */
 
-int commc_async_read_file(commc_async_context_t* ctx,
-                         int handle,
-                         void* buffer,
-                         size_t buffer_size,
-                         size_t offset,
-                         commc_async_callback_t callback,
-                         void* user_data) {
-
-    commc_async_operation_t* op;
+int commc_async_timer_stop(commc_async_context_t* ctx,
+                           commc_async_timer_t* timer) {
 
-    if (!validate_context(ctx) || handle < 0 || !buffer || buffer_size == 0) {
+    if (!validate_context(ctx) || !timer) {
         return -1;
     }
 
-    op = commc_async_operation_create(COMMC_ASYNC_OP_READ, handle,
-                                     buffer, buffer_size);
-    if (!op) {
-        return -1;
+    if (!timer->active || !ctx->timers) {
+        return 0;
     }
 
-    op->offset = offset;
-    op->callback = callback ? callback : ctx->default_callback;
-    op->user_data = user_data;
-
-    return commc_async_submit_operation(ctx, op);
+    timer_unlink(ctx->timers, timer);
+    timer->active = 0;
+    timer->remaining = 0;
+    ctx->timers->count--;
+    return 0;
 }
 
 /*
 
-         commc_async_write_file()
+         commc_async_timer_is_active()
 	       ---
-	       initiates asynchronous file write operation.
+	       checks whether a timer is armed.
 
 */
 
-int commc_async_write_file(commc_async_context_t* ctx,
-                          int handle,
-                          const void* buffer,
-                          size_t buffer_size,
-                          size_t offset,
-                          commc_async_callback_t callback,
-                          void* user_data) {
-
-    commc_async_operation_t* op;
-
-    if (!validate_context(ctx) || handle < 0 || !buffer || buffer_size == 0) {
-        return -1;
-    }
-
-    op = commc_async_operation_create(COMMC_ASYNC_OP_WRITE, handle,
-                                     (void*)buffer, buffer_size);
-    if (!op) {
-        return -1;
-    }
-
-    op->offset = offset;
-    op->callback = callback ? callback : ctx->default_callback;
-    op->user_data = user_data;
+int commc_async_timer_is_active(const commc_async_timer_t* timer) {
 
-    return commc_async_submit_operation(ctx, op);
+    return timer ? timer->active : 0;
 }
 
 /*
 
-         commc_async_poll()
+         commc_async_task_init()
 	       ---
-	       polls for completed operations.
+	       prepares an embedded task for posting.
 
 */
 
-int commc_async_poll(commc_async_context_t* ctx, int timeout_ms) {
+void commc_async_task_init(commc_async_task_t* task,
+                           commc_async_task_fn fn,
+                           void* arg) {
 
-    if (!validate_context(ctx)) {
-        return -1;
+    if (!task) {
+        return;
     }
 
-    if (timeout_ms < 0) {
-        timeout_ms = ctx->timeout_ms;
-    }
+    task->next = NULL;
+    task->fn = fn;
+    task->arg = arg;
+    task->allocated = 0;
+}
 
-#ifdef _WIN32
-    /* Windows uses worker threads, just sleep */
-    Sleep(timeout_ms);
-    return 0;
+/*
 
-#elif defined(__linux__)
-    int nfds = epoll_wait(ctx->epoll_fd, ctx->events, ctx->max_events, timeout_ms);
-    if (nfds == -1) {
-        return -1;
-    }
+         commc_async_post_task()
+	       ---
+	       pushes task on the post stack (Treiber push; the
+	       loop takes the whole stack at once, so there is
+	       no ABA). only the producer that finds the stack
+	       empty signals the loop.
 
-    /* process events */
-    for (int i = 0; i < nfds; i++) {
-        /* handle epoll events here */
-        /* this would typically trigger read/write operations */
-    }
+*/
 
-    return nfds;
+int commc_async_post_task(commc_async_context_t* ctx,
+                          commc_async_task_t* task) {
 
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-    struct timespec timeout;
-    timeout.tv_sec = timeout_ms / 1000;
-    timeout.tv_nsec = (timeout_ms % 1000) * 1000000;
+    commc_async_task_t* head;
 
-    int nfds = kevent(ctx->kqueue_fd, NULL, 0, ctx->events, ctx->max_events, &timeout);
-    if (nfds == -1) {
+    if (!validate_context(ctx) || !task || !task->fn) {
         return -1;
     }
 
-    /* process events */
-    for (int i = 0; i < nfds; i++) {
-        /* handle kqueue events here */
+    do {
+        head = (commc_async_task_t*)ASYNC_LOAD_PTR((void**)&ctx->posted);
+        task->next = head;
+    } while (!ASYNC_CAS_PTR((void**)&ctx->posted, (void*)head, (void*)task));
+
+    if (!head) {
+        signal_wakeup(ctx);
     }
 
-    return nfds;
-#endif
+    return 0;
 }
 
 /*
 
-         commc_async_run()
+         commc_async_post()
 	       ---
-	       runs event loop continuously.
+	       posts a task allocated here and freed by the loop
+	       after it has run.
 
 */
 
-void commc_async_run(commc_async_context_t* ctx) {
-
-    if (!validate_context(ctx)) {
-        return;
-    }
+int commc_async_post(commc_async_context_t* ctx,
+                     commc_async_task_fn fn,
+                     void* arg) {
 
-    ctx->is_running = 1;
+    commc_async_task_t* task;
 
-    while (ctx->is_running) {
-        commc_async_poll(ctx, ctx->timeout_ms);
+    if (!validate_context(ctx) || !fn) {
+        return -1;
     }
-}
-
-/*
-
-         commc_async_stop()
-	       ---
-	       stops running event loop.
-
-*/
 
-void commc_async_stop(commc_async_context_t* ctx) {
-
-    if (!validate_context(ctx)) {
-        return;
+    task = (commc_async_task_t*)malloc(sizeof(commc_async_task_t));
+    if (!task) {
+        return -1;
     }
 
-    ctx->is_running = 0;
+    commc_async_task_init(task, fn, arg);
+    task->allocated = 1;
+
+    return commc_async_post_task(ctx, task);
 }
 
 /*
@@ -964,11 +4832,13 @@ commc_async_operation_t* commc_async_operation_create(commc_async_operation_type
     op->buffer = buffer;
     op->buffer_size = buffer_size;
     op->offset = 0;
+    op->source_handle = -1;
     op->callback = NULL;
     op->user_data = NULL;
     op->address = NULL;
     op->address_size = 0;
     op->timeout_ms = COMMC_ASYNC_DEFAULT_TIMEOUT;
+    op->pipe_slot = -1;
 
     return op;
 }
@@ -984,6 +4854,9 @@ commc_async_operation_t* commc_async_operation_create(commc_async_operation_type
 void commc_async_operation_destroy(commc_async_operation_t* op) {
 
     if (op) {
+        if (op->owns_address) {
+            free(op->address);
+        }
         free(op);
     }
 }
@@ -999,6 +4872,13 @@ void commc_async_operation_destroy(commc_async_operation_t* op) {
 int commc_async_submit_operation(commc_async_context_t* ctx,
                                 commc_async_operation_t* op) {
 
+#ifdef _WIN32
+    BOOL  result = FALSE;
+    DWORD bytes_transferred = 0;
+#else
+    int   rc;
+#endif
+
     if (!validate_context(ctx) || !validate_operation(op)) {
         return -1;
     }
@@ -1009,8 +4889,13 @@ int commc_async_submit_operation(commc_async_context_t* ctx,
     }
 
 #ifdef _WIN32
-    BOOL result = FALSE;
-    DWORD bytes_transferred = 0;
+    if (op->type == COMMC_ASYNC_OP_WORK || op->type == COMMC_ASYNC_OP_FSYNC) {
+        if (offload_submit(ctx, op) != 0) {
+            remove_operation(ctx, op);
+            return -1;
+        }
+        return 0;
+    }
 
     /* set up overlapped structure */
     memset(&op->overlapped, 0, sizeof(OVERLAPPED));
@@ -1033,8 +4918,26 @@ int commc_async_submit_operation(commc_async_context_t* ctx,
 
     return 0;
 #else
-    /* Unix systems would handle operations differently */
-    /* This is a simplified implementation */
+    op->next = NULL;
+    op->stage = 0;
+    op->cancelled = 0;
+    op->transferred = 0;
+    op->staged = 0;
+
+#ifdef COMMC_ASYNC_HAVE_URING
+    if (ctx->uring) {
+        rc = uring_submit(ctx, op);
+    } else
+#endif
+    {
+        rc = reactor_submit(ctx, op);
+    }
+
+    if (rc != 0) {
+        remove_operation(ctx, op);
+        return -1;
+    }
+
     return 0;
 #endif
 }
@@ -1050,20 +4953,60 @@ int commc_async_submit_operation(commc_async_context_t* ctx,
 int commc_async_cancel_all(commc_async_context_t* ctx) {
 
     size_t i;
+#ifdef _WIN32
+    commc_async_operation_t* op;
+    size_t                   kept = 0;
+#else
+    int    handle;
+#endif
 
     if (!validate_context(ctx)) {
         return -1;
     }
 
-    /* destroy all pending operations */
+    offload_cancel(ctx, -1);
+
+#ifdef _WIN32
+    /* destroy all pending operations; helpers still own theirs */
     for (i = 0; i < ctx->operation_count; i++) {
-        if (ctx->operations[i]) {
-            commc_async_operation_destroy((commc_async_operation_t*)ctx->operations[i]);
+        op = (commc_async_operation_t*)ctx->operations[i];
+        if (op && op->stage == ASYNC_STAGE_OFFLOAD) {
+            op->slot = kept;
+            ctx->operations[kept++] = op;
+        } else if (op) {
+            commc_async_operation_destroy(op);
         }
     }
 
-    ctx->operation_count = 0;
+    ctx->operation_count = kept;
+    return 0;
+
+#else
+#ifdef COMMC_ASYNC_HAVE_URING
+    if (ctx->uring) {
+        for (i = 0; i < ctx->operation_count; i++) {
+            if (((commc_async_operation_t*)ctx->operations[i])->type != COMMC_ASYNC_OP_POLL) {
+                uring_cancel_operation(ctx, (commc_async_operation_t*)ctx->operations[i]);
+            }
+        }
+        return 0;
+    }
+#endif
+
+    (void)i;
+
+    for (handle = 0; handle < ctx->fd_state_count; handle++) {
+        if (ctx->fd_states[handle].read_head || ctx->fd_states[handle].write_head) {
+            reactor_cancel(ctx, handle);
+        }
+    }
+
+    while (ctx->ready_head) {
+        reactor_cancel(ctx, ctx->ready_head->handle);
+    }
+
     return 0;
+#endif
 }
 
 /*
@@ -1080,6 +5023,12 @@ size_t commc_async_get_pending_count(const commc_async_context_t* ctx) {
         return 0;
     }
 
+#ifdef COMMC_ASYNC_HAVE_URING
+    if (ctx->uring) {
+        return ctx->operation_count - ctx->uring->watch_ops;
+    }
+#endif
+
     return ctx->operation_count;
 }
 
@@ -1097,11 +5046,11 @@ int commc_async_is_running(const commc_async_context_t* ctx) {
         return 0;
     }
 
-    return ctx->is_running;
+    return COMMC_ATOMIC_LOAD_ACQUIRE((int*)&ctx->is_running);
 }
 
 /*
 	==================================
              --- EOF ---
 	==================================
-*/
\ No newline at end of file
+*/
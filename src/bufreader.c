@@ -0,0 +1,926 @@
+/*
+   ===================================
+   B U F R E A D E R . C
+   BUFFERED SOCKET READER IMPLEMENTATION
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    the unread bytes are buffer[start, end). a fill
+	    receives into buffer[end, capacity); when that is
+	    empty the unread bytes are first moved to the front,
+	    and only a buffer that is full of unread bytes is
+	    grown. one byte past capacity is always allocated so
+	    a line can be NUL-terminated in place even when it
+	    ends the stream without a LF.
+
+	    'scanned' remembers how much of the unread window
+	    was already searched for a delimiter, so a line that
+	    arrives in many pieces is still searched once.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commc/bufreader.h"
+#include "commc/socket.h"
+#include "commc/error.h"
+
+/*
+	==================================
+           --- STRUCTURES ---
+	==================================
+*/
+
+struct commc_bufreader_t {
+
+    commc_socket_t* socket;      /* SOURCE, OR NULL FOR A RAW DESCRIPTOR */
+    int             socket_fd;   /* RAW DESCRIPTOR */
+    char*           buffer;      /* CAPACITY + 1 BYTES */
+    size_t          capacity;    /* CURRENT BUFFER SIZE */
+    size_t          max_size;    /* GROWTH LIMIT */
+    size_t          start;       /* FIRST UNREAD BYTE */
+    size_t          end;         /* ONE PAST THE LAST UNREAD BYTE */
+    size_t          scanned;     /* UNREAD BYTES ALREADY SEARCHED */
+    int             at_end;      /* PEER CLOSED THE STREAM */
+
+};
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         create_reader()
+	       ---
+	       allocates a reader with its first buffer.
+
+*/
+
+static commc_error_t create_reader(commc_bufreader_t** reader,
+                                   commc_socket_t*     socket,
+                                   int                 socket_fd,
+                                   size_t              initial_size,
+                                   size_t              max_size) {
+
+    commc_bufreader_t* new_reader;
+
+    if (initial_size == 0) {
+
+        initial_size = COMMC_BUFREADER_DEFAULT_SIZE;
+
+    }
+
+    if (max_size == 0) {
+
+        max_size = COMMC_BUFREADER_DEFAULT_MAX_SIZE;
+
+    }
+
+    if (initial_size > max_size) {
+
+        initial_size = max_size;
+
+    }
+
+    new_reader = (commc_bufreader_t*)malloc(sizeof(commc_bufreader_t));
+
+    if (!new_reader) {
+
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    new_reader->buffer = (char*)malloc(initial_size + 1);
+
+    if (!new_reader->buffer) {
+
+        free(new_reader);
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    new_reader->socket    = socket;
+    new_reader->socket_fd = socket_fd;
+    new_reader->capacity  = initial_size;
+    new_reader->max_size  = max_size;
+    new_reader->start     = 0;
+    new_reader->end       = 0;
+    new_reader->scanned   = 0;
+    new_reader->at_end    = 0;
+
+    *reader = new_reader;
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         receive_into()
+	       ---
+	       one receive from the source. end of stream is
+	       COMMC_SUCCESS with *received 0; a non-blocking
+	       commc_socket_t is waited on for its receive
+	       timeout.
+
+*/
+
+static commc_error_t receive_into(commc_bufreader_t* reader,
+                                  char*              destination,
+                                  size_t             size,
+                                  size_t*            received) {
+
+    commc_error_t result;
+    int           got;
+
+    *received = 0;
+
+    if (reader->socket) {
+
+        for (;;) {
+
+            result = commc_socket_receive(reader->socket, destination, size, received);
+
+            if (result == COMMC_ERROR_CONNECTION_CLOSED) {
+
+                *received = 0;
+                return COMMC_SUCCESS;
+
+            }
+
+            if (result != COMMC_ERROR_WOULD_BLOCK) {
+
+                return result;
+
+            }
+
+            result = commc_socket_wait_readable(reader->socket,
+                                                reader->socket->options.receive_timeout);
+
+            if (result != COMMC_SUCCESS) {
+
+                return result;
+
+            }
+
+        }
+
+    }
+
+    for (;;) {
+
+        got = (int)recv(reader->socket_fd, destination, (int)size, 0);
+
+        if (got >= 0) {
+
+            *received = (size_t)got;
+            return COMMC_SUCCESS;
+
+        }
+
+#ifdef _WIN32
+        if (WSAGetLastError() == WSAEWOULDBLOCK) {
+
+            return COMMC_ERROR_WOULD_BLOCK;
+
+        }
+#else
+        if (errno == EINTR) {
+
+            continue;
+
+        }
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+
+            return COMMC_ERROR_WOULD_BLOCK;
+
+        }
+#endif
+
+        return COMMC_SYSTEM_ERROR;
+
+    }
+
+}
+
+/*
+
+         make_room()
+	       ---
+	       leaves free space after the unread bytes and
+	       room for want unread bytes in all, compacting
+	       before growing.
+
+*/
+
+static commc_error_t make_room(commc_bufreader_t* reader,
+                               size_t             want) {
+
+    size_t new_capacity;
+    char*  new_buffer;
+
+    if (reader->end < reader->capacity && reader->capacity - reader->start >= want) {
+
+        return COMMC_SUCCESS;
+
+    }
+
+    if (reader->start > 0) {
+
+        memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+        reader->end  -= reader->start;
+        reader->start = 0;
+
+    }
+
+    if (reader->end < reader->capacity && reader->capacity >= want) {
+
+        return COMMC_SUCCESS;
+
+    }
+
+    if (reader->capacity >= reader->max_size) {
+
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+
+    }
+
+    new_capacity = reader->capacity * 2;
+
+    if (new_capacity < want) {
+
+        new_capacity = want;
+
+    }
+
+    if (new_capacity > reader->max_size) {
+
+        new_capacity = reader->max_size;
+
+    }
+
+    new_buffer = (char*)realloc(reader->buffer, new_capacity + 1);
+
+    if (!new_buffer) {
+
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    reader->buffer   = new_buffer;
+    reader->capacity = new_capacity;
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         fill_for()
+	       ---
+	       commc_bufreader_fill() that first makes room for
+	       want unread bytes.
+
+*/
+
+static commc_error_t fill_for(commc_bufreader_t* reader,
+                              size_t             want) {
+
+    commc_error_t result;
+    size_t        received;
+
+    if (reader->at_end) {
+
+        return COMMC_ERROR_CONNECTION_CLOSED;
+
+    }
+
+    result = make_room(reader, want);
+
+    if (result != COMMC_SUCCESS) {
+
+        return result;
+
+    }
+
+    result = receive_into(reader, reader->buffer + reader->end,
+                          reader->capacity - reader->end, &received);
+
+    if (result != COMMC_SUCCESS) {
+
+        return result;
+
+    }
+
+    if (received == 0) {
+
+        reader->at_end = 1;
+        return COMMC_ERROR_CONNECTION_CLOSED;
+
+    }
+
+    reader->end += received;
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         find_delimiter()
+	       ---
+	       searches the unread bytes not searched before
+	       for delimiter. returns its offset from start, or
+	       -1 after recording how far the search got.
+
+*/
+
+static long find_delimiter(commc_bufreader_t* reader,
+                           const char*        delimiter,
+                           size_t             delimiter_length) {
+
+    const char* window = reader->buffer + reader->start;
+    size_t      available = reader->end - reader->start;
+    size_t      position;
+    const char* hit;
+
+    position = reader->scanned;
+
+    if (position >= delimiter_length - 1) {
+
+        position -= delimiter_length - 1;    /* a match may straddle the old end */
+
+    } else {
+
+        position = 0;
+
+    }
+
+    while (position + delimiter_length <= available) {
+
+        hit = (const char*)memchr(window + position, delimiter[0],
+                                  available - position - delimiter_length + 1);
+
+        if (!hit) {
+
+            break;
+
+        }
+
+        position = (size_t)(hit - window);
+
+        if (memcmp(hit, delimiter, delimiter_length) == 0) {
+
+            return (long)position;
+
+        }
+
+        position++;
+
+    }
+
+    reader->scanned = available;
+
+    return -1;
+
+}
+
+/*
+	==================================
+             --- CORE ---
+	==================================
+*/
+
+/*
+
+         commc_bufreader_create()
+	       ---
+	       creates a reader over a commc_socket_t.
+
+*/
+
+commc_error_t commc_bufreader_create(commc_bufreader_t** reader,
+                                     commc_socket_t*     socket,
+                                     size_t              initial_size,
+                                     size_t              max_size) {
+
+    if (!reader || !socket) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    return create_reader(reader, socket, COMMC_INVALID_SOCKET, initial_size, max_size);
+
+}
+
+/*
+
+         commc_bufreader_create_fd()
+	       ---
+	       creates a reader over a raw socket descriptor.
+
+*/
+
+commc_error_t commc_bufreader_create_fd(commc_bufreader_t** reader,
+                                        int                 socket_fd,
+                                        size_t              initial_size,
+                                        size_t              max_size) {
+
+    if (!reader || socket_fd == COMMC_INVALID_SOCKET) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    return create_reader(reader, NULL, socket_fd, initial_size, max_size);
+
+}
+
+/*
+
+         commc_bufreader_destroy()
+	       ---
+	       frees the buffer and the reader.
+
+*/
+
+void commc_bufreader_destroy(commc_bufreader_t* reader) {
+
+    if (!reader) {
+
+        return;
+
+    }
+
+    free(reader->buffer);
+    free(reader);
+
+}
+
+/*
+	==================================
+             --- READING ---
+	==================================
+*/
+
+/*
+
+         commc_bufreader_read_line()
+	       ---
+	       cuts the next line out of the buffer, filling it
+	       until a LF shows up.
+
+*/
+
+commc_error_t commc_bufreader_read_line(commc_bufreader_t* reader,
+                                        char**             line,
+                                        size_t*            length) {
+
+    commc_error_t result;
+    long          offset;
+    size_t        line_length;
+
+    if (!reader || !line || !length) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    for (;;) {
+
+        offset = find_delimiter(reader, "\n", 1);
+
+        if (offset >= 0) {
+
+            line_length = (size_t)offset;
+
+            if (line_length > 0 && reader->buffer[reader->start + line_length - 1] == '\r') {
+
+                line_length--;
+
+            }
+
+            *line   = reader->buffer + reader->start;
+            *length = line_length;
+
+            (*line)[line_length] = '\0';
+
+            commc_bufreader_consume(reader, (size_t)offset + 1);
+            reader->scanned = 0;
+
+            return COMMC_SUCCESS;
+
+        }
+
+        result = fill_for(reader, reader->end - reader->start + 1);
+
+        if (result == COMMC_ERROR_CONNECTION_CLOSED && reader->end > reader->start) {
+
+            /* last line, without LF */
+
+            *line   = reader->buffer + reader->start;
+            *length = reader->end - reader->start;
+
+            (*line)[*length] = '\0';
+
+            commc_bufreader_consume(reader, *length);
+            reader->scanned = 0;
+
+            return COMMC_SUCCESS;
+
+        }
+
+        if (result != COMMC_SUCCESS) {
+
+            return result;
+
+        }
+
+    }
+
+}
+
+/*
+
+         commc_bufreader_read_until()
+	       ---
+	       cuts everything through the next delimiter out of
+	       the buffer.
+
+*/
+
+commc_error_t commc_bufreader_read_until(commc_bufreader_t* reader,
+                                         const char*        delimiter,
+                                         size_t             delimiter_length,
+                                         const char**       data,
+                                         size_t*            length) {
+
+    commc_error_t result;
+    long          offset;
+
+    if (!reader || !delimiter || delimiter_length == 0 || !data || !length) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    for (;;) {
+
+        offset = find_delimiter(reader, delimiter, delimiter_length);
+
+        if (offset >= 0) {
+
+            *data   = reader->buffer + reader->start;
+            *length = (size_t)offset + delimiter_length;
+
+            commc_bufreader_consume(reader, *length);
+            reader->scanned = 0;
+
+            return COMMC_SUCCESS;
+
+        }
+
+        result = fill_for(reader, reader->end - reader->start + 1);
+
+        if (result != COMMC_SUCCESS) {
+
+            return result;
+
+        }
+
+    }
+
+}
+
+/*
+
+         commc_bufreader_read_exact()
+	       ---
+	       drains the buffer into the caller's, then
+	       receives the rest directly when it is at least a
+	       buffer's worth.
+
+*/
+
+commc_error_t commc_bufreader_read_exact(commc_bufreader_t* reader,
+                                         void*              buffer,
+                                         size_t             length) {
+
+    char*         destination = (char*)buffer;
+    size_t        copied;
+    size_t        received;
+    commc_error_t result;
+
+    if (!reader || (!buffer && length > 0)) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    while (length > 0) {
+
+        if (reader->end == reader->start && length >= reader->capacity && !reader->at_end) {
+
+            result = receive_into(reader, destination, length, &received);
+
+            if (result != COMMC_SUCCESS) {
+
+                return result;
+
+            }
+
+            if (received == 0) {
+
+                reader->at_end = 1;
+                return COMMC_ERROR_CONNECTION_CLOSED;
+
+            }
+
+            destination += received;
+            length      -= received;
+
+            continue;
+
+        }
+
+        if (reader->end == reader->start) {
+
+            result = fill_for(reader, 1);
+
+            if (result != COMMC_SUCCESS) {
+
+                return result;
+
+            }
+
+        }
+
+        copied = reader->end - reader->start;
+
+        if (copied > length) {
+
+            copied = length;
+
+        }
+
+        memcpy(destination, reader->buffer + reader->start, copied);
+
+        commc_bufreader_consume(reader, copied);
+        destination += copied;
+        length      -= copied;
+
+    }
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_bufreader_read()
+	       ---
+	       hands out buffered bytes first, and receives at
+	       most once.
+
+*/
+
+commc_error_t commc_bufreader_read(commc_bufreader_t* reader,
+                                   void*              buffer,
+                                   size_t             size,
+                                   size_t*            bytes_read) {
+
+    size_t        copied;
+    commc_error_t result;
+
+    if (!reader || !buffer || !bytes_read) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    *bytes_read = 0;
+
+    if (size == 0) {
+
+        return COMMC_SUCCESS;
+
+    }
+
+    if (reader->end == reader->start) {
+
+        if (reader->at_end) {
+
+            return COMMC_ERROR_CONNECTION_CLOSED;
+
+        }
+
+        if (size >= reader->capacity) {
+
+            result = receive_into(reader, (char*)buffer, size, bytes_read);
+
+            if (result == COMMC_SUCCESS && *bytes_read == 0) {
+
+                reader->at_end = 1;
+                return COMMC_ERROR_CONNECTION_CLOSED;
+
+            }
+
+            return result;
+
+        }
+
+        result = fill_for(reader, 1);
+
+        if (result != COMMC_SUCCESS) {
+
+            return result;
+
+        }
+
+    }
+
+    copied = reader->end - reader->start;
+
+    if (copied > size) {
+
+        copied = size;
+
+    }
+
+    memcpy(buffer, reader->buffer + reader->start, copied);
+    commc_bufreader_consume(reader, copied);
+
+    *bytes_read = copied;
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_bufreader_peek()
+	       ---
+	       fills until length bytes are buffered.
+
+*/
+
+commc_error_t commc_bufreader_peek(commc_bufreader_t* reader,
+                                   size_t             length,
+                                   const char**       data) {
+
+    commc_error_t result;
+
+    if (!reader || !data) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (length > reader->max_size) {
+
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+
+    }
+
+    while (reader->end - reader->start < length) {
+
+        result = fill_for(reader, length);
+
+        if (result != COMMC_SUCCESS) {
+
+            return result;
+
+        }
+
+    }
+
+    *data = reader->buffer + reader->start;
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+	==================================
+          --- BUFFER ACCESS ---
+	==================================
+*/
+
+/*
+
+         commc_bufreader_fill()
+	       ---
+	       receives once more.
+
+*/
+
+commc_error_t commc_bufreader_fill(commc_bufreader_t* reader) {
+
+    if (!reader) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    return fill_for(reader, reader->end - reader->start + 1);
+
+}
+
+/*
+
+         commc_bufreader_data()
+	       ---
+	       exposes the unread window.
+
+*/
+
+size_t commc_bufreader_data(const commc_bufreader_t* reader,
+                            const char**             data) {
+
+    if (!reader) {
+
+        return 0;
+
+    }
+
+    if (data) {
+
+        *data = reader->buffer + reader->start;
+
+    }
+
+    return reader->end - reader->start;
+
+}
+
+/*
+
+         commc_bufreader_consume()
+	       ---
+	       advances past bytes the caller has used.
+
+*/
+
+void commc_bufreader_consume(commc_bufreader_t* reader,
+                             size_t             length) {
+
+    size_t available;
+
+    if (!reader) {
+
+        return;
+
+    }
+
+    available = reader->end - reader->start;
+
+    if (length > available) {
+
+        length = available;
+
+    }
+
+    reader->start += length;
+
+    if (reader->scanned > length) {
+
+        reader->scanned -= length;
+
+    } else {
+
+        reader->scanned = 0;
+
+    }
+
+    if (reader->start == reader->end) {
+
+        reader->start = 0;    /* empty: reuse the whole buffer */
+        reader->end   = 0;
+
+    }
+
+}
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
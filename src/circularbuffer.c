@@ -21,6 +21,14 @@
     - overflow policies handle full buffer scenarios
     - bulk operations optimize memory copying
 
+    SPSC mode uses free-running head/tail counters instead of a
+    shared count. the producer owns the tail, the consumer owns the
+    head, and each side keeps a private copy of the other index that
+    it only refreshes (with an acquire load) when the copy says there
+    is no room or nothing to read. publication is a single release
+    store of the owning index, so a bulk transfer of N elements costs
+    one store regardless of N.
+
 */
 
 /* 
@@ -30,6 +38,7 @@
 */
 
 #include "commc/circularbuffer.h"
+#include "commc/atomic.h"   /* COMMC_ATOMIC_LOAD_ACQUIRE, COMMC_ATOMIC_STORE_RELEASE */
 #include <stdlib.h>         /* MALLOC, FREE */
 #include <string.h>         /* MEMCPY, MEMSET */
 
@@ -47,6 +56,12 @@
 	       
 	       uses head/tail indices instead of pointers to avoid
 	       complications with wraparound and memory management.
+	       
+	       the producer fields (tail, cached_head) and consumer
+	       fields (head, cached_tail) are separated by a full cache
+	       line of padding so that SPSC producers and consumers
+	       never false-share. in LOCAL mode head/tail are masked
+	       indices; in SPSC mode they are free-running counters.
 
 */
 
@@ -55,11 +70,22 @@ struct commc_circular_buffer_t {
   void*                                    data;           /* BUFFER STORAGE */
   size_t                                   capacity;       /* MAX ELEMENTS */
   size_t                                   element_size;   /* BYTES PER ELEMENT */
-  size_t                                   head;           /* READ INDEX */
-  size_t                                   tail;           /* WRITE INDEX */
-  size_t                                   count;          /* CURRENT SIZE */
+  size_t                                   count;          /* CURRENT SIZE (LOCAL MODE) */
   size_t                                   mask;           /* CAPACITY - 1 FOR FAST MODULO */
   commc_circular_buffer_overflow_policy_t  policy;         /* OVERFLOW BEHAVIOR */
+  commc_circular_buffer_mode_t             mode;           /* CONCURRENCY MODE */
+
+  char pad_shared[COMMC_CIRCULAR_BUFFER_CACHE_LINE_SIZE];
+
+  size_t                                   tail;           /* WRITE INDEX (PRODUCER) */
+  size_t                                   cached_head;    /* PRODUCER VIEW OF HEAD */
+
+  char pad_producer[COMMC_CIRCULAR_BUFFER_CACHE_LINE_SIZE];
+
+  size_t                                   head;           /* READ INDEX (CONSUMER) */
+  size_t                                   cached_tail;    /* CONSUMER VIEW OF TAIL */
+
+  char pad_consumer[COMMC_CIRCULAR_BUFFER_CACHE_LINE_SIZE];
   
 };
 
@@ -133,6 +159,259 @@ static void* buffer_get_element_ptr(const commc_circular_buffer_t* buffer, size_
   
 }
 
+/*
+
+         spsc_load_acquire()
+	       ---
+	       reads an index published by the other side. element
+	       reads cannot be hoisted above the load.
+
+*/
+
+static size_t spsc_load_acquire(const size_t* index) {
+
+  return COMMC_ATOMIC_LOAD_ACQUIRE((size_t*)index);
+
+}
+
+/*
+
+         spsc_store_release()
+	       ---
+	       publishes an owned index. every element copy made
+	       before the store is visible to the other side first.
+
+*/
+
+static void spsc_store_release(size_t* index, size_t value) {
+
+  COMMC_ATOMIC_STORE_RELEASE(index, value);
+
+}
+
+/*
+
+         spsc_copy_in()
+	       ---
+	       copies count elements into the ring starting at a
+	       free-running index, splitting into at most two
+	       memcpy calls at the wraparound point.
+
+*/
+
+static void spsc_copy_in(commc_circular_buffer_t* buffer, size_t index,
+                         const char* src, size_t count) {
+
+  size_t start;
+  size_t first;
+
+  start = index & buffer->mask;
+  first = buffer->capacity - start;
+
+  if (first > count) {
+
+    first = count;
+
+  }
+
+  memcpy((char*)buffer->data + start * buffer->element_size, src,
+         first * buffer->element_size);
+
+  if (count > first) {
+
+    memcpy(buffer->data, src + first * buffer->element_size,
+           (count - first) * buffer->element_size);
+
+  }
+
+}
+
+/*
+
+         spsc_copy_out()
+	       ---
+	       copies count elements out of the ring starting at a
+	       free-running index, mirroring spsc_copy_in().
+
+*/
+
+static void spsc_copy_out(const commc_circular_buffer_t* buffer, size_t index,
+                          char* dest, size_t count) {
+
+  size_t start;
+  size_t first;
+
+  start = index & buffer->mask;
+  first = buffer->capacity - start;
+
+  if (first > count) {
+
+    first = count;
+
+  }
+
+  memcpy(dest, (const char*)buffer->data + start * buffer->element_size,
+         first * buffer->element_size);
+
+  if (count > first) {
+
+    memcpy(dest + first * buffer->element_size, buffer->data,
+           (count - first) * buffer->element_size);
+
+  }
+
+}
+
+/*
+
+         spsc_size()
+	       ---
+	       snapshot of the element count in SPSC mode. head is
+	       read first so the difference can only overestimate,
+	       and is clamped to the capacity.
+
+*/
+
+static size_t spsc_size(const commc_circular_buffer_t* buffer) {
+
+  size_t head;
+  size_t tail;
+
+  head = spsc_load_acquire(&buffer->head);
+  tail = spsc_load_acquire(&buffer->tail);
+
+  return (tail - head > buffer->capacity) ? buffer->capacity : tail - head;
+
+}
+
+/*
+
+         spsc_push_bulk()
+	       ---
+	       producer side of SPSC mode. copies as many elements
+	       as fit and publishes them with one release store.
+
+*/
+
+static size_t spsc_push_bulk(commc_circular_buffer_t* buffer,
+                             const char* src, size_t count) {
+
+  size_t tail;
+  size_t free_slots;
+
+  tail       = buffer->tail;
+  free_slots = buffer->capacity - (tail - buffer->cached_head);
+
+  /* only touch the consumer's cache line when the cached view is short */
+
+  if (free_slots < count) {
+
+    buffer->cached_head = spsc_load_acquire(&buffer->head);
+    free_slots          = buffer->capacity - (tail - buffer->cached_head);
+
+  }
+
+  if (free_slots == 0) {
+
+    return 0;
+
+  }
+
+  if (count > free_slots) {
+
+    count = free_slots;
+
+  }
+
+  spsc_copy_in(buffer, tail, src, count);
+  spsc_store_release(&buffer->tail, tail + count);
+
+  return count;
+
+}
+
+/*
+
+         spsc_pop_bulk()
+	       ---
+	       consumer side of SPSC mode. copies (or discards) as
+	       many elements as are available and returns the slots
+	       to the producer with one release store.
+
+*/
+
+static size_t spsc_pop_bulk(commc_circular_buffer_t* buffer,
+                            char* dest, size_t count) {
+
+  size_t head;
+  size_t available;
+
+  head      = buffer->head;
+  available = buffer->cached_tail - head;
+
+  /* only touch the producer's cache line when the cached view is short */
+
+  if (available < count) {
+
+    buffer->cached_tail = spsc_load_acquire(&buffer->tail);
+    available           = buffer->cached_tail - head;
+
+  }
+
+  if (available == 0) {
+
+    return 0;
+
+  }
+
+  if (count > available) {
+
+    count = available;
+
+  }
+
+  if (dest) {
+
+    spsc_copy_out(buffer, head, dest, count);
+
+  }
+
+  spsc_store_release(&buffer->head, head + count);
+
+  return count;
+
+}
+
+/*
+
+         spsc_peek_at()
+	       ---
+	       consumer-side read of the element at offset from the
+	       head without consuming it.
+
+*/
+
+static commc_error_t spsc_peek_at(const commc_circular_buffer_t* buffer,
+                                  size_t offset, void* data) {
+
+  size_t head;
+  size_t tail;
+
+  head = buffer->head;
+  tail = spsc_load_acquire(&buffer->tail);
+
+  if (offset >= tail - head) {
+
+    return (tail == head) ? COMMC_FAILURE : COMMC_ARGUMENT_ERROR;
+
+  }
+
+  spsc_copy_out(buffer, head + offset, (char*)data, 1);
+
+  return COMMC_SUCCESS;
+
+}
+
 /* 
 	==================================
              --- CORE API ---
@@ -216,14 +495,43 @@ commc_circular_buffer_t* commc_circular_buffer_create_with_policy(size_t capacit
   buffer->element_size = element_size;
   buffer->head         = 0;
   buffer->tail         = 0;
+  buffer->cached_head  = 0;
+  buffer->cached_tail  = 0;
   buffer->count        = 0;
   buffer->mask         = actual_capacity - 1; /* for fast modulo with powers of 2 */
   buffer->policy       = policy;
+  buffer->mode         = COMMC_CIRCULAR_BUFFER_MODE_LOCAL;
   
   return buffer;
   
 }
 
+/*
+
+         commc_circular_buffer_create_spsc()
+	       ---
+	       creates buffer in single-producer/single-consumer mode.
+
+*/
+
+commc_circular_buffer_t* commc_circular_buffer_create_spsc(size_t capacity,
+                                                           size_t element_size) {
+
+  commc_circular_buffer_t* buffer;
+
+  buffer = commc_circular_buffer_create_with_policy(capacity, element_size,
+                                                    COMMC_CIRCULAR_BUFFER_REJECT);
+
+  if (buffer) {
+
+    buffer->mode = COMMC_CIRCULAR_BUFFER_MODE_SPSC;
+
+  }
+
+  return buffer;
+
+}
+
 /*
 
          commc_circular_buffer_destroy()
@@ -269,7 +577,19 @@ size_t commc_circular_buffer_capacity(const commc_circular_buffer_t* buffer) {
 
 size_t commc_circular_buffer_size(const commc_circular_buffer_t* buffer) {
 
-  return buffer ? buffer->count : 0;
+  if (!buffer) {
+
+    return 0;
+
+  }
+
+  if (buffer->mode == COMMC_CIRCULAR_BUFFER_MODE_SPSC) {
+
+    return spsc_size(buffer);
+
+  }
+
+  return buffer->count;
   
 }
 
@@ -289,7 +609,7 @@ size_t commc_circular_buffer_available_space(const commc_circular_buffer_t* buff
     
   }
   
-  return buffer->capacity - buffer->count;
+  return buffer->capacity - commc_circular_buffer_size(buffer);
   
 }
 
@@ -303,7 +623,7 @@ size_t commc_circular_buffer_available_space(const commc_circular_buffer_t* buff
 
 int commc_circular_buffer_is_empty(const commc_circular_buffer_t* buffer) {
 
-  return buffer ? (buffer->count == 0) : 1;
+  return buffer ? (commc_circular_buffer_size(buffer) == 0) : 1;
   
 }
 
@@ -317,7 +637,7 @@ int commc_circular_buffer_is_empty(const commc_circular_buffer_t* buffer) {
 
 int commc_circular_buffer_is_full(const commc_circular_buffer_t* buffer) {
 
-  return buffer ? (buffer->count == buffer->capacity) : 0;
+  return buffer ? (commc_circular_buffer_size(buffer) == buffer->capacity) : 0;
   
 }
 
@@ -345,6 +665,12 @@ commc_error_t commc_circular_buffer_push(commc_circular_buffer_t* buffer, const
     
   }
 
+  if (buffer->mode == COMMC_CIRCULAR_BUFFER_MODE_SPSC) {
+
+    return spsc_push_bulk(buffer, (const char*)data, 1) ? COMMC_SUCCESS : COMMC_FAILURE;
+
+  }
+
   /* check if buffer is full */
   
   if (buffer->count == buffer->capacity) {
@@ -413,6 +739,12 @@ commc_error_t commc_circular_buffer_pop(commc_circular_buffer_t* buffer, void* d
     return COMMC_ARGUMENT_ERROR;
     
   }
+
+  if (buffer->mode == COMMC_CIRCULAR_BUFFER_MODE_SPSC) {
+
+    return spsc_pop_bulk(buffer, (char*)data, 1) ? COMMC_SUCCESS : COMMC_FAILURE;
+
+  }
   
   if (buffer->count == 0) {
 
@@ -462,6 +794,12 @@ commc_error_t commc_circular_buffer_peek(const commc_circular_buffer_t* buffer,
     return COMMC_ARGUMENT_ERROR;
     
   }
+
+  if (buffer->mode == COMMC_CIRCULAR_BUFFER_MODE_SPSC) {
+
+    return spsc_peek_at(buffer, 0, data);
+
+  }
   
   if (buffer->count == 0) {
 
@@ -502,6 +840,12 @@ commc_error_t commc_circular_buffer_peek_at(const commc_circular_buffer_t* buffe
     return COMMC_ARGUMENT_ERROR;
     
   }
+
+  if (buffer->mode == COMMC_CIRCULAR_BUFFER_MODE_SPSC) {
+
+    return spsc_peek_at(buffer, offset, data);
+
+  }
   
   if (offset >= buffer->count) {
 
@@ -540,9 +884,11 @@ void commc_circular_buffer_clear(commc_circular_buffer_t* buffer) {
     
   }
   
-  buffer->head  = 0;
-  buffer->tail  = 0;
-  buffer->count = 0;
+  buffer->head        = 0;
+  buffer->tail        = 0;
+  buffer->cached_head = 0;
+  buffer->cached_tail = 0;
+  buffer->count       = 0;
   
 }
 
@@ -574,6 +920,12 @@ size_t commc_circular_buffer_push_bulk(commc_circular_buffer_t* buffer,
     return 0;
     
   }
+
+  if (buffer->mode == COMMC_CIRCULAR_BUFFER_MODE_SPSC) {
+
+    return spsc_push_bulk(buffer, (const char*)data, count);
+
+  }
   
   src_ptr        = (const char*)data;
   elements_added = 0;
@@ -650,6 +1002,12 @@ size_t commc_circular_buffer_pop_bulk(commc_circular_buffer_t* buffer,
     return 0;
     
   }
+
+  if (buffer->mode == COMMC_CIRCULAR_BUFFER_MODE_SPSC) {
+
+    return spsc_pop_bulk(buffer, (char*)data, count);
+
+  }
   
   dest_ptr        = (char*)data;
   elements_removed = 0;
@@ -705,8 +1063,8 @@ commc_circular_buffer_iterator_t commc_circular_buffer_iterator_begin(const comm
   commc_circular_buffer_iterator_t iterator;
   
   iterator.buffer   = buffer;
-  iterator.position = buffer ? buffer->head : 0;
-  iterator.count    = buffer ? buffer->count : 0;
+  iterator.position = buffer ? (buffer->head & buffer->mask) : 0;
+  iterator.count    = commc_circular_buffer_size(buffer);
   
   return iterator;
   
@@ -834,6 +1192,15 @@ commc_error_t commc_circular_buffer_set_overflow_policy(commc_circular_buffer_t*
     return COMMC_ARGUMENT_ERROR;
     
   }
+
+  /* only the consumer may advance an SPSC head */
+
+  if (buffer->mode == COMMC_CIRCULAR_BUFFER_MODE_SPSC &&
+      policy != COMMC_CIRCULAR_BUFFER_REJECT) {
+
+    return COMMC_ARGUMENT_ERROR;
+
+  }
   
   buffer->policy = policy;
   
@@ -855,6 +1222,20 @@ size_t commc_circular_buffer_element_size(const commc_circular_buffer_t* buffer)
   
 }
 
+/*
+
+         commc_circular_buffer_get_mode()
+	       ---
+	       returns the concurrency mode of the buffer.
+
+*/
+
+commc_circular_buffer_mode_t commc_circular_buffer_get_mode(const commc_circular_buffer_t* buffer) {
+
+  return buffer ? buffer->mode : COMMC_CIRCULAR_BUFFER_MODE_LOCAL;
+
+}
+
 /*
 
          commc_circular_buffer_memory_usage()
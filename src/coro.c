@@ -0,0 +1,379 @@
+/*
+   ===================================
+   C O M M O N - C
+   STACKLESS COROUTINE IMPLEMENTATION
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+            --- STACKLESS COROUTINE IMPLEMENTATION ---
+
+    every await passes io_done() or timer_fired() as the
+    commc_async callback with the coroutine as user data;
+    the callback stores the result and re-enters the body.
+    a timeout shares the coroutine's single timer with
+    sleeps: while an I/O await is pending the timer means
+    "give up", which cancels the handle and turns the
+    resulting ECANCELED into ETIMEDOUT.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#include "commc/coro.h"
+#include "commc/async.h"
+#include "commc/error.h"
+
+#include <errno.h>
+#include <string.h>
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         io_done()
+	       ---
+	       completion callback of every I/O await.
+
+*/
+
+static void io_done(const commc_async_result_t* result) {
+
+  commc_coro_t* co = (commc_coro_t*)result->user_data;
+
+  if (co->timer.active) {
+    commc_async_timer_stop(co->ctx, &co->timer);
+  }
+
+  co->result = *result;
+
+  if (co->timed_out) {
+    co->result.error_code = ETIMEDOUT;
+    co->timed_out = 0;
+  }
+
+  co->wait_handle = -1;
+  commc_coro_resume(co);
+
+}
+
+/*
+
+         timer_fired()
+	       ---
+	       ends a sleep, or times out the pending I/O. the
+	       cancellation completes it through io_done().
+
+*/
+
+static void timer_fired(const commc_async_result_t* result) {
+
+  commc_coro_t* co = (commc_coro_t*)result->user_data;
+
+  if (co->wait_handle >= 0) {
+    co->timed_out = 1;
+    commc_async_cancel(co->ctx, co->wait_handle);
+    return;
+  }
+
+  co->result = *result;
+  commc_coro_resume(co);
+
+}
+
+/*
+
+         yield_task()
+	       ---
+	       posted by commc_coro_yield().
+
+*/
+
+static void yield_task(void* arg) {
+
+  commc_coro_t* co = (commc_coro_t*)arg;
+
+  memset(&co->result, 0, sizeof(co->result));
+  co->result.handle = -1;
+  commc_coro_resume(co);
+
+}
+
+/*
+
+         arm_timeout()
+	       ---
+	       records the handle an I/O await waits on and
+	       starts its timeout, if one is set.
+
+*/
+
+static int arm_timeout(commc_coro_t* co, int handle) {
+
+  co->wait_handle = handle;
+  co->timed_out = 0;
+
+  if (co->timeout_ms > 0) {
+    commc_async_timer_start(co->ctx, &co->timer, co->timeout_ms, 0);
+  }
+
+  return 0;
+
+}
+
+/*
+	==================================
+             --- CORE API ---
+	==================================
+*/
+
+/*
+
+         commc_coro_start()
+	       ---
+	       initializes the await state and runs the body.
+
+*/
+
+commc_error_t commc_coro_start(commc_coro_t* co,
+                               commc_async_context_t* ctx,
+                               commc_coro_fn fn,
+                               commc_coro_done_fn on_done) {
+
+  if (!co || !ctx || !fn) {
+    return COMMC_ARGUMENT_ERROR;
+  }
+
+  co->line = 0;
+  co->finished = 0;
+  co->fn = fn;
+  co->on_done = on_done;
+  co->ctx = ctx;
+  co->timeout_ms = 0;
+  co->wait_handle = -1;
+  co->timed_out = 0;
+
+  memset(&co->result, 0, sizeof(co->result));
+  co->result.handle = -1;
+
+  commc_async_timer_init(&co->timer, timer_fired, co);
+  commc_async_task_init(&co->task, yield_task, co);
+
+  commc_coro_resume(co);
+  return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_coro_resume()
+	       ---
+	       re-enters the body; the done hook is the last
+	       thing to touch co.
+
+*/
+
+void commc_coro_resume(commc_coro_t* co) {
+
+  if (!co || co->finished) {
+    return;
+  }
+
+  if (co->fn(co) == COMMC_CORO_DONE) {
+
+    co->finished = 1;
+
+    if (co->on_done) {
+      co->on_done(co);
+    }
+
+  }
+
+}
+
+/*
+
+         commc_coro_set_timeout()
+	       ---
+	       sets the bound applied to later I/O awaits.
+
+*/
+
+void commc_coro_set_timeout(commc_coro_t* co,
+                            unsigned long timeout_ms) {
+
+  if (co) {
+    co->timeout_ms = timeout_ms;
+  }
+
+}
+
+/*
+
+         commc_coro_suspend()
+	       ---
+	       decides between suspending and reporting a
+	       failed submission.
+
+*/
+
+int commc_coro_suspend(commc_coro_t* co,
+                       int submit_status) {
+
+  if (submit_status == 0) {
+    return 1;
+  }
+
+  memset(&co->result, 0, sizeof(co->result));
+  co->result.handle = -1;
+  co->result.error_code = COMMC_CORO_SUBMIT_FAILED;
+  return 0;
+
+}
+
+/*
+	==================================
+             --- AWAITABLE OPERATIONS ---
+	==================================
+*/
+
+/*
+
+         commc_coro_read()
+	       ---
+	       reads into buffer, resuming co.
+
+*/
+
+int commc_coro_read(commc_coro_t* co,
+                    int handle,
+                    void* buffer,
+                    size_t size) {
+
+  if (!co || commc_async_read(co->ctx, handle, buffer, size, io_done, co) != 0) {
+    return -1;
+  }
+
+  return arm_timeout(co, handle);
+
+}
+
+/*
+
+         commc_coro_write()
+	       ---
+	       writes from buffer, resuming co.
+
+*/
+
+int commc_coro_write(commc_coro_t* co,
+                     int handle,
+                     const void* buffer,
+                     size_t size) {
+
+  if (!co || commc_async_write(co->ctx, handle, buffer, size, io_done, co) != 0) {
+    return -1;
+  }
+
+  return arm_timeout(co, handle);
+
+}
+
+/*
+
+         commc_coro_accept()
+	       ---
+	       accepts a connection, resuming co.
+
+*/
+
+int commc_coro_accept(commc_coro_t* co,
+                      int listen_handle,
+                      int* accept_handle,
+                      void* address,
+                      size_t address_size) {
+
+  if (!co || commc_async_accept(co->ctx, listen_handle, accept_handle,
+                                address, address_size, io_done, co) != 0) {
+    return -1;
+  }
+
+  return arm_timeout(co, listen_handle);
+
+}
+
+/*
+
+         commc_coro_connect()
+	       ---
+	       connects handle, resuming co.
+
+*/
+
+int commc_coro_connect(commc_coro_t* co,
+                       int handle,
+                       const void* address,
+                       size_t address_size) {
+
+  if (!co || commc_async_connect(co->ctx, handle, address, address_size,
+                                 io_done, co) != 0) {
+    return -1;
+  }
+
+  return arm_timeout(co, handle);
+
+}
+
+/*
+
+         commc_coro_sleep()
+	       ---
+	       arms the coroutine's timer as a plain delay.
+
+*/
+
+int commc_coro_sleep(commc_coro_t* co,
+                     unsigned long ms) {
+
+  if (!co) {
+    return -1;
+  }
+
+  co->wait_handle = -1;
+  return commc_async_timer_start(co->ctx, &co->timer, ms, 0);
+
+}
+
+/*
+
+         commc_coro_yield()
+	       ---
+	       posts the coroutine's embedded task.
+
+*/
+
+int commc_coro_yield(commc_coro_t* co) {
+
+  if (!co) {
+    return -1;
+  }
+
+  return commc_async_post_task(co->ctx, &co->task);
+
+}
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
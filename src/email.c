@@ -34,6 +34,7 @@
 
 #include "commc/email.h"
 #include "commc/error.h"
+#include "commc/mime.h"
 
 /* 
 	==================================
@@ -132,6 +133,38 @@ static int is_valid_email_char(char c) {
             
 }
 
+/*
+
+         compare_ignoring_case()
+	       ---
+	       compares two strings without regard
+	       to ASCII case, as strcasecmp() does.
+
+*/
+
+static int compare_ignoring_case(const char* a, const char* b) {
+
+    int difference;
+    
+    while (*a && *b) {
+    
+        difference = tolower((unsigned char)*a) - tolower((unsigned char)*b);
+        
+        if (difference != 0) {
+        
+            return difference;
+            
+        }
+        
+        a++;
+        b++;
+        
+    }
+    
+    return tolower((unsigned char)*a) - tolower((unsigned char)*b);
+    
+}
+
 /*
 
          find_header_end()
@@ -240,6 +273,141 @@ static void unfold_header(char* header) {
     
 }
 
+/*
+
+         file_context_t
+	       ---
+	       what commc_email_parse_from_file() carries
+	       between MIME parser events.
+
+*/
+
+typedef struct {
+
+    commc_mime_parser_t*   parser;
+    commc_email_message_t* message;
+    int                    body_found;       /* A BODY PART WAS CHOSEN */
+    size_t                 body_index;       /* ITS INDEX AMONG THE PARTS */
+    size_t                 body_capacity;    /* BYTES ALLOCATED FOR MESSAGE->BODY */
+
+} file_context_t;
+
+/*
+
+         file_event()
+	       ---
+	       MIME parser callback of
+	       commc_email_parse_from_file(). the message's
+	       own header fields go through
+	       commc_email_parse_headers(); the decoded text
+	       of the first text/plain part that is not an
+	       attachment becomes the body, and every other
+	       body is skipped.
+
+*/
+
+static commc_error_t file_event(const commc_mime_event_t* event,
+                                void*                     user_data) {
+
+    file_context_t* context = (file_context_t*)user_data;
+    commc_email_message_t* message = context->message;
+    const commc_mime_part_t* part = event->part;
+    char line_buffer[EMAIL_LINE_BUFFER_SIZE];
+    size_t value_length;
+    size_t needed;
+    
+    if (event->type == COMMC_MIME_EVENT_HEADER) {
+    
+        /* Only fields of the message itself, as "Name: value" lines */
+        
+        if (part->depth != 0 || event->name_length >= COMMC_EMAIL_MAX_HEADER_NAME_LENGTH) {
+        
+            return COMMC_SUCCESS;
+            
+        }
+        
+        value_length = event->value_length;
+        
+        if (value_length >= COMMC_EMAIL_MAX_HEADER_VALUE_LENGTH) {
+        
+            value_length = COMMC_EMAIL_MAX_HEADER_VALUE_LENGTH - 1;
+            
+        }
+        
+        memcpy(line_buffer, event->name, event->name_length);
+        line_buffer[event->name_length] = EMAIL_HEADER_SEPARATOR;
+        line_buffer[event->name_length + 1] = ' ';
+        memcpy(line_buffer + event->name_length + 2, event->value, value_length);
+        
+        return commc_email_parse_headers(line_buffer, event->name_length + 2 + value_length, message);
+        
+    }
+    
+    if (event->type == COMMC_MIME_EVENT_BODY_BEGIN) {
+    
+        if (!context->body_found && !part->is_multipart && !part->is_attachment &&
+            strcmp(part->content_type, "text/plain") == 0) {
+        
+            context->body_found = 1;
+            context->body_index = part->index;
+            
+        }
+        
+        return COMMC_SUCCESS;
+        
+    }
+    
+    if (event->type != COMMC_MIME_EVENT_BODY_DATA) {
+    
+        return COMMC_SUCCESS;
+        
+    }
+    
+    /* Data of any other part is not wanted */
+    
+    if (!context->body_found || part->index != context->body_index) {
+    
+        commc_mime_parser_skip_body(context->parser);
+        return COMMC_SUCCESS;
+        
+    }
+    
+    /* Grow the body by doubling, keeping it terminated */
+    
+    needed = message->body_length + event->data_length + 1;
+    
+    if (needed > context->body_capacity) {
+    
+        size_t capacity = context->body_capacity ? context->body_capacity : COMMC_MIME_OUTPUT_SIZE;
+        char* body;
+        
+        while (capacity < needed) {
+        
+            capacity *= 2;
+            
+        }
+        
+        body = realloc(message->body, capacity);
+        
+        if (!body) {
+        
+            return COMMC_MEMORY_ERROR;
+            
+        }
+        
+        message->body = body;
+        context->body_capacity = capacity;
+        
+    }
+    
+    memcpy(message->body + message->body_length, event->data, event->data_length);
+    message->body_length += event->data_length;
+    message->body[message->body_length] = '\0';
+    
+    return COMMC_SUCCESS;
+    
+}
+
 /* 
 	==================================
         --- MESSAGE MANAGEMENT ---
@@ -614,7 +782,7 @@ commc_error_t commc_email_parse_headers(const char*            header_data,
     
     /* Process headers line by line */
     
-    while (pos <= data_length) {
+    while (line_start < data_length) {
     
         char* colon_pos;
         char header_name[COMMC_EMAIL_MAX_HEADER_NAME_LENGTH];
@@ -691,7 +859,7 @@ commc_error_t commc_email_parse_headers(const char*            header_data,
                     
                     /* Process important headers */
                     
-                    if (strcasecmp(header_name, "Subject") == 0) {
+                    if (compare_ignoring_case(header_name, "Subject") == 0) {
                     
                         if (strlen(header_value) < sizeof(message->subject)) {
                         
@@ -699,16 +867,16 @@ commc_error_t commc_email_parse_headers(const char*            header_data,
                             
                         }
                         
-                    } else if (strcasecmp(header_name, "From") == 0) {
+                    } else if (compare_ignoring_case(header_name, "From") == 0) {
                     
                         commc_email_parse_address(header_value, &message->from);
                         
-                    } else if (strcasecmp(header_name, "To") == 0) {
+                    } else if (compare_ignoring_case(header_name, "To") == 0) {
                     
                         commc_email_parse_address_list(header_value, message->to, 
                                                        COMMC_EMAIL_MAX_RECIPIENTS, &message->to_count);
                                                        
-                    } else if (strcasecmp(header_name, "Content-Type") == 0) {
+                    } else if (compare_ignoring_case(header_name, "Content-Type") == 0) {
                     
                         if (strlen(header_value) < sizeof(message->content_type)) {
                         
@@ -716,7 +884,7 @@ commc_error_t commc_email_parse_headers(const char*            header_data,
                             
                         }
                         
-                    } else if (strcasecmp(header_name, "Message-ID") == 0) {
+                    } else if (compare_ignoring_case(header_name, "Message-ID") == 0) {
                     
                         if (strlen(header_value) < sizeof(message->message_id)) {
                         
@@ -724,7 +892,7 @@ commc_error_t commc_email_parse_headers(const char*            header_data,
                             
                         }
                         
-                    } else if (strcasecmp(header_name, "Date") == 0) {
+                    } else if (compare_ignoring_case(header_name, "Date") == 0) {
                     
                         if (strlen(header_value) < sizeof(message->date)) {
                         
@@ -1084,7 +1252,7 @@ commc_error_t commc_email_get_header(const commc_email_message_t* message,
     if (!message || !header_name || !header_value) return COMMC_ERROR_INVALID_ARGUMENT;
     
     for (i = 0; i < message->header_count; i++) {
-        if (strcasecmp(message->headers[i].name, header_name) == 0) {
+        if (compare_ignoring_case(message->headers[i].name, header_name) == 0) {
             if (strlen(message->headers[i].value) >= value_buffer_size) {
                 return COMMC_ERROR_BUFFER_TOO_SMALL;
             }
@@ -1241,11 +1409,56 @@ commc_error_t commc_email_create_simple(commc_email_message_t** message,
     return COMMC_NOT_IMPLEMENTED_ERROR;
 }
 
+/*
+
+         commc_email_parse_from_file()
+	       ---
+	       parses the email message in a file with the
+	       streaming MIME parser (mime.h), so the file is
+	       mapped or read in pieces rather than loaded.
+	       the body is the decoded text of the first
+	       text/plain part that is not an attachment.
+
+*/
+
 commc_error_t commc_email_parse_from_file(const char*            filename,
                                           commc_email_message_t* message) {
-    /* Stub - parse email from file */
-    if (!filename || !message) return COMMC_ERROR_INVALID_ARGUMENT;
-    return COMMC_NOT_IMPLEMENTED_ERROR;
+
+    file_context_t context;
+    commc_error_t result;
+    
+    if (!filename || !message) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    result = commc_email_message_clear(message);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    context.message = message;
+    context.body_found = 0;
+    context.body_index = 0;
+    context.body_capacity = 0;
+    
+    result = commc_mime_parser_create(&context.parser, file_event, &context);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    result = commc_mime_parser_parse_file(context.parser, filename);
+    commc_mime_parser_destroy(context.parser);
+    
+    return result;
+    
 }
 
 commc_error_t commc_email_save_to_file(const commc_email_message_t* message,
@@ -0,0 +1,817 @@
+/*
+   ===================================
+   C O M M O N - C
+   EPOCH-BASED RECLAMATION IMPLEMENTATION
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+            --- EPOCH RECLAMATION IMPLEMENTATION ---
+
+    the global epoch advances in steps of two so that a record's
+    state can pack its observed epoch and an "active" bit into a
+    single word. the epoch may advance from E only when every
+    active record has observed E. an object retired while the
+    global epoch was E is therefore safe once the epoch reaches
+    E + 2 (two advances): every thread active at retire time has
+    since left its critical section or reported quiescence.
+
+    each record keeps three limbo lists indexed by epoch modulo
+    three. only the owning thread touches its lists, so retire
+    and reclaim are free of atomic read-modify-writes; the only
+    shared writes are the record state and the epoch CAS.
+
+    memory ordering follows the usual EBR pairing: entering a
+    critical section publishes the state and then issues a full
+    fence before any shared pointer is read; retire reads the
+    global epoch with a sequentially consistent load after the
+    object has been unlinked.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+  #define _POSIX_C_SOURCE 200112L  /* PTHREAD KEYS */
+#endif
+
+#include "commc/epoch.h"
+#include "commc/atomic.h"
+#include "commc/error.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <pthread.h>
+#endif
+
+/*
+	==================================
+             --- CONSTANTS ---
+	==================================
+*/
+
+#define COMMC_EPOCH_CACHE_LINE  64      /* FALSE-SHARING PADDING */
+#define COMMC_EPOCH_STEP        2UL     /* EPOCH INCREMENT (LOW BIT IS ACTIVE FLAG) */
+#define COMMC_EPOCH_ACTIVE      1UL     /* RECORD STATE: IN CRITICAL SECTION */
+#define COMMC_EPOCH_LISTS       3       /* LIMBO LISTS PER RECORD */
+
+/* the msvc backend of commc/atomic.h operates on long, which is
+   narrower than a pointer on win64, so pointer CAS goes through
+   the pointer-sized intrinsic there. */
+
+#if defined(_MSC_VER)
+  #define EPOCH_CAS_PTR(ptr, old, new) \
+    (InterlockedCompareExchangePointer((PVOID volatile*)(ptr), (PVOID)(new), (PVOID)(old)) == (PVOID)(old))
+  #define EPOCH_LOAD_PTR(ptr)          (*(void* volatile*)(ptr))
+#else
+  #define EPOCH_CAS_PTR(ptr, old, new) COMMC_ATOMIC_CAS((ptr), (old), (new))
+  #define EPOCH_LOAD_PTR(ptr)          COMMC_ATOMIC_LOAD_ACQUIRE(ptr)
+#endif
+
+/*
+	==================================
+             --- INTERNAL TYPES ---
+	==================================
+*/
+
+#ifdef _WIN32
+  typedef DWORD         epoch_key_t;
+#else
+  typedef pthread_key_t epoch_key_t;
+#endif
+
+/*
+
+         epoch_limbo_t
+	       ---
+	       objects retired during one epoch.
+
+*/
+
+typedef struct {
+
+  commc_epoch_entry_t*  head;    /* RETIRED OBJECTS */
+  unsigned long         epoch;   /* EPOCH THEY WERE RETIRED IN */
+
+} epoch_limbo_t;
+
+/*
+
+         commc_epoch_record_t
+	       ---
+	       per-thread record. state and in_use are read by
+	       other threads and sit on their own cache line; the
+	       rest is private to the owner.
+
+*/
+
+struct commc_epoch_record_t {
+
+  unsigned long              state;       /* OBSERVED EPOCH | ACTIVE */
+  unsigned long              in_use;      /* CLAIMED BY A THREAD */
+  size_t                     pending;     /* RETIRED, NOT YET FREED */
+  char                       pad_shared[COMMC_EPOCH_CACHE_LINE];
+
+  commc_epoch_domain_t*      domain;      /* OWNING DOMAIN */
+  commc_epoch_flavor_t       flavor;      /* CACHED DOMAIN FLAVOR */
+  unsigned long              nesting;     /* EBR SECTION DEPTH */
+  size_t                     since_reclaim;
+  epoch_limbo_t              limbo[COMMC_EPOCH_LISTS];
+  commc_epoch_record_t*      next;        /* DOMAIN RECORD LIST */
+  char                       pad_private[COMMC_EPOCH_CACHE_LINE];
+
+};
+
+/*
+
+         commc_epoch_domain_t
+	       ---
+	       reclamation domain.
+
+*/
+
+struct commc_epoch_domain_t {
+
+  unsigned long              epoch;       /* GLOBAL EPOCH, ALWAYS EVEN */
+  char                       pad_epoch[COMMC_EPOCH_CACHE_LINE];
+
+  commc_epoch_record_t*      records;     /* PUSH-ONLY RECORD LIST */
+  commc_epoch_flavor_t       flavor;      /* EBR OR QSBR */
+  epoch_key_t                self_key;    /* CURRENT RECORD LOOKUP */
+
+};
+
+/*
+	==================================
+             --- INTERNAL HELPERS ---
+	==================================
+*/
+
+/*
+
+         free_list()
+	       ---
+	       runs the destructor of every entry in a chain.
+
+*/
+
+static size_t free_list(commc_epoch_entry_t* entry) {
+
+  commc_epoch_entry_t* next;
+  size_t               count;
+
+  count = 0;
+
+  while (entry) {
+
+    next = entry->next;
+    entry->free_fn(entry);
+    entry = next;
+    count++;
+
+  }
+
+  return count;
+
+}
+
+/*
+
+         try_advance()
+	       ---
+	       advances the global epoch if every active record has
+	       observed it. returns the (possibly new) epoch.
+
+*/
+
+static unsigned long try_advance(commc_epoch_domain_t* domain) {
+
+  commc_epoch_record_t* record;
+  unsigned long         epoch;
+  unsigned long         state;
+
+  epoch  = COMMC_ATOMIC_LOAD(&domain->epoch);
+  record = (commc_epoch_record_t*)EPOCH_LOAD_PTR((void**)&domain->records);
+
+  while (record) {
+
+    state = COMMC_ATOMIC_LOAD(&record->state);
+
+    if ((state & COMMC_EPOCH_ACTIVE) && (state & ~COMMC_EPOCH_ACTIVE) != epoch) {
+
+      return epoch; /* a thread is still in an older epoch */
+
+    }
+
+    record = record->next;
+
+  }
+
+  COMMC_ATOMIC_CAS(&domain->epoch, epoch, epoch + COMMC_EPOCH_STEP);
+
+  return COMMC_ATOMIC_LOAD(&domain->epoch);
+
+}
+
+/*
+
+         release_record()
+	       ---
+	       detaches a record from its thread so another thread
+	       may claim it.
+
+*/
+
+static void release_record(commc_epoch_record_t* record) {
+
+  record->nesting = 0;
+
+  commc_epoch_reclaim(record);
+
+  COMMC_ATOMIC_STORE_RELEASE(&record->state, 0UL);
+  COMMC_ATOMIC_STORE_RELEASE(&record->in_use, 0UL);
+
+}
+
+/*
+
+         record_destructor()
+	       ---
+	       thread-exit hook installed on the domain key.
+
+*/
+
+#ifdef _WIN32
+
+static VOID WINAPI record_destructor(PVOID value) {
+
+  if (value) {
+
+    release_record((commc_epoch_record_t*)value);
+
+  }
+
+}
+
+#else
+
+static void record_destructor(void* value) {
+
+  if (value) {
+
+    release_record((commc_epoch_record_t*)value);
+
+  }
+
+}
+
+#endif
+
+/*
+
+         get_self() / set_self()
+	       ---
+	       thread-local record lookup.
+
+*/
+
+static commc_epoch_record_t* get_self(commc_epoch_domain_t* domain) {
+
+#ifdef _WIN32
+  return (commc_epoch_record_t*)FlsGetValue(domain->self_key);
+#else
+  return (commc_epoch_record_t*)pthread_getspecific(domain->self_key);
+#endif
+
+}
+
+static void set_self(commc_epoch_domain_t* domain, commc_epoch_record_t* record) {
+
+#ifdef _WIN32
+  FlsSetValue(domain->self_key, record);
+#else
+  pthread_setspecific(domain->self_key, record);
+#endif
+
+}
+
+/*
+	==================================
+             --- DOMAIN API ---
+	==================================
+*/
+
+/*
+
+         commc_epoch_create()
+	       ---
+	       allocates a domain and its thread-local key.
+
+*/
+
+commc_epoch_domain_t* commc_epoch_create(commc_epoch_flavor_t flavor) {
+
+  commc_epoch_domain_t* domain;
+
+  if (flavor != COMMC_EPOCH_EBR && flavor != COMMC_EPOCH_QSBR) {
+
+    return NULL;
+
+  }
+
+  domain = (commc_epoch_domain_t*)malloc(sizeof(commc_epoch_domain_t));
+
+  if (!domain) {
+
+    return NULL;
+
+  }
+
+  memset(domain, 0, sizeof(commc_epoch_domain_t));
+
+  domain->epoch   = COMMC_EPOCH_STEP;
+  domain->records = NULL;
+  domain->flavor  = flavor;
+
+#ifdef _WIN32
+  domain->self_key = FlsAlloc(record_destructor);
+
+  if (domain->self_key == FLS_OUT_OF_INDEXES) {
+
+    free(domain);
+    return NULL;
+
+  }
+#else
+  if (pthread_key_create(&domain->self_key, record_destructor) != 0) {
+
+    free(domain);
+    return NULL;
+
+  }
+#endif
+
+  return domain;
+
+}
+
+/*
+
+         commc_epoch_destroy()
+	       ---
+	       frees pending objects, records, and the domain.
+
+*/
+
+void commc_epoch_destroy(commc_epoch_domain_t* domain) {
+
+  commc_epoch_record_t* record;
+  commc_epoch_record_t* next;
+  int                   i;
+
+  if (!domain) {
+
+    return;
+
+  }
+
+  /* deleting the key first keeps exit hooks from touching
+     records that are about to be freed */
+
+#ifdef _WIN32
+  FlsFree(domain->self_key);
+#else
+  pthread_key_delete(domain->self_key);
+#endif
+
+  record = domain->records;
+
+  while (record) {
+
+    next = record->next;
+
+    for (i = 0; i < COMMC_EPOCH_LISTS; i++) {
+
+      free_list(record->limbo[i].head);
+
+    }
+
+    free(record);
+    record = next;
+
+  }
+
+  free(domain);
+
+}
+
+/*
+
+         commc_epoch_get_flavor()
+	       ---
+	       returns the domain flavor.
+
+*/
+
+commc_epoch_flavor_t commc_epoch_get_flavor(const commc_epoch_domain_t* domain) {
+
+  return domain ? domain->flavor : COMMC_EPOCH_EBR;
+
+}
+
+/*
+
+         commc_epoch_pending()
+	       ---
+	       sums the per-record pending counters.
+
+*/
+
+size_t commc_epoch_pending(const commc_epoch_domain_t* domain) {
+
+  commc_epoch_record_t* record;
+  size_t                total;
+
+  if (!domain) {
+
+    return 0;
+
+  }
+
+  total  = 0;
+  record = (commc_epoch_record_t*)EPOCH_LOAD_PTR((void**)&domain->records);
+
+  while (record) {
+
+    total += COMMC_ATOMIC_LOAD_RELAXED(&record->pending);
+    record = record->next;
+
+  }
+
+  return total;
+
+}
+
+/*
+	==================================
+             --- THREAD API ---
+	==================================
+*/
+
+/*
+
+         commc_epoch_self()
+	       ---
+	       finds, claims, or allocates the caller's record.
+
+*/
+
+commc_epoch_record_t* commc_epoch_self(commc_epoch_domain_t* domain) {
+
+  commc_epoch_record_t* record;
+  commc_epoch_record_t* head;
+
+  if (!domain) {
+
+    return NULL;
+
+  }
+
+  record = get_self(domain);
+
+  if (record) {
+
+    return record;
+
+  }
+
+  /* reuse a record released by an exited thread */
+
+  record = (commc_epoch_record_t*)EPOCH_LOAD_PTR((void**)&domain->records);
+
+  while (record) {
+
+    if (COMMC_ATOMIC_LOAD_RELAXED(&record->in_use) == 0 &&
+        COMMC_ATOMIC_CAS(&record->in_use, 0UL, 1UL)) {
+
+      break;
+
+    }
+
+    record = record->next;
+
+  }
+
+  if (!record) {
+
+    record = (commc_epoch_record_t*)malloc(sizeof(commc_epoch_record_t));
+
+    if (!record) {
+
+      return NULL;
+
+    }
+
+    memset(record, 0, sizeof(commc_epoch_record_t));
+
+    record->domain = domain;
+    record->flavor = domain->flavor;
+    record->in_use = 1;
+
+    do {
+
+      head         = (commc_epoch_record_t*)EPOCH_LOAD_PTR((void**)&domain->records);
+      record->next = head;
+
+    } while (!EPOCH_CAS_PTR((void**)&domain->records, (void*)head, (void*)record));
+
+  }
+
+  record->nesting       = 0;
+  record->since_reclaim = 0;
+
+  if (record->flavor == COMMC_EPOCH_QSBR) {
+
+    commc_epoch_online(record);
+
+  }
+
+  set_self(domain, record);
+
+  return record;
+
+}
+
+/*
+
+         commc_epoch_unregister()
+	       ---
+	       releases the caller's record.
+
+*/
+
+void commc_epoch_unregister(commc_epoch_domain_t* domain) {
+
+  commc_epoch_record_t* record;
+
+  if (!domain) {
+
+    return;
+
+  }
+
+  record = get_self(domain);
+
+  if (record) {
+
+    set_self(domain, NULL);
+    release_record(record);
+
+  }
+
+}
+
+/*
+
+         commc_epoch_enter()
+	       ---
+	       publishes the observed epoch, then fences so that no
+	       shared pointer is read before the state is visible.
+
+*/
+
+void commc_epoch_enter(commc_epoch_record_t* record) {
+
+  unsigned long epoch;
+
+  if (!record || record->flavor != COMMC_EPOCH_EBR) {
+
+    return;
+
+  }
+
+  if (record->nesting++ == 0) {
+
+    epoch = COMMC_ATOMIC_LOAD_RELAXED(&record->domain->epoch);
+    COMMC_ATOMIC_STORE_RELAXED(&record->state, epoch | COMMC_EPOCH_ACTIVE);
+    COMMC_MEMORY_BARRIER();
+
+  }
+
+}
+
+/*
+
+         commc_epoch_exit()
+	       ---
+	       leaves the critical section; release keeps our reads
+	       of shared objects above the store.
+
+*/
+
+void commc_epoch_exit(commc_epoch_record_t* record) {
+
+  if (!record || record->flavor != COMMC_EPOCH_EBR || record->nesting == 0) {
+
+    return;
+
+  }
+
+  if (--record->nesting == 0) {
+
+    COMMC_ATOMIC_STORE_RELEASE(&record->state, 0UL);
+
+  }
+
+}
+
+/*
+
+         commc_epoch_quiescent()
+	       ---
+	       re-observes the global epoch. the store is skipped
+	       when nothing changed to keep the line clean.
+
+*/
+
+void commc_epoch_quiescent(commc_epoch_record_t* record) {
+
+  unsigned long epoch;
+
+  if (!record || record->flavor != COMMC_EPOCH_QSBR) {
+
+    return;
+
+  }
+
+  epoch = COMMC_ATOMIC_LOAD_ACQUIRE(&record->domain->epoch) | COMMC_EPOCH_ACTIVE;
+
+  if (COMMC_ATOMIC_LOAD_RELAXED(&record->state) != epoch) {
+
+    COMMC_ATOMIC_STORE_RELEASE(&record->state, epoch);
+
+  }
+
+}
+
+/*
+
+         commc_epoch_online()
+	       ---
+	       marks a QSBR thread as able to hold references.
+
+*/
+
+void commc_epoch_online(commc_epoch_record_t* record) {
+
+  unsigned long epoch;
+
+  if (!record || record->flavor != COMMC_EPOCH_QSBR ||
+      (COMMC_ATOMIC_LOAD_RELAXED(&record->state) & COMMC_EPOCH_ACTIVE)) {
+
+    return; /* already online */
+
+  }
+
+  epoch = COMMC_ATOMIC_LOAD_RELAXED(&record->domain->epoch);
+  COMMC_ATOMIC_STORE_RELAXED(&record->state, epoch | COMMC_EPOCH_ACTIVE);
+  COMMC_MEMORY_BARRIER();
+
+}
+
+/*
+
+         commc_epoch_offline()
+	       ---
+	       marks a QSBR thread as holding no references.
+
+*/
+
+void commc_epoch_offline(commc_epoch_record_t* record) {
+
+  if (!record || record->flavor != COMMC_EPOCH_QSBR) {
+
+    return;
+
+  }
+
+  COMMC_ATOMIC_STORE_RELEASE(&record->state, 0UL);
+
+}
+
+/*
+
+         commc_epoch_retire()
+	       ---
+	       files entry under the current global epoch.
+
+*/
+
+void commc_epoch_retire(commc_epoch_record_t* record,
+                        commc_epoch_entry_t* entry,
+                        commc_epoch_free_fn free_fn) {
+
+  epoch_limbo_t* limbo;
+  unsigned long  epoch;
+  size_t         freed;
+
+  if (!record || !entry || !free_fn) {
+
+    return;
+
+  }
+
+  entry->free_fn = free_fn;
+
+  /* seq_cst load: must not be satisfied before the unlink */
+
+  epoch = COMMC_ATOMIC_LOAD(&record->domain->epoch);
+  limbo = &record->limbo[(epoch / COMMC_EPOCH_STEP) % COMMC_EPOCH_LISTS];
+  freed = 0;
+
+  if (limbo->epoch != epoch) {
+
+    /* the slot holds objects at least three epochs old */
+
+    freed        = free_list(limbo->head);
+    limbo->head  = NULL;
+    limbo->epoch = epoch;
+
+  }
+
+  entry->next = limbo->head;
+  limbo->head = entry;
+
+  COMMC_ATOMIC_STORE_RELAXED(&record->pending, record->pending + 1 - freed);
+
+  if (++record->since_reclaim >= COMMC_EPOCH_RECLAIM_THRESHOLD) {
+
+    commc_epoch_reclaim(record);
+
+  }
+
+}
+
+/*
+
+         commc_epoch_reclaim()
+	       ---
+	       advances if possible and frees every limbo list that
+	       is at least two epochs behind.
+
+*/
+
+size_t commc_epoch_reclaim(commc_epoch_record_t* record) {
+
+  unsigned long epoch;
+  size_t        freed;
+  int           i;
+
+  if (!record) {
+
+    return 0;
+
+  }
+
+  record->since_reclaim = 0;
+
+  epoch = try_advance(record->domain);
+  freed = 0;
+
+  for (i = 0; i < COMMC_EPOCH_LISTS; i++) {
+
+    if (record->limbo[i].head &&
+        epoch - record->limbo[i].epoch >= 2 * COMMC_EPOCH_STEP) {
+
+      freed += free_list(record->limbo[i].head);
+      record->limbo[i].head = NULL;
+
+    }
+
+  }
+
+  if (freed) {
+
+    COMMC_ATOMIC_STORE_RELAXED(&record->pending, record->pending - freed);
+
+  }
+
+  return freed;
+
+}
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
@@ -0,0 +1,3024 @@
+/*
+   ===================================
+   F L A T E . C
+   STREAMING DEFLATE, ZLIB AND GZIP IMPLEMENTATION
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    the decoder is a state machine that can stop at
+	    any bit of the input and pick up where it left off
+	    on the next write. bits are gathered LSB first into
+	    a 32-bit buffer; Huffman codes of up to nine bits
+	    are resolved with one table lookup, longer ones
+	    canonically a bit at a time. output goes into the
+	    32 KB window (which back-references copy from) and
+	    is handed on, and checksummed, whenever the window
+	    is about to wrap and at the end of every write.
+
+	    the encoder keeps a 64 KB window: the upper half is
+	    looked ahead into, the lower half is the history
+	    matches may point back to, and when the window is
+	    full the upper half slides down. strings of three
+	    bytes are hashed into chains (head/prev, as window
+	    positions, 0 for none) and matches are evaluated
+	    lazily: a match is only taken if the next position
+	    does not start a longer one. a block is written
+	    once its symbol buffer fills and at the end; one
+	    whose first bytes have slid out of the window can
+	    no longer be stored, only coded.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "commc/flate.h"
+#include "commc/error.h"
+
+/*
+	==================================
+           --- CONSTANTS ---
+	==================================
+*/
+
+#define FLATE_WINDOW_SIZE     32768                      /* HISTORY A DISTANCE MAY REACH */
+#define FLATE_WINDOW_MASK     (FLATE_WINDOW_SIZE - 1)
+#define FLATE_MAX_BITS        15                         /* LONGEST HUFFMAN CODE */
+#define FLATE_FAST_BITS       9                          /* CODES RESOLVED BY ONE LOOKUP */
+#define FLATE_FAST_SIZE       (1 << FLATE_FAST_BITS)
+#define FLATE_LITERAL_CODES   288                        /* LITERAL/LENGTH ALPHABET */
+#define FLATE_USED_LITERALS   286                        /* OF WHICH VALID IN A STREAM */
+#define FLATE_DISTANCE_CODES  30                         /* DISTANCE ALPHABET */
+#define FLATE_LENGTH_CODES    19                         /* CODE LENGTH ALPHABET */
+#define FLATE_END_OF_BLOCK    256
+#define FLATE_MIN_MATCH       3
+#define FLATE_MAX_MATCH       258
+#define FLATE_MIN_LOOKAHEAD   (FLATE_MAX_MATCH + FLATE_MIN_MATCH + 1)
+#define FLATE_TOO_FAR         4096                       /* DISTANCE NOT WORTH A 3-BYTE MATCH */
+#define FLATE_HASH_BITS       14
+#define FLATE_HASH_SIZE       (1 << FLATE_HASH_BITS)
+#define FLATE_BLOCK_SYMBOLS   16384                      /* SYMBOLS PER ENCODED BLOCK */
+#define FLATE_OUTPUT_SIZE     16384                      /* ENCODER OUTPUT BUFFER */
+#define FLATE_STORED_MAX      65535                      /* LARGEST STORED BLOCK */
+
+#define FLATE_NEED_INPUT      -1                         /* flate_decode_symbol() RESULTS */
+#define FLATE_INVALID         -2
+
+/*
+	==================================
+             --- TABLES ---
+	==================================
+*/
+
+static const unsigned short flate_length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const unsigned char flate_length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const unsigned short flate_distance_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+
+static const unsigned char flate_distance_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/* order in which code length code lengths are sent */
+
+static const unsigned char flate_length_order[FLATE_LENGTH_CODES] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/* CRC-32, polynomial 0xEDB88320, one entry per byte value */
+
+static const unsigned long flate_crc_table[256] = {
+    0x00000000UL, 0x77073096UL, 0xee0e612cUL, 0x990951baUL,
+    0x076dc419UL, 0x706af48fUL, 0xe963a535UL, 0x9e6495a3UL,
+    0x0edb8832UL, 0x79dcb8a4UL, 0xe0d5e91eUL, 0x97d2d988UL,
+    0x09b64c2bUL, 0x7eb17cbdUL, 0xe7b82d07UL, 0x90bf1d91UL,
+    0x1db71064UL, 0x6ab020f2UL, 0xf3b97148UL, 0x84be41deUL,
+    0x1adad47dUL, 0x6ddde4ebUL, 0xf4d4b551UL, 0x83d385c7UL,
+    0x136c9856UL, 0x646ba8c0UL, 0xfd62f97aUL, 0x8a65c9ecUL,
+    0x14015c4fUL, 0x63066cd9UL, 0xfa0f3d63UL, 0x8d080df5UL,
+    0x3b6e20c8UL, 0x4c69105eUL, 0xd56041e4UL, 0xa2677172UL,
+    0x3c03e4d1UL, 0x4b04d447UL, 0xd20d85fdUL, 0xa50ab56bUL,
+    0x35b5a8faUL, 0x42b2986cUL, 0xdbbbc9d6UL, 0xacbcf940UL,
+    0x32d86ce3UL, 0x45df5c75UL, 0xdcd60dcfUL, 0xabd13d59UL,
+    0x26d930acUL, 0x51de003aUL, 0xc8d75180UL, 0xbfd06116UL,
+    0x21b4f4b5UL, 0x56b3c423UL, 0xcfba9599UL, 0xb8bda50fUL,
+    0x2802b89eUL, 0x5f058808UL, 0xc60cd9b2UL, 0xb10be924UL,
+    0x2f6f7c87UL, 0x58684c11UL, 0xc1611dabUL, 0xb6662d3dUL,
+    0x76dc4190UL, 0x01db7106UL, 0x98d220bcUL, 0xefd5102aUL,
+    0x71b18589UL, 0x06b6b51fUL, 0x9fbfe4a5UL, 0xe8b8d433UL,
+    0x7807c9a2UL, 0x0f00f934UL, 0x9609a88eUL, 0xe10e9818UL,
+    0x7f6a0dbbUL, 0x086d3d2dUL, 0x91646c97UL, 0xe6635c01UL,
+    0x6b6b51f4UL, 0x1c6c6162UL, 0x856530d8UL, 0xf262004eUL,
+    0x6c0695edUL, 0x1b01a57bUL, 0x8208f4c1UL, 0xf50fc457UL,
+    0x65b0d9c6UL, 0x12b7e950UL, 0x8bbeb8eaUL, 0xfcb9887cUL,
+    0x62dd1ddfUL, 0x15da2d49UL, 0x8cd37cf3UL, 0xfbd44c65UL,
+    0x4db26158UL, 0x3ab551ceUL, 0xa3bc0074UL, 0xd4bb30e2UL,
+    0x4adfa541UL, 0x3dd895d7UL, 0xa4d1c46dUL, 0xd3d6f4fbUL,
+    0x4369e96aUL, 0x346ed9fcUL, 0xad678846UL, 0xda60b8d0UL,
+    0x44042d73UL, 0x33031de5UL, 0xaa0a4c5fUL, 0xdd0d7cc9UL,
+    0x5005713cUL, 0x270241aaUL, 0xbe0b1010UL, 0xc90c2086UL,
+    0x5768b525UL, 0x206f85b3UL, 0xb966d409UL, 0xce61e49fUL,
+    0x5edef90eUL, 0x29d9c998UL, 0xb0d09822UL, 0xc7d7a8b4UL,
+    0x59b33d17UL, 0x2eb40d81UL, 0xb7bd5c3bUL, 0xc0ba6cadUL,
+    0xedb88320UL, 0x9abfb3b6UL, 0x03b6e20cUL, 0x74b1d29aUL,
+    0xead54739UL, 0x9dd277afUL, 0x04db2615UL, 0x73dc1683UL,
+    0xe3630b12UL, 0x94643b84UL, 0x0d6d6a3eUL, 0x7a6a5aa8UL,
+    0xe40ecf0bUL, 0x9309ff9dUL, 0x0a00ae27UL, 0x7d079eb1UL,
+    0xf00f9344UL, 0x8708a3d2UL, 0x1e01f268UL, 0x6906c2feUL,
+    0xf762575dUL, 0x806567cbUL, 0x196c3671UL, 0x6e6b06e7UL,
+    0xfed41b76UL, 0x89d32be0UL, 0x10da7a5aUL, 0x67dd4accUL,
+    0xf9b9df6fUL, 0x8ebeeff9UL, 0x17b7be43UL, 0x60b08ed5UL,
+    0xd6d6a3e8UL, 0xa1d1937eUL, 0x38d8c2c4UL, 0x4fdff252UL,
+    0xd1bb67f1UL, 0xa6bc5767UL, 0x3fb506ddUL, 0x48b2364bUL,
+    0xd80d2bdaUL, 0xaf0a1b4cUL, 0x36034af6UL, 0x41047a60UL,
+    0xdf60efc3UL, 0xa867df55UL, 0x316e8eefUL, 0x4669be79UL,
+    0xcb61b38cUL, 0xbc66831aUL, 0x256fd2a0UL, 0x5268e236UL,
+    0xcc0c7795UL, 0xbb0b4703UL, 0x220216b9UL, 0x5505262fUL,
+    0xc5ba3bbeUL, 0xb2bd0b28UL, 0x2bb45a92UL, 0x5cb36a04UL,
+    0xc2d7ffa7UL, 0xb5d0cf31UL, 0x2cd99e8bUL, 0x5bdeae1dUL,
+    0x9b64c2b0UL, 0xec63f226UL, 0x756aa39cUL, 0x026d930aUL,
+    0x9c0906a9UL, 0xeb0e363fUL, 0x72076785UL, 0x05005713UL,
+    0x95bf4a82UL, 0xe2b87a14UL, 0x7bb12baeUL, 0x0cb61b38UL,
+    0x92d28e9bUL, 0xe5d5be0dUL, 0x7cdcefb7UL, 0x0bdbdf21UL,
+    0x86d3d2d4UL, 0xf1d4e242UL, 0x68ddb3f8UL, 0x1fda836eUL,
+    0x81be16cdUL, 0xf6b9265bUL, 0x6fb077e1UL, 0x18b74777UL,
+    0x88085ae6UL, 0xff0f6a70UL, 0x66063bcaUL, 0x11010b5cUL,
+    0x8f659effUL, 0xf862ae69UL, 0x616bffd3UL, 0x166ccf45UL,
+    0xa00ae278UL, 0xd70dd2eeUL, 0x4e048354UL, 0x3903b3c2UL,
+    0xa7672661UL, 0xd06016f7UL, 0x4969474dUL, 0x3e6e77dbUL,
+    0xaed16a4aUL, 0xd9d65adcUL, 0x40df0b66UL, 0x37d83bf0UL,
+    0xa9bcae53UL, 0xdebb9ec5UL, 0x47b2cf7fUL, 0x30b5ffe9UL,
+    0xbdbdf21cUL, 0xcabac28aUL, 0x53b39330UL, 0x24b4a3a6UL,
+    0xbad03605UL, 0xcdd70693UL, 0x54de5729UL, 0x23d967bfUL,
+    0xb3667a2eUL, 0xc4614ab8UL, 0x5d681b02UL, 0x2a6f2b94UL,
+    0xb40bbe37UL, 0xc30c8ea1UL, 0x5a05df1bUL, 0x2d02ef8dUL
+};
+
+/* encoder match search effort per level, as in zlib */
+
+static const struct {
+
+    unsigned short good;    /* PREVIOUS MATCH THIS LONG: SEARCH A QUARTER OF THE CHAIN */
+    unsigned short lazy;    /* PREVIOUS MATCH THIS LONG: DO NOT LOOK FOR A BETTER ONE */
+    unsigned short nice;    /* STOP SEARCHING AT A MATCH THIS LONG */
+    unsigned short chain;   /* CHAIN ENTRIES TO TRY */
+
+} flate_levels[10] = {
+
+    {  0,   0,   0,    0 },
+    {  4,   4,   8,    4 },
+    {  4,   5,  16,    8 },
+    {  4,   6,  32,   32 },
+    {  4,   4,  16,   16 },
+    {  8,  16,  32,   32 },
+    {  8,  16, 128,  128 },
+    {  8,  32, 128,  256 },
+    { 32, 128, 258, 1024 },
+    { 32, 258, 258, 4096 }
+
+};
+
+/*
+	==================================
+           --- STRUCTURES ---
+	==================================
+*/
+
+/*
+
+         flate_table_t
+	       ---
+	       decoding table for one canonical Huffman code.
+
+*/
+
+typedef struct {
+
+    unsigned short count[FLATE_MAX_BITS + 1];     /* CODES OF EACH LENGTH */
+    unsigned short symbol[FLATE_LITERAL_CODES];   /* SYMBOLS IN CODE ORDER */
+    unsigned short fast[FLATE_FAST_SIZE];         /* LENGTH << 9 | SYMBOL BY NEXT 9 BITS, 0 IF LONGER */
+
+} flate_table_t;
+
+/*
+
+         flate_decode_state_t
+	       ---
+	       where a decoder stopped.
+
+*/
+
+typedef enum {
+
+    DECODE_HEADER,          /* ZLIB OR GZIP MAGIC, OR FORMAT DETECTION */
+    DECODE_GZIP_METHOD,     /* GZIP METHOD AND FLAGS */
+    DECODE_GZIP_SKIP,       /* HEADER BYTES TO SKIP */
+    DECODE_GZIP_EXTRA,      /* LENGTH OF THE EXTRA FIELD */
+    DECODE_GZIP_STRING,     /* FILE NAME OR COMMENT */
+    DECODE_BLOCK,           /* BLOCK HEADER */
+    DECODE_STORED,          /* STORED BLOCK LENGTH */
+    DECODE_STORED_CHECK,    /* ITS COMPLEMENT */
+    DECODE_STORED_COPY,     /* STORED BYTES */
+    DECODE_TABLE,           /* DYNAMIC BLOCK CODE COUNTS */
+    DECODE_TABLE_LENGTHS,   /* CODE LENGTH CODE LENGTHS */
+    DECODE_TABLE_CODES,     /* LITERAL AND DISTANCE CODE LENGTHS */
+    DECODE_CODES,           /* LITERALS AND LENGTHS */
+    DECODE_LENGTH_EXTRA,    /* EXTRA BITS OF A LENGTH */
+    DECODE_DISTANCE,        /* DISTANCE CODE */
+    DECODE_DISTANCE_EXTRA,  /* EXTRA BITS OF A DISTANCE */
+    DECODE_TRAILER,         /* ZLIB OR GZIP CHECKSUMS */
+    DECODE_DONE,            /* STREAM ENDED */
+    DECODE_FAILED           /* CORRUPT STREAM OR OUTPUT ERROR */
+
+} flate_decode_state_t;
+
+struct commc_flate_decoder_t {
+
+    commc_flate_format_t  created;         /* FORMAT ASKED FOR */
+    commc_flate_format_t  format;          /* AUTO UNTIL THE HEADER IS SEEN */
+    commc_flate_output_t  output;
+    void*                 user_data;
+    flate_decode_state_t  state;
+    commc_error_t         error;           /* WHY THE DECODER FAILED */
+
+    const unsigned char*  input;           /* UNREAD BYTES OF THE CURRENT WRITE */
+    const unsigned char*  input_end;
+    unsigned long         bits;            /* BIT BUFFER, NEXT BIT LOWEST */
+    int                   bit_count;
+
+    int                   last;            /* CURRENT BLOCK IS THE FINAL ONE */
+    unsigned              flags;           /* GZIP HEADER PARTS STILL TO SKIP */
+    unsigned long         remaining;       /* BYTES TO SKIP OR STORED BYTES LEFT */
+    int                   literal_count;   /* DYNAMIC BLOCK: LITERAL/LENGTH CODES */
+    int                   distance_count;  /* DYNAMIC BLOCK: DISTANCE CODES */
+    int                   length_count;    /* DYNAMIC BLOCK: CODE LENGTH CODES */
+    int                   index;           /* NEXT CODE LENGTH TO READ */
+    int                   code;            /* CODE WAITING FOR ITS EXTRA BITS */
+    unsigned              copy_length;     /* LENGTH OF THE MATCH BEING READ */
+
+    unsigned char         lengths[FLATE_USED_LITERALS + FLATE_DISTANCE_CODES];
+    flate_table_t         literals;        /* LITERAL/LENGTH (OR CODE LENGTH) CODE */
+    flate_table_t         distances;
+
+    unsigned long         check;           /* RUNNING CRC-32 OR ADLER-32 */
+    unsigned long         total;           /* BYTES DECODED */
+    unsigned long         flushed;         /* BYTES PASSED TO OUTPUT */
+    unsigned long         history;         /* FLUSHED BYTES STILL IN THE WINDOW */
+    unsigned char         trailer[8];
+    int                   trailer_length;
+
+    unsigned char         window[FLATE_WINDOW_SIZE];
+
+};
+
+struct commc_flate_encoder_t {
+
+    commc_flate_format_t  format;
+    commc_flate_output_t  output;
+    void*                 user_data;
+    int                   level;
+    commc_error_t         error;           /* FIRST OUTPUT ERROR */
+    int                   started;         /* HEADER WRITTEN */
+    int                   finished;        /* TRAILER WRITTEN */
+
+    unsigned long         check;           /* RUNNING CRC-32 OR ADLER-32 */
+    unsigned long         total;           /* BYTES COMPRESSED */
+
+    size_t                window_end;      /* BYTES IN THE WINDOW */
+    size_t                position;        /* NEXT BYTE TO MATCH */
+    long                  block_start;     /* FIRST BYTE OF THE BLOCK, < 0 ONCE SLID OUT */
+    unsigned              match_length;    /* MATCH AT position - 1 */
+    unsigned              match_distance;
+    int                   match_available; /* BYTE AT position - 1 NOT YET RECORDED */
+
+    size_t                symbol_count;
+    unsigned char         symbol_length[FLATE_BLOCK_SYMBOLS];    /* LITERAL, OR MATCH LENGTH - 3 */
+    unsigned short        symbol_distance[FLATE_BLOCK_SYMBOLS];  /* 0 FOR A LITERAL */
+
+    unsigned long         bits;            /* BITS NOT YET A WHOLE BYTE */
+    int                   bit_count;
+    size_t                out_length;
+    unsigned char         out[FLATE_OUTPUT_SIZE];
+
+    unsigned char         length_code[256];    /* MATCH LENGTH - 3 TO LENGTH CODE */
+    unsigned char         distance_code[512];  /* DISTANCE - 1 TO CODE, SEE distance_code() */
+
+    unsigned short        head[FLATE_HASH_SIZE];      /* LATEST POSITION PER HASH */
+    unsigned short        prev[FLATE_WINDOW_SIZE];    /* EARLIER POSITION, SAME HASH */
+    unsigned char         window[2 * FLATE_WINDOW_SIZE];
+
+};
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         reverse_bits()
+	       ---
+	       DEFLATE sends Huffman codes most significant bit
+	       first into an LSB-first stream; tables hold them
+	       reversed.
+
+*/
+
+static unsigned reverse_bits(unsigned code,
+                             int      length) {
+
+    unsigned reversed = 0;
+
+    while (length-- > 0) {
+
+        reversed = (reversed << 1) | (code & 1);
+        code   >>= 1;
+
+    }
+
+    return reversed;
+
+}
+
+/*
+
+         assign_codes()
+	       ---
+	       canonical codes for the code lengths of count
+	       symbols, reversed for sending.
+
+*/
+
+static void assign_codes(const unsigned char* lengths,
+                         int                  count,
+                         unsigned short*      codes) {
+
+    unsigned short length_count[FLATE_MAX_BITS + 1];
+    unsigned       next[FLATE_MAX_BITS + 1];
+    unsigned       code = 0;
+    int            length;
+    int            symbol;
+
+    memset(length_count, 0, sizeof(length_count));
+
+    for (symbol = 0; symbol < count; symbol++) {
+
+        length_count[lengths[symbol]]++;
+
+    }
+
+    length_count[0] = 0;
+
+    for (length = 1; length <= FLATE_MAX_BITS; length++) {
+
+        code         = (code + length_count[length - 1]) << 1;
+        next[length] = code;
+
+    }
+
+    for (symbol = 0; symbol < count; symbol++) {
+
+        length = lengths[symbol];
+        codes[symbol] = length ? (unsigned short)reverse_bits(next[length]++, length) : 0;
+
+    }
+
+}
+
+/*
+
+         fixed_lengths()
+	       ---
+	       code lengths of the fixed codes: 288 literal/
+	       length codes followed by 30 distance codes.
+
+*/
+
+static void fixed_lengths(unsigned char* lengths) {
+
+    int symbol;
+
+    for (symbol = 0; symbol < 144; symbol++) {
+
+        lengths[symbol] = 8;
+
+    }
+
+    for (; symbol < 256; symbol++) {
+
+        lengths[symbol] = 9;
+
+    }
+
+    for (; symbol < 280; symbol++) {
+
+        lengths[symbol] = 7;
+
+    }
+
+    for (; symbol < FLATE_LITERAL_CODES; symbol++) {
+
+        lengths[symbol] = 8;
+
+    }
+
+    for (symbol = 0; symbol < FLATE_DISTANCE_CODES; symbol++) {
+
+        lengths[FLATE_LITERAL_CODES + symbol] = 5;
+
+    }
+
+}
+
+/*
+	==================================
+            --- DECODING ---
+	==================================
+*/
+
+/*
+
+         build_table()
+	       ---
+	       builds the decoding table for count code
+	       lengths. returns 0 for an over-subscribed code;
+	       incomplete codes are accepted, their unused bit
+	       patterns failing when met.
+
+*/
+
+static int build_table(flate_table_t*       table,
+                       const unsigned char* lengths,
+                       int                  count) {
+
+    unsigned short offsets[FLATE_MAX_BITS + 2];
+    unsigned short codes[FLATE_LITERAL_CODES];
+    long           left = 1;
+    int            length;
+    int            symbol;
+    unsigned       entry;
+    unsigned       slot;
+
+    memset(table->count, 0, sizeof(table->count));
+
+    for (symbol = 0; symbol < count; symbol++) {
+
+        table->count[lengths[symbol]]++;
+
+    }
+
+    table->count[0] = 0;
+
+    for (length = 1; length <= FLATE_MAX_BITS; length++) {
+
+        left = (left << 1) - table->count[length];
+
+        if (left < 0) {
+
+            return 0;
+
+        }
+
+    }
+
+    offsets[1] = 0;
+
+    for (length = 1; length <= FLATE_MAX_BITS; length++) {
+
+        offsets[length + 1] = (unsigned short)(offsets[length] + table->count[length]);
+
+    }
+
+    for (symbol = 0; symbol < count; symbol++) {
+
+        if (lengths[symbol]) {
+
+            table->symbol[offsets[lengths[symbol]]++] = (unsigned short)symbol;
+
+        }
+
+    }
+
+    /* every 9-bit pattern a short code starts gets its entry */
+
+    assign_codes(lengths, count, codes);
+    memset(table->fast, 0, sizeof(table->fast));
+
+    for (symbol = 0; symbol < count; symbol++) {
+
+        length = lengths[symbol];
+
+        if (length == 0 || length > FLATE_FAST_BITS) {
+
+            continue;
+
+        }
+
+        entry = ((unsigned)length << 9) | (unsigned)symbol;
+
+        for (slot = codes[symbol]; slot < FLATE_FAST_SIZE; slot += 1U << length) {
+
+            table->fast[slot] = (unsigned short)entry;
+
+        }
+
+    }
+
+    return 1;
+
+}
+
+/*
+
+         pull_bits()
+	       ---
+	       tops the bit buffer up from the input until it
+	       holds count bits (at most 25). returns 0 if the
+	       input ran out first.
+
+*/
+
+static int pull_bits(commc_flate_decoder_t* decoder,
+                     int                    count) {
+
+    while (decoder->bit_count < count) {
+
+        if (decoder->input == decoder->input_end) {
+
+            return 0;
+
+        }
+
+        decoder->bits      |= (unsigned long)*decoder->input++ << decoder->bit_count;
+        decoder->bit_count += 8;
+
+    }
+
+    return 1;
+
+}
+
+/*
+
+         drop_bits()
+	       ---
+	       consumes count buffered bits.
+
+*/
+
+static void drop_bits(commc_flate_decoder_t* decoder,
+                      int                    count) {
+
+    decoder->bits      >>= count;
+    decoder->bit_count -= count;
+
+}
+
+/*
+
+         decode_symbol()
+	       ---
+	       the next symbol of table's code, or
+	       FLATE_NEED_INPUT (nothing consumed) or
+	       FLATE_INVALID. codes of up to FLATE_FAST_BITS
+	       take one lookup; longer ones are found among the
+	       canonical codes a bit at a time.
+
+*/
+
+static int decode_symbol(commc_flate_decoder_t* decoder,
+                         const flate_table_t*   table) {
+
+    unsigned entry;
+    int      length;
+    int      code  = 0;
+    int      first = 0;
+    int      index = 0;
+    int      count;
+
+    if (decoder->bit_count < FLATE_MAX_BITS) {
+
+        pull_bits(decoder, FLATE_MAX_BITS);
+
+    }
+
+    /* bits above bit_count are zero, so a hit no longer than them is real */
+
+    entry = table->fast[decoder->bits & (FLATE_FAST_SIZE - 1)];
+
+    if (entry) {
+
+        length = (int)(entry >> 9);
+
+        if (length > decoder->bit_count) {
+
+            return FLATE_NEED_INPUT;
+
+        }
+
+        drop_bits(decoder, length);
+        return (int)(entry & 0x1FF);
+
+    }
+
+    for (length = 1; length <= FLATE_MAX_BITS; length++) {
+
+        if (length > decoder->bit_count) {
+
+            return FLATE_NEED_INPUT;
+
+        }
+
+        code |= (int)((decoder->bits >> (length - 1)) & 1);
+        count = table->count[length];
+
+        if (code - count < first) {
+
+            drop_bits(decoder, length);
+            return table->symbol[index + (code - first)];
+
+        }
+
+        index += count;
+        first  = (first + count) << 1;
+        code <<= 1;
+
+    }
+
+    return FLATE_INVALID;
+
+}
+
+/*
+
+         flush_window()
+	       ---
+	       passes the decoded bytes not yet handed on to
+	       output, checksumming them on the way.
+
+*/
+
+static commc_error_t flush_window(commc_flate_decoder_t* decoder) {
+
+    commc_error_t result;
+    unsigned long pending = decoder->total - decoder->flushed;
+    size_t        start;
+    size_t        length;
+
+    while (pending > 0) {
+
+        start  = (size_t)(decoder->flushed & FLATE_WINDOW_MASK);
+        length = FLATE_WINDOW_SIZE - start;
+
+        if (length > pending) {
+
+            length = (size_t)pending;
+
+        }
+
+        if (decoder->format == COMMC_FLATE_GZIP) {
+
+            decoder->check = commc_flate_crc32(decoder->check, decoder->window + start, length);
+
+        } else if (decoder->format == COMMC_FLATE_ZLIB) {
+
+            decoder->check = commc_flate_adler32(decoder->check, decoder->window + start, length);
+
+        }
+
+        result = decoder->output((const char*)decoder->window + start, length, decoder->user_data);
+
+        if (result != COMMC_SUCCESS) {
+
+            return result;
+
+        }
+
+        decoder->flushed += length;
+        pending          -= length;
+
+        decoder->history += length;
+
+        if (decoder->history > FLATE_WINDOW_SIZE) {
+
+            decoder->history = FLATE_WINDOW_SIZE;
+
+        }
+
+    }
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         next_gzip_state()
+	       ---
+	       the gzip header part after the current one.
+
+*/
+
+static flate_decode_state_t next_gzip_state(commc_flate_decoder_t* decoder) {
+
+    if (decoder->flags & 0x04) {
+
+        return DECODE_GZIP_EXTRA;
+
+    }
+
+    if (decoder->flags & 0x18) {
+
+        return DECODE_GZIP_STRING;
+
+    }
+
+    if (decoder->flags & 0x02) {
+
+        decoder->flags    &= ~0x02U;
+        decoder->remaining = 2;
+        return DECODE_GZIP_SKIP;
+
+    }
+
+    return DECODE_BLOCK;
+
+}
+
+/*
+
+         end_block()
+	       ---
+	       the state after an end of block: the next block,
+	       or the trailer (byte-aligned) after the last.
+
+*/
+
+static flate_decode_state_t end_block(commc_flate_decoder_t* decoder) {
+
+    if (!decoder->last) {
+
+        return DECODE_BLOCK;
+
+    }
+
+    drop_bits(decoder, decoder->bit_count & 7);
+    return DECODE_TRAILER;
+
+}
+
+/*
+
+         read_tables()
+	       ---
+	       builds the literal and distance tables once a
+	       dynamic block's code lengths are all read.
+
+*/
+
+static int read_tables(commc_flate_decoder_t* decoder) {
+
+    if (decoder->lengths[FLATE_END_OF_BLOCK] == 0) {
+
+        return 0;
+
+    }
+
+    return build_table(&decoder->literals, decoder->lengths, decoder->literal_count) &&
+           build_table(&decoder->distances, decoder->lengths + decoder->literal_count,
+                       decoder->distance_count);
+
+}
+
+/*
+
+         decode()
+	       ---
+	       runs the state machine over the input of the
+	       current write. returns COMMC_SUCCESS once the
+	       input is used up or the stream has ended.
+
+*/
+
+static commc_error_t decode(commc_flate_decoder_t* decoder) {
+
+    commc_error_t  result;
+    unsigned char  lengths[FLATE_LITERAL_CODES + FLATE_DISTANCE_CODES];
+    unsigned       first;
+    unsigned       second;
+    unsigned       value;
+    unsigned long  distance;
+    unsigned long  room;
+    size_t         length;
+    int            symbol;
+    int            repeat;
+    int            extra;
+
+    for (;;) {
+
+        switch (decoder->state) {
+
+        case DECODE_HEADER:
+
+            if (!pull_bits(decoder, 16)) {
+
+                return COMMC_SUCCESS;
+
+            }
+
+            first  = (unsigned)(decoder->bits & 0xFF);
+            second = (unsigned)((decoder->bits >> 8) & 0xFF);
+
+            if (decoder->format == COMMC_FLATE_GZIP ||
+                (decoder->format == COMMC_FLATE_AUTO && first == 0x1F && second == 0x8B)) {
+
+                if (first != 0x1F || second != 0x8B) {
+
+                    return COMMC_FORMAT_ERROR;
+
+                }
+
+                decoder->format = COMMC_FLATE_GZIP;
+                decoder->check  = 0;
+                decoder->state  = DECODE_GZIP_METHOD;
+
+            } else if (decoder->format == COMMC_FLATE_ZLIB ||
+                       (decoder->format == COMMC_FLATE_AUTO && (first & 0x0F) == 8 &&
+                        (first >> 4) <= 7 && ((first << 8) | second) % 31 == 0)) {
+
+                /* preset dictionaries are not supported */
+
+                if ((first & 0x0F) != 8 || (first >> 4) > 7 ||
+                    ((first << 8) | second) % 31 != 0 || (second & 0x20)) {
+
+                    return COMMC_FORMAT_ERROR;
+
+                }
+
+                decoder->format = COMMC_FLATE_ZLIB;
+                decoder->check  = 1;
+                decoder->state  = DECODE_BLOCK;
+
+            } else {
+
+                decoder->format = COMMC_FLATE_RAW;
+                decoder->state  = DECODE_BLOCK;
+                break;
+
+            }
+
+            drop_bits(decoder, 16);
+            break;
+
+        case DECODE_GZIP_METHOD:
+
+            if (!pull_bits(decoder, 16)) {
+
+                return COMMC_SUCCESS;
+
+            }
+
+            decoder->flags = (unsigned)((decoder->bits >> 8) & 0xFF);
+
+            if ((decoder->bits & 0xFF) != 8 || (decoder->flags & 0xE0)) {
+
+                return COMMC_FORMAT_ERROR;
+
+            }
+
+            drop_bits(decoder, 16);
+
+            decoder->remaining = 6;            /* MTIME, XFL, OS */
+            decoder->state     = DECODE_GZIP_SKIP;
+            break;
+
+        case DECODE_GZIP_SKIP:
+
+            while (decoder->remaining > 0) {
+
+                if (!pull_bits(decoder, 8)) {
+
+                    return COMMC_SUCCESS;
+
+                }
+
+                drop_bits(decoder, 8);
+                decoder->remaining--;
+
+            }
+
+            decoder->state = next_gzip_state(decoder);
+            break;
+
+        case DECODE_GZIP_EXTRA:
+
+            if (!pull_bits(decoder, 16)) {
+
+                return COMMC_SUCCESS;
+
+            }
+
+            decoder->remaining = decoder->bits & 0xFFFF;
+            decoder->flags    &= ~0x04U;
+            decoder->state     = DECODE_GZIP_SKIP;
+
+            drop_bits(decoder, 16);
+            break;
+
+        case DECODE_GZIP_STRING:
+
+            for (;;) {
+
+                if (!pull_bits(decoder, 8)) {
+
+                    return COMMC_SUCCESS;
+
+                }
+
+                value = (unsigned)(decoder->bits & 0xFF);
+                drop_bits(decoder, 8);
+
+                if (value == 0) {
+
+                    break;
+
+                }
+
+            }
+
+            /* the name comes before the comment */
+
+            decoder->flags &= (decoder->flags & 0x08) ? ~0x08U : ~0x10U;
+            decoder->state  = next_gzip_state(decoder);
+            break;
+
+        case DECODE_BLOCK:
+
+            if (!pull_bits(decoder, 3)) {
+
+                return COMMC_SUCCESS;
+
+            }
+
+            decoder->last = (int)(decoder->bits & 1);
+            value         = (unsigned)((decoder->bits >> 1) & 3);
+
+            drop_bits(decoder, 3);
+
+            if (value == 0) {
+
+                drop_bits(decoder, decoder->bit_count & 7);
+                decoder->state = DECODE_STORED;
+
+            } else if (value == 1) {
+
+                fixed_lengths(lengths);
+                build_table(&decoder->literals, lengths, FLATE_LITERAL_CODES);
+                build_table(&decoder->distances, lengths + FLATE_LITERAL_CODES, FLATE_DISTANCE_CODES);
+
+                decoder->state = DECODE_CODES;
+
+            } else if (value == 2) {
+
+                decoder->state = DECODE_TABLE;
+
+            } else {
+
+                return COMMC_FORMAT_ERROR;
+
+            }
+
+            break;
+
+        case DECODE_STORED:
+
+            if (!pull_bits(decoder, 16)) {
+
+                return COMMC_SUCCESS;
+
+            }
+
+            decoder->remaining = decoder->bits & 0xFFFF;
+            decoder->state     = DECODE_STORED_CHECK;
+
+            drop_bits(decoder, 16);
+            break;
+
+        case DECODE_STORED_CHECK:
+
+            if (!pull_bits(decoder, 16)) {
+
+                return COMMC_SUCCESS;
+
+            }
+
+            if ((decoder->bits & 0xFFFF) != (~decoder->remaining & 0xFFFF)) {
+
+                return COMMC_FORMAT_ERROR;
+
+            }
+
+            drop_bits(decoder, 16);
+            decoder->state = DECODE_STORED_COPY;
+            break;
+
+        case DECODE_STORED_COPY:
+
+            while (decoder->remaining > 0) {
+
+                room = FLATE_WINDOW_SIZE - (decoder->total - decoder->flushed);
+
+                if (room == 0) {
+
+                    result = flush_window(decoder);
+
+                    if (result != COMMC_SUCCESS) {
+
+                        return result;
+
+                    }
+
+                    continue;
+
+                }
+
+                /* whole bytes left in the bit buffer come first */
+
+                if (decoder->bit_count >= 8) {
+
+                    decoder->window[decoder->total++ & FLATE_WINDOW_MASK] =
+                        (unsigned char)(decoder->bits & 0xFF);
+
+                    drop_bits(decoder, 8);
+                    decoder->remaining--;
+                    continue;
+
+                }
+
+                if (decoder->input == decoder->input_end) {
+
+                    return COMMC_SUCCESS;
+
+                }
+
+                length = FLATE_WINDOW_SIZE - (size_t)(decoder->total & FLATE_WINDOW_MASK);
+
+                if (length > room) {
+
+                    length = (size_t)room;
+
+                }
+
+                if (length > decoder->remaining) {
+
+                    length = (size_t)decoder->remaining;
+
+                }
+
+                if (length > (size_t)(decoder->input_end - decoder->input)) {
+
+                    length = (size_t)(decoder->input_end - decoder->input);
+
+                }
+
+                memcpy(decoder->window + (decoder->total & FLATE_WINDOW_MASK), decoder->input, length);
+
+                decoder->input     += length;
+                decoder->total     += length;
+                decoder->remaining -= length;
+
+            }
+
+            decoder->state = end_block(decoder);
+            break;
+
+        case DECODE_TABLE:
+
+            if (!pull_bits(decoder, 14)) {
+
+                return COMMC_SUCCESS;
+
+            }
+
+            decoder->literal_count  = (int)(decoder->bits & 0x1F) + 257;
+            decoder->distance_count = (int)((decoder->bits >> 5) & 0x1F) + 1;
+            decoder->length_count   = (int)((decoder->bits >> 10) & 0x0F) + 4;
+
+            drop_bits(decoder, 14);
+
+            if (decoder->literal_count > FLATE_USED_LITERALS ||
+                decoder->distance_count > FLATE_DISTANCE_CODES) {
+
+                return COMMC_FORMAT_ERROR;
+
+            }
+
+            memset(decoder->lengths, 0, FLATE_LENGTH_CODES);
+
+            decoder->index = 0;
+            decoder->state = DECODE_TABLE_LENGTHS;
+            break;
+
+        case DECODE_TABLE_LENGTHS:
+
+            while (decoder->index < decoder->length_count) {
+
+                if (!pull_bits(decoder, 3)) {
+
+                    return COMMC_SUCCESS;
+
+                }
+
+                decoder->lengths[flate_length_order[decoder->index++]] =
+                    (unsigned char)(decoder->bits & 7);
+
+                drop_bits(decoder, 3);
+
+            }
+
+            /* the code length code lives in the literal table until it is read */
+
+            if (!build_table(&decoder->literals, decoder->lengths, FLATE_LENGTH_CODES)) {
+
+                return COMMC_FORMAT_ERROR;
+
+            }
+
+            decoder->index = 0;
+            decoder->code  = -1;
+            decoder->state = DECODE_TABLE_CODES;
+            break;
+
+        case DECODE_TABLE_CODES:
+
+            while (decoder->index < decoder->literal_count + decoder->distance_count) {
+
+                if (decoder->code < 0) {
+
+                    symbol = decode_symbol(decoder, &decoder->literals);
+
+                    if (symbol == FLATE_NEED_INPUT) {
+
+                        return COMMC_SUCCESS;
+
+                    }
+
+                    if (symbol < 0 || symbol >= FLATE_LENGTH_CODES) {
+
+                        return COMMC_FORMAT_ERROR;
+
+                    }
+
+                    if (symbol < 16) {
+
+                        decoder->lengths[decoder->index++] = (unsigned char)symbol;
+                        continue;
+
+                    }
+
+                    decoder->code = symbol;
+
+                }
+
+                /* 16 repeats the previous length 3-6 times, 17 and 18 zero 3-10 and 11-138 */
+
+                extra = decoder->code == 16 ? 2 : decoder->code == 17 ? 3 : 7;
+
+                if (!pull_bits(decoder, extra)) {
+
+                    return COMMC_SUCCESS;
+
+                }
+
+                repeat = (int)(decoder->bits & ((1UL << extra) - 1)) +
+                         (decoder->code == 18 ? 11 : 3);
+
+                drop_bits(decoder, extra);
+
+                if (decoder->code == 16) {
+
+                    if (decoder->index == 0) {
+
+                        return COMMC_FORMAT_ERROR;
+
+                    }
+
+                    value = decoder->lengths[decoder->index - 1];
+
+                } else {
+
+                    value = 0;
+
+                }
+
+                if (decoder->index + repeat > decoder->literal_count + decoder->distance_count) {
+
+                    return COMMC_FORMAT_ERROR;
+
+                }
+
+                while (repeat-- > 0) {
+
+                    decoder->lengths[decoder->index++] = (unsigned char)value;
+
+                }
+
+                decoder->code = -1;
+
+            }
+
+            if (!read_tables(decoder)) {
+
+                return COMMC_FORMAT_ERROR;
+
+            }
+
+            decoder->state = DECODE_CODES;
+            break;
+
+        case DECODE_CODES:
+
+            /* literals stay in this loop; a match leaves room for its longest copy */
+
+            for (;;) {
+
+                if (decoder->total - decoder->flushed > FLATE_WINDOW_SIZE - FLATE_MAX_MATCH) {
+
+                    result = flush_window(decoder);
+
+                    if (result != COMMC_SUCCESS) {
+
+                        return result;
+
+                    }
+
+                }
+
+                symbol = decode_symbol(decoder, &decoder->literals);
+
+                if (symbol < 0 || symbol >= FLATE_END_OF_BLOCK) {
+
+                    break;
+
+                }
+
+                decoder->window[decoder->total++ & FLATE_WINDOW_MASK] = (unsigned char)symbol;
+
+            }
+
+            if (symbol == FLATE_NEED_INPUT) {
+
+                return COMMC_SUCCESS;
+
+            }
+
+            if (symbol == FLATE_END_OF_BLOCK) {
+
+                decoder->state = end_block(decoder);
+                break;
+
+            }
+
+            if (symbol < 0 || symbol >= FLATE_USED_LITERALS) {
+
+                return COMMC_FORMAT_ERROR;
+
+            }
+
+            decoder->code  = symbol - 257;
+            decoder->state = DECODE_LENGTH_EXTRA;
+            break;
+
+        case DECODE_LENGTH_EXTRA:
+
+            extra = flate_length_extra[decoder->code];
+
+            if (!pull_bits(decoder, extra)) {
+
+                return COMMC_SUCCESS;
+
+            }
+
+            decoder->copy_length = flate_length_base[decoder->code] +
+                                   (unsigned)(decoder->bits & ((1UL << extra) - 1));
+
+            drop_bits(decoder, extra);
+            decoder->state = DECODE_DISTANCE;
+            break;
+
+        case DECODE_DISTANCE:
+
+            symbol = decode_symbol(decoder, &decoder->distances);
+
+            if (symbol == FLATE_NEED_INPUT) {
+
+                return COMMC_SUCCESS;
+
+            }
+
+            if (symbol < 0 || symbol >= FLATE_DISTANCE_CODES) {
+
+                return COMMC_FORMAT_ERROR;
+
+            }
+
+            decoder->code  = symbol;
+            decoder->state = DECODE_DISTANCE_EXTRA;
+            break;
+
+        case DECODE_DISTANCE_EXTRA:
+
+            extra = flate_distance_extra[decoder->code];
+
+            if (!pull_bits(decoder, extra)) {
+
+                return COMMC_SUCCESS;
+
+            }
+
+            distance = flate_distance_base[decoder->code] + (decoder->bits & ((1UL << extra) - 1));
+            drop_bits(decoder, extra);
+
+            if (distance > decoder->history + (decoder->total - decoder->flushed)) {
+
+                return COMMC_FORMAT_ERROR;
+
+            }
+
+            /* byte by byte: a copy may overlap what it is writing */
+
+            while (decoder->copy_length > 0) {
+
+                decoder->window[decoder->total & FLATE_WINDOW_MASK] =
+                    decoder->window[(decoder->total - distance) & FLATE_WINDOW_MASK];
+
+                decoder->total++;
+                decoder->copy_length--;
+
+            }
+
+            decoder->state = DECODE_CODES;
+            break;
+
+        case DECODE_TRAILER:
+
+            /* the checksums cover everything, so hand it all on first */
+
+            result = flush_window(decoder);
+
+            if (result != COMMC_SUCCESS) {
+
+                return result;
+
+            }
+
+            length = decoder->format == COMMC_FLATE_GZIP ? 8 :
+                     decoder->format == COMMC_FLATE_ZLIB ? 4 : 0;
+
+            while ((size_t)decoder->trailer_length < length) {
+
+                if (!pull_bits(decoder, 8)) {
+
+                    return COMMC_SUCCESS;
+
+                }
+
+                decoder->trailer[decoder->trailer_length++] = (unsigned char)(decoder->bits & 0xFF);
+                drop_bits(decoder, 8);
+
+            }
+
+            if (decoder->format == COMMC_FLATE_ZLIB) {
+
+                if ((((unsigned long)decoder->trailer[0] << 24) |
+                     ((unsigned long)decoder->trailer[1] << 16) |
+                     ((unsigned long)decoder->trailer[2] << 8) |
+                     (unsigned long)decoder->trailer[3]) != decoder->check) {
+
+                    return COMMC_FORMAT_ERROR;
+
+                }
+
+            } else if (decoder->format == COMMC_FLATE_GZIP) {
+
+                if ((((unsigned long)decoder->trailer[3] << 24) |
+                     ((unsigned long)decoder->trailer[2] << 16) |
+                     ((unsigned long)decoder->trailer[1] << 8) |
+                     (unsigned long)decoder->trailer[0]) != decoder->check ||
+                    (((unsigned long)decoder->trailer[7] << 24) |
+                     ((unsigned long)decoder->trailer[6] << 16) |
+                     ((unsigned long)decoder->trailer[5] << 8) |
+                     (unsigned long)decoder->trailer[4]) != (decoder->total & 0xFFFFFFFFUL)) {
+
+                    return COMMC_FORMAT_ERROR;
+
+                }
+
+            }
+
+            decoder->state = DECODE_DONE;
+            break;
+
+        case DECODE_DONE:
+        default:
+
+            return COMMC_SUCCESS;
+
+        }
+
+    }
+
+}
+
+/*
+	==================================
+            --- ENCODING ---
+	==================================
+*/
+
+/*
+
+         flush_output()
+	       ---
+	       hands the output buffer to the callback. an
+	       error sticks to the encoder.
+
+*/
+
+static void flush_output(commc_flate_encoder_t* encoder) {
+
+    commc_error_t result;
+
+    if (encoder->out_length == 0 || encoder->error != COMMC_SUCCESS) {
+
+        encoder->out_length = 0;
+        return;
+
+    }
+
+    result = encoder->output((const char*)encoder->out, encoder->out_length, encoder->user_data);
+
+    if (result != COMMC_SUCCESS) {
+
+        encoder->error = result;
+
+    }
+
+    encoder->out_length = 0;
+
+}
+
+/*
+
+         put_byte()
+	       ---
+	       appends a byte to the output buffer.
+
+*/
+
+static void put_byte(commc_flate_encoder_t* encoder,
+                     unsigned               value) {
+
+    if (encoder->out_length == FLATE_OUTPUT_SIZE) {
+
+        flush_output(encoder);
+
+    }
+
+    encoder->out[encoder->out_length++] = (unsigned char)value;
+
+}
+
+/*
+
+         put_bits()
+	       ---
+	       appends the low count (at most 16) bits of value.
+
+*/
+
+static void put_bits(commc_flate_encoder_t* encoder,
+                     unsigned long          value,
+                     int                    count) {
+
+    encoder->bits      |= value << encoder->bit_count;
+    encoder->bit_count += count;
+
+    while (encoder->bit_count >= 8) {
+
+        put_byte(encoder, (unsigned)(encoder->bits & 0xFF));
+
+        encoder->bits      >>= 8;
+        encoder->bit_count -= 8;
+
+    }
+
+}
+
+/*
+
+         align_bits()
+	       ---
+	       pads the last partial byte with zero bits.
+
+*/
+
+static void align_bits(commc_flate_encoder_t* encoder) {
+
+    if (encoder->bit_count > 0) {
+
+        put_bits(encoder, 0, 8 - encoder->bit_count);
+
+    }
+
+}
+
+/*
+
+         distance_code()
+	       ---
+	       the distance code of distance. the table maps
+	       distances up to 256 directly and longer ones by
+	       their upper bits.
+
+*/
+
+static unsigned distance_code(const commc_flate_encoder_t* encoder,
+                              unsigned                     distance) {
+
+    distance--;
+
+    return distance < 256 ? encoder->distance_code[distance] :
+                            encoder->distance_code[256 + (distance >> 7)];
+
+}
+
+/*
+
+         compare_leaves()
+	       ---
+	       qsort order for build_lengths(): by weight, then
+	       by symbol.
+
+*/
+
+typedef struct {
+
+    unsigned long weight;
+    int           symbol;
+
+} flate_leaf_t;
+
+static int compare_leaves(const void* left,
+                          const void* right) {
+
+    const flate_leaf_t* a = (const flate_leaf_t*)left;
+    const flate_leaf_t* b = (const flate_leaf_t*)right;
+
+    if (a->weight != b->weight) {
+
+        return a->weight < b->weight ? -1 : 1;
+
+    }
+
+    return a->symbol - b->symbol;
+
+}
+
+/*
+
+         build_lengths()
+	       ---
+	       Huffman code lengths for count symbol
+	       frequencies, none longer than limit. leaves are
+	       sorted once and merged with a second queue of
+	       internal nodes, which are made in weight order;
+	       while the tree is too deep the frequencies are
+	       halved (never to zero) and it is built again.
+	       at least two symbols get codes, as decoders
+	       expect.
+
+*/
+
+static void build_lengths(const unsigned long* frequencies,
+                          int                  count,
+                          int                  limit,
+                          unsigned char*       lengths) {
+
+    flate_leaf_t  leaves[FLATE_LITERAL_CODES];
+    unsigned long weights[2 * FLATE_LITERAL_CODES];
+    int           parents[2 * FLATE_LITERAL_CODES];
+    int           depths[2 * FLATE_LITERAL_CODES];
+    int           used = 0;
+    int           leaf;
+    int           internal;
+    int           node;
+    int           pick;
+    int           side;
+    int           deepest;
+    int           symbol;
+
+    for (symbol = 0; symbol < count; symbol++) {
+
+        lengths[symbol] = 0;
+
+        if (frequencies[symbol]) {
+
+            leaves[used].weight   = frequencies[symbol];
+            leaves[used++].symbol = symbol;
+
+        }
+
+    }
+
+    for (symbol = 0; used < 2; symbol++) {
+
+        if (!frequencies[symbol]) {
+
+            leaves[used].weight   = 1;
+            leaves[used++].symbol = symbol;
+
+        }
+
+    }
+
+    qsort(leaves, (size_t)used, sizeof(flate_leaf_t), compare_leaves);
+
+    for (;;) {
+
+        for (leaf = 0; leaf < used; leaf++) {
+
+            weights[leaf] = leaves[leaf].weight;
+
+        }
+
+        leaf     = 0;
+        internal = used;
+
+        for (node = used; node < 2 * used - 1; node++) {
+
+            weights[node] = 0;
+
+            for (side = 0; side < 2; side++) {
+
+                if (leaf < used && (internal >= node || weights[leaf] <= weights[internal])) {
+
+                    pick = leaf++;
+
+                } else {
+
+                    pick = internal++;
+
+                }
+
+                weights[node] += weights[pick];
+                parents[pick]  = node;
+
+            }
+
+        }
+
+        depths[2 * used - 2] = 0;
+        deepest              = 0;
+
+        for (node = 2 * used - 3; node >= 0; node--) {
+
+            depths[node] = depths[parents[node]] + 1;
+
+            if (depths[node] > deepest) {
+
+                deepest = depths[node];
+
+            }
+
+        }
+
+        if (deepest <= limit) {
+
+            break;
+
+        }
+
+        /* halving keeps the order, so the leaves stay sorted */
+
+        for (leaf = 0; leaf < used; leaf++) {
+
+            leaves[leaf].weight = (leaves[leaf].weight + 1) >> 1;
+
+        }
+
+    }
+
+    for (leaf = 0; leaf < used; leaf++) {
+
+        lengths[leaves[leaf].symbol] = (unsigned char)depths[leaf];
+
+    }
+
+}
+
+/*
+
+         encode_lengths()
+	       ---
+	       run-length codes the code lengths of a dynamic
+	       block: 16 repeats the previous length, 17 and 18
+	       are runs of zeros. returns the number of codes.
+
+*/
+
+static int encode_lengths(const unsigned char* lengths,
+                          int                  count,
+                          unsigned char*       codes,
+                          unsigned char*       extras) {
+
+    int output = 0;
+    int index  = 0;
+    int run;
+    int take;
+
+    while (index < count) {
+
+        run = 1;
+
+        while (index + run < count && lengths[index + run] == lengths[index]) {
+
+            run++;
+
+        }
+
+        if (lengths[index] == 0) {
+
+            while (run >= 11) {
+
+                take             = run > 138 ? 138 : run;
+                codes[output]    = 18;
+                extras[output++] = (unsigned char)(take - 11);
+                run             -= take;
+                index           += take;
+
+            }
+
+            if (run >= 3) {
+
+                codes[output]    = 17;
+                extras[output++] = (unsigned char)(run - 3);
+                index           += run;
+                run              = 0;
+
+            }
+
+        } else {
+
+            codes[output]    = lengths[index];
+            extras[output++] = 0;
+            run--;
+            index++;
+
+            while (run >= 3) {
+
+                take             = run > 6 ? 6 : run;
+                codes[output]    = 16;
+                extras[output++] = (unsigned char)(take - 3);
+                run             -= take;
+                index           += take;
+
+            }
+
+        }
+
+        while (run-- > 0) {
+
+            codes[output]    = lengths[index++];
+            extras[output++] = 0;
+
+        }
+
+    }
+
+    return output;
+
+}
+
+/*
+
+         put_symbols()
+	       ---
+	       writes the block's symbols and its end with the
+	       given codes.
+
+*/
+
+static void put_symbols(commc_flate_encoder_t* encoder,
+                        const unsigned short*  literal_codes,
+                        const unsigned char*   literal_lengths,
+                        const unsigned short*  distance_codes,
+                        const unsigned char*   distance_lengths) {
+
+    size_t   index;
+    unsigned value;
+    unsigned distance;
+    unsigned code;
+
+    for (index = 0; index < encoder->symbol_count; index++) {
+
+        value    = encoder->symbol_length[index];
+        distance = encoder->symbol_distance[index];
+
+        if (distance == 0) {
+
+            put_bits(encoder, literal_codes[value], literal_lengths[value]);
+            continue;
+
+        }
+
+        code = encoder->length_code[value];
+        put_bits(encoder, literal_codes[257 + code], literal_lengths[257 + code]);
+
+        if (flate_length_extra[code]) {
+
+            put_bits(encoder, value + 3 - flate_length_base[code], flate_length_extra[code]);
+
+        }
+
+        code = distance_code(encoder, distance);
+        put_bits(encoder, distance_codes[code], distance_lengths[code]);
+
+        if (flate_distance_extra[code]) {
+
+            put_bits(encoder, distance - flate_distance_base[code], flate_distance_extra[code]);
+
+        }
+
+    }
+
+    put_bits(encoder, literal_codes[FLATE_END_OF_BLOCK], literal_lengths[FLATE_END_OF_BLOCK]);
+
+}
+
+/*
+
+         emit_block()
+	       ---
+	       writes the bytes since block_start as one block
+	       (last marks the final one): stored, with the
+	       fixed codes or with codes built from the
+	       block's symbols, whichever is estimated
+	       smallest.
+
+*/
+
+static void emit_block(commc_flate_encoder_t* encoder,
+                       int                    last) {
+
+    unsigned long  literal_frequencies[FLATE_LITERAL_CODES];
+    unsigned long  distance_frequencies[FLATE_DISTANCE_CODES];
+    unsigned long  length_frequencies[FLATE_LENGTH_CODES];
+    unsigned char  literal_lengths[FLATE_LITERAL_CODES];
+    unsigned char  distance_lengths[FLATE_DISTANCE_CODES];
+    unsigned char  length_lengths[FLATE_LENGTH_CODES];
+    unsigned short literal_codes[FLATE_LITERAL_CODES];
+    unsigned short distance_codes[FLATE_DISTANCE_CODES];
+    unsigned short length_codes[FLATE_LENGTH_CODES];
+    unsigned char  fixed[FLATE_LITERAL_CODES + FLATE_DISTANCE_CODES];
+    unsigned char  lengths[FLATE_USED_LITERALS + FLATE_DISTANCE_CODES];
+    unsigned char  runs[FLATE_USED_LITERALS + FLATE_DISTANCE_CODES];
+    unsigned char  run_extras[FLATE_USED_LITERALS + FLATE_DISTANCE_CODES];
+    unsigned long  extra_bits = 0;
+    unsigned long  fixed_cost;
+    unsigned long  dynamic_cost;
+    unsigned long  stored_cost;
+    unsigned long  raw_length;
+    size_t         index;
+    size_t         chunk;
+    size_t         stored;
+    unsigned       code;
+    int            literal_count;
+    int            distance_count;
+    int            length_count;
+    int            run_count;
+    int            symbol;
+
+    raw_length = (unsigned long)((long)(encoder->position - encoder->match_available) -
+                                 encoder->block_start);
+
+    memset(literal_frequencies, 0, sizeof(literal_frequencies));
+    memset(distance_frequencies, 0, sizeof(distance_frequencies));
+    memset(length_frequencies, 0, sizeof(length_frequencies));
+
+    for (index = 0; index < encoder->symbol_count; index++) {
+
+        if (encoder->symbol_distance[index] == 0) {
+
+            literal_frequencies[encoder->symbol_length[index]]++;
+            continue;
+
+        }
+
+        code = encoder->length_code[encoder->symbol_length[index]];
+        literal_frequencies[257 + code]++;
+        extra_bits += flate_length_extra[code];
+
+        code = distance_code(encoder, encoder->symbol_distance[index]);
+        distance_frequencies[code]++;
+        extra_bits += flate_distance_extra[code];
+
+    }
+
+    literal_frequencies[FLATE_END_OF_BLOCK] = 1;
+
+    /* dynamic codes and what sending them costs */
+
+    build_lengths(literal_frequencies, FLATE_USED_LITERALS, FLATE_MAX_BITS, literal_lengths);
+    build_lengths(distance_frequencies, FLATE_DISTANCE_CODES, FLATE_MAX_BITS, distance_lengths);
+
+    literal_count  = FLATE_USED_LITERALS;
+    distance_count = FLATE_DISTANCE_CODES;
+
+    while (literal_lengths[literal_count - 1] == 0) {
+
+        literal_count--;
+
+    }
+
+    while (distance_count > 1 && distance_lengths[distance_count - 1] == 0) {
+
+        distance_count--;
+
+    }
+
+    memcpy(lengths, literal_lengths, (size_t)literal_count);
+    memcpy(lengths + literal_count, distance_lengths, (size_t)distance_count);
+
+    run_count = encode_lengths(lengths, literal_count + distance_count, runs, run_extras);
+
+    for (symbol = 0; symbol < run_count; symbol++) {
+
+        length_frequencies[runs[symbol]]++;
+
+    }
+
+    build_lengths(length_frequencies, FLATE_LENGTH_CODES, 7, length_lengths);
+
+    length_count = FLATE_LENGTH_CODES;
+
+    while (length_count > 4 && length_lengths[flate_length_order[length_count - 1]] == 0) {
+
+        length_count--;
+
+    }
+
+    dynamic_cost = 3 + 14 + 3UL * (unsigned long)length_count + extra_bits;
+    fixed_cost   = 3 + extra_bits;
+
+    fixed_lengths(fixed);
+
+    for (symbol = 0; symbol < run_count; symbol++) {
+
+        dynamic_cost += length_lengths[runs[symbol]];
+        dynamic_cost += runs[symbol] == 16 ? 2 : runs[symbol] == 17 ? 3 : runs[symbol] == 18 ? 7 : 0;
+
+    }
+
+    for (symbol = 0; symbol < FLATE_USED_LITERALS; symbol++) {
+
+        dynamic_cost += literal_frequencies[symbol] * literal_lengths[symbol];
+        fixed_cost   += literal_frequencies[symbol] * fixed[symbol];
+
+    }
+
+    for (symbol = 0; symbol < FLATE_DISTANCE_CODES; symbol++) {
+
+        dynamic_cost += distance_frequencies[symbol] * distance_lengths[symbol];
+        fixed_cost   += distance_frequencies[symbol] * 5;
+
+    }
+
+    /* a block that started before the window slid cannot be stored */
+
+    stored_cost = (unsigned long)-1;
+
+    if (encoder->block_start >= 0) {
+
+        stored_cost = raw_length * 8 + (raw_length / FLATE_STORED_MAX + 1) * (3 + 7 + 32);
+
+    }
+
+    if (encoder->level == 0 ||
+        (stored_cost <= fixed_cost && stored_cost <= dynamic_cost)) {
+
+        /* stored blocks hold at most 65535 bytes; only the last may be final */
+
+        stored = 0;
+
+        do {
+
+            chunk = raw_length - stored;
+
+            if (chunk > FLATE_STORED_MAX) {
+
+                chunk = FLATE_STORED_MAX;
+
+            }
+
+            put_bits(encoder, last && stored + chunk == raw_length, 3);
+            align_bits(encoder);
+
+            put_byte(encoder, (unsigned)(chunk & 0xFF));
+            put_byte(encoder, (unsigned)(chunk >> 8));
+            put_byte(encoder, (unsigned)(~chunk & 0xFF));
+            put_byte(encoder, (unsigned)((~chunk >> 8) & 0xFF));
+
+            for (index = 0; index < chunk; index++) {
+
+                put_byte(encoder, encoder->window[(size_t)encoder->block_start + stored + index]);
+
+            }
+
+            stored += chunk;
+
+        } while (stored < raw_length);
+
+    } else if (fixed_cost <= dynamic_cost) {
+
+        assign_codes(fixed, FLATE_LITERAL_CODES, literal_codes);
+        assign_codes(fixed + FLATE_LITERAL_CODES, FLATE_DISTANCE_CODES, distance_codes);
+
+        put_bits(encoder, (unsigned long)last | (1UL << 1), 3);
+        put_symbols(encoder, literal_codes, fixed, distance_codes, fixed + FLATE_LITERAL_CODES);
+
+    } else {
+
+        assign_codes(literal_lengths, FLATE_USED_LITERALS, literal_codes);
+        assign_codes(distance_lengths, FLATE_DISTANCE_CODES, distance_codes);
+        assign_codes(length_lengths, FLATE_LENGTH_CODES, length_codes);
+
+        put_bits(encoder, (unsigned long)last | (2UL << 1), 3);
+        put_bits(encoder, (unsigned long)(literal_count - 257), 5);
+        put_bits(encoder, (unsigned long)(distance_count - 1), 5);
+        put_bits(encoder, (unsigned long)(length_count - 4), 4);
+
+        for (symbol = 0; symbol < length_count; symbol++) {
+
+            put_bits(encoder, length_lengths[flate_length_order[symbol]], 3);
+
+        }
+
+        for (symbol = 0; symbol < run_count; symbol++) {
+
+            code = runs[symbol];
+            put_bits(encoder, length_codes[code], length_lengths[code]);
+
+            if (code >= 16) {
+
+                put_bits(encoder, run_extras[symbol], code == 16 ? 2 : code == 17 ? 3 : 7);
+
+            }
+
+        }
+
+        put_symbols(encoder, literal_codes, literal_lengths, distance_codes, distance_lengths);
+
+    }
+
+    encoder->block_start += (long)raw_length;
+    encoder->symbol_count = 0;
+
+}
+
+/*
+
+         hash_at()
+	       ---
+	       hash of the three bytes at position.
+
+*/
+
+static unsigned hash_at(const commc_flate_encoder_t* encoder,
+                        size_t                       position) {
+
+    const unsigned char* bytes = encoder->window + position;
+    unsigned long        value;
+
+    value = (unsigned long)bytes[0] | ((unsigned long)bytes[1] << 8) | ((unsigned long)bytes[2] << 16);
+
+    return (unsigned)(((value * 2654435761UL) & 0xFFFFFFFFUL) >> (32 - FLATE_HASH_BITS));
+
+}
+
+/*
+
+         insert_string()
+	       ---
+	       links position into its hash chain and returns
+	       the previous head of the chain (0 for none).
+
+*/
+
+static unsigned insert_string(commc_flate_encoder_t* encoder,
+                              size_t                 position) {
+
+    unsigned hash = hash_at(encoder, position);
+    unsigned previous = encoder->head[hash];
+
+    encoder->prev[position & FLATE_WINDOW_MASK] = (unsigned short)previous;
+    encoder->head[hash]                         = (unsigned short)position;
+
+    return previous;
+
+}
+
+/*
+
+         longest_match()
+	       ---
+	       follows the chain from candidate for a match at
+	       position longer than best. returns its length,
+	       or best when there is none (distance untouched).
+
+*/
+
+static unsigned longest_match(commc_flate_encoder_t* encoder,
+                              unsigned               candidate,
+                              unsigned               best,
+                              unsigned*              distance) {
+
+    const unsigned char* window = encoder->window;
+    const unsigned char* here   = window + encoder->position;
+    const unsigned char* there;
+    size_t               limit;
+    unsigned             chain  = flate_levels[encoder->level].chain;
+    unsigned             nice   = flate_levels[encoder->level].nice;
+    unsigned             longest;
+    unsigned             length;
+
+    longest = (unsigned)(encoder->window_end - encoder->position);
+
+    if (longest > FLATE_MAX_MATCH) {
+
+        longest = FLATE_MAX_MATCH;
+
+    }
+
+    if (best >= longest) {
+
+        return best;
+
+    }
+
+    if (nice > longest) {
+
+        nice = longest;
+
+    }
+
+    if (best >= flate_levels[encoder->level].good) {
+
+        chain >>= 2;
+
+    }
+
+    limit = encoder->position > FLATE_WINDOW_SIZE ? encoder->position - FLATE_WINDOW_SIZE : 0;
+
+    do {
+
+        there = window + candidate;
+
+        /* the byte that would make it longer is the likeliest to differ */
+
+        if (there[best] != here[best] || there[0] != here[0] || there[1] != here[1]) {
+
+            continue;
+
+        }
+
+        length = 2;
+
+        while (length < longest && there[length] == here[length]) {
+
+            length++;
+
+        }
+
+        if (length > best) {
+
+            best      = length;
+            *distance = (unsigned)(encoder->position - candidate);
+
+            if (length >= nice) {
+
+                break;
+
+            }
+
+        }
+
+    } while ((candidate = encoder->prev[candidate & FLATE_WINDOW_MASK]) > limit && --chain != 0);
+
+    return best;
+
+}
+
+/*
+
+         record_literal() / record_match()
+	       ---
+	       append a symbol to the block, writing the block
+	       first if it is full.
+
+*/
+
+static void record_literal(commc_flate_encoder_t* encoder,
+                           unsigned               value) {
+
+    encoder->symbol_length[encoder->symbol_count]     = (unsigned char)value;
+    encoder->symbol_distance[encoder->symbol_count++] = 0;
+
+}
+
+static void record_match(commc_flate_encoder_t* encoder,
+                         unsigned               length,
+                         unsigned               distance) {
+
+    encoder->symbol_length[encoder->symbol_count]     = (unsigned char)(length - FLATE_MIN_MATCH);
+    encoder->symbol_distance[encoder->symbol_count++] = (unsigned short)distance;
+
+}
+
+/*
+
+         compress()
+	       ---
+	       matches the window from position on. until
+	       finishing, FLATE_MIN_LOOKAHEAD bytes are left
+	       so every match can reach its longest. a match
+	       found at position - 1 is held back one step and
+	       dropped if position starts a longer one.
+
+*/
+
+static void compress(commc_flate_encoder_t* encoder,
+                     int                    finishing) {
+
+    size_t   lookahead;
+    size_t   end;
+    unsigned head;
+    unsigned previous_length;
+    unsigned previous_distance;
+
+    if (encoder->level == 0) {
+
+        encoder->position = encoder->window_end;
+
+        if (!finishing && encoder->position - (size_t)encoder->block_start >= FLATE_WINDOW_SIZE) {
+
+            emit_block(encoder, 0);
+
+        }
+
+        return;
+
+    }
+
+    for (;;) {
+
+        lookahead = encoder->window_end - encoder->position;
+
+        if (lookahead == 0 || (lookahead < FLATE_MIN_LOOKAHEAD && !finishing)) {
+
+            break;
+
+        }
+
+        if (encoder->symbol_count == FLATE_BLOCK_SYMBOLS) {
+
+            emit_block(encoder, 0);
+
+        }
+
+        head = 0;
+
+        if (lookahead >= FLATE_MIN_MATCH) {
+
+            head = insert_string(encoder, encoder->position);
+
+        }
+
+        previous_length         = encoder->match_length;
+        previous_distance       = encoder->match_distance;
+        encoder->match_length   = FLATE_MIN_MATCH - 1;
+
+        if (head != 0 && previous_length < flate_levels[encoder->level].lazy &&
+            encoder->position - head <= FLATE_WINDOW_SIZE) {
+
+            encoder->match_length = longest_match(encoder, head, FLATE_MIN_MATCH - 1,
+                                                  &encoder->match_distance);
+
+            if (encoder->match_length == FLATE_MIN_MATCH && encoder->match_distance > FLATE_TOO_FAR) {
+
+                encoder->match_length = FLATE_MIN_MATCH - 1;
+
+            }
+
+        }
+
+        if (previous_length >= FLATE_MIN_MATCH && encoder->match_length <= previous_length) {
+
+            /* the held match wins; index the strings it covers */
+
+            record_match(encoder, previous_length, previous_distance);
+
+            end = encoder->position + previous_length - 1;
+
+            for (encoder->position++; encoder->position < end; encoder->position++) {
+
+                if (encoder->position + FLATE_MIN_MATCH <= encoder->window_end) {
+
+                    insert_string(encoder, encoder->position);
+
+                }
+
+            }
+
+            encoder->match_available = 0;
+            encoder->match_length    = FLATE_MIN_MATCH - 1;
+
+        } else if (encoder->match_available) {
+
+            record_literal(encoder, encoder->window[encoder->position - 1]);
+            encoder->position++;
+
+        } else {
+
+            encoder->match_available = 1;
+            encoder->position++;
+
+        }
+
+    }
+
+    if (finishing && encoder->match_available) {
+
+        if (encoder->symbol_count == FLATE_BLOCK_SYMBOLS) {
+
+            emit_block(encoder, 0);
+
+        }
+
+        record_literal(encoder, encoder->window[encoder->position - 1]);
+        encoder->match_available = 0;
+
+    }
+
+}
+
+/*
+
+         slide_window()
+	       ---
+	       moves the upper half of the window down and
+	       rebases every stored position, dropping those
+	       that fall out.
+
+*/
+
+static void slide_window(commc_flate_encoder_t* encoder) {
+
+    size_t index;
+
+    memmove(encoder->window, encoder->window + FLATE_WINDOW_SIZE, FLATE_WINDOW_SIZE);
+
+    encoder->window_end  -= FLATE_WINDOW_SIZE;
+    encoder->position    -= FLATE_WINDOW_SIZE;
+    encoder->block_start -= FLATE_WINDOW_SIZE;
+
+    for (index = 0; index < FLATE_HASH_SIZE; index++) {
+
+        encoder->head[index] = (unsigned short)(encoder->head[index] >= FLATE_WINDOW_SIZE ?
+                                                encoder->head[index] - FLATE_WINDOW_SIZE : 0);
+
+    }
+
+    for (index = 0; index < FLATE_WINDOW_SIZE; index++) {
+
+        encoder->prev[index] = (unsigned short)(encoder->prev[index] >= FLATE_WINDOW_SIZE ?
+                                                encoder->prev[index] - FLATE_WINDOW_SIZE : 0);
+
+    }
+
+}
+
+/*
+
+         put_header()
+	       ---
+	       writes the zlib or gzip header.
+
+*/
+
+static void put_header(commc_flate_encoder_t* encoder) {
+
+    unsigned flags;
+
+    if (encoder->format == COMMC_FLATE_ZLIB) {
+
+        /* 32 KB window, deflate; FLEVEL hints at the level */
+
+        flags = encoder->level < 2 ? 0 : encoder->level < 6 ? 1 : encoder->level == 6 ? 2 : 3;
+        flags <<= 6;
+        flags  += 31 - ((0x78U << 8) | flags) % 31;
+
+        put_byte(encoder, 0x78);
+        put_byte(encoder, flags);
+
+    } else if (encoder->format == COMMC_FLATE_GZIP) {
+
+        put_byte(encoder, 0x1F);
+        put_byte(encoder, 0x8B);
+        put_byte(encoder, 8);                  /* DEFLATE */
+        put_byte(encoder, 0);                  /* NO FLAGS */
+        put_byte(encoder, 0);                  /* NO MTIME */
+        put_byte(encoder, 0);
+        put_byte(encoder, 0);
+        put_byte(encoder, 0);
+        put_byte(encoder, encoder->level == 9 ? 2 : encoder->level == 1 ? 4 : 0);
+        put_byte(encoder, 255);                /* OS UNKNOWN */
+
+    }
+
+}
+
+/*
+
+         put_word()
+	       ---
+	       writes a 32-bit trailer value, most significant
+	       byte first if big_endian.
+
+*/
+
+static void put_word(commc_flate_encoder_t* encoder,
+                     unsigned long          value,
+                     int                    big_endian) {
+
+    int byte;
+
+    for (byte = 0; byte < 4; byte++) {
+
+        put_byte(encoder, (unsigned)((value >> (big_endian ? 24 - 8 * byte : 8 * byte)) & 0xFF));
+
+    }
+
+}
+
+/*
+	==================================
+          --- DECODER API ---
+	==================================
+*/
+
+/*
+
+         commc_flate_decoder_create()
+	       ---
+	       allocates a decoder waiting for the header of
+	       its format.
+
+*/
+
+commc_error_t commc_flate_decoder_create(commc_flate_decoder_t** decoder,
+                                         commc_flate_format_t    format,
+                                         commc_flate_output_t    output,
+                                         void*                   user_data) {
+
+    commc_flate_decoder_t* new_decoder;
+
+    if (!decoder || !output || format < COMMC_FLATE_RAW || format > COMMC_FLATE_AUTO) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    new_decoder = (commc_flate_decoder_t*)malloc(sizeof(commc_flate_decoder_t));
+
+    if (!new_decoder) {
+
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    new_decoder->created   = format;
+    new_decoder->output    = output;
+    new_decoder->user_data = user_data;
+
+    commc_flate_decoder_reset(new_decoder);
+
+    *decoder = new_decoder;
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_flate_decoder_destroy()
+	       ---
+	       frees a decoder.
+
+*/
+
+void commc_flate_decoder_destroy(commc_flate_decoder_t* decoder) {
+
+    free(decoder);
+
+}
+
+/*
+
+         commc_flate_decoder_reset()
+	       ---
+	       clears the stream state; the window needs no
+	       clearing, as nothing is read from it before it
+	       is written.
+
+*/
+
+void commc_flate_decoder_reset(commc_flate_decoder_t* decoder) {
+
+    commc_flate_format_t format;
+    commc_flate_output_t output;
+    void*                user_data;
+
+    if (!decoder) {
+
+        return;
+
+    }
+
+    format    = decoder->created;
+    output    = decoder->output;
+    user_data = decoder->user_data;
+
+    memset(decoder, 0, offsetof(commc_flate_decoder_t, window));
+
+    decoder->created   = format;
+    decoder->format    = format;
+    decoder->output    = output;
+    decoder->user_data = user_data;
+    decoder->state     = format == COMMC_FLATE_RAW ? DECODE_BLOCK : DECODE_HEADER;
+    decoder->error     = COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_flate_decoder_write()
+	       ---
+	       decodes as far as the bytes allow and hands on
+	       everything decoded.
+
+*/
+
+commc_error_t commc_flate_decoder_write(commc_flate_decoder_t* decoder,
+                                        const void*            data,
+                                        size_t                 length) {
+
+    commc_error_t result;
+
+    if (!decoder || (!data && length > 0)) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (decoder->state == DECODE_FAILED) {
+
+        return decoder->error;
+
+    }
+
+    decoder->input     = (const unsigned char*)data;
+    decoder->input_end = decoder->input + length;
+
+    result = decode(decoder);
+
+    if (result == COMMC_SUCCESS) {
+
+        result = flush_window(decoder);
+
+    }
+
+    decoder->input     = NULL;
+    decoder->input_end = NULL;
+
+    if (result != COMMC_SUCCESS) {
+
+        decoder->state = DECODE_FAILED;
+        decoder->error = result;
+
+    }
+
+    return result;
+
+}
+
+/*
+
+         commc_flate_decoder_finish()
+	       ---
+	       reports whether the stream ended completely.
+
+*/
+
+commc_error_t commc_flate_decoder_finish(commc_flate_decoder_t* decoder) {
+
+    if (!decoder) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    return decoder->state == DECODE_DONE ? COMMC_SUCCESS : COMMC_FORMAT_ERROR;
+
+}
+
+/*
+	==================================
+          --- ENCODER API ---
+	==================================
+*/
+
+/*
+
+         commc_flate_encoder_create()
+	       ---
+	       allocates an encoder and its code tables. the
+	       header is written with the first output.
+
+*/
+
+commc_error_t commc_flate_encoder_create(commc_flate_encoder_t** encoder,
+                                         commc_flate_format_t    format,
+                                         int                     level,
+                                         commc_flate_output_t    output,
+                                         void*                   user_data) {
+
+    commc_flate_encoder_t* new_encoder;
+    unsigned               value;
+    unsigned               code;
+    unsigned               step;
+
+    if (!encoder || !output || format < COMMC_FLATE_RAW || format > COMMC_FLATE_GZIP ||
+        level < COMMC_FLATE_LEVEL_STORE || level > COMMC_FLATE_LEVEL_BEST) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    new_encoder = (commc_flate_encoder_t*)malloc(sizeof(commc_flate_encoder_t));
+
+    if (!new_encoder) {
+
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    new_encoder->format    = format;
+    new_encoder->output    = output;
+    new_encoder->user_data = user_data;
+    new_encoder->level     = level;
+
+    /* sliding rebases every prev entry, so none may be left unset */
+
+    memset(new_encoder->prev, 0, sizeof(new_encoder->prev));
+    commc_flate_encoder_reset(new_encoder);
+
+    /* length - 3 by code; 258 has a code of its own */
+
+    value = 0;
+
+    for (code = 0; code < 28; code++) {
+
+        for (step = 0; step < (1U << flate_length_extra[code]); step++) {
+
+            new_encoder->length_code[value++] = (unsigned char)code;
+
+        }
+
+    }
+
+    new_encoder->length_code[255] = 28;
+
+    /* distance - 1 directly up to 256, then in steps of 128 */
+
+    value = 0;
+
+    for (code = 0; code < 16; code++) {
+
+        for (step = 0; step < (1U << flate_distance_extra[code]); step++) {
+
+            new_encoder->distance_code[value++] = (unsigned char)code;
+
+        }
+
+    }
+
+    value >>= 7;
+
+    for (; code < FLATE_DISTANCE_CODES; code++) {
+
+        for (step = 0; step < (1U << (flate_distance_extra[code] - 7)); step++) {
+
+            new_encoder->distance_code[256 + value++] = (unsigned char)code;
+
+        }
+
+    }
+
+    *encoder = new_encoder;
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_flate_encoder_destroy()
+	       ---
+	       frees an encoder.
+
+*/
+
+void commc_flate_encoder_destroy(commc_flate_encoder_t* encoder) {
+
+    free(encoder);
+
+}
+
+/*
+
+         commc_flate_encoder_reset()
+	       ---
+	       clears the stream state and the hash heads.
+	       prev needs no clearing: chains start at a head,
+	       so only entries written since are followed.
+
+*/
+
+void commc_flate_encoder_reset(commc_flate_encoder_t* encoder) {
+
+    if (!encoder) {
+
+        return;
+
+    }
+
+    encoder->error           = COMMC_SUCCESS;
+    encoder->started         = 0;
+    encoder->finished        = 0;
+    encoder->check           = encoder->format == COMMC_FLATE_ZLIB ? 1 : 0;
+    encoder->total           = 0;
+    encoder->window_end      = 0;
+    encoder->position        = 0;
+    encoder->block_start     = 0;
+    encoder->match_length    = FLATE_MIN_MATCH - 1;
+    encoder->match_distance  = 0;
+    encoder->match_available = 0;
+    encoder->symbol_count    = 0;
+    encoder->bits            = 0;
+    encoder->bit_count       = 0;
+    encoder->out_length      = 0;
+
+    memset(encoder->head, 0, sizeof(encoder->head));
+
+}
+
+/*
+
+         commc_flate_encoder_write()
+	       ---
+	       appends the bytes to the window, sliding it
+	       whenever it is full, and matches what it can.
+
+*/
+
+commc_error_t commc_flate_encoder_write(commc_flate_encoder_t* encoder,
+                                        const void*            data,
+                                        size_t                 length) {
+
+    const unsigned char* input = (const unsigned char*)data;
+    size_t               chunk;
+
+    if (!encoder || (!data && length > 0)) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (encoder->finished) {
+
+        return COMMC_ERROR_INVALID_STATE;
+
+    }
+
+    if (!encoder->started) {
+
+        put_header(encoder);
+        encoder->started = 1;
+
+    }
+
+    if (encoder->format == COMMC_FLATE_GZIP) {
+
+        encoder->check = commc_flate_crc32(encoder->check, input, length);
+
+    } else if (encoder->format == COMMC_FLATE_ZLIB) {
+
+        encoder->check = commc_flate_adler32(encoder->check, input, length);
+
+    }
+
+    encoder->total += (unsigned long)length;
+
+    while (length > 0 && encoder->error == COMMC_SUCCESS) {
+
+        if (encoder->window_end == 2 * FLATE_WINDOW_SIZE) {
+
+            slide_window(encoder);
+
+        }
+
+        chunk = 2 * FLATE_WINDOW_SIZE - encoder->window_end;
+
+        if (chunk > length) {
+
+            chunk = length;
+
+        }
+
+        memcpy(encoder->window + encoder->window_end, input, chunk);
+
+        encoder->window_end += chunk;
+        input               += chunk;
+        length              -= chunk;
+
+        compress(encoder, 0);
+
+    }
+
+    return encoder->error;
+
+}
+
+/*
+
+         commc_flate_encoder_finish()
+	       ---
+	       matches the rest, writes it as the final block,
+	       adds the trailer and flushes.
+
+*/
+
+commc_error_t commc_flate_encoder_finish(commc_flate_encoder_t* encoder) {
+
+    if (!encoder) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (encoder->finished) {
+
+        return COMMC_ERROR_INVALID_STATE;
+
+    }
+
+    if (!encoder->started) {
+
+        put_header(encoder);
+        encoder->started = 1;
+
+    }
+
+    compress(encoder, 1);
+    emit_block(encoder, 1);
+    align_bits(encoder);
+
+    if (encoder->format == COMMC_FLATE_ZLIB) {
+
+        put_word(encoder, encoder->check, 1);
+
+    } else if (encoder->format == COMMC_FLATE_GZIP) {
+
+        put_word(encoder, encoder->check, 0);
+        put_word(encoder, encoder->total, 0);
+
+    }
+
+    encoder->finished = 1;
+    flush_output(encoder);
+
+    return encoder->error;
+
+}
+
+/*
+	==================================
+           --- CHECKSUMS ---
+	==================================
+*/
+
+/*
+
+         commc_flate_crc32()
+	       ---
+	       table-driven, a byte at a time.
+
+*/
+
+unsigned long commc_flate_crc32(unsigned long crc,
+                                const void*   data,
+                                size_t        length) {
+
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    crc = ~crc & 0xFFFFFFFFUL;
+
+    while (length-- > 0) {
+
+        crc = flate_crc_table[(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+
+    }
+
+    return ~crc & 0xFFFFFFFFUL;
+
+}
+
+/*
+
+         commc_flate_adler32()
+	       ---
+	       both sums are reduced every 5552 bytes, the most
+	       that cannot overflow 32 bits.
+
+*/
+
+unsigned long commc_flate_adler32(unsigned long adler,
+                                  const void*   data,
+                                  size_t        length) {
+
+    const unsigned char* bytes = (const unsigned char*)data;
+    unsigned long        low   = adler & 0xFFFF;
+    unsigned long        high  = (adler >> 16) & 0xFFFF;
+    size_t               chunk;
+
+    while (length > 0) {
+
+        chunk   = length < 5552 ? length : 5552;
+        length -= chunk;
+
+        while (chunk-- > 0) {
+
+            low  += *bytes++;
+            high += low;
+
+        }
+
+        low  %= 65521;
+        high %= 65521;
+
+    }
+
+    return (high << 16) | low;
+
+}
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
@@ -27,27 +27,64 @@
 	==================================
 */
 
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L    /* GETADDRINFO, FTRUNCATE */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #if defined(_MSC_VER)
 #pragma comment(lib, "ws2_32.lib")
 #endif
 #define close closesocket
+#define open_local_file(path) _open((path), _O_RDONLY | _O_BINARY)
+#define create_local_file(path) _open((path), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE)
+#define open_local_output(path) _open((path), _O_WRONLY | _O_BINARY)
+#define close_local_file(fd)  _close(fd)
+#define read_local_file(fd, buffer, size) _read((fd), (buffer), (unsigned int)(size))
+#define write_local_file(fd, buffer, size) _write((fd), (buffer), (unsigned int)(size))
+#define seek_local_file(fd, offset) (_lseeki64((fd), (__int64)(offset), SEEK_SET) != -1)
+#define resize_local_file(fd, size) (_chsize_s((fd), (__int64)(size)) == 0)
+#define unmap_local_file(view, size)
 #else
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <time.h>
+#define open_local_file(path) open((path), O_RDONLY)
+#define create_local_file(path) open((path), O_WRONLY | O_CREAT | O_TRUNC, 0666)
+#define open_local_output(path) open((path), O_WRONLY)
+#define close_local_file(fd)  close(fd)
+#define read_local_file(fd, buffer, size) read((fd), (buffer), (size))
+#define write_local_file(fd, buffer, size) write((fd), (buffer), (size))
+#define seek_local_file(fd, offset) (lseek((fd), (off_t)(offset), SEEK_SET) != (off_t)-1)
+#define resize_local_file(fd, size) (ftruncate((fd), (off_t)(size)) == 0)
+#define unmap_local_file(view, size) munmap((void*)(view), (size))
 #endif
 
 #include "commc/ftp.h"
+#include "commc/atomic.h"
+#include "commc/socket.h"
+#include "commc/bufreader.h"
+#include "commc/threadpool.h"
+#include "commc/memory.h"
+#include "commc/time.h"
 #include "commc/error.h"
 
 /* 
@@ -60,6 +97,51 @@
 #define FTP_RESPONSE_BUFFER_SIZE 2048
 #define FTP_DATA_BUFFER_SIZE     8192
 #define FTP_INVALID_SOCKET       (-1)
+#define FTP_SENDFILE_SLICE       1048576
+
+/* 
+	==================================
+           --- STRUCTURES ---
+	==================================
+*/
+
+/*
+
+         ftp_segment_t
+	       ---
+	       one byte range of a segmented download and how
+	       far it got.
+
+*/
+
+typedef struct {
+    const commc_ftp_client_t* client;       /* Host, credentials, mode */
+    const char*               remote_path;
+    const char*               local_path;
+    size_t                    offset;       /* First byte of the range */
+    size_t                    length;       /* Bytes in the range */
+    size_t                    received;     /* Bytes written so far, stored atomically */
+    char*                     buffer;       /* Pooled transfer buffer */
+    size_t                    buffer_size;
+    commc_error_t*            stop;         /* First final error, set by CAS */
+    commc_error_t             result;
+} ftp_segment_t;
+
+/*
+
+         ftp_transfer_t
+	       ---
+	       progress of one transfer and when it was last
+	       reported.
+
+*/
+
+typedef struct {
+    commc_ftp_client_t*  client;            /* Whose callback hears of it */
+    unsigned long        start;             /* now_ms() at the start */
+    unsigned long        reported;          /* now_ms() at the last report */
+    commc_ftp_progress_t progress;
+} ftp_transfer_t;
 
 /* 
 	==================================
@@ -119,7 +201,10 @@ static void socket_cleanup(void) {
          create_socket_connection()
 	       ---
 	       creates TCP socket connection to specified
-	       hostname and port with timeout handling.
+	       hostname and port. getaddrinfo() is used as it is
+	       safe to call from several threads at once, which
+	       segmented downloads do; timeout_seconds, if not
+	       0, bounds every later send and receive.
 
 */
 
@@ -128,18 +213,23 @@ static commc_error_t create_socket_connection(const char* hostname,
                                               int         timeout_seconds,
                                               int*        socket_fd) {
 
-    struct hostent* host_entry;
-    struct sockaddr_in server_addr;
-    int sock;
-    
+    struct addrinfo  hints;
+    struct addrinfo* addresses;
+    struct addrinfo* address;
+    char             service[16];
+    int              sock = FTP_INVALID_SOCKET;
+#ifdef _WIN32
+    DWORD            timeout;
+#else
+    struct timeval   timeout;
+#endif
+
     if (!hostname || !socket_fd) {
     
         return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    (void)timeout_seconds; /* TODO: Implement timeout functionality */
-    
     /* Initialize sockets */
     
     if (socket_init() != COMMC_SUCCESS) {
@@ -148,51 +238,67 @@ static commc_error_t create_socket_connection(const char* hostname,
         
     }
     
-    /* Create socket */
+    /* Resolve hostname */
     
-#ifdef _WIN32
-    sock = WSASocket(AF_INET, SOCK_STREAM, 0, NULL, 0, 0);
-#else
-    sock = socket(AF_INET, SOCK_STREAM, 0);
-#endif
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
     
-    if (sock == FTP_INVALID_SOCKET) {
+    sprintf(service, "%d", port);
+    
+    if (getaddrinfo(hostname, service, &hints, &addresses) != 0) {
     
         socket_cleanup();
         return COMMC_SYSTEM_ERROR;
         
     }
     
-    /* Resolve hostname */
-    
-    host_entry = gethostbyname(hostname);
+    /* Connect to the first address that answers */
     
-    if (!host_entry) {
+    for (address = addresses; address; address = address->ai_next) {
     
+        sock = (int)socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        
+        if (sock == FTP_INVALID_SOCKET) {
+        
+            continue;
+            
+        }
+        
+        if (connect(sock, address->ai_addr, address->ai_addrlen) == 0) {
+        
+            break;
+            
+        }
+        
         close(sock);
-        socket_cleanup();
-        return COMMC_SYSTEM_ERROR;
+        sock = FTP_INVALID_SOCKET;
         
     }
     
-    /* Set up server address */
-    
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons((unsigned short)port);
-    memcpy(&server_addr.sin_addr, host_entry->h_addr_list[0], 
-           (size_t)host_entry->h_length);
-    
-    /* Connect to server */
+    freeaddrinfo(addresses);
     
-    if (connect(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) == -1) {
+    if (sock == FTP_INVALID_SOCKET) {
     
-        close(sock);
         socket_cleanup();
         return COMMC_SYSTEM_ERROR;
         
     }
     
+    if (timeout_seconds > 0) {
+    
+#ifdef _WIN32
+        timeout = (DWORD)timeout_seconds * 1000;
+#else
+        timeout.tv_sec  = timeout_seconds;
+        timeout.tv_usec = 0;
+#endif
+
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+        
+    }
+    
     *socket_fd = sock;
     return COMMC_SUCCESS;
     
@@ -237,62 +343,74 @@ static commc_error_t send_all(int         socket_fd,
 
          receive_line()
 	       ---
-	       receives a single line from socket,
-	       handling CRLF line endings properly.
+	       copies the next control line out of the client's
+	       buffered reader, dropping the CRLF and cutting it
+	       to fit buffer.
 
 */
 
-static commc_error_t receive_line(int    socket_fd,
-                                  char*  buffer,
-                                  size_t buffer_size) {
+static commc_error_t receive_line(commc_ftp_client_t* client,
+                                  char*               buffer,
+                                  size_t              buffer_size) {
 
-    size_t pos = 0;
-    char   ch;
-    int    bytes_received;
+    char*         line;
+    size_t        length;
+    commc_error_t result;
     
-    if (!buffer || buffer_size == 0) {
+    if (!buffer || buffer_size == 0 || !client->control_reader) {
     
         return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    while (pos < buffer_size - 1) {
+    result = commc_bufreader_read_line(client->control_reader, &line, &length);
     
-        bytes_received = recv(socket_fd, &ch, 1, 0);
-        
-        if (bytes_received == -1) {
-        
-            return COMMC_SYSTEM_ERROR;
-            
-        }
-        
-        if (bytes_received == 0) {
-        
-            break;  /* Connection closed */
-            
-        }
-        
-        if (ch == '\r') {
-        
-            continue;  /* Skip carriage return */
-            
-        }
-        
-        if (ch == '\n') {
-        
-            break;  /* End of line */
-            
-        }
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
         
-        buffer[pos++] = ch;
+    }
+    
+    if (length > buffer_size - 1) {
+    
+        length = buffer_size - 1;
         
     }
     
-    buffer[pos] = '\0';
+    memcpy(buffer, line, length);
+    buffer[length] = '\0';
+    
     return COMMC_SUCCESS;
     
 }
 
+/*
+
+         close_control_connection()
+	       ---
+	       closes the control connection and drops what
+	       its reader had buffered.
+
+*/
+
+static void close_control_connection(commc_ftp_client_t* client) {
+
+    if (client->control_reader) {
+    
+        commc_bufreader_destroy(client->control_reader);
+        client->control_reader = NULL;
+        
+    }
+    
+    if (client->control_socket != FTP_INVALID_SOCKET) {
+    
+        close(client->control_socket);
+        client->control_socket = FTP_INVALID_SOCKET;
+        
+    }
+    
+}
+
 /*
 
          parse_response_code()
@@ -335,54 +453,62 @@ static int is_positive_response(int code) {
     
 }
 
-/* 
-	==================================
-        --- CLIENT MANAGEMENT ---
-	==================================
-*/
-
 /*
 
-         commc_ftp_client_create()
+         read_reply()
 	       ---
-	       creates and initializes a new FTP client
-	       with default settings.
+	       reads a complete server reply, skipping the
+	       continuation lines of a multi-line one
+	       ("150-..." up to "150 ..."), and records it as
+	       the last response.
 
 */
 
-commc_error_t commc_ftp_client_create(commc_ftp_client_t** client) {
+static commc_error_t read_reply(commc_ftp_client_t* client,
+                                char*               buffer,
+                                size_t              buffer_size,
+                                int*                response_code) {
 
-    commc_ftp_client_t* new_client;
+    commc_error_t result;
+    int           code;
     
-    if (!client) {
+    result = receive_line(client, buffer, buffer_size);
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
         
     }
     
-    new_client = malloc(sizeof(commc_ftp_client_t));
+    code = parse_response_code(buffer);
     
-    if (!new_client) {
+    if (code != 0 && buffer[3] == '-') {
     
-        return COMMC_MEMORY_ERROR;
+        client->last_response.is_multiline = 1;
         
-    }
-    
-    /* Initialize client structure */
-    
-    memset(new_client, 0, sizeof(commc_ftp_client_t));
+        do {
+        
+            result = receive_line(client, buffer, buffer_size);
+            
+            if (result != COMMC_SUCCESS) {
+            
+                return result;
+                
+            }
+            
+        } while (parse_response_code(buffer) != code || buffer[3] == '-');
+        
+    } else {
     
-    new_client->control_socket = FTP_INVALID_SOCKET;
-    new_client->data_socket = FTP_INVALID_SOCKET;
-    new_client->port = COMMC_FTP_DEFAULT_PORT;
-    new_client->mode = COMMC_FTP_MODE_PASSIVE;
-    new_client->type = COMMC_FTP_TYPE_BINARY;
-    new_client->state = COMMC_FTP_STATE_DISCONNECTED;
-    new_client->timeout = COMMC_FTP_DEFAULT_TIMEOUT;
+        client->last_response.is_multiline = 0;
+        
+    }
     
-    strcpy(new_client->current_dir, "/");
+    client->last_response.code = code;
+    strncpy(client->last_response.message, buffer, COMMC_FTP_MAX_RESPONSE_LENGTH - 1);
+    client->last_response.message[COMMC_FTP_MAX_RESPONSE_LENGTH - 1] = '\0';
     
-    *client = new_client;
+    *response_code = code;
     
     return COMMC_SUCCESS;
     
@@ -390,124 +516,1211 @@ commc_error_t commc_ftp_client_create(commc_ftp_client_t** client) {
 
 /*
 
-         commc_ftp_client_destroy()
+         send_command()
 	       ---
-	       destroys FTP client and cleans up
-	       all associated resources.
+	       sends one command line and reads its reply. an
+	       argument holding CR or LF is refused, since it
+	       would smuggle a second command onto the line.
 
 */
 
-void commc_ftp_client_destroy(commc_ftp_client_t* client) {
+static commc_error_t send_command(commc_ftp_client_t* client,
+                                  const char*         command,
+                                  const char*         argument,
+                                  int*                response_code) {
 
-    if (!client) {
+    char          command_buffer[FTP_COMMAND_BUFFER_SIZE];
+    char          response_buffer[FTP_RESPONSE_BUFFER_SIZE];
+    size_t        command_length  = strlen(command);
+    size_t        argument_length = argument ? strlen(argument) : 0;
+    size_t        length;
+    commc_error_t result;
     
-        return;
+    /* Paths and names come from callers; keep them to one line */
+    
+    if (argument && strpbrk(argument, "\r\n")) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    /* Close sockets if open */
+    /* Room for the separator and CRLF */
     
-    if (client->control_socket != FTP_INVALID_SOCKET) {
+    if (command_length + argument_length + 3 > sizeof(command_buffer)) {
     
-        close(client->control_socket);
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
         
     }
     
-    if (client->data_socket != FTP_INVALID_SOCKET) {
+    memcpy(command_buffer, command, command_length);
+    length = command_length;
     
-        close(client->data_socket);
+    if (argument) {
+    
+        command_buffer[length++] = ' ';
+        memcpy(command_buffer + length, argument, argument_length);
+        length += argument_length;
         
     }
     
-    socket_cleanup();
-    free(client);
+    command_buffer[length++] = '\r';
+    command_buffer[length++] = '\n';
+    
+    result = send_all(client->control_socket, command_buffer, length);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    return read_reply(client, response_buffer, sizeof(response_buffer), response_code);
     
 }
 
 /*
 
-         commc_ftp_set_timeout()
+         open_data_connection()
 	       ---
-	       configures timeout for FTP operations
-	       in seconds.
+	       asks for a passive data port and connects to it.
+	       the address in the 227 reply is ignored in favour
+	       of the control connection's host, which is what
+	       the server must be reachable as anyway; servers
+	       behind NAT routinely announce a private one.
 
 */
 
-commc_error_t commc_ftp_set_timeout(commc_ftp_client_t* client,
-                                    int                 timeout_seconds) {
+static commc_error_t open_data_connection(commc_ftp_client_t* client,
+                                          commc_socket_t**    data_socket) {
 
-    if (!client || timeout_seconds < 0) {
+    char          service[16];
+    const char*   numbers;
+    unsigned int  fields[6];
+    int           response_code;
+    commc_error_t result;
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+    if (client->mode != COMMC_FTP_MODE_PASSIVE) {
+    
+        return COMMC_NOT_IMPLEMENTED_ERROR;
         
     }
     
-    client->timeout = timeout_seconds;
+    result = send_command(client, "PASV", NULL, &response_code);
     
-    return COMMC_SUCCESS;
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    numbers = strchr(client->last_response.message, '(');
+    
+    if (response_code != 227 || !numbers ||
+        sscanf(numbers + 1, "%u,%u,%u,%u,%u,%u", &fields[0], &fields[1], &fields[2],
+               &fields[3], &fields[4], &fields[5]) != 6 ||
+        fields[4] > 255 || fields[5] > 255) {
+        
+        return COMMC_FORMAT_ERROR;
+        
+    }
+    
+    sprintf(service, "%u", fields[4] * 256 + fields[5]);
+    
+    result = commc_socket_create(data_socket, COMMC_SOCKET_TYPE_TCP, COMMC_SOCKET_FAMILY_IPV4);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    (*data_socket)->options.send_timeout    = client->timeout;
+    (*data_socket)->options.receive_timeout = client->timeout;
+    
+    result = commc_socket_connect_hostname(*data_socket, client->hostname,
+                                           service, client->timeout);
+                                           
+    if (result != COMMC_SUCCESS) {
+    
+        commc_socket_destroy(*data_socket);
+        *data_socket = NULL;
+        
+    }
+    
+    return result;
     
 }
 
 /*
 
-         commc_ftp_set_mode()
+         now_ms()
 	       ---
-	       configures FTP transfer mode
-	       (active or passive).
+	       monotonic milliseconds, wrapping.
 
 */
 
-commc_error_t commc_ftp_set_mode(commc_ftp_client_t* client,
-                                 commc_ftp_mode_t    mode) {
+static unsigned long now_ms(void) {
 
-    if (!client) {
-    
-        return COMMC_ERROR_INVALID_ARGUMENT;
-        
-    }
+#ifdef _WIN32
+    return (unsigned long)GetTickCount();
+#else
+    struct timespec now;
     
-    client->mode = mode;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000UL + (unsigned long)(now.tv_nsec / 1000000L);
+#endif
+}
+
+/*
+
+         begin_transfer()
+	       ---
+	       starts the progress record of a transfer of
+	       total bytes (0 if unknown).
+
+*/
+
+static void begin_transfer(ftp_transfer_t*     transfer,
+                           commc_ftp_client_t* client,
+                           size_t              total) {
+
+    memset(transfer, 0, sizeof(ftp_transfer_t));
     
-    return COMMC_SUCCESS;
+    transfer->client         = client;
+    transfer->start          = now_ms();
+    transfer->reported       = transfer->start;
+    transfer->progress.total = total;
     
 }
 
 /*
 
-         commc_ftp_set_type()
+         report_transfer()
 	       ---
-	       configures FTP transfer type
-	       (ASCII or binary).
+	       brings the elapsed time and throughput up to
+	       date and, with notify set, hands the record to
+	       the progress callback if there is one.
 
 */
 
-commc_error_t commc_ftp_set_type(commc_ftp_client_t* client,
-                                 commc_ftp_type_t    type) {
+static commc_error_t report_transfer(ftp_transfer_t* transfer,
+                                     int             notify) {
 
-    if (!client) {
+    commc_ftp_client_t* client = transfer->client;
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+    transfer->reported            = now_ms();
+    transfer->progress.elapsed_ms = transfer->reported - transfer->start;
+    
+    transfer->progress.bytes_per_second = transfer->progress.elapsed_ms > 0 ?
+        (double)transfer->progress.transferred * 1000.0 / (double)transfer->progress.elapsed_ms : 0.0;
         
-    }
+    if (!notify || !client->progress) {
     
-    client->type = type;
+        return COMMC_SUCCESS;
+        
+    }
     
-    return COMMC_SUCCESS;
+    return client->progress(&transfer->progress, client->progress_data);
     
 }
 
-/* 
-	==================================
-        --- CONNECTION MANAGEMENT ---
-	==================================
-*/
-
 /*
 
-         commc_ftp_connect()
+         advance_transfer()
 	       ---
-	       establishes connection to FTP server
-	       and performs initial handshake.
+	       counts bytes moved, reporting progress at most
+	       every COMMC_FTP_PROGRESS_INTERVAL_MS. an error
+	       from the callback aborts the transfer.
+
+*/
+
+static commc_error_t advance_transfer(ftp_transfer_t* transfer,
+                                      size_t          bytes) {
+
+    transfer->progress.transferred += bytes;
+    
+    if (!transfer->client->progress ||
+        now_ms() - transfer->reported < COMMC_FTP_PROGRESS_INTERVAL_MS) {
+        
+        return COMMC_SUCCESS;
+        
+    }
+    
+    return report_transfer(transfer, 1);
+    
+}
+
+/*
+
+         end_transfer()
+	       ---
+	       sends the last progress report of a transfer
+	       that succeeded and keeps its totals for
+	       commc_ftp_get_transfer_stats().
+
+*/
+
+static commc_error_t end_transfer(ftp_transfer_t* transfer,
+                                  commc_error_t   result) {
+
+    commc_error_t reported = report_transfer(transfer, result == COMMC_SUCCESS);
+    
+    transfer->client->last_transfer = transfer->progress;
+    
+    return result == COMMC_SUCCESS ? reported : result;
+    
+}
+
+/*
+
+         acquire_buffer()
+	       ---
+	       returns the client's transfer buffer, allocating
+	       it on first use. it is kept for later transfers.
+
+*/
+
+static commc_error_t acquire_buffer(commc_ftp_client_t* client,
+                                    char**              buffer,
+                                    size_t*             size) {
+
+    if (!client->buffer) {
+    
+        if (client->buffer_size == 0) {
+        
+            client->buffer_size = COMMC_FTP_TRANSFER_BUFFER_SIZE;
+            
+        }
+        
+        client->buffer = (char*)malloc(client->buffer_size);
+        
+        if (!client->buffer) {
+        
+            return COMMC_MEMORY_ERROR;
+            
+        }
+        
+        client->buffer_owned = 1;
+        
+    }
+    
+    *buffer = client->buffer;
+    *size   = client->buffer_size;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         announced_size()
+	       ---
+	       reads the size many servers put in the reply
+	       that opens a download, "150 ... (1234 bytes)".
+	       returns 0 if there is none.
+
+*/
+
+static size_t announced_size(const commc_ftp_client_t* client) {
+
+    const char* end = strstr(client->last_response.message, " bytes)");
+    const char* start;
+    size_t      size = 0;
+    
+    if (!end) {
+    
+        return 0;
+        
+    }
+    
+    for (start = end; start > client->last_response.message && isdigit((unsigned char)start[-1]); start--) {
+    
+        /* Find the first digit */
+        
+    }
+    
+    if (start == end || start[-1] != '(') {
+    
+        return 0;
+        
+    }
+    
+    while (start < end) {
+    
+        if (size > ((size_t)-1 - 9) / 10) {
+        
+            return 0;
+            
+        }
+        
+        size = size * 10 + (size_t)(*start++ - '0');
+        
+    }
+    
+    return size;
+    
+}
+
+/*
+
+         send_ascii()
+	       ---
+	       ASCII-type uploads must turn every bare LF into
+	       the CRLF of the network form. previous carries
+	       the last byte across calls so a CRLF split
+	       between them is left alone.
+
+*/
+
+static commc_error_t send_ascii(ftp_transfer_t* transfer,
+                                commc_socket_t* data_socket,
+                                const char*     input,
+                                size_t          length,
+                                char*           previous) {
+
+    char          output[FTP_DATA_BUFFER_SIZE * 2];
+    size_t        output_length;
+    size_t        piece;
+    size_t        i;
+    commc_error_t result;
+    
+    while (length > 0) {
+    
+        piece         = length < FTP_DATA_BUFFER_SIZE ? length : FTP_DATA_BUFFER_SIZE;
+        output_length = 0;
+        
+        for (i = 0; i < piece; i++) {
+        
+            if (input[i] == '\n' && *previous != '\r') {
+            
+                output[output_length++] = '\r';
+                
+            }
+            
+            output[output_length++] = input[i];
+            *previous = input[i];
+            
+        }
+        
+        result = commc_socket_send_all(data_socket, output, output_length);
+        
+        if (result == COMMC_SUCCESS) {
+        
+            result = advance_transfer(transfer, piece);
+            
+        }
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+        input  += piece;
+        length -= piece;
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         map_local_file()
+	       ---
+	       maps size bytes of a local file read-only, or
+	       returns NULL where that fails or is not
+	       supported.
+
+*/
+
+static const char* map_local_file(int    file_handle,
+                                  size_t size) {
+
+#ifdef _WIN32
+    (void)file_handle;
+    (void)size;
+    
+    return NULL;
+#else
+    void* view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file_handle, 0);
+    
+    return view == MAP_FAILED ? NULL : (const char*)view;
+#endif
+}
+
+/*
+
+         send_ascii_file()
+	       ---
+	       converts a local file of size bytes for an
+	       ASCII upload straight out of a read-only mapping
+	       of it, without reading it into a buffer first.
+	       files that cannot be mapped (empty ones, or too
+	       large for the address space) are read piece by
+	       piece.
+
+*/
+
+static commc_error_t send_ascii_file(ftp_transfer_t* transfer,
+                                     commc_socket_t* data_socket,
+                                     int             file_handle,
+                                     size_t          size) {
+
+    char          input[FTP_DATA_BUFFER_SIZE];
+    char          previous = '\0';
+    const char*   view     = size > 0 ? map_local_file(file_handle, size) : NULL;
+    long          got;
+    commc_error_t result;
+    
+    if (view) {
+    
+        result = send_ascii(transfer, data_socket, view, size, &previous);
+        
+        unmap_local_file(view, size);
+        return result;
+        
+    }
+    
+    for (;;) {
+    
+        got = (long)read_local_file(file_handle, input, sizeof(input));
+        
+        if (got < 0) {
+        
+            return COMMC_IO_ERROR;
+            
+        }
+        
+        if (got == 0) {
+        
+            return COMMC_SUCCESS;
+            
+        }
+        
+        result = send_ascii(transfer, data_socket, input, (size_t)got, &previous);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+    }
+    
+}
+
+/*
+
+         write_local_all()
+	       ---
+	       writes all of data to a local file, handling
+	       partial writes.
+
+*/
+
+static commc_error_t write_local_all(int         file_handle,
+                                     const char* data,
+                                     size_t      data_length) {
+
+    long written;
+    
+    while (data_length > 0) {
+    
+        written = (long)write_local_file(file_handle, data, data_length);
+        
+        if (written <= 0) {
+        
+            return COMMC_IO_ERROR;
+            
+        }
+        
+        data        += written;
+        data_length -= (size_t)written;
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         file_sink()
+	       ---
+	       download sink writing to the local file whose
+	       handle user_data points to.
+
+*/
+
+static commc_error_t file_sink(const char* data,
+                               size_t      length,
+                               void*       user_data) {
+
+    return write_local_all(*(int*)user_data, data, length);
+    
+}
+
+/*
+
+         receive_data()
+	       ---
+	       hands what arrives on the data connection to
+	       sink, a transfer buffer at a time, until the
+	       server closes it or limit bytes have come,
+	       counting them in received. ASCII data has its
+	       CRLF line ends turned into LF in place; a CR is
+	       held back until the next byte shows whether an
+	       LF follows, which may be in the next receive.
+
+	       returns:
+	       - COMMC_SUCCESS at the end of the data or at limit
+	       - COMMC_ERROR_TIMEOUT if nothing arrived for the
+	         data socket's receive timeout
+	       - the sink's or progress callback's error
+	       - the receive error otherwise
+
+*/
+
+static commc_error_t receive_data(ftp_transfer_t*  transfer,
+                                  commc_socket_t*  data_socket,
+                                  size_t           limit,
+                                  size_t*          received,
+                                  int              ascii,
+                                  commc_ftp_sink_t sink,
+                                  void*            user_data) {
+
+    char*         buffer;
+    size_t        size;
+    size_t        wanted;
+    size_t        got;
+    size_t        length;
+    size_t        i;
+    char          c;
+    int           held = 0;
+    commc_error_t result;
+    
+    result = acquire_buffer(transfer->client, &buffer, &size);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    while (*received < limit) {
+    
+        wanted = limit - *received < size ? limit - *received : size;
+        result = commc_socket_receive(data_socket, buffer, wanted, &got);
+        
+        if (result == COMMC_ERROR_CONNECTION_CLOSED) {
+        
+            return held ? sink("\r", 1, user_data) : COMMC_SUCCESS;
+            
+        }
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result == COMMC_ERROR_WOULD_BLOCK ? COMMC_ERROR_TIMEOUT : result;
+            
+        }
+        
+        /* A segment's count is watched from the reporting thread */
+        
+        COMMC_ATOMIC_STORE_RELEASE(received, *received + got);
+        length = got;
+        
+        if (ascii) {
+        
+            if (held && buffer[0] != '\n') {
+            
+                result = sink("\r", 1, user_data);
+                
+                if (result != COMMC_SUCCESS) {
+                
+                    return result;
+                    
+                }
+                
+            }
+            
+            /* Output never overtakes input, so the buffer is reused */
+            
+            length = 0;
+            
+            for (i = 0; i < got; i++) {
+            
+                c = buffer[i];
+                
+                if (held && c != '\n' && i > 0) {
+                
+                    buffer[length++] = '\r';
+                    
+                }
+                
+                held = c == '\r';
+                
+                if (!held) {
+                
+                    buffer[length++] = c;
+                    
+                }
+                
+            }
+            
+        }
+        
+        result = length > 0 ? sink(buffer, length, user_data) : COMMC_SUCCESS;
+        
+        if (result == COMMC_SUCCESS) {
+        
+            result = advance_transfer(transfer, got);
+            
+        }
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         query_size()
+	       ---
+	       asks for the size of a remote file with SIZE.
+	       the result depends on the representation type,
+	       so set TYPE first.
+
+*/
+
+static commc_error_t query_size(commc_ftp_client_t* client,
+                                const char*         remote_path,
+                                size_t*             size) {
+
+    const char*   digits;
+    size_t        value = 0;
+    int           response_code;
+    commc_error_t result;
+    
+    result = send_command(client, "SIZE", remote_path, &response_code);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    if (response_code != 213) {
+    
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+    
+    digits = client->last_response.message + 3;
+    
+    while (*digits == ' ') {
+    
+        digits++;
+        
+    }
+    
+    if (!isdigit((unsigned char)*digits)) {
+    
+        return COMMC_FORMAT_ERROR;
+        
+    }
+    
+    while (isdigit((unsigned char)*digits)) {
+    
+        if (value > ((size_t)-1 - 9) / 10) {
+        
+            return COMMC_FORMAT_ERROR;
+            
+        }
+        
+        value = value * 10 + (size_t)(*digits++ - '0');
+        
+    }
+    
+    *size = value;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         start_retrieve()
+	       ---
+	       sets the representation type, opens a data
+	       connection and asks for remote_path from offset
+	       on (REST, then RETR). on success the data is
+	       flowing on *data_socket.
+
+*/
+
+static commc_error_t start_retrieve(commc_ftp_client_t* client,
+                                    const char*         remote_path,
+                                    size_t              offset,
+                                    commc_socket_t**    data_socket) {
+
+    char          position[32];
+    int           response_code;
+    commc_error_t result;
+    
+    result = send_command(client, "TYPE",
+                          client->type == COMMC_FTP_TYPE_BINARY ? "I" : "A",
+                          &response_code);
+                          
+    if (result == COMMC_SUCCESS && !is_positive_response(response_code)) {
+    
+        result = COMMC_SYSTEM_ERROR;
+        
+    }
+    
+    if (result == COMMC_SUCCESS) {
+    
+        result = open_data_connection(client, data_socket);
+        
+    }
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    /* REST answers 350 and moves the start of the next RETR */
+    
+    if (offset > 0) {
+    
+        sprintf(position, "%lu", (unsigned long)offset);
+        
+        result = send_command(client, "REST", position, &response_code);
+        
+        if (result == COMMC_SUCCESS && response_code != 350) {
+        
+            result = COMMC_NOT_IMPLEMENTED_ERROR;
+            
+        }
+        
+    }
+    
+    /* RETR answers 125 or 150 before the data flows */
+    
+    if (result == COMMC_SUCCESS) {
+    
+        result = send_command(client, "RETR", remote_path, &response_code);
+        
+        if (result == COMMC_SUCCESS && response_code != 125 && response_code != 150) {
+        
+            result = COMMC_SYSTEM_ERROR;
+            
+        }
+        
+    }
+    
+    if (result != COMMC_SUCCESS) {
+    
+        commc_socket_destroy(*data_socket);
+        *data_socket = NULL;
+        return result;
+        
+    }
+    
+    client->state = COMMC_FTP_STATE_TRANSFERRING;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         start_store()
+	       ---
+	       sets the representation type, opens a data
+	       connection and sends STOR. on success the
+	       server is waiting for the data on *data_socket.
+
+*/
+
+static commc_error_t start_store(commc_ftp_client_t* client,
+                                 const char*         remote_path,
+                                 commc_socket_t**    data_socket) {
+
+    int           response_code;
+    commc_error_t result;
+    
+    result = send_command(client, "TYPE",
+                          client->type == COMMC_FTP_TYPE_BINARY ? "I" : "A",
+                          &response_code);
+                          
+    if (result == COMMC_SUCCESS && !is_positive_response(response_code)) {
+    
+        result = COMMC_SYSTEM_ERROR;
+        
+    }
+    
+    if (result == COMMC_SUCCESS) {
+    
+        result = open_data_connection(client, data_socket);
+        
+    }
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    /* STOR answers 125 or 150 before the data flows */
+    
+    result = send_command(client, "STOR", remote_path, &response_code);
+    
+    if (result == COMMC_SUCCESS && response_code != 125 && response_code != 150) {
+    
+        result = COMMC_SYSTEM_ERROR;
+        
+    }
+    
+    if (result != COMMC_SUCCESS) {
+    
+        commc_socket_destroy(*data_socket);
+        *data_socket = NULL;
+        return result;
+        
+    }
+    
+    client->state = COMMC_FTP_STATE_TRANSFERRING;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         finish_transfer()
+	       ---
+	       reads the reply that ends a transfer once its
+	       data connection is closed, and merges it into
+	       the transfer's result.
+
+*/
+
+static commc_error_t finish_transfer(commc_ftp_client_t* client,
+                                     commc_error_t       result) {
+
+    char          response_buffer[FTP_RESPONSE_BUFFER_SIZE];
+    int           response_code;
+    commc_error_t reply_result;
+    
+    if (client->state != COMMC_FTP_STATE_TRANSFERRING) {
+    
+        return result;
+        
+    }
+    
+    client->state = COMMC_FTP_STATE_AUTHENTICATED;
+    
+    reply_result = read_reply(client, response_buffer, sizeof(response_buffer),
+                              &response_code);
+                              
+    if (result == COMMC_SUCCESS) {
+    
+        result = reply_result;
+        
+    }
+    
+    if (result == COMMC_SUCCESS && !is_positive_response(response_code)) {
+    
+        result = COMMC_SYSTEM_ERROR;
+        
+    }
+    
+    return result;
+    
+}
+
+/* 
+	==================================
+        --- CLIENT MANAGEMENT ---
+	==================================
+*/
+
+/*
+
+         commc_ftp_client_create()
+	       ---
+	       creates and initializes a new FTP client
+	       with default settings.
+
+*/
+
+commc_error_t commc_ftp_client_create(commc_ftp_client_t** client) {
+
+    commc_ftp_client_t* new_client;
+    
+    if (!client) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    new_client = malloc(sizeof(commc_ftp_client_t));
+    
+    if (!new_client) {
+    
+        return COMMC_MEMORY_ERROR;
+        
+    }
+    
+    /* Initialize client structure */
+    
+    memset(new_client, 0, sizeof(commc_ftp_client_t));
+    
+    new_client->control_socket = FTP_INVALID_SOCKET;
+    new_client->data_socket = FTP_INVALID_SOCKET;
+    new_client->port = COMMC_FTP_DEFAULT_PORT;
+    new_client->mode = COMMC_FTP_MODE_PASSIVE;
+    new_client->type = COMMC_FTP_TYPE_BINARY;
+    new_client->state = COMMC_FTP_STATE_DISCONNECTED;
+    new_client->timeout = COMMC_FTP_DEFAULT_TIMEOUT;
+    
+    strcpy(new_client->current_dir, "/");
+    
+    *client = new_client;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_ftp_client_destroy()
+	       ---
+	       destroys FTP client and cleans up
+	       all associated resources.
+
+*/
+
+void commc_ftp_client_destroy(commc_ftp_client_t* client) {
+
+    if (!client) {
+    
+        return;
+        
+    }
+    
+    /* Close sockets if open */
+    
+    close_control_connection(client);
+    
+    if (client->data_socket != FTP_INVALID_SOCKET) {
+    
+        close(client->data_socket);
+        
+    }
+    
+    if (client->buffer_owned) {
+    
+        free(client->buffer);
+        
+    }
+    
+    commc_memory_pool_destroy(client->segment_buffers);
+    socket_cleanup();
+    free(client);
+    
+}
+
+/*
+
+         commc_ftp_set_timeout()
+	       ---
+	       configures timeout for FTP operations
+	       in seconds.
+
+*/
+
+commc_error_t commc_ftp_set_timeout(commc_ftp_client_t* client,
+                                    int                 timeout_seconds) {
+
+    if (!client || timeout_seconds < 0) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    client->timeout = timeout_seconds;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_ftp_set_mode()
+	       ---
+	       configures FTP transfer mode
+	       (active or passive).
+
+*/
+
+commc_error_t commc_ftp_set_mode(commc_ftp_client_t* client,
+                                 commc_ftp_mode_t    mode) {
+
+    if (!client) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    client->mode = mode;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_ftp_set_type()
+	       ---
+	       configures FTP transfer type
+	       (ASCII or binary).
+
+*/
+
+commc_error_t commc_ftp_set_type(commc_ftp_client_t* client,
+                                 commc_ftp_type_t    type) {
+
+    if (!client) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    client->type = type;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_ftp_set_buffer()
+	       ---
+	       sets the buffer transfers read into and write
+	       from. a caller's buffer stays the caller's and
+	       must outlive the client; NULL makes the client
+	       allocate one of size bytes (0 for
+	       COMMC_FTP_TRANSFER_BUFFER_SIZE) on first use.
+
+*/
+
+commc_error_t commc_ftp_set_buffer(commc_ftp_client_t* client,
+                                   void*               buffer,
+                                   size_t              size) {
+
+    if (!client || (buffer && size == 0)) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    if (client->buffer_owned) {
+    
+        free(client->buffer);
+        
+    }
+    
+    /* Pooled segment buffers follow the size */
+    
+    if (size != client->buffer_size) {
+    
+        commc_memory_pool_destroy(client->segment_buffers);
+        
+        client->segment_buffers      = NULL;
+        client->segment_buffer_count = 0;
+        
+    }
+    
+    client->buffer       = (char*)buffer;
+    client->buffer_size  = size;
+    client->buffer_owned = 0;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_ftp_set_progress()
+	       ---
+	       sets the callback transfers report progress to,
+	       or none with NULL.
+
+*/
+
+commc_error_t commc_ftp_set_progress(commc_ftp_client_t*            client,
+                                     commc_ftp_progress_callback_t callback,
+                                     void*                          user_data) {
+
+    if (!client) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    client->progress      = callback;
+    client->progress_data = user_data;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_ftp_get_transfer_stats()
+	       ---
+	       copies the totals of the last transfer.
+
+*/
+
+commc_error_t commc_ftp_get_transfer_stats(const commc_ftp_client_t* client,
+                                           commc_ftp_progress_t*     progress) {
+
+    if (!client || !progress) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    *progress = client->last_transfer;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/* 
+	==================================
+        --- CONNECTION MANAGEMENT ---
+	==================================
+*/
+
+/*
+
+         commc_ftp_connect()
+	       ---
+	       establishes connection to FTP server
+	       and performs initial handshake.
 
 */
 
@@ -515,424 +1728,1162 @@ commc_error_t commc_ftp_connect(commc_ftp_client_t* client,
                                 const char*         hostname,
                                 int                 port) {
 
-    commc_error_t result;
-    char          response_buffer[FTP_RESPONSE_BUFFER_SIZE];
-    int           response_code;
+    commc_error_t result;
+    char          response_buffer[FTP_RESPONSE_BUFFER_SIZE];
+    int           response_code;
+    
+    if (!client || !hostname) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    if (client->state != COMMC_FTP_STATE_DISCONNECTED) {
+    
+        return COMMC_ERROR_INVALID_STATE;
+        
+    }
+    
+    /* Store connection parameters */
+    
+    if (strlen(hostname) >= COMMC_FTP_MAX_HOSTNAME_LENGTH) {
+    
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        
+    }
+    
+    strcpy(client->hostname, hostname);
+    client->port = (port > 0) ? port : COMMC_FTP_DEFAULT_PORT;
+    
+    client->state = COMMC_FTP_STATE_CONNECTING;
+    
+    /* Create control connection */
+    
+    result = create_socket_connection(client->hostname, client->port,
+                                      client->timeout, &client->control_socket);
+                                      
+    if (result == COMMC_SUCCESS) {
+    
+        result = commc_bufreader_create_fd(&client->control_reader, client->control_socket,
+                                           FTP_RESPONSE_BUFFER_SIZE, 0);
+                                           
+        if (result != COMMC_SUCCESS) {
+        
+            close_control_connection(client);
+            
+        }
+        
+    }
+    
+    if (result != COMMC_SUCCESS) {
+    
+        client->state = COMMC_FTP_STATE_ERROR;
+        return result;
+        
+    }
+    
+    /* Read initial server response */
+    
+    result = read_reply(client, response_buffer, sizeof(response_buffer), &response_code);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        close_control_connection(client);
+        client->state = COMMC_FTP_STATE_ERROR;
+        return result;
+        
+    }
+    
+    /* Parse response code */
+    
+    if (!is_positive_response(response_code)) {
+    
+        close_control_connection(client);
+        client->state = COMMC_FTP_STATE_ERROR;
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+    
+    /* Store response */
+    
+    client->last_response.code = response_code;
+    strcpy(client->last_response.message, response_buffer);
+    client->last_response.is_multiline = 0;
+    
+    client->state = COMMC_FTP_STATE_CONNECTED;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_ftp_authenticate()
+	       ---
+	       performs user authentication with
+	       username and password.
+
+*/
+
+commc_error_t commc_ftp_authenticate(commc_ftp_client_t* client,
+                                     const char*         username,
+                                     const char*         password) {
+
+    char command_buffer[FTP_COMMAND_BUFFER_SIZE];
+    char response_buffer[FTP_RESPONSE_BUFFER_SIZE];
+    commc_error_t result;
+    int response_code;
+    
+    if (!client || !username || !password ||
+        strpbrk(username, "\r\n") || strpbrk(password, "\r\n")) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    if (client->state != COMMC_FTP_STATE_CONNECTED) {
+    
+        return COMMC_ERROR_INVALID_STATE;
+        
+    }
+    
+    /* Store credentials */
+    
+    if (strlen(username) >= COMMC_FTP_MAX_USERNAME_LENGTH ||
+        strlen(password) >= COMMC_FTP_MAX_PASSWORD_LENGTH) {
+        
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        
+    }
+    
+    strcpy(client->username, username);
+    strcpy(client->password, password);
+    
+    /* Send USER command */
+    
+    snprintf(command_buffer, sizeof(command_buffer), "USER %s\r\n", username);
+    
+    result = send_all(client->control_socket, command_buffer, strlen(command_buffer));
+    
+    if (result != COMMC_SUCCESS) {
+    
+        client->state = COMMC_FTP_STATE_ERROR;
+        return result;
+        
+    }
+    
+    /* Read USER response */
+    
+    result = read_reply(client, response_buffer, sizeof(response_buffer), &response_code);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        client->state = COMMC_FTP_STATE_ERROR;
+        return result;
+        
+    }
+    
+    /* Send PASS command if password required */
+    
+    if (response_code == 331) { /* Need password */
+    
+        snprintf(command_buffer, sizeof(command_buffer), "PASS %s\r\n", password);
+        
+        result = send_all(client->control_socket, command_buffer, strlen(command_buffer));
+        
+        if (result != COMMC_SUCCESS) {
+        
+            client->state = COMMC_FTP_STATE_ERROR;
+            return result;
+            
+        }
+        
+        /* Read PASS response */
+        
+        result = read_reply(client, response_buffer, sizeof(response_buffer), &response_code);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            client->state = COMMC_FTP_STATE_ERROR;
+            return result;
+            
+        }
+        
+    }
+    
+    /* Check authentication result */
+    
+    if (!is_positive_response(response_code)) {
+    
+        client->state = COMMC_FTP_STATE_ERROR;
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+    
+    /* Store response */
+    
+    client->last_response.code = response_code;
+    strcpy(client->last_response.message, response_buffer);
+    client->last_response.is_multiline = 0;
+    
+    client->state = COMMC_FTP_STATE_AUTHENTICATED;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_ftp_disconnect()
+	       ---
+	       gracefully disconnects from FTP server
+	       and cleans up connections.
+
+*/
+
+commc_error_t commc_ftp_disconnect(commc_ftp_client_t* client) {
+
+    char command_buffer[FTP_COMMAND_BUFFER_SIZE];
+    
+    if (!client) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    if (client->control_socket != FTP_INVALID_SOCKET) {
+    
+        /* Send QUIT command */
+        
+        strcpy(command_buffer, "QUIT\r\n");
+        send_all(client->control_socket, command_buffer, strlen(command_buffer));
+        
+        close_control_connection(client);
+        
+    }
+    
+    if (client->data_socket != FTP_INVALID_SOCKET) {
+    
+        close(client->data_socket);
+        client->data_socket = FTP_INVALID_SOCKET;
+        
+    }
+    
+    client->state = COMMC_FTP_STATE_DISCONNECTED;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/* 
+	==================================
+        --- UTILITY FUNCTIONS ---
+	==================================
+*/
+
+/*
+
+         commc_ftp_send_command()
+	       ---
+	       sends raw FTP command to server
+	       and retrieves response.
+
+*/
+
+commc_error_t commc_ftp_send_command(commc_ftp_client_t*    client,
+                                     const char*            command,
+                                     commc_ftp_response_t*  response) {
+
+    char command_buffer[FTP_COMMAND_BUFFER_SIZE];
+    char response_buffer[FTP_RESPONSE_BUFFER_SIZE];
+    commc_error_t result;
+    int response_code;
+    
+    if (!client || !command || !response || strpbrk(command, "\r\n")) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    if (client->control_socket == FTP_INVALID_SOCKET) {
+    
+        return COMMC_ERROR_INVALID_STATE;
+        
+    }
+    
+    /* Format command with CRLF */
+    
+    snprintf(command_buffer, sizeof(command_buffer), "%s\r\n", command);
+    
+    /* Send command */
+    
+    result = send_all(client->control_socket, command_buffer, strlen(command_buffer));
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    /* Read response */
+    
+    result = read_reply(client, response_buffer, sizeof(response_buffer), &response_code);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    /* read_reply() stored it in the client */
+    
+    *response = client->last_response;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_ftp_get_last_response()
+	       ---
+	       retrieves the last server response
+	       for debugging and error analysis.
+
+*/
+
+commc_error_t commc_ftp_get_last_response(const commc_ftp_client_t* client,
+                                          commc_ftp_response_t*     response) {
+
+    if (!client || !response) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    *response = client->last_response;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_ftp_is_connected()
+	       ---
+	       checks if FTP client is connected
+	       and authenticated with server.
+
+*/
+
+int commc_ftp_is_connected(const commc_ftp_client_t* client) {
+
+    if (!client) {
+    
+        return 0;
+        
+    }
+    
+    return (client->state == COMMC_FTP_STATE_AUTHENTICATED) ? 1 : 0;
+    
+}
+
+/*
+
+         commc_ftp_get_state()
+	       ---
+	       retrieves current FTP client state
+	       for status monitoring.
+
+*/
+
+commc_ftp_state_t commc_ftp_get_state(const commc_ftp_client_t* client) {
+
+    if (!client) {
+    
+        return COMMC_FTP_STATE_ERROR;
+        
+    }
+    
+    return client->state;
+    
+}
+
+/* 
+	==================================
+        --- CONVENIENCE FUNCTIONS ---
+	==================================
+*/
+
+/*
+
+         commc_ftp_quick_upload()
+	       ---
+	       convenience function for simple
+	       file upload with authentication.
+
+*/
+
+commc_error_t commc_ftp_quick_upload(const char* hostname,
+                                     int         port,
+                                     const char* username,
+                                     const char* password,
+                                     const char* local_path,
+                                     const char* remote_path) {
+
+    commc_ftp_client_t* client = NULL;
+    commc_error_t       result;
+    
+    if (!hostname || !username || !password || !local_path || !remote_path) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    /* Create client */
+    
+    result = commc_ftp_client_create(&client);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    /* Connect and authenticate */
+    
+    result = commc_ftp_connect(client, hostname, port);
+    
+    if (result == COMMC_SUCCESS) {
+    
+        result = commc_ftp_authenticate(client, username, password);
+        
+        if (result == COMMC_SUCCESS) {
+        
+            result = commc_ftp_upload_file(client, local_path, remote_path);
+            
+        }
+        
+    }
+    
+    /* Cleanup */
+    
+    commc_ftp_disconnect(client);
+    commc_ftp_client_destroy(client);
+    
+    return result;
+    
+}
+
+/*
+
+         commc_ftp_quick_download()
+	       ---
+	       convenience function for simple
+	       file download with authentication.
+
+*/
+
+commc_error_t commc_ftp_quick_download(const char* hostname,
+                                       int         port,
+                                       const char* username,
+                                       const char* password,
+                                       const char* remote_path,
+                                       const char* local_path) {
+
+    commc_ftp_client_t* client = NULL;
+    commc_error_t       result;
+    
+    if (!hostname || !username || !password || !local_path || !remote_path) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    /* Create client */
+    
+    result = commc_ftp_client_create(&client);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    /* Connect and authenticate */
+    
+    result = commc_ftp_connect(client, hostname, port);
+    
+    if (result == COMMC_SUCCESS) {
+    
+        result = commc_ftp_authenticate(client, username, password);
+        
+        if (result == COMMC_SUCCESS) {
+        
+            result = commc_ftp_download_file(client, remote_path, local_path);
+            
+        }
+        
+    }
+    
+    /* Cleanup */
+    
+    commc_ftp_disconnect(client);
+    commc_ftp_client_destroy(client);
+    
+    return result;
+    
+}
+
+/* 
+	==================================
+        --- FILE OPERATIONS ---
+	==================================
+*/
+
+/*
+
+         commc_ftp_upload_file()
+	       ---
+	       stores a local file over a passive data
+	       connection. binary uploads go from the file to
+	       the socket through commc_socket_send_file(), so
+	       the data never passes through a user buffer;
+	       it is sent in slices of FTP_SENDFILE_SLICE so
+	       progress can be reported in between.
+
+*/
+
+commc_error_t commc_ftp_upload_file(commc_ftp_client_t* client,
+                                    const char*         local_path,
+                                    const char*         remote_path) {
+
+    commc_socket_t* data_socket = NULL;
+    ftp_transfer_t  transfer;
+    struct stat     file_status;
+    int             file_handle;
+    size_t          size;
+    size_t          slice;
+    size_t          bytes_sent;
+    commc_error_t   result;
     
-    if (!client || !hostname) {
+    if (!client || !local_path || !remote_path) {
     
         return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    if (client->state != COMMC_FTP_STATE_DISCONNECTED) {
+    if (client->state != COMMC_FTP_STATE_AUTHENTICATED) {
     
         return COMMC_ERROR_INVALID_STATE;
         
     }
     
-    /* Store connection parameters */
+    file_handle = open_local_file(local_path);
     
-    if (strlen(hostname) >= COMMC_FTP_MAX_HOSTNAME_LENGTH) {
+    if (file_handle < 0) {
     
-        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        return COMMC_IO_ERROR;
         
     }
     
-    strcpy(client->hostname, hostname);
-    client->port = (port > 0) ? port : COMMC_FTP_DEFAULT_PORT;
+    if (fstat(file_handle, &file_status) != 0) {
     
-    client->state = COMMC_FTP_STATE_CONNECTING;
+        close_local_file(file_handle);
+        return COMMC_IO_ERROR;
+        
+    }
     
-    /* Create control connection */
+    size   = (size_t)file_status.st_size;
+    result = start_store(client, remote_path, &data_socket);
     
-    result = create_socket_connection(client->hostname, client->port,
-                                      client->timeout, &client->control_socket);
-                                      
-    if (result != COMMC_SUCCESS) {
+    begin_transfer(&transfer, client, size);
     
-        client->state = COMMC_FTP_STATE_ERROR;
-        return result;
+    if (result == COMMC_SUCCESS) {
+    
+        if (client->type == COMMC_FTP_TYPE_BINARY) {
+        
+            while (result == COMMC_SUCCESS && transfer.progress.transferred < size) {
+            
+                slice      = size - transfer.progress.transferred;
+                slice      = slice < FTP_SENDFILE_SLICE ? slice : FTP_SENDFILE_SLICE;
+                bytes_sent = 0;
+                
+                result = commc_socket_send_file(data_socket, file_handle,
+                                                transfer.progress.transferred, slice, &bytes_sent);
+                                                
+                /* A file that shrank under the upload ends early */
+                
+                if (result == COMMC_SUCCESS && bytes_sent == 0) {
+                
+                    result = COMMC_IO_ERROR;
+                    
+                }
+                
+                if (result == COMMC_SUCCESS) {
+                
+                    result = advance_transfer(&transfer, bytes_sent);
+                    
+                }
+                
+            }
+            
+        } else {
+        
+            result = send_ascii_file(&transfer, data_socket, file_handle, size);
+            
+        }
         
     }
     
-    /* Read initial server response */
+    /* Closing the data connection ends the file */
     
-    result = receive_line(client->control_socket, response_buffer, sizeof(response_buffer));
+    commc_socket_destroy(data_socket);
+    close_local_file(file_handle);
     
-    if (result != COMMC_SUCCESS) {
+    return end_transfer(&transfer, finish_transfer(client, result));
     
-        close(client->control_socket);
-        client->control_socket = FTP_INVALID_SOCKET;
-        client->state = COMMC_FTP_STATE_ERROR;
-        return result;
+}
+
+/*
+
+         commc_ftp_upload_stream()
+	       ---
+	       stores what source produces, read into the
+	       client's transfer buffer a buffer at a time.
+
+*/
+
+commc_error_t commc_ftp_upload_stream(commc_ftp_client_t* client,
+                                      const char*         remote_path,
+                                      commc_ftp_source_t  source,
+                                      void*               user_data) {
+
+    commc_socket_t* data_socket = NULL;
+    ftp_transfer_t  transfer;
+    char*           buffer;
+    size_t          size;
+    size_t          length;
+    char            previous = '\0';
+    commc_error_t   result;
+    
+    if (!client || !remote_path || !source) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    /* Parse response code */
+    if (client->state != COMMC_FTP_STATE_AUTHENTICATED) {
     
-    response_code = parse_response_code(response_buffer);
+        return COMMC_ERROR_INVALID_STATE;
+        
+    }
     
-    if (!is_positive_response(response_code)) {
+    result = acquire_buffer(client, &buffer, &size);
     
-        close(client->control_socket);
-        client->control_socket = FTP_INVALID_SOCKET;
-        client->state = COMMC_FTP_STATE_ERROR;
-        return COMMC_SYSTEM_ERROR;
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
         
     }
     
-    /* Store response */
+    result = start_store(client, remote_path, &data_socket);
     
-    client->last_response.code = response_code;
-    strcpy(client->last_response.message, response_buffer);
-    client->last_response.is_multiline = 0;
+    begin_transfer(&transfer, client, 0);
     
-    client->state = COMMC_FTP_STATE_CONNECTED;
+    while (result == COMMC_SUCCESS) {
     
-    return COMMC_SUCCESS;
+        length = 0;
+        result = source(buffer, size, &length, user_data);
+        
+        if (result != COMMC_SUCCESS || length == 0) {
+        
+            break;
+            
+        }
+        
+        if (length > size) {
+        
+            result = COMMC_ERROR_INVALID_ARGUMENT;
+            
+        } else if (client->type == COMMC_FTP_TYPE_BINARY) {
+        
+            result = commc_socket_send_all(data_socket, buffer, length);
+            
+            if (result == COMMC_SUCCESS) {
+            
+                result = advance_transfer(&transfer, length);
+                
+            }
+            
+        } else {
+        
+            result = send_ascii(&transfer, data_socket, buffer, length, &previous);
+            
+        }
+        
+    }
+    
+    commc_socket_destroy(data_socket);
+    
+    return end_transfer(&transfer, finish_transfer(client, result));
     
 }
 
 /*
 
-         commc_ftp_authenticate()
+         commc_ftp_download_file()
 	       ---
-	       performs user authentication with
-	       username and password.
+	       retrieves a remote file over a passive data
+	       connection into local_path, which is created or
+	       truncated. ASCII-type downloads have their CRLF
+	       line ends stored as LF.
 
 */
 
-commc_error_t commc_ftp_authenticate(commc_ftp_client_t* client,
-                                     const char*         username,
-                                     const char*         password) {
+commc_error_t commc_ftp_download_file(commc_ftp_client_t* client,
+                                      const char*         remote_path,
+                                      const char*         local_path) {
 
-    char command_buffer[FTP_COMMAND_BUFFER_SIZE];
-    char response_buffer[FTP_RESPONSE_BUFFER_SIZE];
+    int           file_handle;
     commc_error_t result;
-    int response_code;
     
-    if (!client || !username || !password) {
+    if (!client || !remote_path || !local_path) {
     
         return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    if (client->state != COMMC_FTP_STATE_CONNECTED) {
+    if (client->state != COMMC_FTP_STATE_AUTHENTICATED) {
     
         return COMMC_ERROR_INVALID_STATE;
         
     }
     
-    /* Store credentials */
+    file_handle = create_local_file(local_path);
     
-    if (strlen(username) >= COMMC_FTP_MAX_USERNAME_LENGTH ||
-        strlen(password) >= COMMC_FTP_MAX_PASSWORD_LENGTH) {
-        
-        return COMMC_ERROR_BUFFER_TOO_SMALL;
+    if (file_handle < 0) {
+    
+        return COMMC_IO_ERROR;
         
     }
     
-    strcpy(client->username, username);
-    strcpy(client->password, password);
+    result = commc_ftp_download_stream(client, remote_path, file_sink, &file_handle);
     
-    /* Send USER command */
+    close_local_file(file_handle);
     
-    snprintf(command_buffer, sizeof(command_buffer), "USER %s\r\n", username);
+    return result;
     
-    result = send_all(client->control_socket, command_buffer, strlen(command_buffer));
+}
+
+/*
+
+         commc_ftp_download_stream()
+	       ---
+	       retrieves a remote file and hands it to sink as
+	       it arrives, a transfer buffer at a time.
+
+*/
+
+commc_error_t commc_ftp_download_stream(commc_ftp_client_t* client,
+                                        const char*         remote_path,
+                                        commc_ftp_sink_t    sink,
+                                        void*               user_data) {
+
+    commc_socket_t* data_socket = NULL;
+    ftp_transfer_t  transfer;
+    size_t          received    = 0;
+    commc_error_t   result;
     
-    if (result != COMMC_SUCCESS) {
+    if (!client || !remote_path || !sink) {
     
-        client->state = COMMC_FTP_STATE_ERROR;
-        return result;
+        return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    /* Read USER response */
+    if (client->state != COMMC_FTP_STATE_AUTHENTICATED) {
     
-    result = receive_line(client->control_socket, response_buffer, sizeof(response_buffer));
+        return COMMC_ERROR_INVALID_STATE;
+        
+    }
     
-    if (result != COMMC_SUCCESS) {
+    result = start_retrieve(client, remote_path, 0, &data_socket);
     
-        client->state = COMMC_FTP_STATE_ERROR;
-        return result;
-        
+    begin_transfer(&transfer, client, result == COMMC_SUCCESS ? announced_size(client) : 0);
+    
+    if (result == COMMC_SUCCESS) {
+    
+        result = receive_data(&transfer, data_socket, (size_t)-1, &received,
+                              client->type != COMMC_FTP_TYPE_BINARY, sink, user_data);
+                              
     }
     
-    response_code = parse_response_code(response_buffer);
+    commc_socket_destroy(data_socket);
     
-    /* Send PASS command if password required */
+    return end_transfer(&transfer, finish_transfer(client, result));
     
-    if (response_code == 331) { /* Need password */
+}
+
+/*
+
+         commc_ftp_get_file_size()
+	       ---
+	       retrieves file size from remote server
+	       using SIZE command.
+
+*/
+
+commc_error_t commc_ftp_get_file_size(commc_ftp_client_t* client,
+                                      const char*         remote_path,
+                                      long*               file_size) {
+
+    size_t        size;
+    commc_error_t result;
     
-        snprintf(command_buffer, sizeof(command_buffer), "PASS %s\r\n", password);
-        
-        result = send_all(client->control_socket, command_buffer, strlen(command_buffer));
-        
-        if (result != COMMC_SUCCESS) {
-        
-            client->state = COMMC_FTP_STATE_ERROR;
-            return result;
-            
-        }
-        
-        /* Read PASS response */
-        
-        result = receive_line(client->control_socket, response_buffer, sizeof(response_buffer));
-        
-        if (result != COMMC_SUCCESS) {
-        
-            client->state = COMMC_FTP_STATE_ERROR;
-            return result;
-            
-        }
+    if (!client || !remote_path || !file_size) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
         
-        response_code = parse_response_code(response_buffer);
+    }
+    
+    if (client->state != COMMC_FTP_STATE_AUTHENTICATED) {
+    
+        return COMMC_ERROR_INVALID_STATE;
         
     }
     
-    /* Check authentication result */
+    result = query_size(client, remote_path, &size);
     
-    if (!is_positive_response(response_code)) {
+    if (result != COMMC_SUCCESS) {
     
-        client->state = COMMC_FTP_STATE_ERROR;
-        return COMMC_SYSTEM_ERROR;
+        return result;
         
     }
     
-    /* Store response */
+    if (size > (size_t)LONG_MAX) {
     
-    client->last_response.code = response_code;
-    strcpy(client->last_response.message, response_buffer);
-    client->last_response.is_multiline = 0;
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        
+    }
     
-    client->state = COMMC_FTP_STATE_AUTHENTICATED;
+    *file_size = (long)size;
     
     return COMMC_SUCCESS;
     
 }
 
 /*
+	==================================
+      --- SEGMENTED DOWNLOADS ---
+	==================================
+*/
 
-         commc_ftp_disconnect()
+/*
+
+         segment_progress()
 	       ---
-	       gracefully disconnects from FTP server
-	       and cleans up connections.
+	       progress callback of a segment's session. it
+	       only passes on a stop the caller's callback
+	       asked for.
 
 */
 
-commc_error_t commc_ftp_disconnect(commc_ftp_client_t* client) {
+static commc_error_t segment_progress(const commc_ftp_progress_t* progress,
+                                      void*                       user_data) {
 
-    char command_buffer[FTP_COMMAND_BUFFER_SIZE];
+    ftp_segment_t* segment = (ftp_segment_t*)user_data;
     
-    if (!client) {
+    (void)progress;
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+    return COMMC_ATOMIC_LOAD_ACQUIRE(segment->stop);
+    
+}
+
+/*
+
+         open_session()
+	       ---
+	       opens another logged-in connection to the
+	       server of the segment's client, transferring
+	       through the segment's buffer.
+
+*/
+
+static commc_error_t open_session(ftp_segment_t*       segment,
+                                  commc_ftp_client_t** session) {
+
+    const commc_ftp_client_t* parent = segment->client;
+    commc_error_t             result;
+    
+    result = commc_ftp_client_create(session);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
         
     }
     
-    if (client->control_socket != FTP_INVALID_SOCKET) {
+    (*session)->timeout       = parent->timeout;
+    (*session)->mode          = parent->mode;
+    (*session)->buffer        = segment->buffer;
+    (*session)->buffer_size   = segment->buffer_size;
+    (*session)->progress      = segment_progress;
+    (*session)->progress_data = segment;
     
-        /* Send QUIT command */
-        
-        strcpy(command_buffer, "QUIT\r\n");
-        send_all(client->control_socket, command_buffer, strlen(command_buffer));
-        
-        close(client->control_socket);
-        client->control_socket = FTP_INVALID_SOCKET;
+    result = commc_ftp_connect(*session, parent->hostname, parent->port);
+    
+    if (result == COMMC_SUCCESS) {
+    
+        result = commc_ftp_authenticate(*session, parent->username, parent->password);
         
     }
     
-    if (client->data_socket != FTP_INVALID_SOCKET) {
+    if (result != COMMC_SUCCESS) {
     
-        close(client->data_socket);
-        client->data_socket = FTP_INVALID_SOCKET;
+        commc_ftp_disconnect(*session);
+        commc_ftp_client_destroy(*session);
+        *session = NULL;
         
     }
     
-    client->state = COMMC_FTP_STATE_DISCONNECTED;
-    
-    return COMMC_SUCCESS;
+    return result;
     
 }
 
-/* 
-	==================================
-        --- UTILITY FUNCTIONS ---
-	==================================
-*/
-
 /*
 
-         commc_ftp_send_command()
+         fetch_segment()
 	       ---
-	       sends raw FTP command to server
-	       and retrieves response.
+	       one attempt at the rest of a segment: a new
+	       session retrieves from where the last attempt
+	       stopped and writes at that place in the file.
+	       reading stops at the end of the range, so the
+	       server sees the data connection close early and
+	       the session is simply dropped.
 
 */
 
-commc_error_t commc_ftp_send_command(commc_ftp_client_t*    client,
-                                     const char*            command,
-                                     commc_ftp_response_t*  response) {
+static commc_error_t fetch_segment(ftp_segment_t* segment) {
 
-    char command_buffer[FTP_COMMAND_BUFFER_SIZE];
-    char response_buffer[FTP_RESPONSE_BUFFER_SIZE];
-    commc_error_t result;
-    int response_code;
+    commc_ftp_client_t* session;
+    commc_socket_t*     data_socket = NULL;
+    ftp_transfer_t      transfer;
+    size_t              position    = segment->offset + segment->received;
+    int                 file_handle;
+    commc_error_t       result;
     
-    if (!client || !command || !response) {
+    file_handle = open_local_output(segment->local_path);
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+    if (file_handle < 0) {
+    
+        return COMMC_IO_ERROR;
         
     }
     
-    if (client->control_socket == FTP_INVALID_SOCKET) {
+    if (!seek_local_file(file_handle, position)) {
     
-        return COMMC_ERROR_INVALID_STATE;
+        close_local_file(file_handle);
+        return COMMC_IO_ERROR;
         
     }
     
-    /* Format command with CRLF */
-    
-    snprintf(command_buffer, sizeof(command_buffer), "%s\r\n", command);
-    
-    /* Send command */
-    
-    result = send_all(client->control_socket, command_buffer, strlen(command_buffer));
+    result = open_session(segment, &session);
     
     if (result != COMMC_SUCCESS) {
     
+        close_local_file(file_handle);
         return result;
         
     }
     
-    /* Read response */
-    
-    result = receive_line(client->control_socket, response_buffer, sizeof(response_buffer));
+    result = start_retrieve(session, segment->remote_path, position, &data_socket);
     
-    if (result != COMMC_SUCCESS) {
+    if (result == COMMC_SUCCESS) {
     
-        return result;
+        begin_transfer(&transfer, session, segment->length - segment->received);
+        
+        result = receive_data(&transfer, data_socket, segment->length, &segment->received,
+                              0, file_sink, &file_handle);
+                              
+        /* A server that closed early cut the range short */
+        
+        if (result == COMMC_SUCCESS && segment->received < segment->length) {
+        
+            result = COMMC_ERROR_CONNECTION_CLOSED;
+            
+        }
         
     }
     
-    /* Parse response */
-    
-    response_code = parse_response_code(response_buffer);
+    commc_socket_destroy(data_socket);
+    close_local_file(file_handle);
     
-    response->code = response_code;
-    strcpy(response->message, response_buffer);
-    response->is_multiline = 0;
+    commc_ftp_disconnect(session);
+    commc_ftp_client_destroy(session);
     
-    /* Store in client */
-    
-    client->last_response = *response;
-    
-    return COMMC_SUCCESS;
+    return result;
     
 }
 
 /*
 
-         commc_ftp_get_last_response()
+         download_segment()
 	       ---
-	       retrieves the last server response
-	       for debugging and error analysis.
+	       thread pool task fetching one segment, trying
+	       again from where it stopped after a failure.
+	       failing to write the file, or being stopped, is
+	       final; a final failure stops the other
+	       segments.
 
 */
 
-commc_error_t commc_ftp_get_last_response(const commc_ftp_client_t* client,
-                                          commc_ftp_response_t*     response) {
+static void download_segment(void* arg) {
 
-    if (!client || !response) {
+    ftp_segment_t* segment = (ftp_segment_t*)arg;
+    int            attempt;
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+    for (attempt = 0; attempt <= COMMC_FTP_SEGMENT_RETRIES; attempt++) {
+    
+        segment->result = fetch_segment(segment);
+        
+        if (segment->result == COMMC_SUCCESS || segment->result == COMMC_IO_ERROR ||
+            COMMC_ATOMIC_LOAD_ACQUIRE(segment->stop) != COMMC_SUCCESS) {
+            
+            break;
+            
+        }
         
     }
     
-    *response = client->last_response;
+    /* A range that failed for good fails the whole transfer; the first one wins */
     
-    return COMMC_SUCCESS;
+    if (segment->result != COMMC_SUCCESS) {
+    
+        COMMC_ATOMIC_CAS(segment->stop, COMMC_SUCCESS, segment->result);
+        
+    }
     
 }
 
 /*
 
-         commc_ftp_is_connected()
+         acquire_segment_buffers()
 	       ---
-	       checks if FTP client is connected
-	       and authenticated with server.
+	       makes sure the client's buffer pool holds count
+	       transfer buffers, keeping it for later
+	       segmented downloads.
 
 */
 
-int commc_ftp_is_connected(const commc_ftp_client_t* client) {
+static commc_error_t acquire_segment_buffers(commc_ftp_client_t* client,
+                                             size_t              count) {
 
-    if (!client) {
+    if (client->buffer_size == 0) {
     
-        return 0;
+        client->buffer_size = COMMC_FTP_TRANSFER_BUFFER_SIZE;
         
     }
     
-    return (client->state == COMMC_FTP_STATE_AUTHENTICATED) ? 1 : 0;
+    if (client->segment_buffers && client->segment_buffer_count >= count) {
+    
+        return COMMC_SUCCESS;
+        
+    }
+    
+    commc_memory_pool_destroy(client->segment_buffers);
+    
+    client->segment_buffers      = commc_memory_pool_create(client->buffer_size, count);
+    client->segment_buffer_count = client->segment_buffers ? count : 0;
+    
+    return client->segment_buffers ? COMMC_SUCCESS : COMMC_MEMORY_ERROR;
     
 }
 
 /*
 
-         commc_ftp_get_state()
+         release_segment_buffers()
 	       ---
-	       retrieves current FTP client state
-	       for status monitoring.
+	       gives the buffers the segments took back to the
+	       client's pool.
 
 */
 
-commc_ftp_state_t commc_ftp_get_state(const commc_ftp_client_t* client) {
+static void release_segment_buffers(commc_ftp_client_t* client,
+                                    ftp_segment_t*      parts,
+                                    size_t              count) {
 
-    if (!client) {
+    size_t i;
     
-        return COMMC_FTP_STATE_ERROR;
+    for (i = 0; i < count; i++) {
+    
+        if (parts[i].buffer) {
+        
+            commc_memory_pool_free(client->segment_buffers, parts[i].buffer);
+            parts[i].buffer = NULL;
+            
+        }
         
     }
     
-    return client->state;
-    
 }
 
-/* 
-	==================================
-        --- CONVENIENCE FUNCTIONS ---
-	==================================
-*/
-
 /*
 
-         commc_ftp_quick_upload()
+         commc_ftp_download_segmented()
 	       ---
-	       convenience function for simple
-	       file upload with authentication.
+	       splits a binary download into byte ranges
+	       fetched at once over their own connections and
+	       written in place into a file sized up front.
+	       with a progress callback, the calling thread
+	       reports the ranges' sum while it waits.
 
 */
 
-commc_error_t commc_ftp_quick_upload(const char* hostname,
-                                     int         port,
-                                     const char* username,
-                                     const char* password,
-                                     const char* local_path,
-                                     const char* remote_path) {
-
-    commc_ftp_client_t* client = NULL;
-    commc_error_t       result;
-    
-    if (!hostname || !username || !password || !local_path || !remote_path) {
+commc_error_t commc_ftp_download_segmented(commc_ftp_client_t* client,
+                                           const char*         remote_path,
+                                           const char*         local_path,
+                                           int                 segments) {
+
+    ftp_segment_t*           parts;
+    ftp_transfer_t           transfer;
+    commc_threadpool_t*      pool;
+    commc_threadpool_group_t group;
+    commc_error_t            stop = COMMC_SUCCESS;
+    commc_error_t            reported;
+    size_t                   size;
+    size_t                   count;
+    size_t                   i;
+    int                      response_code;
+    int                      file_handle;
+    commc_error_t            result;
+    
+    if (!client || !remote_path || !local_path || segments < 1) {
     
         return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    /* Create client */
+    if (client->state != COMMC_FTP_STATE_AUTHENTICATED) {
     
-    result = commc_ftp_client_create(&client);
+        return COMMC_ERROR_INVALID_STATE;
+        
+    }
+    
+    if (segments > COMMC_FTP_MAX_SEGMENTS) {
+    
+        segments = COMMC_FTP_MAX_SEGMENTS;
+        
+    }
+    
+    /* Offsets only line up with the file in binary */
+    
+    if (client->type != COMMC_FTP_TYPE_BINARY || segments == 1) {
+    
+        return commc_ftp_download_file(client, remote_path, local_path);
+        
+    }
+    
+    result = send_command(client, "TYPE", "I", &response_code);
     
     if (result != COMMC_SUCCESS) {
     
@@ -940,86 +2891,182 @@ commc_error_t commc_ftp_quick_upload(const char* hostname,
         
     }
     
-    /* Connect and authenticate */
+    /* Without a size there is nothing to split */
     
-    result = commc_ftp_connect(client, hostname, port);
+    if (!is_positive_response(response_code) ||
+        query_size(client, remote_path, &size) != COMMC_SUCCESS) {
+        
+        return commc_ftp_download_file(client, remote_path, local_path);
+        
+    }
     
-    if (result == COMMC_SUCCESS) {
+    count = size / COMMC_FTP_SEGMENT_MIN_SIZE;
     
-        result = commc_ftp_authenticate(client, username, password);
+    if (count > (size_t)segments) {
+    
+        count = (size_t)segments;
         
-        if (result == COMMC_SUCCESS) {
+    }
+    
+    if (count < 2) {
+    
+        return commc_ftp_download_file(client, remote_path, local_path);
         
-            result = commc_ftp_upload_file(client, local_path, remote_path);
+    }
+    
+    result = acquire_segment_buffers(client, count);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    parts = (ftp_segment_t*)calloc(count, sizeof(ftp_segment_t));
+    
+    if (!parts) {
+    
+        return COMMC_MEMORY_ERROR;
+        
+    }
+    
+    for (i = 0; i < count; i++) {
+    
+        parts[i].buffer = (char*)commc_memory_pool_alloc(client->segment_buffers);
+        
+        if (!parts[i].buffer) {
+        
+            release_segment_buffers(client, parts, i);
+            free(parts);
+            return COMMC_MEMORY_ERROR;
             
         }
         
     }
     
-    /* Cleanup */
+    /* Without threads the ranges cannot run at once; fetch it whole */
     
-    commc_ftp_disconnect(client);
-    commc_ftp_client_destroy(client);
+    pool = commc_threadpool_create(count);
     
-    return result;
+    if (!pool) {
     
-}
-
-/*
-
-         commc_ftp_quick_download()
-	       ---
-	       convenience function for simple
-	       file download with authentication.
-
-*/
-
-commc_error_t commc_ftp_quick_download(const char* hostname,
-                                       int         port,
-                                       const char* username,
-                                       const char* password,
-                                       const char* remote_path,
-                                       const char* local_path) {
-
-    commc_ftp_client_t* client = NULL;
-    commc_error_t       result;
+        release_segment_buffers(client, parts, count);
+        free(parts);
+        return commc_ftp_download_file(client, remote_path, local_path);
+        
+    }
     
-    if (!hostname || !username || !password || !local_path || !remote_path) {
+    /* Every segment writes into its own place of the full-size file */
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+    file_handle = create_local_file(local_path);
+    
+    if (file_handle < 0) {
+    
+        commc_threadpool_destroy(pool);
+        release_segment_buffers(client, parts, count);
+        free(parts);
+        return COMMC_IO_ERROR;
         
     }
     
-    /* Create client */
+    if (!resize_local_file(file_handle, size)) {
     
-    result = commc_ftp_client_create(&client);
+        close_local_file(file_handle);
+        remove(local_path);
+        commc_threadpool_destroy(pool);
+        release_segment_buffers(client, parts, count);
+        free(parts);
+        return COMMC_IO_ERROR;
+        
+    }
     
-    if (result != COMMC_SUCCESS) {
+    close_local_file(file_handle);
     
-        return result;
+    for (i = 0; i < count; i++) {
+    
+        parts[i].client      = client;
+        parts[i].remote_path = remote_path;
+        parts[i].local_path  = local_path;
+        parts[i].offset      = size / count * i;
+        parts[i].length      = i + 1 < count ? size / count : size - parts[i].offset;
+        parts[i].buffer_size = client->buffer_size;
+        parts[i].stop        = &stop;
+        parts[i].result      = COMMC_SUCCESS;
         
     }
     
-    /* Connect and authenticate */
+    begin_transfer(&transfer, client, size);
+    commc_threadpool_group_init(&group, pool);
     
-    result = commc_ftp_connect(client, hostname, port);
+    for (i = 0; i < count; i++) {
     
-    if (result == COMMC_SUCCESS) {
+        if (commc_threadpool_group_spawn(&group, download_segment, &parts[i]) != COMMC_SUCCESS) {
+        
+            download_segment(&parts[i]);
+            
+        }
+        
+    }
     
-        result = commc_ftp_authenticate(client, username, password);
+    /* The ranges count on their own threads; report their sum from here */
+    
+    while (client->progress && COMMC_ATOMIC_LOAD_ACQUIRE(&group.pending) > 0) {
+    
+        commc_sleep_ms(COMMC_FTP_PROGRESS_INTERVAL_MS);
+        
+        if (COMMC_ATOMIC_LOAD_ACQUIRE(&group.pending) == 0) {
+        
+            break;
+            
+        }
+        
+        transfer.progress.transferred = 0;
+        
+        for (i = 0; i < count; i++) {
+        
+            transfer.progress.transferred += COMMC_ATOMIC_LOAD_ACQUIRE(&parts[i].received);
+            
+        }
+        
+        reported = report_transfer(&transfer, COMMC_ATOMIC_LOAD_ACQUIRE(&stop) == COMMC_SUCCESS);
+        
+        if (reported != COMMC_SUCCESS) {
+        
+            COMMC_ATOMIC_CAS(&stop, COMMC_SUCCESS, reported);
+            
+        }
+        
+    }
+    
+    commc_threadpool_group_wait(&group);
+    commc_threadpool_destroy(pool);
+    
+    transfer.progress.transferred = 0;
+    
+    for (i = 0; i < count; i++) {
+    
+        transfer.progress.transferred += parts[i].received;
         
         if (result == COMMC_SUCCESS) {
         
-            result = commc_ftp_download_file(client, remote_path, local_path);
+            result = parts[i].result;
             
         }
         
     }
     
-    /* Cleanup */
+    result = end_transfer(&transfer, stop != COMMC_SUCCESS ? stop : result);
     
-    commc_ftp_disconnect(client);
-    commc_ftp_client_destroy(client);
+    /* A full-size file with holes must not pass for a download */
+    
+    if (result != COMMC_SUCCESS) {
+    
+        remove(local_path);
+        
+    }
+    
+    release_segment_buffers(client, parts, count);
+    free(parts);
     
     return result;
     
@@ -1039,22 +3086,6 @@ commc_error_t commc_ftp_quick_download(const char* hostname,
 
 */
 
-commc_error_t commc_ftp_upload_file(commc_ftp_client_t* client,
-                                    const char*         local_path,
-                                    const char*         remote_path) {
-    /* Stub implementation - requires data connection setup and file transfer */
-    if (!client || !local_path || !remote_path) return COMMC_ERROR_INVALID_ARGUMENT;
-    return COMMC_NOT_IMPLEMENTED_ERROR;
-}
-
-commc_error_t commc_ftp_download_file(commc_ftp_client_t* client,
-                                      const char*         remote_path,
-                                      const char*         local_path) {
-    /* Stub implementation - requires data connection setup and file transfer */
-    if (!client || !remote_path || !local_path) return COMMC_ERROR_INVALID_ARGUMENT;
-    return COMMC_NOT_IMPLEMENTED_ERROR;
-}
-
 commc_error_t commc_ftp_delete_file(commc_ftp_client_t* client,
                                     const char*         remote_path) {
     /* Stub implementation - send DELE command */
@@ -1070,14 +3101,6 @@ commc_error_t commc_ftp_rename_file(commc_ftp_client_t* client,
     return COMMC_NOT_IMPLEMENTED_ERROR;
 }
 
-commc_error_t commc_ftp_get_file_size(commc_ftp_client_t* client,
-                                      const char*         remote_path,
-                                      long*               file_size) {
-    /* Stub implementation - send SIZE command */
-    if (!client || !remote_path || !file_size) return COMMC_ERROR_INVALID_ARGUMENT;
-    return COMMC_NOT_IMPLEMENTED_ERROR;
-}
-
 commc_error_t commc_ftp_change_directory(commc_ftp_client_t* client,
                                          const char*         directory) {
     /* Stub implementation - send CWD command */
@@ -33,29 +33,17 @@
 #include <ctype.h>
 #include <time.h>
 
+#include "commc/http.h"
+#include "commc/socket.h"
+#include "commc/bufreader.h"
+#include "commc/httpparser.h"
+#include "commc/flate.h"
+#include "commc/error.h"
+
 #ifdef _WIN32
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#if defined(_MSC_VER)
-#pragma comment(lib, "ws2_32.lib")
-#endif
 #define close closesocket
-#define SOCKET_ERROR_CODE WSAGetLastError()
-#define COMMC_INVALID_SOCKET ((int)-1)
-#else
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <netdb.h>
-#include <unistd.h>
-#include <errno.h>
-#define SOCKET_ERROR -1
-#define SOCKET_ERROR_CODE errno
-#define COMMC_INVALID_SOCKET -1
 #endif
 
-#include "commc/http.h"
-#include "commc/error.h"
-
 /* 
 	==================================
            --- CONSTANTS ---
@@ -65,860 +53,3831 @@
 #define HTTP_REQUEST_BUFFER_SIZE  8192    /* REQUEST BUFFER SIZE */
 #define HTTP_RESPONSE_BUFFER_SIZE 8192    /* RESPONSE BUFFER SIZE */
 #define HTTP_LINE_BUFFER_SIZE     2048    /* LINE BUFFER SIZE */
-#define MAX_RESPONSE_SIZE         1048576 /* 1MB MAX RESPONSE */
+#define HTTP_MULTI_RECEIVE_SIZE   16384   /* CONCURRENT CONNECTION RECEIVE SIZE */
+#define HTTP_MULTI_MAX_HEAD       65536   /* LARGEST CONCURRENT RESPONSE HEAD */
+#define HTTP_CHUNK_SIZE           16384   /* GZIPPED REQUEST BODY BYTES PER CHUNK */
 
 /* 
 	==================================
-             --- HELPERS ---
+           --- STRUCTURES ---
 	==================================
 */
 
 /*
 
-         http_method_strings[]
+         http_framing_t
 	       ---
-	       array of HTTP method names corresponding
-	       to the method enumeration values.
+	       how the body of a response is delimited.
 
 */
 
-static const char* http_method_strings[] = {
-    "GET",
-    "POST", 
-    "PUT",
-    "DELETE",
-    "HEAD",
-    "OPTIONS",
-    "PATCH"
-};
+typedef enum {
+
+    HTTP_BODY_NONE,           /* NO BODY */
+    HTTP_BODY_LENGTH,         /* CONTENT-LENGTH BYTES */
+    HTTP_BODY_CHUNKED,        /* CHUNKED TRANSFER CODING */
+    HTTP_BODY_UNTIL_CLOSE,    /* EVERYTHING UNTIL THE SERVER CLOSES */
+    HTTP_BODY_INVALID         /* UNUSABLE CONTENT-LENGTH */
+
+} http_framing_t;
 
 /*
 
-         initialize_sockets()
+         http_decoding_t
 	       ---
-	       initializes the socket library on Windows
-	       platforms. no-op on Unix systems.
+	       a response body on its way from its
+	       Content-Encoding to the body callback.
 
 */
 
-static commc_error_t initialize_sockets(void) {
+typedef struct {
 
-#ifdef _WIN32
+    commc_flate_decoder_t* decoder;         /* NULL WHEN THE BODY IS NOT CODED */
+    size_t                 received;        /* CODED BYTES SO FAR */
 
-    WSADATA wsa_data;
-    int result = WSAStartup(MAKEWORD(2, 2), &wsa_data);
-    
-    if (result != 0) {
-    
-        return COMMC_SYSTEM_ERROR;
-        
-    }
-    
-#endif
+} http_decoding_t;
 
-    return COMMC_SUCCESS;
-    
-}
+/*
+
+         http_multi_stage_t
+	       ---
+	       where a concurrent connection is in the
+	       response it is reading.
+
+*/
+
+typedef enum {
+
+    HTTP_MULTI_HEAD,          /* STATUS LINE AND HEADERS */
+    HTTP_MULTI_BODY,          /* CONTENT-LENGTH OR CLOSE-DELIMITED BODY */
+    HTTP_MULTI_CHUNK_SIZE,    /* HEX SIZE LINE */
+    HTTP_MULTI_CHUNK_DATA,    /* CHUNK BYTES */
+    HTTP_MULTI_CHUNK_END,     /* CRLF AFTER CHUNK BYTES */
+    HTTP_MULTI_TRAILER        /* TRAILER LINES UP TO AN EMPTY ONE */
+
+} http_multi_stage_t;
 
 /*
 
-         cleanup_sockets()
+         http_multi_job_t
 	       ---
-	       cleans up the socket library on Windows
-	       platforms. no-op on Unix systems.
+	       one request added to a commc_http_multi_t.
 
 */
 
-static void cleanup_sockets(void) {
+typedef struct http_multi_job_t {
 
-#ifdef _WIN32
+    struct http_multi_job_t*         next;          /* HOST QUEUE OR CONNECTION LIST */
+    commc_http_request_t*            request;
+    commc_http_response_t*           response;
+    commc_http_completion_callback_t callback;
+    void*                            user_data;
+    int                              retried;       /* ALREADY LOST ONE CONNECTION */
+    int                              replied;       /* SOME OF THE RESPONSE ARRIVED */
 
-    WSACleanup();
-    
-#endif
+} http_multi_job_t;
 
-}
+/*
+
+         http_multi_connection_t
+	       ---
+	       a pooled connection carrying requests of a
+	       commc_http_multi_t. requests go out in the order
+	       they were assigned and are answered in that
+	       order.
+
+*/
+
+typedef struct http_multi_connection_t {
+
+    struct http_multi_host_t*       host;
+    struct http_multi_connection_t* prev;           /* HOST LIST */
+    struct http_multi_connection_t* next;
+    commc_socket_t*                 socket;
+    int                             pending;        /* OPERATIONS IN FLIGHT */
+    int                             sending;        /* SEND OR SENDFILE IN FLIGHT */
+    int                             receiving;      /* RECEIVE IN FLIGHT */
+    int                             closing;        /* FREED ONCE PENDING IS 0 */
+    int                             reusable;       /* NO RESPONSE HAS ASKED TO CLOSE */
+
+    http_multi_job_t*               jobs;           /* SENT OR SENDING, OLDEST FIRST */
+    http_multi_job_t*               jobs_tail;
+    size_t                          job_count;
+
+    char*                           output;         /* FORMATTED REQUESTS */
+    size_t                          output_length;
+    size_t                          output_capacity;
+    size_t                          output_sent;
+
+    int                             file;           /* FILE BODY AFTER THE OUTPUT, -1 IF NONE */
+    size_t                          file_offset;
+    size_t                          file_remaining;
+
+    char*                           input;          /* RECEIVED, UNPROCESSED BYTES */
+    size_t                          input_capacity;
+    size_t                          input_start;
+    size_t                          input_end;
+
+    http_multi_stage_t              stage;
+    int                             until_close;    /* BODY ENDS WITH THE CONNECTION */
+    size_t                          remaining;      /* BODY OR CHUNK BYTES LEFT */
+    int                             parsing;        /* PARSER HOLDS A PARTIAL HEAD */
+    commc_http_parser_t             parser;
+    http_decoding_t                 decoding;       /* CONTENT-ENCODING OF THE CURRENT BODY */
+
+    commc_async_timer_t             timer;          /* REQUEST TIMEOUT */
+
+} http_multi_connection_t;
 
 /*
 
-         create_socket_connection()
+         http_chunked_t
 	       ---
-	       creates a TCP socket connection to the specified
-	       hostname and port with timeout handling.
+	       a request body gzipped on the fly and sent as
+	       HTTP/1.1 chunks of up to HTTP_CHUNK_SIZE bytes,
+	       straight to a socket or onto a concurrent
+	       connection's output.
 
 */
 
-static commc_error_t create_socket_connection(const char* hostname,
-                                              int         port,
-                                              int*        socket_fd) {
+typedef struct {
 
-    struct hostent* host_entry;
-    struct sockaddr_in server_addr;
-    int sock;
-    
-    if (!hostname || !socket_fd) {
-    
-        return COMMC_ERROR_INVALID_ARGUMENT;
-        
-    }
+    commc_socket_t*          socket;                 /* SENDS EACH CHUNK, OR NULL */
+    http_multi_connection_t* queue;                  /* OTHERWISE QUEUES IT HERE */
+    size_t                   length;                 /* BYTES WAITING IN DATA */
+    char                     data[HTTP_CHUNK_SIZE];
+
+} http_chunked_t;
+
+/*
+
+         http_multi_host_t
+	       ---
+	       requests of a commc_http_multi_t for one host
+	       and port, with the connections serving them.
+
+*/
+
+typedef struct http_multi_host_t {
+
+    struct http_multi_host_t*       next;
+    commc_http_multi_t*             multi;
+    char                            hostname[256];
+    int                             port;
+
+    http_multi_job_t*               queue;          /* WAITING FOR A CONNECTION */
+    http_multi_job_t*               queue_tail;
+    size_t                          queued;
+
+    http_multi_connection_t*        connections;
+    size_t                          connection_count;
+    size_t                          acquiring;      /* POOL ACQUIRES IN FLIGHT */
+
+    int                             pumping;        /* INSIDE multi_pump_host() */
+    int                             repump;         /* CALLED AGAIN MEANWHILE */
+
+} http_multi_host_t;
+
+struct commc_http_multi_t {
+
+    commc_http_client_t*            client;
+    commc_async_context_t*          ctx;
+    int                             owns_ctx;       /* PRIVATE CONTEXT, DESTROYED WITH US */
+    int                             destroying;
+    size_t                          max_connections;
+    size_t                          pipeline_depth;
+    size_t                          outstanding;    /* ADDED, NOT YET COMPLETED */
+    size_t                          pending;        /* OPERATIONS AND ACQUIRES IN FLIGHT */
+    http_multi_host_t*              hosts;
+
+};
+
+/* 
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         http_method_strings[]
+	       ---
+	       array of HTTP method names corresponding
+	       to the method enumeration values.
+
+*/
+
+static const char* http_method_strings[] = {
+    "GET",
+    "POST", 
+    "PUT",
+    "DELETE",
+    "HEAD",
+    "OPTIONS",
+    "PATCH"
+};
+
+/*
+
+         acquire_connection()
+	       ---
+	       takes a connection to the request's host and
+	       port from the client's pool, reusing an idle
+	       kept-alive one when there is one, with
+	       timeout_seconds bounding every later send and
+	       receive.
+
+*/
+
+static commc_error_t acquire_connection(commc_http_client_t*  client,
+                                        commc_http_request_t* request,
+                                        commc_socket_t**      connection) {
+
+    commc_error_t result;
     
     /* Initialize sockets */
     
-    if (initialize_sockets() != COMMC_SUCCESS) {
-    
-        return COMMC_SYSTEM_ERROR;
-        
-    }
-    
-    /* Create socket */
+    if (commc_socket_init() != COMMC_SUCCESS) {
     
-    sock = socket(AF_INET, SOCK_STREAM, 0);
-    
-    if (sock == COMMC_INVALID_SOCKET) {
-    
-        cleanup_sockets();
         return COMMC_SYSTEM_ERROR;
         
     }
     
-    /* Resolve hostname */
-    
-    host_entry = gethostbyname(hostname);
-    
-    if (!host_entry) {
+    result = commc_socketpool_acquire(client->pool,
+                                      request->url.hostname,
+                                      request->url.port,
+                                      COMMC_SOCKET_TYPE_TCP,
+                                      client->connection_timeout * 1000,
+                                      connection);
+                                      
+    if (result != COMMC_SUCCESS) {
     
-        close(sock);
-        cleanup_sockets();
-        return COMMC_SYSTEM_ERROR;
+        return result;
         
     }
     
-    /* Set up server address */
-    
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons((unsigned short)port);
-    memcpy(&server_addr.sin_addr, host_entry->h_addr_list[0], 
-           (size_t)host_entry->h_length);
-    
-    /* Connect to server */
-    
-    if (connect(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
-    
-        close(sock);
-        cleanup_sockets();
-        return COMMC_SYSTEM_ERROR;
-        
-    }
+    (*connection)->options.send_timeout    = request->timeout_seconds;
+    (*connection)->options.receive_timeout = request->timeout_seconds;
     
-    *socket_fd = sock;
     return COMMC_SUCCESS;
     
 }
 
 /*
 
-         send_all()
+         header_has_token()
 	       ---
-	       sends all data through the socket, handling
-	       partial sends and ensuring complete transmission.
+	       checks a comma-separated header value such as
+	       "keep-alive, Upgrade" for a token, ignoring
+	       case and surrounding whitespace.
 
 */
 
-static commc_error_t send_all(int         socket_fd,
-                              const char* data,
-                              size_t      data_length) {
+static int header_has_token(const char* value, const char* token) {
 
-    size_t total_sent = 0;
-    int    bytes_sent;
+    size_t token_length = strlen(token);
+    size_t i;
     
-    while (total_sent < data_length) {
+    while (*value) {
     
-        bytes_sent = send(socket_fd, data + total_sent, 
-                         (int)(data_length - total_sent), 0);
-                         
-        if (bytes_sent == SOCKET_ERROR) {
+        while (*value == ' ' || *value == '\t' || *value == ',') {
         
-            return COMMC_SYSTEM_ERROR;
+            value++;
+            
+        }
+        
+        for (i = 0; i < token_length; i++) {
+        
+            if (tolower((unsigned char)value[i]) != tolower((unsigned char)token[i])) {
+            
+                break;
+                
+            }
+            
+        }
+        
+        if (i == token_length && (value[i] == '\0' || value[i] == ',' ||
+                                  value[i] == ' '  || value[i] == '\t' ||
+                                  value[i] == ';')) {
+        
+            return 1;
             
         }
         
-        total_sent += (size_t)bytes_sent;
+        /* Skip to the next element */
+        
+        while (*value && *value != ',') {
+        
+            value++;
+            
+        }
         
     }
     
-    return COMMC_SUCCESS;
+    return 0;
     
 }
 
 /*
 
-         receive_line()
+         keep_alive_parameter()
 	       ---
-	       receives a single line from the socket,
-	       handling CR/LF line endings properly.
+	       reads a numeric parameter ("timeout" or "max")
+	       from a Keep-Alive header value. returns -1 if
+	       it is absent.
 
 */
 
-static commc_error_t receive_line(int    socket_fd,
-                                  char*  buffer,
-                                  size_t buffer_size) {
+static long keep_alive_parameter(const char* value, const char* name) {
 
-    size_t pos = 0;
-    char   ch;
-    int    bytes_received;
+    size_t name_length = strlen(name);
+    size_t i;
     
-    if (!buffer || buffer_size == 0) {
+    while (*value) {
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
-        
-    }
-    
-    while (pos < buffer_size - 1) {
-    
-        bytes_received = recv(socket_fd, &ch, 1, 0);
-        
-        if (bytes_received == SOCKET_ERROR) {
+        while (*value == ' ' || *value == '\t' || *value == ',') {
         
-            return COMMC_SYSTEM_ERROR;
+            value++;
             
         }
         
-        if (bytes_received == 0) {
+        for (i = 0; i < name_length; i++) {
         
-            break;  /* Connection closed */
+            if (tolower((unsigned char)value[i]) != tolower((unsigned char)name[i])) {
+            
+                break;
+                
+            }
             
         }
         
-        if (ch == '\r') {
+        if (i == name_length && value[i] == '=') {
         
-            continue;  /* Skip carriage return */
+            return strtol(value + i + 1, NULL, 10);
             
         }
         
-        if (ch == '\n') {
+        while (*value && *value != ',') {
         
-            break;  /* End of line */
+            value++;
             
         }
         
-        buffer[pos++] = ch;
-        
     }
     
-    buffer[pos] = '\0';
-    return COMMC_SUCCESS;
+    return -1;
     
 }
 
 /*
 
-         parse_status_line()
+         reserve_body()
 	       ---
-	       parses the HTTP status line from a response,
-	       extracting version, status code, and message.
+	       grows the response body buffer to hold at least
+	       needed bytes plus a terminating NUL, doubling
+	       from HTTP_RESPONSE_BUFFER_SIZE.
 
 */
 
-static commc_error_t parse_status_line(const char*            status_line,
-                                       commc_http_version_t*  version,
-                                       int*                   status_code,
-                                       char*                  status_message) {
+static commc_error_t reserve_body(commc_http_response_t* response, size_t needed) {
 
-    const char* space1;
-    const char* space2;
-    char        version_str[16];
-    char        code_str[8];
+    size_t capacity;
+    char*  body;
     
-    if (!status_line || !version || !status_code || !status_message) {
+    if (needed == (size_t)-1) {
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
         
     }
     
-    /* Find first space (after version) */
+    if (response->body && needed < response->body_capacity) {
     
-    space1 = strchr(status_line, ' ');
+        return COMMC_SUCCESS;
+        
+    }
     
-    if (!space1) {
+    capacity = response->body_capacity ? response->body_capacity : HTTP_RESPONSE_BUFFER_SIZE;
     
-        return COMMC_FORMAT_ERROR;
+    while (capacity <= needed) {
+    
+        if (capacity > (size_t)-1 / 2) {
+        
+            capacity = needed + 1;
+            break;
+            
+        }
+        
+        capacity *= 2;
         
     }
     
-    /* Extract version */
+    body = realloc(response->body, capacity);
     
-    if ((size_t)(space1 - status_line) >= sizeof(version_str)) {
+    if (!body) {
     
-        return COMMC_FORMAT_ERROR;
+        return COMMC_MEMORY_ERROR;
         
     }
     
-    memcpy(version_str, status_line, (size_t)(space1 - status_line));
-    version_str[space1 - status_line] = '\0';
+    response->body          = body;
+    response->body_capacity = capacity;
     
-    if (strcmp(version_str, "HTTP/1.0") == 0) {
+    return COMMC_SUCCESS;
     
-        *version = COMMC_HTTP_VERSION_1_0;
-        
-    } else if (strcmp(version_str, "HTTP/1.1") == 0) {
+}
+
+/*
+
+         append_body()
+	       ---
+	       body callback of commc_http_client_execute():
+	       collects the body in response->body, kept
+	       NUL-terminated.
+
+*/
+
+static commc_error_t append_body(const char* data, size_t length, void* user_data) {
+
+    commc_http_response_t* response = (commc_http_response_t*)user_data;
+    commc_error_t          result;
     
-        *version = COMMC_HTTP_VERSION_1_1;
-        
-    } else {
+    if (length > (size_t)-1 - 1 - response->body_length) {
     
-        return COMMC_FORMAT_ERROR;
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
         
     }
     
-    /* Find second space (after status code) */
-    
-    space2 = strchr(space1 + 1, ' ');
-    
-    if (!space2) {
+    result = reserve_body(response, response->body_length + length);
     
-        /* No status message, just code */
-        
-        *status_code = atoi(space1 + 1);
-        status_message[0] = '\0';
-        
-    } else {
+    if (result != COMMC_SUCCESS) {
     
-        /* Extract status code */
-        
-        if ((size_t)(space2 - space1 - 1) >= sizeof(code_str)) {
-        
-            return COMMC_FORMAT_ERROR;
-            
-        }
-        
-        memcpy(code_str, space1 + 1, (size_t)(space2 - space1 - 1));
-        code_str[space2 - space1 - 1] = '\0';
-        
-        *status_code = atoi(code_str);
-        
-        /* Extract status message */
-        
-        strcpy(status_message, space2 + 1);
+        return result;
         
     }
     
+    memcpy(response->body + response->body_length, data, length);
+    response->body_length += length;
+    response->body[response->body_length] = '\0';
+    
     return COMMC_SUCCESS;
     
 }
 
 /*
 
-         parse_header_line()
+         reset_response()
 	       ---
-	       parses a single HTTP header line into name
-	       and value components.
+	       empties a response before a request is (re)sent.
 
 */
 
-static commc_error_t parse_header_line(const char*           header_line,
-                                       commc_http_header_t*  header) {
+static void reset_response(commc_http_response_t* response) {
 
-    const char* colon;
-    const char* value_start;
-    size_t      name_len;
-    size_t      value_len;
-    
-    if (!header_line || !header) {
+    free(response->body);
+    response->body          = NULL;
+    response->body_length   = 0;
+    response->body_capacity = 0;
+    response->header_count  = 0;
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
-        
-    }
-    
-    /* Find the colon separator */
-    
-    colon = strchr(header_line, ':');
+}
+
+/*
+
+         request_has_header()
+	       ---
+	       checks whether a request sets a header field
+	       itself.
+
+*/
+
+static int request_has_header(const commc_http_request_t* request,
+                              const char*                 name) {
+
+    int i;
     
-    if (!colon) {
+    for (i = 0; i < request->header_count; i++) {
     
-        return COMMC_FORMAT_ERROR;
+        if (header_has_token(request->headers[i].name, name)) {
+        
+            return 1;
+            
+        }
         
     }
     
-    /* Extract header name */
+    return 0;
+    
+}
+
+/*
+
+         start_decoding()
+	       ---
+	       readies decoding for a response body whose
+	       Content-Encoding is gzip or deflate, when the
+	       client asked for it; decoded bytes go to
+	       callback. other codings are left alone. the
+	       "deflate" coding is taken as zlib or bare
+	       DEFLATE, since servers send both.
+
+*/
+
+static commc_error_t start_decoding(http_decoding_t*           decoding,
+                                    commc_http_client_t*       client,
+                                    commc_http_request_t*      request,
+                                    commc_http_response_t*     response,
+                                    commc_http_body_callback_t callback,
+                                    void*                      user_data) {
+
+    commc_flate_format_t format;
+    const char*          value;
     
-    name_len = (size_t)(colon - header_line);
+    decoding->decoder  = NULL;
+    decoding->received = 0;
     
-    if (name_len >= sizeof(header->name)) {
+    if (!client->decompress || request_has_header(request, "Accept-Encoding")) {
     
-        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        return COMMC_SUCCESS;
         
     }
     
-    memcpy(header->name, header_line, name_len);
-    header->name[name_len] = '\0';
-    
-    /* Skip spaces after colon */
+    value = commc_http_response_get_header(response, "Content-Encoding");
     
-    value_start = colon + 1;
+    /* Stacked codings ("deflate, br") are passed on as they are */
     
-    while (*value_start == ' ' || *value_start == '\t') {
+    if (!value || strchr(value, ',')) {
     
-        value_start++;
+        return COMMC_SUCCESS;
         
     }
     
-    /* Extract header value */
+    if (header_has_token(value, "gzip") || header_has_token(value, "x-gzip")) {
     
-    value_len = strlen(value_start);
+        format = COMMC_FLATE_GZIP;
+        
+    } else if (header_has_token(value, "deflate")) {
     
-    if (value_len >= sizeof(header->value)) {
+        format = COMMC_FLATE_AUTO;
+        
+    } else {
     
-        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        return COMMC_SUCCESS;
         
     }
     
-    strcpy(header->value, value_start);
-    
-    return COMMC_SUCCESS;
+    return commc_flate_decoder_create(&decoding->decoder, format, callback, user_data);
     
 }
 
-/* 
-	==================================
-             --- CORE ---
-	==================================
-*/
-
 /*
 
-         commc_http_client_create()
+         decode_body()
 	       ---
-	       creates and initializes a new HTTP client.
+	       body callback feeding coded bytes to the
+	       decoder of an http_decoding_t.
 
 */
 
-commc_error_t commc_http_client_create(commc_http_client_t** client) {
+static commc_error_t decode_body(const char* data, size_t length, void* user_data) {
 
-    commc_http_client_t* new_client;
+    http_decoding_t* decoding = (http_decoding_t*)user_data;
     
+    decoding->received += length;
+    
+    return commc_flate_decoder_write(decoding->decoder, data, length);
+    
+}
+
+/*
+
+         finish_decoding()
+	       ---
+	       checks that a coded body ended with its stream
+	       (an empty body is let through) and frees the
+	       decoder.
+
+*/
+
+static commc_error_t finish_decoding(http_decoding_t* decoding) {
+
+    commc_error_t result = COMMC_SUCCESS;
+    
+    if (!decoding->decoder) {
+    
+        return COMMC_SUCCESS;
+        
+    }
+    
+    if (decoding->received > 0) {
+    
+        result = commc_flate_decoder_finish(decoding->decoder);
+        
+    }
+    
+    commc_flate_decoder_destroy(decoding->decoder);
+    decoding->decoder = NULL;
+    
+    return result;
+    
+}
+
+/*
+
+         compresses_body()
+	       ---
+	       decides whether a request body goes out
+	       gzipped: an in-memory body of at least the
+	       client's threshold that the caller has neither
+	       coded nor given a Content-Length or framing of
+	       its own.
+
+*/
+
+static int compresses_body(const commc_http_client_t*  client,
+                           const commc_http_request_t* request) {
+
+    return client->compress_threshold > 0 && request->body_file < 0 && request->body &&
+           request->body_length >= client->compress_threshold &&
+           !request_has_header(request, "Content-Encoding") &&
+           !request_has_header(request, "Content-Length") &&
+           !request_has_header(request, "Transfer-Encoding");
+           
+}
+
+/*
+
+         queue_output()
+	       ---
+	       appends bytes to a concurrent connection's
+	       output, growing it by doubling.
+
+*/
+
+static commc_error_t queue_output(http_multi_connection_t* connection,
+                                  const char*              data,
+                                  size_t                   length) {
+
+    char*  output;
+    size_t needed = connection->output_length + length;
+    size_t capacity;
+    
+    if (needed > connection->output_capacity) {
+    
+        capacity = connection->output_capacity ? connection->output_capacity :
+                                                 HTTP_REQUEST_BUFFER_SIZE;
+                                                 
+        while (capacity < needed) {
+        
+            capacity *= 2;
+            
+        }
+        
+        output = realloc(connection->output, capacity);
+        
+        if (!output) {
+        
+            return COMMC_MEMORY_ERROR;
+            
+        }
+        
+        connection->output          = output;
+        connection->output_capacity = capacity;
+        
+    }
+    
+    memcpy(connection->output + connection->output_length, data, length);
+    connection->output_length += length;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         flush_chunk()
+	       ---
+	       sends or queues the bytes waiting in chunked as
+	       one chunk: hex size line, data, CRLF.
+
+*/
+
+static commc_error_t flush_chunk(http_chunked_t* chunked) {
+
+    commc_socket_iovec_t pieces[3];
+    char                 size_line[24];
+    commc_error_t        result;
+    
+    if (chunked->length == 0) {
+    
+        return COMMC_SUCCESS;
+        
+    }
+    
+    sprintf(size_line, "%lx\r\n", (unsigned long)chunked->length);
+    
+    if (chunked->socket) {
+    
+        pieces[0].base   = size_line;
+        pieces[0].length = strlen(size_line);
+        pieces[1].base   = chunked->data;
+        pieces[1].length = chunked->length;
+        pieces[2].base   = "\r\n";
+        pieces[2].length = 2;
+        
+        result = commc_socket_sendv_all(chunked->socket, pieces, 3);
+        
+    } else {
+    
+        result = queue_output(chunked->queue, size_line, strlen(size_line));
+        
+        if (result == COMMC_SUCCESS) {
+        
+            result = queue_output(chunked->queue, chunked->data, chunked->length);
+            
+        }
+        
+        if (result == COMMC_SUCCESS) {
+        
+            result = queue_output(chunked->queue, "\r\n", 2);
+            
+        }
+        
+    }
+    
+    chunked->length = 0;
+    
+    return result;
+    
+}
+
+/*
+
+         chunk_output()
+	       ---
+	       encoder output of send_gzipped_body(), gathered
+	       into chunks of HTTP_CHUNK_SIZE bytes.
+
+*/
+
+static commc_error_t chunk_output(const char* data, size_t length, void* user_data) {
+
+    http_chunked_t* chunked = (http_chunked_t*)user_data;
+    size_t          room;
+    commc_error_t   result;
+    
+    while (length > 0) {
+    
+        room = HTTP_CHUNK_SIZE - chunked->length;
+        
+        if (room > length) {
+        
+            room = length;
+            
+        }
+        
+        memcpy(chunked->data + chunked->length, data, room);
+        chunked->length += room;
+        data            += room;
+        length          -= room;
+        
+        if (chunked->length == HTTP_CHUNK_SIZE) {
+        
+            result = flush_chunk(chunked);
+            
+            if (result != COMMC_SUCCESS) {
+            
+                return result;
+                
+            }
+            
+        }
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         send_gzipped_body()
+	       ---
+	       gzips request's body through the streaming
+	       encoder into chunked, ending with the last
+	       chunk. no more than one chunk of compressed
+	       data is held at a time.
+
+*/
+
+static commc_error_t send_gzipped_body(http_chunked_t*             chunked,
+                                       const commc_http_request_t* request) {
+
+    commc_flate_encoder_t* encoder;
+    commc_error_t          result;
+    
+    chunked->length = 0;
+    
+    result = commc_flate_encoder_create(&encoder, COMMC_FLATE_GZIP, COMMC_FLATE_LEVEL_DEFAULT,
+                                        chunk_output, chunked);
+                                        
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    result = commc_flate_encoder_write(encoder, request->body, request->body_length);
+    
+    if (result == COMMC_SUCCESS) {
+    
+        result = commc_flate_encoder_finish(encoder);
+        
+    }
+    
+    commc_flate_encoder_destroy(encoder);
+    
+    if (result == COMMC_SUCCESS) {
+    
+        result = flush_chunk(chunked);
+        
+    }
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    if (chunked->socket) {
+    
+        return commc_socket_send_all(chunked->socket, "0\r\n\r\n", 5);
+        
+    }
+    
+    return queue_output(chunked->queue, "0\r\n\r\n", 5);
+    
+}
+
+/*
+
+         stream_body()
+	       ---
+	       hands the next length bytes to callback straight
+	       from the reader's buffer, one receive's worth at
+	       a time. with until_close set, length is ignored
+	       and everything up to the end of the stream is
+	       passed on.
+
+*/
+
+static commc_error_t stream_body(commc_bufreader_t*         reader,
+                                 size_t                     length,
+                                 int                        until_close,
+                                 commc_http_body_callback_t callback,
+                                 void*                      user_data) {
+
+    const char*   data;
+    size_t        available;
+    commc_error_t result;
+    
+    while (until_close || length > 0) {
+    
+        available = commc_bufreader_data(reader, &data);
+        
+        if (available == 0) {
+        
+            result = commc_bufreader_fill(reader);
+            
+            if (result == COMMC_ERROR_CONNECTION_CLOSED && until_close) {
+            
+                return COMMC_SUCCESS;
+                
+            }
+            
+            if (result != COMMC_SUCCESS) {
+            
+                return result;
+                
+            }
+            
+            continue;
+            
+        }
+        
+        if (!until_close && available > length) {
+        
+            available = length;
+            
+        }
+        
+        result = callback(data, available, user_data);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+        commc_bufreader_consume(reader, available);
+        length -= until_close ? 0 : available;
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         stream_chunked_body()
+	       ---
+	       decodes a Transfer-Encoding: chunked body:
+	       hex size lines (extensions ignored), each chunk
+	       followed by CRLF, then a zero-size chunk and
+	       trailer lines up to an empty one, which are
+	       skipped. chunk data goes to callback as it
+	       arrives.
+
+*/
+
+static commc_error_t stream_chunked_body(commc_bufreader_t*         reader,
+                                         commc_http_body_callback_t callback,
+                                         void*                      user_data) {
+
+    char*         line;
+    char*         end;
+    size_t        line_length;
+    unsigned long chunk_size;
+    commc_error_t result;
+    
+    for (;;) {
+    
+        result = commc_bufreader_read_line(reader, &line, &line_length);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+        chunk_size = strtoul(line, &end, 16);
+        
+        if (end == line || (*end != '\0' && *end != ';' && *end != ' ' && *end != '\t')) {
+        
+            return COMMC_FORMAT_ERROR;
+            
+        }
+        
+        if (chunk_size == 0) {
+        
+            break;
+            
+        }
+        
+        result = stream_body(reader, (size_t)chunk_size, 0, callback, user_data);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+        /* Every chunk's data ends with CRLF */
+        
+        result = commc_bufreader_read_line(reader, &line, &line_length);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+        if (line_length != 0) {
+        
+            return COMMC_FORMAT_ERROR;
+            
+        }
+        
+    }
+    
+    /* Skip trailers */
+    
+    do {
+    
+        result = commc_bufreader_read_line(reader, &line, &line_length);
+        
+    } while (result == COMMC_SUCCESS && line_length != 0);
+    
+    return result;
+    
+}
+
+/*
+
+         append_head()
+	       ---
+	       appends text to the request head being built in
+	       buffer, if it fits with room for the
+	       terminating zero.
+
+*/
+
+static int append_head(char*       buffer,
+                       size_t      size,
+                       size_t*     used,
+                       const char* text) {
+
+    size_t length = strlen(text);
+    
+    if (length >= size - *used) {
+    
+        return 0;
+        
+    }
+    
+    memcpy(buffer + *used, text, length + 1);
+    *used += length;
+    
+    return 1;
+    
+}
+
+/*
+
+         format_request_head()
+	       ---
+	       writes the request line and headers, blank line
+	       included, into buffer and returns their length,
+	       or 0 if they do not fit. body_length non-zero
+	       adds Content-Length; gzipped instead announces
+	       a gzip-coded, chunked body (send_gzipped_body()).
+
+*/
+
+static size_t format_request_head(commc_http_client_t*  client,
+                                  commc_http_request_t* request,
+                                  size_t                body_length,
+                                  int                   gzipped,
+                                  char*                 buffer,
+                                  size_t                size) {
+
+    char   number[32];
+    size_t used = 0;
+    int    fits;
+    int    i;
+    
+    fits = append_head(buffer, size, &used, commc_http_method_to_string(request->method)) &&
+           append_head(buffer, size, &used, " ") &&
+           append_head(buffer, size, &used, request->url.path) &&
+           append_head(buffer, size, &used, " HTTP/1.1\r\nHost: ") &&
+           append_head(buffer, size, &used, request->url.hostname) &&
+           append_head(buffer, size, &used, "\r\n");
+           
+    /* Add headers */
+    
+    for (i = 0; fits && i < request->header_count; i++) {
+    
+        fits = append_head(buffer, size, &used, request->headers[i].name) &&
+               append_head(buffer, size, &used, ": ") &&
+               append_head(buffer, size, &used, request->headers[i].value) &&
+               append_head(buffer, size, &used, "\r\n");
+               
+    }
+    
+    /* HTTP/1.1 connections persist unless a side says otherwise */
+    
+    if (fits && !client->keep_alive) {
+    
+        fits = append_head(buffer, size, &used, "Connection: close\r\n");
+        
+    }
+    
+    /* Offer the codings the client decodes, unless the request picked its own */
+    
+    if (fits && client->decompress && !request_has_header(request, "Accept-Encoding")) {
+    
+        fits = append_head(buffer, size, &used, "Accept-Encoding: gzip, deflate\r\n");
+        
+    }
+    
+    if (fits && gzipped) {
+    
+        fits = append_head(buffer, size, &used, "Content-Encoding: gzip\r\n") &&
+               append_head(buffer, size, &used, "Transfer-Encoding: chunked\r\n");
+               
+    } else if (fits && body_length > 0) {
+    
+        /* Add body length if present */
+        
+        sprintf(number, "%lu", (unsigned long)body_length);
+        
+        fits = append_head(buffer, size, &used, "Content-Length: ") &&
+               append_head(buffer, size, &used, number) &&
+               append_head(buffer, size, &used, "\r\n");
+               
+    }
+    
+    if (fits) {
+    
+        fits = append_head(buffer, size, &used, "\r\n");
+        
+    }
+    
+    return fits ? used : 0;
+    
+}
+
+/*
+
+         send_request()
+	       ---
+	       writes the request line, headers and body. the
+	       head and an in-memory body go out in one
+	       gathered send; a file body goes straight from
+	       the file, and a body the client's threshold
+	       gzips in chunks as it is compressed, both
+	       behind a corked head.
+
+*/
+
+static commc_error_t send_request(commc_http_client_t*  client,
+                                  commc_socket_t*       connection,
+                                  commc_http_request_t* request) {
+
+    char                   request_buffer[HTTP_REQUEST_BUFFER_SIZE];
+    commc_socket_iovec_t   pieces[2];
+    commc_socket_options_t options;
+    commc_error_t          result;
+    http_chunked_t*        chunked;
+    size_t                 body_length;
+    size_t                 bytes_sent;
+    size_t                 request_len;
+    int                    has_file;
+    int                    gzipped;
+    
+    has_file    = request->body_file >= 0;
+    gzipped     = compresses_body(client, request);
+    body_length = has_file ? request->body_file_length :
+                  (request->body ? request->body_length : 0);
+    
+    request_len = format_request_head(client, request, body_length, gzipped,
+                                      request_buffer, sizeof(request_buffer));
+    
+    if (request_len == 0) {
+    
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        
+    }
+    
+    if ((has_file && body_length > 0) || gzipped) {
+    
+        commc_socket_get_options(connection, &options);
+        options.cork = 1;
+        commc_socket_set_options(connection, &options);
+        
+        result = commc_socket_send_all(connection, request_buffer, request_len);
+        
+        if (result == COMMC_SUCCESS && gzipped) {
+        
+            chunked = (http_chunked_t*)malloc(sizeof(http_chunked_t));
+            
+            if (chunked) {
+            
+                chunked->socket = connection;
+                chunked->queue  = NULL;
+                
+                result = send_gzipped_body(chunked, request);
+                
+                free(chunked);
+                
+            } else {
+            
+                result = COMMC_MEMORY_ERROR;
+                
+            }
+            
+        } else if (result == COMMC_SUCCESS) {
+        
+            result = commc_socket_send_file(connection, request->body_file,
+                                            request->body_file_offset,
+                                            body_length, &bytes_sent);
+                                            
+            if (result == COMMC_SUCCESS && bytes_sent < body_length) {
+            
+                result = COMMC_IO_ERROR;    /* file shrank under us */
+                
+            }
+            
+        }
+        
+        options.cork = 0;
+        commc_socket_set_options(connection, &options);
+        
+        return result;
+        
+    }
+    
+    pieces[0].base   = request_buffer;
+    pieces[0].length = request_len;
+    pieces[1].base   = request->body;
+    pieces[1].length = body_length;
+    
+    return commc_socket_sendv_all(connection, pieces, body_length > 0 ? 2 : 1);
+    
+}
+
+/*
+
+         copy_head()
+	       ---
+	       copies a parsed status line and the header
+	       fields that fit the fixed-size fields into
+	       response.
+
+*/
+
+static void copy_head(const commc_http_parser_t* parser,
+                      commc_http_response_t*     response) {
+
+    const commc_http_header_view_t* view;
+    commc_http_header_t*            header;
+    size_t                          length;
+    size_t                          i;
+    
+    response->version     = parser->minor_version == 0 ? COMMC_HTTP_VERSION_1_0 :
+                                                         COMMC_HTTP_VERSION_1_1;
+    response->status_code = parser->status_code;
+    
+    length = parser->reason_length < sizeof(response->status_message) - 1 ?
+             parser->reason_length : sizeof(response->status_message) - 1;
+             
+    memcpy(response->status_message, parser->reason, length);
+    response->status_message[length] = '\0';
+    
+    response->header_count = 0;
+    
+    for (i = 0; i < parser->header_count && response->header_count < COMMC_HTTP_MAX_HEADERS; i++) {
+    
+        view   = &parser->headers[i];
+        header = &response->headers[response->header_count];
+        
+        if (view->name_length >= sizeof(header->name) ||
+            view->value_length >= sizeof(header->value)) {
+            
+            continue;
+            
+        }
+        
+        memcpy(header->name, view->name, view->name_length);
+        header->name[view->name_length] = '\0';
+        
+        memcpy(header->value, view->value, view->value_length);
+        header->value[view->value_length] = '\0';
+        
+        response->header_count++;
+        
+    }
+    
+}
+
+/*
+
+         receive_head()
+	       ---
+	       parses a status line and headers in place in the
+	       reader's buffer, receiving until they are
+	       complete, and copies them into response. sets
+	       *replied as soon as any of the reply has arrived.
+
+*/
+
+static commc_error_t receive_head(commc_bufreader_t*     reader,
+                                  commc_http_response_t* response,
+                                  int*                   replied) {
+
+    commc_http_parser_t parser;
+    const char*         data;
+    size_t              available;
+    commc_error_t       result;
+    
+    commc_http_parser_init(&parser, COMMC_HTTP_PARSER_RESPONSE);
+    
+    for (;;) {
+    
+        available = commc_bufreader_data(reader, &data);
+        
+        if (available > 0) {
+        
+            *replied = 1;
+            result   = commc_http_parser_execute(&parser, data, available);
+            
+            if (result != COMMC_ERROR_WOULD_BLOCK) {
+            
+                break;
+                
+            }
+            
+        }
+        
+        result = commc_bufreader_fill(reader);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+    }
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    copy_head(&parser, response);
+    
+    commc_bufreader_consume(reader, parser.head_length);
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         connection_reusable()
+	       ---
+	       decides from the request and the response head
+	       whether the connection may carry another
+	       request once this response has been read.
+
+*/
+
+static int connection_reusable(commc_http_client_t*   client,
+                               commc_http_request_t*  request,
+                               commc_http_response_t* response) {
+
+    const char* value;
+    long        parameter;
+    int         reusable;
+    int         i;
+    
+    reusable = client->keep_alive && response->status_code != 101;
+    
+    value = commc_http_response_get_header(response, "Connection");
+    
+    if (response->version == COMMC_HTTP_VERSION_1_0) {
+    
+        reusable = reusable && value && header_has_token(value, "keep-alive");
+        
+    } else if (value && header_has_token(value, "close")) {
+    
+        reusable = 0;
+        
+    }
+    
+    value = commc_http_response_get_header(response, "Keep-Alive");
+    
+    if (value) {
+    
+        parameter = keep_alive_parameter(value, "timeout");
+        
+        if (parameter == 0) {
+        
+            reusable = 0;
+            
+        }
+        
+        parameter = keep_alive_parameter(value, "max");
+        
+        if (parameter == 0) {
+        
+            reusable = 0;
+            
+        }
+        
+    }
+    
+    for (i = 0; i < request->header_count; i++) {
+    
+        if (header_has_token(request->headers[i].name, "Connection") &&
+            header_has_token(request->headers[i].value, "close")) {
+            
+            reusable = 0;
+            
+        }
+        
+    }
+    
+    return reusable;
+    
+}
+
+/*
+
+         body_framing()
+	       ---
+	       tells how the body after a response head ends:
+	       not at all (HEAD, 1xx, 204, 304), by chunked
+	       encoding, after Content-Length bytes (stored in
+	       *length) or at the end of the connection.
+
+*/
+
+static http_framing_t body_framing(commc_http_request_t*  request,
+                                   commc_http_response_t* response,
+                                   size_t*                length) {
+
+    char*         end;
+    const char*   value;
+    unsigned long content_length;
+    
+    *length = 0;
+    
+    if (request->method == COMMC_HTTP_HEAD || response->status_code < 200 ||
+        response->status_code == 204 || response->status_code == 304) {
+    
+        return HTTP_BODY_NONE;
+        
+    }
+    
+    value = commc_http_response_get_header(response, "Transfer-Encoding");
+    
+    if (value && header_has_token(value, "chunked")) {
+    
+        return HTTP_BODY_CHUNKED;
+        
+    }
+    
+    value = commc_http_response_get_header(response, "Content-Length");
+    
+    if (!value) {
+    
+        return HTTP_BODY_UNTIL_CLOSE;
+        
+    }
+    
+    content_length = strtoul(value, &end, 10);
+    
+    while (*end == ' ' || *end == '\t') {
+    
+        end++;
+        
+    }
+    
+    if (end == value || *end != '\0' || value[0] == '-') {
+    
+        return HTTP_BODY_INVALID;
+        
+    }
+    
+    *length = (size_t)content_length;
+    
+    return HTTP_BODY_LENGTH;
+    
+}
+
+/*
+
+         receive_response()
+	       ---
+	       reads the status line and headers of one
+	       response, skipping interim 1xx responses, and
+	       streams its body to callback, decoded if it is
+	       gzip or deflate coded. sets
+	       *replied once any of the reply has arrived, and
+	       *reusable if the connection ended exactly at
+	       the end of the response and neither side asked
+	       to close it.
+
+*/
+
+static commc_error_t receive_response(commc_http_client_t*       client,
+                                      commc_bufreader_t*         reader,
+                                      commc_http_request_t*      request,
+                                      commc_http_response_t*     response,
+                                      commc_http_body_callback_t callback,
+                                      void*                      user_data,
+                                      int*                       replied,
+                                      int*                       reusable) {
+
+    http_decoding_t decoding;
+    http_framing_t  framing;
+    size_t          length;
+    commc_error_t   result;
+    commc_error_t   status;
+    
+    *replied  = 0;
+    *reusable = 0;
+    
+    do {
+    
+        result = receive_head(reader, response, replied);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+    } while (response->status_code >= 100 && response->status_code < 200 &&
+             response->status_code != 101);
+             
+    /* Decide whether the connection outlives this response */
+    
+    *reusable = connection_reusable(client, request, response);
+    
+    framing = body_framing(request, response, &length);
+    
+    decoding.decoder = NULL;
+    
+    if (framing != HTTP_BODY_NONE && framing != HTTP_BODY_INVALID) {
+    
+        result = start_decoding(&decoding, client, request, response, callback, user_data);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+        if (decoding.decoder) {
+        
+            callback  = decode_body;
+            user_data = &decoding;
+            
+        }
+        
+    }
+    
+    /* Receive body */
+    
+    switch (framing) {
+    
+        case HTTP_BODY_NONE:
+        
+            result = COMMC_SUCCESS;
+            break;
+            
+        case HTTP_BODY_CHUNKED:
+        
+            result = stream_chunked_body(reader, callback, user_data);
+            break;
+            
+        case HTTP_BODY_LENGTH:
+        
+            result = stream_body(reader, length, 0, callback, user_data);
+            break;
+            
+        case HTTP_BODY_UNTIL_CLOSE:
+        
+            *reusable = 0;
+            result = stream_body(reader, 0, 1, callback, user_data);
+            break;
+            
+        default:
+        
+            result = COMMC_FORMAT_ERROR;
+            break;
+            
+    }
+    
+    status = finish_decoding(&decoding);
+    
+    if (result == COMMC_SUCCESS) {
+    
+        result = status;
+        
+    }
+    
+    if (result != COMMC_SUCCESS) {
+    
+        *reusable = 0;
+        return result;
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         execute_request()
+	       ---
+	       sends a request over a pooled connection and
+	       streams the response body to callback. a
+	       request that fails before any reply arrived is
+	       sent once more on another connection when
+	       repeating it is safe, since the likely cause is
+	       a kept-alive connection the server closed just
+	       as it was reused.
+
+*/
+
+static commc_error_t execute_request(commc_http_client_t*       client,
+                                     commc_http_request_t*      request,
+                                     commc_http_response_t*     response,
+                                     commc_http_body_callback_t callback,
+                                     void*                      user_data) {
+
+    commc_socket_t*    connection;
+    commc_bufreader_t* reader;
+    const char*        unread;
+    commc_error_t      result;
+    int                replied;
+    int                reusable;
+    int                attempt;
+    
+    for (attempt = 0; ; attempt++) {
+    
+        reset_response(response);
+        
+        replied  = 0;
+        reusable = 0;
+        
+        result = acquire_connection(client, request, &connection);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+        result = send_request(client, connection, request);
+        
+        if (result == COMMC_SUCCESS) {
+        
+            result = commc_bufreader_create(&reader, connection, HTTP_RESPONSE_BUFFER_SIZE, 0);
+            
+            if (result == COMMC_SUCCESS) {
+            
+                result = receive_response(client, reader, request, response,
+                                          callback, user_data, &replied, &reusable);
+                                          
+                /* Bytes past the response mean the framing was off */
+                
+                if (commc_bufreader_data(reader, &unread) > 0) {
+                
+                    reusable = 0;
+                    
+                }
+                
+                commc_bufreader_destroy(reader);
+                
+            }
+            
+        }
+        
+        commc_socketpool_release(client->pool, connection,
+                                 result == COMMC_SUCCESS && reusable);
+                                 
+        if (result == COMMC_SUCCESS || replied || attempt > 0 ||
+            result == COMMC_ERROR_TIMEOUT || result == COMMC_MEMORY_ERROR ||
+            request->method == COMMC_HTTP_POST || request->method == COMMC_HTTP_PATCH) {
+            
+            return result;
+            
+        }
+        
+    }
+    
+}
+
+
+/* 
+	==================================
+             --- CORE ---
+	==================================
+*/
+
+/*
+
+         commc_http_client_create()
+	       ---
+	       creates and initializes a new HTTP client.
+
+*/
+
+commc_error_t commc_http_client_create(commc_http_client_t** client) {
+
+    commc_http_client_t* new_client;
+    
+    if (!client) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    new_client = malloc(sizeof(commc_http_client_t));
+    
+    if (!new_client) {
+    
+        return COMMC_MEMORY_ERROR;
+        
+    }
+    
+    /* Initialize client */
+    
+    memset(new_client, 0, sizeof(commc_http_client_t));
+    
+    new_client->socket_fd = COMMC_INVALID_SOCKET;
+    strcpy(new_client->user_agent, "COMMC-HTTP/1.0");
+    new_client->connection_timeout = COMMC_HTTP_DEFAULT_TIMEOUT;
+    new_client->request_timeout = COMMC_HTTP_DEFAULT_TIMEOUT;
+    new_client->keep_alive = 1;
+    new_client->decompress = 1;
+    new_client->follow_redirects = 1;
+    new_client->max_redirects = 5;
+    
+    if (commc_socketpool_create(&new_client->pool, 0,
+                                COMMC_HTTP_KEEPALIVE_IDLE_MS) != COMMC_SUCCESS) {
+    
+        free(new_client);
+        return COMMC_MEMORY_ERROR;
+        
+    }
+    
+    *client = new_client;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_http_client_destroy()
+	       ---
+	       destroys an HTTP client and frees resources.
+
+*/
+
+void commc_http_client_destroy(commc_http_client_t* client) {
+
+    if (!client) {
+    
+        return;
+        
+    }
+    
+    /* Close socket if open */
+    
+    if (client->socket_fd != COMMC_INVALID_SOCKET) {
+    
+        close(client->socket_fd);
+        
+    }
+    
+    /* Close kept-alive connections */
+    
+    commc_socketpool_destroy(client->pool);
+    
+    free(client);
+    
+}
+
+/*
+
+         commc_http_client_set_keep_alive()
+	       ---
+	       turns connection reuse on or off.
+
+*/
+
+commc_error_t commc_http_client_set_keep_alive(commc_http_client_t* client,
+                                                int                  enabled) {
+
+    if (!client) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    client->keep_alive = enabled ? 1 : 0;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_http_client_set_compression()
+	       ---
+	       sets the Content-Encoding policy.
+
+*/
+
+commc_error_t commc_http_client_set_compression(commc_http_client_t* client,
+                                                 int                  decompress,
+                                                 size_t               request_threshold) {
+
     if (!client) {
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    client->decompress         = decompress ? 1 : 0;
+    client->compress_threshold = request_threshold;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_http_request_create()
+	       ---
+	       creates and initializes a new HTTP request.
+
+*/
+
+commc_error_t commc_http_request_create(commc_http_request_t** request) {
+
+    commc_http_request_t* new_request;
+    
+    if (!request) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    new_request = malloc(sizeof(commc_http_request_t));
+    
+    if (!new_request) {
+    
+        return COMMC_MEMORY_ERROR;
+        
+    }
+    
+    /* Initialize request */
+    
+    memset(new_request, 0, sizeof(commc_http_request_t));
+    
+    new_request->method = COMMC_HTTP_GET;
+    new_request->version = COMMC_HTTP_VERSION_1_1;
+    new_request->timeout_seconds = COMMC_HTTP_DEFAULT_TIMEOUT;
+    new_request->follow_redirects = 1;
+    new_request->max_redirects = 5;
+    new_request->body_file = -1;
+    
+    *request = new_request;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_http_request_destroy()
+	       ---
+	       destroys an HTTP request and frees memory.
+
+*/
+
+void commc_http_request_destroy(commc_http_request_t* request) {
+
+    if (!request) {
+    
+        return;
+        
+    }
+    
+    if (request->body) {
+    
+        free(request->body);
+        
+    }
+    
+    free(request);
+    
+}
+
+/*
+
+         commc_http_response_create()
+	       ---
+	       creates and initializes a new HTTP response.
+
+*/
+
+commc_error_t commc_http_response_create(commc_http_response_t** response) {
+
+    commc_http_response_t* new_response;
+    
+    if (!response) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    new_response = malloc(sizeof(commc_http_response_t));
+    
+    if (!new_response) {
+    
+        return COMMC_MEMORY_ERROR;
+        
+    }
+    
+    /* Initialize response */
+    
+    memset(new_response, 0, sizeof(commc_http_response_t));
+    
+    new_response->version = COMMC_HTTP_VERSION_1_1;
+    
+    *response = new_response;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_http_response_destroy()
+	       ---
+	       destroys an HTTP response and frees memory.
+
+*/
+
+void commc_http_response_destroy(commc_http_response_t* response) {
+
+    if (!response) {
+    
+        return;
+        
+    }
+    
+    if (response->body) {
+    
+        free(response->body);
+        
+    }
+    
+    free(response);
+    
+}
+
+/*
+
+         commc_http_response_get_header()
+	       ---
+	       returns the value of the first header named
+	       header_name, compared without regard to case,
+	       or NULL.
+
+*/
+
+const char* commc_http_response_get_header(commc_http_response_t* response,
+                                           const char*            header_name) {
+
+    const char* a;
+    const char* b;
+    int         i;
+    
+    if (!response || !header_name) {
+    
+        return NULL;
+        
+    }
+    
+    for (i = 0; i < response->header_count; i++) {
+    
+        a = response->headers[i].name;
+        b = header_name;
+        
+        while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        
+            a++;
+            b++;
+            
+        }
+        
+        if (*a == '\0' && *b == '\0') {
+        
+            return response->headers[i].value;
+            
+        }
+        
+    }
+    
+    return NULL;
+    
+}
+
+/*
+
+         commc_http_url_parse()
+	       ---
+	       parses a URL string into component parts.
+
+*/
+
+commc_error_t commc_http_url_parse(const char*       url_string,
+                                   commc_http_url_t* parsed_url) {
+
+    const char* current;
+    const char* protocol_end;
+    const char* hostname_start;
+    const char* hostname_end;
+    const char* port_start;
+    const char* path_start;
+    const char* query_start;
+    const char* fragment_start;
+    char        port_str[8];
+    
+    if (!url_string || !parsed_url) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    /* Initialize parsed URL */
+    
+    memset(parsed_url, 0, sizeof(commc_http_url_t));
+    strcpy(parsed_url->path, "/");
+    parsed_url->port = COMMC_HTTP_DEFAULT_PORT;
+    
+    current = url_string;
+    
+    /* Extract protocol */
+    
+    protocol_end = strstr(current, "://");
+    
+    if (!protocol_end) {
+    
+        return COMMC_FORMAT_ERROR;
+        
+    }
+    
+    if ((size_t)(protocol_end - current) >= sizeof(parsed_url->protocol)) {
+    
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        
+    }
+    
+    memcpy(parsed_url->protocol, current, (size_t)(protocol_end - current));
+    parsed_url->protocol[protocol_end - current] = '\0';
+    
+    /* Set default port based on protocol */
+    
+    if (strcmp(parsed_url->protocol, "https") == 0) {
+    
+        parsed_url->port = COMMC_HTTP_DEFAULT_HTTPS_PORT;
+        
+    }
+    
+    /* Extract hostname */
+    
+    hostname_start = protocol_end + 3;
+    hostname_end = hostname_start;
+    
+    while (*hostname_end && *hostname_end != ':' && 
+           *hostname_end != '/' && *hostname_end != '?' && 
+           *hostname_end != '#') {
+        
+        hostname_end++;
+        
+    }
+    
+    if ((size_t)(hostname_end - hostname_start) >= sizeof(parsed_url->hostname)) {
+    
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        
+    }
+    
+    memcpy(parsed_url->hostname, hostname_start, (size_t)(hostname_end - hostname_start));
+    parsed_url->hostname[hostname_end - hostname_start] = '\0';
+    
+    current = hostname_end;
+    
+    /* Extract port if present */
+    
+    if (*current == ':') {
+    
+        port_start = current + 1;
+        current = port_start;
+        
+        while (*current && isdigit(*current)) {
+        
+            current++;
+            
+        }
+        
+        if ((size_t)(current - port_start) < sizeof(port_str)) {
+        
+            memcpy(port_str, port_start, (size_t)(current - port_start));
+            port_str[current - port_start] = '\0';
+            parsed_url->port = atoi(port_str);
+            
+        }
+        
+    }
+    
+    /* Extract path */
+    
+    if (*current == '/') {
+    
+        path_start = current;
+        
+        while (*current && *current != '?' && *current != '#') {
+        
+            current++;
+            
+        }
+        
+        if ((size_t)(current - path_start) < sizeof(parsed_url->path)) {
+        
+            memcpy(parsed_url->path, path_start, (size_t)(current - path_start));
+            parsed_url->path[current - path_start] = '\0';
+            
+        }
+        
+    }
+    
+    /* Extract query string */
+    
+    if (*current == '?') {
+    
+        query_start = current + 1;
+        current = query_start;
+        
+        while (*current && *current != '#') {
+        
+            current++;
+            
+        }
+        
+        if ((size_t)(current - query_start) < sizeof(parsed_url->query)) {
+        
+            memcpy(parsed_url->query, query_start, (size_t)(current - query_start));
+            parsed_url->query[current - query_start] = '\0';
+            
+        }
+        
+    }
+    
+    /* Extract fragment */
+    
+    if (*current == '#') {
+    
+        fragment_start = current + 1;
+        
+        if (strlen(fragment_start) < sizeof(parsed_url->fragment)) {
+        
+            strcpy(parsed_url->fragment, fragment_start);
+            
+        }
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_http_request_set_url()
+	       ---
+	       sets the target URL for the HTTP request.
+
+*/
+
+commc_error_t commc_http_request_set_url(commc_http_request_t* request,
+                                          const char*           url) {
+
+    if (!request || !url) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    return commc_http_url_parse(url, &request->url);
+    
+}
+
+/*
+
+         commc_http_request_add_header()
+	       ---
+	       adds a header to the HTTP request.
+
+*/
+
+commc_error_t commc_http_request_add_header(commc_http_request_t* request,
+                                             const char*           name,
+                                             const char*           value) {
+
+    commc_http_header_t* header;
+    
+    if (!request || !name || !value) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    if (request->header_count >= COMMC_HTTP_MAX_HEADERS) {
+    
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        
+    }
+    
+    header = &request->headers[request->header_count];
+    
+    if (strlen(name) >= sizeof(header->name) ||
+        strlen(value) >= sizeof(header->value)) {
+        
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        
+    }
+    
+    strcpy(header->name, name);
+    strcpy(header->value, value);
+    
+    request->header_count++;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_http_request_set_body()
+	       ---
+	       sets the request body content.
+
+*/
+
+commc_error_t commc_http_request_set_body(commc_http_request_t* request,
+                                           const char*           body,
+                                           size_t                body_length) {
+
+    if (!request || !body) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    /* Free existing body */
+    
+    if (request->body) {
+    
+        free(request->body);
+        
+    }
+    
+    /* Allocate new body */
+    
+    request->body = malloc(body_length + 1);
+    
+    if (!request->body) {
+    
+        return COMMC_MEMORY_ERROR;
+        
+    }
+    
+    memcpy(request->body, body, body_length);
+    request->body[body_length] = '\0';
+    request->body_length = body_length;
+    request->body_file = -1;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_http_request_set_body_file()
+	       ---
+	       sets a file range as the request body, replacing
+	       any in-memory body.
+
+*/
+
+commc_error_t commc_http_request_set_body_file(commc_http_request_t* request,
+                                                int                   file_handle,
+                                                size_t                offset,
+                                                size_t                length) {
+
+    if (!request || file_handle < 0) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    if (request->body) {
+    
+        free(request->body);
+        request->body = NULL;
+        
+    }
+    
+    request->body_length      = 0;
+    request->body_file        = file_handle;
+    request->body_file_offset = offset;
+    request->body_file_length = length;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_http_method_to_string()
+	       ---
+	       converts an HTTP method to its string representation.
+
+*/
+
+const char* commc_http_method_to_string(commc_http_method_t method) {
+
+    if (method >= 0 && method < (int)(sizeof(http_method_strings) / sizeof(char*))) {
+    
+        return http_method_strings[method];
+        
+    }
+    
+    return "GET";
+    
+}
+
+/*
+
+         commc_http_get()
+	       ---
+	       convenience function for simple GET requests.
+
+*/
+
+commc_error_t commc_http_get(const char*            url,
+                              commc_http_response_t* response) {
+
+    commc_http_client_t*  client = NULL;
+    commc_http_request_t* request = NULL;
+    commc_error_t         result;
+    
+    if (!url || !response) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    /* Create client and request */
+    
+    result = commc_http_client_create(&client);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    result = commc_http_request_create(&request);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        commc_http_client_destroy(client);
+        return result;
+        
+    }
+    
+    /* Set up request */
+    
+    result = commc_http_request_set_url(request, url);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        commc_http_request_destroy(request);
+        commc_http_client_destroy(client);
+        return result;
+        
+    }
+    
+    /* Execute request */
+    
+    result = commc_http_client_execute(client, request, response);
+    
+    /* Cleanup */
+    
+    commc_http_request_destroy(request);
+    commc_http_client_destroy(client);
+    
+    return result;
+    
+}
+
+/*
+
+         commc_http_client_execute()
+	       ---
+	       executes an HTTP request, collecting the body in
+	       response->body.
+
+*/
+
+commc_error_t commc_http_client_execute(commc_http_client_t*   client,
+                                         commc_http_request_t*  request,
+                                         commc_http_response_t* response) {
+
+    commc_error_t result;
+    
+    if (!client || !request || !response) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    result = execute_request(client, request, response, append_body, response);
+    
+    if (result == COMMC_SUCCESS && !response->body) {
+    
+        /* Bodiless response: still hand back an empty string */
+        
+        result = append_body("", 0, response);
+        
+    }
+    
+    return result;
+    
+}
+
+/*
+
+         commc_http_client_execute_stream()
+	       ---
+	       executes an HTTP request, passing the body to
+	       callback piece by piece.
+
+*/
+
+commc_error_t commc_http_client_execute_stream(commc_http_client_t*       client,
+                                                commc_http_request_t*      request,
+                                                commc_http_response_t*     response,
+                                                commc_http_body_callback_t callback,
+                                                void*                      user_data) {
+
+    if (!client || !request || !response || !callback) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    return execute_request(client, request, response, callback, user_data);
+    
+}
+
+/*
+
+         commc_http_sink_file()
+	       ---
+	       body callback writing to a FILE*.
+
+*/
+
+commc_error_t commc_http_sink_file(const char* data, size_t length, void* user_data) {
+
+    if (!user_data) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    if (fwrite(data, 1, length, (FILE*)user_data) != length) {
+    
+        return COMMC_IO_ERROR;
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/* 
+	==================================
+     --- CONCURRENT EXECUTION ---
+	==================================
+*/
+
+static void multi_pump_host(http_multi_host_t* host);
+
+/*
+
+         multi_finish()
+	       ---
+	       completes a request: hands the result to its
+	       callback and frees the job.
+
+*/
+
+static void multi_finish(commc_http_multi_t* multi,
+                         http_multi_job_t*   job,
+                         commc_error_t       result) {
+
+    if (result == COMMC_SUCCESS && !job->response->body) {
+    
+        /* Bodiless response: still hand back an empty string */
+        
+        result = append_body("", 0, job->response);
+        
+    }
+    
+    multi->outstanding--;
+    
+    if (job->callback) {
+    
+        job->callback(job->request, job->response, result, job->user_data);
+        
+    }
+    
+    free(job);
+    
+}
+
+/*
+
+         multi_fail_queue()
+	       ---
+	       completes every request still waiting for a
+	       connection to host with result.
+
+*/
+
+static void multi_fail_queue(http_multi_host_t* host, commc_error_t result) {
+
+    http_multi_job_t* job;
+    http_multi_job_t* next;
+    
+    job = host->queue;
+    
+    host->queue      = NULL;
+    host->queue_tail = NULL;
+    host->queued     = 0;
+    
+    for (; job; job = next) {
+    
+        next = job->next;
+        multi_finish(host->multi, job, result);
+        
+    }
+    
+}
+
+/*
+
+         multi_repeatable()
+	       ---
+	       tells whether a request may be sent again after
+	       a connection was lost under it, or written
+	       behind unanswered requests.
+
+*/
+
+static int multi_repeatable(const commc_http_request_t* request) {
+
+    return request->method != COMMC_HTTP_POST &&
+           request->method != COMMC_HTTP_PATCH &&
+           request->body_file < 0;
+           
+}
+
+/*
+
+         multi_free_connection()
+	       ---
+	       gives a connection with nothing in flight back
+	       to the pool (kept alive if it ended cleanly)
+	       and frees it.
+
+*/
+
+static void multi_free_connection(http_multi_connection_t* connection) {
+
+    commc_http_multi_t* multi = connection->host->multi;
+    int                 reusable;
+    
+    reusable = connection->reusable && connection->job_count == 0 &&
+               connection->input_start == connection->input_end &&
+               connection->output_sent == connection->output_length &&
+               connection->file_remaining == 0;
+    
+    commc_async_timer_stop(multi->ctx, &connection->timer);
+    commc_async_remove_handle(multi->ctx, connection->socket->handle);
+    commc_socket_set_blocking(connection->socket, 1);
+    commc_socketpool_release(multi->client->pool, connection->socket, reusable);
+    
+    finish_decoding(&connection->decoding);
+    
+    free(connection->input);
+    free(connection->output);
+    free(connection);
+    
+}
+
+/*
+
+         multi_close_connection()
+	       ---
+	       takes a connection off its host and ends the
+	       requests on it. with result COMMC_SUCCESS they
+	       were never answered (an earlier response closed
+	       the connection) and go back to the queue;
+	       otherwise those the server had not started
+	       answering are queued again once if they are
+	       repeatable, and the rest fail with result. the
+	       connection is freed here if nothing is in
+	       flight, else by its cancelled operations'
+	       callbacks.
+
+*/
+
+static void multi_close_connection(http_multi_connection_t* connection,
+                                   commc_error_t            result) {
+
+    http_multi_host_t*  host  = connection->host;
+    commc_http_multi_t* multi = host->multi;
+    http_multi_job_t*   requeue;
+    http_multi_job_t*   requeue_tail;
+    http_multi_job_t*   job;
+    http_multi_job_t*   next;
+    size_t              requeued;
+    
+    if (connection->closing) {
+    
+        return;
         
     }
     
-    new_client = malloc(sizeof(commc_http_client_t));
+    connection->closing = 1;
+    commc_async_timer_stop(multi->ctx, &connection->timer);
     
-    if (!new_client) {
+    if (connection->prev) {
     
-        return COMMC_MEMORY_ERROR;
+        connection->prev->next = connection->next;
+        
+    } else {
+    
+        host->connections = connection->next;
         
     }
     
-    /* Initialize client */
+    if (connection->next) {
     
-    memset(new_client, 0, sizeof(commc_http_client_t));
+        connection->next->prev = connection->prev;
+        
+    }
     
-    new_client->socket_fd = COMMC_INVALID_SOCKET;
-    strcpy(new_client->user_agent, "COMMC-HTTP/1.0");
-    new_client->connection_timeout = COMMC_HTTP_DEFAULT_TIMEOUT;
-    new_client->request_timeout = COMMC_HTTP_DEFAULT_TIMEOUT;
-    new_client->follow_redirects = 1;
-    new_client->max_redirects = 5;
+    host->connection_count--;
+    
+    job = connection->jobs;
+    
+    connection->jobs      = NULL;
+    connection->jobs_tail = NULL;
+    
+    if (job) {
+    
+        connection->reusable = 0;
+        
+    }
+    
+    if (connection->pending == 0) {
+    
+        multi_free_connection(connection);
+        
+    } else {
+    
+        connection->reusable = 0;
+        commc_async_cancel(multi->ctx, connection->socket->handle);
+        
+    }
+    
+    /* Unanswered requests go back to the front, in order */
+    
+    requeue      = NULL;
+    requeue_tail = NULL;
+    requeued     = 0;
+    
+    for (; job; job = next) {
+    
+        next      = job->next;
+        job->next = NULL;
+        
+        if (!multi->destroying &&
+            (result == COMMC_SUCCESS ||
+             (!job->replied && !job->retried && multi_repeatable(job->request) &&
+              result != COMMC_ERROR_TIMEOUT && result != COMMC_MEMORY_ERROR))) {
+            
+            job->retried = job->retried || result != COMMC_SUCCESS;
+            job->replied = 0;
+            
+            reset_response(job->response);
+            
+            if (requeue_tail) {
+            
+                requeue_tail->next = job;
+                
+            } else {
+            
+                requeue = job;
+                
+            }
+            
+            requeue_tail = job;
+            requeued++;
+            
+            continue;
+            
+        }
+        
+        multi_finish(multi, job, result == COMMC_SUCCESS ? COMMC_ERROR_INVALID_STATE : result);
+        
+    }
+    
+    if (requeue) {
+    
+        requeue_tail->next = host->queue;
+        host->queue        = requeue;
+        
+        if (!host->queue_tail) {
+        
+            host->queue_tail = requeue_tail;
+            
+        }
+        
+        host->queued += requeued;
+        
+    }
+    
+}
+
+/*
+
+         multi_timeout_done()
+	       ---
+	       fails the requests on a connection whose server
+	       stopped responding.
+
+*/
+
+static void multi_timeout_done(const commc_async_result_t* result) {
+
+    http_multi_connection_t* connection = (http_multi_connection_t*)result->user_data;
+    http_multi_host_t*       host       = connection->host;
+    
+    multi_close_connection(connection, COMMC_ERROR_TIMEOUT);
+    multi_pump_host(host);
+    
+}
+
+/*
+
+         multi_complete()
+	       ---
+	       completes the oldest request on a connection
+	       and readies the parser for the next response.
+	       fails, completing nothing, if the body's coded
+	       stream did not end with it.
+
+*/
+
+static commc_error_t multi_complete(http_multi_connection_t* connection) {
+
+    http_multi_job_t* job = connection->jobs;
+    commc_error_t     result;
+    
+    result = finish_decoding(&connection->decoding);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    connection->jobs = job->next;
+    
+    if (!connection->jobs) {
+    
+        connection->jobs_tail = NULL;
+        
+    }
+    
+    connection->job_count--;
+    connection->stage       = HTTP_MULTI_HEAD;
+    connection->until_close = 0;
+    connection->remaining   = 0;
+    
+    multi_finish(connection->host->multi, job, COMMC_SUCCESS);
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         multi_take_line()
+	       ---
+	       finds the line at the start of the unprocessed
+	       input, NUL-terminates it in place (CR dropped)
+	       and consumes it. returns NULL if no full line
+	       has arrived.
+
+*/
+
+static char* multi_take_line(http_multi_connection_t* connection,
+                             size_t*                  length) {
+
+    char*  line = connection->input + connection->input_start;
+    char*  end;
+    size_t available = connection->input_end - connection->input_start;
+    
+    end = memchr(line, '\n', available);
+    
+    if (!end) {
+    
+        return NULL;
+        
+    }
+    
+    connection->input_start += (size_t)(end - line) + 1;
+    
+    if (end > line && end[-1] == '\r') {
+    
+        end--;
+        
+    }
+    
+    *end    = '\0';
+    *length = (size_t)(end - line);
+    
+    return line;
+    
+}
+
+/*
+
+         multi_process_input()
+	       ---
+	       works through the received bytes: response
+	       heads, bodies and chunk framing, completing
+	       requests as their responses end. stops at the
+	       end of a response that closes the connection.
+
+*/
+
+static commc_error_t multi_process_input(http_multi_connection_t* connection) {
+
+    commc_http_client_t*   client = connection->host->multi->client;
+    commc_http_response_t* response;
+    http_multi_job_t*      job;
+    const char*            data;
+    char*                  line;
+    char*                  end;
+    size_t                 available;
+    size_t                 length;
+    unsigned long          chunk_size;
+    http_framing_t         framing;
+    commc_error_t          result;
+    
+    while (connection->jobs && (connection->reusable || connection->stage != HTTP_MULTI_HEAD)) {
+    
+        job       = connection->jobs;
+        response  = job->response;
+        data      = connection->input + connection->input_start;
+        available = connection->input_end - connection->input_start;
+        
+        switch (connection->stage) {
+        
+            case HTTP_MULTI_HEAD:
+            
+                if (available == 0) {
+                
+                    return COMMC_SUCCESS;
+                    
+                }
+                
+                job->replied = 1;
+                
+                if (!connection->parsing) {
+                
+                    commc_http_parser_init(&connection->parser, COMMC_HTTP_PARSER_RESPONSE);
+                    connection->parsing = 1;
+                    
+                }
+                
+                result = commc_http_parser_execute(&connection->parser, data, available);
+                
+                if (result == COMMC_ERROR_WOULD_BLOCK) {
+                
+                    return available >= HTTP_MULTI_MAX_HEAD ?
+                           COMMC_ERROR_BUFFER_TOO_SMALL : COMMC_SUCCESS;
+                           
+                }
+                
+                connection->parsing = 0;
+                
+                if (result != COMMC_SUCCESS) {
+                
+                    return result;
+                    
+                }
+                
+                copy_head(&connection->parser, response);
+                connection->input_start += connection->parser.head_length;
+                
+                /* Interim responses precede the real one */
+                
+                if (response->status_code >= 100 && response->status_code < 200 &&
+                    response->status_code != 101) {
+                    
+                    break;
+                    
+                }
+                
+                if (!connection_reusable(client, job->request, response)) {
+                
+                    connection->reusable = 0;
+                    
+                }
+                
+                framing = body_framing(job->request, response, &connection->remaining);
+                
+                if (framing != HTTP_BODY_NONE && framing != HTTP_BODY_INVALID) {
+                
+                    result = start_decoding(&connection->decoding, client, job->request,
+                                            response, append_body, response);
+                                            
+                    if (result != COMMC_SUCCESS) {
+                    
+                        return result;
+                        
+                    }
+                    
+                }
+                
+                result = COMMC_SUCCESS;
+                
+                switch (framing) {
+                
+                    case HTTP_BODY_NONE:
+                    
+                        result = multi_complete(connection);
+                        break;
+                        
+                    case HTTP_BODY_CHUNKED:
+                    
+                        connection->stage = HTTP_MULTI_CHUNK_SIZE;
+                        break;
+                        
+                    case HTTP_BODY_LENGTH:
+                    
+                        connection->stage = HTTP_MULTI_BODY;
+                        
+                        if (connection->remaining == 0) {
+                        
+                            result = multi_complete(connection);
+                            
+                        }
+                        
+                        break;
+                        
+                    case HTTP_BODY_UNTIL_CLOSE:
+                    
+                        connection->stage       = HTTP_MULTI_BODY;
+                        connection->until_close = 1;
+                        break;
+                        
+                    default:
+                    
+                        return COMMC_FORMAT_ERROR;
+                        
+                }
+                
+                if (result != COMMC_SUCCESS) {
+                
+                    return result;
+                    
+                }
+                
+                break;
+                
+            case HTTP_MULTI_BODY:
+            case HTTP_MULTI_CHUNK_DATA:
+            
+                if (available == 0) {
+                
+                    return COMMC_SUCCESS;
+                    
+                }
+                
+                if (!connection->until_close && available > connection->remaining) {
+                
+                    available = connection->remaining;
+                    
+                }
+                
+                if (connection->decoding.decoder) {
+                
+                    result = decode_body(data, available, &connection->decoding);
+                    
+                } else {
+                
+                    result = append_body(data, available, response);
+                    
+                }
+                
+                if (result != COMMC_SUCCESS) {
+                
+                    return result;
+                    
+                }
+                
+                connection->input_start += available;
+                
+                if (connection->until_close) {
+                
+                    break;
+                    
+                }
+                
+                connection->remaining -= available;
+                
+                if (connection->remaining == 0) {
+                
+                    if (connection->stage == HTTP_MULTI_BODY) {
+                    
+                        result = multi_complete(connection);
+                        
+                        if (result != COMMC_SUCCESS) {
+                        
+                            return result;
+                            
+                        }
+                        
+                    } else {
+                    
+                        connection->stage = HTTP_MULTI_CHUNK_END;
+                        
+                    }
+                    
+                }
+                
+                break;
+                
+            default:
+            
+                /* Size lines, chunk ends and trailers */
+                
+                line = multi_take_line(connection, &length);
+                
+                if (!line) {
+                
+                    return available > HTTP_LINE_BUFFER_SIZE ? COMMC_FORMAT_ERROR : COMMC_SUCCESS;
+                    
+                }
+                
+                if (connection->stage == HTTP_MULTI_CHUNK_SIZE) {
+                
+                    chunk_size = strtoul(line, &end, 16);
+                    
+                    if (end == line || (*end != '\0' && *end != ';' && *end != ' ' && *end != '\t')) {
+                    
+                        return COMMC_FORMAT_ERROR;
+                        
+                    }
+                    
+                    connection->remaining = (size_t)chunk_size;
+                    connection->stage     = chunk_size == 0 ? HTTP_MULTI_TRAILER :
+                                                              HTTP_MULTI_CHUNK_DATA;
+                                                              
+                } else if (connection->stage == HTTP_MULTI_CHUNK_END) {
+                
+                    if (length != 0) {
+                    
+                        return COMMC_FORMAT_ERROR;
+                        
+                    }
+                    
+                    connection->stage = HTTP_MULTI_CHUNK_SIZE;
+                    
+                } else if (length == 0) {
+                
+                    result = multi_complete(connection);
+                    
+                    if (result != COMMC_SUCCESS) {
+                    
+                        return result;
+                        
+                    }
+                    
+                }
+                
+                break;
+                
+        }
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         multi_io_done()
+	       ---
+	       completion of a connection's send, sendfile or
+	       receive.
+
+*/
+
+static void multi_io_done(const commc_async_result_t* result) {
+
+    http_multi_connection_t* connection = (http_multi_connection_t*)result->user_data;
+    http_multi_host_t*       host       = connection->host;
+    commc_error_t            status;
+    
+    /*
+     * the operation stays counted (and its flag set) until the
+     * end, so completion callbacks that add requests can neither
+     * free the connection nor move its buffers under us
+     */
+    
+    if (!connection->closing) {
+    
+        status = COMMC_SUCCESS;
+        
+        if (result->error_code != 0) {
+        
+            status = COMMC_IO_ERROR;
+            
+        } else if (result->operation == COMMC_ASYNC_OP_RECV) {
+        
+            if (result->bytes_transferred == 0) {
+            
+                /* A body without framing ends here, unanswering the rest */
+                
+                status = COMMC_SUCCESS;
+                
+                if (connection->jobs && connection->until_close) {
+                
+                    status = multi_complete(connection);
+                    
+                } else if (connection->jobs) {
+                
+                    status = COMMC_ERROR_CONNECTION_CLOSED;
+                    
+                }
+                
+                connection->reusable = 0;
+                
+            } else {
+            
+                connection->input_end += result->bytes_transferred;
+                status = multi_process_input(connection);
+                
+            }
+            
+        } else if (result->operation == COMMC_ASYNC_OP_SEND) {
+        
+            connection->output_sent += result->bytes_transferred;
+            
+            if (connection->output_sent == connection->output_length) {
+            
+                connection->output_sent   = 0;
+                connection->output_length = 0;
+                
+            }
+            
+        } else {
+        
+            /* a short count means the file shrank under us */
+            
+            if (result->bytes_transferred < connection->file_remaining) {
+            
+                status = COMMC_IO_ERROR;
+                
+            }
+            
+            connection->file           = -1;
+            connection->file_remaining = 0;
+            
+        }
+        
+        if (status != COMMC_SUCCESS) {
+        
+            multi_close_connection(connection, status);
+            
+        } else if (!connection->reusable && connection->stage == HTTP_MULTI_HEAD) {
+        
+            /* The server closes after the last response; the rest go elsewhere */
+            
+            multi_close_connection(connection, COMMC_SUCCESS);
+            
+        }
+        
+    }
+    
+    connection->pending--;
+    host->multi->pending--;
+    
+    if (result->operation == COMMC_ASYNC_OP_RECV) {
+    
+        connection->receiving = 0;
+        
+    } else {
+    
+        connection->sending = 0;
+        
+    }
+    
+    if (connection->closing) {
     
-    *client = new_client;
+        if (connection->pending == 0) {
+        
+            multi_free_connection(connection);
+            
+        }
+        
+    }
     
-    return COMMC_SUCCESS;
+    multi_pump_host(host);
     
 }
 
 /*
 
-         commc_http_client_destroy()
+         multi_submit()
 	       ---
-	       destroys an HTTP client and frees resources.
+	       submits one operation for a connection and
+	       re-arms the timeout of its oldest request.
+	       returns 0 on failure.
 
 */
 
-void commc_http_client_destroy(commc_http_client_t* client) {
+static int multi_submit(http_multi_connection_t*     connection,
+                        commc_async_operation_type_t type,
+                        void*                        buffer,
+                        size_t                       length) {
 
-    if (!client) {
+    commc_http_multi_t*      multi = connection->host->multi;
+    commc_async_operation_t* op;
+    int                      failed;
     
-        return;
+    if (type == COMMC_ASYNC_OP_SENDFILE) {
+    
+        failed = commc_async_sendfile(multi->ctx, connection->socket->handle, connection->file,
+                                      connection->file_offset, connection->file_remaining,
+                                      multi_io_done, connection) != 0;
+                                      
+    } else {
+    
+        op = commc_async_operation_create(type, connection->socket->handle, buffer, length);
+        
+        if (!op) {
+        
+            return 0;
+            
+        }
+        
+        op->callback  = multi_io_done;
+        op->user_data = connection;
+        
+        failed = commc_async_submit_operation(multi->ctx, op) != 0;
+        
+        if (failed) {
+        
+            commc_async_operation_destroy(op);
+            
+        }
         
     }
     
-    /* Close socket if open */
-    
-    if (client->socket_fd != COMMC_INVALID_SOCKET) {
+    if (failed) {
     
-        close(client->socket_fd);
-        cleanup_sockets();
+        return 0;
         
     }
     
-    free(client);
+    connection->pending++;
+    multi->pending++;
+    
+    if (connection->jobs && connection->jobs->request->timeout_seconds > 0) {
+    
+        commc_async_timer_start(multi->ctx, &connection->timer,
+                                (unsigned long)connection->jobs->request->timeout_seconds * 1000UL, 0);
+                                
+    }
+    
+    return 1;
     
 }
 
 /*
 
-         commc_http_request_create()
+         multi_reserve_input()
 	       ---
-	       creates and initializes a new HTTP request.
+	       makes room for one more receive behind the
+	       unprocessed input, moving it to the front of
+	       the buffer or growing it.
 
 */
 
-commc_error_t commc_http_request_create(commc_http_request_t** request) {
+static int multi_reserve_input(http_multi_connection_t* connection) {
 
-    commc_http_request_t* new_request;
+    size_t held = connection->input_end - connection->input_start;
+    char*  input;
     
-    if (!request) {
+    if (connection->input_start > 0) {
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+        memmove(connection->input, connection->input + connection->input_start, held);
+        
+        connection->input_start = 0;
+        connection->input_end   = held;
         
     }
     
-    new_request = malloc(sizeof(commc_http_request_t));
-    
-    if (!new_request) {
+    if (connection->input_capacity - held >= HTTP_MULTI_RECEIVE_SIZE) {
     
-        return COMMC_MEMORY_ERROR;
+        return 1;
         
     }
     
-    /* Initialize request */
+    input = realloc(connection->input, held + HTTP_MULTI_RECEIVE_SIZE);
     
-    memset(new_request, 0, sizeof(commc_http_request_t));
+    if (!input) {
     
-    new_request->method = COMMC_HTTP_GET;
-    new_request->version = COMMC_HTTP_VERSION_1_1;
-    new_request->timeout_seconds = COMMC_HTTP_DEFAULT_TIMEOUT;
-    new_request->follow_redirects = 1;
-    new_request->max_redirects = 5;
+        return 0;
+        
+    }
     
-    *request = new_request;
+    connection->input          = input;
+    connection->input_capacity = held + HTTP_MULTI_RECEIVE_SIZE;
     
-    return COMMC_SUCCESS;
+    return 1;
     
 }
 
 /*
 
-         commc_http_request_destroy()
+         multi_can_take()
 	       ---
-	       destroys an HTTP request and frees memory.
+	       tells whether job may be written to connection
+	       now: always to an idle one, and, within the
+	       pipeline depth, behind repeatable requests when
+	       it is repeatable itself and not being repeated.
 
 */
 
-void commc_http_request_destroy(commc_http_request_t* request) {
+static int multi_can_take(http_multi_connection_t* connection,
+                          http_multi_job_t*        job) {
 
-    if (!request) {
+    commc_http_multi_t* multi = connection->host->multi;
     
-        return;
+    /* The output buffer may not move under a send */
+    
+    if (connection->closing || !connection->reusable || connection->sending) {
+    
+        return 0;
         
     }
     
-    if (request->body) {
+    if (connection->job_count == 0) {
     
-        free(request->body);
+        return 1;
         
     }
     
-    free(request);
+    /* A repeated request travels alone */
     
+    return connection->job_count < multi->pipeline_depth && !job->retried &&
+           multi_repeatable(job->request) &&
+           multi_repeatable(connection->jobs_tail->request);
+           
 }
 
 /*
 
-         commc_http_response_create()
+         multi_assign()
 	       ---
-	       creates and initializes a new HTTP response.
+	       appends job's request to a connection's output
+	       and its job list.
 
 */
 
-commc_error_t commc_http_response_create(commc_http_response_t** response) {
+static commc_error_t multi_assign(http_multi_connection_t* connection,
+                                  http_multi_job_t*        job) {
 
-    commc_http_response_t* new_response;
-    
-    if (!response) {
+    commc_http_request_t* request = job->request;
+    char                  head[HTTP_REQUEST_BUFFER_SIZE];
+    http_chunked_t*       chunked;
+    size_t                start = connection->output_length;
+    size_t                head_length;
+    size_t                body_length;
+    commc_error_t         result;
+    int                   has_file;
+    int                   gzipped;
+    
+    has_file    = request->body_file >= 0;
+    gzipped     = compresses_body(connection->host->multi->client, request);
+    body_length = has_file ? request->body_file_length :
+                  (request->body ? request->body_length : 0);
+                  
+    head_length = format_request_head(connection->host->multi->client, request,
+                                      body_length, gzipped, head, sizeof(head));
+                                      
+    if (head_length == 0) {
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
         
     }
     
-    new_response = malloc(sizeof(commc_http_response_t));
+    result = queue_output(connection, head, head_length);
     
-    if (!new_response) {
+    if (result != COMMC_SUCCESS) {
     
-        return COMMC_MEMORY_ERROR;
+        return result;
         
     }
     
-    /* Initialize response */
+    if (gzipped) {
     
-    memset(new_response, 0, sizeof(commc_http_response_t));
+        /* The chunks are queued as the encoder produces them */
+        
+        chunked = (http_chunked_t*)malloc(sizeof(http_chunked_t));
+        
+        if (!chunked) {
+        
+            return COMMC_MEMORY_ERROR;
+            
+        }
+        
+        chunked->socket = NULL;
+        chunked->queue  = connection;
+        
+        result = send_gzipped_body(chunked, request);
+        
+        free(chunked);
+        
+    } else if (has_file) {
     
-    new_response->version = COMMC_HTTP_VERSION_1_1;
+        connection->file           = body_length > 0 ? request->body_file : -1;
+        connection->file_offset    = request->body_file_offset;
+        connection->file_remaining = body_length;
+        
+    } else if (body_length > 0) {
     
-    *response = new_response;
+        result = queue_output(connection, request->body, body_length);
+        
+    }
     
-    return COMMC_SUCCESS;
+    /* A request that failed half way leaves nothing behind */
     
-}
-
-/*
-
-         commc_http_response_destroy()
-	       ---
-	       destroys an HTTP response and frees memory.
-
-*/
-
-void commc_http_response_destroy(commc_http_response_t* response) {
-
-    if (!response) {
+    if (result != COMMC_SUCCESS) {
     
-        return;
+        connection->output_length = start;
+        return result;
         
     }
     
-    if (response->body) {
+    job->next = NULL;
     
-        free(response->body);
+    if (connection->jobs_tail) {
+    
+        connection->jobs_tail->next = job;
+        
+    } else {
+    
+        connection->jobs = job;
         
     }
     
-    free(response);
+    connection->jobs_tail = job;
+    connection->job_count++;
+    
+    return COMMC_SUCCESS;
     
 }
 
 /*
 
-         commc_http_url_parse()
+         multi_pump_connection()
 	       ---
-	       parses a URL string into component parts.
+	       moves queued requests of the host onto a
+	       connection, then keeps a send going while output
+	       is left and a receive going while responses are
+	       due. a connection left with nothing to do goes
+	       back to the pool.
 
 */
 
-commc_error_t commc_http_url_parse(const char*       url_string,
-                                   commc_http_url_t* parsed_url) {
+static void multi_pump_connection(http_multi_connection_t* connection) {
 
-    const char* current;
-    const char* protocol_end;
-    const char* hostname_start;
-    const char* hostname_end;
-    const char* port_start;
-    const char* path_start;
-    const char* query_start;
-    const char* fragment_start;
-    char        port_str[8];
+    http_multi_host_t* host = connection->host;
+    http_multi_job_t*  job;
+    commc_error_t      result;
+    int                submitted;
     
-    if (!url_string || !parsed_url) {
+    while (host->queue && multi_can_take(connection, host->queue)) {
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+        job = host->queue;
         
-    }
-    
-    /* Initialize parsed URL */
-    
-    memset(parsed_url, 0, sizeof(commc_http_url_t));
-    strcpy(parsed_url->path, "/");
-    parsed_url->port = COMMC_HTTP_DEFAULT_PORT;
-    
-    current = url_string;
-    
-    /* Extract protocol */
-    
-    protocol_end = strstr(current, "://");
-    
-    if (!protocol_end) {
-    
-        return COMMC_FORMAT_ERROR;
+        host->queue = job->next;
+        host->queued--;
+        
+        if (!host->queue) {
+        
+            host->queue_tail = NULL;
+            
+        }
+        
+        result = multi_assign(connection, job);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            multi_finish(host->multi, job, result);
+            
+        }
         
     }
     
-    if ((size_t)(protocol_end - current) >= sizeof(parsed_url->protocol)) {
+    if (connection->job_count == 0) {
     
-        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        if (!connection->sending && !connection->receiving) {
+        
+            multi_close_connection(connection, COMMC_SUCCESS);
+            
+        }
+        
+        return;
         
     }
     
-    memcpy(parsed_url->protocol, current, (size_t)(protocol_end - current));
-    parsed_url->protocol[protocol_end - current] = '\0';
-    
-    /* Set default port based on protocol */
+    submitted = 1;
     
-    if (strcmp(parsed_url->protocol, "https") == 0) {
+    if (!connection->sending) {
     
-        parsed_url->port = COMMC_HTTP_DEFAULT_HTTPS_PORT;
+        if (connection->output_sent < connection->output_length) {
+        
+            submitted = multi_submit(connection, COMMC_ASYNC_OP_SEND,
+                                     connection->output + connection->output_sent,
+                                     connection->output_length - connection->output_sent);
+            connection->sending = submitted;
+            
+        } else if (connection->file_remaining > 0) {
+        
+            submitted = multi_submit(connection, COMMC_ASYNC_OP_SENDFILE, NULL, 0);
+            connection->sending = submitted;
+            
+        }
         
     }
     
-    /* Extract hostname */
-    
-    hostname_start = protocol_end + 3;
-    hostname_end = hostname_start;
+    if (submitted && !connection->receiving) {
     
-    while (*hostname_end && *hostname_end != ':' && 
-           *hostname_end != '/' && *hostname_end != '?' && 
-           *hostname_end != '#') {
-        
-        hostname_end++;
+        submitted = multi_reserve_input(connection) &&
+                    multi_submit(connection, COMMC_ASYNC_OP_RECV,
+                                 connection->input + connection->input_end,
+                                 connection->input_capacity - connection->input_end);
+        connection->receiving = submitted;
         
     }
     
-    if ((size_t)(hostname_end - hostname_start) >= sizeof(parsed_url->hostname)) {
+    if (!submitted) {
     
-        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        multi_close_connection(connection, COMMC_SYSTEM_ERROR);
         
     }
     
-    memcpy(parsed_url->hostname, hostname_start, (size_t)(hostname_end - hostname_start));
-    parsed_url->hostname[hostname_end - hostname_start] = '\0';
-    
-    current = hostname_end;
+}
+
+/*
+
+         multi_acquire_done()
+	       ---
+	       a pooled connection for a host is ready (or
+	       could not be made).
+
+*/
+
+static void multi_acquire_done(commc_socketpool_t* pool,
+                               commc_socket_t*     socket,
+                               commc_error_t       status,
+                               void*               user_data) {
+
+    http_multi_host_t*       host  = (http_multi_host_t*)user_data;
+    commc_http_multi_t*      multi = host->multi;
+    http_multi_connection_t* connection;
     
-    /* Extract port if present */
+    host->acquiring--;
+    multi->pending--;
     
-    if (*current == ':') {
+    if (status != COMMC_SUCCESS) {
     
-        port_start = current + 1;
-        current = port_start;
+        /* Leave the queue to connections that did open */
         
-        while (*current && isdigit(*current)) {
+        if (host->connection_count == 0 && host->acquiring == 0) {
         
-            current++;
+            multi_fail_queue(host, status);
             
         }
         
-        if ((size_t)(current - port_start) < sizeof(port_str)) {
+        return;
         
-            memcpy(port_str, port_start, (size_t)(current - port_start));
-            port_str[current - port_start] = '\0';
-            parsed_url->port = atoi(port_str);
-            
-        }
+    }
+    
+    if (multi->destroying || !host->queue) {
+    
+        commc_socketpool_release(pool, socket, 1);
+        return;
         
     }
     
-    /* Extract path */
+    connection = calloc(1, sizeof(http_multi_connection_t));
     
-    if (*current == '/') {
+    if (!connection) {
     
-        path_start = current;
+        commc_socketpool_release(pool, socket, 1);
         
-        while (*current && *current != '?' && *current != '#') {
+        if (host->connection_count == 0 && host->acquiring == 0) {
         
-            current++;
+            multi_fail_queue(host, COMMC_MEMORY_ERROR);
             
         }
         
-        if ((size_t)(current - path_start) < sizeof(parsed_url->path)) {
+        return;
         
-            memcpy(parsed_url->path, path_start, (size_t)(current - path_start));
-            parsed_url->path[current - path_start] = '\0';
-            
-        }
+    }
+    
+    connection->host     = host;
+    connection->socket   = socket;
+    connection->reusable = 1;
+    connection->file     = -1;
+    connection->next     = host->connections;
+    
+    commc_async_timer_init(&connection->timer, multi_timeout_done, connection);
+    commc_socket_set_blocking(socket, 0);
+    
+    if (host->connections) {
+    
+        host->connections->prev = connection;
+        
+    }
+    
+    host->connections = connection;
+    host->connection_count++;
+    
+    multi_pump_host(host);
+    
+}
+
+/*
+
+         multi_pump_host()
+	       ---
+	       hands a host's queued requests to its
+	       connections and asks the pool for more
+	       connections while requests are left over and
+	       the limit allows. calls made while it runs (from
+	       completion callbacks adding requests) are folded
+	       into another round.
+
+*/
+
+static void multi_pump_host(http_multi_host_t* host) {
+
+    commc_http_multi_t*      multi = host->multi;
+    http_multi_connection_t* connection;
+    http_multi_connection_t* next;
+    
+    if (multi->destroying) {
+    
+        return;
         
     }
     
-    /* Extract query string */
-    
-    if (*current == '?') {
+    if (host->pumping) {
     
-        query_start = current + 1;
-        current = query_start;
-        
-        while (*current && *current != '#') {
-        
-            current++;
-            
-        }
-        
-        if ((size_t)(current - query_start) < sizeof(parsed_url->query)) {
-        
-            memcpy(parsed_url->query, query_start, (size_t)(current - query_start));
-            parsed_url->query[current - query_start] = '\0';
-            
-        }
+        host->repump = 1;
+        return;
         
     }
     
-    /* Extract fragment */
+    host->pumping = 1;
     
-    if (*current == '#') {
+    do {
     
-        fragment_start = current + 1;
+        host->repump = 0;
         
-        if (strlen(fragment_start) < sizeof(parsed_url->fragment)) {
+        for (connection = host->connections; connection; connection = next) {
         
-            strcpy(parsed_url->fragment, fragment_start);
+            next = connection->next;
+            multi_pump_connection(connection);
             
         }
         
-    }
+        while (host->queued > host->acquiring * multi->pipeline_depth &&
+               host->connection_count + host->acquiring < multi->max_connections) {
+               
+            if (commc_socketpool_acquire_async(multi->client->pool, multi->ctx,
+                                               host->hostname, host->port,
+                                               COMMC_SOCKET_TYPE_TCP,
+                                               multi_acquire_done, host) != COMMC_SUCCESS) {
+                                               
+                if (host->connection_count == 0 && host->acquiring == 0) {
+                
+                    multi_fail_queue(host, COMMC_SYSTEM_ERROR);
+                    
+                }
+                
+                break;
+                
+            }
+            
+            host->acquiring++;
+            multi->pending++;
+            
+        }
+        
+    } while (host->repump);
     
-    return COMMC_SUCCESS;
+    host->pumping = 0;
     
 }
 
 /*
 
-         commc_http_request_set_url()
+         multi_store_result()
 	       ---
-	       sets the target URL for the HTTP request.
+	       completion callback of
+	       commc_http_client_execute_all().
 
 */
 
-commc_error_t commc_http_request_set_url(commc_http_request_t* request,
-                                          const char*           url) {
+static void multi_store_result(commc_http_request_t*  request,
+                               commc_http_response_t* response,
+                               commc_error_t          result,
+                               void*                  user_data) {
 
-    if (!request || !url) {
+    (void)request;
+    (void)response;
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
-        
-    }
-    
-    return commc_http_url_parse(url, &request->url);
+    *(commc_error_t*)user_data = result;
     
 }
 
 /*
 
-         commc_http_request_add_header()
+         commc_http_multi_create()
 	       ---
-	       adds a header to the HTTP request.
+	       creates an empty request set.
 
 */
 
-commc_error_t commc_http_request_add_header(commc_http_request_t* request,
-                                             const char*           name,
-                                             const char*           value) {
+commc_error_t commc_http_multi_create(commc_http_multi_t**   multi,
+                                      commc_http_client_t*   client,
+                                      commc_async_context_t* ctx) {
 
-    commc_http_header_t* header;
+    commc_http_multi_t* new_multi;
     
-    if (!request || !name || !value) {
+    if (!multi || !client) {
     
         return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    if (request->header_count >= COMMC_HTTP_MAX_HEADERS) {
+    if (commc_socket_init() != COMMC_SUCCESS) {
     
-        return COMMC_ERROR_BUFFER_TOO_SMALL;
+        return COMMC_SYSTEM_ERROR;
         
     }
     
-    header = &request->headers[request->header_count];
+    new_multi = calloc(1, sizeof(commc_http_multi_t));
     
-    if (strlen(name) >= sizeof(header->name) ||
-        strlen(value) >= sizeof(header->value)) {
+    if (!new_multi) {
+    
+        return COMMC_MEMORY_ERROR;
         
-        return COMMC_ERROR_BUFFER_TOO_SMALL;
+    }
+    
+    if (!ctx) {
+    
+        ctx = commc_async_context_create(0, 100);
+        
+        if (!ctx) {
+        
+            free(new_multi);
+            return COMMC_SYSTEM_ERROR;
+            
+        }
+        
+        new_multi->owns_ctx = 1;
         
     }
     
-    strcpy(header->name, name);
-    strcpy(header->value, value);
+    new_multi->client          = client;
+    new_multi->ctx             = ctx;
+    new_multi->max_connections = COMMC_HTTP_MULTI_CONNECTIONS;
+    new_multi->pipeline_depth  = COMMC_HTTP_MULTI_PIPELINE;
     
-    request->header_count++;
+    *multi = new_multi;
     
     return COMMC_SUCCESS;
     
@@ -926,313 +3885,295 @@ commc_error_t commc_http_request_add_header(commc_http_request_t* request,
 
 /*
 
-         commc_http_request_set_body()
+         commc_http_multi_destroy()
 	       ---
-	       sets the request body content.
+	       closes the connections and frees the set.
 
 */
 
-commc_error_t commc_http_request_set_body(commc_http_request_t* request,
-                                           const char*           body,
-                                           size_t                body_length) {
+void commc_http_multi_destroy(commc_http_multi_t* multi) {
 
-    if (!request || !body) {
+    http_multi_host_t* host;
+    http_multi_host_t* next;
     
-        return COMMC_ERROR_INVALID_ARGUMENT;
+    if (!multi) {
+    
+        return;
         
     }
     
-    /* Free existing body */
+    multi->destroying = 1;
     
-    if (request->body) {
+    for (host = multi->hosts; host; host = host->next) {
     
-        free(request->body);
+        while (host->connections) {
+        
+            multi_close_connection(host->connections, COMMC_ERROR_INVALID_STATE);
+            
+        }
+        
+        multi_fail_queue(host, COMMC_ERROR_INVALID_STATE);
         
     }
     
-    /* Allocate new body */
+    /* io_uring reports the cancellations, and the pool its connects, from the next polls */
     
-    request->body = malloc(body_length + 1);
+    while (multi->pending > 0) {
     
-    if (!request->body) {
+        if (commc_async_poll(multi->ctx, 100) < 0) {
+        
+            break;
+            
+        }
+        
+    }
     
-        return COMMC_MEMORY_ERROR;
+    for (host = multi->hosts; host; host = next) {
+    
+        next = host->next;
+        free(host);
         
     }
     
-    memcpy(request->body, body, body_length);
-    request->body[body_length] = '\0';
-    request->body_length = body_length;
+    if (multi->owns_ctx) {
     
-    return COMMC_SUCCESS;
+        commc_async_context_destroy(multi->ctx);
+        
+    }
+    
+    free(multi);
     
 }
 
 /*
 
-         commc_http_method_to_string()
+         commc_http_multi_set_limits()
 	       ---
-	       converts an HTTP method to its string representation.
+	       sets the connection and pipelining limits.
 
 */
 
-const char* commc_http_method_to_string(commc_http_method_t method) {
+commc_error_t commc_http_multi_set_limits(commc_http_multi_t* multi,
+                                          size_t              max_connections,
+                                          size_t              pipeline_depth) {
 
-    if (method >= 0 && method < (int)(sizeof(http_method_strings) / sizeof(char*))) {
+    if (!multi || max_connections == 0 || pipeline_depth == 0) {
     
-        return http_method_strings[method];
+        return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    return "GET";
+    multi->max_connections = max_connections;
+    multi->pipeline_depth  = pipeline_depth;
+    
+    return COMMC_SUCCESS;
     
 }
 
 /*
 
-         commc_http_get()
+         commc_http_multi_add()
 	       ---
-	       convenience function for simple GET requests.
+	       queues a request on its host.
 
 */
 
-commc_error_t commc_http_get(const char*            url,
-                              commc_http_response_t* response) {
+commc_error_t commc_http_multi_add(commc_http_multi_t*              multi,
+                                   commc_http_request_t*            request,
+                                   commc_http_response_t*           response,
+                                   commc_http_completion_callback_t callback,
+                                   void*                            user_data) {
 
-    commc_http_client_t*  client = NULL;
-    commc_http_request_t* request = NULL;
-    commc_error_t         result;
+    http_multi_host_t* host;
+    http_multi_job_t*  job;
     
-    if (!url || !response) {
+    if (!multi || !request || !response) {
     
         return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    /* Create client and request */
+    if (multi->destroying) {
     
-    result = commc_http_client_create(&client);
+        return COMMC_ERROR_INVALID_STATE;
+        
+    }
     
-    if (result != COMMC_SUCCESS) {
+    for (host = multi->hosts; host; host = host->next) {
     
-        return result;
+        if (host->port == request->url.port &&
+            strcmp(host->hostname, request->url.hostname) == 0) {
+            
+            break;
+            
+        }
         
     }
     
-    result = commc_http_request_create(&request);
-    
-    if (result != COMMC_SUCCESS) {
+    if (!host) {
     
-        commc_http_client_destroy(client);
-        return result;
+        host = calloc(1, sizeof(http_multi_host_t));
+        
+        if (!host) {
+        
+            return COMMC_MEMORY_ERROR;
+            
+        }
+        
+        strcpy(host->hostname, request->url.hostname);
+        
+        host->multi  = multi;
+        host->port   = request->url.port;
+        host->next   = multi->hosts;
+        multi->hosts = host;
         
     }
     
-    /* Set up request */
-    
-    result = commc_http_request_set_url(request, url);
+    job = calloc(1, sizeof(http_multi_job_t));
     
-    if (result != COMMC_SUCCESS) {
+    if (!job) {
     
-        commc_http_request_destroy(request);
-        commc_http_client_destroy(client);
-        return result;
+        return COMMC_MEMORY_ERROR;
         
     }
     
-    /* Execute request */
+    job->request   = request;
+    job->response  = response;
+    job->callback  = callback;
+    job->user_data = user_data;
     
-    result = commc_http_client_execute(client, request, response);
+    reset_response(response);
     
-    /* Cleanup */
+    if (host->queue_tail) {
     
-    commc_http_request_destroy(request);
-    commc_http_client_destroy(client);
+        host->queue_tail->next = job;
+        
+    } else {
     
-    return result;
+        host->queue = job;
+        
+    }
+    
+    host->queue_tail = job;
+    host->queued++;
+    multi->outstanding++;
+    
+    multi_pump_host(host);
+    
+    return COMMC_SUCCESS;
     
 }
 
 /*
 
-         commc_http_client_execute()
+         commc_http_multi_wait()
 	       ---
-	       executes an HTTP request (simplified implementation).
+	       polls until every request has completed.
 
 */
 
-commc_error_t commc_http_client_execute(commc_http_client_t*   client,
-                                         commc_http_request_t*  request,
-                                         commc_http_response_t* response) {
+commc_error_t commc_http_multi_wait(commc_http_multi_t* multi) {
 
-    char request_buffer[HTTP_REQUEST_BUFFER_SIZE];
-    char line_buffer[HTTP_LINE_BUFFER_SIZE];
-    commc_error_t result;
-    int socket_fd;
-    int i;
-    size_t request_len = 0;
-    
-    if (!client || !request || !response) {
+    if (!multi) {
     
         return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    /* Create connection */
-    
-    result = create_socket_connection(request->url.hostname,
-                                      request->url.port,
-                                      &socket_fd);
-                                      
-    if (result != COMMC_SUCCESS) {
-    
-        return result;
-        
-    }
-    
-    /* Build request */
-    
-    snprintf(request_buffer, sizeof(request_buffer),
-             "%s %s HTTP/1.1\r\nHost: %s\r\n",
-             commc_http_method_to_string(request->method),
-             request->url.path,
-             request->url.hostname);
-             
-    request_len = strlen(request_buffer);
-    
-    /* Add headers */
-    
-    for (i = 0; i < request->header_count; i++) {
-    
-        snprintf(request_buffer + request_len, 
-                sizeof(request_buffer) - request_len,
-                "%s: %s\r\n",
-                request->headers[i].name,
-                request->headers[i].value);
-                
-        request_len = strlen(request_buffer);
-        
-    }
-    
-    /* Add body if present */
-    
-    if (request->body && request->body_length > 0) {
+    while (multi->outstanding > 0) {
     
-        snprintf(request_buffer + request_len,
-                sizeof(request_buffer) - request_len,
-                "Content-Length: %lu\r\n\r\n",
-                (unsigned long)request->body_length);
-                
-        request_len = strlen(request_buffer);
-        
-        if (request_len + request->body_length < sizeof(request_buffer)) {
+        if (commc_async_poll(multi->ctx, 100) < 0) {
         
-            memcpy(request_buffer + request_len, request->body, request->body_length);
-            request_len += request->body_length;
+            return COMMC_SYSTEM_ERROR;
             
         }
         
-    } else {
-    
-        strcat(request_buffer, "\r\n");
-        request_len = strlen(request_buffer);
-        
     }
     
-    /* Send request */
-    
-    result = send_all(socket_fd, request_buffer, request_len);
-    
-    if (result != COMMC_SUCCESS) {
-    
-        close(socket_fd);
-        cleanup_sockets();
-        return result;
-        
-    }
+    return COMMC_SUCCESS;
     
-    /* Receive status line */
+}
+
+/*
+
+         commc_http_multi_get_outstanding()
+	       ---
+	       returns the number of uncompleted requests.
+
+*/
+
+size_t commc_http_multi_get_outstanding(const commc_http_multi_t* multi) {
+
+    return multi ? multi->outstanding : 0;
     
-    result = receive_line(socket_fd, line_buffer, sizeof(line_buffer));
+}
+
+/*
+
+         commc_http_client_execute_all()
+	       ---
+	       executes a batch of requests concurrently.
+
+*/
+
+commc_error_t commc_http_client_execute_all(commc_http_client_t*    client,
+                                            commc_http_request_t**  requests,
+                                            commc_http_response_t** responses,
+                                            commc_error_t*          results,
+                                            size_t                  count,
+                                            size_t                  pipeline_depth) {
+
+    commc_http_multi_t* multi;
+    commc_error_t       result;
+    commc_error_t       status;
+    size_t              i;
     
-    if (result != COMMC_SUCCESS) {
+    if (!client || (count > 0 && (!requests || !responses || !results))) {
     
-        close(socket_fd);
-        cleanup_sockets();
-        return result;
+        return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    /* Parse status line */
+    result = commc_http_multi_create(&multi, client, NULL);
     
-    result = parse_status_line(line_buffer, &response->version,
-                              &response->status_code, response->status_message);
-                              
     if (result != COMMC_SUCCESS) {
     
-        close(socket_fd);
-        cleanup_sockets();
         return result;
         
     }
     
-    /* Receive headers */
-    
-    while (1) {
+    result = commc_http_multi_set_limits(multi, COMMC_HTTP_MULTI_CONNECTIONS,
+                                         pipeline_depth > 0 ? pipeline_depth : 1);
+                                         
+    for (i = 0; i < count && result == COMMC_SUCCESS; i++) {
     
-        result = receive_line(socket_fd, line_buffer, sizeof(line_buffer));
-        
-        if (result != COMMC_SUCCESS) {
-        
-            close(socket_fd);
-            cleanup_sockets();
-            return result;
-            
-        }
-        
-        if (strlen(line_buffer) == 0) {
-        
-            break;  /* Empty line indicates end of headers */
-            
-        }
+        results[i] = COMMC_ERROR_INVALID_STATE;
+        status     = commc_http_multi_add(multi, requests[i], responses[i],
+                                          multi_store_result, &results[i]);
+                                          
+        if (status != COMMC_SUCCESS) {
         
-        if (response->header_count < COMMC_HTTP_MAX_HEADERS) {
-        
-            parse_header_line(line_buffer, &response->headers[response->header_count]);
-            response->header_count++;
+            results[i] = status;
             
         }
         
     }
     
-    /* Receive body (simplified - just read what's available) */
-    
-    response->body = malloc(MAX_RESPONSE_SIZE);
-    
-    if (response->body) {
+    if (result == COMMC_SUCCESS) {
     
-        int bytes_received = recv(socket_fd, response->body, MAX_RESPONSE_SIZE - 1, 0);
-        
-        if (bytes_received > 0) {
-        
-            response->body[bytes_received] = '\0';
-            response->body_length = (size_t)bytes_received;
-            
-        } else {
-        
-            response->body[0] = '\0';
-            response->body_length = 0;
-            
-        }
+        result = commc_http_multi_wait(multi);
         
     }
     
-    /* Close connection */
+    commc_http_multi_destroy(multi);
     
-    close(socket_fd);
-    cleanup_sockets();
+    for (i = 0; i < count && result == COMMC_SUCCESS; i++) {
     
-    return COMMC_SUCCESS;
+        result = results[i];
+        
+    }
+    
+    return result;
     
 }
 
@@ -0,0 +1,837 @@
+/*
+   ===================================
+   H T T P P A R S E R . C
+   HTTP/1.X MESSAGE HEAD PARSER IMPLEMENTATION
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    the first call just parses, checking for the end of
+	    the input as it goes; heads mostly arrive in one
+	    receive, and then that single pass is all the work.
+	    if it runs out of input, later calls search only
+	    the bytes not searched before for the blank line
+	    that ends the head (LF by LF, sixteen at a time
+	    with SSE2), so a head trickling in byte by byte is
+	    not re-parsed on every call.
+
+	    header values and request targets are the long
+	    fields, so they are scanned in bulk for the first
+	    byte that ends them: any control character, which
+	    catches CR and LF and rejects NUL and friends in
+	    the same test. names and methods are matched
+	    against the RFC 9110 token table a byte at a time.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#include <ctype.h>
+#include <string.h>
+
+#include "commc/httpparser.h"
+#include "commc/error.h"
+
+#if !defined(COMMC_HTTP_PARSER_NO_SSE2) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define HTTP_PARSER_HAVE_SSE2
+#endif
+
+/*
+	==================================
+           --- CONSTANTS ---
+	==================================
+*/
+
+/*
+
+         token_chars[]
+	       ---
+	       1 for the bytes allowed in a method or header
+	       name: ALPHA, DIGIT and !#$%&'*+-.^_`|~.
+
+*/
+
+static const unsigned char token_chars[256] = {
+
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0
+
+    /* 0x80 - 0xFF: 0 */
+
+};
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+#ifdef HTTP_PARSER_HAVE_SSE2
+
+/*
+
+         lowest_bit()
+	       ---
+	       index of the lowest set bit of a non-zero mask.
+
+*/
+
+static int lowest_bit(unsigned int mask) {
+
+#if defined(__GNUC__)
+
+    return __builtin_ctz(mask);
+
+#else
+
+    int index = 0;
+
+    while (!(mask & 1u)) {
+
+        mask >>= 1;
+        index++;
+
+    }
+
+    return index;
+
+#endif
+
+}
+
+#endif
+
+/*
+
+         find_control()
+	       ---
+	       returns the first byte in [p, end) below limit
+	       (unsigned) or equal to DEL, or end. limit is
+	       0x20 for field values and 0x21 where a space
+	       ends the field too; it must not exceed 0x80.
+
+*/
+
+static const char* find_control(const char*   p,
+                                const char*   end,
+                                unsigned char limit) {
+
+#ifdef HTTP_PARSER_HAVE_SSE2
+
+    __m128i below = _mm_set1_epi8((char)(limit - 1));
+    __m128i del   = _mm_set1_epi8(0x7F);
+    __m128i bytes;
+    int     mask;
+
+    while (end - p >= 16) {
+
+        bytes = _mm_loadu_si128((const __m128i*)p);
+
+        /* unsigned byte <= limit - 1 exactly when min(byte, limit - 1) == byte */
+
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(bytes, below), bytes),
+                                              _mm_cmpeq_epi8(bytes, del)));
+
+        if (mask) {
+
+            return p + lowest_bit((unsigned int)mask);
+
+        }
+
+        p += 16;
+
+    }
+
+#else
+
+    const unsigned long ones  = (unsigned long)-1 / 255;
+    const unsigned long highs = ones << 7;
+    unsigned long       word;
+    unsigned long       dels;
+
+    /* a word has a byte below limit if (w - limit * ones) & ~w & highs,
+       and a DEL byte if the same test for zero holds for w ^ (0x7F * ones) */
+
+    while ((size_t)(end - p) >= sizeof(unsigned long)) {
+
+        memcpy(&word, p, sizeof(unsigned long));
+        dels = word ^ (ones * 0x7F);
+
+        if (((word - ones * limit) & ~word & highs) | ((dels - ones) & ~dels & highs)) {
+
+            break;    /* the byte loop below finds which one */
+
+        }
+
+        p += sizeof(unsigned long);
+
+    }
+
+#endif
+
+    while (p < end && (unsigned char)*p >= limit && *p != 0x7F) {
+
+        p++;
+
+    }
+
+    return p;
+
+}
+
+/*
+
+         find_head_end()
+	       ---
+	       searches data from the parser's resume point for
+	       LF LF or LF CR LF. returns the length of the
+	       head through that blank line, or 0 after moving
+	       the resume point up to where a blank line could
+	       still start.
+
+*/
+
+static size_t find_head_end(commc_http_parser_t* parser,
+                            const char*          data,
+                            size_t               length,
+                            size_t               start) {
+
+    const char* hit;
+    size_t      position = parser->scanned > start ? parser->scanned : start;
+
+#ifdef HTTP_PARSER_HAVE_SSE2
+
+    /* every LF of a 16-byte block comes out of one compare */
+
+    __m128i newline = _mm_set1_epi8('\n');
+    size_t  block;
+    int     mask;
+
+    while (length - position >= 16 + 2) {
+
+        block = position;
+        mask  = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + block)),
+                                                 newline));
+
+        while (mask) {
+
+            position = block + (size_t)lowest_bit((unsigned int)mask) + 1;
+
+            if (data[position] == '\n') {
+
+                return position + 1;
+
+            }
+
+            if (data[position] == '\r' && data[position + 1] == '\n') {
+
+                return position + 2;
+
+            }
+
+            mask &= mask - 1;
+
+        }
+
+        position = block + 16;
+
+    }
+
+#endif
+
+    while (position < length) {
+
+        hit = (const char*)memchr(data + position, '\n', length - position);
+
+        if (!hit) {
+
+            break;
+
+        }
+
+        position = (size_t)(hit - data) + 1;
+
+        if (position < length && data[position] == '\n') {
+
+            return position + 1;
+
+        }
+
+        if (position + 1 < length && data[position] == '\r' && data[position + 1] == '\n') {
+
+            return position + 2;
+
+        }
+
+    }
+
+    parser->scanned = length >= 2 ? length - 2 : 0;
+
+    return 0;
+
+}
+
+/*
+
+         parse_version()
+	       ---
+	       matches "HTTP/1.x" at p and stores x.
+
+*/
+
+static const char* parse_version(commc_http_parser_t* parser,
+                                 const char*          p,
+                                 const char*          end,
+                                 commc_error_t*       result) {
+
+    size_t available = (size_t)(end - p);
+
+    if (available < 8) {
+
+        *result = memcmp(p, "HTTP/1.", available < 7 ? available : 7) == 0 ?
+                  COMMC_ERROR_WOULD_BLOCK : COMMC_FORMAT_ERROR;
+        return NULL;
+
+    }
+
+    if (memcmp(p, "HTTP/1.", 7) != 0 || p[7] < '0' || p[7] > '9') {
+
+        *result = COMMC_FORMAT_ERROR;
+        return NULL;
+
+    }
+
+    parser->minor_version = p[7] - '0';
+
+    return p + 8;
+
+}
+
+/*
+
+         parse_line_end()
+	       ---
+	       steps over the CRLF or LF at p.
+
+*/
+
+static const char* parse_line_end(const char*    p,
+                                  const char*    end,
+                                  commc_error_t* result) {
+
+    if (p == end || (*p == '\r' && p + 1 == end)) {
+
+        *result = COMMC_ERROR_WOULD_BLOCK;
+        return NULL;
+
+    }
+
+    if (*p == '\n') {
+
+        return p + 1;
+
+    }
+
+    if (*p == '\r' && p[1] == '\n') {
+
+        return p + 2;
+
+    }
+
+    *result = COMMC_FORMAT_ERROR;
+    return NULL;
+
+}
+
+/*
+
+         parse_request_line()
+	       ---
+	       METHOD SP TARGET SP HTTP/1.x EOL.
+
+*/
+
+static const char* parse_request_line(commc_http_parser_t* parser,
+                                      const char*          p,
+                                      const char*          end,
+                                      commc_error_t*       result) {
+
+    parser->method = p;
+
+    while (p < end && token_chars[(unsigned char)*p]) {
+
+        p++;
+
+    }
+
+    parser->method_length = (size_t)(p - parser->method);
+
+    if (p == end) {
+
+        *result = COMMC_ERROR_WOULD_BLOCK;
+        return NULL;
+
+    }
+
+    if (parser->method_length == 0 || *p != ' ') {
+
+        *result = COMMC_FORMAT_ERROR;
+        return NULL;
+
+    }
+
+    parser->target = ++p;
+    p = find_control(p, end, 0x21);
+
+    parser->target_length = (size_t)(p - parser->target);
+
+    if (p == end) {
+
+        *result = COMMC_ERROR_WOULD_BLOCK;
+        return NULL;
+
+    }
+
+    if (parser->target_length == 0 || *p != ' ') {
+
+        *result = COMMC_FORMAT_ERROR;
+        return NULL;
+
+    }
+
+    p = parse_version(parser, p + 1, end, result);
+
+    return p ? parse_line_end(p, end, result) : NULL;
+
+}
+
+/*
+
+         parse_status_line()
+	       ---
+	       HTTP/1.x SP 3DIGIT [SP REASON] EOL. the reason
+	       may hold spaces and tabs.
+
+*/
+
+static const char* parse_status_line(commc_http_parser_t* parser,
+                                     const char*          p,
+                                     const char*          end,
+                                     commc_error_t*       result) {
+
+    int i;
+
+    p = parse_version(parser, p, end, result);
+
+    if (!p) {
+
+        return NULL;
+
+    }
+
+    /* SP and three digits */
+
+    for (i = 0; i < 4; i++) {
+
+        if (p + i == end) {
+
+            *result = COMMC_ERROR_WOULD_BLOCK;
+            return NULL;
+
+        }
+
+        if (i == 0 ? p[i] != ' ' : (p[i] < '0' || p[i] > '9')) {
+
+            *result = COMMC_FORMAT_ERROR;
+            return NULL;
+
+        }
+
+    }
+
+    parser->status_code = (p[1] - '0') * 100 + (p[2] - '0') * 10 + (p[3] - '0');
+    p += 4;
+
+    parser->reason = p;
+
+    if (p < end && *p == ' ') {
+
+        parser->reason = ++p;
+
+        for (;;) {
+
+            p = find_control(p, end, 0x20);
+
+            if (p == end || *p != '\t') {
+
+                break;
+
+            }
+
+            p++;
+
+        }
+
+    }
+
+    parser->reason_length = (size_t)(p - parser->reason);
+
+    return parse_line_end(p, end, result);
+
+}
+
+/*
+
+         parse_headers()
+	       ---
+	       header fields up to and including the blank
+	       line. returns the end of the head, or NULL with
+	       *result set.
+
+*/
+
+static const char* parse_headers(commc_http_parser_t* parser,
+                                 const char*          p,
+                                 const char*          end,
+                                 commc_error_t*       result) {
+
+    commc_http_header_view_t* header;
+    const char*               value_end;
+
+    for (;;) {
+
+        if (p == end) {
+
+            *result = COMMC_ERROR_WOULD_BLOCK;
+            return NULL;
+
+        }
+
+        if (*p == '\r' || *p == '\n') {
+
+            return parse_line_end(p, end, result);
+
+        }
+
+        if (parser->header_count == COMMC_HTTP_PARSER_MAX_HEADERS) {
+
+            *result = COMMC_ERROR_BUFFER_TOO_SMALL;
+            return NULL;
+
+        }
+
+        header = &parser->headers[parser->header_count];
+
+        /* Name: a token ended by a colon (so folded lines fail here) */
+
+        header->name = p;
+
+        while (p < end && token_chars[(unsigned char)*p]) {
+
+            p++;
+
+        }
+
+        header->name_length = (size_t)(p - header->name);
+
+        if (p == end) {
+
+            *result = COMMC_ERROR_WOULD_BLOCK;
+            return NULL;
+
+        }
+
+        if (header->name_length == 0 || *p != ':') {
+
+            *result = COMMC_FORMAT_ERROR;
+            return NULL;
+
+        }
+
+        p++;
+
+        while (p < end && (*p == ' ' || *p == '\t')) {
+
+            p++;
+
+        }
+
+        /* Value: up to the first control character other than a tab */
+
+        header->value = p;
+
+        for (;;) {
+
+            p = find_control(p, end, 0x20);
+
+            if (p == end || *p != '\t') {
+
+                break;
+
+            }
+
+            p++;
+
+        }
+
+        value_end = p;
+
+        while (value_end > header->value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+
+            value_end--;
+
+        }
+
+        header->value_length = (size_t)(value_end - header->value);
+
+        p = parse_line_end(p, end, result);
+
+        if (!p) {
+
+            return NULL;
+
+        }
+
+        parser->header_count++;
+
+    }
+
+}
+
+/*
+	==================================
+             --- CORE ---
+	==================================
+*/
+
+/*
+
+         commc_http_parser_init()
+	       ---
+	       clears the parser.
+
+*/
+
+void commc_http_parser_init(commc_http_parser_t*     parser,
+                            commc_http_parser_type_t type) {
+
+    if (!parser) {
+
+        return;
+
+    }
+
+    /* the header array is filled as it is parsed, so only the
+       scalars need clearing; a memset of the whole struct costs
+       more than parsing a typical head */
+
+    parser->type          = type;
+    parser->partial       = 0;
+    parser->scanned       = 0;
+    parser->head_length   = 0;
+    parser->method        = NULL;
+    parser->method_length = 0;
+    parser->target        = NULL;
+    parser->target_length = 0;
+    parser->minor_version = 0;
+    parser->status_code   = 0;
+    parser->reason        = NULL;
+    parser->reason_length = 0;
+    parser->header_count  = 0;
+
+}
+
+/*
+
+         commc_http_parser_execute()
+	       ---
+	       the first call parses straight away, since a
+	       head usually arrives whole. once a call has run
+	       out of input, later calls first look for the end
+	       of the head in the new bytes and parse only when
+	       it is there. blank lines before a request line
+	       are skipped, as RFC 9112 asks of servers.
+
+*/
+
+commc_error_t commc_http_parser_execute(commc_http_parser_t* parser,
+                                        const char*          data,
+                                        size_t               length) {
+
+    commc_error_t result = COMMC_SUCCESS;
+    const char*   p;
+    const char*   end = data + length;
+    size_t        skip = 0;
+    size_t        head_length;
+
+    if (!parser || (!data && length > 0)) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (parser->type == COMMC_HTTP_PARSER_REQUEST) {
+
+        while (skip < length && (data[skip] == '\r' || data[skip] == '\n')) {
+
+            if (data[skip] == '\r' && (skip + 1 == length || data[skip + 1] != '\n')) {
+
+                break;
+
+            }
+
+            skip += data[skip] == '\r' ? 2 : 1;
+
+        }
+
+    }
+
+    if (skip == length || (data[skip] == '\r' && skip + 1 == length)) {
+
+        return COMMC_ERROR_WOULD_BLOCK;
+
+    }
+
+    if (parser->partial) {
+
+        head_length = find_head_end(parser, data, length, skip);
+
+        if (head_length == 0) {
+
+            return COMMC_ERROR_WOULD_BLOCK;
+
+        }
+
+        end = data + head_length;
+
+    }
+
+    parser->header_count = 0;
+
+    if (parser->type == COMMC_HTTP_PARSER_REQUEST) {
+
+        p = parse_request_line(parser, data + skip, end, &result);
+
+    } else {
+
+        p = parse_status_line(parser, data + skip, end, &result);
+
+    }
+
+    if (p) {
+
+        p = parse_headers(parser, p, end, &result);
+
+    }
+
+    if (!p) {
+
+        if (result == COMMC_ERROR_WOULD_BLOCK) {
+
+            parser->partial = 1;
+            parser->scanned = length >= 2 ? length - 2 : 0;
+
+        }
+
+        return result;
+
+    }
+
+    parser->head_length = (size_t)(p - data);
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_http_parser_find_header()
+	       ---
+	       linear search; heads rarely carry more than a
+	       few dozen fields.
+
+*/
+
+const commc_http_header_view_t* commc_http_parser_find_header(const commc_http_parser_t* parser,
+                                                              const char*                name) {
+
+    size_t i;
+
+    if (!parser || !name) {
+
+        return NULL;
+
+    }
+
+    for (i = 0; i < parser->header_count; i++) {
+
+        if (commc_http_parser_view_equals(parser->headers[i].name,
+                                          parser->headers[i].name_length, name)) {
+
+            return &parser->headers[i];
+
+        }
+
+    }
+
+    return NULL;
+
+}
+
+/*
+
+         commc_http_parser_view_equals()
+	       ---
+	       case-insensitive comparison of a view and a
+	       string.
+
+*/
+
+int commc_http_parser_view_equals(const char* view,
+                                  size_t      view_length,
+                                  const char* string) {
+
+    size_t i;
+
+    if (!view || !string) {
+
+        return 0;
+
+    }
+
+    for (i = 0; i < view_length; i++) {
+
+        if (string[i] == '\0' ||
+            tolower((unsigned char)view[i]) != tolower((unsigned char)string[i])) {
+
+            return 0;
+
+        }
+
+    }
+
+    return string[view_length] == '\0';
+
+}
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
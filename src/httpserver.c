@@ -0,0 +1,3144 @@
+/*
+   ===================================
+   H T T P S E R V E R . C
+   EMBEDDED HTTP/1.1 SERVER IMPLEMENTATION
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    each connection has at most one operation in flight
+	    and moves between receiving and sending: whatever
+	    arrived is parsed and answered request by request,
+	    responses pile up in the output buffer (pipelined
+	    requests get theirs in the same send), and only when
+	    the output is gone, and any file after it, does the
+	    next receive go out. a request whose head or body is
+	    still incomplete just waits in the input buffer.
+
+	    a connection that is done after a response shuts its
+	    write side and discards input until the peer closes
+	    or SERVER_LINGER_MS pass: closing with unread bytes
+	    would reset the connection and could destroy the
+	    response (an error answer to an oversized request,
+	    say) before the client read it.
+
+	    a connection is freed once it is closing and its
+	    operation has reported back; on the readiness
+	    backends cancelling does that at once, on io_uring
+	    at the next poll. the idle timer is re-armed on
+	    every submit, which the timing wheel makes O(1).
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L    /* GETADDRINFO, FSTAT */
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commc/httpserver.h"
+#include "commc/httpparser.h"
+#include "commc/async.h"
+#include "commc/flate.h"
+#include "commc/error.h"
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <io.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+
+    #define SERVER_CLOSE_SOCKET(s)  closesocket((SOCKET)(s))
+    #define SERVER_OPEN_FILE(p)     _open((p), _O_RDONLY | _O_BINARY)
+    #define SERVER_CLOSE_FILE(f)    _close(f)
+    #define SERVER_STAT             struct _stat
+    #define SERVER_FSTAT(f, s)      _fstat((f), (s))
+    #define SERVER_IS_REGULAR(m)    (((m) & _S_IFMT) == _S_IFREG)
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+
+    #define SERVER_CLOSE_SOCKET(s)  close(s)
+    #define SERVER_OPEN_FILE(p)     open((p), O_RDONLY)
+    #define SERVER_CLOSE_FILE(f)    close(f)
+    #define SERVER_STAT             struct stat
+    #define SERVER_FSTAT(f, s)      fstat((f), (s))
+    #define SERVER_IS_REGULAR(m)    S_ISREG(m)
+#endif
+
+/*
+	==================================
+           --- CONSTANTS ---
+	==================================
+*/
+
+#define SERVER_BUFFER_SIZE      4096     /* INITIAL INPUT AND OUTPUT BUFFER */
+#define SERVER_OUTPUT_LIMIT     65536    /* QUEUED RESPONSE BYTES BEFORE SENDING */
+#define SERVER_CHUNK_LINE       4096     /* LONGEST CHUNK SIZE OR TRAILER LINE */
+#define SERVER_MAX_PATH         1024     /* LONGEST FILE PATH SERVED */
+#define SERVER_LINGER_MS        1000UL   /* DRAINING TIME BEFORE A CLOSE */
+
+/*
+	==================================
+           --- STRUCTURES ---
+	==================================
+*/
+
+/*
+
+         server_buffer_t
+	       ---
+	       growable byte buffer.
+
+*/
+
+typedef struct {
+
+    char*  data;
+    size_t length;
+    size_t capacity;
+
+} server_buffer_t;
+
+/*
+
+         server_route_t
+	       ---
+	       one handler and what it matches. pattern holds
+	       the path without the trailing '*' of a prefix.
+
+*/
+
+typedef struct {
+
+    char*                       method;      /* NULL FOR ANY */
+    char*                       pattern;
+    size_t                      length;
+    int                         prefix;      /* MATCH PATHS STARTING WITH PATTERN */
+    commc_http_server_handler_t handler;
+    void*                       user_data;
+    void*                       owned;       /* FREED WITH THE ROUTE */
+
+} server_route_t;
+
+/*
+
+         server_directory_t
+	       ---
+	       user data of a serve_directory() route.
+
+*/
+
+typedef struct {
+
+    size_t prefix_length;                    /* PATH BYTES TO STRIP */
+    size_t directory_length;
+    char   directory[1];                     /* ROOT, NUL-TERMINATED */
+
+} server_directory_t;
+
+struct commc_http_server_connection_t {
+
+    commc_http_server_t*            server;
+    commc_http_server_connection_t* prev;           /* SERVER LIST */
+    commc_http_server_connection_t* next;
+    int                             handle;
+    int                             pending;        /* OPERATIONS IN FLIGHT */
+    int                             closing;        /* FREED ONCE PENDING IS 0 */
+    int                             close_after;    /* CLOSE ONCE THE OUTPUT IS SENT */
+    int                             draining;       /* WRITE SIDE SHUT, DISCARDING INPUT */
+    int                             parsing;        /* PARSER HOLDS A PARTIAL HEAD */
+    int                             continue_sent;  /* 100 CONTINUE WENT OUT FOR THIS REQUEST */
+
+    char*                           input;          /* RECEIVED, UNANSWERED BYTES */
+    size_t                          input_capacity;
+    size_t                          input_start;
+    size_t                          input_end;
+
+    server_buffer_t                 output;         /* QUEUED RESPONSES */
+    size_t                          output_sent;
+    server_buffer_t                 headers;        /* add_header() FIELDS OF THE NEXT RESPONSE */
+
+    int                             file;           /* SENT AFTER THE OUTPUT, -1 IF NONE */
+    size_t                          file_offset;
+    size_t                          file_remaining;
+
+    commc_async_timer_t             timer;          /* IDLE TIMEOUT */
+    commc_http_parser_t             parser;
+
+};
+
+struct commc_http_server_t {
+
+    commc_async_context_t*          ctx;
+    commc_http_server_config_t      config;
+
+    int                             listener;       /* -1 IF NOT LISTENING */
+    int                             port;
+    int                             client;         /* ACCEPT OUTPUT */
+    int                             accepting;      /* ACCEPT IN FLIGHT */
+    int                             destroying;
+    size_t                          pending;        /* OPERATIONS IN FLIGHT, ACCEPT INCLUDED */
+    commc_async_timer_t             backoff;        /* ACCEPT RETRY */
+
+    server_route_t*                 routes;
+    size_t                          route_count;
+    size_t                          route_capacity;
+
+    commc_http_server_connection_t* connections;
+    size_t                          connection_count;
+
+    commc_flate_encoder_t*          encoder;        /* GZIPS RESPONSES, CREATED ON FIRST USE */
+    server_buffer_t                 compressed;     /* THE GZIPPED BODY BEING QUEUED */
+    size_t                          compress_limit; /* GIVE UP AT THIS MANY BYTES */
+    commc_flate_decoder_t*          decoder;        /* DECODES REQUEST BODIES, CREATED ON FIRST USE */
+    server_buffer_t                 decoded;        /* THE DECODED BODY BEING DISPATCHED */
+
+};
+
+/*
+	==================================
+             --- BUFFERS ---
+	==================================
+*/
+
+/*
+
+         buffer_append()
+	       ---
+	       appends length bytes, doubling the buffer as
+	       needed. returns 0 if memory runs out.
+
+*/
+
+static int buffer_append(server_buffer_t* buffer,
+                         const void*      data,
+                         size_t           length) {
+
+    size_t capacity;
+    char*  grown;
+
+    if (buffer->capacity - buffer->length < length) {
+
+        capacity = buffer->capacity ? buffer->capacity : SERVER_BUFFER_SIZE;
+
+        while (capacity - buffer->length < length) {
+
+            capacity *= 2;
+
+        }
+
+        grown = (char*)realloc(buffer->data, capacity);
+
+        if (!grown) {
+
+            return 0;
+
+        }
+
+        buffer->data     = grown;
+        buffer->capacity = capacity;
+
+    }
+
+    if (length > 0) {
+
+        memcpy(buffer->data + buffer->length, data, length);
+        buffer->length += length;
+
+    }
+
+    return 1;
+
+}
+
+/*
+
+         buffer_append_string()
+	       ---
+	       appends a NUL-terminated string.
+
+*/
+
+static int buffer_append_string(server_buffer_t* buffer,
+                                const char*      string) {
+
+    return buffer_append(buffer, string, strlen(string));
+
+}
+
+/*
+
+         buffer_append_decimal()
+	       ---
+	       appends an unsigned number in decimal.
+
+*/
+
+static int buffer_append_decimal(server_buffer_t* buffer,
+                                 unsigned long    value) {
+
+    char   digits[24];
+    size_t count = sizeof(digits);
+
+    do {
+
+        digits[--count] = (char)('0' + value % 10);
+        value /= 10;
+
+    } while (value > 0);
+
+    return buffer_append(buffer, digits + count, sizeof(digits) - count);
+
+}
+
+/*
+
+         buffer_release()
+	       ---
+	       frees the buffer if it grew past max_capacity,
+	       so a connection only holds a large buffer while
+	       it needs one. the buffer must be empty.
+
+*/
+
+static void buffer_release(server_buffer_t* buffer,
+                           size_t           max_capacity) {
+
+    if (buffer->capacity > max_capacity) {
+
+        free(buffer->data);
+
+        buffer->data     = NULL;
+        buffer->capacity = 0;
+
+    }
+
+}
+
+/*
+	==================================
+            --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         status_reason()
+	       ---
+	       returns the reason phrase of a status code.
+
+*/
+
+static const char* status_reason(int status) {
+
+    switch (status) {
+
+        case 100: return "Continue";
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 303: return "See Other";
+        case 304: return "Not Modified";
+        case 307: return "Temporary Redirect";
+        case 308: return "Permanent Redirect";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 409: return "Conflict";
+        case 411: return "Length Required";
+        case 413: return "Content Too Large";
+        case 414: return "URI Too Long";
+        case 415: return "Unsupported Media Type";
+        case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
+        default:  return "Unknown";
+
+    }
+
+}
+
+/*
+
+         guess_content_type()
+	       ---
+	       maps a file extension to a media type.
+
+*/
+
+static const char* guess_content_type(const char* path) {
+
+    static const char* const types[][2] = {
+
+        { ".html", "text/html; charset=utf-8" },
+        { ".htm",  "text/html; charset=utf-8" },
+        { ".css",  "text/css; charset=utf-8" },
+        { ".js",   "text/javascript; charset=utf-8" },
+        { ".json", "application/json" },
+        { ".txt",  "text/plain; charset=utf-8" },
+        { ".xml",  "application/xml" },
+        { ".svg",  "image/svg+xml" },
+        { ".png",  "image/png" },
+        { ".jpg",  "image/jpeg" },
+        { ".jpeg", "image/jpeg" },
+        { ".gif",  "image/gif" },
+        { ".ico",  "image/x-icon" },
+        { ".webp", "image/webp" },
+        { ".wasm", "application/wasm" },
+        { ".pdf",  "application/pdf" }
+
+    };
+
+    const char* extension = strrchr(path, '.');
+    size_t      i;
+
+    if (extension && !strchr(extension, '/')) {
+
+        for (i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+
+            if (commc_http_parser_view_equals(extension, strlen(extension), types[i][0])) {
+
+                return types[i][1];
+
+            }
+
+        }
+
+    }
+
+    return "application/octet-stream";
+
+}
+
+/*
+
+         view_has_token()
+	       ---
+	       checks a comma-separated header value for token,
+	       without regard to case.
+
+*/
+
+static int view_has_token(const commc_http_header_view_t* view,
+                          const char*                     token) {
+
+    const char* p;
+    const char* end;
+    const char* start;
+    const char* last;
+
+    if (!view) {
+
+        return 0;
+
+    }
+
+    p   = view->value;
+    end = view->value + view->value_length;
+
+    while (p < end) {
+
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+
+            p++;
+
+        }
+
+        start = p;
+
+        while (p < end && *p != ',') {
+
+            p++;
+
+        }
+
+        last = p;
+
+        while (last > start && (last[-1] == ' ' || last[-1] == '\t')) {
+
+            last--;
+
+        }
+
+        if (last > start &&
+            commc_http_parser_view_equals(start, (size_t)(last - start), token)) {
+
+            return 1;
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+/*
+
+         parse_content_length()
+	       ---
+	       reads a Content-Length value. returns 0 for
+	       anything but a plain decimal that fits.
+
+*/
+
+static int parse_content_length(const commc_http_header_view_t* view,
+                                size_t*                         length) {
+
+    size_t value = 0;
+    size_t i;
+
+    if (view->value_length == 0) {
+
+        return 0;
+
+    }
+
+    for (i = 0; i < view->value_length; i++) {
+
+        if (view->value[i] < '0' || view->value[i] > '9' ||
+            value > ((size_t)-1 - 9) / 10) {
+
+            return 0;
+
+        }
+
+        value = value * 10 + (size_t)(view->value[i] - '0');
+
+    }
+
+    *length = value;
+    return 1;
+
+}
+
+/*
+
+         hex_digit()
+	       ---
+	       value of a hex digit, or -1.
+
+*/
+
+static int hex_digit(char c) {
+
+    if (c >= '0' && c <= '9') {
+
+        return c - '0';
+
+    }
+
+    if (c >= 'a' && c <= 'f') {
+
+        return c - 'a' + 10;
+
+    }
+
+    if (c >= 'A' && c <= 'F') {
+
+        return c - 'A' + 10;
+
+    }
+
+    return -1;
+
+}
+
+/*
+
+         read_chunked_body()
+	       ---
+	       walks the chunked request body at body, with
+	       available bytes received. with join set, the
+	       chunks' data is also moved together to the
+	       start of body; call it so only once the body
+	       is complete.
+
+	       returns:
+	       - 1 once complete: *consumed is the body up to
+	         the end of its trailers, *length its data
+	       - 0 while more is needed
+	       - 400 if it is malformed
+	       - 413 if its data passes max_body
+
+*/
+
+static int read_chunked_body(char*   body,
+                             size_t  available,
+                             size_t  max_body,
+                             int     join,
+                             size_t* consumed,
+                             size_t* length) {
+
+    const char* line_end;
+    size_t      position = 0;
+    size_t      total    = 0;
+    size_t      size;
+    int         digits;
+    int         value;
+
+    for (;;) {
+
+        line_end = (const char*)memchr(body + position, '\n', available - position);
+
+        if (!line_end) {
+
+            return available - position > SERVER_CHUNK_LINE ? 400 : 0;
+
+        }
+
+        /* the size line: hex digits, then extensions to ignore */
+
+        size   = 0;
+        digits = 0;
+
+        while ((value = hex_digit(body[position])) >= 0) {
+
+            if (size > max_body / 16) {
+
+                return 413;
+
+            }
+
+            size = size * 16 + (size_t)value;
+            position++;
+            digits++;
+
+        }
+
+        if (digits == 0 || (body[position] != ';' && body[position] != '\r' &&
+                            body[position] != '\n')) {
+
+            return 400;
+
+        }
+
+        position = (size_t)(line_end - body) + 1;
+
+        if (size == 0) {
+
+            break;
+
+        }
+
+        if (size > max_body - total) {
+
+            return 413;
+
+        }
+
+        if (available - position < size + 2) {
+
+            return 0;
+
+        }
+
+        if (body[position + size] != '\r' || body[position + size + 1] != '\n') {
+
+            return 400;
+
+        }
+
+        if (join) {
+
+            memmove(body + total, body + position, size);
+
+        }
+
+        total    += size;
+        position += size + 2;
+
+    }
+
+    /* trailer fields, up to an empty line */
+
+    for (;;) {
+
+        line_end = (const char*)memchr(body + position, '\n', available - position);
+
+        if (!line_end) {
+
+            return available - position > SERVER_CHUNK_LINE ? 400 : 0;
+
+        }
+
+        if (line_end == body + position ||
+            (line_end == body + position + 1 && body[position] == '\r')) {
+
+            *consumed = (size_t)(line_end - body) + 1;
+            *length   = total;
+
+            return 1;
+
+        }
+
+        position = (size_t)(line_end - body) + 1;
+
+    }
+
+}
+
+/*
+
+         accepts_gzip()
+	       ---
+	       checks an Accept-Encoding value for gzip (or
+	       x-gzip, or failing those '*') with a nonzero q.
+
+*/
+
+static int accepts_gzip(const commc_http_header_view_t* view) {
+
+    const char* p;
+    const char* end;
+    const char* name;
+    size_t      name_length;
+    int         accepted;
+    int         any = 0;
+
+    if (!view) {
+
+        return 0;
+
+    }
+
+    p   = view->value;
+    end = view->value + view->value_length;
+
+    while (p < end) {
+
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+
+            p++;
+
+        }
+
+        name = p;
+
+        while (p < end && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') {
+
+            p++;
+
+        }
+
+        name_length = (size_t)(p - name);
+        accepted    = 1;
+
+        /* of the parameters only q matters: q=0 (0.0, 0.000) refuses */
+
+        while (p < end && *p != ',') {
+
+            if (*p == ';') {
+
+                p++;
+
+                while (p < end && (*p == ' ' || *p == '\t')) {
+
+                    p++;
+
+                }
+
+                if (end - p >= 2 && (*p == 'q' || *p == 'Q') && p[1] == '=') {
+
+                    accepted = 0;
+
+                    for (p += 2; p < end && *p != ',' && *p != ';'; p++) {
+
+                        if (*p >= '1' && *p <= '9') {
+
+                            accepted = 1;
+
+                        }
+
+                    }
+
+                }
+
+                continue;
+
+            }
+
+            p++;
+
+        }
+
+        if (commc_http_parser_view_equals(name, name_length, "gzip") ||
+            commc_http_parser_view_equals(name, name_length, "x-gzip")) {
+
+            return accepted;
+
+        }
+
+        if (name_length == 1 && *name == '*') {
+
+            any = accepted;
+
+        }
+
+    }
+
+    return any;
+
+}
+
+/*
+
+         is_compressible()
+	       ---
+	       checks whether a Content-Type is worth gzipping:
+	       text, and the JSON, XML and script types.
+	       images, archives and the like are compressed
+	       already.
+
+*/
+
+static int is_compressible(const char* content_type) {
+
+    static const char* const words[] = { "json", "xml", "javascript", "ecmascript" };
+
+    size_t length;
+    size_t size;
+    size_t i;
+    size_t j;
+
+    if (!content_type) {
+
+        return 0;
+
+    }
+
+    length = strcspn(content_type, ";");
+
+    if (length >= 5 && commc_http_parser_view_equals(content_type, 5, "text/")) {
+
+        return 1;
+
+    }
+
+    for (i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+
+        size = strlen(words[i]);
+
+        for (j = 0; j + size <= length; j++) {
+
+            if (commc_http_parser_view_equals(content_type + j, size, words[i])) {
+
+                return 1;
+
+            }
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+/*
+
+         out_of_descriptors()
+	       ---
+	       checks for accept errors that last until some
+	       connection closes, so retrying at once would spin.
+
+*/
+
+static int out_of_descriptors(int error) {
+
+    return error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM;
+
+}
+
+/*
+	==================================
+           --- CONNECTIONS ---
+	==================================
+*/
+
+static int  arm_accept(commc_http_server_t* server);
+static void pump(commc_http_server_connection_t* connection);
+
+/*
+
+         free_connection()
+	       ---
+	       closes the handle and any file and frees a
+	       connection with nothing in flight. accepting
+	       resumes if the connection limit held it up.
+
+*/
+
+static void free_connection(commc_http_server_connection_t* connection) {
+
+    commc_http_server_t* server = connection->server;
+
+    if (connection->prev) {
+
+        connection->prev->next = connection->next;
+
+    } else {
+
+        server->connections = connection->next;
+
+    }
+
+    if (connection->next) {
+
+        connection->next->prev = connection->prev;
+
+    }
+
+    server->connection_count--;
+
+    commc_async_timer_stop(server->ctx, &connection->timer);
+    commc_async_remove_handle(server->ctx, connection->handle);
+    SERVER_CLOSE_SOCKET(connection->handle);
+
+    if (connection->file != -1) {
+
+        SERVER_CLOSE_FILE(connection->file);
+
+    }
+
+    free(connection->input);
+    free(connection->output.data);
+    free(connection->headers.data);
+    free(connection);
+
+    arm_accept(server);
+
+}
+
+/*
+
+         close_connection()
+	       ---
+	       starts closing a connection. it is freed here if
+	       nothing is in flight, else by the callback of its
+	       cancelled operation, which may run before this
+	       returns.
+
+*/
+
+static void close_connection(commc_http_server_connection_t* connection) {
+
+    if (connection->closing) {
+
+        return;
+
+    }
+
+    connection->closing = 1;
+    commc_async_timer_stop(connection->server->ctx, &connection->timer);
+
+    if (connection->pending == 0) {
+
+        free_connection(connection);
+        return;
+
+    }
+
+    commc_async_cancel(connection->server->ctx, connection->handle);
+
+}
+
+/*
+
+         timeout_done()
+	       ---
+	       closes a connection that stayed quiet too long.
+
+*/
+
+static void timeout_done(const commc_async_result_t* result) {
+
+    close_connection((commc_http_server_connection_t*)result->user_data);
+
+}
+
+/*
+
+         io_done()
+	       ---
+	       completion of a connection's receive, send or
+	       sendfile.
+
+*/
+
+static void io_done(const commc_async_result_t* result) {
+
+    commc_http_server_connection_t* connection;
+
+    connection = (commc_http_server_connection_t*)result->user_data;
+
+    connection->pending--;
+    connection->server->pending--;
+
+    if (connection->closing) {
+
+        if (connection->pending == 0) {
+
+            free_connection(connection);
+
+        }
+
+        return;
+
+    }
+
+    if (result->error_code != 0) {
+
+        close_connection(connection);
+        return;
+
+    }
+
+    switch (result->operation) {
+
+        case COMMC_ASYNC_OP_RECV:
+
+            if (result->bytes_transferred == 0) {
+
+                close_connection(connection);
+                return;
+
+            }
+
+            if (!connection->draining) {
+
+                connection->input_end += result->bytes_transferred;
+
+            }
+
+            break;
+
+        case COMMC_ASYNC_OP_SEND:
+
+            connection->output_sent += result->bytes_transferred;
+            break;
+
+        case COMMC_ASYNC_OP_SENDFILE:
+
+            /* a short count means the file shrank under us */
+
+            if (result->bytes_transferred < connection->file_remaining) {
+
+                close_connection(connection);
+                return;
+
+            }
+
+            SERVER_CLOSE_FILE(connection->file);
+            connection->file           = -1;
+            connection->file_remaining = 0;
+            break;
+
+        default:
+
+            break;
+
+    }
+
+    pump(connection);
+
+}
+
+/*
+
+         submit_io()
+	       ---
+	       submits one operation for a connection and
+	       re-arms its idle timer. returns 0 on failure.
+
+*/
+
+static int submit_io(commc_http_server_connection_t* connection,
+                     commc_async_operation_type_t    type,
+                     void*                           buffer,
+                     size_t                          length) {
+
+    commc_http_server_t*     server = connection->server;
+    commc_async_operation_t* op;
+    int                      failed;
+
+    if (type == COMMC_ASYNC_OP_SENDFILE) {
+
+        failed = commc_async_sendfile(server->ctx, connection->handle, connection->file,
+                                      connection->file_offset, connection->file_remaining,
+                                      io_done, connection) != 0;
+
+    } else {
+
+        op = commc_async_operation_create(type, connection->handle, buffer, length);
+
+        if (!op) {
+
+            return 0;
+
+        }
+
+        op->callback  = io_done;
+        op->user_data = connection;
+
+        failed = commc_async_submit_operation(server->ctx, op) != 0;
+
+        if (failed) {
+
+            commc_async_operation_destroy(op);
+
+        }
+
+    }
+
+    if (failed) {
+
+        return 0;
+
+    }
+
+    connection->pending++;
+    server->pending++;
+
+    if (!connection->draining) {
+
+        commc_async_timer_start(server->ctx, &connection->timer,
+                                server->config.idle_timeout_ms, 0);
+
+    }
+
+    return 1;
+
+}
+
+/*
+
+         reserve_input()
+	       ---
+	       makes room for at least total unanswered bytes
+	       plus one more receive, moving them to the front
+	       of the buffer or growing it.
+
+*/
+
+static int reserve_input(commc_http_server_connection_t* connection,
+                         size_t                          total) {
+
+    size_t held = connection->input_end - connection->input_start;
+    size_t capacity;
+    char*  grown;
+
+    if (total < held + 1) {
+
+        total = held + 1;
+
+    }
+
+    if (connection->input_capacity - connection->input_start >= total &&
+        connection->input_end < connection->input_capacity) {
+
+        return 1;
+
+    }
+
+    if (connection->input_start > 0) {
+
+        memmove(connection->input, connection->input + connection->input_start, held);
+
+        connection->input_start = 0;
+        connection->input_end   = held;
+
+    }
+
+    if (connection->input_capacity >= total) {
+
+        return 1;
+
+    }
+
+    capacity = connection->input_capacity ? connection->input_capacity : SERVER_BUFFER_SIZE;
+
+    while (capacity < total) {
+
+        capacity *= 2;
+
+    }
+
+    grown = (char*)realloc(connection->input, capacity);
+
+    if (!grown) {
+
+        return 0;
+
+    }
+
+    connection->input          = grown;
+    connection->input_capacity = capacity;
+
+    return 1;
+
+}
+
+/*
+	==================================
+            --- CODINGS ---
+	==================================
+*/
+
+/*
+
+         collect_compressed()
+	       ---
+	       flate output of a response body. gives up once
+	       the result is no smaller than the body.
+
+*/
+
+static commc_error_t collect_compressed(const char* data,
+                                        size_t      length,
+                                        void*       user_data) {
+
+    commc_http_server_t* server = (commc_http_server_t*)user_data;
+
+    if (length >= server->compress_limit - server->compressed.length) {
+
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+
+    }
+
+    return buffer_append(&server->compressed, data, length) ? COMMC_SUCCESS :
+                                                              COMMC_MEMORY_ERROR;
+
+}
+
+/*
+
+         collect_decoded()
+	       ---
+	       flate output of a request body, held to
+	       max_body.
+
+*/
+
+static commc_error_t collect_decoded(const char* data,
+                                     size_t      length,
+                                     void*       user_data) {
+
+    commc_http_server_t* server = (commc_http_server_t*)user_data;
+
+    if (length > server->config.max_body - server->decoded.length) {
+
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+
+    }
+
+    return buffer_append(&server->decoded, data, length) ? COMMC_SUCCESS :
+                                                           COMMC_MEMORY_ERROR;
+
+}
+
+/*
+
+         compress_body()
+	       ---
+	       gzips a response body into server->compressed.
+	       returns 0 if that fails or would not save a
+	       byte; the body then goes out as it is.
+
+*/
+
+static int compress_body(commc_http_server_t* server,
+                         const void*          body,
+                         size_t               length) {
+
+    commc_error_t result;
+
+    if (!server->encoder) {
+
+        if (commc_flate_encoder_create(&server->encoder, COMMC_FLATE_GZIP,
+                                       server->config.compress_level,
+                                       collect_compressed, server) != COMMC_SUCCESS) {
+
+            server->encoder = NULL;
+            return 0;
+
+        }
+
+    } else {
+
+        commc_flate_encoder_reset(server->encoder);
+
+    }
+
+    server->compressed.length = 0;
+    server->compress_limit    = length;
+
+    result = commc_flate_encoder_write(server->encoder, body, length);
+
+    if (result == COMMC_SUCCESS) {
+
+        result = commc_flate_encoder_finish(server->encoder);
+
+    }
+
+    return result == COMMC_SUCCESS;
+
+}
+
+/*
+
+         decode_body()
+	       ---
+	       decodes a request body sent with Content-Encoding
+	       into server->decoded.
+
+	       returns:
+	       - 0 if decoded
+	       - the status to reject the request with
+	         otherwise
+
+*/
+
+static int decode_body(commc_http_server_t*            server,
+                       const commc_http_header_view_t* coding,
+                       const char*                     body,
+                       size_t                          length) {
+
+    commc_error_t result;
+
+    if (!commc_http_parser_view_equals(coding->value, coding->value_length, "gzip") &&
+        !commc_http_parser_view_equals(coding->value, coding->value_length, "x-gzip") &&
+        !commc_http_parser_view_equals(coding->value, coding->value_length, "deflate")) {
+
+        return 415;
+
+    }
+
+    /* AUTO takes gzip, zlib and bare DEFLATE, all of which clients send */
+
+    if (!server->decoder) {
+
+        if (commc_flate_decoder_create(&server->decoder, COMMC_FLATE_AUTO,
+                                       collect_decoded, server) != COMMC_SUCCESS) {
+
+            server->decoder = NULL;
+            return 500;
+
+        }
+
+    } else {
+
+        commc_flate_decoder_reset(server->decoder);
+
+    }
+
+    server->decoded.length = 0;
+
+    result = commc_flate_decoder_write(server->decoder, body, length);
+
+    if (result == COMMC_SUCCESS) {
+
+        result = commc_flate_decoder_finish(server->decoder);
+
+    }
+
+    if (result == COMMC_ERROR_BUFFER_TOO_SMALL) {
+
+        return 413;
+
+    }
+
+    if (result == COMMC_MEMORY_ERROR) {
+
+        return 500;
+
+    }
+
+    return result == COMMC_SUCCESS ? 0 : 400;
+
+}
+
+/*
+	==================================
+            --- RESPONDING ---
+	==================================
+*/
+
+/*
+
+         queue_response()
+	       ---
+	       appends the status line and header fields of a
+	       response with a body of length bytes. fields are
+	       preformatted header lines of our own, or NULL.
+
+*/
+
+static int queue_response(commc_http_server_request_t* request,
+                          int                          status,
+                          const char*                  content_type,
+                          size_t                       length,
+                          const char*                  fields) {
+
+    commc_http_server_connection_t* connection = request->connection;
+    server_buffer_t*                output     = &connection->output;
+
+    if (!buffer_append(output, "HTTP/1.1 ", 9) ||
+        !buffer_append_decimal(output, (unsigned long)status) ||
+        !buffer_append(output, " ", 1) ||
+        !buffer_append_string(output, status_reason(status)) ||
+        !buffer_append(output, "\r\n", 2)) {
+
+        return 0;
+
+    }
+
+    if (status >= 200 && status != 204 && status != 304) {
+
+        if (!buffer_append(output, "Content-Length: ", 16) ||
+            !buffer_append_decimal(output, (unsigned long)length) ||
+            !buffer_append(output, "\r\n", 2)) {
+
+            return 0;
+
+        }
+
+    }
+
+    if (content_type &&
+        (!buffer_append(output, "Content-Type: ", 14) ||
+         !buffer_append_string(output, content_type) ||
+         !buffer_append(output, "\r\n", 2))) {
+
+        return 0;
+
+    }
+
+    if (fields && !buffer_append_string(output, fields)) {
+
+        return 0;
+
+    }
+
+    if (!request->keep_alive) {
+
+        if (!buffer_append(output, "Connection: close\r\n", 19)) {
+
+            return 0;
+
+        }
+
+    } else if (request->head->minor_version == 0) {
+
+        if (!buffer_append(output, "Connection: keep-alive\r\n", 24)) {
+
+            return 0;
+
+        }
+
+    }
+
+    return buffer_append(output, connection->headers.data, connection->headers.length) &&
+           buffer_append(output, "\r\n", 2);
+
+}
+
+/*
+
+         is_head_request()
+	       ---
+	       checks whether a response must go without body.
+
+*/
+
+static int is_head_request(const commc_http_server_request_t* request) {
+
+    return request->head->method_length == 4 &&
+           memcmp(request->head->method, "HEAD", 4) == 0;
+
+}
+
+/*
+
+         finish_response()
+	       ---
+	       common tail of the respond calls.
+
+*/
+
+static void finish_response(commc_http_server_request_t* request) {
+
+    request->responded = 1;
+    request->connection->headers.length = 0;
+
+    if (!request->keep_alive) {
+
+        request->connection->close_after = 1;
+
+    }
+
+}
+
+/*
+
+         reject()
+	       ---
+	       answers a request that cannot be served and
+	       closes the connection after the answer.
+
+*/
+
+static int reject(commc_http_server_connection_t* connection,
+                  int                             status) {
+
+    commc_http_server_request_t request;
+    commc_http_parser_t         head;
+    const char*                 reason = status_reason(status);
+
+    /* the head may be unusable, so answer as for an HTTP/1.1 request */
+
+    commc_http_parser_init(&head, COMMC_HTTP_PARSER_REQUEST);
+    head.minor_version = 1;
+
+    memset(&request, 0, sizeof(request));
+    request.head       = &head;
+    request.connection = connection;
+
+    connection->headers.length = 0;
+
+    return commc_http_server_respond(&request, status, "text/plain; charset=utf-8",
+                                     reason, strlen(reason)) == COMMC_SUCCESS;
+
+}
+
+/*
+
+         find_route()
+	       ---
+	       returns the first route matching a request.
+
+*/
+
+static const server_route_t* find_route(const commc_http_server_t*         server,
+                                        const commc_http_server_request_t* request) {
+
+    const server_route_t* route;
+    size_t                i;
+
+    for (i = 0; i < server->route_count; i++) {
+
+        route = &server->routes[i];
+
+        if (route->method &&
+            (strlen(route->method) != request->head->method_length ||
+             memcmp(route->method, request->head->method, request->head->method_length) != 0)) {
+
+            continue;
+
+        }
+
+        if (route->prefix ? request->path_length >= route->length :
+                            request->path_length == route->length) {
+
+            if (memcmp(route->pattern, request->path, route->length) == 0) {
+
+                return route;
+
+            }
+
+        }
+
+    }
+
+    return NULL;
+
+}
+
+/*
+
+         dispatch()
+	       ---
+	       hands a complete request to its route and makes
+	       sure it is answered. returns 0 if no response
+	       could be queued.
+
+*/
+
+static int dispatch(commc_http_server_connection_t* connection,
+                    const char*                     body,
+                    size_t                          body_length) {
+
+    commc_http_server_request_t     request;
+    const commc_http_parser_t*      head = &connection->parser;
+    const commc_http_header_view_t* header;
+    const server_route_t*           route;
+    const char*                     question;
+    const char*                     message;
+
+    request.head        = head;
+    request.path        = head->target;
+    request.path_length = head->target_length;
+    request.query       = head->target + head->target_length;
+    request.query_length = 0;
+    request.body        = body;
+    request.body_length = body_length;
+    request.responded   = 0;
+    request.connection  = connection;
+
+    question = (const char*)memchr(head->target, '?', head->target_length);
+
+    if (question) {
+
+        request.path_length  = (size_t)(question - head->target);
+        request.query        = question + 1;
+        request.query_length = head->target_length - request.path_length - 1;
+
+    }
+
+    header = commc_http_parser_find_header(head, "Connection");
+
+    request.keep_alive = head->minor_version == 0 ? view_has_token(header, "keep-alive") :
+                                                    !view_has_token(header, "close");
+
+    connection->headers.length = 0;
+
+    route = find_route(connection->server, &request);
+
+    if (route) {
+
+        route->handler(&request, route->user_data);
+
+    }
+
+    if (!request.responded) {
+
+        message = route ? "handler did not respond" : "not found";
+
+        connection->headers.length = 0;
+
+        if (commc_http_server_respond(&request, route ? 500 : 404, "text/plain; charset=utf-8",
+                                      message, strlen(message)) != COMMC_SUCCESS) {
+
+            return 0;
+
+        }
+
+    }
+
+    return 1;
+
+}
+
+/*
+
+         process_input()
+	       ---
+	       answers the complete requests in the input
+	       buffer until the output is full enough to send or
+	       a file or close has to go first.
+
+	       returns:
+	       - 1 if something is queued to send, or the
+	         connection is to close
+	       - 0 if more input is needed
+	       - -1 if memory ran out
+
+*/
+
+static int process_input(commc_http_server_connection_t* connection) {
+
+    commc_http_server_t*              server = connection->server;
+    const commc_http_server_config_t* config = &server->config;
+    commc_http_parser_t*              parser = &connection->parser;
+    const commc_http_header_view_t*   header;
+    const char*                       data;
+    const char*                       body;
+    char*                             framed;
+    size_t                            available;
+    size_t                            body_length;
+    size_t                            content_length;
+    size_t                            decoded_length;
+    commc_error_t                     result;
+    int                               status;
+    int                               chunked;
+    int                               complete;
+
+    while (connection->output.length < SERVER_OUTPUT_LIMIT &&
+           connection->file == -1 && !connection->close_after) {
+
+        data      = connection->input + connection->input_start;
+        available = connection->input_end - connection->input_start;
+
+        if (available == 0) {
+
+            break;
+
+        }
+
+        if (!connection->parsing) {
+
+            commc_http_parser_init(parser, COMMC_HTTP_PARSER_REQUEST);
+            connection->parsing = 1;
+
+        }
+
+        result = commc_http_parser_execute(parser, data, available);
+
+        if (result == COMMC_ERROR_WOULD_BLOCK) {
+
+            if (available >= config->max_head && !reject(connection, 431)) {
+
+                return -1;
+
+            }
+
+            break;
+
+        }
+
+        connection->parsing = 0;
+        status              = 0;
+        body_length         = 0;
+        chunked             = 0;
+
+        if (result != COMMC_SUCCESS) {
+
+            status = result == COMMC_ERROR_BUFFER_TOO_SMALL ? 431 : 400;
+
+        } else if (parser->head_length > config->max_head) {
+
+            status = 431;
+
+        } else if ((header = commc_http_parser_find_header(parser, "Transfer-Encoding")) != NULL) {
+
+            /* chunked is the only framing taken; it wins over Content-Length */
+
+            chunked = commc_http_parser_view_equals(header->value, header->value_length, "chunked");
+            status  = chunked ? 0 : 501;
+
+        } else if ((header = commc_http_parser_find_header(parser, "Content-Length")) != NULL) {
+
+            if (!parse_content_length(header, &body_length)) {
+
+                status = 400;
+
+            } else if (body_length > config->max_body) {
+
+                status = 413;
+
+            }
+
+        }
+
+        if (status != 0) {
+
+            if (!reject(connection, status)) {
+
+                return -1;
+
+            }
+
+            break;
+
+        }
+
+        framed         = connection->input + connection->input_start + parser->head_length;
+        content_length = body_length;
+        complete       = available - parser->head_length >= body_length;
+
+        if (chunked) {
+
+            complete = read_chunked_body(framed, available - parser->head_length, config->max_body,
+                                         0, &body_length, &content_length);
+
+            /* framing may not outgrow its data without bound either */
+
+            if (complete == 0 && (available - parser->head_length) / 2 > config->max_body) {
+
+                complete = 413;
+
+            }
+
+            if (complete > 1) {
+
+                if (!reject(connection, complete)) {
+
+                    return -1;
+
+                }
+
+                break;
+
+            }
+
+        }
+
+        if (!complete) {
+
+            /* the body is still on its way: make room and wait for it */
+
+            if (!connection->continue_sent &&
+                view_has_token(commc_http_parser_find_header(parser, "Expect"), "100-continue")) {
+
+                if (!buffer_append(&connection->output, "HTTP/1.1 100 Continue\r\n\r\n", 25)) {
+
+                    return -1;
+
+                }
+
+                connection->continue_sent = 1;
+
+            }
+
+            if (!reserve_input(connection, chunked ? available : parser->head_length + body_length)) {
+
+                return -1;
+
+            }
+
+            break;
+
+        }
+
+        /* chunks are joined in place, ahead of their framing */
+
+        if (chunked) {
+
+            read_chunked_body(framed, available - parser->head_length, config->max_body,
+                              1, &body_length, &content_length);
+
+        }
+
+        body           = framed;
+        decoded_length = content_length;
+        header         = commc_http_parser_find_header(parser, "Content-Encoding");
+
+        if (header && content_length > 0 &&
+            !commc_http_parser_view_equals(header->value, header->value_length, "identity")) {
+
+            status = decode_body(server, header, body, content_length);
+
+            if (status != 0) {
+
+                if (!reject(connection, status)) {
+
+                    return -1;
+
+                }
+
+                break;
+
+            }
+
+            body           = server->decoded.data ? server->decoded.data : "";
+            decoded_length = server->decoded.length;
+
+        }
+
+        status = dispatch(connection, body, decoded_length);
+
+        server->decoded.length = 0;
+        buffer_release(&server->decoded, SERVER_OUTPUT_LIMIT);
+
+        if (!status) {
+
+            return -1;
+
+        }
+
+        connection->input_start  += parser->head_length + body_length;
+        connection->continue_sent = 0;
+
+    }
+
+    if (connection->input_start == connection->input_end) {
+
+        connection->input_start = 0;
+        connection->input_end   = 0;
+
+        if (connection->input_capacity > SERVER_BUFFER_SIZE) {
+
+            free(connection->input);
+
+            connection->input          = NULL;
+            connection->input_capacity = 0;
+
+        }
+
+    }
+
+    return connection->output.length > 0 || connection->file != -1 || connection->close_after;
+
+}
+
+/*
+
+         begin_draining()
+	       ---
+	       shuts the write side once the last response is
+	       out, and gives the peer SERVER_LINGER_MS to close
+	       its side while further input is discarded.
+
+*/
+
+static void begin_draining(commc_http_server_connection_t* connection) {
+
+#ifdef _WIN32
+    shutdown(connection->handle, SD_SEND);
+#else
+    shutdown(connection->handle, SHUT_WR);
+#endif
+
+    connection->draining    = 1;
+    connection->input_start = 0;
+    connection->input_end   = 0;
+
+    commc_async_timer_start(connection->server->ctx, &connection->timer,
+                            SERVER_LINGER_MS, 0);
+
+}
+
+/*
+
+         pump()
+	       ---
+	       moves a connection along: sends queued output,
+	       then a queued file, then answers what has arrived,
+	       and receives once nothing is left to send (or,
+	       once the connection is done, drains it).
+
+*/
+
+static void pump(commc_http_server_connection_t* connection) {
+
+    int processed;
+
+    for (;;) {
+
+        if (connection->output_sent < connection->output.length) {
+
+            if (!submit_io(connection, COMMC_ASYNC_OP_SEND,
+                           connection->output.data + connection->output_sent,
+                           connection->output.length - connection->output_sent)) {
+
+                close_connection(connection);
+
+            }
+
+            return;
+
+        }
+
+        connection->output.length = 0;
+        connection->output_sent   = 0;
+
+        buffer_release(&connection->output, SERVER_OUTPUT_LIMIT);
+
+        if (connection->file != -1) {
+
+            if (!submit_io(connection, COMMC_ASYNC_OP_SENDFILE, NULL, 0)) {
+
+                close_connection(connection);
+
+            }
+
+            return;
+
+        }
+
+        if (connection->close_after) {
+
+            if (!connection->draining) {
+
+                begin_draining(connection);
+
+            }
+
+            break;
+
+        }
+
+        processed = process_input(connection);
+
+        if (processed < 0) {
+
+            close_connection(connection);
+            return;
+
+        }
+
+        if (processed == 0) {
+
+            break;
+
+        }
+
+    }
+
+    if (!reserve_input(connection, 0) ||
+        !submit_io(connection, COMMC_ASYNC_OP_RECV,
+                   connection->input + connection->input_end,
+                   connection->input_capacity - connection->input_end)) {
+
+        close_connection(connection);
+
+    }
+
+}
+
+/*
+	==================================
+             --- ACCEPTING ---
+	==================================
+*/
+
+/*
+
+         accept_done()
+	       ---
+	       serves a new connection and keeps the next accept
+	       pending.
+
+*/
+
+static void accept_done(const commc_async_result_t* result) {
+
+    commc_http_server_t* server = (commc_http_server_t*)result->user_data;
+
+    server->accepting = 0;
+    server->pending--;
+
+    if (result->error_code == 0) {
+
+        if (server->destroying) {
+
+            SERVER_CLOSE_SOCKET(server->client);
+            return;
+
+        }
+
+        commc_http_server_adopt(server, server->client);
+
+    } else if (result->error_code == ECANCELED || server->destroying) {
+
+        return;
+
+    } else if (out_of_descriptors(result->error_code)) {
+
+        commc_async_timer_start(server->ctx, &server->backoff,
+                                COMMC_HTTP_SERVER_ACCEPT_BACKOFF_MS, 0);
+        return;
+
+    }
+
+    /* aborted handshakes and the like only affect that connection */
+
+    arm_accept(server);
+
+}
+
+/*
+
+         backoff_done()
+	       ---
+	       retries accepting after descriptor exhaustion.
+
+*/
+
+static void backoff_done(const commc_async_result_t* result) {
+
+    arm_accept((commc_http_server_t*)result->user_data);
+
+}
+
+/*
+
+         arm_accept()
+	       ---
+	       keeps one accept pending while there is room
+	       for another connection. returns 0 if the accept
+	       could not be submitted (a retry is scheduled).
+
+*/
+
+static int arm_accept(commc_http_server_t* server) {
+
+    if (server->listener == -1 || server->accepting || server->destroying ||
+        server->connection_count >= server->config.max_connections) {
+
+        return 1;
+
+    }
+
+    if (commc_async_accept(server->ctx, server->listener, &server->client,
+                           NULL, 0, accept_done, server) != 0) {
+
+        commc_async_timer_start(server->ctx, &server->backoff,
+                                COMMC_HTTP_SERVER_ACCEPT_BACKOFF_MS, 0);
+        return 0;
+
+    }
+
+    server->accepting = 1;
+    server->pending++;
+
+    return 1;
+
+}
+
+/*
+
+         open_listener()
+	       ---
+	       creates a non-blocking listening socket on the
+	       first address of host and port that binds.
+
+*/
+
+static int open_listener(const char* host,
+                         int         port,
+                         int         backlog) {
+
+    struct addrinfo  hints;
+    struct addrinfo* addresses;
+    struct addrinfo* address;
+    char             service[16];
+    int              handle = -1;
+    int              one    = 1;
+#ifdef _WIN32
+    unsigned long    mode   = 1;
+#else
+    int              flags;
+#endif
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_PASSIVE;
+
+    sprintf(service, "%d", port);
+
+    if (getaddrinfo(host, service, &hints, &addresses) != 0) {
+
+        return -1;
+
+    }
+
+    for (address = addresses; address; address = address->ai_next) {
+
+        handle = (int)socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+
+        if (handle == -1) {
+
+            continue;
+
+        }
+
+        setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+
+        if (bind(handle, address->ai_addr, address->ai_addrlen) == 0 &&
+            listen(handle, backlog) == 0) {
+
+            break;
+
+        }
+
+        SERVER_CLOSE_SOCKET(handle);
+        handle = -1;
+
+    }
+
+    freeaddrinfo(addresses);
+
+    if (handle == -1) {
+
+        return -1;
+
+    }
+
+#ifdef _WIN32
+    if (ioctlsocket(handle, FIONBIO, &mode) != 0) {
+#else
+    fcntl(handle, F_SETFD, FD_CLOEXEC);
+
+    flags = fcntl(handle, F_GETFL, 0);
+
+    if (flags == -1 || fcntl(handle, F_SETFL, flags | O_NONBLOCK) != 0) {
+#endif
+
+        SERVER_CLOSE_SOCKET(handle);
+        return -1;
+
+    }
+
+    return handle;
+
+}
+
+/*
+
+         local_port()
+	       ---
+	       returns the port a socket is bound to.
+
+*/
+
+static int local_port(int handle) {
+
+    struct sockaddr_storage address;
+    socklen_t               length = (socklen_t)sizeof(address);
+
+    if (getsockname(handle, (struct sockaddr*)&address, &length) != 0) {
+
+        return 0;
+
+    }
+
+    if (address.ss_family == AF_INET) {
+
+        return ntohs(((struct sockaddr_in*)&address)->sin_port);
+
+    }
+
+#ifdef AF_INET6
+    if (address.ss_family == AF_INET6) {
+
+        return ntohs(((struct sockaddr_in6*)&address)->sin6_port);
+
+    }
+#endif
+
+    return 0;
+
+}
+
+/*
+	==================================
+             --- CORE ---
+	==================================
+*/
+
+/*
+
+         commc_http_server_config_init()
+	       ---
+	       fills config with the defaults.
+
+*/
+
+void commc_http_server_config_init(commc_http_server_config_t* config) {
+
+    if (!config) {
+
+        return;
+
+    }
+
+    config->max_head        = COMMC_HTTP_SERVER_MAX_HEAD;
+    config->max_body        = COMMC_HTTP_SERVER_MAX_BODY;
+    config->idle_timeout_ms = COMMC_HTTP_SERVER_IDLE_TIMEOUT_MS;
+    config->max_connections = COMMC_HTTP_SERVER_MAX_CONNECTIONS;
+    config->backlog         = COMMC_HTTP_SERVER_BACKLOG;
+
+    config->compress_threshold = 0;
+    config->compress_level     = COMMC_HTTP_SERVER_COMPRESS_LEVEL;
+
+}
+
+/*
+
+         commc_http_server_create()
+	       ---
+	       creates a server on a context.
+
+*/
+
+commc_error_t commc_http_server_create(commc_http_server_t**             server,
+                                       commc_async_context_t*            ctx,
+                                       const commc_http_server_config_t* config) {
+
+    commc_http_server_t* new_server;
+
+    if (!server || !ctx) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    new_server = (commc_http_server_t*)calloc(1, sizeof(commc_http_server_t));
+
+    if (!new_server) {
+
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    if (config) {
+
+        new_server->config = *config;
+
+    } else {
+
+        commc_http_server_config_init(&new_server->config);
+
+    }
+
+    if (new_server->config.max_head == 0) {
+
+        new_server->config.max_head = COMMC_HTTP_SERVER_MAX_HEAD;
+
+    }
+
+    if (new_server->config.backlog <= 0) {
+
+        new_server->config.backlog = COMMC_HTTP_SERVER_BACKLOG;
+
+    }
+
+    if (new_server->config.compress_level < 1 || new_server->config.compress_level > 9) {
+
+        new_server->config.compress_level = COMMC_HTTP_SERVER_COMPRESS_LEVEL;
+
+    }
+
+    new_server->ctx      = ctx;
+    new_server->listener = -1;
+
+    commc_async_timer_init(&new_server->backoff, backoff_done, new_server);
+
+    *server = new_server;
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_http_server_destroy()
+	       ---
+	       closes everything and frees the server.
+
+*/
+
+void commc_http_server_destroy(commc_http_server_t* server) {
+
+    commc_http_server_connection_t* connection;
+    commc_http_server_connection_t* next;
+    size_t                          i;
+
+    if (!server) {
+
+        return;
+
+    }
+
+    server->destroying = 1;
+
+    commc_async_timer_stop(server->ctx, &server->backoff);
+
+    if (server->listener != -1) {
+
+        commc_async_remove_handle(server->ctx, server->listener);
+
+    }
+
+    for (connection = server->connections; connection; connection = next) {
+
+        next = connection->next;
+        close_connection(connection);
+
+    }
+
+    /* io_uring reports the cancellations from the next polls */
+
+    while (server->pending > 0) {
+
+        if (commc_async_poll(server->ctx, 100) < 0) {
+
+            break;
+
+        }
+
+    }
+
+    if (server->listener != -1) {
+
+        SERVER_CLOSE_SOCKET(server->listener);
+
+    }
+
+    for (i = 0; i < server->route_count; i++) {
+
+        free(server->routes[i].method);
+        free(server->routes[i].pattern);
+        free(server->routes[i].owned);
+
+    }
+
+    free(server->routes);
+
+    commc_flate_encoder_destroy(server->encoder);
+    commc_flate_decoder_destroy(server->decoder);
+    free(server->compressed.data);
+    free(server->decoded.data);
+
+    free(server);
+
+}
+
+/*
+
+         commc_http_server_listen()
+	       ---
+	       binds the listener and starts accepting.
+
+*/
+
+commc_error_t commc_http_server_listen(commc_http_server_t* server,
+                                       const char*          host,
+                                       int                  port) {
+
+    if (!server || port < 0 || port > 65535) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (server->listener != -1) {
+
+        return COMMC_ERROR_INVALID_STATE;
+
+    }
+
+    server->listener = open_listener(host, port, server->config.backlog);
+
+    if (server->listener == -1) {
+
+        return COMMC_IO_ERROR;
+
+    }
+
+    server->port = local_port(server->listener);
+
+    if (!arm_accept(server)) {
+
+        commc_async_timer_stop(server->ctx, &server->backoff);
+        SERVER_CLOSE_SOCKET(server->listener);
+
+        server->listener = -1;
+        server->port     = 0;
+
+        return COMMC_SYSTEM_ERROR;
+
+    }
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_http_server_get_port()
+	       ---
+	       returns the bound port.
+
+*/
+
+int commc_http_server_get_port(const commc_http_server_t* server) {
+
+    return server ? server->port : 0;
+
+}
+
+/*
+
+         commc_http_server_adopt()
+	       ---
+	       starts serving a connected socket.
+
+*/
+
+commc_error_t commc_http_server_adopt(commc_http_server_t* server,
+                                      int                  handle) {
+
+    commc_http_server_connection_t* connection;
+    int                             one = 1;
+#ifdef _WIN32
+    unsigned long                   mode = 1;
+#else
+    int                             flags;
+#endif
+
+    if (!server || handle < 0) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (server->destroying) {
+
+        SERVER_CLOSE_SOCKET(handle);
+        return COMMC_ERROR_INVALID_STATE;
+
+    }
+
+    connection = (commc_http_server_connection_t*)calloc(1, sizeof(commc_http_server_connection_t));
+
+    if (!connection) {
+
+        SERVER_CLOSE_SOCKET(handle);
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    /* accepted by commc_async_accept() it is non-blocking already; adopted, maybe not */
+
+#ifdef _WIN32
+    ioctlsocket(handle, FIONBIO, &mode);
+#else
+    flags = fcntl(handle, F_GETFL, 0);
+
+    if (flags != -1 && !(flags & O_NONBLOCK)) {
+
+        fcntl(handle, F_SETFL, flags | O_NONBLOCK);
+
+    }
+#endif
+
+    setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+
+    connection->server = server;
+    connection->handle = handle;
+    connection->file   = -1;
+    connection->next   = server->connections;
+
+    if (server->connections) {
+
+        server->connections->prev = connection;
+
+    }
+
+    server->connections = connection;
+    server->connection_count++;
+
+    commc_async_timer_init(&connection->timer, timeout_done, connection);
+
+    pump(connection);
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_http_server_get_connection_count()
+	       ---
+	       returns the number of open connections.
+
+*/
+
+size_t commc_http_server_get_connection_count(const commc_http_server_t* server) {
+
+    return server ? server->connection_count : 0;
+
+}
+
+/*
+	==================================
+             --- ROUTES ---
+	==================================
+*/
+
+/*
+
+         copy_string()
+	       ---
+	       duplicates a string, NULL staying NULL. returns
+	       0 if memory runs out.
+
+*/
+
+static int copy_string(char**      copy,
+                       const char* string) {
+
+    *copy = NULL;
+
+    if (!string) {
+
+        return 1;
+
+    }
+
+    *copy = (char*)malloc(strlen(string) + 1);
+
+    if (!*copy) {
+
+        return 0;
+
+    }
+
+    strcpy(*copy, string);
+
+    return 1;
+
+}
+
+/*
+
+         commc_http_server_route()
+	       ---
+	       adds a route.
+
+*/
+
+commc_error_t commc_http_server_route(commc_http_server_t*        server,
+                                      const char*                 method,
+                                      const char*                 pattern,
+                                      commc_http_server_handler_t handler,
+                                      void*                       user_data) {
+
+    server_route_t* routes;
+    server_route_t* route;
+    size_t          capacity;
+
+    if (!server || !pattern || !handler) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (server->route_count == server->route_capacity) {
+
+        capacity = server->route_capacity ? server->route_capacity * 2 : 8;
+        routes   = (server_route_t*)realloc(server->routes, capacity * sizeof(server_route_t));
+
+        if (!routes) {
+
+            return COMMC_MEMORY_ERROR;
+
+        }
+
+        server->routes         = routes;
+        server->route_capacity = capacity;
+
+    }
+
+    route = &server->routes[server->route_count];
+
+    if (!copy_string(&route->method, method) || !copy_string(&route->pattern, pattern)) {
+
+        free(route->method);
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    route->length    = strlen(pattern);
+    route->prefix    = route->length > 0 && pattern[route->length - 1] == '*';
+    route->handler   = handler;
+    route->user_data = user_data;
+    route->owned     = NULL;
+
+    if (route->prefix) {
+
+        route->length--;
+
+    }
+
+    server->route_count++;
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         hex_value()
+	       ---
+	       returns the value of a hex digit, or -1.
+
+*/
+
+static int hex_value(char c) {
+
+    if (c >= '0' && c <= '9') {
+
+        return c - '0';
+
+    }
+
+    if (c >= 'a' && c <= 'f') {
+
+        return c - 'a' + 10;
+
+    }
+
+    if (c >= 'A' && c <= 'F') {
+
+        return c - 'A' + 10;
+
+    }
+
+    return -1;
+
+}
+
+/*
+
+         decode_path()
+	       ---
+	       appends a percent-decoded request path to a file
+	       path, refusing ".." segments, backslashes and
+	       NUL. returns the new length, or 0 if refused or
+	       too long.
+
+*/
+
+static size_t decode_path(char*       file_path,
+                          size_t      length,
+                          const char* path,
+                          size_t      path_length) {
+
+    size_t start = length;
+    size_t segment;
+    size_t i;
+    int    high;
+    int    low;
+    char   c;
+
+    for (i = 0; i < path_length; i++) {
+
+        c = path[i];
+
+        if (c == '%') {
+
+            if (i + 2 >= path_length ||
+                (high = hex_value(path[i + 1])) < 0 || (low = hex_value(path[i + 2])) < 0) {
+
+                return 0;
+
+            }
+
+            c  = (char)(high * 16 + low);
+            i += 2;
+
+        }
+
+        if (c == '\0' || c == '\\' || length + 1 >= SERVER_MAX_PATH) {
+
+            return 0;
+
+        }
+
+        file_path[length++] = c;
+
+    }
+
+    /* decoding may have produced new separators, so check afterwards */
+
+    for (segment = start, i = start; i <= length; i++) {
+
+        if (i == length || file_path[i] == '/') {
+
+            if (i - segment == 2 && file_path[segment] == '.' && file_path[segment + 1] == '.') {
+
+                return 0;
+
+            }
+
+            segment = i + 1;
+
+        }
+
+    }
+
+    return length;
+
+}
+
+/*
+
+         directory_handler()
+	       ---
+	       route handler of commc_http_server_serve_directory().
+
+*/
+
+static void directory_handler(commc_http_server_request_t* request,
+                              void*                        user_data) {
+
+    server_directory_t* directory = (server_directory_t*)user_data;
+    char                file_path[SERVER_MAX_PATH];
+    size_t              length;
+    const char*         message;
+
+    if (!is_head_request(request) &&
+        (request->head->method_length != 3 || memcmp(request->head->method, "GET", 3) != 0)) {
+
+        message = "method not allowed";
+
+        commc_http_server_add_header(request, "Allow", "GET, HEAD");
+        commc_http_server_respond(request, 405, "text/plain; charset=utf-8",
+                                  message, strlen(message));
+        return;
+
+    }
+
+    message = "not found";
+    length  = directory->directory_length;
+
+    memcpy(file_path, directory->directory, length);
+    file_path[length++] = '/';
+
+    length = decode_path(file_path, length,
+                         request->path + directory->prefix_length,
+                         request->path_length - directory->prefix_length);
+
+    if (length == 0) {
+
+        commc_http_server_respond(request, 404, "text/plain; charset=utf-8",
+                                  message, strlen(message));
+        return;
+
+    }
+
+    if (file_path[length - 1] == '/') {
+
+        if (length + 11 >= SERVER_MAX_PATH) {
+
+            commc_http_server_respond(request, 404, "text/plain; charset=utf-8",
+                                      message, strlen(message));
+            return;
+
+        }
+
+        memcpy(file_path + length, "index.html", 10);
+        length += 10;
+
+    }
+
+    file_path[length] = '\0';
+
+    if (commc_http_server_respond_file(request, 200, NULL, file_path) == COMMC_IO_ERROR) {
+
+        commc_http_server_respond(request, 404, "text/plain; charset=utf-8",
+                                  message, strlen(message));
+
+    }
+
+}
+
+/*
+
+         commc_http_server_serve_directory()
+	       ---
+	       adds a static file route.
+
+*/
+
+commc_error_t commc_http_server_serve_directory(commc_http_server_t* server,
+                                                const char*          prefix,
+                                                const char*          directory) {
+
+    server_directory_t* state;
+    char*               pattern;
+    size_t              prefix_length;
+    size_t              directory_length;
+    commc_error_t       result;
+
+    if (!server || !prefix || !directory) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    prefix_length    = strlen(prefix);
+    directory_length = strlen(directory);
+
+    while (directory_length > 1 && directory[directory_length - 1] == '/') {
+
+        directory_length--;
+
+    }
+
+    if (directory_length + 2 >= SERVER_MAX_PATH) {
+
+        return COMMC_ERROR_BUFFER_TOO_SMALL;
+
+    }
+
+    state   = (server_directory_t*)malloc(sizeof(server_directory_t) + directory_length);
+    pattern = (char*)malloc(prefix_length + 2);
+
+    if (!state || !pattern) {
+
+        free(state);
+        free(pattern);
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    state->prefix_length    = prefix_length;
+    state->directory_length = directory_length;
+
+    memcpy(state->directory, directory, directory_length);
+    state->directory[directory_length] = '\0';
+
+    memcpy(pattern, prefix, prefix_length);
+    pattern[prefix_length]     = '*';
+    pattern[prefix_length + 1] = '\0';
+
+    result = commc_http_server_route(server, NULL, pattern, directory_handler, state);
+
+    free(pattern);
+
+    if (result != COMMC_SUCCESS) {
+
+        free(state);
+        return result;
+
+    }
+
+    server->routes[server->route_count - 1].owned = state;
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+	==================================
+            --- RESPONSES ---
+	==================================
+*/
+
+/*
+
+         commc_http_server_add_header()
+	       ---
+	       adds a field to the pending response.
+
+*/
+
+commc_error_t commc_http_server_add_header(commc_http_server_request_t* request,
+                                           const char*                  name,
+                                           const char*                  value) {
+
+    server_buffer_t* headers;
+    size_t           mark;
+
+    if (!request || !request->connection || !name || !value) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (request->responded) {
+
+        return COMMC_ERROR_INVALID_STATE;
+
+    }
+
+    headers = &request->connection->headers;
+    mark    = headers->length;
+
+    if (!buffer_append_string(headers, name) ||
+        !buffer_append(headers, ": ", 2) ||
+        !buffer_append_string(headers, value) ||
+        !buffer_append(headers, "\r\n", 2)) {
+
+        headers->length = mark;
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_http_server_respond()
+	       ---
+	       queues a response with an in-memory body.
+
+*/
+
+commc_error_t commc_http_server_respond(commc_http_server_request_t* request,
+                                        int                          status,
+                                        const char*                  content_type,
+                                        const void*                  body,
+                                        size_t                       length) {
+
+    commc_http_server_t* server;
+    server_buffer_t*     output;
+    const char*          fields = NULL;
+    size_t               mark;
+    int                  queued;
+
+    if (!request || !request->connection || status < 100 || status > 999 ||
+        (!body && length > 0)) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (request->responded) {
+
+        return COMMC_ERROR_INVALID_STATE;
+
+    }
+
+    server = request->connection->server;
+    output = &request->connection->output;
+    mark   = output->length;
+
+    /* a HEAD answer announces the GET one's headers but has no body to gzip */
+
+    if (!is_head_request(request) && server->config.compress_threshold > 0 &&
+        length >= server->config.compress_threshold &&
+        status >= 200 && status != 204 && status != 304 && is_compressible(content_type)) {
+
+        fields = "Vary: Accept-Encoding\r\n";
+
+        if (accepts_gzip(commc_http_parser_find_header(request->head, "Accept-Encoding")) &&
+            compress_body(server, body, length)) {
+
+            fields = "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n";
+            body   = server->compressed.data;
+            length = server->compressed.length;
+
+        }
+
+    }
+
+    queued = queue_response(request, status, content_type, length, fields) &&
+             (is_head_request(request) || buffer_append(output, body, length));
+
+    server->compressed.length = 0;
+    buffer_release(&server->compressed, SERVER_OUTPUT_LIMIT);
+
+    if (!queued) {
+
+        output->length = mark;
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    finish_response(request);
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_http_server_respond_file()
+	       ---
+	       queues a response whose body is sent from a file.
+
+*/
+
+commc_error_t commc_http_server_respond_file(commc_http_server_request_t* request,
+                                             int                          status,
+                                             const char*                  content_type,
+                                             const char*                  path) {
+
+    commc_http_server_connection_t* connection;
+    SERVER_STAT                     info;
+    size_t                          mark;
+    int                             file;
+
+    if (!request || !request->connection || !path || status < 100 || status > 999) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (request->responded) {
+
+        return COMMC_ERROR_INVALID_STATE;
+
+    }
+
+    connection = request->connection;
+    file       = SERVER_OPEN_FILE(path);
+
+    if (file == -1) {
+
+        return COMMC_IO_ERROR;
+
+    }
+
+    if (SERVER_FSTAT(file, &info) != 0 || !SERVER_IS_REGULAR(info.st_mode)) {
+
+        SERVER_CLOSE_FILE(file);
+        return COMMC_IO_ERROR;
+
+    }
+
+    mark = connection->output.length;
+
+    if (!queue_response(request, status, content_type ? content_type : guess_content_type(path),
+                        (size_t)info.st_size, NULL)) {
+
+        connection->output.length = mark;
+        SERVER_CLOSE_FILE(file);
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    if (is_head_request(request) || info.st_size == 0) {
+
+        SERVER_CLOSE_FILE(file);
+
+    } else {
+
+        connection->file           = file;
+        connection->file_offset    = 0;
+        connection->file_remaining = (size_t)info.st_size;
+
+    }
+
+    finish_response(request);
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
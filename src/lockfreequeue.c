@@ -22,6 +22,18 @@
     
     memory management uses a combination of hazard pointers and reference
     counting to safely reclaim memory without requiring a garbage collector.
+    
+    memory ordering follows the usual hazard pointer pairing: a hazard
+    is published with a relaxed store followed by a full fence before
+    the protected pointer is re-validated, and the reclaimer issues a
+    full fence after unlinking nodes before it scans the hazards. all
+    other accesses use acquire loads and release stores, and the size
+    and retired counters are relaxed.
+    
+    queues created with an epoch scheme (commc/epoch.h) wrap every
+    public operation in an epoch guard instead. the algorithm code is
+    shared: hazard acquisition returns a placeholder that needs no
+    publication, and retired nodes go to per-thread limbo lists.
 
 */
 
@@ -32,6 +44,7 @@
 */
 
 #include "commc/lockfreequeue.h"
+#include "commc/epoch.h"
 #include "commc/error.h"
 
 #include <stdlib.h>
@@ -57,7 +70,6 @@
 */
 
 #define COMMC_LF_QUEUE_CLEANUP_THRESHOLD    100    /* retire nodes before cleanup */
-#define COMMC_LF_QUEUE_MAX_CLEANUP_BATCH    50     /* max nodes cleaned per batch */
 
 /*
 	==================================
@@ -87,7 +99,10 @@ static commc_lf_queue_node_t* allocate_node(void* data) {
   
   node->data = data;
   node->next = commc_lf_queue_tagged_ptr_create(NULL);
-  node->ref_count = 1;
+  node->ref_count = 0;
+  node->retired_next = NULL;
+  node->epoch_entry.next    = NULL;
+  node->epoch_entry.free_fn = NULL;
   
   return node;
   
@@ -111,7 +126,7 @@ static void free_node(commc_lf_queue_node_t* node) {
   
   /* ensure reference count has reached zero */
   
-  if (COMMC_ATOMIC_LOAD(&node->ref_count) != 0) {
+  if (COMMC_ATOMIC_LOAD_ACQUIRE(&node->ref_count) != 0) {
 
     return; /* still referenced, cannot free */
     
@@ -121,6 +136,89 @@ static void free_node(commc_lf_queue_node_t* node) {
   
 }
 
+/*
+
+         free_epoch_node()
+	       ---
+	       epoch domain destructor for retired nodes.
+
+*/
+
+static void free_epoch_node(commc_epoch_entry_t* entry) {
+
+  free((char*)entry - offsetof(commc_lf_queue_node_t, epoch_entry));
+
+}
+
+/*
+
+    in the epoch schemes a whole operation is protected by the
+    epoch guard, so hazard acquisition hands out this shared
+    placeholder without touching it. the hazard helpers below
+    recognise it and do nothing, which keeps the algorithm code
+    identical for every scheme.
+
+*/
+
+static commc_lf_queue_hazard_t epoch_guard_hazard;
+
+/*
+
+         reclaim_enter()
+	       ---
+	       opens the epoch guard for one operation. in hazard mode
+	       *guard is NULL. returns 0 if the thread record could not
+	       be allocated.
+
+*/
+
+static int reclaim_enter(commc_lf_queue_t* queue, commc_epoch_record_t** guard) {
+
+  *guard = NULL;
+
+  if (queue->reclaim == COMMC_LF_QUEUE_RECLAIM_HAZARD) {
+
+    return 1;
+    
+  }
+  
+  *guard = commc_epoch_self(queue->epoch);
+  
+  if (!*guard) {
+
+    return 0;
+    
+  }
+  
+  commc_epoch_online(*guard);   /* QSBR only */
+  commc_epoch_enter(*guard);    /* EBR only */
+  
+  return 1;
+  
+}
+
+/*
+
+         reclaim_exit()
+	       ---
+	       closes the epoch guard. QSBR threads report a quiescent
+	       state here since they hold no node references any more.
+
+*/
+
+static void reclaim_exit(commc_epoch_record_t* guard) {
+
+  if (!guard) {
+
+    return;
+    
+  }
+  
+  commc_epoch_exit(guard);        /* EBR only */
+  commc_epoch_quiescent(guard);   /* QSBR only */
+  
+}
+
 /*
 
          get_thread_local_data()
@@ -149,7 +247,7 @@ static commc_lf_queue_thread_data_t* get_thread_local_data(commc_lf_queue_t* que
 
     thread_data = &queue->thread_data[i];
     
-    if (thread_data->thread_id == thread_id) {
+    if (COMMC_ATOMIC_LOAD_ACQUIRE(&thread_data->thread_id) == thread_id) {
 
       return thread_data;
       
@@ -157,7 +255,7 @@ static commc_lf_queue_thread_data_t* get_thread_local_data(commc_lf_queue_t* que
     
     /* try to claim an unused slot */
     
-    if (thread_data->thread_id == 0) {
+    if (COMMC_ATOMIC_LOAD_RELAXED(&thread_data->thread_id) == 0) {
 
       if (COMMC_ATOMIC_CAS(&thread_data->thread_id, 0, thread_id)) {
 
@@ -167,8 +265,8 @@ static commc_lf_queue_thread_data_t* get_thread_local_data(commc_lf_queue_t* que
         
         for (j = 0; j < COMMC_LF_QUEUE_HAZARDS_PER_THREAD; j++) {
 
-          thread_data->hazards[j].node = NULL;
-          thread_data->hazards[j].active = 0;
+          COMMC_ATOMIC_STORE_RELAXED((void**)&thread_data->hazards[j].node, NULL);
+          COMMC_ATOMIC_STORE_RELEASE(&thread_data->hazards[j].active, 0);
           
         }
         
@@ -198,6 +296,12 @@ static commc_lf_queue_hazard_t* acquire_hazard_pointer(commc_lf_queue_t* queue,
   commc_lf_queue_thread_data_t* thread_data;
   unsigned long                 i;
   
+  if (queue->reclaim != COMMC_LF_QUEUE_RECLAIM_HAZARD) {
+
+    return &epoch_guard_hazard; /* protected by the epoch guard */
+    
+  }
+  
   thread_data = get_thread_local_data(queue);
   
   if (!thread_data) {
@@ -210,21 +314,18 @@ static commc_lf_queue_hazard_t* acquire_hazard_pointer(commc_lf_queue_t* queue,
   
   for (i = 0; i < COMMC_LF_QUEUE_HAZARDS_PER_THREAD; i++) {
 
-    if (COMMC_ATOMIC_CAS(&thread_data->hazards[i].active, 0, 1)) {
+    if (COMMC_ATOMIC_LOAD_RELAXED(&thread_data->hazards[i].active) == 0 &&
+        COMMC_ATOMIC_CAS(&thread_data->hazards[i].active, 0, 1)) {
 
-      /* claimed hazard pointer, protect the node */
+      /* claimed hazard pointer, protect the node. the full fence
+         orders the publication before the caller re-validates the
+         source pointer (store-load ordering). the node must not be
+         touched before that validation, since it may already have
+         been reclaimed */
       
-      (void)COMMC_ATOMIC_STORE((void**)&thread_data->hazards[i].node, node);
+      COMMC_ATOMIC_STORE_RELAXED((void**)&thread_data->hazards[i].node, (void*)node);
       COMMC_MEMORY_BARRIER();
       
-      /* increment node reference count */
-      
-      if (node) {
-
-        COMMC_ATOMIC_INC(&node->ref_count);
-        
-      }
-      
       return &thread_data->hazards[i];
       
     }
@@ -239,36 +340,48 @@ static commc_lf_queue_hazard_t* acquire_hazard_pointer(commc_lf_queue_t* queue,
 
          release_hazard_pointer()
 	       ---
-	       releases a hazard pointer and decrements node reference count.
+	       releases a hazard pointer so the node may be reclaimed.
 
 */
 
 static void release_hazard_pointer(commc_lf_queue_hazard_t* hazard) {
 
-  commc_lf_queue_node_t* node;
-  
-  if (!hazard || !COMMC_ATOMIC_LOAD(&hazard->active)) {
+  if (!hazard || hazard == &epoch_guard_hazard || 
+      !COMMC_ATOMIC_LOAD_RELAXED(&hazard->active)) {
 
     return;
     
   }
   
-  node = (commc_lf_queue_node_t*)COMMC_ATOMIC_LOAD((void**)&hazard->node);
-  
-  /* clear the hazard */
+  /* clear the hazard; release keeps our reads of the node above it */
   
-  (void)COMMC_ATOMIC_STORE((void**)&hazard->node, NULL);
-  COMMC_MEMORY_BARRIER();
-  (void)COMMC_ATOMIC_STORE(&hazard->active, 0);
-  
-  /* decrement reference count */
+  COMMC_ATOMIC_STORE_RELEASE((void**)&hazard->node, NULL);
+  COMMC_ATOMIC_STORE_RELEASE(&hazard->active, 0);
   
-  if (node) {
+}
+
+/*
+
+         reprotect_hazard_pointer()
+	       ---
+	       moves an already-held hazard pointer to a new node without
+	       giving up the slot. used when walking a chain so that a
+	       single acquisition covers the whole traversal.
+
+*/
+
+static void reprotect_hazard_pointer(commc_lf_queue_hazard_t* hazard,
+                                     commc_lf_queue_node_t* node) {
 
-    COMMC_ATOMIC_DEC(&node->ref_count);
+  if (hazard == &epoch_guard_hazard) {
+
+    return;
     
   }
   
+  COMMC_ATOMIC_STORE_RELAXED((void**)&hazard->node, (void*)node);
+  COMMC_MEMORY_BARRIER();
+
 }
 
 /*
@@ -296,7 +409,7 @@ static int is_node_hazardous(commc_lf_queue_t* queue, commc_lf_queue_node_t* nod
 
     commc_lf_queue_thread_data_t* thread_data = &queue->thread_data[i];
     
-    if (thread_data->thread_id == 0) {
+    if (COMMC_ATOMIC_LOAD_ACQUIRE(&thread_data->thread_id) == 0) {
 
       continue; /* unused thread slot */
       
@@ -304,10 +417,10 @@ static int is_node_hazardous(commc_lf_queue_t* queue, commc_lf_queue_node_t* nod
     
     for (j = 0; j < COMMC_LF_QUEUE_HAZARDS_PER_THREAD; j++) {
 
-      if (COMMC_ATOMIC_LOAD(&thread_data->hazards[j].active)) {
+      if (COMMC_ATOMIC_LOAD_ACQUIRE(&thread_data->hazards[j].active)) {
 
         commc_lf_queue_node_t* hazardous_node = 
-          (commc_lf_queue_node_t*)COMMC_ATOMIC_LOAD((void**)&thread_data->hazards[j].node);
+          (commc_lf_queue_node_t*)COMMC_ATOMIC_LOAD_ACQUIRE((void**)&thread_data->hazards[j].node);
           
         if (hazardous_node == node) {
 
@@ -373,7 +486,8 @@ commc_lf_queue_tagged_ptr_t commc_lf_queue_tagged_ptr_advance(commc_lf_queue_tag
 
          commc_lf_queue_tagged_ptr_load()
 	       ---
-	       atomically loads a tagged pointer with memory barriers.
+	       loads a tagged pointer with acquire ordering, so the
+	       pointee's contents are visible once the pointer is.
 
 */
 
@@ -387,12 +501,10 @@ commc_lf_queue_tagged_ptr_t commc_lf_queue_tagged_ptr_load(volatile commc_lf_que
     
   }
   
-  /* atomic load with memory barrier */
+  /* acquire loads; no full fences are needed on the read side */
   
-  COMMC_MEMORY_BARRIER();
-  result.ptr = COMMC_ATOMIC_LOAD((void**)&target->ptr);
-  result.tag = COMMC_ATOMIC_LOAD(&target->tag);
-  COMMC_MEMORY_BARRIER();
+  result.ptr = COMMC_ATOMIC_LOAD_ACQUIRE((void**)&target->ptr);
+  result.tag = COMMC_ATOMIC_LOAD_ACQUIRE(&target->tag);
   
   return result;
   
@@ -436,9 +548,9 @@ int commc_lf_queue_tagged_ptr_cas(volatile commc_lf_queue_tagged_ptr_t* target,
     
     if (COMMC_ATOMIC_CAS((void**)&target->ptr, expected.ptr, new_value.ptr)) {
 
-      /* pointer CAS succeeded, now update tag */
+      /* pointer CAS succeeded, now publish the tag */
       
-      (void)COMMC_ATOMIC_STORE(&target->tag, new_value.tag);
+      COMMC_ATOMIC_STORE_RELEASE(&target->tag, new_value.tag);
       return 1;
       
     }
@@ -473,16 +585,42 @@ int commc_lf_queue_tagged_ptr_cas(volatile commc_lf_queue_tagged_ptr_t* target,
 
          commc_lf_queue_create()
 	       ---
-	       creates a new lock-free queue with hazard pointer management.
+	       creates a new lock-free queue with the default
+	       reclamation scheme.
 
 */
 
 commc_lf_queue_t* commc_lf_queue_create(unsigned long max_threads) {
 
+  return commc_lf_queue_create_with_reclaim(max_threads, COMMC_LF_QUEUE_DEFAULT_RECLAIM);
+  
+}
+
+/*
+
+         commc_lf_queue_create_with_reclaim()
+	       ---
+	       creates a new lock-free queue with the given reclamation
+	       scheme. hazard mode allocates per-thread hazard slots,
+	       the epoch schemes allocate an epoch domain instead.
+
+*/
+
+commc_lf_queue_t* commc_lf_queue_create_with_reclaim(unsigned long max_threads,
+                                                     commc_lf_queue_reclaim_t reclaim) {
+
   commc_lf_queue_t*       queue;
   commc_lf_queue_node_t*  dummy_node;
   size_t                  thread_data_size;
   
+  if (reclaim != COMMC_LF_QUEUE_RECLAIM_HAZARD &&
+      reclaim != COMMC_LF_QUEUE_RECLAIM_EBR &&
+      reclaim != COMMC_LF_QUEUE_RECLAIM_QSBR) {
+
+    return NULL;
+    
+  }
+  
   if (max_threads == 0) {
 
     max_threads = 16; /* reasonable default */
@@ -517,6 +655,29 @@ commc_lf_queue_t* commc_lf_queue_create(unsigned long max_threads) {
   queue->max_threads = max_threads;
   queue->retired_nodes = NULL;
   queue->retired_count = 0;
+  queue->reclaim = reclaim;
+  queue->epoch = NULL;
+  queue->thread_data = NULL;
+  
+  if (reclaim != COMMC_LF_QUEUE_RECLAIM_HAZARD) {
+
+    /* epoch schemes: no hazard slots, no thread cap */
+    
+    queue->max_threads = 0;
+    queue->epoch = commc_epoch_create(reclaim == COMMC_LF_QUEUE_RECLAIM_QSBR ?
+                                      COMMC_EPOCH_QSBR : COMMC_EPOCH_EBR);
+    
+    if (!queue->epoch) {
+
+      free_node(dummy_node);
+      free(queue);
+      return NULL;
+      
+    }
+    
+    return queue;
+    
+  }
   
   /* allocate thread data for hazard pointers */
   
@@ -574,12 +735,20 @@ void commc_lf_queue_destroy(commc_lf_queue_t* queue) {
   
   while (current) {
 
-    next = (commc_lf_queue_node_t*)current->next.ptr;
+    next = current->retired_next;
     free(current);
     current = next;
     
   }
   
+  /* free nodes still waiting in the epoch domain */
+  
+  if (queue->epoch) {
+
+    commc_epoch_destroy(queue->epoch);
+    
+  }
+  
   /* free thread data */
   
   if (queue->thread_data) {
@@ -600,7 +769,7 @@ void commc_lf_queue_destroy(commc_lf_queue_t* queue) {
 
 */
 
-commc_error_t commc_lf_queue_enqueue(commc_lf_queue_t* queue, void* data) {
+static commc_error_t enqueue_internal(commc_lf_queue_t* queue, void* data) {
 
   commc_lf_queue_node_t*     new_node;
   commc_lf_queue_hazard_t*   tail_hazard;
@@ -677,7 +846,7 @@ commc_error_t commc_lf_queue_enqueue(commc_lf_queue_t* queue, void* data) {
         
         /* increment size counter */
         
-        COMMC_ATOMIC_INC(&queue->size);
+        COMMC_ATOMIC_ADD_RELAXED(&queue->size, 1);
         
         break; /* enqueue successful */
         
@@ -728,7 +897,7 @@ commc_error_t commc_lf_queue_enqueue(commc_lf_queue_t* queue, void* data) {
   
   /* periodic cleanup of retired nodes */
   
-  if (COMMC_ATOMIC_LOAD(&queue->retired_count) > COMMC_LF_QUEUE_CLEANUP_THRESHOLD) {
+  if (COMMC_ATOMIC_LOAD_RELAXED(&queue->retired_count) > COMMC_LF_QUEUE_CLEANUP_THRESHOLD) {
 
     commc_lf_queue_cleanup_retired(queue);
     
@@ -738,6 +907,40 @@ commc_error_t commc_lf_queue_enqueue(commc_lf_queue_t* queue, void* data) {
   
 }
 
+/*
+
+         commc_lf_queue_enqueue()
+	       ---
+	       public entry point; runs the operation inside the
+	       reclamation guard of the queue's scheme.
+
+*/
+
+commc_error_t commc_lf_queue_enqueue(commc_lf_queue_t* queue, void* data) {
+
+  commc_epoch_record_t* guard;
+  commc_error_t         result;
+  
+  if (!queue) {
+
+    return COMMC_ARGUMENT_ERROR;
+    
+  }
+  
+  if (!reclaim_enter(queue, &guard)) {
+
+    return COMMC_MEMORY_ERROR;
+    
+  }
+  
+  result = enqueue_internal(queue, data);
+  
+  reclaim_exit(guard);
+  
+  return result;
+  
+}
+
 /*
 
          commc_lf_queue_dequeue()
@@ -746,7 +949,7 @@ commc_error_t commc_lf_queue_enqueue(commc_lf_queue_t* queue, void* data) {
 
 */
 
-commc_error_t commc_lf_queue_dequeue(commc_lf_queue_t* queue, void** data) {
+static commc_error_t dequeue_internal(commc_lf_queue_t* queue, void** data) {
 
   commc_lf_queue_hazard_t*   head_hazard;
   commc_lf_queue_hazard_t*   tail_hazard;
@@ -823,6 +1026,8 @@ commc_error_t commc_lf_queue_dequeue(commc_lf_queue_t* queue, void** data) {
 
       if (next.ptr == NULL) {
 
+        release_hazard_pointer(head_hazard);
+        head_hazard = NULL;
         continue; /* inconsistent state, retry */
         
       }
@@ -834,9 +1039,27 @@ commc_error_t commc_lf_queue_dequeue(commc_lf_queue_t* queue, void** data) {
       if (!next_hazard) {
 
         release_hazard_pointer(head_hazard);
+        head_hazard = NULL;
         continue;
         
       }
+
+      /* next is only safe to read if head still points at its
+         predecessor after the hazard was published */
+
+      {
+        commc_lf_queue_tagged_ptr_t current_head = commc_lf_queue_tagged_ptr_load(&queue->head);
+
+        if (current_head.ptr != head.ptr || current_head.tag != head.tag) {
+
+          release_hazard_pointer(next_hazard);
+          release_hazard_pointer(head_hazard);
+          next_hazard = NULL;
+          head_hazard = NULL;
+          continue;
+
+        }
+      }
       
       /* read data before attempting to dequeue */
       
@@ -855,7 +1078,7 @@ commc_error_t commc_lf_queue_dequeue(commc_lf_queue_t* queue, void** data) {
         
         /* decrement size */
         
-        COMMC_ATOMIC_DEC(&queue->size);
+        COMMC_ATOMIC_SUB_RELAXED(&queue->size, 1);
         
         /* retire the old head node */
         
@@ -912,161 +1135,667 @@ commc_error_t commc_lf_queue_dequeue(commc_lf_queue_t* queue, void** data) {
     
   }
   
+  /* dequeuers retire nodes, so they must also reclaim them;
+     otherwise a drain with no concurrent enqueues grows the
+     retired list without bound */
+  
+  if (COMMC_ATOMIC_LOAD_RELAXED(&queue->retired_count) > COMMC_LF_QUEUE_CLEANUP_THRESHOLD) {
+
+    commc_lf_queue_cleanup_retired(queue);
+    
+  }
+  
   return COMMC_SUCCESS;
   
 }
 
-/*
-	==================================
-             --- UTILITY FUNCTIONS ---
-	==================================
-*/
-
 /*
 
-         commc_lf_queue_is_empty()
+         commc_lf_queue_dequeue()
 	       ---
-	       checks if queue appears empty (snapshot).
+	       public entry point; runs the operation inside the
+	       reclamation guard of the queue's scheme.
 
 */
 
-int commc_lf_queue_is_empty(const commc_lf_queue_t* queue) {
+commc_error_t commc_lf_queue_dequeue(commc_lf_queue_t* queue, void** data) {
 
-  commc_lf_queue_tagged_ptr_t head;
-  commc_lf_queue_tagged_ptr_t tail;
-  commc_lf_queue_tagged_ptr_t next;
+  commc_epoch_record_t* guard;
+  commc_error_t         result;
   
   if (!queue) {
 
-    return 1;
+    return COMMC_ARGUMENT_ERROR;
     
   }
   
-  head = commc_lf_queue_tagged_ptr_load((volatile commc_lf_queue_tagged_ptr_t*)&queue->head);
-  tail = commc_lf_queue_tagged_ptr_load((volatile commc_lf_queue_tagged_ptr_t*)&queue->tail);
-  
-  if (head.ptr != tail.ptr) {
+  if (!reclaim_enter(queue, &guard)) {
 
-    return 0; /* definitely not empty */
+    return COMMC_MEMORY_ERROR;
     
   }
   
-  /* head == tail, check if next pointer is NULL */
+  result = dequeue_internal(queue, data);
   
-  next = commc_lf_queue_tagged_ptr_load((volatile commc_lf_queue_tagged_ptr_t*)&((commc_lf_queue_node_t*)head.ptr)->next);
+  reclaim_exit(guard);
   
-  return (next.ptr == NULL) ? 1 : 0;
+  return result;
   
 }
 
 /*
 
-         commc_lf_queue_size()
+         commc_lf_queue_enqueue_batch()
 	       ---
-	       returns approximate queue size.
+	       publishes a pre-built chain of nodes with one link CAS.
 
 */
 
-unsigned long commc_lf_queue_size(const commc_lf_queue_t* queue) {
-
-  if (!queue) {
+static commc_error_t enqueue_batch_internal(commc_lf_queue_t* queue, 
+                                            void** items, size_t count) {
 
-    return 0;
-    
-  }
-  
-  return COMMC_ATOMIC_LOAD((volatile unsigned long*)&queue->size);
-  
-}
+  commc_lf_queue_node_t*      first;
+  commc_lf_queue_node_t*      last;
+  commc_lf_queue_node_t*      node;
+  commc_lf_queue_hazard_t*    tail_hazard;
+  commc_lf_queue_tagged_ptr_t tail;
+  commc_lf_queue_tagged_ptr_t next;
+  commc_lf_queue_tagged_ptr_t new_tail;
+  size_t                      i;
 
-/*
+  if (!queue || (!items && count > 0)) {
 
-         commc_lf_queue_retire_node()
-	       ---
-	       adds node to retired list for deferred cleanup.
+    return COMMC_ARGUMENT_ERROR;
 
-*/
+  }
 
-void commc_lf_queue_retire_node(commc_lf_queue_t* queue, commc_lf_queue_node_t* node) {
+  if (count == 0) {
 
-  if (!queue || !node) {
+    return COMMC_SUCCESS;
 
-    return;
-    
   }
-  
-  /* add to retired list */
-  
-  do {
 
-    commc_lf_queue_node_t* old_head = queue->retired_nodes;
-    node->next.ptr = old_head;
-    
-  } while (!COMMC_ATOMIC_CAS((void**)&queue->retired_nodes, 
-                             (void*)node->next.ptr, (void*)node));
-  
-  /* increment retired count */
-  
-  COMMC_ATOMIC_INC(&queue->retired_count);
-  
-}
+  /* build the private chain; nothing is visible to other threads yet */
 
-/*
+  first = allocate_node(items[0]);
 
-         commc_lf_queue_cleanup_retired()
-	       ---
-	       safely reclaims retired nodes not protected by hazard pointers.
+  if (!first) {
 
-*/
+    return COMMC_MEMORY_ERROR;
 
-void commc_lf_queue_cleanup_retired(commc_lf_queue_t* queue) {
+  }
 
-  commc_lf_queue_node_t* current;
-  commc_lf_queue_node_t* next;
-  commc_lf_queue_node_t* prev;
-  unsigned long          cleaned;
-  
-  if (!queue) {
+  last = first;
 
-    return;
-    
-  }
-  
-  prev = NULL;
-  current = queue->retired_nodes;
-  cleaned = 0;
-  
-  while (current && cleaned < COMMC_LF_QUEUE_MAX_CLEANUP_BATCH) {
+  for (i = 1; i < count; i++) {
 
-    next = (commc_lf_queue_node_t*)current->next.ptr;
-    
-    if (!is_node_hazardous(queue, current) && 
-        COMMC_ATOMIC_LOAD(&current->ref_count) == 0) {
+    node = allocate_node(items[i]);
 
-      /* node is safe to free */
-      
-      if (prev) {
+    if (!node) {
 
-        prev->next.ptr = next;
-        
-      } else {
+      while (first) {
+
+        node  = (commc_lf_queue_node_t*)first->next.ptr;
+        free(first);
+        first = node;
 
-        queue->retired_nodes = next;
-        
       }
-      
-      free(current);
-      cleaned++;
-      COMMC_ATOMIC_DEC(&queue->retired_count);
-      
-    } else {
 
-      prev = current;
-      
+      return COMMC_MEMORY_ERROR;
+
     }
-    
-    current = next;
-    
+
+    last->next.ptr = node;
+    last           = node;
+
+  }
+
+  while (1) {
+
+    tail        = commc_lf_queue_tagged_ptr_load(&queue->tail);
+    tail_hazard = acquire_hazard_pointer(queue, (commc_lf_queue_node_t*)tail.ptr);
+
+    if (!tail_hazard) {
+
+      continue; /* no hazard pointers available, retry */
+
+    }
+
+    /* verify tail hasn't changed */
+
+    {
+      commc_lf_queue_tagged_ptr_t current_tail = commc_lf_queue_tagged_ptr_load(&queue->tail);
+
+      if (current_tail.ptr != tail.ptr || current_tail.tag != tail.tag) {
+
+        release_hazard_pointer(tail_hazard);
+        continue; /* tail changed, retry */
+
+      }
+    }
+
+    next = commc_lf_queue_tagged_ptr_load(&((commc_lf_queue_node_t*)tail.ptr)->next);
+
+    if (next.ptr == NULL) {
+
+      /* link the whole chain behind the last node */
+
+      commc_lf_queue_tagged_ptr_t new_next = commc_lf_queue_tagged_ptr_advance(next);
+      new_next.ptr = first;
+
+      if (commc_lf_queue_tagged_ptr_cas(&((commc_lf_queue_node_t*)tail.ptr)->next, next, new_next)) {
+
+        /* swing tail straight to the end of the chain; if another
+           thread has already helped it forward this simply fails */
+
+        new_tail     = commc_lf_queue_tagged_ptr_advance(tail);
+        new_tail.ptr = last;
+
+        commc_lf_queue_tagged_ptr_cas(&queue->tail, tail, new_tail);
+
+        COMMC_ATOMIC_ADD_RELAXED(&queue->size, (unsigned long)count);
+
+        release_hazard_pointer(tail_hazard);
+        break;
+
+      }
+
+    } else {
+
+      /* tail is lagging, help it forward */
+
+      new_tail     = commc_lf_queue_tagged_ptr_advance(tail);
+      new_tail.ptr = next.ptr;
+
+      commc_lf_queue_tagged_ptr_cas(&queue->tail, tail, new_tail);
+
+    }
+
+    release_hazard_pointer(tail_hazard);
+
+  }
+
+  if (COMMC_ATOMIC_LOAD_RELAXED(&queue->retired_count) > COMMC_LF_QUEUE_CLEANUP_THRESHOLD) {
+
+    commc_lf_queue_cleanup_retired(queue);
+
+  }
+
+  return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_lf_queue_enqueue_batch()
+	       ---
+	       public entry point; runs the batch inside the
+	       reclamation guard of the queue's scheme.
+
+*/
+
+commc_error_t commc_lf_queue_enqueue_batch(commc_lf_queue_t* queue, 
+                                           void** items, size_t count) {
+
+  commc_epoch_record_t* guard;
+  commc_error_t         result;
+  
+  if (!queue) {
+
+    return COMMC_ARGUMENT_ERROR;
+    
+  }
+  
+  if (!reclaim_enter(queue, &guard)) {
+
+    return COMMC_MEMORY_ERROR;
+    
+  }
+  
+  result = enqueue_batch_internal(queue, items, count);
+  
+  reclaim_exit(guard);
+  
+  return result;
+  
+}
+
+/*
+
+         commc_lf_queue_dequeue_batch()
+	       ---
+	       claims a prefix of up to max_items nodes with one head CAS.
+
+*/
+
+static commc_error_t dequeue_batch_internal(commc_lf_queue_t* queue, void** items,
+                                            size_t max_items, size_t* dequeued) {
+
+  commc_lf_queue_hazard_t*    head_hazard;
+  commc_lf_queue_hazard_t*    walk_hazard;
+  commc_lf_queue_tagged_ptr_t head;
+  commc_lf_queue_tagged_ptr_t tail;
+  commc_lf_queue_tagged_ptr_t next;
+  commc_lf_queue_tagged_ptr_t new_head;
+  commc_lf_queue_tagged_ptr_t current_head;
+  commc_lf_queue_node_t*      node;
+  commc_lf_queue_node_t*      retired;
+  size_t                      taken;
+  int                         restart;
+
+  if (!queue || !items || !dequeued || max_items == 0) {
+
+    return COMMC_ARGUMENT_ERROR;
+
+  }
+
+  *dequeued = 0;
+
+  while (1) {
+
+    head        = commc_lf_queue_tagged_ptr_load(&queue->head);
+    head_hazard = acquire_hazard_pointer(queue, (commc_lf_queue_node_t*)head.ptr);
+
+    if (!head_hazard) {
+
+      continue; /* no hazard pointers available, retry */
+
+    }
+
+    current_head = commc_lf_queue_tagged_ptr_load(&queue->head);
+
+    if (current_head.ptr != head.ptr || current_head.tag != head.tag) {
+
+      release_hazard_pointer(head_hazard);
+      continue; /* head changed, retry */
+
+    }
+
+    walk_hazard = acquire_hazard_pointer(queue, NULL);
+
+    if (!walk_hazard) {
+
+      release_hazard_pointer(head_hazard);
+      continue;
+
+    }
+
+    /* walk forward from the dummy, collecting up to max_items values.
+       each step protects the next node and then re-validates the head:
+       while the head is unchanged nothing past it can have been retired. */
+
+    node    = (commc_lf_queue_node_t*)head.ptr;
+    taken   = 0;
+    restart = 0;
+
+    while (taken < max_items) {
+
+      next = commc_lf_queue_tagged_ptr_load(&node->next);
+
+      if (next.ptr == NULL) {
+
+        break;
+
+      }
+
+      reprotect_hazard_pointer(walk_hazard, (commc_lf_queue_node_t*)next.ptr);
+
+      current_head = commc_lf_queue_tagged_ptr_load(&queue->head);
+
+      if (current_head.ptr != head.ptr || current_head.tag != head.tag) {
+
+        restart = 1;
+        break;
+
+      }
+
+      /* never let the head overtake the tail */
+
+      tail = commc_lf_queue_tagged_ptr_load(&queue->tail);
+
+      if (tail.ptr == (void*)node) {
+
+        commc_lf_queue_tagged_ptr_t new_tail = commc_lf_queue_tagged_ptr_advance(tail);
+        new_tail.ptr = next.ptr;
+
+        commc_lf_queue_tagged_ptr_cas(&queue->tail, tail, new_tail);
+
+      }
+
+      node           = (commc_lf_queue_node_t*)next.ptr;
+      items[taken++] = node->data;
+
+    }
+
+    if (!restart && taken == 0) {
+
+      /* queue is empty */
+
+      release_hazard_pointer(walk_hazard);
+      release_hazard_pointer(head_hazard);
+      return COMMC_FAILURE;
+
+    }
+
+    if (!restart) {
+
+      new_head     = commc_lf_queue_tagged_ptr_advance(head);
+      new_head.ptr = node;
+
+      if (commc_lf_queue_tagged_ptr_cas(&queue->head, head, new_head)) {
+
+        COMMC_ATOMIC_SUB_RELAXED(&queue->size, (unsigned long)taken);
+
+        /* the claimed prefix is now private; retire every node
+           before the new dummy */
+
+        retired = (commc_lf_queue_node_t*)head.ptr;
+
+        while (retired != node) {
+
+          commc_lf_queue_node_t* following = (commc_lf_queue_node_t*)retired->next.ptr;
+
+          commc_lf_queue_retire_node(queue, retired);
+          retired = following;
+
+        }
+
+        release_hazard_pointer(walk_hazard);
+        release_hazard_pointer(head_hazard);
+
+        if (COMMC_ATOMIC_LOAD_RELAXED(&queue->retired_count) > COMMC_LF_QUEUE_CLEANUP_THRESHOLD) {
+
+          commc_lf_queue_cleanup_retired(queue);
+
+        }
+
+        *dequeued = taken;
+        return COMMC_SUCCESS;
+
+      }
+
+    }
+
+    release_hazard_pointer(walk_hazard);
+    release_hazard_pointer(head_hazard);
+
+  }
+
+}
+
+/*
+
+         commc_lf_queue_dequeue_batch()
+	       ---
+	       public entry point; runs the batch inside the
+	       reclamation guard of the queue's scheme.
+
+*/
+
+commc_error_t commc_lf_queue_dequeue_batch(commc_lf_queue_t* queue, void** items,
+                                           size_t max_items, size_t* dequeued) {
+
+  commc_epoch_record_t* guard;
+  commc_error_t         result;
+  
+  if (!queue) {
+
+    return COMMC_ARGUMENT_ERROR;
+    
+  }
+  
+  if (!reclaim_enter(queue, &guard)) {
+
+    return COMMC_MEMORY_ERROR;
+    
+  }
+  
+  result = dequeue_batch_internal(queue, items, max_items, dequeued);
+  
+  reclaim_exit(guard);
+  
+  return result;
+  
+}
+
+/*
+	==================================
+             --- UTILITY FUNCTIONS ---
+	==================================
+*/
+
+/*
+
+         commc_lf_queue_is_empty()
+	       ---
+	       checks if queue appears empty (snapshot).
+
+*/
+
+int commc_lf_queue_is_empty(const commc_lf_queue_t* queue) {
+
+  commc_lf_queue_tagged_ptr_t head;
+  commc_lf_queue_tagged_ptr_t tail;
+  commc_lf_queue_tagged_ptr_t next;
+  commc_lf_queue_tagged_ptr_t current;
+  commc_lf_queue_hazard_t*    hazard;
+  commc_epoch_record_t*       guard;
+  
+  if (!queue) {
+
+    return 1;
+    
+  }
+  
+  head = commc_lf_queue_tagged_ptr_load((volatile commc_lf_queue_tagged_ptr_t*)&queue->head);
+  tail = commc_lf_queue_tagged_ptr_load((volatile commc_lf_queue_tagged_ptr_t*)&queue->tail);
+  
+  if (head.ptr != tail.ptr) {
+
+    return 0; /* definitely not empty */
+    
+  }
+  
+  /* head == tail, check if next pointer is NULL. the head node
+     must be protected before it is dereferenced */
+
+  if (!reclaim_enter((commc_lf_queue_t*)queue, &guard)) {
+
+    return (COMMC_ATOMIC_LOAD_RELAXED((volatile unsigned long*)&queue->size) == 0) ? 1 : 0;
+
+  }
+
+  hazard = acquire_hazard_pointer((commc_lf_queue_t*)queue, (commc_lf_queue_node_t*)head.ptr);
+
+  if (!hazard) {
+
+    return (COMMC_ATOMIC_LOAD_RELAXED((volatile unsigned long*)&queue->size) == 0) ? 1 : 0;
+
+  }
+
+  current = commc_lf_queue_tagged_ptr_load((volatile commc_lf_queue_tagged_ptr_t*)&queue->head);
+
+  if (current.ptr != head.ptr || current.tag != head.tag) {
+
+    release_hazard_pointer(hazard);
+    reclaim_exit(guard);
+    return 0; /* head moved, something was dequeued */
+
+  }
+  
+  next = commc_lf_queue_tagged_ptr_load((volatile commc_lf_queue_tagged_ptr_t*)&((commc_lf_queue_node_t*)head.ptr)->next);
+
+  release_hazard_pointer(hazard);
+  reclaim_exit(guard);
+  
+  return (next.ptr == NULL) ? 1 : 0;
+  
+}
+
+/*
+
+         commc_lf_queue_size()
+	       ---
+	       returns approximate queue size.
+
+*/
+
+unsigned long commc_lf_queue_size(const commc_lf_queue_t* queue) {
+
+  if (!queue) {
+
+    return 0;
+    
+  }
+  
+  return COMMC_ATOMIC_LOAD_RELAXED((volatile unsigned long*)&queue->size);
+  
+}
+
+/*
+
+         commc_lf_queue_retire_node()
+	       ---
+	       adds node to retired list for deferred cleanup. the list
+	       is threaded through retired_next so that a thread still
+	       holding the node never follows it into the retired list.
+	       in the epoch schemes the node goes to the calling
+	       thread's limbo list instead.
+
+*/
+
+void commc_lf_queue_retire_node(commc_lf_queue_t* queue, commc_lf_queue_node_t* node) {
+
+  commc_lf_queue_node_t* old_head;
+  commc_epoch_record_t*  record;
+
+  if (!queue || !node) {
+
+    return;
+    
+  }
+  
+  if (queue->reclaim != COMMC_LF_QUEUE_RECLAIM_HAZARD) {
+
+    record = commc_epoch_self(queue->epoch);
+    
+    if (record) {
+
+      commc_epoch_retire(record, &node->epoch_entry, free_epoch_node);
+      return;
+      
+    }
+    
+    /* no record: park the node on the retired list, which is
+       only freed at destroy in the epoch schemes */
+    
+  }
+  
+  /* add to retired list */
+  
+  do {
+
+    old_head           = (commc_lf_queue_node_t*)COMMC_ATOMIC_LOAD_RELAXED((void**)&queue->retired_nodes);
+    node->retired_next = old_head;
+    
+  } while (!COMMC_ATOMIC_CAS((void**)&queue->retired_nodes, 
+                             (void*)old_head, (void*)node));
+  
+  /* increment retired count */
+  
+  COMMC_ATOMIC_ADD_RELAXED(&queue->retired_count, 1);
+  
+}
+
+/*
+
+         commc_lf_queue_cleanup_retired()
+	       ---
+	       safely reclaims retired nodes not protected by hazard pointers.
+	       
+	       the whole retired list is detached with one exchange, so
+	       concurrent cleanups never see the same node. survivors are
+	       spliced back in a single CAS loop.
+
+*/
+
+void commc_lf_queue_cleanup_retired(commc_lf_queue_t* queue) {
+
+  commc_lf_queue_node_t* current;
+  commc_lf_queue_node_t* next;
+  commc_lf_queue_node_t* keep_head;
+  commc_lf_queue_node_t* keep_tail;
+  commc_lf_queue_node_t* old_head;
+  unsigned long          cleaned;
+  
+  if (!queue) {
+
+    return;
+    
+  }
+  
+  if (queue->reclaim != COMMC_LF_QUEUE_RECLAIM_HAZARD) {
+
+    commc_epoch_reclaim(commc_epoch_self(queue->epoch));
+    return;
+    
+  }
+  
+  current = (commc_lf_queue_node_t*)COMMC_ATOMIC_EXCHANGE((void**)&queue->retired_nodes, NULL);
+
+  /* pairs with the fence in acquire_hazard_pointer() */
+
+  COMMC_MEMORY_BARRIER();
+
+  keep_head = NULL;
+  keep_tail = NULL;
+  cleaned   = 0;
+  
+  while (current) {
+
+    next = current->retired_next;
+    
+    if (!is_node_hazardous(queue, current) && 
+        COMMC_ATOMIC_LOAD_ACQUIRE(&current->ref_count) == 0) {
+
+      /* node is safe to free */
+      
+      free(current);
+      cleaned++;
+      
+    } else {
+
+      current->retired_next = keep_head;
+      keep_head             = current;
+
+      if (!keep_tail) {
+
+        keep_tail = current;
+
+      }
+      
+    }
+    
+    current = next;
+    
+  }
+
+  if (keep_head) {
+
+    do {
+
+      old_head                = (commc_lf_queue_node_t*)COMMC_ATOMIC_LOAD_RELAXED((void**)&queue->retired_nodes);
+      keep_tail->retired_next = old_head;
+
+    } while (!COMMC_ATOMIC_CAS((void**)&queue->retired_nodes,
+                               (void*)old_head, (void*)keep_head));
+
+  }
+
+  if (cleaned) {
+
+    COMMC_ATOMIC_SUB_RELAXED(&queue->retired_count, cleaned);
+
   }
   
 }
@@ -1093,7 +1822,8 @@ size_t commc_lf_queue_memory_usage(const commc_lf_queue_t* queue) {
   total = sizeof(commc_lf_queue_t);
   total += queue->max_threads * sizeof(commc_lf_queue_thread_data_t);
   
-  node_count = COMMC_ATOMIC_LOAD((volatile unsigned long*)&queue->size) + COMMC_ATOMIC_LOAD((volatile unsigned long*)&queue->retired_count);
+  node_count = COMMC_ATOMIC_LOAD_RELAXED((volatile unsigned long*)&queue->size) + COMMC_ATOMIC_LOAD_RELAXED((volatile unsigned long*)&queue->retired_count);
+  node_count += (unsigned long)commc_epoch_pending(queue->epoch);
   total += node_count * sizeof(commc_lf_queue_node_t);
   
   return total;
@@ -1209,6 +1939,40 @@ commc_lf_queue_thread_data_t* commc_lf_queue_get_thread_data(commc_lf_queue_t* q
   
 }
 
+/*
+
+         commc_lf_queue_get_reclaim()
+	       ---
+	       returns the reclamation scheme of the queue.
+
+*/
+
+commc_lf_queue_reclaim_t commc_lf_queue_get_reclaim(const commc_lf_queue_t* queue) {
+
+  return queue ? queue->reclaim : COMMC_LF_QUEUE_RECLAIM_HAZARD;
+  
+}
+
+/*
+
+         commc_lf_queue_thread_offline()
+	       ---
+	       takes the calling thread offline in a QSBR queue.
+
+*/
+
+void commc_lf_queue_thread_offline(commc_lf_queue_t* queue) {
+
+  if (!queue || queue->reclaim != COMMC_LF_QUEUE_RECLAIM_QSBR) {
+
+    return;
+    
+  }
+  
+  commc_epoch_offline(commc_epoch_self(queue->epoch));
+  
+}
+
 /* 
 	==================================
              --- EOF ---
@@ -0,0 +1,2164 @@
+/*
+   ===================================
+   M I M E . C
+   STREAMING MIME MESSAGE PARSER IMPLEMENTATION
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    the parser is either reading a part's headers or
+	    scanning a body. headers go a byte at a time into
+	    the field buffer, CRs dropped and folds joined, and
+	    a field is reported once the next line shows it is
+	    complete.
+
+	    a body is scanned line by line for the delimiters
+	    of the multiparts it is nested in. most lines are
+	    ruled out by their first byte and then skipped to
+	    their LF with memchr; only lines starting "--" are
+	    collected (into look[], up to the longest possible
+	    delimiter line) until their end decides. the line
+	    end before a delimiter belongs to the delimiter, so
+	    every line end is held back until the next line is
+	    known not to be one.
+
+	    body bytes that pass are gathered into spans of the
+	    caller's input and handed on only when a span
+	    breaks off (at a delimiter, a held byte from an
+	    earlier write, or the end of the write), so a part
+	    that is not decoded arrives in as few BODY_DATA
+	    events as the writes allow, all without copying.
+	    base64 and quoted-printable spans are decoded into
+	    the output buffer, which goes out when full and at
+	    the end of every write.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L    /* MMAP, FSTAT */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#define MIME_HAVE_MMAP
+#endif
+
+#include "commc/mime.h"
+#include "commc/error.h"
+
+/*
+	==================================
+           --- CONSTANTS ---
+	==================================
+*/
+
+#define MIME_LOOK_SIZE      (COMMC_MIME_MAX_BOUNDARY + 64)    /* "--", BOUNDARY, "--", PADDING, CR */
+#define MIME_QP_SPACES      80                                /* TRAILING BLANKS HELD BY QP */
+#define MIME_INVALID        255
+
+/*
+
+         base64_values[]
+	       ---
+	       the 6-bit value of each base64 character,
+	       MIME_INVALID for every other byte ('=' and line
+	       ends included).
+
+*/
+
+static const unsigned char base64_values[256] = {
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255, 62,255,255,255, 63,
+     52, 53, 54, 55, 56, 57, 58, 59, 60, 61,255,255,255,255,255,255,
+    255,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+     15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25,255,255,255,255,255,
+    255, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+     41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255
+};
+
+/*
+	==================================
+           --- STRUCTURES ---
+	==================================
+*/
+
+/*
+
+         mime_state_t / mime_qp_state_t
+	       ---
+	       what the parser is reading, and where a
+	       quoted-printable decoder stands after an '='.
+
+*/
+
+typedef enum {
+
+    MIME_HEADERS,
+    MIME_BODY
+
+} mime_state_t;
+
+typedef enum {
+
+    MIME_QP_TEXT,          /* ORDINARY BYTES */
+    MIME_QP_EQUALS,        /* AFTER '=' */
+    MIME_QP_HEX,           /* AFTER '=' AND ONE HEX DIGIT */
+    MIME_QP_SOFT_CR,       /* AFTER '=' CR, OR '=' BLANKS CR */
+    MIME_QP_SOFT_BLANKS    /* AFTER '=' AND BLANKS */
+
+} mime_qp_state_t;
+
+struct commc_mime_parser_t {
+
+    commc_mime_callback_t callback;
+    void*                 user_data;
+    commc_error_t         error;                /* STICKY UNTIL RESET */
+    int                   started;              /* THE MESSAGE'S PART_BEGIN WAS SENT */
+    int                   finished;
+
+    const char*           chunk;                /* INPUT OF THE CURRENT WRITE */
+    const char*           chunk_end;
+    size_t                base;                 /* INPUT OFFSET OF chunk */
+
+    mime_state_t          state;
+    int                   depth;                /* INNERMOST OPEN PART */
+    size_t                part_count;
+    commc_mime_part_t     parts[COMMC_MIME_MAX_DEPTH];
+    size_t                boundary_length[COMMC_MIME_MAX_DEPTH];
+    int                   delimited[COMMC_MIME_MAX_DEPTH];    /* ITS DELIMITERS ARE LOOKED FOR */
+
+    int                   line_start;           /* NEXT BYTE STARTS A LINE */
+    size_t                line_offset;          /* WHERE THE CURRENT LINE STARTED */
+
+    char                  field[COMMC_MIME_MAX_FIELD];
+    size_t                field_length;
+    size_t                field_offset;
+    int                   field_line;           /* THE FIELD STARTED ON THE CURRENT LINE */
+
+    int                   skip;                 /* BODY BYTES ARE DROPPED */
+    char                  look[MIME_LOOK_SIZE]; /* START OF A LINE THAT MAY BE A DELIMITER */
+    size_t                look_length;
+    int                   held;                 /* LINE END BYTES HELD BACK: 0, 1 OR 2 */
+    size_t                held_offset;
+    int                   held_cr;              /* A CR ENDING THE INPUT SO FAR, HELD BACK */
+    size_t                held_cr_offset;
+
+    const char*           span;                 /* BODY BYTES OF THIS WRITE NOT YET HANDED ON */
+    size_t                span_length;
+    size_t                span_offset;
+
+    unsigned long         bits;                 /* BASE64 BITS NOT YET OUTPUT */
+    int                   bit_count;
+    mime_qp_state_t       qp_state;
+    char                  qp_digit;             /* FIRST HEX DIGIT AFTER '=' */
+    char                  spaces[MIME_QP_SPACES];
+    size_t                space_count;
+
+    char                  output[COMMC_MIME_OUTPUT_SIZE];
+    size_t                output_length;
+
+};
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         emit()
+	       ---
+	       hands an event about the current part to the
+	       callback, unless the parser has failed already.
+
+*/
+
+static void emit(commc_mime_parser_t* parser,
+                 commc_mime_event_t*  event) {
+
+    commc_error_t result;
+
+    if (parser->error != COMMC_SUCCESS) {
+
+        return;
+
+    }
+
+    event->part = &parser->parts[parser->depth];
+    result      = parser->callback(event, parser->user_data);
+
+    if (result != COMMC_SUCCESS) {
+
+        parser->error = result;
+
+    }
+
+}
+
+/*
+
+         emit_simple()
+	       ---
+	       emits an event carrying only a span.
+
+*/
+
+static void emit_simple(commc_mime_parser_t*    parser,
+                        commc_mime_event_type_t type,
+                        size_t                  offset,
+                        size_t                  length) {
+
+    commc_mime_event_t event;
+
+    memset(&event, 0, sizeof(event));
+
+    event.type   = type;
+    event.offset = offset;
+    event.length = length;
+
+    emit(parser, &event);
+
+}
+
+/*
+
+         emit_data()
+	       ---
+	       emits BODY_DATA for data, whose span is
+	       (offset, length) in the input or none.
+
+*/
+
+static void emit_data(commc_mime_parser_t* parser,
+                      const char*          data,
+                      size_t               data_length,
+                      size_t               offset,
+                      size_t               length) {
+
+    commc_mime_event_t event;
+
+    memset(&event, 0, sizeof(event));
+
+    event.type        = COMMC_MIME_EVENT_BODY_DATA;
+    event.data        = data;
+    event.data_length = data_length;
+    event.offset      = offset;
+    event.length      = length;
+
+    parser->parts[parser->depth].decoded_length += data_length;
+
+    emit(parser, &event);
+
+}
+
+/*
+
+         in_chunk()
+	       ---
+	       returns the bytes at input offset in the
+	       current write, or NULL if they came earlier.
+
+*/
+
+static const char* in_chunk(const commc_mime_parser_t* parser,
+                            size_t                     offset) {
+
+    if (!parser->chunk || offset < parser->base) {
+
+        return NULL;
+
+    }
+
+    return parser->chunk + (offset - parser->base);
+
+}
+
+/*
+
+         equals_ignoring_case()
+	       ---
+	       compares length bytes with a lowercase string.
+
+*/
+
+static int equals_ignoring_case(const char* text,
+                                size_t      length,
+                                const char* lower) {
+
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+
+        if (lower[i] == '\0' || tolower((unsigned char)text[i]) != lower[i]) {
+
+            return 0;
+
+        }
+
+    }
+
+    return lower[length] == '\0';
+
+}
+
+/*
+
+         copy_value()
+	       ---
+	       copies length bytes into a field of size bytes,
+	       cutting them short if needed. returns 1 if they
+	       fitted.
+
+*/
+
+static int copy_value(char*       field,
+                      size_t      size,
+                      const char* value,
+                      size_t      length,
+                      int         lowercase) {
+
+    size_t copied = length < size ? length : size - 1;
+    size_t i;
+
+    for (i = 0; i < copied; i++) {
+
+        field[i] = lowercase ? (char)tolower((unsigned char)value[i]) : value[i];
+
+    }
+
+    field[copied] = '\0';
+
+    return copied == length;
+
+}
+
+/*
+	==================================
+          --- CONTENT HEADERS ---
+	==================================
+*/
+
+/*
+
+         is_blank()
+	       ---
+	       space or tab.
+
+*/
+
+static int is_blank(char c) {
+
+    return c == ' ' || c == '\t';
+
+}
+
+/*
+
+         next_parameter()
+	       ---
+	       finds the next "; name=value" parameter of a
+	       Content-Type or Content-Disposition value from
+	       *cursor on, unquoting a quoted value into value
+	       (size bytes). returns 0 when there is none
+	       left, otherwise 1 and the value's full length
+	       in *value_length (which may exceed what fitted).
+
+*/
+
+static int next_parameter(const char** cursor,
+                          const char*  end,
+                          const char** name,
+                          size_t*      name_length,
+                          char*        value,
+                          size_t       size,
+                          size_t*      value_length) {
+
+    const char* p = *cursor;
+    size_t      length;
+
+    for (;;) {
+
+        while (p < end && *p != ';') {
+
+            p++;
+
+        }
+
+        if (p >= end) {
+
+            *cursor = p;
+            return 0;
+
+        }
+
+        p++;
+
+        while (p < end && is_blank(*p)) {
+
+            p++;
+
+        }
+
+        *name = p;
+
+        while (p < end && *p != '=' && *p != ';' && !is_blank(*p)) {
+
+            p++;
+
+        }
+
+        *name_length = (size_t)(p - *name);
+
+        while (p < end && is_blank(*p)) {
+
+            p++;
+
+        }
+
+        if (p < end && *p == '=') {
+
+            break;
+
+        }
+
+    }
+
+    p++;
+
+    while (p < end && is_blank(*p)) {
+
+        p++;
+
+    }
+
+    length = 0;
+
+    if (p < end && *p == '"') {
+
+        for (p++; p < end && *p != '"'; p++) {
+
+            if (*p == '\\' && p + 1 < end) {
+
+                p++;
+
+            }
+
+            if (length + 1 < size) {
+
+                value[length] = *p;
+
+            }
+
+            length++;
+
+        }
+
+        if (p < end) {
+
+            p++;
+
+        }
+
+    } else {
+
+        for (; p < end && *p != ';' && !is_blank(*p); p++) {
+
+            if (length + 1 < size) {
+
+                value[length] = *p;
+
+            }
+
+            length++;
+
+        }
+
+    }
+
+    value[length < size ? length : size - 1] = '\0';
+
+    *value_length = length;
+    *cursor       = p;
+
+    return 1;
+
+}
+
+/*
+
+         token_length()
+	       ---
+	       length of the leading token of a header value,
+	       up to a ';', blank or comment.
+
+*/
+
+static size_t token_length(const char* value,
+                           size_t      length) {
+
+    size_t i = 0;
+
+    while (i < length && value[i] != ';' && value[i] != '(' && !is_blank(value[i])) {
+
+        i++;
+
+    }
+
+    return i;
+
+}
+
+/*
+
+         read_content_type()
+	       ---
+	       takes type/subtype, boundary, charset and name
+	       from a Content-Type value.
+
+*/
+
+static void read_content_type(commc_mime_part_t* part,
+                              const char*        value,
+                              size_t             length) {
+
+    char        parameter[COMMC_MIME_MAX_FILENAME];
+    const char* cursor = value + token_length(value, length);
+    const char* name;
+    size_t      name_length;
+    size_t      parameter_length;
+
+    copy_value(part->content_type, sizeof(part->content_type),
+               value, token_length(value, length), 1);
+
+    part->boundary[0] = '\0';
+
+    while (next_parameter(&cursor, value + length, &name, &name_length,
+                          parameter, sizeof(parameter), &parameter_length)) {
+
+        if (equals_ignoring_case(name, name_length, "boundary")) {
+
+            /* a boundary cut short would never match */
+
+            if (parameter_length > 0 && parameter_length <= COMMC_MIME_MAX_BOUNDARY) {
+
+                copy_value(part->boundary, sizeof(part->boundary), parameter, parameter_length, 0);
+
+            }
+
+        } else if (equals_ignoring_case(name, name_length, "charset")) {
+
+            copy_value(part->charset, sizeof(part->charset), parameter, parameter_length, 0);
+
+        } else if (equals_ignoring_case(name, name_length, "name") && part->filename[0] == '\0') {
+
+            copy_value(part->filename, sizeof(part->filename), parameter, parameter_length, 0);
+
+        }
+
+    }
+
+}
+
+/*
+
+         read_disposition()
+	       ---
+	       takes the disposition and filename from a
+	       Content-Disposition value. its filename wins
+	       over a Content-Type name.
+
+*/
+
+static void read_disposition(commc_mime_part_t* part,
+                             const char*        value,
+                             size_t             length) {
+
+    char        parameter[COMMC_MIME_MAX_FILENAME];
+    const char* cursor = value + token_length(value, length);
+    const char* name;
+    size_t      name_length;
+    size_t      parameter_length;
+
+    part->is_attachment = equals_ignoring_case(value, token_length(value, length), "attachment");
+
+    while (next_parameter(&cursor, value + length, &name, &name_length,
+                          parameter, sizeof(parameter), &parameter_length)) {
+
+        if (equals_ignoring_case(name, name_length, "filename")) {
+
+            copy_value(part->filename, sizeof(part->filename), parameter, parameter_length, 0);
+
+        }
+
+    }
+
+}
+
+/*
+
+         read_encoding()
+	       ---
+	       maps a Content-Transfer-Encoding value.
+
+*/
+
+static commc_mime_encoding_t read_encoding(const char* value,
+                                           size_t      length) {
+
+    length = token_length(value, length);
+
+    if (equals_ignoring_case(value, length, "base64")) {
+
+        return COMMC_MIME_ENCODING_BASE64;
+
+    }
+
+    if (equals_ignoring_case(value, length, "quoted-printable")) {
+
+        return COMMC_MIME_ENCODING_QUOTED_PRINTABLE;
+
+    }
+
+    if (equals_ignoring_case(value, length, "7bit")) {
+
+        return COMMC_MIME_ENCODING_7BIT;
+
+    }
+
+    if (equals_ignoring_case(value, length, "8bit")) {
+
+        return COMMC_MIME_ENCODING_8BIT;
+
+    }
+
+    if (equals_ignoring_case(value, length, "binary")) {
+
+        return COMMC_MIME_ENCODING_BINARY;
+
+    }
+
+    return COMMC_MIME_ENCODING_UNKNOWN;
+
+}
+
+/*
+	==================================
+             --- DECODING ---
+	==================================
+*/
+
+/*
+
+         flush_output()
+	       ---
+	       hands the decoded bytes on, or drops them if
+	       the body is being skipped.
+
+*/
+
+static void flush_output(commc_mime_parser_t* parser) {
+
+    if (parser->output_length > 0 && !parser->skip) {
+
+        emit_data(parser, parser->output, parser->output_length, 0, 0);
+
+    }
+
+    parser->output_length = 0;
+
+}
+
+/*
+
+         output_byte()
+	       ---
+	       adds one decoded byte, passing the buffer on
+	       when full.
+
+*/
+
+static void output_byte(commc_mime_parser_t* parser,
+                        int                  c) {
+
+    if (parser->output_length == COMMC_MIME_OUTPUT_SIZE) {
+
+        flush_output(parser);
+
+    }
+
+    parser->output[parser->output_length++] = (char)c;
+
+}
+
+/*
+
+         decode_base64()
+	       ---
+	       decodes base64 text, skipping line ends and
+	       anything else outside the alphabet. '=' pads
+	       out a quartet, so bits left over then are
+	       dropped and the next quartet starts afresh.
+
+*/
+
+static void decode_base64(commc_mime_parser_t* parser,
+                          const char*          data,
+                          size_t               length) {
+
+    unsigned long bits      = parser->bits;
+    int           bit_count = parser->bit_count;
+    unsigned      value;
+    size_t        i;
+
+    for (i = 0; i < length && parser->error == COMMC_SUCCESS && !parser->skip; i++) {
+
+        value = base64_values[(unsigned char)data[i]];
+
+        if (value == MIME_INVALID) {
+
+            if (data[i] == '=') {
+
+                bit_count = 0;
+
+            }
+
+            continue;
+
+        }
+
+        bits       = ((bits << 6) | value) & 0xFFFFFFUL;
+        bit_count += 6;
+
+        if (bit_count >= 8) {
+
+            bit_count -= 8;
+
+            if (parser->output_length == COMMC_MIME_OUTPUT_SIZE) {
+
+                flush_output(parser);
+
+            }
+
+            parser->output[parser->output_length++] = (char)((bits >> bit_count) & 0xFF);
+
+        }
+
+    }
+
+    parser->bits      = bits;
+    parser->bit_count = bit_count;
+
+}
+
+/*
+
+         hex_value()
+	       ---
+	       value of a hex digit, or -1.
+
+*/
+
+static int hex_value(char c) {
+
+    if (c >= '0' && c <= '9') {
+
+        return c - '0';
+
+    }
+
+    if (c >= 'A' && c <= 'F') {
+
+        return c - 'A' + 10;
+
+    }
+
+    if (c >= 'a' && c <= 'f') {
+
+        return c - 'a' + 10;
+
+    }
+
+    return -1;
+
+}
+
+/*
+
+         flush_spaces()
+	       ---
+	       outputs the blanks held by quoted-printable
+	       once something follows them on their line.
+
+*/
+
+static void flush_spaces(commc_mime_parser_t* parser) {
+
+    size_t i;
+
+    for (i = 0; i < parser->space_count; i++) {
+
+        output_byte(parser, parser->spaces[i]);
+
+    }
+
+    parser->space_count = 0;
+
+}
+
+/*
+
+         decode_quoted_printable()
+	       ---
+	       decodes quoted-printable text: "=XX" escapes,
+	       soft line breaks ('=' at the end of a line,
+	       blanks allowed before the line end) and blanks
+	       at the end of a line, which are dropped.
+	       malformed escapes are kept as they are.
+
+*/
+
+static void decode_quoted_printable(commc_mime_parser_t* parser,
+                                    const char*          data,
+                                    size_t               length) {
+
+    size_t i = 0;
+    char   c;
+    int    value;
+
+    while (i < length && parser->error == COMMC_SUCCESS && !parser->skip) {
+
+        c = data[i];
+
+        switch (parser->qp_state) {
+
+            case MIME_QP_TEXT:
+
+                if (c == '=') {
+
+                    parser->qp_state = MIME_QP_EQUALS;
+
+                } else if (is_blank(c)) {
+
+                    if (parser->space_count == MIME_QP_SPACES) {
+
+                        flush_spaces(parser);
+
+                    }
+
+                    parser->spaces[parser->space_count++] = c;
+
+                } else {
+
+                    /* blanks before a line end are padding */
+
+                    if (c == '\r' || c == '\n') {
+
+                        parser->space_count = 0;
+
+                    } else {
+
+                        flush_spaces(parser);
+
+                    }
+
+                    output_byte(parser, c);
+
+                }
+
+                i++;
+                break;
+
+            case MIME_QP_EQUALS:
+
+                flush_spaces(parser);
+
+                if (hex_value(c) >= 0) {
+
+                    parser->qp_digit = c;
+                    parser->qp_state = MIME_QP_HEX;
+                    i++;
+
+                } else if (c == '\r') {
+
+                    parser->qp_state = MIME_QP_SOFT_CR;
+                    i++;
+
+                } else if (c == '\n') {
+
+                    parser->qp_state = MIME_QP_TEXT;
+                    i++;
+
+                } else if (is_blank(c)) {
+
+                    parser->qp_state = MIME_QP_SOFT_BLANKS;
+                    i++;
+
+                } else {
+
+                    output_byte(parser, '=');
+                    parser->qp_state = MIME_QP_TEXT;
+
+                }
+
+                break;
+
+            case MIME_QP_HEX:
+
+                value = hex_value(c);
+
+                if (value >= 0) {
+
+                    output_byte(parser, hex_value(parser->qp_digit) * 16 + value);
+                    i++;
+
+                } else {
+
+                    output_byte(parser, '=');
+                    output_byte(parser, parser->qp_digit);
+
+                }
+
+                parser->qp_state = MIME_QP_TEXT;
+                break;
+
+            case MIME_QP_SOFT_CR:
+
+                /* a bare CR is dropped with the break */
+
+                if (c == '\n') {
+
+                    i++;
+
+                }
+
+                parser->qp_state = MIME_QP_TEXT;
+                break;
+
+            case MIME_QP_SOFT_BLANKS:
+
+                if (is_blank(c)) {
+
+                    i++;
+
+                } else if (c == '\r') {
+
+                    parser->qp_state = MIME_QP_SOFT_CR;
+                    i++;
+
+                } else if (c == '\n') {
+
+                    parser->qp_state = MIME_QP_TEXT;
+                    i++;
+
+                } else {
+
+                    output_byte(parser, '=');
+                    parser->qp_state = MIME_QP_TEXT;
+
+                }
+
+                break;
+
+        }
+
+    }
+
+}
+
+/*
+
+         finish_decoding()
+	       ---
+	       ends the current part's body and hands the rest
+	       on. a final '=' is a soft line break whose line
+	       end went to the delimiter; half an escape is
+	       kept as it is; partial base64 bits and trailing
+	       blanks are dropped.
+
+*/
+
+static void finish_decoding(commc_mime_parser_t* parser) {
+
+    if (parser->qp_state == MIME_QP_HEX) {
+
+        output_byte(parser, '=');
+        output_byte(parser, parser->qp_digit);
+
+    }
+
+    flush_output(parser);
+
+    parser->bits        = 0;
+    parser->bit_count   = 0;
+    parser->qp_state    = MIME_QP_TEXT;
+    parser->space_count = 0;
+
+}
+
+/*
+
+         flush_span()
+	       ---
+	       hands the gathered body bytes on: as they are,
+	       or through the part's decoder.
+
+*/
+
+static void flush_span(commc_mime_parser_t* parser) {
+
+    const char* span   = parser->span;
+    size_t      length = parser->span_length;
+
+    if (length == 0) {
+
+        return;
+
+    }
+
+    parser->span_length = 0;
+
+    switch (parser->parts[parser->depth].encoding) {
+
+        case COMMC_MIME_ENCODING_BASE64:
+
+            decode_base64(parser, span, length);
+            break;
+
+        case COMMC_MIME_ENCODING_QUOTED_PRINTABLE:
+
+            decode_quoted_printable(parser, span, length);
+            break;
+
+        default:
+
+            emit_data(parser, span, length, parser->span_offset, length);
+            break;
+
+    }
+
+}
+
+/*
+
+         content()
+	       ---
+	       passes on body bytes found at input offset.
+	       bytes of the current write that follow the
+	       span directly join it; others (held from an
+	       earlier write) go out at once.
+
+*/
+
+static void content(commc_mime_parser_t* parser,
+                    const char*          data,
+                    size_t               length,
+                    size_t               offset) {
+
+    if (length == 0 || parser->skip) {
+
+        return;
+
+    }
+
+    if (parser->span_length > 0 && data == parser->span + parser->span_length) {
+
+        parser->span_length += length;
+        return;
+
+    }
+
+    flush_span(parser);
+
+    parser->span        = data;
+    parser->span_length = length;
+    parser->span_offset = offset;
+
+    if (data < parser->chunk || data >= parser->chunk_end) {
+
+        flush_span(parser);
+
+    }
+
+}
+
+/*
+
+         release_held()
+	       ---
+	       passes on the held line end (the next line was
+	       no delimiter) and any held CR.
+
+*/
+
+static void release_held(commc_mime_parser_t* parser) {
+
+    const char* data;
+
+    if (parser->held > 0) {
+
+        data = in_chunk(parser, parser->held_offset);
+
+        content(parser, data ? data : (parser->held == 2 ? "\r\n" : "\n"),
+                (size_t)parser->held, parser->held_offset);
+
+        parser->held = 0;
+
+    }
+
+    if (parser->held_cr) {
+
+        data = in_chunk(parser, parser->held_cr_offset);
+
+        content(parser, data ? data : "\r", 1, parser->held_cr_offset);
+
+        parser->held_cr = 0;
+
+    }
+
+}
+
+/*
+
+         release_look()
+	       ---
+	       passes on a line start collected in look[]
+	       that turned out not to be a delimiter.
+
+*/
+
+static void release_look(commc_mime_parser_t* parser,
+                         size_t               length) {
+
+    const char* data;
+
+    if (length > 0) {
+
+        data = in_chunk(parser, parser->line_offset);
+
+        content(parser, data ? data : parser->look, length, parser->line_offset);
+
+    }
+
+    parser->look_length = 0;
+
+}
+
+/*
+	==================================
+             --- STRUCTURE ---
+	==================================
+*/
+
+/*
+
+         match_delimiter()
+	       ---
+	       checks whether a line (line end removed) is
+	       "--boundary" or "--boundary--", blanks allowed
+	       after, for an open multipart, innermost first.
+	       returns 1 with its depth and whether it closes.
+
+*/
+
+static int match_delimiter(const commc_mime_parser_t* parser,
+                           const char*                line,
+                           size_t                     length,
+                           int*                       level,
+                           int*                       close) {
+
+    size_t rest;
+    int    i;
+
+    if (length < 3 || line[0] != '-' || line[1] != '-') {
+
+        return 0;
+
+    }
+
+    for (i = parser->depth; i >= 0; i--) {
+
+        if (!parser->delimited[i] || length < 2 + parser->boundary_length[i] ||
+            memcmp(line + 2, parser->parts[i].boundary, parser->boundary_length[i]) != 0) {
+
+            continue;
+
+        }
+
+        rest   = 2 + parser->boundary_length[i];
+        *close = 0;
+
+        if (rest + 2 <= length && line[rest] == '-' && line[rest + 1] == '-') {
+
+            *close = 1;
+            rest  += 2;
+
+        }
+
+        while (rest < length && is_blank(line[rest])) {
+
+            rest++;
+
+        }
+
+        if (rest == length) {
+
+            *level = i;
+            return 1;
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+/*
+
+         begin_part()
+	       ---
+	       opens a child of the innermost part, whose
+	       headers start at offset.
+
+*/
+
+static void begin_part(commc_mime_parser_t* parser,
+                       size_t               offset) {
+
+    const commc_mime_part_t* parent = &parser->parts[parser->depth];
+    commc_mime_part_t*       part   = &parser->parts[parser->depth + 1];
+    int                      digest = strcmp(parent->content_type, "multipart/digest") == 0;
+
+    memset(part, 0, sizeof(commc_mime_part_t));
+
+    /* RFC 2046: parts of a digest are messages unless they say otherwise */
+
+    strcpy(part->content_type, digest ? "message/rfc822" : "text/plain");
+
+    part->depth    = parser->depth + 1;
+    part->index    = parser->part_count++;
+    part->offset   = offset;
+    part->encoding = COMMC_MIME_ENCODING_7BIT;
+
+    parser->depth++;
+    parser->delimited[parser->depth] = 0;
+
+    parser->state        = MIME_HEADERS;
+    parser->line_start   = 1;
+    parser->line_offset  = offset;
+    parser->field_length = 0;
+
+    emit_simple(parser, COMMC_MIME_EVENT_PART_BEGIN, offset, 0);
+
+}
+
+/*
+
+         end_field()
+	       ---
+	       reports the field collected so far, which ends
+	       at offset, and applies it to the part if it is
+	       a Content-* field. lines without a colon are
+	       dropped.
+
+*/
+
+static void end_field(commc_mime_parser_t* parser,
+                      size_t               offset) {
+
+    commc_mime_part_t* part = &parser->parts[parser->depth];
+    commc_mime_event_t event;
+    const char*        colon;
+    const char*        field_end = parser->field + parser->field_length;
+
+    if (parser->field_length == 0) {
+
+        return;
+
+    }
+
+    parser->field_length = 0;
+
+    colon = (const char*)memchr(parser->field, ':', (size_t)(field_end - parser->field));
+
+    if (!colon) {
+
+        return;
+
+    }
+
+    memset(&event, 0, sizeof(event));
+
+    event.type        = COMMC_MIME_EVENT_HEADER;
+    event.name        = parser->field;
+    event.name_length = (size_t)(colon - parser->field);
+    event.value       = colon + 1;
+    event.offset      = parser->field_offset;
+    event.length      = offset - parser->field_offset;
+
+    while (event.name_length > 0 && is_blank(event.name[event.name_length - 1])) {
+
+        event.name_length--;
+
+    }
+
+    while (event.value < field_end && is_blank(*event.value)) {
+
+        event.value++;
+
+    }
+
+    event.value_length = (size_t)(field_end - event.value);
+
+    while (event.value_length > 0 && is_blank(event.value[event.value_length - 1])) {
+
+        event.value_length--;
+
+    }
+
+    if (equals_ignoring_case(event.name, event.name_length, "content-type")) {
+
+        read_content_type(part, event.value, event.value_length);
+
+    } else if (equals_ignoring_case(event.name, event.name_length, "content-transfer-encoding")) {
+
+        part->encoding = read_encoding(event.value, event.value_length);
+
+    } else if (equals_ignoring_case(event.name, event.name_length, "content-disposition")) {
+
+        read_disposition(part, event.value, event.value_length);
+
+    }
+
+    emit(parser, &event);
+
+}
+
+/*
+
+         end_headers()
+	       ---
+	       starts the body of the innermost part at
+	       offset. a multipart looks for its delimiters
+	       from here, dropping its preamble; a
+	       message/rfc822 part goes straight on to the
+	       headers of the message it holds. both need room
+	       for a child, otherwise they are read as leaves.
+
+*/
+
+static void end_headers(commc_mime_parser_t* parser,
+                        size_t               offset) {
+
+    commc_mime_part_t* part     = &parser->parts[parser->depth];
+    int                room     = parser->depth + 1 < COMMC_MIME_MAX_DEPTH;
+    int                embedded = 0;
+
+    part->body_offset  = offset;
+    part->is_multipart = room && part->boundary[0] != '\0' &&
+                         strncmp(part->content_type, "multipart/", 10) == 0;
+
+    /* RFC 2046: an encoded message/rfc822 part is not allowed */
+
+    if (room && !part->is_multipart && strcmp(part->content_type, "message/rfc822") == 0) {
+
+        embedded = part->encoding == COMMC_MIME_ENCODING_7BIT ||
+                   part->encoding == COMMC_MIME_ENCODING_8BIT ||
+                   part->encoding == COMMC_MIME_ENCODING_BINARY;
+
+    }
+
+    parser->state       = MIME_BODY;
+    parser->line_start  = 1;
+    parser->line_offset = offset;
+    parser->look_length = 0;
+    parser->held        = 0;
+    parser->held_cr     = 0;
+    parser->skip        = 0;
+
+    emit_simple(parser, COMMC_MIME_EVENT_BODY_BEGIN, offset, 0);
+
+    if (part->is_multipart) {
+
+        parser->boundary_length[parser->depth] = strlen(part->boundary);
+        parser->delimited[parser->depth]       = 1;
+        parser->skip                           = 1;
+
+    } else if (embedded) {
+
+        parser->skip = 1;
+        begin_part(parser, offset);
+
+    }
+
+}
+
+/*
+
+         end_parts()
+	       ---
+	       ends every part deeper than level, their
+	       bodies ending at offset. a part still reading
+	       headers gets its body (empty) first.
+
+*/
+
+static void end_parts(commc_mime_parser_t* parser,
+                      int                  level,
+                      size_t               offset) {
+
+    commc_mime_part_t* part;
+
+    while (parser->depth > level) {
+
+        if (parser->state == MIME_HEADERS) {
+
+            end_field(parser, offset);
+            end_headers(parser, offset);
+            continue;
+
+        }
+
+        flush_span(parser);
+        finish_decoding(parser);
+
+        part              = &parser->parts[parser->depth];
+        part->body_length = offset - part->body_offset;
+
+        emit_simple(parser, COMMC_MIME_EVENT_PART_END, part->offset, offset - part->offset);
+
+        /* the parent is a container whose body bytes are dropped */
+
+        parser->depth--;
+        parser->skip = 1;
+
+    }
+
+}
+
+/*
+
+         delimiter()
+	       ---
+	       acts on a delimiter of the multipart at level:
+	       the parts inside it end at body_end, and either
+	       the next part begins at next or, for a closing
+	       delimiter, its epilogue (dropped) does.
+
+*/
+
+static void delimiter(commc_mime_parser_t* parser,
+                      int                  level,
+                      int                  close,
+                      size_t               body_end,
+                      size_t               next) {
+
+    flush_span(parser);
+    end_parts(parser, level, body_end);
+
+    if (close) {
+
+        parser->delimited[level] = 0;
+        parser->state            = MIME_BODY;
+        parser->line_start       = 1;
+        parser->line_offset      = next;
+        parser->look_length      = 0;
+        parser->held             = 0;
+        parser->held_cr          = 0;
+        parser->skip             = 1;
+
+    } else {
+
+        begin_part(parser, next);
+
+    }
+
+}
+
+/*
+	==================================
+             --- SCANNING ---
+	==================================
+*/
+
+/*
+
+         parse_headers()
+	       ---
+	       reads header lines up to the blank line ending
+	       them (or a delimiter, for a part missing one).
+
+*/
+
+static const char* parse_headers(commc_mime_parser_t* parser,
+                                 const char*          p,
+                                 const char*          end) {
+
+    size_t offset;
+    int    level;
+    int    close;
+    char   c;
+
+    while (p < end && parser->state == MIME_HEADERS && parser->error == COMMC_SUCCESS) {
+
+        c      = *p++;
+        offset = parser->base + (size_t)(p - parser->chunk);
+
+        if (c == '\r') {
+
+            continue;
+
+        }
+
+        if (parser->line_start) {
+
+            if (c == '\n') {
+
+                end_field(parser, parser->line_offset);
+                end_headers(parser, offset);
+                break;
+
+            }
+
+            parser->line_start = 0;
+
+            /* a line starting with a blank continues the field */
+
+            if (is_blank(c) && parser->field_length > 0) {
+
+                parser->field_line = 0;
+
+            } else {
+
+                end_field(parser, parser->line_offset);
+
+                parser->field_offset = parser->line_offset;
+                parser->field_line   = 1;
+
+            }
+
+        }
+
+        if (c == '\n') {
+
+            if (parser->field_line &&
+                match_delimiter(parser, parser->field, parser->field_length, &level, &close)) {
+
+                parser->field_length = 0;
+
+                delimiter(parser, level, close, parser->field_offset, offset);
+                break;
+
+            }
+
+            parser->line_start  = 1;
+            parser->line_offset = offset;
+            continue;
+
+        }
+
+        if (parser->field_length == COMMC_MIME_MAX_FIELD) {
+
+            parser->error = COMMC_ERROR_BUFFER_TOO_SMALL;
+            break;
+
+        }
+
+        parser->field[parser->field_length++] = c;
+
+    }
+
+    return p;
+
+}
+
+/*
+
+         scan_body()
+	       ---
+	       passes body bytes on, line by line, until a
+	       delimiter of an open multipart.
+
+*/
+
+static const char* scan_body(commc_mime_parser_t* parser,
+                             const char*          p,
+                             const char*          end) {
+
+    const char* line_end;
+    size_t      length;
+    int         crlf;
+    int         level;
+    int         close;
+    char        c;
+
+    while (p < end && parser->state == MIME_BODY && parser->error == COMMC_SUCCESS) {
+
+        if (!parser->line_start) {
+
+            line_end = (const char*)memchr(p, '\n', (size_t)(end - p));
+
+            if (!line_end) {
+
+                length = (size_t)(end - p);
+
+                release_held(parser);
+
+                /* a CR at the end may start the line end */
+
+                if (p[length - 1] == '\r') {
+
+                    length--;
+
+                    parser->held_cr        = 1;
+                    parser->held_cr_offset = parser->base + (size_t)(p + length - parser->chunk);
+
+                }
+
+                content(parser, p, length, parser->base + (size_t)(p - parser->chunk));
+                return end;
+
+            }
+
+            length = (size_t)(line_end - p);
+            crlf   = length > 0 ? line_end[-1] == '\r' : parser->held_cr;
+
+            if (length > 0) {
+
+                release_held(parser);
+                content(parser, p, crlf ? length - 1 : length, parser->base + (size_t)(p - parser->chunk));
+
+            }
+
+            parser->held        = crlf ? 2 : 1;
+            parser->held_offset = crlf && length == 0 ? parser->held_cr_offset :
+                                  parser->base + (size_t)(line_end - parser->chunk) - (size_t)crlf;
+            parser->held_cr     = 0;
+
+            p = line_end + 1;
+
+            parser->line_start  = 1;
+            parser->line_offset = parser->base + (size_t)(p - parser->chunk);
+            continue;
+
+        }
+
+        c = *p;
+
+        if (c == '\n') {
+
+            length = parser->look_length;
+            crlf   = length > 0 && parser->look[length - 1] == '\r';
+
+            if (match_delimiter(parser, parser->look, length - (size_t)crlf, &level, &close)) {
+
+                delimiter(parser, level, close,
+                          parser->held ? parser->held_offset : parser->line_offset,
+                          parser->base + (size_t)(p + 1 - parser->chunk));
+
+                return p + 1;
+
+            }
+
+            release_held(parser);
+            release_look(parser, length - (size_t)crlf);
+
+            parser->held        = crlf ? 2 : 1;
+            parser->held_offset = parser->base + (size_t)(p - parser->chunk) - (size_t)crlf;
+
+            p++;
+
+            parser->line_offset = parser->base + (size_t)(p - parser->chunk);
+            continue;
+
+        }
+
+        /* only lines starting "--" (or a CR, for an empty CRLF line) may be delimiters */
+
+        length = parser->look_length;
+
+        if ((length == 0 && (c == '-' || c == '\r')) ||
+            (length == 1 && parser->look[0] == '-' && c == '-') ||
+            (length >= 2 && parser->look[0] == '-' && length < MIME_LOOK_SIZE)) {
+
+            parser->look[parser->look_length++] = c;
+            p++;
+            continue;
+
+        }
+
+        release_held(parser);
+        release_look(parser, length);
+
+        parser->line_start = 0;
+
+    }
+
+    return p;
+
+}
+
+/*
+
+         start()
+	       ---
+	       opens the message itself before its first byte.
+
+*/
+
+static void start(commc_mime_parser_t* parser) {
+
+    if (!parser->started) {
+
+        parser->started = 1;
+
+        emit_simple(parser, COMMC_MIME_EVENT_PART_BEGIN, 0, 0);
+
+    }
+
+}
+
+/*
+	==================================
+             --- CORE ---
+	==================================
+*/
+
+/*
+
+         commc_mime_parser_create()
+	       ---
+	       creates a parser handing its events to
+	       callback.
+
+*/
+
+commc_error_t commc_mime_parser_create(commc_mime_parser_t** parser,
+                                       commc_mime_callback_t callback,
+                                       void*                 user_data) {
+
+    commc_mime_parser_t* new_parser;
+
+    if (!parser || !callback) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    new_parser = (commc_mime_parser_t*)malloc(sizeof(commc_mime_parser_t));
+
+    if (!new_parser) {
+
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    new_parser->callback  = callback;
+    new_parser->user_data = user_data;
+
+    commc_mime_parser_reset(new_parser);
+
+    *parser = new_parser;
+
+    return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_mime_parser_destroy()
+	       ---
+	       frees a parser.
+
+*/
+
+void commc_mime_parser_destroy(commc_mime_parser_t* parser) {
+
+    free(parser);
+
+}
+
+/*
+
+         commc_mime_parser_reset()
+	       ---
+	       readies a parser for a new message, keeping its
+	       callback.
+
+*/
+
+void commc_mime_parser_reset(commc_mime_parser_t* parser) {
+
+    commc_mime_part_t* message;
+
+    if (!parser) {
+
+        return;
+
+    }
+
+    parser->error       = COMMC_SUCCESS;
+    parser->started     = 0;
+    parser->finished    = 0;
+    parser->chunk       = NULL;
+    parser->chunk_end   = NULL;
+    parser->base        = 0;
+
+    parser->state        = MIME_HEADERS;
+    parser->depth        = 0;
+    parser->part_count   = 1;
+    parser->delimited[0] = 0;
+
+    parser->line_start   = 1;
+    parser->line_offset  = 0;
+    parser->field_length = 0;
+    parser->field_offset = 0;
+    parser->field_line   = 0;
+
+    parser->skip        = 0;
+    parser->look_length = 0;
+    parser->held        = 0;
+    parser->held_cr     = 0;
+    parser->span        = NULL;
+    parser->span_length = 0;
+
+    parser->bits          = 0;
+    parser->bit_count     = 0;
+    parser->qp_state      = MIME_QP_TEXT;
+    parser->space_count   = 0;
+    parser->output_length = 0;
+
+    message = &parser->parts[0];
+
+    memset(message, 0, sizeof(commc_mime_part_t));
+    strcpy(message->content_type, "text/plain");
+
+    message->encoding = COMMC_MIME_ENCODING_7BIT;
+
+}
+
+/*
+
+         commc_mime_parser_write()
+	       ---
+	       parses the next length bytes of the message.
+
+*/
+
+commc_error_t commc_mime_parser_write(commc_mime_parser_t* parser,
+                                      const void*          data,
+                                      size_t               length) {
+
+    const char* p   = (const char*)data;
+    const char* end = p + length;
+
+    if (!parser || (!data && length > 0)) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (parser->error != COMMC_SUCCESS) {
+
+        return parser->error;
+
+    }
+
+    if (parser->finished) {
+
+        return COMMC_ERROR_INVALID_STATE;
+
+    }
+
+    start(parser);
+
+    parser->chunk     = p;
+    parser->chunk_end = end;
+
+    while (p < end && parser->error == COMMC_SUCCESS) {
+
+        p = parser->state == MIME_HEADERS ? parse_headers(parser, p, end) :
+                                            scan_body(parser, p, end);
+
+    }
+
+    /* nothing may point into the input once it is handed back */
+
+    flush_span(parser);
+    flush_output(parser);
+
+    parser->chunk     = NULL;
+    parser->chunk_end = NULL;
+    parser->base     += length;
+
+    return parser->error;
+
+}
+
+/*
+
+         commc_mime_parser_finish()
+	       ---
+	       ends the message, closing every open part.
+
+*/
+
+commc_error_t commc_mime_parser_finish(commc_mime_parser_t* parser) {
+
+    size_t length;
+    int    crlf;
+    int    level;
+    int    close;
+
+    if (!parser) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    if (parser->error != COMMC_SUCCESS) {
+
+        return parser->error;
+
+    }
+
+    if (parser->finished) {
+
+        return COMMC_ERROR_INVALID_STATE;
+
+    }
+
+    start(parser);
+
+    /* the last line may be a delimiter without a line end */
+
+    if (parser->state == MIME_HEADERS) {
+
+        if (!parser->line_start && parser->field_line &&
+            match_delimiter(parser, parser->field, parser->field_length, &level, &close)) {
+
+            parser->field_length = 0;
+
+            delimiter(parser, level, close, parser->field_offset, parser->base);
+
+        }
+
+    } else if (parser->line_start && parser->look_length > 0) {
+
+        length = parser->look_length;
+        crlf   = parser->look[length - 1] == '\r';
+
+        if (match_delimiter(parser, parser->look, length - (size_t)crlf, &level, &close)) {
+
+            delimiter(parser, level, close,
+                      parser->held ? parser->held_offset : parser->line_offset, parser->base);
+
+        } else {
+
+            release_held(parser);
+            release_look(parser, length);
+
+        }
+
+    }
+
+    if (parser->state == MIME_BODY) {
+
+        release_held(parser);
+
+    }
+
+    end_parts(parser, -1, parser->base);
+
+    parser->finished = 1;
+
+    return parser->error;
+
+}
+
+/*
+
+         commc_mime_parser_skip_body()
+	       ---
+	       stops reporting the current part's body.
+
+*/
+
+void commc_mime_parser_skip_body(commc_mime_parser_t* parser) {
+
+    if (parser && parser->state == MIME_BODY) {
+
+        parser->skip = 1;
+
+    }
+
+}
+
+/*
+	==================================
+           --- WHOLE INPUT ---
+	==================================
+*/
+
+/*
+
+         commc_mime_parser_parse()
+	       ---
+	       parses a message held whole in memory.
+
+*/
+
+commc_error_t commc_mime_parser_parse(commc_mime_parser_t* parser,
+                                      const void*          data,
+                                      size_t               length) {
+
+    commc_error_t result;
+
+    if (!parser || (!data && length > 0)) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+    commc_mime_parser_reset(parser);
+
+    result = commc_mime_parser_write(parser, data, length);
+
+    return result == COMMC_SUCCESS ? commc_mime_parser_finish(parser) : result;
+
+}
+
+/*
+
+         commc_mime_parser_parse_file()
+	       ---
+	       parses the message in a file, mapped if
+	       possible.
+
+*/
+
+commc_error_t commc_mime_parser_parse_file(commc_mime_parser_t* parser,
+                                           const char*          path) {
+
+    FILE*         file;
+    char*         buffer;
+    size_t        got;
+    commc_error_t result;
+
+#ifdef MIME_HAVE_MMAP
+    struct stat   status;
+    void*         view;
+    int           handle;
+#endif
+
+    if (!parser || !path) {
+
+        return COMMC_ERROR_INVALID_ARGUMENT;
+
+    }
+
+#ifdef MIME_HAVE_MMAP
+    handle = open(path, O_RDONLY);
+
+    if (handle < 0) {
+
+        return COMMC_IO_ERROR;
+
+    }
+
+    if (fstat(handle, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0 &&
+        (off_t)(size_t)status.st_size == status.st_size) {
+
+        view = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, handle, 0);
+
+        if (view != MAP_FAILED) {
+
+            close(handle);
+
+            result = commc_mime_parser_parse(parser, view, (size_t)status.st_size);
+
+            munmap(view, (size_t)status.st_size);
+            return result;
+
+        }
+
+    }
+
+    close(handle);
+#endif
+
+    /* empty files, pipes and systems without mmap are read in pieces */
+
+    file = fopen(path, "rb");
+
+    if (!file) {
+
+        return COMMC_IO_ERROR;
+
+    }
+
+    buffer = (char*)malloc(COMMC_MIME_READ_SIZE);
+
+    if (!buffer) {
+
+        fclose(file);
+        return COMMC_MEMORY_ERROR;
+
+    }
+
+    commc_mime_parser_reset(parser);
+
+    result = COMMC_SUCCESS;
+
+    while (result == COMMC_SUCCESS && (got = fread(buffer, 1, COMMC_MIME_READ_SIZE, file)) > 0) {
+
+        result = commc_mime_parser_write(parser, buffer, got);
+
+    }
+
+    if (result == COMMC_SUCCESS) {
+
+        result = ferror(file) ? COMMC_IO_ERROR : commc_mime_parser_finish(parser);
+
+    }
+
+    free(buffer);
+    fclose(file);
+
+    return result;
+
+}
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
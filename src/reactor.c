@@ -0,0 +1,1178 @@
+/*
+   ===================================
+   C O M M O N - C
+   MULTI-REACTOR IMPLEMENTATION
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+            --- MULTI-REACTOR IMPLEMENTATION ---
+
+    every loop is a thread running commc_async_run() on its own
+    context. nothing here is shared between loops at run time:
+    the only cross-thread traffic is the post stack of the
+    target context, which also carries stop requests, so a
+    stop can never be lost to a loop that has not entered its
+    run yet.
+
+    listeners keep one accept pending per loop. when the
+    process runs out of descriptors the accept is retried from
+    a timer instead of spinning on EMFILE.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+  #define _GNU_SOURCE  /* CPU_SET, PTHREAD_SETAFFINITY_NP */
+#elif !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+  #define _POSIX_C_SOURCE 200112L  /* PTHREADS, SYSCONF */
+#endif
+
+#include "commc/reactor.h"
+#include "commc/atomic.h"
+#include "commc/error.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+  #include <winsock2.h>
+#else
+  #include <pthread.h>
+  #include <sched.h>
+  #include <unistd.h>
+  #include <fcntl.h>
+  #include <sys/types.h>
+  #include <sys/socket.h>
+#endif
+
+/*
+	==================================
+             --- CONSTANTS ---
+	==================================
+*/
+
+/* only these spread connections across the sockets sharing a
+   port; plain SO_REUSEPORT on the BSDs and macOS does not. */
+
+#if defined(SO_REUSEPORT_LB)
+  #define REACTOR_REUSEPORT  SO_REUSEPORT_LB
+#elif defined(__linux__) && defined(SO_REUSEPORT)
+  #define REACTOR_REUSEPORT  SO_REUSEPORT
+#endif
+
+/*
+	==================================
+             --- PLATFORM THREADS ---
+	==================================
+*/
+
+#ifdef _WIN32
+
+  typedef HANDLE      reactor_thread_t;
+  typedef DWORD       reactor_key_t;
+  typedef SOCKET      reactor_socket_t;
+
+  #define REACTOR_CLOSE_SOCKET(s)  closesocket((SOCKET)(s))
+  #define REACTOR_BAD_SOCKET       INVALID_SOCKET
+
+#else
+
+  typedef pthread_t   reactor_thread_t;
+  typedef pthread_key_t reactor_key_t;
+  typedef int         reactor_socket_t;
+
+  #define REACTOR_CLOSE_SOCKET(s)  close(s)
+  #define REACTOR_BAD_SOCKET       (-1)
+
+#endif
+
+/*
+	==================================
+             --- INTERNAL TYPES ---
+	==================================
+*/
+
+struct reactor_listener_t;
+
+/*
+
+         reactor_loop_t
+	       ---
+	       one event loop: its context, thread and the task
+	       that stops it.
+
+*/
+
+typedef struct {
+
+  commc_reactor_t*        reactor;    /* OWNING REACTOR */
+  size_t                  index;      /* POSITION IN LOOPS */
+  commc_async_context_t*  ctx;        /* LOOP CONTEXT */
+  reactor_thread_t        thread;     /* LOOP THREAD */
+  int                     running;    /* THREAD CREATED AND NOT JOINED */
+  int                     cpu;        /* PIN TARGET */
+  commc_async_task_t      stop_task;  /* POSTED BY COMMC_REACTOR_STOP */
+
+} reactor_loop_t;
+
+/*
+
+         reactor_acceptor_t
+	       ---
+	       accept state of one listener on one loop. lives
+	       until the reactor is destroyed because pending
+	       operations and timers point into it.
+
+*/
+
+typedef struct {
+
+  struct reactor_listener_t*  listener;   /* OWNING LISTENER */
+  size_t                      index;      /* LOOP INDEX */
+  commc_async_context_t*      ctx;        /* LOOP CONTEXT */
+  int                         handle;     /* LISTENING SOCKET */
+  int                         owns_handle; /* CLOSED AT DESTROY */
+  int                         client;     /* ACCEPT OUTPUT */
+  commc_async_task_t          start;      /* FIRST ACCEPT, POSTED TO THE LOOP */
+  commc_async_timer_t         backoff;    /* RETRY AFTER DESCRIPTOR EXHAUSTION */
+
+} reactor_acceptor_t;
+
+/*
+
+         reactor_listener_t
+	       ---
+	       one commc_reactor_listen() call.
+
+*/
+
+typedef struct reactor_listener_t {
+
+  struct reactor_listener_t*  next;       /* REACTOR LISTENER LIST */
+  commc_reactor_t*            reactor;    /* OWNING REACTOR */
+  commc_reactor_accept_fn     on_accept;  /* CONNECTION CALLBACK */
+  void*                       user_data;  /* PASSED TO ON_ACCEPT */
+  reactor_acceptor_t*         acceptors;  /* ONE PER LOOP */
+
+} reactor_listener_t;
+
+/*
+
+         commc_reactor_t
+	       ---
+	       loops, the thread-local key that identifies them,
+	       and the listeners.
+
+*/
+
+struct commc_reactor_t {
+
+  reactor_loop_t*         loops;       /* LOOP ARRAY */
+  size_t                  loop_count;  /* NUMBER OF LOOPS */
+  commc_reactor_config_t  config;      /* CREATION PARAMETERS */
+  reactor_key_t           self_key;    /* CURRENT LOOP OF A THREAD */
+  int                     has_key;     /* SELF_KEY WAS CREATED */
+  int                     started;     /* START WAS CALLED */
+  int                     stopping;    /* STOP WAS CALLED */
+  reactor_listener_t*     listeners;   /* LISTEN CALLS */
+
+};
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         get_self()
+	       ---
+	       returns the calling loop of reactor, or NULL.
+
+*/
+
+static reactor_loop_t* get_self(const commc_reactor_t* reactor) {
+
+#ifdef _WIN32
+  return (reactor_loop_t*)TlsGetValue(reactor->self_key);
+#else
+  return (reactor_loop_t*)pthread_getspecific(reactor->self_key);
+#endif
+
+}
+
+/*
+
+         set_self()
+	       ---
+	       registers the calling thread as loop.
+
+*/
+
+static void set_self(commc_reactor_t* reactor, reactor_loop_t* loop) {
+
+#ifdef _WIN32
+  TlsSetValue(reactor->self_key, loop);
+#else
+  pthread_setspecific(reactor->self_key, loop);
+#endif
+
+}
+
+/*
+
+         usable_cpus()
+	       ---
+	       stores up to max CPUs the process may run on, in
+	       ascending order, and returns how many it stored
+	       (at least 1).
+
+*/
+
+static size_t usable_cpus(int* cpus, size_t max) {
+
+  size_t count = 0;
+
+#if defined(__linux__)
+  cpu_set_t set;
+  int       cpu;
+
+  CPU_ZERO(&set);
+
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+
+    for (cpu = 0; cpu < CPU_SETSIZE && count < max; cpu++) {
+
+      if (CPU_ISSET(cpu, &set)) {
+
+        cpus[count++] = cpu;
+
+      }
+
+    }
+
+  }
+#elif defined(_WIN32)
+  DWORD_PTR process_mask;
+  DWORD_PTR system_mask;
+  int       cpu;
+
+  if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+
+    for (cpu = 0; cpu < (int)(8 * sizeof(DWORD_PTR)) && count < max; cpu++) {
+
+      if (process_mask & ((DWORD_PTR)1 << cpu)) {
+
+        cpus[count++] = cpu;
+
+      }
+
+    }
+
+  }
+#else
+  long online;
+
+  online = sysconf(_SC_NPROCESSORS_ONLN);
+
+  while (online > 0 && count < max && (long)count < online) {
+
+    cpus[count] = (int)count;
+    count++;
+
+  }
+#endif
+
+  if (count == 0) {
+
+    cpus[0] = 0;
+    count   = 1;
+
+  }
+
+  return count;
+
+}
+
+/*
+
+         pin_thread()
+	       ---
+	       binds the calling thread to cpu. best effort; a
+	       no-op where affinity is not supported.
+
+*/
+
+static void pin_thread(int cpu) {
+
+#if defined(__linux__)
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(_WIN32)
+  SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu);
+#else
+  (void)cpu;
+#endif
+
+}
+
+/*
+
+         stop_loop()
+	       ---
+	       stop task: ends the run of the loop it executes on.
+
+*/
+
+static void stop_loop(void* arg) {
+
+  commc_async_stop(((reactor_loop_t*)arg)->ctx);
+
+}
+
+/*
+
+         loop_main()
+	       ---
+	       body of a loop thread.
+
+*/
+
+static void loop_main(reactor_loop_t* loop) {
+
+  commc_reactor_t* reactor = loop->reactor;
+
+  set_self(reactor, loop);
+
+  if (reactor->config.pin_threads) {
+
+    pin_thread(loop->cpu);
+
+  }
+
+  if (reactor->config.on_start) {
+
+    reactor->config.on_start(reactor, loop->index, loop->ctx, reactor->config.user_data);
+
+  }
+
+  commc_async_run(loop->ctx);
+
+  if (reactor->config.on_stop) {
+
+    reactor->config.on_stop(reactor, loop->index, loop->ctx, reactor->config.user_data);
+
+  }
+
+  set_self(reactor, NULL);
+
+}
+
+#ifdef _WIN32
+
+static DWORD WINAPI loop_entry(LPVOID param) {
+
+  loop_main((reactor_loop_t*)param);
+  return 0;
+
+}
+
+#else
+
+static void* loop_entry(void* param) {
+
+  loop_main((reactor_loop_t*)param);
+  return NULL;
+
+}
+
+#endif
+
+/*
+	==================================
+             --- ACCEPTING ---
+	==================================
+*/
+
+static void arm_accept(reactor_acceptor_t* acceptor);
+
+/*
+
+         out_of_descriptors()
+	       ---
+	       checks for accept errors that persist until some
+	       connection is closed, so retrying at once would
+	       spin.
+
+*/
+
+static int out_of_descriptors(int error) {
+
+  return error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM;
+
+}
+
+/*
+
+         accept_done()
+	       ---
+	       hands a new connection to the listener callback
+	       and keeps the next accept pending.
+
+*/
+
+static void accept_done(const commc_async_result_t* result) {
+
+  reactor_acceptor_t* acceptor = (reactor_acceptor_t*)result->user_data;
+  reactor_listener_t* listener = acceptor->listener;
+
+  if (result->error_code == 0) {
+
+    listener->on_accept(listener->reactor, acceptor->index, acceptor->ctx,
+                        acceptor->client, listener->user_data);
+
+  } else if (result->error_code == ECANCELED) {
+
+    return;
+
+  } else if (out_of_descriptors(result->error_code)) {
+
+    commc_async_timer_start(acceptor->ctx, &acceptor->backoff,
+                            COMMC_REACTOR_ACCEPT_BACKOFF_MS, 0);
+    return;
+
+  }
+
+  /* aborted handshakes and the like only affect that connection */
+
+  arm_accept(acceptor);
+
+}
+
+/*
+
+         backoff_done()
+	       ---
+	       retries an accept after descriptor exhaustion.
+
+*/
+
+static void backoff_done(const commc_async_result_t* result) {
+
+  arm_accept((reactor_acceptor_t*)result->user_data);
+
+}
+
+/*
+
+         start_accepting()
+	       ---
+	       posted task that issues the first accept on the
+	       acceptor's own loop.
+
+*/
+
+static void start_accepting(void* arg) {
+
+  arm_accept((reactor_acceptor_t*)arg);
+
+}
+
+/*
+
+         arm_accept()
+	       ---
+	       submits the accept of an acceptor, or schedules a
+	       retry if that fails.
+
+*/
+
+static void arm_accept(reactor_acceptor_t* acceptor) {
+
+  if (commc_async_accept(acceptor->ctx, acceptor->handle, &acceptor->client,
+                         NULL, 0, accept_done, acceptor) != 0) {
+
+    commc_async_timer_start(acceptor->ctx, &acceptor->backoff,
+                            COMMC_REACTOR_ACCEPT_BACKOFF_MS, 0);
+
+  }
+
+}
+
+/*
+
+         open_listener()
+	       ---
+	       creates a non-blocking listening socket bound to
+	       address, optionally sharing the port with others.
+
+*/
+
+static int open_listener(const struct sockaddr* address,
+                         size_t address_size,
+                         int backlog,
+                         int reuse_port) {
+
+  reactor_socket_t handle;
+  int              one = 1;
+#ifdef _WIN32
+  unsigned long    mode = 1;
+#else
+  int              flags;
+#endif
+
+  handle = socket(address->sa_family, SOCK_STREAM, 0);
+
+  if (handle == REACTOR_BAD_SOCKET) {
+
+    return -1;
+
+  }
+
+#ifndef _WIN32
+  fcntl(handle, F_SETFD, FD_CLOEXEC);
+#endif
+
+  setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+
+#ifdef REACTOR_REUSEPORT
+  if (reuse_port &&
+      setsockopt(handle, SOL_SOCKET, REACTOR_REUSEPORT, (const char*)&one, sizeof(one)) != 0) {
+
+    REACTOR_CLOSE_SOCKET(handle);
+    return -1;
+
+  }
+#else
+  (void)reuse_port;
+#endif
+
+  if (bind(handle, address, (int)address_size) != 0 || listen(handle, backlog) != 0) {
+
+    REACTOR_CLOSE_SOCKET(handle);
+    return -1;
+
+  }
+
+#ifdef _WIN32
+  if (ioctlsocket(handle, FIONBIO, &mode) != 0) {
+#else
+  flags = fcntl(handle, F_GETFL, 0);
+  if (flags == -1 || fcntl(handle, F_SETFL, flags | O_NONBLOCK) != 0) {
+#endif
+
+    REACTOR_CLOSE_SOCKET(handle);
+    return -1;
+
+  }
+
+  return (int)handle;
+
+}
+
+/*
+
+         free_listener()
+	       ---
+	       closes the sockets of a listener and frees it.
+	       its loops must no longer run.
+
+*/
+
+static void free_listener(reactor_listener_t* listener, size_t loop_count) {
+
+  size_t i;
+
+  for (i = 0; i < loop_count; i++) {
+
+    if (listener->acceptors[i].owns_handle) {
+
+      REACTOR_CLOSE_SOCKET(listener->acceptors[i].handle);
+
+    }
+
+  }
+
+  free(listener->acceptors);
+  free(listener);
+
+}
+
+/*
+	==================================
+             --- CORE API ---
+	==================================
+*/
+
+/*
+
+         commc_reactor_config_init()
+	       ---
+	       fills config with defaults.
+
+*/
+
+void commc_reactor_config_init(commc_reactor_config_t* config) {
+
+  if (!config) {
+
+    return;
+
+  }
+
+  memset(config, 0, sizeof(commc_reactor_config_t));
+  config->loop_count  = 0;
+  config->pin_threads = 1;
+  config->max_events  = 0;
+  config->backend     = COMMC_ASYNC_BACKEND_DEFAULT;
+
+}
+
+/*
+
+         commc_reactor_create()
+	       ---
+	       allocates the loops and their contexts.
+
+*/
+
+commc_reactor_t* commc_reactor_create(const commc_reactor_config_t* config) {
+
+  commc_reactor_t* reactor;
+  int              cpus[COMMC_REACTOR_MAX_LOOPS];
+  size_t           cpu_count;
+  size_t           i;
+
+  reactor = (commc_reactor_t*)malloc(sizeof(commc_reactor_t));
+
+  if (!reactor) {
+
+    return NULL;
+
+  }
+
+  memset(reactor, 0, sizeof(commc_reactor_t));
+
+  if (config) {
+
+    reactor->config = *config;
+
+  } else {
+
+    commc_reactor_config_init(&reactor->config);
+
+  }
+
+  cpu_count = usable_cpus(cpus, COMMC_REACTOR_MAX_LOOPS);
+
+  reactor->loop_count = reactor->config.loop_count ? reactor->config.loop_count : cpu_count;
+
+  if (reactor->loop_count > COMMC_REACTOR_MAX_LOOPS) {
+
+    reactor->loop_count = COMMC_REACTOR_MAX_LOOPS;
+
+  }
+
+  reactor->loops = (reactor_loop_t*)malloc(reactor->loop_count * sizeof(reactor_loop_t));
+
+  if (!reactor->loops) {
+
+    free(reactor);
+    return NULL;
+
+  }
+
+  memset(reactor->loops, 0, reactor->loop_count * sizeof(reactor_loop_t));
+
+  for (i = 0; i < reactor->loop_count; i++) {
+
+    reactor->loops[i].reactor = reactor;
+    reactor->loops[i].index   = i;
+    reactor->loops[i].cpu     = cpus[i % cpu_count];
+    reactor->loops[i].ctx     = commc_async_context_create_with_backend(reactor->config.max_events,
+                                                                        COMMC_ASYNC_DEFAULT_TIMEOUT,
+                                                                        reactor->config.backend);
+
+    commc_async_task_init(&reactor->loops[i].stop_task, stop_loop, &reactor->loops[i]);
+
+    if (!reactor->loops[i].ctx) {
+
+      commc_reactor_destroy(reactor);
+      return NULL;
+
+    }
+
+  }
+
+#ifdef _WIN32
+  reactor->self_key = TlsAlloc();
+  if (reactor->self_key == TLS_OUT_OF_INDEXES) {
+    commc_reactor_destroy(reactor);
+    return NULL;
+  }
+#else
+  if (pthread_key_create(&reactor->self_key, NULL) != 0) {
+    commc_reactor_destroy(reactor);
+    return NULL;
+  }
+#endif
+
+  reactor->has_key = 1;
+
+  return reactor;
+
+}
+
+/*
+
+         commc_reactor_destroy()
+	       ---
+	       stops and joins the loops, then frees everything.
+
+*/
+
+void commc_reactor_destroy(commc_reactor_t* reactor) {
+
+  reactor_listener_t* listener;
+  size_t              i;
+
+  if (!reactor) {
+
+    return;
+
+  }
+
+  commc_reactor_stop(reactor);
+  commc_reactor_join(reactor);
+
+  /* contexts first: their pending accepts still reference the sockets */
+
+  for (i = 0; i < reactor->loop_count; i++) {
+
+    commc_async_context_destroy(reactor->loops[i].ctx);
+
+  }
+
+  while (reactor->listeners) {
+
+    listener           = reactor->listeners;
+    reactor->listeners = listener->next;
+    free_listener(listener, reactor->loop_count);
+
+  }
+
+  if (reactor->has_key) {
+
+#ifdef _WIN32
+    TlsFree(reactor->self_key);
+#else
+    pthread_key_delete(reactor->self_key);
+#endif
+
+  }
+
+  free(reactor->loops);
+  free(reactor);
+
+}
+
+/*
+
+         commc_reactor_start()
+	       ---
+	       creates the loop threads.
+
+*/
+
+commc_error_t commc_reactor_start(commc_reactor_t* reactor) {
+
+  reactor_loop_t* loop;
+  size_t          i;
+
+  if (!reactor) {
+
+    return COMMC_ARGUMENT_ERROR;
+
+  }
+
+  if (reactor->started || COMMC_ATOMIC_LOAD_ACQUIRE(&reactor->stopping)) {
+
+    return COMMC_ERROR_INVALID_STATE;
+
+  }
+
+  reactor->started = 1;
+
+  for (i = 0; i < reactor->loop_count; i++) {
+
+    loop = &reactor->loops[i];
+
+#ifdef _WIN32
+    loop->thread = CreateThread(NULL, 0, loop_entry, loop, 0, NULL);
+
+    if (!loop->thread) {
+#else
+    if (pthread_create(&loop->thread, NULL, loop_entry, loop) != 0) {
+#endif
+
+      commc_reactor_stop(reactor);
+      commc_reactor_join(reactor);
+      return COMMC_SYSTEM_ERROR;
+
+    }
+
+    loop->running = 1;
+
+  }
+
+  return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_reactor_stop()
+	       ---
+	       posts each loop its stop task. the first call
+	       wins, so no task is ever queued twice.
+
+*/
+
+void commc_reactor_stop(commc_reactor_t* reactor) {
+
+  size_t i;
+
+  if (!reactor || !COMMC_ATOMIC_CAS(&reactor->stopping, 0, 1)) {
+
+    return;
+
+  }
+
+  for (i = 0; i < reactor->loop_count; i++) {
+
+    if (reactor->loops[i].ctx) {
+
+      commc_async_post_task(reactor->loops[i].ctx, &reactor->loops[i].stop_task);
+
+    }
+
+  }
+
+}
+
+/*
+
+         commc_reactor_join()
+	       ---
+	       waits for every started loop thread.
+
+*/
+
+void commc_reactor_join(commc_reactor_t* reactor) {
+
+  size_t i;
+
+  if (!reactor) {
+
+    return;
+
+  }
+
+  for (i = 0; i < reactor->loop_count; i++) {
+
+    if (!reactor->loops[i].running) {
+
+      continue;
+
+    }
+
+#ifdef _WIN32
+    WaitForSingleObject(reactor->loops[i].thread, INFINITE);
+    CloseHandle(reactor->loops[i].thread);
+#else
+    pthread_join(reactor->loops[i].thread, NULL);
+#endif
+
+    reactor->loops[i].running = 0;
+
+  }
+
+}
+
+/*
+
+         commc_reactor_loop_count()
+	       ---
+	       returns the number of loops.
+
+*/
+
+size_t commc_reactor_loop_count(const commc_reactor_t* reactor) {
+
+  return reactor ? reactor->loop_count : 0;
+
+}
+
+/*
+
+         commc_reactor_context()
+	       ---
+	       returns the context of loop index.
+
+*/
+
+commc_async_context_t* commc_reactor_context(const commc_reactor_t* reactor,
+                                             size_t index) {
+
+  if (!reactor || index >= reactor->loop_count) {
+
+    return NULL;
+
+  }
+
+  return reactor->loops[index].ctx;
+
+}
+
+/*
+
+         commc_reactor_current_loop()
+	       ---
+	       looks the calling thread up in the reactor's
+	       thread-local key.
+
+*/
+
+int commc_reactor_current_loop(const commc_reactor_t* reactor) {
+
+  reactor_loop_t* loop;
+
+  if (!reactor || !reactor->has_key) {
+
+    return -1;
+
+  }
+
+  loop = get_self(reactor);
+
+  return loop ? (int)loop->index : -1;
+
+}
+
+/*
+	==================================
+             --- CROSS-LOOP API ---
+	==================================
+*/
+
+/*
+
+         commc_reactor_post()
+	       ---
+	       posts an allocated task to loop index.
+
+*/
+
+commc_error_t commc_reactor_post(commc_reactor_t* reactor,
+                                 size_t index,
+                                 commc_async_task_fn fn,
+                                 void* arg) {
+
+  if (!reactor || index >= reactor->loop_count || !fn) {
+
+    return COMMC_ARGUMENT_ERROR;
+
+  }
+
+  if (commc_async_post(reactor->loops[index].ctx, fn, arg) != 0) {
+
+    return COMMC_MEMORY_ERROR;
+
+  }
+
+  return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_reactor_post_task()
+	       ---
+	       posts an embedded task to loop index.
+
+*/
+
+commc_error_t commc_reactor_post_task(commc_reactor_t* reactor,
+                                      size_t index,
+                                      commc_async_task_t* task) {
+
+  if (!reactor || index >= reactor->loop_count || !task) {
+
+    return COMMC_ARGUMENT_ERROR;
+
+  }
+
+  if (commc_async_post_task(reactor->loops[index].ctx, task) != 0) {
+
+    return COMMC_ARGUMENT_ERROR;
+
+  }
+
+  return COMMC_SUCCESS;
+
+}
+
+/*
+	==================================
+             --- LISTENER API ---
+	==================================
+*/
+
+/*
+
+         commc_reactor_listen()
+	       ---
+	       opens the per-loop sockets and posts each loop
+	       the task that starts accepting on it.
+
+*/
+
+commc_error_t commc_reactor_listen(commc_reactor_t* reactor,
+                                   const void* address,
+                                   size_t address_size,
+                                   int backlog,
+                                   commc_reactor_accept_fn on_accept,
+                                   void* user_data,
+                                   int* handle) {
+
+  reactor_listener_t*      listener;
+  reactor_acceptor_t*      acceptor;
+  struct sockaddr_storage  bound;
+  socklen_t                bound_size;
+  int                      reuse_port = 0;
+  size_t                   i;
+
+  if (!reactor || !address || !on_accept ||
+      address_size < sizeof(struct sockaddr) || address_size > sizeof(bound)) {
+
+    return COMMC_ARGUMENT_ERROR;
+
+  }
+
+  if (backlog <= 0) {
+
+    backlog = COMMC_REACTOR_DEFAULT_BACKLOG;
+
+  }
+
+#ifdef REACTOR_REUSEPORT
+  reuse_port = reactor->loop_count > 1;
+#endif
+
+  listener = (reactor_listener_t*)malloc(sizeof(reactor_listener_t));
+
+  if (!listener) {
+
+    return COMMC_MEMORY_ERROR;
+
+  }
+
+  memset(listener, 0, sizeof(reactor_listener_t));
+  listener->reactor   = reactor;
+  listener->on_accept = on_accept;
+  listener->user_data = user_data;
+  listener->acceptors = (reactor_acceptor_t*)malloc(reactor->loop_count * sizeof(reactor_acceptor_t));
+
+  if (!listener->acceptors) {
+
+    free(listener);
+    return COMMC_MEMORY_ERROR;
+
+  }
+
+  memset(listener->acceptors, 0, reactor->loop_count * sizeof(reactor_acceptor_t));
+
+  memcpy(&bound, address, address_size);
+  bound_size = (socklen_t)address_size;
+
+  for (i = 0; i < reactor->loop_count; i++) {
+
+    acceptor           = &listener->acceptors[i];
+    acceptor->listener = listener;
+    acceptor->index    = i;
+    acceptor->ctx      = reactor->loops[i].ctx;
+
+    commc_async_task_init(&acceptor->start, start_accepting, acceptor);
+    commc_async_timer_init(&acceptor->backoff, backoff_done, acceptor);
+
+    if (i > 0 && !reuse_port) {
+
+      /* no balancing port sharing: every loop accepts from the first socket */
+
+      acceptor->handle = listener->acceptors[0].handle;
+      continue;
+
+    }
+
+    acceptor->handle = open_listener((const struct sockaddr*)&bound, bound_size,
+                                     backlog, reuse_port);
+
+    if (acceptor->handle < 0) {
+
+      free_listener(listener, i);
+      return COMMC_IO_ERROR;
+
+    }
+
+    acceptor->owns_handle = 1;
+
+    /* the remaining sockets must share an ephemeral port picked here */
+
+    if (i == 0 && reuse_port &&
+        getsockname(acceptor->handle, (struct sockaddr*)&bound, &bound_size) != 0) {
+
+      free_listener(listener, 1);
+      return COMMC_IO_ERROR;
+
+    }
+
+  }
+
+  for (i = 0; i < reactor->loop_count; i++) {
+
+    commc_async_post_task(listener->acceptors[i].ctx, &listener->acceptors[i].start);
+
+  }
+
+  listener->next     = reactor->listeners;
+  reactor->listeners = listener;
+
+  if (handle) {
+
+    *handle = listener->acceptors[0].handle;
+
+  }
+
+  return COMMC_SUCCESS;
+
+}
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
@@ -27,6 +27,10 @@
 	==================================
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE    /* for sendmmsg, recvmmsg, splice */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,6 +39,7 @@
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#include <io.h>
 #if defined(_MSC_VER)
 #pragma comment(lib, "ws2_32.lib")
 #endif
@@ -55,8 +60,32 @@
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#define COMMC_SOCKET_HAVE_SENDFILE    /* sendfile for files, splice for the rest */
+#endif
+
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+#define COMMC_SOCKET_HAVE_MMSG    /* one syscall per datagram batch */
+#endif
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define COMMC_SOCKET_HAVE_ZEROCOPY    /* MSG_ZEROCOPY with error-queue completions */
+#endif
+
+#ifdef _WIN32
+#define SOCKET_OPTION_UNSUPPORTED(error_code) ((error_code) == WSAENOPROTOOPT || \
+                                               (error_code) == WSAEINVAL)
+#else
+#define SOCKET_OPTION_UNSUPPORTED(error_code) ((error_code) == ENOPROTOOPT || \
+                                               (error_code) == EOPNOTSUPP)
 #endif
 
 #include "commc/socket.h"
@@ -68,8 +97,18 @@
 	==================================
 */
 
+#define SOCKET_BATCH_IOVECS 256    /* PIECES SHARED BY ONE BATCH */
+#define SOCKET_FILE_CHUNK   65536  /* SPLICE PIPE CAPACITY AND COPY BUFFER */
+#define SOCKET_MAX_IO_SIZE  0x7ffff000UL /* LINUX PER-CALL I/O LIMIT */
+
 static int socket_initialized = 0;
 
+#ifdef _WIN32
+typedef WSABUF       socket_sys_iovec_t;
+#else
+typedef struct iovec socket_sys_iovec_t;
+#endif
+
 /* 
 	==================================
              --- HELPERS ---
@@ -179,6 +218,26 @@ static int family_to_int(commc_socket_family_t family) {
     
 }
 
+/*
+
+         open_socket_handle()
+	       ---
+	       creates the system socket. lives outside
+	       commc_socket_create(), whose parameter named
+	       'socket' hides the system call.
+
+*/
+
+static int open_socket_handle(int sock_family, int sock_type) {
+
+#ifdef _WIN32
+    return (int)WSASocket(sock_family, sock_type, 0, NULL, 0, 0);
+#else
+    return socket(sock_family, sock_type, 0);
+#endif
+
+}
+
 /*
 
          wait_for_socket()
@@ -373,19 +432,15 @@ commc_error_t commc_socket_create(commc_socket_t**        socket,
     new_socket->options.broadcast          = 0;
     new_socket->options.receive_timeout    = COMMC_SOCKET_DEFAULT_TIMEOUT;
     new_socket->options.send_timeout       = COMMC_SOCKET_DEFAULT_TIMEOUT;
-    new_socket->options.receive_buffer_size = COMMC_SOCKET_BUFFER_SIZE;
-    new_socket->options.send_buffer_size    = COMMC_SOCKET_BUFFER_SIZE;
+    new_socket->options.receive_buffer_size = 0;    /* system default */
+    new_socket->options.send_buffer_size    = 0;
     
     /* Create system socket */
     
     sock_type   = socket_type_to_int(type);
     sock_family = family_to_int(family);
     
-#ifdef _WIN32
-    sock_fd = WSASocket(sock_family, sock_type, 0, NULL, 0, 0);
-#else
-    sock_fd = socket(sock_family, sock_type, 0);
-#endif
+    sock_fd = open_socket_handle(sock_family, sock_type);
     
     if (sock_fd == COMMC_INVALID_SOCKET) {
     
@@ -430,6 +485,95 @@ void commc_socket_destroy(commc_socket_t* socket) {
     
 }
 
+/*
+
+         apply_option()
+	       ---
+	       sets one integer socket option, recording the
+	       error on failure.
+
+*/
+
+static commc_error_t apply_option(commc_socket_t* socket,
+                                  int             level,
+                                  int             name,
+                                  int             value) {
+
+    if (setsockopt(socket->handle, level, name,
+                   (const char*)&value, sizeof(value)) == COMMC_SOCKET_ERROR) {
+        
+        set_socket_error(socket, get_socket_error());
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         apply_optional()
+	       ---
+	       apply_option() for options a kernel may not
+	       know: those become a no-op and *stored is reset
+	       so the socket does not claim them.
+
+*/
+
+static commc_error_t apply_optional(commc_socket_t* socket,
+                                    int             level,
+                                    int             name,
+                                    int             value,
+                                    int*            stored) {
+
+    int error_code;
+    
+    if (setsockopt(socket->handle, level, name,
+                   (const char*)&value, sizeof(value)) != COMMC_SOCKET_ERROR) {
+        
+        return COMMC_SUCCESS;
+        
+    }
+    
+    error_code = get_socket_error();
+    
+    if (SOCKET_OPTION_UNSUPPORTED(error_code)) {
+    
+        *stored = 0;
+        return COMMC_SUCCESS;
+        
+    }
+    
+    set_socket_error(socket, error_code);
+    return COMMC_SYSTEM_ERROR;
+    
+}
+
+/*
+
+         query_option()
+	       ---
+	       reads one integer socket option, or returns
+	       fallback if the kernel will not say.
+
+*/
+
+static int query_option(int handle, int level, int name, int fallback) {
+
+    int       value = 0;
+    socklen_t length = sizeof(value);
+    
+    if (getsockopt(handle, level, name, (char*)&value, &length) == COMMC_SOCKET_ERROR) {
+    
+        return fallback;
+        
+    }
+    
+    return value;
+    
+}
+
 /*
 
          commc_socket_set_options()
@@ -441,8 +585,8 @@ void commc_socket_destroy(commc_socket_t* socket) {
 commc_error_t commc_socket_set_options(commc_socket_t*              socket,
                                        const commc_socket_options_t* options) {
 
-    int result;
-    int option_value;
+    commc_socket_options_t previous;
+    int                    is_tcp;
     
     if (!socket || !options || socket->handle == COMMC_INVALID_SOCKET) {
     
@@ -452,110 +596,161 @@ commc_error_t commc_socket_set_options(commc_socket_t*              socket,
     
     /* Copy options to socket */
     
+    previous        = socket->options;
     socket->options = *options;
+    is_tcp          = socket->type == COMMC_SOCKET_TYPE_TCP;
     
-    /* Set SO_REUSEADDR */
+    /* Socket level */
     
-    if (options->reuse_address) {
-    
-        option_value = 1;
-        result = setsockopt(socket->handle, SOL_SOCKET, SO_REUSEADDR,
-                           (const char*)&option_value, sizeof(option_value));
-                           
-        if (result == COMMC_SOCKET_ERROR) {
+    if ((options->reuse_address || previous.reuse_address) &&
+        apply_option(socket, SOL_SOCKET, SO_REUSEADDR, options->reuse_address != 0) != COMMC_SUCCESS) {
         
-            set_socket_error(socket, get_socket_error());
-            return COMMC_SYSTEM_ERROR;
-            
-        }
+        return COMMC_SYSTEM_ERROR;
         
     }
     
-    /* Set SO_KEEPALIVE */
-    
-    if (options->keep_alive && socket->type == COMMC_SOCKET_TYPE_TCP) {
-    
-        option_value = 1;
-        result = setsockopt(socket->handle, SOL_SOCKET, SO_KEEPALIVE,
-                           (const char*)&option_value, sizeof(option_value));
-                           
-        if (result == COMMC_SOCKET_ERROR) {
+    if (is_tcp && (options->keep_alive || previous.keep_alive) &&
+        apply_option(socket, SOL_SOCKET, SO_KEEPALIVE, options->keep_alive != 0) != COMMC_SUCCESS) {
         
-            set_socket_error(socket, get_socket_error());
-            return COMMC_SYSTEM_ERROR;
-            
-        }
+        return COMMC_SYSTEM_ERROR;
         
     }
     
-    /* Set TCP_NODELAY */
-    
-    if (options->no_delay && socket->type == COMMC_SOCKET_TYPE_TCP) {
-    
-        option_value = 1;
-        result = setsockopt(socket->handle, IPPROTO_TCP, TCP_NODELAY,
-                           (const char*)&option_value, sizeof(option_value));
-                           
-        if (result == COMMC_SOCKET_ERROR) {
+    if (!is_tcp && (options->broadcast || previous.broadcast) &&
+        apply_option(socket, SOL_SOCKET, SO_BROADCAST, options->broadcast != 0) != COMMC_SUCCESS) {
         
-            set_socket_error(socket, get_socket_error());
-            return COMMC_SYSTEM_ERROR;
-            
-        }
+        return COMMC_SYSTEM_ERROR;
         
     }
     
-    /* Set SO_BROADCAST */
-    
-    if (options->broadcast && socket->type == COMMC_SOCKET_TYPE_UDP) {
-    
-        option_value = 1;
-        result = setsockopt(socket->handle, SOL_SOCKET, SO_BROADCAST,
-                           (const char*)&option_value, sizeof(option_value));
-                           
-        if (result == COMMC_SOCKET_ERROR) {
+    if (options->receive_buffer_size > 0 &&
+        options->receive_buffer_size != previous.receive_buffer_size &&
+        apply_option(socket, SOL_SOCKET, SO_RCVBUF, options->receive_buffer_size) != COMMC_SUCCESS) {
         
-            set_socket_error(socket, get_socket_error());
-            return COMMC_SYSTEM_ERROR;
-            
-        }
+        return COMMC_SYSTEM_ERROR;
         
     }
     
-    /* Set receive buffer size */
-    
-    if (options->receive_buffer_size > 0) {
+    if (options->send_buffer_size > 0 &&
+        options->send_buffer_size != previous.send_buffer_size &&
+        apply_option(socket, SOL_SOCKET, SO_SNDBUF, options->send_buffer_size) != COMMC_SUCCESS) {
+        
+        return COMMC_SYSTEM_ERROR;
+        
+    }
     
-        option_value = options->receive_buffer_size;
-        result = setsockopt(socket->handle, SOL_SOCKET, SO_RCVBUF,
-                           (const char*)&option_value, sizeof(option_value));
-                           
-        if (result == COMMC_SOCKET_ERROR) {
+#ifdef SO_REUSEPORT
+    if ((options->reuse_port || previous.reuse_port) &&
+        apply_optional(socket, SOL_SOCKET, SO_REUSEPORT, options->reuse_port != 0,
+                       &socket->options.reuse_port) != COMMC_SUCCESS) {
         
-            set_socket_error(socket, get_socket_error());
-            return COMMC_SYSTEM_ERROR;
-            
-        }
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+#else
+    socket->options.reuse_port = 0;
+#endif
+
+#ifdef SO_BUSY_POLL
+    if (options->busy_poll != previous.busy_poll &&
+        apply_optional(socket, SOL_SOCKET, SO_BUSY_POLL, options->busy_poll,
+                       &socket->options.busy_poll) != COMMC_SUCCESS) {
+        
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+#else
+    socket->options.busy_poll = 0;
+#endif
+
+#ifdef COMMC_SOCKET_HAVE_ZEROCOPY
+    if ((options->zero_copy || previous.zero_copy) &&
+        apply_optional(socket, SOL_SOCKET, SO_ZEROCOPY, options->zero_copy != 0,
+                       &socket->options.zero_copy) != COMMC_SUCCESS) {
+        
+        return COMMC_SYSTEM_ERROR;
         
     }
+#else
+    socket->options.zero_copy = 0;
+#endif
+
+    /* TCP level */
     
-    /* Set send buffer size */
+    if (!is_tcp) {
     
-    if (options->send_buffer_size > 0) {
+        socket->options.cork              = 0;
+        socket->options.quick_ack         = 0;
+        socket->options.fast_open         = 0;
+        socket->options.fast_open_connect = 0;
+        
+        return COMMC_SUCCESS;
+        
+    }
     
-        option_value = options->send_buffer_size;
-        result = setsockopt(socket->handle, SOL_SOCKET, SO_SNDBUF,
-                           (const char*)&option_value, sizeof(option_value));
-                           
-        if (result == COMMC_SOCKET_ERROR) {
+    if ((options->no_delay || previous.no_delay) &&
+        apply_option(socket, IPPROTO_TCP, TCP_NODELAY, options->no_delay != 0) != COMMC_SUCCESS) {
         
-            set_socket_error(socket, get_socket_error());
-            return COMMC_SYSTEM_ERROR;
-            
-        }
+        return COMMC_SYSTEM_ERROR;
         
     }
     
+#if defined(TCP_CORK)
+    if ((options->cork || previous.cork) &&
+        apply_optional(socket, IPPROTO_TCP, TCP_CORK, options->cork != 0,
+                       &socket->options.cork) != COMMC_SUCCESS) {
+        
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+#elif defined(TCP_NOPUSH)
+    if ((options->cork || previous.cork) &&
+        apply_optional(socket, IPPROTO_TCP, TCP_NOPUSH, options->cork != 0,
+                       &socket->options.cork) != COMMC_SUCCESS) {
+        
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+#else
+    socket->options.cork = 0;
+#endif
+
+#ifdef TCP_QUICKACK
+    if (options->quick_ack &&
+        apply_optional(socket, IPPROTO_TCP, TCP_QUICKACK, 1,
+                       &socket->options.quick_ack) != COMMC_SUCCESS) {
+        
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+#else
+    socket->options.quick_ack = 0;
+#endif
+
+#ifdef TCP_FASTOPEN
+    if (options->fast_open != previous.fast_open &&
+        apply_optional(socket, IPPROTO_TCP, TCP_FASTOPEN, options->fast_open,
+                       &socket->options.fast_open) != COMMC_SUCCESS) {
+        
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+#else
+    socket->options.fast_open = 0;
+#endif
+
+#ifdef TCP_FASTOPEN_CONNECT
+    if ((options->fast_open_connect || previous.fast_open_connect) &&
+        apply_optional(socket, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, options->fast_open_connect != 0,
+                       &socket->options.fast_open_connect) != COMMC_SUCCESS) {
+        
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+#else
+    socket->options.fast_open_connect = 0;
+#endif
+
     return COMMC_SUCCESS;
     
 }
@@ -571,6 +766,8 @@ commc_error_t commc_socket_set_options(commc_socket_t*              socket,
 commc_error_t commc_socket_get_options(const commc_socket_t*    socket,
                                        commc_socket_options_t*  options) {
 
+    int handle;
+    
     if (!socket || !options) {
     
         return COMMC_ERROR_INVALID_ARGUMENT;
@@ -578,7 +775,51 @@ commc_error_t commc_socket_get_options(const commc_socket_t*    socket,
     }
     
     *options = socket->options;
+    handle   = socket->handle;
+    
+    if (handle == COMMC_INVALID_SOCKET) {
+    
+        return COMMC_SUCCESS;
+        
+    }
+    
+    options->reuse_address       = query_option(handle, SOL_SOCKET, SO_REUSEADDR, options->reuse_address) != 0;
+    options->keep_alive          = query_option(handle, SOL_SOCKET, SO_KEEPALIVE, options->keep_alive) != 0;
+    options->broadcast           = query_option(handle, SOL_SOCKET, SO_BROADCAST, options->broadcast) != 0;
+    options->receive_buffer_size = query_option(handle, SOL_SOCKET, SO_RCVBUF, options->receive_buffer_size);
+    options->send_buffer_size    = query_option(handle, SOL_SOCKET, SO_SNDBUF, options->send_buffer_size);
+    
+#ifdef SO_REUSEPORT
+    options->reuse_port = query_option(handle, SOL_SOCKET, SO_REUSEPORT, options->reuse_port) != 0;
+#endif
+#ifdef SO_BUSY_POLL
+    options->busy_poll = query_option(handle, SOL_SOCKET, SO_BUSY_POLL, options->busy_poll);
+#endif
+#ifdef COMMC_SOCKET_HAVE_ZEROCOPY
+    options->zero_copy = query_option(handle, SOL_SOCKET, SO_ZEROCOPY, options->zero_copy) != 0;
+#endif
+
+    if (socket->type != COMMC_SOCKET_TYPE_TCP) {
+    
+        return COMMC_SUCCESS;
+        
+    }
     
+    options->no_delay = query_option(handle, IPPROTO_TCP, TCP_NODELAY, options->no_delay) != 0;
+    
+#if defined(TCP_CORK)
+    options->cork = query_option(handle, IPPROTO_TCP, TCP_CORK, options->cork) != 0;
+#elif defined(TCP_NOPUSH)
+    options->cork = query_option(handle, IPPROTO_TCP, TCP_NOPUSH, options->cork) != 0;
+#endif
+#ifdef TCP_QUICKACK
+    options->quick_ack = query_option(handle, IPPROTO_TCP, TCP_QUICKACK, options->quick_ack) != 0;
+#endif
+#ifdef TCP_FASTOPEN_CONNECT
+    options->fast_open_connect = query_option(handle, IPPROTO_TCP, TCP_FASTOPEN_CONNECT,
+                                              options->fast_open_connect) != 0;
+#endif
+
     return COMMC_SUCCESS;
     
 }
@@ -639,28 +880,24 @@ commc_error_t commc_socket_address_create(commc_socket_address_t*   address,
 
 /*
 
-         commc_socket_address_resolve()
+         resolve_first()
 	       ---
-	       resolves hostname to IP address using
-	       system DNS resolution.
+	       looks up address and formats the first IPv4 or
+	       IPv6 result into resolved_ip. returns 0, the
+	       getaddrinfo() error, or EAI_FAIL when no result
+	       could be formatted.
 
 */
 
-commc_error_t commc_socket_address_resolve(const commc_socket_address_t* address,
-                                           char*                         resolved_ip,
-                                           size_t                        ip_buffer_size) {
+static int resolve_first(const commc_socket_address_t* address,
+                         char*                         resolved_ip,
+                         size_t                        ip_buffer_size) {
 
     struct addrinfo  hints;
     struct addrinfo* result;
     struct addrinfo* addr_ptr;
     int              getaddr_result;
     
-    if (!address || !resolved_ip || ip_buffer_size == 0) {
-    
-        return COMMC_ERROR_INVALID_ARGUMENT;
-        
-    }
-    
     memset(&hints, 0, sizeof(hints));
     hints.ai_family   = family_to_int(address->family);
     hints.ai_socktype = SOCK_STREAM;
@@ -669,7 +906,7 @@ commc_error_t commc_socket_address_resolve(const commc_socket_address_t* address
     
     if (getaddr_result != 0) {
     
-        return COMMC_SYSTEM_ERROR;
+        return getaddr_result;
         
     }
     
@@ -682,7 +919,7 @@ commc_error_t commc_socket_address_resolve(const commc_socket_address_t* address
             if (inet_ntop(AF_INET, &ipv4->sin_addr, resolved_ip, (socklen_t)ip_buffer_size)) {
             
                 freeaddrinfo(result);
-                return COMMC_SUCCESS;
+                return 0;
                 
             }
             
@@ -693,7 +930,7 @@ commc_error_t commc_socket_address_resolve(const commc_socket_address_t* address
             if (inet_ntop(AF_INET6, &ipv6->sin6_addr, resolved_ip, (socklen_t)ip_buffer_size)) {
             
                 freeaddrinfo(result);
-                return COMMC_SUCCESS;
+                return 0;
                 
             }
             
@@ -702,51 +939,192 @@ commc_error_t commc_socket_address_resolve(const commc_socket_address_t* address
     }
     
     freeaddrinfo(result);
-    return COMMC_SYSTEM_ERROR;
+    return EAI_FAIL;
     
 }
 
-/* 
-	==================================
-        --- CLIENT OPERATIONS ---
-	==================================
-*/
-
 /*
 
-         commc_socket_connect()
+         commc_socket_address_resolve()
 	       ---
-	       establishes connection to remote host
-	       with specified timeout.
+	       resolves hostname to IP address using
+	       system DNS resolution.
 
 */
 
-commc_error_t commc_socket_connect(commc_socket_t*                socket,
-                                   const commc_socket_address_t*  address,
-                                   int                            timeout_seconds) {
+commc_error_t commc_socket_address_resolve(const commc_socket_address_t* address,
+                                           char*                         resolved_ip,
+                                           size_t                        ip_buffer_size) {
 
-    struct addrinfo  hints;
-    struct addrinfo* result;
-    struct addrinfo* addr_ptr;
-    int              connect_result;
-    int              getaddr_result;
-    commc_error_t    wait_result;
-    
-    if (!socket || !address || socket->handle == COMMC_INVALID_SOCKET) {
+    if (!address || !resolved_ip || ip_buffer_size == 0) {
     
         return COMMC_ERROR_INVALID_ARGUMENT;
         
     }
     
-    socket->state = COMMC_SOCKET_STATE_CONNECTING;
-    
-    /* Resolve address */
-    
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family   = family_to_int(address->family);
-    hints.ai_socktype = socket_type_to_int(socket->type);
+    return (resolve_first(address, resolved_ip, ip_buffer_size) == 0) ? COMMC_SUCCESS
+                                                                       : COMMC_SYSTEM_ERROR;
     
-    getaddr_result = getaddrinfo(address->hostname, address->service, &hints, &result);
+}
+
+/*
+
+         socket_resolve_job_t
+	       ---
+	       state of one commc_socket_address_resolve_async()
+	       call, owned by the helper thread and then by the
+	       loop until the callback has run.
+
+*/
+
+typedef struct {
+
+    commc_socket_address_t  address;
+    char*                   resolved_ip;
+    size_t                  ip_buffer_size;
+    commc_async_callback_t  callback;
+    void*                   user_data;
+
+} socket_resolve_job_t;
+
+/*
+
+         resolve_work()
+	       ---
+	       helper-thread half of the async resolve.
+
+*/
+
+static int resolve_work(void* arg, size_t* bytes_transferred) {
+
+    socket_resolve_job_t* job = (socket_resolve_job_t*)arg;
+    int                   rc;
+    
+    rc = resolve_first(&job->address, job->resolved_ip, job->ip_buffer_size);
+    
+    if (rc == 0) {
+    
+        *bytes_transferred = strlen(job->resolved_ip);
+        return 0;
+        
+    }
+    
+    return (rc == EAI_AGAIN) ? EAGAIN : ENOENT;
+    
+}
+
+/*
+
+         resolve_done()
+	       ---
+	       loop-thread half: hands the result to the caller
+	       with its own buffer and user data.
+
+*/
+
+static void resolve_done(const commc_async_result_t* result) {
+
+    socket_resolve_job_t*  job = (socket_resolve_job_t*)result->user_data;
+    commc_async_result_t   copy = *result;
+    commc_async_callback_t callback = job->callback;
+    
+    copy.buffer    = job->resolved_ip;
+    copy.user_data = job->user_data;
+    
+    free(job);
+    callback(&copy);
+    
+}
+
+/*
+
+         commc_socket_address_resolve_async()
+	       ---
+	       resolves hostname on a helper thread of ctx.
+
+*/
+
+commc_error_t commc_socket_address_resolve_async(commc_async_context_t*        ctx,
+                                                 const commc_socket_address_t* address,
+                                                 char*                         resolved_ip,
+                                                 size_t                        ip_buffer_size,
+                                                 commc_async_callback_t        callback,
+                                                 void*                         user_data) {
+
+    socket_resolve_job_t* job;
+    
+    if (!ctx || !address || !resolved_ip || ip_buffer_size == 0 || !callback) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    job = (socket_resolve_job_t*)malloc(sizeof(socket_resolve_job_t));
+    
+    if (!job) {
+    
+        return COMMC_MEMORY_ERROR;
+        
+    }
+    
+    job->address        = *address;
+    job->resolved_ip    = resolved_ip;
+    job->ip_buffer_size = ip_buffer_size;
+    job->callback       = callback;
+    job->user_data      = user_data;
+    
+    if (commc_async_offload(ctx, resolve_work, job, resolve_done, job) != 0) {
+    
+        free(job);
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/* 
+	==================================
+        --- CLIENT OPERATIONS ---
+	==================================
+*/
+
+/*
+
+         commc_socket_connect()
+	       ---
+	       establishes connection to remote host
+	       with specified timeout.
+
+*/
+
+commc_error_t commc_socket_connect(commc_socket_t*                socket,
+                                   const commc_socket_address_t*  address,
+                                   int                            timeout_seconds) {
+
+    struct addrinfo  hints;
+    struct addrinfo* result;
+    struct addrinfo* addr_ptr;
+    int              connect_result;
+    int              getaddr_result;
+    commc_error_t    wait_result;
+    
+    if (!socket || !address || socket->handle == COMMC_INVALID_SOCKET) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    socket->state = COMMC_SOCKET_STATE_CONNECTING;
+    
+    /* Resolve address */
+    
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = family_to_int(address->family);
+    hints.ai_socktype = socket_type_to_int(socket->type);
+    
+    getaddr_result = getaddrinfo(address->hostname, address->service, &hints, &result);
     
     if (getaddr_result != 0) {
     
@@ -1282,6 +1660,1147 @@ commc_error_t commc_socket_receive_all(commc_socket_t* socket,
     
 }
 
+/*
+
+         commc_socket_send_zerocopy()
+	       ---
+	       sends with MSG_ZEROCOPY when the zero_copy option
+	       is on, numbering each send the way the kernel
+	       numbers its completions. otherwise a plain send
+	       that is complete as soon as it returns.
+
+*/
+
+commc_error_t commc_socket_send_zerocopy(commc_socket_t* socket,
+                                         const void*     data,
+                                         size_t          data_length,
+                                         size_t*         bytes_sent,
+                                         unsigned long*  send_id) {
+
+    commc_error_t result;
+    
+    if (!socket || !send_id) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+#ifdef COMMC_SOCKET_HAVE_ZEROCOPY
+    if (socket->options.zero_copy) {
+    
+        ssize_t send_result;
+        
+        if (!data || !bytes_sent ||
+            socket->handle == COMMC_INVALID_SOCKET ||
+            socket->state != COMMC_SOCKET_STATE_CONNECTED) {
+            
+            return COMMC_ERROR_INVALID_ARGUMENT;
+            
+        }
+        
+        send_result = send(socket->handle, data, data_length, MSG_ZEROCOPY);
+        
+        if (send_result < 0) {
+        
+            int error_code = get_socket_error();
+            
+            *bytes_sent = 0;
+            
+            if (error_code == EWOULDBLOCK || error_code == EAGAIN) {
+            
+                return COMMC_ERROR_WOULD_BLOCK;
+                
+            }
+            
+            /* ENOBUFS: out of pinnable memory (optmem_max) */
+            
+            set_socket_error(socket, error_code);
+            return COMMC_SYSTEM_ERROR;
+            
+        }
+        
+        *bytes_sent = (size_t)send_result;
+        *send_id    = socket->zerocopy_sent++;
+        
+        return COMMC_SUCCESS;
+        
+    }
+#endif
+
+    result = commc_socket_send(socket, data, data_length, bytes_sent);
+    
+    if (result == COMMC_SUCCESS) {
+    
+        *send_id                   = socket->zerocopy_sent++;
+        socket->zerocopy_completed = socket->zerocopy_sent;
+        
+    }
+    
+    return result;
+    
+}
+
+/*
+
+         commc_socket_reap_zerocopy()
+	       ---
+	       drains the error queue. each notification names
+	       an inclusive range of 32-bit send numbers; ranges
+	       arrive in order, so only the upper end matters.
+
+*/
+
+commc_error_t commc_socket_reap_zerocopy(commc_socket_t* socket,
+                                         unsigned long*  completed,
+                                         int*            copied) {
+
+    if (!socket || !completed) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    if (copied) {
+    
+        *copied = 0;
+        
+    }
+    
+#ifdef COMMC_SOCKET_HAVE_ZEROCOPY
+    while (socket->zerocopy_completed != socket->zerocopy_sent &&
+           socket->handle != COMMC_INVALID_SOCKET) {
+    
+        struct msghdr             message;
+        struct cmsghdr*           control;
+        struct sock_extended_err* extended;
+        unsigned long             control_buffer[16];
+        unsigned long             delta;
+        
+        memset(&message, 0, sizeof(message));
+        message.msg_control    = control_buffer;
+        message.msg_controllen = sizeof(control_buffer);
+        
+        if (recvmsg(socket->handle, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+        
+            int error_code = get_socket_error();
+            
+            if (error_code == EWOULDBLOCK || error_code == EAGAIN || error_code == EINTR) {
+            
+                break;
+                
+            }
+            
+            set_socket_error(socket, error_code);
+            return COMMC_SYSTEM_ERROR;
+            
+        }
+        
+        for (control = CMSG_FIRSTHDR(&message); control; control = CMSG_NXTHDR(&message, control)) {
+        
+            if (!((control->cmsg_level == SOL_IP   && control->cmsg_type == IP_RECVERR) ||
+                  (control->cmsg_level == SOL_IPV6 && control->cmsg_type == IPV6_RECVERR))) {
+                
+                continue;
+                
+            }
+            
+            extended = (struct sock_extended_err*)CMSG_DATA(control);
+            
+            if (extended->ee_errno != 0 || extended->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+            
+                continue;
+                
+            }
+            
+            /* extend the 32-bit upper end to the full counter */
+            
+            delta = ((unsigned long)extended->ee_data + 1UL -
+                     socket->zerocopy_completed) & 0xFFFFFFFFUL;
+                     
+            if (delta <= socket->zerocopy_sent - socket->zerocopy_completed) {
+            
+                socket->zerocopy_completed += delta;
+                
+            }
+            
+            if (copied && (extended->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)) {
+            
+                *copied = 1;
+                
+            }
+            
+        }
+        
+    }
+#endif
+
+    *completed = socket->zerocopy_completed;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/* 
+	==================================
+     --- VECTORED AND BATCHED I/O ---
+	==================================
+*/
+
+/*
+
+         fill_iovecs()
+	       ---
+	       copies pieces into the system's vector type.
+
+*/
+
+static int fill_iovecs(socket_sys_iovec_t*         out,
+                       const commc_socket_iovec_t* iov,
+                       int                         iov_count) {
+
+    int i;
+    
+    for (i = 0; i < iov_count; i++) {
+    
+#ifdef _WIN32
+        out[i].buf = (CHAR*)iov[i].base;
+        out[i].len = (ULONG)iov[i].length;
+#else
+        out[i].iov_base = iov[i].base;
+        out[i].iov_len  = iov[i].length;
+#endif
+
+    }
+    
+    return iov_count;
+    
+}
+
+/*
+
+         transfer_error()
+	       ---
+	       maps the error of a failed transfer like
+	       commc_socket_send() does.
+
+*/
+
+static commc_error_t transfer_error(commc_socket_t* socket) {
+
+    int error_code = get_socket_error();
+    
+    if (error_code == EWOULDBLOCK || error_code == EAGAIN) {
+    
+        return COMMC_ERROR_WOULD_BLOCK;
+        
+    }
+    
+    set_socket_error(socket, error_code);
+    return COMMC_SYSTEM_ERROR;
+    
+}
+
+/*
+
+         transfer_message()
+	       ---
+	       one sendmsg()/recvmsg() (WSASendTo()/WSARecvFrom()
+	       on Windows) for a message, recording its outcome.
+
+*/
+
+static commc_error_t transfer_message(commc_socket_t*         socket,
+                                      commc_socket_message_t* message,
+                                      int                     receiving,
+                                      int                     flags) {
+
+    socket_sys_iovec_t vecs[COMMC_SOCKET_MAX_IOVEC];
+    int                count;
+    
+#ifdef _WIN32
+
+    DWORD done = 0;
+    DWORD recv_flags = (DWORD)flags;
+    int   address_length = (int)message->address_length;
+    int   result;
+    
+    count = fill_iovecs(vecs, message->iov, message->iov_count);
+    
+    if (receiving) {
+    
+        result = WSARecvFrom((SOCKET)socket->handle, vecs, (DWORD)count, &done, &recv_flags,
+                             (struct sockaddr*)message->address,
+                             message->address ? &address_length : NULL, NULL, NULL);
+                             
+    } else {
+    
+        result = WSASendTo((SOCKET)socket->handle, vecs, (DWORD)count, &done, 0,
+                           (const struct sockaddr*)message->address,
+                           message->address ? address_length : 0, NULL, NULL);
+                           
+    }
+    
+    message->truncated = 0;
+    
+    if (result == SOCKET_ERROR) {
+    
+        if (!receiving || WSAGetLastError() != WSAEMSGSIZE) {
+        
+            return transfer_error(socket);
+            
+        }
+        
+        message->truncated = 1;
+        
+    }
+    
+    message->transferred = (size_t)done;
+    
+    if (receiving && message->address) {
+    
+        message->address_length = (size_t)address_length;
+        
+    }
+    
+#else
+
+    struct msghdr header;
+    ssize_t       result;
+    
+    count = fill_iovecs(vecs, message->iov, message->iov_count);
+    
+    memset(&header, 0, sizeof(header));
+    header.msg_name    = message->address;
+    header.msg_namelen = message->address ? (socklen_t)message->address_length : 0;
+    header.msg_iov     = vecs;
+    header.msg_iovlen  = count;
+    
+    if (receiving) {
+    
+        result = recvmsg(socket->handle, &header, flags);
+        
+    } else {
+    
+        result = sendmsg(socket->handle, &header, flags);
+        
+    }
+    
+    if (result < 0) {
+    
+        return transfer_error(socket);
+        
+    }
+    
+    message->transferred = (size_t)result;
+    message->truncated   = receiving && (header.msg_flags & MSG_TRUNC) != 0;
+    
+    if (receiving && message->address) {
+    
+        message->address_length = (size_t)header.msg_namelen;
+        
+    }
+    
+#endif
+
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_socket_sendv()
+	       ---
+	       gathers the pieces into one send.
+
+*/
+
+commc_error_t commc_socket_sendv(commc_socket_t*             socket,
+                                 const commc_socket_iovec_t* iov,
+                                 int                         iov_count,
+                                 size_t*                     bytes_sent) {
+
+    commc_socket_message_t message;
+    commc_error_t          result;
+    
+    if (!socket || !iov || iov_count <= 0 || !bytes_sent ||
+        socket->handle == COMMC_INVALID_SOCKET ||
+        socket->state != COMMC_SOCKET_STATE_CONNECTED) {
+        
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    memset(&message, 0, sizeof(message));
+    message.iov       = (commc_socket_iovec_t*)iov;
+    message.iov_count = iov_count < COMMC_SOCKET_MAX_IOVEC ? iov_count : COMMC_SOCKET_MAX_IOVEC;
+    
+    *bytes_sent = 0;
+    result = transfer_message(socket, &message, 0, 0);
+    
+    if (result == COMMC_SUCCESS) {
+    
+        *bytes_sent = message.transferred;
+        
+    }
+    
+    return result;
+    
+}
+
+/*
+
+         commc_socket_receivev()
+	       ---
+	       scatters one receive across the pieces.
+
+*/
+
+commc_error_t commc_socket_receivev(commc_socket_t*             socket,
+                                    const commc_socket_iovec_t* iov,
+                                    int                         iov_count,
+                                    size_t*                     bytes_received) {
+
+    commc_socket_message_t message;
+    commc_error_t          result;
+    
+    if (!socket || !iov || iov_count <= 0 || !bytes_received ||
+        socket->handle == COMMC_INVALID_SOCKET ||
+        socket->state != COMMC_SOCKET_STATE_CONNECTED) {
+        
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    memset(&message, 0, sizeof(message));
+    message.iov       = (commc_socket_iovec_t*)iov;
+    message.iov_count = iov_count < COMMC_SOCKET_MAX_IOVEC ? iov_count : COMMC_SOCKET_MAX_IOVEC;
+    
+    *bytes_received = 0;
+    result = transfer_message(socket, &message, 1, 0);
+    
+    if (result != COMMC_SUCCESS) {
+    
+        return result;
+        
+    }
+    
+    if (message.transferred == 0 && socket->type == COMMC_SOCKET_TYPE_TCP) {
+    
+        /* Connection closed */
+        
+        socket->state = COMMC_SOCKET_STATE_CLOSED;
+        return COMMC_ERROR_CONNECTION_CLOSED;
+        
+    }
+    
+    *bytes_received = message.transferred;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+/*
+
+         commc_socket_sendv_all()
+	       ---
+	       sends every piece, resuming partial sends in
+	       the middle of a piece.
+
+*/
+
+commc_error_t commc_socket_sendv_all(commc_socket_t*             socket,
+                                     const commc_socket_iovec_t* iov,
+                                     int                         iov_count) {
+
+    commc_socket_iovec_t window[COMMC_SOCKET_MAX_IOVEC];
+    commc_error_t        result;
+    size_t               offset = 0;
+    size_t               bytes_sent;
+    int                  index = 0;
+    int                  count;
+    int                  i;
+    
+    if (!socket || !iov || iov_count < 0) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    for (;;) {
+    
+        /* Skip finished and empty pieces */
+        
+        while (index < iov_count && offset >= iov[index].length) {
+        
+            index++;
+            offset = 0;
+            
+        }
+        
+        if (index == iov_count) {
+        
+            return COMMC_SUCCESS;
+            
+        }
+        
+        count = iov_count - index;
+        
+        if (count > COMMC_SOCKET_MAX_IOVEC) {
+        
+            count = COMMC_SOCKET_MAX_IOVEC;
+            
+        }
+        
+        for (i = 0; i < count; i++) {
+        
+            window[i] = iov[index + i];
+            
+        }
+        
+        window[0].base    = (char*)window[0].base + offset;
+        window[0].length -= offset;
+        
+        result = commc_socket_sendv(socket, window, count, &bytes_sent);
+        
+        if (result == COMMC_ERROR_WOULD_BLOCK) {
+        
+            /* Wait for socket to become writable */
+            
+            result = wait_for_socket(socket->handle, 1, socket->options.send_timeout);
+            
+            if (result != COMMC_SUCCESS) {
+            
+                return result;
+                
+            }
+            
+            continue;
+            
+        }
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+        /* Advance past what was sent */
+        
+        while (bytes_sent > 0) {
+        
+            if (bytes_sent >= iov[index].length - offset) {
+            
+                bytes_sent -= iov[index].length - offset;
+                index++;
+                offset = 0;
+                
+            } else {
+            
+                offset    += bytes_sent;
+                bytes_sent = 0;
+                
+            }
+            
+        }
+        
+    }
+    
+}
+
+/*
+
+         check_batch()
+	       ---
+	       validates the arguments of a batched transfer.
+
+*/
+
+static int check_batch(const commc_socket_t*         socket,
+                       const commc_socket_message_t* messages,
+                       int                           message_count,
+                       const int*                    done) {
+
+    int i;
+    
+    if (!socket || !messages || message_count <= 0 || !done ||
+        socket->handle == COMMC_INVALID_SOCKET) {
+        
+        return 0;
+        
+    }
+    
+    for (i = 0; i < message_count && i < COMMC_SOCKET_MAX_BATCH; i++) {
+    
+        if (!messages[i].iov || messages[i].iov_count <= 0 ||
+            messages[i].iov_count > COMMC_SOCKET_MAX_IOVEC) {
+            
+            return 0;
+            
+        }
+        
+    }
+    
+    return 1;
+    
+}
+
+#ifdef COMMC_SOCKET_HAVE_MMSG
+
+/*
+
+         transfer_batch()
+	       ---
+	       one sendmmsg()/recvmmsg() over as many messages
+	       as fit the batch and the shared piece array.
+
+*/
+
+static commc_error_t transfer_batch(commc_socket_t*         socket,
+                                    commc_socket_message_t* messages,
+                                    int                     message_count,
+                                    int                     receiving,
+                                    int*                    done) {
+
+    struct mmsghdr headers[COMMC_SOCKET_MAX_BATCH];
+    struct iovec   vecs[SOCKET_BATCH_IOVECS];
+    int            used = 0;
+    int            count;
+    int            result;
+    int            i;
+    
+    for (count = 0; count < message_count && count < COMMC_SOCKET_MAX_BATCH; count++) {
+    
+        commc_socket_message_t* message = &messages[count];
+        
+        if (used + message->iov_count > SOCKET_BATCH_IOVECS) {
+        
+            break;
+            
+        }
+        
+        memset(&headers[count], 0, sizeof(headers[count]));
+        headers[count].msg_hdr.msg_name    = message->address;
+        headers[count].msg_hdr.msg_namelen = message->address ? (socklen_t)message->address_length : 0;
+        headers[count].msg_hdr.msg_iov     = &vecs[used];
+        headers[count].msg_hdr.msg_iovlen  = fill_iovecs(&vecs[used], message->iov, message->iov_count);
+        
+        used += message->iov_count;
+        
+    }
+    
+    if (receiving) {
+    
+        result = recvmmsg(socket->handle, headers, (unsigned int)count, MSG_WAITFORONE, NULL);
+        
+    } else {
+    
+        result = sendmmsg(socket->handle, headers, (unsigned int)count, 0);
+        
+    }
+    
+    if (result < 0) {
+    
+        return transfer_error(socket);
+        
+    }
+    
+    for (i = 0; i < result; i++) {
+    
+        messages[i].transferred = (size_t)headers[i].msg_len;
+        messages[i].truncated   = receiving && (headers[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+        
+        if (receiving && messages[i].address) {
+        
+            messages[i].address_length = (size_t)headers[i].msg_hdr.msg_namelen;
+            
+        }
+        
+    }
+    
+    *done = result;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+#else
+
+#if defined(_WIN32) || !defined(MSG_DONTWAIT)
+
+/*
+
+         readable_now()
+	       ---
+	       polls a socket without waiting.
+
+*/
+
+static int readable_now(int socket_fd) {
+
+    fd_set         fds;
+    struct timeval timeout;
+    
+    FD_ZERO(&fds);
+    FD_SET(socket_fd, &fds);
+    
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = 0;
+    
+    return select(socket_fd + 1, &fds, NULL, NULL, &timeout) > 0;
+    
+}
+
+#endif
+
+/*
+
+         transfer_batch()
+	       ---
+	       the portable loop: one call per message. after
+	       the first, receives only take queued datagrams.
+
+*/
+
+static commc_error_t transfer_batch(commc_socket_t*         socket,
+                                    commc_socket_message_t* messages,
+                                    int                     message_count,
+                                    int                     receiving,
+                                    int*                    done) {
+
+    commc_error_t result;
+    int           flags = 0;
+    int           count;
+    
+    for (count = 0; count < message_count && count < COMMC_SOCKET_MAX_BATCH; count++) {
+    
+        if (receiving && count > 0) {
+        
+#if defined(MSG_DONTWAIT) && !defined(_WIN32)
+            flags = MSG_DONTWAIT;
+#else
+            if (!readable_now(socket->handle)) {
+            
+                break;
+                
+            }
+#endif
+
+        }
+        
+        result = transfer_message(socket, &messages[count], receiving, flags);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            if (count == 0) {
+            
+                return result;
+                
+            }
+            
+            break;
+            
+        }
+        
+    }
+    
+    *done = count;
+    
+    return COMMC_SUCCESS;
+    
+}
+
+#endif
+
+/*
+
+         commc_socket_send_batch()
+	       ---
+	       sends a batch of datagrams.
+
+*/
+
+commc_error_t commc_socket_send_batch(commc_socket_t*         socket,
+                                      commc_socket_message_t* messages,
+                                      int                     message_count,
+                                      int*                    messages_sent) {
+
+    if (!check_batch(socket, messages, message_count, messages_sent)) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    *messages_sent = 0;
+    
+    return transfer_batch(socket, messages, message_count, 0, messages_sent);
+    
+}
+
+/*
+
+         commc_socket_receive_batch()
+	       ---
+	       receives a batch of datagrams.
+
+*/
+
+commc_error_t commc_socket_receive_batch(commc_socket_t*         socket,
+                                         commc_socket_message_t* messages,
+                                         int                     message_count,
+                                         int*                    messages_received) {
+
+    if (!check_batch(socket, messages, message_count, messages_received)) {
+    
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    *messages_received = 0;
+    
+    return transfer_batch(socket, messages, message_count, 1, messages_received);
+    
+}
+
+/* 
+	==================================
+          --- FILE TRANSFER ---
+	==================================
+*/
+
+#ifdef COMMC_SOCKET_HAVE_SENDFILE
+
+/*
+
+         splice_to_socket()
+	       ---
+	       moves a descriptor sendfile() refuses (a socket or
+	       a pipe) into the socket through a pipe, so the
+	       bytes never enter user space. *sent counts only
+	       what reached the socket.
+
+*/
+
+static commc_error_t splice_to_socket(commc_socket_t* socket,
+                                      int             source,
+                                      loff_t*         position,
+                                      size_t          length,
+                                      size_t*         sent) {
+
+    int           pipe_fds[2];
+    size_t        in_pipe = 0;
+    ssize_t       moved;
+    commc_error_t result  = COMMC_SUCCESS;
+    int           at_end  = 0;
+    
+    if (pipe(pipe_fds) != 0) {
+    
+        set_socket_error(socket, errno);
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+    
+    while (result == COMMC_SUCCESS && (in_pipe > 0 || (!at_end && *sent < length))) {
+    
+        /* refill the pipe from the source */
+        
+        if (in_pipe == 0) {
+        
+            size_t want = length - *sent;
+            
+            moved = splice(source, position, pipe_fds[1], NULL,
+                           want < SOCKET_FILE_CHUNK ? want : SOCKET_FILE_CHUNK,
+                           SPLICE_F_MOVE | SPLICE_F_MORE);
+                           
+            if (moved < 0) {
+            
+                if (errno == EINTR) {
+                
+                    continue;
+                    
+                }
+                
+                if (errno == EAGAIN) {
+                
+                    result = wait_for_socket(source, 0, socket->options.receive_timeout);
+                    continue;
+                    
+                }
+                
+                set_socket_error(socket, errno);
+                result = COMMC_SYSTEM_ERROR;
+                break;
+                
+            }
+            
+            if (moved == 0) {
+            
+                at_end = 1;
+                continue;
+                
+            }
+            
+            in_pipe = (size_t)moved;
+            
+        }
+        
+        /* drain it into the socket */
+        
+        moved = splice(pipe_fds[0], NULL, socket->handle, NULL, in_pipe,
+                       SPLICE_F_MOVE | SPLICE_F_MORE);
+                       
+        if (moved < 0) {
+        
+            if (errno == EINTR) {
+            
+                continue;
+                
+            }
+            
+            if (errno == EAGAIN) {
+            
+                result = wait_for_socket(socket->handle, 1, socket->options.send_timeout);
+                continue;
+                
+            }
+            
+            set_socket_error(socket, errno);
+            result = COMMC_SYSTEM_ERROR;
+            break;
+            
+        }
+        
+        in_pipe -= (size_t)moved;
+        *sent   += (size_t)moved;
+        
+    }
+    
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    
+    return result;
+    
+}
+
+#else
+
+/*
+
+         copy_to_socket()
+	       ---
+	       portable fallback: reads the source into a buffer
+	       and sends it. files are read at offset; sockets
+	       and pipes from where they stand.
+
+*/
+
+static commc_error_t copy_to_socket(commc_socket_t* socket,
+                                    int             source,
+                                    size_t          offset,
+                                    size_t          length,
+                                    size_t*         sent) {
+
+    char          buffer[SOCKET_FILE_CHUNK];
+    size_t        want;
+    long          got;
+    commc_error_t result;
+#ifndef _WIN32
+    int           seekable = 1;
+#endif
+    
+#ifdef _WIN32
+    if (_lseek(source, (long)offset, SEEK_SET) == -1L) {
+    
+        set_socket_error(socket, errno);
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+#endif
+
+    while (*sent < length) {
+    
+        want = length - *sent;
+        
+        if (want > sizeof(buffer)) {
+        
+            want = sizeof(buffer);
+            
+        }
+        
+#ifdef _WIN32
+        got = (long)_read(source, buffer, (unsigned int)want);
+#else
+        if (seekable) {
+        
+            got = (long)pread(source, buffer, want, (off_t)(offset + *sent));
+            
+            if (got < 0 && errno == ESPIPE) {
+            
+                seekable = 0;
+                continue;
+                
+            }
+            
+        } else {
+        
+            got = (long)read(source, buffer, want);
+            
+        }
+        
+        if (got < 0 && errno == EINTR) {
+        
+            continue;
+            
+        }
+#endif
+
+        if (got < 0) {
+        
+            set_socket_error(socket, errno);
+            return COMMC_SYSTEM_ERROR;
+            
+        }
+        
+        if (got == 0) {
+        
+            break;    /* end of file */
+            
+        }
+        
+        result = commc_socket_send_all(socket, buffer, (size_t)got);
+        
+        if (result != COMMC_SUCCESS) {
+        
+            return result;
+            
+        }
+        
+        *sent += (size_t)got;
+        
+    }
+    
+    return COMMC_SUCCESS;
+    
+}
+
+#endif
+
+/*
+
+         commc_socket_send_file()
+	       ---
+	       sendfile() where the kernel takes a regular file,
+	       splice() through a pipe where it does not, and a
+	       read/send loop on other platforms.
+
+*/
+
+commc_error_t commc_socket_send_file(commc_socket_t* socket,
+                                     int             file_handle,
+                                     size_t          offset,
+                                     size_t          length,
+                                     size_t*         bytes_sent) {
+
+#ifdef COMMC_SOCKET_HAVE_SENDFILE
+    struct stat   file_status;
+    loff_t        splice_position;
+    off_t         position;
+    ssize_t       sent;
+    size_t        want;
+    commc_error_t result;
+#endif
+
+    if (!socket || !bytes_sent || file_handle < 0 ||
+        socket->handle == COMMC_INVALID_SOCKET ||
+        socket->state != COMMC_SOCKET_STATE_CONNECTED) {
+        
+        return COMMC_ERROR_INVALID_ARGUMENT;
+        
+    }
+    
+    *bytes_sent = 0;
+    
+#ifdef COMMC_SOCKET_HAVE_SENDFILE
+    if (fstat(file_handle, &file_status) != 0) {
+    
+        set_socket_error(socket, errno);
+        return COMMC_SYSTEM_ERROR;
+        
+    }
+    
+    if (!S_ISREG(file_status.st_mode)) {
+    
+        return splice_to_socket(socket, file_handle, NULL, length, bytes_sent);
+        
+    }
+    
+    position = (off_t)offset;
+    
+    while (*bytes_sent < length) {
+    
+        want = length - *bytes_sent;
+        
+        if (want > SOCKET_MAX_IO_SIZE) {
+        
+            want = SOCKET_MAX_IO_SIZE;
+            
+        }
+        
+        sent = sendfile(socket->handle, file_handle, &position, want);
+        
+        if (sent < 0) {
+        
+            if (errno == EINTR) {
+            
+                continue;
+                
+            }
+            
+            if (errno == EAGAIN) {
+            
+                result = wait_for_socket(socket->handle, 1, socket->options.send_timeout);
+                
+                if (result != COMMC_SUCCESS) {
+                
+                    return result;
+                    
+                }
+                
+                continue;
+                
+            }
+            
+            if ((errno == EINVAL || errno == ENOSYS) && *bytes_sent == 0) {
+            
+                /* a file system without sendfile support */
+                
+                splice_position = (loff_t)offset;
+                return splice_to_socket(socket, file_handle, &splice_position,
+                                        length, bytes_sent);
+                                        
+            }
+            
+            set_socket_error(socket, errno);
+            return COMMC_SYSTEM_ERROR;
+            
+        }
+        
+        if (sent == 0) {
+        
+            break;    /* file shorter than length */
+            
+        }
+        
+        *bytes_sent += (size_t)sent;
+        
+    }
+    
+    return COMMC_SUCCESS;
+#else
+    return copy_to_socket(socket, file_handle, offset, length, bytes_sent);
+#endif
+
+}
+
 /* 
 	==================================
            --- STATUS AND UTILITIES ---
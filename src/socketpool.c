@@ -1,4 +1,4 @@
-/* 	
+/*
    ===================================
    SOCKETPOOL.C
    SOCKET CONNECTION POOLING IMPLEMENTATION
@@ -10,51 +10,731 @@
 
 	                  --- ABOUT ---
 
-	    socket connection pooling implementation for
-	    efficient reuse and management of TCP/UDP sockets.
-	    provides pool creation, acquisition, release,
-	    and cleanup. C89 compliant and cross-platform.
+	    destinations live in a small chained hash table and
+	    are never removed before the pool is destroyed, so a
+	    destination pointer stays valid without a lock once
+	    found. each keeps its idle connections in a doubly
+	    linked list, most recently released first: reuse pops
+	    the warm end, idle eviction trims the cold end.
+
+	    a pooled connection is a socketpool_entry_t whose
+	    first member is the commc_socket_t handed to callers,
+	    so release finds its bookkeeping without a search.
 
+	    a destination's 'count' covers idle, in-use and
+	    connecting sockets. a caller reserves a slot before
+	    connecting outside the lock; a slot given up while
+	    callers wait passes to the first of them instead of
+	    being returned, which keeps the queue first in,
+	    first out.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
 */
 
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+  #define _POSIX_C_SOURCE 200112L  /* PTHREADS, CLOCK_GETTIME */
+#endif
+
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "commc/socketpool.h"
 #include "commc/socket.h"
+#include "commc/async.h"
 #include "commc/error.h"
 
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <pthread.h>
+  #include <time.h>
+#endif
+
+/*
+	==================================
+             --- PLATFORM LOCKS ---
+	==================================
+*/
+
+#ifdef _WIN32
+
+  typedef CRITICAL_SECTION   pool_mutex_t;
+  typedef CONDITION_VARIABLE pool_cond_t;
+
+  #define POOL_MUTEX_INIT(m)      (InitializeCriticalSection(m), 0)
+  #define POOL_MUTEX_DESTROY(m)   DeleteCriticalSection(m)
+  #define POOL_MUTEX_LOCK(m)      EnterCriticalSection(m)
+  #define POOL_MUTEX_UNLOCK(m)    LeaveCriticalSection(m)
+  #define POOL_COND_INIT(c)       (InitializeConditionVariable(c), 0)
+  #define POOL_COND_DESTROY(c)    ((void)(c))
+  #define POOL_COND_WAIT(c, m)    SleepConditionVariableCS((c), (m), INFINITE)
+  #define POOL_COND_BROADCAST(c)  WakeAllConditionVariable(c)
+
+#else
+
+  typedef pthread_mutex_t    pool_mutex_t;
+  typedef pthread_cond_t     pool_cond_t;
+
+  #define POOL_MUTEX_INIT(m)      pthread_mutex_init((m), NULL)
+  #define POOL_MUTEX_DESTROY(m)   pthread_mutex_destroy(m)
+  #define POOL_MUTEX_LOCK(m)      pthread_mutex_lock(m)
+  #define POOL_MUTEX_UNLOCK(m)    pthread_mutex_unlock(m)
+  #define POOL_COND_INIT(c)       pthread_cond_init((c), NULL)
+  #define POOL_COND_DESTROY(c)    pthread_cond_destroy(c)
+  #define POOL_COND_WAIT(c, m)    pthread_cond_wait((c), (m))
+  #define POOL_COND_BROADCAST(c)  pthread_cond_broadcast(c)
+
+#endif
+
+/*
+	==================================
+             --- INTERNAL TYPES ---
+	==================================
+*/
+
+struct socketpool_host_t;
+
+/*
+         socketpool_entry_t
+	       ---
+	       one pooled connection.
+*/
+
+typedef struct socketpool_entry_t {
+    commc_socket_t             socket;      /* FIRST: WHAT CALLERS SEE */
+    commc_socketpool_t*        pool;        /* OWNER, CHECKED ON RELEASE */
+    struct socketpool_host_t*  host;        /* DESTINATION */
+    struct socketpool_entry_t* prev;        /* IDLE LIST LINKS */
+    struct socketpool_entry_t* next;
+    unsigned long              idle_since;  /* RELEASE TIME (MS) */
+    int                        in_use;      /* HANDED OUT */
+} socketpool_entry_t;
+
+/*
+         socketpool_waiter_t
+	       ---
+	       a caller queued at a full destination. blocking
+	       callers keep theirs on the stack, async ones on
+	       the heap until the callback has run.
+*/
+
+typedef struct socketpool_waiter_t {
+    struct socketpool_waiter_t* next;       /* QUEUE LINK */
+    socketpool_entry_t*         entry;      /* HANDED-OVER CONNECTION, NULL FOR A SLOT */
+    int                         granted;    /* GOT A CONNECTION OR A SLOT */
+    commc_error_t               status;     /* ASYNC OUTCOME */
+    commc_socketpool_t*         pool;
+    struct socketpool_host_t*   host;
+    commc_async_context_t*      ctx;        /* NULL FOR A BLOCKING CALLER */
+    commc_socketpool_callback_t callback;
+    void*                       user_data;
+    commc_async_task_t          task;       /* DELIVERY TO THE LOOP THREAD */
+} socketpool_waiter_t;
+
+/*
+         socketpool_host_t
+	       ---
+	       one (host, port, protocol) destination.
+*/
+
+typedef struct socketpool_host_t {
+    struct socketpool_host_t* next;         /* BUCKET CHAIN */
+    unsigned long             hash;
+    char                      hostname[COMMC_SOCKET_MAX_HOSTNAME_LENGTH];
+    int                       port;
+    commc_socket_type_t       type;
+    socketpool_entry_t*       idle_head;    /* MOST RECENTLY RELEASED */
+    socketpool_entry_t*       idle_tail;    /* LONGEST IDLE */
+    socketpool_waiter_t*      wait_head;    /* FIFO OF WAITING CALLERS */
+    socketpool_waiter_t*      wait_tail;
+    int                       count;        /* OPEN OR CONNECTING */
+} socketpool_host_t;
+
+struct commc_socketpool_t {
+    pool_mutex_t       lock;
+    pool_cond_t        granted;             /* WAKES BLOCKING WAITERS */
+    socketpool_host_t* buckets[COMMC_SOCKETPOOL_HOST_BUCKETS];
+    int                max_per_host;
+    unsigned long      idle_timeout_ms;
+    int                count;               /* OPEN OR CONNECTING, ALL HOSTS */
+    int                idle_count;
+    int                blocked;             /* BLOCKING CALLERS ASLEEP IN ACQUIRE */
+};
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+         pool_now_ms()
+	       ---
+	       monotonic milliseconds for idle ages.
+*/
+
+static unsigned long pool_now_ms(void) {
+
+#ifdef _WIN32
+    return (unsigned long)GetTickCount();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000UL + (unsigned long)(now.tv_nsec / 1000000L);
+#endif
+}
+
+/*
+         pool_cond_timedwait()
+	       ---
+	       waits on the pool's condition for at most ms.
+*/
+
+static void pool_cond_timedwait(commc_socketpool_t* pool, unsigned long ms) {
+
+#ifdef _WIN32
+    SleepConditionVariableCS(&pool->granted, &pool->lock, (DWORD)ms);
+#else
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec  += (time_t)(ms / 1000UL);
+    deadline.tv_nsec += (long)(ms % 1000UL) * 1000000L;
+
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_cond_timedwait(&pool->granted, &pool->lock, &deadline);
+#endif
+}
+
+/*
+         hash_key()
+	       ---
+	       FNV-1a over the destination triple.
+*/
+
+static unsigned long hash_key(const char* hostname, int port, commc_socket_type_t type) {
+
+    unsigned long hash = 2166136261UL;
+
+    while (*hostname) {
+        hash = ((hash ^ (unsigned char)*hostname++) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+
+    hash = ((hash ^ (unsigned long)(port & 0xFFFF)) * 16777619UL) & 0xFFFFFFFFUL;
+    hash = ((hash ^ (unsigned long)type) * 16777619UL) & 0xFFFFFFFFUL;
+
+    return hash;
+}
+
+/*
+         find_host()
+	       ---
+	       looks a destination up, adding it if missing.
+	       NULL if it could not be allocated.
+*/
+
+static socketpool_host_t* find_host(commc_socketpool_t* pool,
+                                    const char*         hostname,
+                                    int                 port,
+                                    commc_socket_type_t type) {
+
+    unsigned long      hash = hash_key(hostname, port, type);
+    socketpool_host_t* host;
+    socketpool_host_t** bucket = &pool->buckets[hash % COMMC_SOCKETPOOL_HOST_BUCKETS];
+
+    for (host = *bucket; host; host = host->next) {
+        if (host->hash == hash && host->port == port && host->type == type &&
+            strcmp(host->hostname, hostname) == 0) {
+            return host;
+        }
+    }
+
+    host = (socketpool_host_t*)malloc(sizeof(socketpool_host_t));
+    if (!host) {
+        return NULL;
+    }
+
+    memset(host, 0, sizeof(socketpool_host_t));
+    strncpy(host->hostname, hostname, sizeof(host->hostname) - 1);
+    host->hash = hash;
+    host->port = port;
+    host->type = type;
+
+    host->next = *bucket;
+    *bucket = host;
+
+    return host;
+}
+
+/*
+         idle_unlink() / idle_push()
+	       ---
+	       idle list maintenance.
+*/
+
+static void idle_unlink(commc_socketpool_t* pool, socketpool_entry_t* entry) {
+
+    socketpool_host_t* host = entry->host;
+
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        host->idle_head = entry->next;
+    }
+
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        host->idle_tail = entry->prev;
+    }
+
+    entry->prev = NULL;
+    entry->next = NULL;
+    pool->idle_count--;
+}
+
+static void idle_push(commc_socketpool_t* pool, socketpool_entry_t* entry) {
+
+    socketpool_host_t* host = entry->host;
+
+    entry->prev = NULL;
+    entry->next = host->idle_head;
+
+    if (host->idle_head) {
+        host->idle_head->prev = entry;
+    } else {
+        host->idle_tail = entry;
+    }
+
+    host->idle_head = entry;
+    pool->idle_count++;
+}
+
+/*
+         entry_alive()
+	       ---
+	       probes an idle TCP connection without blocking.
+	       pending bytes count as dead too: an idle request/
+	       response connection has nothing to say, so they
+	       are an EOF in disguise or junk from a confused
+	       peer. UDP is not probed.
+*/
+
+static int entry_alive(socketpool_entry_t* entry) {
+
+    if (entry->socket.type != COMMC_SOCKET_TYPE_TCP) {
+        return 1;
+    }
+
+#if defined(MSG_DONTWAIT) && !defined(_WIN32)
+    {
+        char probe;
+
+        if (recv(entry->socket.handle, &probe, 1, MSG_PEEK | MSG_DONTWAIT) < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+    }
+#else
+    {
+        fd_set         readable;
+        struct timeval zero;
+
+        FD_ZERO(&readable);
+        FD_SET(entry->socket.handle, &readable);
+        zero.tv_sec = 0;
+        zero.tv_usec = 0;
+
+        if (select(entry->socket.handle + 1, &readable, NULL, NULL, &zero) == 0) {
+            return 1;
+        }
+    }
+#endif
+
+    return 0;
+}
+
+/*
+         entry_close()
+	       ---
+	       closes and frees a connection. the caller settles
+	       its slot.
+*/
+
+static void entry_close(socketpool_entry_t* entry) {
+
+    if (entry->socket.handle != COMMC_INVALID_SOCKET) {
+        commc_socket_disconnect(&entry->socket);
+    }
+
+    free(entry);
+}
+
+/*
+         waiter_unlink()
+	       ---
+	       removes a waiter that gave up from its queue.
+*/
+
+static void waiter_unlink(socketpool_host_t* host, socketpool_waiter_t* waiter) {
+
+    socketpool_waiter_t* prev = NULL;
+    socketpool_waiter_t* cur;
+
+    for (cur = host->wait_head; cur; prev = cur, cur = cur->next) {
+
+        if (cur != waiter) {
+            continue;
+        }
+
+        if (prev) {
+            prev->next = cur->next;
+        } else {
+            host->wait_head = cur->next;
+        }
+
+        if (host->wait_tail == cur) {
+            host->wait_tail = prev;
+        }
+
+        return;
+    }
+}
+
+/*
+         waiter_grant()
+	       ---
+	       hands a released connection, or with entry NULL
+	       the slot of a closed one, to the first waiter.
+	       returns 0 if nobody waits.
+*/
+
+static int waiter_grant(commc_socketpool_t* pool,
+                        socketpool_host_t*  host,
+                        socketpool_entry_t* entry) {
+
+    socketpool_waiter_t* waiter = host->wait_head;
+
+    if (!waiter) {
+        return 0;
+    }
+
+    host->wait_head = waiter->next;
+    if (!host->wait_head) {
+        host->wait_tail = NULL;
+    }
+
+    if (entry) {
+        entry->in_use = 1;
+    }
+
+    waiter->next = NULL;
+    waiter->entry = entry;
+    waiter->granted = 1;
+
+    if (waiter->ctx) {
+        commc_async_post_task(waiter->ctx, &waiter->task);
+    } else {
+        POOL_COND_BROADCAST(&pool->granted);
+    }
+
+    return 1;
+}
+
+/*
+         slot_free()
+	       ---
+	       settles the slot of a closed or never-opened
+	       connection.
+*/
+
+static void slot_free(commc_socketpool_t* pool, socketpool_host_t* host) {
+
+    if (!waiter_grant(pool, host, NULL)) {
+        host->count--;
+        pool->count--;
+    }
+}
+
+/*
+         evict_expired()
+	       ---
+	       closes a destination's connections idle for longer
+	       than the timeout, oldest first.
+*/
+
+static int evict_expired(commc_socketpool_t* pool,
+                         socketpool_host_t*  host,
+                         unsigned long       now) {
+
+    socketpool_entry_t* entry;
+    int                 closed = 0;
+
+    while ((entry = host->idle_tail) != NULL &&
+           now - entry->idle_since >= pool->idle_timeout_ms) {
+        idle_unlink(pool, entry);
+        entry_close(entry);
+        slot_free(pool, host);
+        closed++;
+    }
+
+    return closed;
+}
+
+/*
+         take_idle()
+	       ---
+	       pops the warmest idle connection that is still
+	       alive, closing the expired and dead ones on the
+	       way. NULL if none is left.
+*/
+
+static socketpool_entry_t* take_idle(commc_socketpool_t* pool,
+                                     socketpool_host_t*  host) {
+
+    socketpool_entry_t* entry;
+
+    evict_expired(pool, host, pool_now_ms());
+
+    while ((entry = host->idle_head) != NULL) {
+
+        idle_unlink(pool, entry);
+
+        if (entry_alive(entry)) {
+            entry->in_use = 1;
+            return entry;
+        }
+
+        entry_close(entry);
+        slot_free(pool, host);
+    }
+
+    return NULL;
+}
+
+/*
+         connect_entry()
+	       ---
+	       opens a connection for a reserved slot, trying
+	       IPv4 and then IPv6. runs without the lock; the
+	       destination's key fields never change.
+*/
+
+static commc_error_t connect_entry(commc_socketpool_t*  pool,
+                                   socketpool_host_t*   host,
+                                   socketpool_entry_t** out) {
+
+    static const commc_socket_family_t families[2] = {
+        COMMC_SOCKET_FAMILY_IPV4,
+        COMMC_SOCKET_FAMILY_IPV6
+    };
+
+    socketpool_entry_t* entry;
+    commc_socket_t*     socket;
+    commc_error_t       result = COMMC_SYSTEM_ERROR;
+    char                service[16];
+    int                 i;
+
+    sprintf(service, "%d", host->port);
+
+    for (i = 0; i < 2; i++) {
+
+        result = commc_socket_create(&socket, host->type, families[i]);
+        if (result != COMMC_SUCCESS) {
+            continue;
+        }
+
+        result = commc_socket_connect_hostname(socket, host->hostname, service,
+                                               COMMC_SOCKET_DEFAULT_TIMEOUT);
+        if (result != COMMC_SUCCESS) {
+            commc_socket_destroy(socket);
+            continue;
+        }
+
+        entry = (socketpool_entry_t*)malloc(sizeof(socketpool_entry_t));
+        if (!entry) {
+            commc_socket_destroy(socket);
+            return COMMC_MEMORY_ERROR;
+        }
+
+        memset(entry, 0, sizeof(socketpool_entry_t));
+        entry->socket = *socket;
+        free(socket);
+
+        entry->pool = pool;
+        entry->host = host;
+        entry->in_use = 1;
+
+        *out = entry;
+        return COMMC_SUCCESS;
+    }
+
+    return result;
+}
+
+/*
+	==================================
+             --- ASYNC DELIVERY ---
+	==================================
+*/
+
+/*
+         waiter_finish()
+	       ---
+	       calls an async waiter back and frees it.
+*/
+
+static void waiter_finish(socketpool_waiter_t* waiter, commc_error_t status) {
+
+    commc_socket_t* socket = NULL;
+
+    if (status == COMMC_SUCCESS) {
+        socket = &waiter->entry->socket;
+    }
+
+    waiter->callback(waiter->pool, socket, status, waiter->user_data);
+    free(waiter);
+}
+
+/*
+         connect_work() / connect_done()
+	       ---
+	       a new connection made on a helper thread, and its
+	       completion on the loop thread.
+*/
+
+static int connect_work(void* arg, size_t* bytes_transferred) {
+
+    socketpool_waiter_t* waiter = (socketpool_waiter_t*)arg;
+
+    (void)bytes_transferred;
+
+    waiter->status = connect_entry(waiter->pool, waiter->host, &waiter->entry);
+    return 0;
+}
+
+static void connect_done(const commc_async_result_t* result) {
+
+    socketpool_waiter_t* waiter = (socketpool_waiter_t*)result->user_data;
+    commc_socketpool_t*  pool = waiter->pool;
+
+    if (result->error_code != 0) {
+        waiter->status = COMMC_SYSTEM_ERROR;   /* CANCELLED BEFORE IT RAN */
+    }
+
+    if (waiter->status != COMMC_SUCCESS) {
+        POOL_MUTEX_LOCK(&pool->lock);
+        slot_free(pool, waiter->host);
+        POOL_MUTEX_UNLOCK(&pool->lock);
+    }
+
+    waiter_finish(waiter, waiter->status);
+}
+
+/*
+         start_connect()
+	       ---
+	       sends an async waiter holding a slot to the
+	       helper threads.
+*/
+
+static commc_error_t start_connect(socketpool_waiter_t* waiter) {
+
+    waiter->status = COMMC_SYSTEM_ERROR;
+    waiter->entry = NULL;
+
+    if (commc_async_offload(waiter->ctx, connect_work, waiter, connect_done, waiter) != 0) {
+        return COMMC_SYSTEM_ERROR;
+    }
+
+    return COMMC_SUCCESS;
+}
+
+/*
+         waiter_task()
+	       ---
+	       runs on the loop thread once a queued async
+	       waiter was granted something (or the pool died).
+*/
+
+static void waiter_task(void* arg) {
+
+    socketpool_waiter_t* waiter = (socketpool_waiter_t*)arg;
+    commc_socketpool_t*  pool = waiter->pool;
+
+    if (!pool) {
+        waiter_finish(waiter, COMMC_ERROR_INVALID_STATE);
+        return;
+    }
+
+    if (waiter->entry) {
+        waiter_finish(waiter, COMMC_SUCCESS);
+        return;
+    }
+
+    if (start_connect(waiter) != COMMC_SUCCESS) {
+        POOL_MUTEX_LOCK(&pool->lock);
+        slot_free(pool, waiter->host);
+        POOL_MUTEX_UNLOCK(&pool->lock);
+        waiter_finish(waiter, COMMC_SYSTEM_ERROR);
+    }
+}
+
+/*
+	==================================
+             --- CORE API ---
+	==================================
+*/
+
 /*
          commc_socketpool_create()
 	       ---
-	       creates and initializes a socket pool
-	       for specified host, port, and type.
+	       creates an empty pool.
 */
 commc_error_t commc_socketpool_create(commc_socketpool_t** pool,
-                                      const char*          hostname,
-                                      int                  port,
-                                      int                  pool_type,
-                                      int                  max_sockets) {
+                                      int                  max_per_host,
+                                      unsigned long        idle_timeout_ms) {
+
     commc_socketpool_t* new_pool;
-    int i;
-    if (!pool || !hostname || port <= 0 || max_sockets <= 0 || max_sockets > COMMC_SOCKETPOOL_MAX_SOCKETS) {
+
+    if (!pool || max_per_host < 0) {
         return COMMC_ERROR_INVALID_ARGUMENT;
     }
+
     new_pool = (commc_socketpool_t*)malloc(sizeof(commc_socketpool_t));
     if (!new_pool) {
         return COMMC_MEMORY_ERROR;
     }
+
     memset(new_pool, 0, sizeof(commc_socketpool_t));
-    strncpy(new_pool->hostname, hostname, sizeof(new_pool->hostname)-1);
-    new_pool->port = port;
-    new_pool->pool_type = pool_type;
-    new_pool->max_sockets = max_sockets;
-    new_pool->socket_count = 0;
-    for (i = 0; i < max_sockets; i++) {
-        new_pool->sockets[i] = NULL;
-        new_pool->in_use[i] = 0;
+
+    new_pool->max_per_host = max_per_host > 0 ? max_per_host
+                                              : COMMC_SOCKETPOOL_DEFAULT_MAX_PER_HOST;
+    new_pool->idle_timeout_ms = idle_timeout_ms > 0 ? idle_timeout_ms
+                                                    : COMMC_SOCKETPOOL_DEFAULT_IDLE_TIMEOUT;
+
+    if (POOL_MUTEX_INIT(&new_pool->lock) != 0) {
+        free(new_pool);
+        return COMMC_SYSTEM_ERROR;
+    }
+
+    if (POOL_COND_INIT(&new_pool->granted) != 0) {
+        POOL_MUTEX_DESTROY(&new_pool->lock);
+        free(new_pool);
+        return COMMC_SYSTEM_ERROR;
     }
+
     *pool = new_pool;
     return COMMC_SUCCESS;
 }
@@ -62,87 +742,384 @@ commc_error_t commc_socketpool_create(commc_socketpool_t** pool,
 /*
          commc_socketpool_destroy()
 	       ---
-	       destroys socket pool and closes all
-	       managed sockets.
+	       closes idle connections, fails every waiter and
+	       frees the pool once the blocking ones have left
+	       acquire.
 */
 void commc_socketpool_destroy(commc_socketpool_t* pool) {
-    int i;
-    if (!pool) return;
-    for (i = 0; i < pool->max_sockets; i++) {
-        if (pool->sockets[i]) {
-            commc_socket_destroy(pool->sockets[i]);
-            pool->sockets[i] = NULL;
+
+    socketpool_host_t*   host;
+    socketpool_entry_t*  entry;
+    socketpool_waiter_t* waiter;
+    int                  i;
+
+    if (!pool) {
+        return;
+    }
+
+    POOL_MUTEX_LOCK(&pool->lock);
+
+    for (i = 0; i < COMMC_SOCKETPOOL_HOST_BUCKETS; i++) {
+
+        while ((host = pool->buckets[i]) != NULL) {
+
+            pool->buckets[i] = host->next;
+
+            while ((entry = host->idle_head) != NULL) {
+                idle_unlink(pool, entry);
+                entry_close(entry);
+            }
+
+            while ((waiter = host->wait_head) != NULL) {
+                host->wait_head = waiter->next;
+                waiter->pool = NULL;
+                waiter->entry = NULL;
+                waiter->status = COMMC_ERROR_INVALID_STATE;
+                waiter->granted = 1;
+                if (waiter->ctx) {
+                    commc_async_post_task(waiter->ctx, &waiter->task);
+                }
+            }
+
+            free(host);
         }
     }
+
+    /* blocking waiters still sleep on the condition and the lock */
+
+    POOL_COND_BROADCAST(&pool->granted);
+
+    while (pool->blocked > 0) {
+        POOL_COND_WAIT(&pool->granted, &pool->lock);
+    }
+
+    POOL_MUTEX_UNLOCK(&pool->lock);
+
+    POOL_COND_DESTROY(&pool->granted);
+    POOL_MUTEX_DESTROY(&pool->lock);
     free(pool);
 }
 
 /*
          commc_socketpool_acquire()
 	       ---
-	       acquires an available socket from the pool
-	       for use. returns pointer to socket or NULL.
-*/
-commc_socket_t* commc_socketpool_acquire(commc_socketpool_t* pool) {
-    int i;
-    if (!pool) return NULL;
-    for (i = 0; i < pool->max_sockets; i++) {
-        if (!pool->in_use[i]) {
-            if (!pool->sockets[i]) {
-                /* Create new socket if not present */
-                pool->sockets[i] = (commc_socket_t*)malloc(sizeof(commc_socket_t));
-                if (!pool->sockets[i]) return NULL;
-                memset(pool->sockets[i], 0, sizeof(commc_socket_t));
-                pool->sockets[i]->type = pool->pool_type == 0 ? COMMC_SOCKET_TYPE_TCP : COMMC_SOCKET_TYPE_UDP;
-                if (pool->pool_type == 0) {
-                    /* TCP */
-                    if (commc_socket_connect_hostname(pool->sockets[i], pool->hostname, NULL, COMMC_SOCKET_DEFAULT_TIMEOUT) != COMMC_SUCCESS) {
-                        commc_socket_destroy(pool->sockets[i]);
-                        pool->sockets[i] = NULL;
-                        continue;
-                    }
-                } else {
-                    /* UDP: just initialize type, no connect needed */
-                }
-                pool->socket_count++;
+	       hands out an idle connection, a new one, or one
+	       released while waiting.
+*/
+commc_error_t commc_socketpool_acquire(commc_socketpool_t* pool,
+                                       const char*         hostname,
+                                       int                 port,
+                                       commc_socket_type_t type,
+                                       int                 timeout_ms,
+                                       commc_socket_t**    socket) {
+
+    socketpool_host_t*  host;
+    socketpool_entry_t* entry;
+    socketpool_waiter_t waiter;
+    commc_error_t       result;
+    unsigned long       start;
+    unsigned long       elapsed;
+
+    if (!pool || !hostname || !socket || port <= 0 || port > 65535) {
+        return COMMC_ERROR_INVALID_ARGUMENT;
+    }
+
+    POOL_MUTEX_LOCK(&pool->lock);
+
+    host = find_host(pool, hostname, port, type);
+    if (!host) {
+        POOL_MUTEX_UNLOCK(&pool->lock);
+        return COMMC_MEMORY_ERROR;
+    }
+
+    entry = take_idle(pool, host);
+    if (entry) {
+        POOL_MUTEX_UNLOCK(&pool->lock);
+        *socket = &entry->socket;
+        return COMMC_SUCCESS;
+    }
+
+    if (host->count < pool->max_per_host) {
+
+        host->count++;
+        pool->count++;
+
+    } else {
+
+        if (timeout_ms == 0) {
+            POOL_MUTEX_UNLOCK(&pool->lock);
+            return COMMC_ERROR_WOULD_BLOCK;
+        }
+
+        memset(&waiter, 0, sizeof(waiter));
+
+        if (host->wait_tail) {
+            host->wait_tail->next = &waiter;
+        } else {
+            host->wait_head = &waiter;
+        }
+        host->wait_tail = &waiter;
+
+        pool->blocked++;
+        start = pool_now_ms();
+
+        while (!waiter.granted) {
+
+            if (timeout_ms < 0) {
+                POOL_COND_WAIT(&pool->granted, &pool->lock);
+                continue;
             }
-            pool->in_use[i] = 1;
-            return pool->sockets[i];
+
+            elapsed = pool_now_ms() - start;
+            if (elapsed >= (unsigned long)timeout_ms) {
+                break;
+            }
+
+            pool_cond_timedwait(pool, (unsigned long)timeout_ms - elapsed);
+        }
+
+        pool->blocked--;
+
+        if (waiter.status != COMMC_SUCCESS) {
+            /* the pool is being destroyed; host is gone already */
+            POOL_COND_BROADCAST(&pool->granted);
+            POOL_MUTEX_UNLOCK(&pool->lock);
+            return waiter.status;
+        }
+
+        if (!waiter.granted) {
+            waiter_unlink(host, &waiter);
+            POOL_MUTEX_UNLOCK(&pool->lock);
+            return COMMC_ERROR_TIMEOUT;
+        }
+
+        if (waiter.entry) {
+            POOL_MUTEX_UNLOCK(&pool->lock);
+            *socket = &waiter.entry->socket;
+            return COMMC_SUCCESS;
         }
+
+        /* granted the slot of a closed connection */
     }
-    return NULL;
+
+    POOL_MUTEX_UNLOCK(&pool->lock);
+
+    result = connect_entry(pool, host, &entry);
+
+    if (result != COMMC_SUCCESS) {
+        POOL_MUTEX_LOCK(&pool->lock);
+        slot_free(pool, host);
+        POOL_MUTEX_UNLOCK(&pool->lock);
+        return result;
+    }
+
+    *socket = &entry->socket;
+    return COMMC_SUCCESS;
+}
+
+/*
+         commc_socketpool_acquire_async()
+	       ---
+	       the non-blocking acquire. every outcome after a
+	       successful return goes through callback.
+*/
+commc_error_t commc_socketpool_acquire_async(commc_socketpool_t*         pool,
+                                             commc_async_context_t*      ctx,
+                                             const char*                 hostname,
+                                             int                         port,
+                                             commc_socket_type_t         type,
+                                             commc_socketpool_callback_t callback,
+                                             void*                       user_data) {
+
+    socketpool_host_t*   host;
+    socketpool_waiter_t* waiter;
+
+    if (!pool || !ctx || !hostname || !callback || port <= 0 || port > 65535) {
+        return COMMC_ERROR_INVALID_ARGUMENT;
+    }
+
+    waiter = (socketpool_waiter_t*)malloc(sizeof(socketpool_waiter_t));
+    if (!waiter) {
+        return COMMC_MEMORY_ERROR;
+    }
+
+    memset(waiter, 0, sizeof(socketpool_waiter_t));
+    waiter->pool = pool;
+    waiter->ctx = ctx;
+    waiter->callback = callback;
+    waiter->user_data = user_data;
+    commc_async_task_init(&waiter->task, waiter_task, waiter);
+
+    POOL_MUTEX_LOCK(&pool->lock);
+
+    host = find_host(pool, hostname, port, type);
+    if (!host) {
+        POOL_MUTEX_UNLOCK(&pool->lock);
+        free(waiter);
+        return COMMC_MEMORY_ERROR;
+    }
+
+    waiter->host = host;
+    waiter->entry = take_idle(pool, host);
+
+    if (waiter->entry) {
+
+        waiter->granted = 1;
+        POOL_MUTEX_UNLOCK(&pool->lock);
+        commc_async_post_task(ctx, &waiter->task);
+        return COMMC_SUCCESS;
+
+    }
+
+    if (host->count >= pool->max_per_host) {
+
+        if (host->wait_tail) {
+            host->wait_tail->next = waiter;
+        } else {
+            host->wait_head = waiter;
+        }
+        host->wait_tail = waiter;
+
+        POOL_MUTEX_UNLOCK(&pool->lock);
+        return COMMC_SUCCESS;
+
+    }
+
+    host->count++;
+    pool->count++;
+    POOL_MUTEX_UNLOCK(&pool->lock);
+
+    if (start_connect(waiter) != COMMC_SUCCESS) {
+        POOL_MUTEX_LOCK(&pool->lock);
+        slot_free(pool, host);
+        POOL_MUTEX_UNLOCK(&pool->lock);
+        free(waiter);
+        return COMMC_SYSTEM_ERROR;
+    }
+
+    return COMMC_SUCCESS;
 }
 
 /*
          commc_socketpool_release()
 	       ---
-	       releases a socket back to the pool after use.
+	       passes a connection to the next waiter, parks it
+	       as idle, or closes it.
 */
 commc_error_t commc_socketpool_release(commc_socketpool_t* pool,
-                                       commc_socket_t*     socket) {
-    int i;
-    if (!pool || !socket) return COMMC_ERROR_INVALID_ARGUMENT;
-    for (i = 0; i < pool->max_sockets; i++) {
-        if (pool->sockets[i] == socket) {
-            pool->in_use[i] = 0;
-            return COMMC_SUCCESS;
+                                       commc_socket_t*     socket,
+                                       int                 reusable) {
+
+    socketpool_entry_t* entry = (socketpool_entry_t*)socket;
+    socketpool_host_t*  host;
+
+    if (!pool || !socket) {
+        return COMMC_ERROR_INVALID_ARGUMENT;
+    }
+
+    POOL_MUTEX_LOCK(&pool->lock);
+
+    if (entry->pool != pool || !entry->in_use) {
+        POOL_MUTEX_UNLOCK(&pool->lock);
+        return COMMC_ERROR_INVALID_ARGUMENT;
+    }
+
+    host = entry->host;
+    entry->in_use = 0;
+
+    if (reusable && socket->handle != COMMC_INVALID_SOCKET &&
+        socket->state == COMMC_SOCKET_STATE_CONNECTED) {
+
+        if (!waiter_grant(pool, host, entry)) {
+            entry->idle_since = pool_now_ms();
+            idle_push(pool, entry);
+        }
+
+    } else {
+
+        entry_close(entry);
+        slot_free(pool, host);
+
+    }
+
+    POOL_MUTEX_UNLOCK(&pool->lock);
+    return COMMC_SUCCESS;
+}
+
+/*
+         commc_socketpool_evict_idle()
+	       ---
+	       sweeps every destination for expired idle
+	       connections.
+*/
+int commc_socketpool_evict_idle(commc_socketpool_t* pool) {
+
+    socketpool_host_t* host;
+    unsigned long      now;
+    int                closed = 0;
+    int                i;
+
+    if (!pool) {
+        return 0;
+    }
+
+    POOL_MUTEX_LOCK(&pool->lock);
+
+    now = pool_now_ms();
+
+    for (i = 0; i < COMMC_SOCKETPOOL_HOST_BUCKETS; i++) {
+        for (host = pool->buckets[i]; host; host = host->next) {
+            closed += evict_expired(pool, host, now);
         }
     }
-    return COMMC_ERROR_INVALID_ARGUMENT;
+
+    POOL_MUTEX_UNLOCK(&pool->lock);
+    return closed;
 }
 
 /*
          commc_socketpool_get_count()
 	       ---
-	       returns the number of sockets currently
-	       managed by the pool.
+	       returns the number of open connections.
 */
 int commc_socketpool_get_count(const commc_socketpool_t* pool) {
-    if (!pool) return 0;
-    return pool->socket_count;
+
+    commc_socketpool_t* locked = (commc_socketpool_t*)pool;
+    int                 count;
+
+    if (!pool) {
+        return 0;
+    }
+
+    POOL_MUTEX_LOCK(&locked->lock);
+    count = pool->count;
+    POOL_MUTEX_UNLOCK(&locked->lock);
+
+    return count;
 }
 
-/* 
+/*
+         commc_socketpool_get_idle_count()
+	       ---
+	       returns the number of idle connections.
+*/
+int commc_socketpool_get_idle_count(const commc_socketpool_t* pool) {
+
+    commc_socketpool_t* locked = (commc_socketpool_t*)pool;
+    int                 count;
+
+    if (!pool) {
+        return 0;
+    }
+
+    POOL_MUTEX_LOCK(&locked->lock);
+    count = pool->idle_count;
+    POOL_MUTEX_UNLOCK(&locked->lock);
+
+    return count;
+}
+
+/*
 	==================================
              --- EOF ---
 	==================================
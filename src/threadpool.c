@@ -0,0 +1,1434 @@
+/*
+   ===================================
+   C O M M O N - C
+   WORK-STEALING THREAD POOL IMPLEMENTATION
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+            --- THREAD POOL IMPLEMENTATION ---
+
+    every worker owns a Chase-Lev deque (Chase & Lev 2005, with the
+    memory orderings of Le et al. 2013). the owner pushes and pops
+    at the bottom without any atomic read-modify-write except when
+    racing a thief for the last element; thieves take from the top
+    with a single CAS. when a deque fills up the owner doubles its
+    array; old arrays stay allocated until the pool is destroyed
+    because a thief may still be reading from them.
+
+    the pool keeps a global count of queued tasks. idle workers
+    spin on it for a while, then register as sleepers and wait on
+    a condition variable. submitters bump the count first and only
+    take the lock to signal when a sleeper is registered; both
+    sides use sequentially consistent accesses so one of them
+    always sees the other.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+  #define _POSIX_C_SOURCE 200112L  /* PTHREADS, SYSCONF, SCHED_YIELD */
+#endif
+
+#include "commc/threadpool.h"
+#include "commc/atomic.h"
+#include "commc/error.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <pthread.h>
+  #include <sched.h>
+  #include <unistd.h>
+#endif
+
+/*
+	==================================
+             --- CONSTANTS ---
+	==================================
+*/
+
+#define COMMC_THREADPOOL_CACHE_LINE   64    /* FALSE-SHARING PADDING */
+#define COMMC_THREADPOOL_SPLIT_FACTOR 8     /* PARALLEL_FOR PIECES PER WORKER */
+
+/* the msvc backend of commc/atomic.h works on long, which is
+   narrower than a pointer on win64; x86 loads and stores of
+   aligned pointers are already atomic with acquire/release
+   semantics, so plain volatile accesses suffice there. */
+
+#if defined(_MSC_VER)
+  #define POOL_LOAD_PTR(ptr)             (*(void* volatile*)(ptr))
+  #define POOL_STORE_PTR(ptr, val)       ((void)(*(void* volatile*)(ptr) = (val)))
+  #define POOL_STORE_PTR_RELEASE(ptr, val) ((void)(*(void* volatile*)(ptr) = (val)))
+#else
+  #define POOL_LOAD_PTR(ptr)             COMMC_ATOMIC_LOAD_ACQUIRE(ptr)
+  #define POOL_STORE_PTR(ptr, val)       COMMC_ATOMIC_STORE_RELAXED((ptr), (val))
+  #define POOL_STORE_PTR_RELEASE(ptr, val) COMMC_ATOMIC_STORE_RELEASE((ptr), (val))
+#endif
+
+/*
+	==================================
+             --- PLATFORM THREADS ---
+	==================================
+*/
+
+#ifdef _WIN32
+
+  typedef HANDLE             pool_thread_t;
+  typedef CRITICAL_SECTION   pool_mutex_t;
+  typedef CONDITION_VARIABLE pool_cond_t;
+  typedef DWORD              pool_key_t;
+
+  #define POOL_MUTEX_INIT(m)      (InitializeCriticalSection(m), 0)
+  #define POOL_MUTEX_DESTROY(m)   DeleteCriticalSection(m)
+  #define POOL_MUTEX_LOCK(m)      EnterCriticalSection(m)
+  #define POOL_MUTEX_UNLOCK(m)    LeaveCriticalSection(m)
+  #define POOL_COND_INIT(c)       (InitializeConditionVariable(c), 0)
+  #define POOL_COND_DESTROY(c)    ((void)(c))
+  #define POOL_COND_WAIT(c, m)    SleepConditionVariableCS((c), (m), INFINITE)
+  #define POOL_COND_SIGNAL(c)     WakeConditionVariable(c)
+  #define POOL_COND_BROADCAST(c)  WakeAllConditionVariable(c)
+  #define POOL_YIELD()            SwitchToThread()
+
+#else
+
+  typedef pthread_t          pool_thread_t;
+  typedef pthread_mutex_t    pool_mutex_t;
+  typedef pthread_cond_t     pool_cond_t;
+  typedef pthread_key_t      pool_key_t;
+
+  #define POOL_MUTEX_INIT(m)      pthread_mutex_init((m), NULL)
+  #define POOL_MUTEX_DESTROY(m)   pthread_mutex_destroy(m)
+  #define POOL_MUTEX_LOCK(m)      pthread_mutex_lock(m)
+  #define POOL_MUTEX_UNLOCK(m)    pthread_mutex_unlock(m)
+  #define POOL_COND_INIT(c)       pthread_cond_init((c), NULL)
+  #define POOL_COND_DESTROY(c)    pthread_cond_destroy(c)
+  #define POOL_COND_WAIT(c, m)    pthread_cond_wait((c), (m))
+  #define POOL_COND_SIGNAL(c)     pthread_cond_signal(c)
+  #define POOL_COND_BROADCAST(c)  pthread_cond_broadcast(c)
+  #define POOL_YIELD()            sched_yield()
+
+#endif
+
+/*
+	==================================
+             --- INTERNAL TYPES ---
+	==================================
+*/
+
+/*
+
+         pool_task_t
+	       ---
+	       heap-allocated task record. the next link is only
+	       used while the task sits in the injection queue.
+
+*/
+
+typedef struct pool_task_t {
+
+  commc_threadpool_task_fn   fn;      /* ENTRY POINT */
+  void*                      arg;     /* ENTRY ARGUMENT */
+  commc_threadpool_group_t*  group;   /* OWNING GROUP OR NULL */
+  struct pool_task_t*        next;    /* INJECTION QUEUE LINK */
+
+} pool_task_t;
+
+/*
+
+         deque_array_t
+	       ---
+	       circular storage for a Chase-Lev deque. capacity is
+	       always a power of two.
+
+*/
+
+typedef struct deque_array_t {
+
+  long                   capacity;      /* SLOT COUNT */
+  pool_task_t**          slots;         /* TASK POINTERS */
+  struct deque_array_t*  retired_next;  /* OLDER ARRAYS */
+
+} deque_array_t;
+
+/*
+
+         work_deque_t
+	       ---
+	       Chase-Lev deque. top is shared with thieves, bottom is
+	       written only by the owner; each sits on its own line.
+
+*/
+
+typedef struct {
+
+  long            top;                                           /* STEAL END */
+  char            pad_top[COMMC_THREADPOOL_CACHE_LINE];
+
+  long            bottom;                                        /* OWNER END */
+  deque_array_t*  array;                                         /* CURRENT STORAGE */
+  char            pad_bottom[COMMC_THREADPOOL_CACHE_LINE];
+
+} work_deque_t;
+
+/*
+
+         pool_worker_t
+	       ---
+	       per-worker state.
+
+*/
+
+typedef struct {
+
+  work_deque_t         deque;    /* LOCAL TASKS */
+  commc_threadpool_t*  pool;     /* OWNING POOL */
+  size_t               index;    /* WORKER INDEX */
+  unsigned long        seed;     /* VICTIM SELECTION STATE */
+  pool_thread_t        thread;   /* OS THREAD */
+
+} pool_worker_t;
+
+/*
+
+         commc_threadpool_t
+	       ---
+	       pool structure.
+
+*/
+
+struct commc_threadpool_t {
+
+  pool_worker_t*   workers;          /* WORKER ARRAY */
+  size_t           worker_count;     /* NUMBER OF WORKERS */
+  size_t           started;          /* THREADS ACTUALLY STARTED */
+
+  long             queued;           /* TASKS WAITING IN ANY QUEUE */
+  long             sleepers;         /* WORKERS BLOCKED ON COND */
+  int              shutdown;         /* DESTROY IN PROGRESS */
+
+  pool_mutex_t     lock;             /* GUARDS INJECTION QUEUE AND SLEEP */
+  pool_cond_t      wake;             /* SIGNALLED WHEN WORK ARRIVES */
+  pool_task_t*     inject_head;      /* EXTERNAL SUBMISSIONS */
+  pool_task_t*     inject_tail;
+
+  pool_key_t       self_key;         /* CURRENT WORKER LOOKUP */
+  int              has_key;          /* SELF_KEY WAS ALLOCATED */
+
+};
+
+/*
+
+         range_task_t
+	       ---
+	       parallel_for piece. the task header comes first so
+	       the record is released by the generic task path.
+
+*/
+
+typedef struct {
+
+  pool_task_t                task;   /* MUST BE FIRST */
+  commc_threadpool_group_t*  group;
+  commc_threadpool_range_fn  body;
+  void*                      arg;
+  size_t                     begin;
+  size_t                     end;
+  size_t                     grain;
+
+} range_task_t;
+
+/*
+	==================================
+             --- THREAD-LOCAL LOOKUP ---
+	==================================
+*/
+
+/*
+
+         get_self()
+	       ---
+	       returns the calling worker of pool, or NULL.
+
+*/
+
+static pool_worker_t* get_self(const commc_threadpool_t* pool) {
+
+#ifdef _WIN32
+  return (pool_worker_t*)TlsGetValue(pool->self_key);
+#else
+  return (pool_worker_t*)pthread_getspecific(pool->self_key);
+#endif
+
+}
+
+/*
+
+         set_self()
+	       ---
+	       registers the calling thread as worker.
+
+*/
+
+static void set_self(commc_threadpool_t* pool, pool_worker_t* worker) {
+
+#ifdef _WIN32
+  TlsSetValue(pool->self_key, worker);
+#else
+  pthread_setspecific(pool->self_key, worker);
+#endif
+
+}
+
+/*
+	==================================
+             --- CHASE-LEV DEQUE ---
+	==================================
+*/
+
+/*
+
+         deque_array_create()
+	       ---
+	       allocates deque storage with the given capacity.
+
+*/
+
+static deque_array_t* deque_array_create(long capacity) {
+
+  deque_array_t* array;
+
+  array = (deque_array_t*)malloc(sizeof(deque_array_t));
+
+  if (!array) {
+
+    return NULL;
+
+  }
+
+  array->slots = (pool_task_t**)malloc((size_t)capacity * sizeof(pool_task_t*));
+
+  if (!array->slots) {
+
+    free(array);
+    return NULL;
+
+  }
+
+  array->capacity     = capacity;
+  array->retired_next = NULL;
+
+  return array;
+
+}
+
+/*
+
+         deque_init()
+	       ---
+	       prepares an empty deque.
+
+*/
+
+static int deque_init(work_deque_t* deque) {
+
+  deque->top    = 0;
+  deque->bottom = 0;
+  deque->array  = deque_array_create(COMMC_THREADPOOL_DEQUE_CAPACITY);
+
+  return deque->array ? 0 : -1;
+
+}
+
+/*
+
+         deque_destroy()
+	       ---
+	       frees the current array and every retired one.
+
+*/
+
+static void deque_destroy(work_deque_t* deque) {
+
+  deque_array_t* array;
+  deque_array_t* next;
+
+  array = deque->array;
+
+  while (array) {
+
+    next = array->retired_next;
+    free(array->slots);
+    free(array);
+    array = next;
+
+  }
+
+  deque->array = NULL;
+
+}
+
+/*
+
+         deque_grow()
+	       ---
+	       owner-only. doubles the array, copying the live
+	       window [top, bottom). the old array is chained
+	       behind the new one so thieves may keep reading it.
+
+*/
+
+static deque_array_t* deque_grow(work_deque_t* deque, deque_array_t* old_array,
+                                 long top, long bottom) {
+
+  deque_array_t* new_array;
+  long           i;
+
+  new_array = deque_array_create(old_array->capacity * 2);
+
+  if (!new_array) {
+
+    return NULL;
+
+  }
+
+  for (i = top; i < bottom; i++) {
+
+    new_array->slots[i & (new_array->capacity - 1)] =
+      old_array->slots[i & (old_array->capacity - 1)];
+
+  }
+
+  new_array->retired_next = old_array;
+  POOL_STORE_PTR_RELEASE((void**)&deque->array, (void*)new_array);
+
+  return new_array;
+
+}
+
+/*
+
+         deque_push()
+	       ---
+	       owner-only. adds a task at the bottom.
+
+*/
+
+static int deque_push(work_deque_t* deque, pool_task_t* task) {
+
+  long           bottom;
+  long           top;
+  deque_array_t* array;
+
+  bottom = COMMC_ATOMIC_LOAD_RELAXED(&deque->bottom);
+  top    = COMMC_ATOMIC_LOAD_ACQUIRE(&deque->top);
+  array  = (deque_array_t*)POOL_LOAD_PTR((void**)&deque->array);
+
+  if (bottom - top > array->capacity - 1) {
+
+    array = deque_grow(deque, array, top, bottom);
+
+    if (!array) {
+
+      return -1;
+
+    }
+
+  }
+
+  POOL_STORE_PTR((void**)&array->slots[bottom & (array->capacity - 1)], (void*)task);
+  COMMC_ATOMIC_FENCE_RELEASE();
+  COMMC_ATOMIC_STORE_RELAXED(&deque->bottom, bottom + 1);
+
+  return 0;
+
+}
+
+/*
+
+         deque_pop()
+	       ---
+	       owner-only. takes the most recently pushed task.
+
+*/
+
+static pool_task_t* deque_pop(work_deque_t* deque) {
+
+  long           bottom;
+  long           top;
+  deque_array_t* array;
+  pool_task_t*   task;
+
+  bottom = COMMC_ATOMIC_LOAD_RELAXED(&deque->bottom) - 1;
+  array  = (deque_array_t*)POOL_LOAD_PTR((void**)&deque->array);
+
+  COMMC_ATOMIC_STORE_RELAXED(&deque->bottom, bottom);
+  COMMC_MEMORY_BARRIER();
+
+  top = COMMC_ATOMIC_LOAD_RELAXED(&deque->top);
+
+  if (top > bottom) {
+
+    /* empty: restore bottom */
+
+    COMMC_ATOMIC_STORE_RELAXED(&deque->bottom, bottom + 1);
+    return NULL;
+
+  }
+
+  task = (pool_task_t*)POOL_LOAD_PTR((void**)&array->slots[bottom & (array->capacity - 1)]);
+
+  if (top == bottom) {
+
+    /* last element: race thieves for it */
+
+    if (!COMMC_ATOMIC_CAS(&deque->top, top, top + 1)) {
+
+      task = NULL;
+
+    }
+
+    COMMC_ATOMIC_STORE_RELAXED(&deque->bottom, bottom + 1);
+
+  }
+
+  return task;
+
+}
+
+/*
+
+         deque_steal()
+	       ---
+	       thief side. takes the oldest task, or returns NULL
+	       when the deque is empty or the race was lost.
+
+*/
+
+static pool_task_t* deque_steal(work_deque_t* deque) {
+
+  long           top;
+  long           bottom;
+  deque_array_t* array;
+  pool_task_t*   task;
+
+  top = COMMC_ATOMIC_LOAD_ACQUIRE(&deque->top);
+  COMMC_MEMORY_BARRIER();
+  bottom = COMMC_ATOMIC_LOAD_ACQUIRE(&deque->bottom);
+
+  if (top >= bottom) {
+
+    return NULL;
+
+  }
+
+  array = (deque_array_t*)POOL_LOAD_PTR((void**)&deque->array);
+  task  = (pool_task_t*)POOL_LOAD_PTR((void**)&array->slots[top & (array->capacity - 1)]);
+
+  if (!COMMC_ATOMIC_CAS(&deque->top, top, top + 1)) {
+
+    return NULL;
+
+  }
+
+  return task;
+
+}
+
+/*
+	==================================
+             --- SCHEDULING HELPERS ---
+	==================================
+*/
+
+/*
+
+         wake_one()
+	       ---
+	       wakes a sleeping worker if any is registered.
+
+*/
+
+static void wake_one(commc_threadpool_t* pool) {
+
+  if (COMMC_ATOMIC_LOAD(&pool->sleepers) > 0) {
+
+    POOL_MUTEX_LOCK(&pool->lock);
+    POOL_COND_SIGNAL(&pool->wake);
+    POOL_MUTEX_UNLOCK(&pool->lock);
+
+  }
+
+}
+
+/*
+
+         enqueue_task()
+	       ---
+	       places a task on the caller's deque if the caller is
+	       a worker, otherwise on the injection queue.
+
+*/
+
+static int enqueue_task(commc_threadpool_t* pool, pool_task_t* task) {
+
+  pool_worker_t* self;
+
+  self = get_self(pool);
+
+  /* count first so sleepers that check afterwards see the work */
+
+  COMMC_ATOMIC_INC(&pool->queued);
+
+  if (self) {
+
+    if (deque_push(&self->deque, task) != 0) {
+
+      COMMC_ATOMIC_DEC(&pool->queued);
+      return -1;
+
+    }
+
+  } else {
+
+    task->next = NULL;
+
+    POOL_MUTEX_LOCK(&pool->lock);
+
+    if (pool->inject_tail) {
+
+      pool->inject_tail->next = task;
+
+    } else {
+
+      POOL_STORE_PTR((void**)&pool->inject_head, (void*)task);
+
+    }
+
+    pool->inject_tail = task;
+
+    POOL_MUTEX_UNLOCK(&pool->lock);
+
+  }
+
+  wake_one(pool);
+
+  return 0;
+
+}
+
+/*
+
+         take_injected()
+	       ---
+	       pops one task from the injection queue.
+
+*/
+
+static pool_task_t* take_injected(commc_threadpool_t* pool) {
+
+  pool_task_t* task;
+
+  /* cheap unlocked peek avoids the lock when nothing is queued */
+
+  if (!POOL_LOAD_PTR((void**)&pool->inject_head)) {
+
+    return NULL;
+
+  }
+
+  POOL_MUTEX_LOCK(&pool->lock);
+
+  task = pool->inject_head;
+
+  if (task) {
+
+    POOL_STORE_PTR((void**)&pool->inject_head, (void*)task->next);
+
+    if (!pool->inject_head) {
+
+      pool->inject_tail = NULL;
+
+    }
+
+  }
+
+  POOL_MUTEX_UNLOCK(&pool->lock);
+
+  return task;
+
+}
+
+/*
+
+         find_task()
+	       ---
+	       looks for work in order: own deque, injection queue,
+	       then every other worker starting at a random victim.
+
+*/
+
+static pool_task_t* find_task(commc_threadpool_t* pool, pool_worker_t* self) {
+
+  pool_task_t*  task;
+  size_t        start;
+  size_t        i;
+  size_t        victim;
+
+  task = NULL;
+
+  if (self) {
+
+    task = deque_pop(&self->deque);
+
+  }
+
+  if (!task) {
+
+    task = take_injected(pool);
+
+  }
+
+  if (!task && pool->worker_count > 0) {
+
+    if (self) {
+
+      /* xorshift victim selection spreads thieves across deques */
+
+      self->seed ^= self->seed << 13;
+      self->seed ^= self->seed >> 7;
+      self->seed ^= self->seed << 17;
+      start = (size_t)(self->seed % pool->worker_count);
+
+    } else {
+
+      start = 0;
+
+    }
+
+    for (i = 0; i < pool->worker_count && !task; i++) {
+
+      victim = (start + i) % pool->worker_count;
+
+      if (self && victim == self->index) {
+
+        continue;
+
+      }
+
+      task = deque_steal(&pool->workers[victim].deque);
+
+    }
+
+  }
+
+  if (task) {
+
+    COMMC_ATOMIC_DEC(&pool->queued);
+
+  }
+
+  return task;
+
+}
+
+/*
+
+         run_task()
+	       ---
+	       executes a task, completes its group and frees it.
+
+*/
+
+static void run_task(pool_task_t* task) {
+
+  commc_threadpool_group_t* group;
+
+  group = task->group;
+
+  task->fn(task->arg);
+
+  free(task);
+
+  if (group) {
+
+    COMMC_ATOMIC_DEC(&group->pending);
+
+  }
+
+}
+
+/*
+
+         worker_loop()
+	       ---
+	       body of every worker thread.
+
+*/
+
+static void worker_loop(pool_worker_t* self) {
+
+  commc_threadpool_t* pool;
+  pool_task_t*        task;
+  int                 spins;
+
+  pool  = self->pool;
+  spins = 0;
+
+  set_self(pool, self);
+
+  while (1) {
+
+    task = find_task(pool, self);
+
+    if (task) {
+
+      run_task(task);
+      spins = 0;
+      continue;
+
+    }
+
+    if (COMMC_ATOMIC_LOAD(&pool->shutdown) && COMMC_ATOMIC_LOAD(&pool->queued) == 0) {
+
+      break;
+
+    }
+
+    if (++spins < COMMC_THREADPOOL_SPIN_COUNT) {
+
+      COMMC_CPU_RELAX();
+      continue;
+
+    }
+
+    /* register as sleeper, then re-check under the lock */
+
+    POOL_MUTEX_LOCK(&pool->lock);
+    COMMC_ATOMIC_INC(&pool->sleepers);
+
+    while (COMMC_ATOMIC_LOAD(&pool->queued) == 0 && !COMMC_ATOMIC_LOAD(&pool->shutdown)) {
+
+      POOL_COND_WAIT(&pool->wake, &pool->lock);
+
+    }
+
+    COMMC_ATOMIC_DEC(&pool->sleepers);
+    POOL_MUTEX_UNLOCK(&pool->lock);
+
+    spins = 0;
+
+  }
+
+}
+
+#ifdef _WIN32
+
+static DWORD WINAPI worker_entry(LPVOID param) {
+
+  worker_loop((pool_worker_t*)param);
+  return 0;
+
+}
+
+#else
+
+static void* worker_entry(void* param) {
+
+  worker_loop((pool_worker_t*)param);
+  return NULL;
+
+}
+
+#endif
+
+/*
+
+         online_processors()
+	       ---
+	       returns the number of online CPUs, at least 1.
+
+*/
+
+static size_t online_processors(void) {
+
+#ifdef _WIN32
+  SYSTEM_INFO info;
+
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+#else
+  long count;
+
+  count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (size_t)count : 1;
+#endif
+
+}
+
+/*
+
+         shutdown_workers()
+	       ---
+	       signals shutdown and joins every started worker.
+
+*/
+
+static void shutdown_workers(commc_threadpool_t* pool) {
+
+  size_t i;
+
+  POOL_MUTEX_LOCK(&pool->lock);
+  COMMC_ATOMIC_STORE_SEQ_CST(&pool->shutdown, 1);
+  POOL_COND_BROADCAST(&pool->wake);
+  POOL_MUTEX_UNLOCK(&pool->lock);
+
+  for (i = 0; i < pool->started; i++) {
+
+#ifdef _WIN32
+    WaitForSingleObject(pool->workers[i].thread, INFINITE);
+    CloseHandle(pool->workers[i].thread);
+#else
+    pthread_join(pool->workers[i].thread, NULL);
+#endif
+
+  }
+
+  pool->started = 0;
+
+}
+
+/*
+	==================================
+             --- CORE API ---
+	==================================
+*/
+
+/*
+
+         commc_threadpool_create()
+	       ---
+	       allocates the pool, its deques, and starts workers.
+
+*/
+
+commc_threadpool_t* commc_threadpool_create(size_t worker_count) {
+
+  commc_threadpool_t* pool;
+  size_t              i;
+
+  if (worker_count == 0) {
+
+    worker_count = online_processors();
+
+  }
+
+  if (worker_count > COMMC_THREADPOOL_MAX_WORKERS) {
+
+    worker_count = COMMC_THREADPOOL_MAX_WORKERS;
+
+  }
+
+  pool = (commc_threadpool_t*)malloc(sizeof(commc_threadpool_t));
+
+  if (!pool) {
+
+    return NULL;
+
+  }
+
+  memset(pool, 0, sizeof(commc_threadpool_t));
+
+  pool->workers = (pool_worker_t*)malloc(worker_count * sizeof(pool_worker_t));
+
+  if (!pool->workers) {
+
+    free(pool);
+    return NULL;
+
+  }
+
+  memset(pool->workers, 0, worker_count * sizeof(pool_worker_t));
+  pool->worker_count = worker_count;
+
+  for (i = 0; i < worker_count; i++) {
+
+    pool->workers[i].pool  = pool;
+    pool->workers[i].index = i;
+    pool->workers[i].seed  = 2463534242UL + (unsigned long)i * 2654435761UL;
+
+    if (deque_init(&pool->workers[i].deque) != 0) {
+
+      while (i-- > 0) {
+
+        deque_destroy(&pool->workers[i].deque);
+
+      }
+
+      free(pool->workers);
+      free(pool);
+      return NULL;
+
+    }
+
+  }
+
+  POOL_MUTEX_INIT(&pool->lock);
+  POOL_COND_INIT(&pool->wake);
+
+#ifdef _WIN32
+  pool->self_key = TlsAlloc();
+  if (pool->self_key == TLS_OUT_OF_INDEXES) {
+    commc_threadpool_destroy(pool);
+    return NULL;
+  }
+#else
+  if (pthread_key_create(&pool->self_key, NULL) != 0) {
+    commc_threadpool_destroy(pool);
+    return NULL;
+  }
+#endif
+
+  pool->has_key = 1;
+
+  for (i = 0; i < worker_count; i++) {
+
+#ifdef _WIN32
+    pool->workers[i].thread = CreateThread(NULL, 0, worker_entry, &pool->workers[i], 0, NULL);
+
+    if (!pool->workers[i].thread) {
+
+      commc_threadpool_destroy(pool);
+      return NULL;
+
+    }
+#else
+    if (pthread_create(&pool->workers[i].thread, NULL, worker_entry, &pool->workers[i]) != 0) {
+
+      commc_threadpool_destroy(pool);
+      return NULL;
+
+    }
+#endif
+
+    pool->started++;
+
+  }
+
+  return pool;
+
+}
+
+/*
+
+         commc_threadpool_destroy()
+	       ---
+	       drains queued work, joins workers, frees everything.
+
+*/
+
+void commc_threadpool_destroy(commc_threadpool_t* pool) {
+
+  size_t       i;
+  pool_task_t* task;
+
+  if (!pool) {
+
+    return;
+
+  }
+
+  shutdown_workers(pool);
+
+  /* only reachable when creation failed before all workers ran */
+
+  while ((task = take_injected(pool)) != NULL) {
+
+    COMMC_ATOMIC_DEC(&pool->queued);
+    run_task(task);
+
+  }
+
+  for (i = 0; i < pool->worker_count; i++) {
+
+    deque_destroy(&pool->workers[i].deque);
+
+  }
+
+  if (pool->has_key) {
+
+#ifdef _WIN32
+    TlsFree(pool->self_key);
+#else
+    pthread_key_delete(pool->self_key);
+#endif
+
+  }
+
+  POOL_COND_DESTROY(&pool->wake);
+  POOL_MUTEX_DESTROY(&pool->lock);
+
+  free(pool->workers);
+  free(pool);
+
+}
+
+/*
+
+         submit_internal()
+	       ---
+	       shared path for submit and group spawn.
+
+*/
+
+static commc_error_t submit_internal(commc_threadpool_t* pool,
+                                     commc_threadpool_group_t* group,
+                                     commc_threadpool_task_fn fn,
+                                     void* arg) {
+
+  pool_task_t* task;
+
+  if (!pool || !fn) {
+
+    return COMMC_ARGUMENT_ERROR;
+
+  }
+
+  /* external submissions stop once shutdown starts; tasks spawned
+     by running tasks are still accepted so they can finish */
+
+  if (COMMC_ATOMIC_LOAD_RELAXED(&pool->shutdown) && !get_self(pool)) {
+
+    return COMMC_ERROR_INVALID_STATE;
+
+  }
+
+  task = (pool_task_t*)malloc(sizeof(pool_task_t));
+
+  if (!task) {
+
+    return COMMC_MEMORY_ERROR;
+
+  }
+
+  task->fn    = fn;
+  task->arg   = arg;
+  task->group = group;
+  task->next  = NULL;
+
+  if (group) {
+
+    COMMC_ATOMIC_INC(&group->pending);
+
+  }
+
+  if (enqueue_task(pool, task) != 0) {
+
+    if (group) {
+
+      COMMC_ATOMIC_DEC(&group->pending);
+
+    }
+
+    free(task);
+    return COMMC_MEMORY_ERROR;
+
+  }
+
+  return COMMC_SUCCESS;
+
+}
+
+/*
+
+         commc_threadpool_submit()
+	       ---
+	       queues a fire-and-forget task.
+
+*/
+
+commc_error_t commc_threadpool_submit(commc_threadpool_t* pool,
+                                      commc_threadpool_task_fn fn,
+                                      void* arg) {
+
+  return submit_internal(pool, NULL, fn, arg);
+
+}
+
+/*
+
+         commc_threadpool_worker_count()
+	       ---
+	       returns the number of worker threads.
+
+*/
+
+size_t commc_threadpool_worker_count(const commc_threadpool_t* pool) {
+
+  return pool ? pool->worker_count : 0;
+
+}
+
+/*
+
+         commc_threadpool_current_worker()
+	       ---
+	       returns the calling worker's index or -1.
+
+*/
+
+int commc_threadpool_current_worker(const commc_threadpool_t* pool) {
+
+  pool_worker_t* self;
+
+  if (!pool) {
+
+    return -1;
+
+  }
+
+  self = get_self(pool);
+
+  return self ? (int)self->index : -1;
+
+}
+
+/*
+	==================================
+             --- FORK/JOIN API ---
+	==================================
+*/
+
+/*
+
+         commc_threadpool_group_init()
+	       ---
+	       prepares a group for spawning.
+
+*/
+
+void commc_threadpool_group_init(commc_threadpool_group_t* group,
+                                 commc_threadpool_t* pool) {
+
+  if (!group) {
+
+    return;
+
+  }
+
+  group->pool    = pool;
+  group->pending = 0;
+
+}
+
+/*
+
+         commc_threadpool_group_spawn()
+	       ---
+	       submits a task counted by the group.
+
+*/
+
+commc_error_t commc_threadpool_group_spawn(commc_threadpool_group_t* group,
+                                           commc_threadpool_task_fn fn,
+                                           void* arg) {
+
+  if (!group) {
+
+    return COMMC_ARGUMENT_ERROR;
+
+  }
+
+  return submit_internal(group->pool, group, fn, arg);
+
+}
+
+/*
+
+         commc_threadpool_group_wait()
+	       ---
+	       helps execute pool work until the group drains.
+
+*/
+
+void commc_threadpool_group_wait(commc_threadpool_group_t* group) {
+
+  commc_threadpool_t* pool;
+  pool_worker_t*      self;
+  pool_task_t*        task;
+  int                 spins;
+
+  if (!group || !group->pool) {
+
+    return;
+
+  }
+
+  pool  = group->pool;
+  self  = get_self(pool);
+  spins = 0;
+
+  while (COMMC_ATOMIC_LOAD_ACQUIRE(&group->pending) != 0) {
+
+    task = find_task(pool, self);
+
+    if (task) {
+
+      run_task(task);
+      spins = 0;
+      continue;
+
+    }
+
+    /* the remaining tasks are running elsewhere */
+
+    if (++spins < COMMC_THREADPOOL_SPIN_COUNT) {
+
+      COMMC_CPU_RELAX();
+
+    } else {
+
+      POOL_YIELD();
+
+    }
+
+  }
+
+}
+
+/*
+
+         run_range()
+	       ---
+	       splits a range in halves, spawning the upper halves,
+	       until it fits the grain, then runs the body on what
+	       remains.
+
+*/
+
+static void run_range(commc_threadpool_group_t* group, commc_threadpool_range_fn body,
+                      void* arg, size_t begin, size_t end, size_t grain);
+
+static void range_task_entry(void* param) {
+
+  range_task_t* range;
+
+  range = (range_task_t*)param;
+  run_range(range->group, range->body, range->arg,
+            range->begin, range->end, range->grain);
+
+}
+
+static void run_range(commc_threadpool_group_t* group, commc_threadpool_range_fn body,
+                      void* arg, size_t begin, size_t end, size_t grain) {
+
+  range_task_t* upper;
+  size_t        mid;
+
+  while (end - begin > grain) {
+
+    mid   = begin + (end - begin) / 2;
+    upper = (range_task_t*)malloc(sizeof(range_task_t));
+
+    if (!upper) {
+
+      break; /* out of memory: run the rest inline */
+
+    }
+
+    upper->task.fn    = range_task_entry;
+    upper->task.arg   = upper;
+    upper->task.group = group;
+    upper->task.next  = NULL;
+    upper->group      = group;
+    upper->body       = body;
+    upper->arg        = arg;
+    upper->begin      = mid;
+    upper->end        = end;
+    upper->grain      = grain;
+
+    COMMC_ATOMIC_INC(&group->pending);
+
+    if (enqueue_task(group->pool, &upper->task) != 0) {
+
+      COMMC_ATOMIC_DEC(&group->pending);
+      free(upper);
+      break;
+
+    }
+
+    end = mid;
+
+  }
+
+  body(arg, begin, end);
+
+}
+
+/*
+
+         commc_threadpool_parallel_for()
+	       ---
+	       runs body over [begin, end) and waits for it.
+
+*/
+
+commc_error_t commc_threadpool_parallel_for(commc_threadpool_t* pool,
+                                            size_t begin,
+                                            size_t end,
+                                            size_t grain,
+                                            commc_threadpool_range_fn body,
+                                            void* arg) {
+
+  commc_threadpool_group_t group;
+  size_t                   pieces;
+
+  if (!pool || !body || end < begin) {
+
+    return COMMC_ARGUMENT_ERROR;
+
+  }
+
+  if (end == begin) {
+
+    return COMMC_SUCCESS;
+
+  }
+
+  if (grain == 0) {
+
+    pieces = pool->worker_count * COMMC_THREADPOOL_SPLIT_FACTOR;
+    grain  = (end - begin + pieces - 1) / pieces;
+
+    if (grain == 0) {
+
+      grain = 1;
+
+    }
+
+  }
+
+  commc_threadpool_group_init(&group, pool);
+
+  run_range(&group, body, arg, begin, end, grain);
+  commc_threadpool_group_wait(&group);
+
+  return COMMC_SUCCESS;
+
+}
+
+/*
+	==================================
+             --- EOF ---
+	==================================
+*/
@@ -0,0 +1,773 @@
+/*
+   ===================================
+   T E S T _ A S Y N C _ U R I N G . C
+   ASYNC BACKEND TESTS: IO_URING AND EPOLL
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    runs the same operations through the epoll and the
+	    io_uring backends of commc_async_context and checks
+	    that they agree: a socketpair ping-pong, positioned
+	    file writes and reads, accept and connect on a
+	    loopback port, sendfile into a socket and
+	    cancelling a read that never completes.
+
+	    the ping-pong is timed on each backend and the
+	    round trips per second printed, not checked. on a
+	    kernel without io_uring the request falls back to
+	    epoll; that is reported and the epoll run stands.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L    /* CLOCK_GETTIME, SOCKETPAIR */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#include "commc/async.h"
+#include "commc/error.h"
+
+#define TEST_ROUND_TRIPS   20000
+#define TEST_MESSAGE_SIZE  64
+#define TEST_FILE_PATH     "test_async_uring.tmp"
+#define TEST_FILE_SIZE     262147           /* NOT A MULTIPLE OF ANY BUFFER */
+#define TEST_DEADLINE_MS   10000
+
+static int failures = 0;
+
+#define CHECK(condition, message)                                       \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            printf("  FAILED: %s (line %d)\n", (message), __LINE__);    \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+#ifdef __linux__
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         now_ms()
+	       ---
+	       monotonic milliseconds.
+
+*/
+
+static double now_ms(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+
+}
+
+/*
+
+         set_nonblocking()
+	       ---
+	       the loop must never block on a handle.
+
+*/
+
+static void set_nonblocking(int handle) {
+
+    fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+
+}
+
+/*
+
+         release()
+	       ---
+	       drops a handle from the context before closing
+	       it, as its number may be reused by the next
+	       case.
+
+*/
+
+static void release(commc_async_context_t* ctx, int handle) {
+
+    if (handle >= 0) {
+
+        commc_async_remove_handle(ctx, handle);
+        close(handle);
+
+    }
+
+}
+
+/*
+
+         run_until()
+	       ---
+	       polls ctx until *done is set or the deadline
+	       passes. returns *done.
+
+*/
+
+static int run_until(commc_async_context_t* ctx, const int* done) {
+
+    double deadline = now_ms() + TEST_DEADLINE_MS;
+
+    while (!*done && now_ms() < deadline) {
+
+        commc_async_poll(ctx, 50);
+
+    }
+
+    return *done;
+
+}
+
+/*
+
+         pattern_byte()
+	       ---
+	       byte i of the test file.
+
+*/
+
+static unsigned char pattern_byte(size_t i) {
+
+    return (unsigned char)((i * 13 + i / 509) & 0xFF);
+
+}
+
+/*
+	==================================
+             --- PING-PONG ---
+	==================================
+*/
+
+/*
+
+         pingpong_t
+	       ---
+	       a message bounced between the two ends of a
+	       socketpair: written on one end, read on the
+	       other, and sent back.
+
+*/
+
+typedef struct {
+    commc_async_context_t* ctx;
+    int                    ends[2];
+    char                   outgoing[TEST_MESSAGE_SIZE];
+    char                   incoming[TEST_MESSAGE_SIZE];
+    size_t                 received;      /* BYTES OF THE CURRENT LEG */
+    int                    leg;           /* 0: TOWARDS ends[1], 1: BACK */
+    int                    trips;
+    int                    corrupt;
+    int                    failed;
+    int                    done;
+} pingpong_t;
+
+static void pingpong_read(const commc_async_result_t* result);
+
+/*
+
+         pingpong_send()
+	       ---
+	       writes the message for trip and leg and reads
+	       it on the far end.
+
+*/
+
+static void pingpong_send(pingpong_t* ping) {
+
+    int from = ping->ends[ping->leg];
+    int to   = ping->ends[1 - ping->leg];
+
+    memset(ping->outgoing, 'a' + ping->trips % 26, sizeof(ping->outgoing));
+    sprintf(ping->outgoing, "%d/%d", ping->trips, ping->leg);
+
+    ping->received = 0;
+
+    if (commc_async_write(ping->ctx, from, ping->outgoing, sizeof(ping->outgoing), NULL, NULL) != 0 ||
+        commc_async_read(ping->ctx, to, ping->incoming, sizeof(ping->incoming),
+                         pingpong_read, ping) != 0) {
+
+        ping->failed = 1;
+        ping->done   = 1;
+
+    }
+
+}
+
+/*
+
+         pingpong_read()
+	       ---
+	       a leg arrived (maybe in part): check it and
+	       start the next one.
+
+*/
+
+static void pingpong_read(const commc_async_result_t* result) {
+
+    pingpong_t* ping = (pingpong_t*)result->user_data;
+
+    if (result->error_code != 0 || result->bytes_transferred == 0) {
+
+        ping->failed = 1;
+        ping->done   = 1;
+        return;
+
+    }
+
+    ping->received += result->bytes_transferred;
+
+    if (ping->received < sizeof(ping->incoming)) {
+
+        if (commc_async_read(ping->ctx, ping->ends[1 - ping->leg],
+                             ping->incoming + ping->received,
+                             sizeof(ping->incoming) - ping->received,
+                             pingpong_read, ping) != 0) {
+
+            ping->failed = 1;
+            ping->done   = 1;
+
+        }
+
+        return;
+
+    }
+
+    if (memcmp(ping->incoming, ping->outgoing, sizeof(ping->incoming)) != 0) {
+
+        ping->corrupt = 1;
+
+    }
+
+    if (ping->leg == 1) {
+
+        ping->trips++;
+
+    }
+
+    ping->leg = 1 - ping->leg;
+
+    if (ping->trips == TEST_ROUND_TRIPS) {
+
+        ping->done = 1;
+        return;
+
+    }
+
+    pingpong_send(ping);
+
+}
+
+/*
+
+         test_pingpong()
+	       ---
+	       TEST_ROUND_TRIPS messages there and back;
+	       returns the round trips per second.
+
+*/
+
+static double test_pingpong(commc_async_context_t* ctx) {
+
+    pingpong_t ping;
+    double     start;
+    double     elapsed;
+
+    memset(&ping, 0, sizeof(ping));
+    ping.ctx = ctx;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, ping.ends) != 0) {
+
+        CHECK(0, "socketpair");
+        return 0.0;
+
+    }
+
+    set_nonblocking(ping.ends[0]);
+    set_nonblocking(ping.ends[1]);
+
+    start = now_ms();
+
+    pingpong_send(&ping);
+
+    CHECK(run_until(ctx, &ping.done), "ping-pong finishes in time");
+    CHECK(!ping.failed, "every leg is delivered");
+    CHECK(!ping.corrupt, "every leg arrives intact");
+    CHECK(ping.trips == TEST_ROUND_TRIPS, "every round trip completes");
+
+    elapsed = now_ms() - start;
+
+    release(ctx, ping.ends[0]);
+    release(ctx, ping.ends[1]);
+
+    return elapsed > 0.0 ? ping.trips * 1000.0 / elapsed : 0.0;
+
+}
+
+/*
+	==================================
+             --- FILES ---
+	==================================
+*/
+
+typedef struct {
+    int    done;
+    int    error;
+    size_t bytes;
+} completion_t;
+
+/*
+
+         complete()
+	       ---
+	       records a single operation's outcome.
+
+*/
+
+static void complete(const commc_async_result_t* result) {
+
+    completion_t* completion = (completion_t*)result->user_data;
+
+    completion->error = result->error_code;
+    completion->bytes = result->bytes_transferred;
+    completion->done  = 1;
+
+}
+
+/*
+
+         test_file_offsets()
+	       ---
+	       writes the pattern in two halves, the second
+	       half first, and reads a window across the seam.
+
+*/
+
+static void test_file_offsets(commc_async_context_t* ctx) {
+
+    unsigned char* data = (unsigned char*)malloc(TEST_FILE_SIZE);
+    unsigned char  window[4096];
+    completion_t   first;
+    completion_t   second;
+    completion_t   readback;
+    size_t         half = TEST_FILE_SIZE / 2;
+    size_t         i;
+    int            same = 1;
+    int            handle;
+
+    handle = open(TEST_FILE_PATH, O_CREAT | O_TRUNC | O_RDWR, 0600);
+
+    CHECK(data != NULL && handle >= 0, "file setup");
+
+    if (!data || handle < 0) {
+
+        free(data);
+        return;
+
+    }
+
+    for (i = 0; i < TEST_FILE_SIZE; i++) {
+
+        data[i] = pattern_byte(i);
+
+    }
+
+    memset(&first, 0, sizeof(first));
+    memset(&second, 0, sizeof(second));
+    memset(&readback, 0, sizeof(readback));
+
+    CHECK(commc_async_write_file(ctx, handle, data + half, TEST_FILE_SIZE - half, half,
+                                 complete, &second) == 0, "second half queued");
+    CHECK(run_until(ctx, &second.done) && second.error == 0 &&
+          second.bytes == TEST_FILE_SIZE - half, "second half written at its offset");
+
+    CHECK(commc_async_write_file(ctx, handle, data, half, 0, complete, &first) == 0,
+          "first half queued");
+    CHECK(run_until(ctx, &first.done) && first.error == 0 && first.bytes == half,
+          "first half written at offset 0");
+
+    CHECK(commc_async_read_file(ctx, handle, window, sizeof(window), half - sizeof(window) / 2,
+                                complete, &readback) == 0, "read queued");
+    CHECK(run_until(ctx, &readback.done) && readback.error == 0 &&
+          readback.bytes == sizeof(window), "window read across the seam");
+
+    for (i = 0; i < sizeof(window); i++) {
+
+        if (window[i] != pattern_byte(half - sizeof(window) / 2 + i)) {
+
+            same = 0;
+
+        }
+
+    }
+
+    CHECK(same, "window matches what was written");
+
+    release(ctx, handle);
+    free(data);
+
+}
+
+/*
+	==================================
+             --- SOCKETS ---
+	==================================
+*/
+
+/*
+
+         test_accept_connect()
+	       ---
+	       accepts and connects on a loopback port through
+	       the loop, then sends a greeting across.
+
+*/
+
+static void test_accept_connect(commc_async_context_t* ctx) {
+
+    struct sockaddr_in address;
+    struct sockaddr_in peer;
+    socklen_t          length = sizeof(address);
+    completion_t       accepted;
+    completion_t       connected;
+    completion_t       sent;
+    completion_t       received;
+    char               greeting[16];
+    int                listener;
+    int                client;
+    int                server  = -1;
+
+    memset(&accepted, 0, sizeof(accepted));
+    memset(&connected, 0, sizeof(connected));
+    memset(&sent, 0, sizeof(sent));
+    memset(&received, 0, sizeof(received));
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    client   = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (listener < 0 || client < 0 ||
+        bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listener, 4) != 0 ||
+        getsockname(listener, (struct sockaddr*)&address, &length) != 0) {
+
+        CHECK(0, "listener setup");
+        release(ctx, listener);
+        release(ctx, client);
+        return;
+
+    }
+
+    set_nonblocking(listener);
+    set_nonblocking(client);
+
+    CHECK(commc_async_accept(ctx, listener, &server, &peer, sizeof(peer),
+                             complete, &accepted) == 0, "accept queued");
+    CHECK(commc_async_connect(ctx, client, &address, sizeof(address),
+                              complete, &connected) == 0, "connect queued");
+
+    CHECK(run_until(ctx, &connected.done) && connected.error == 0, "connect completes");
+    CHECK(run_until(ctx, &accepted.done) && accepted.error == 0 && server >= 0, "accept completes");
+
+    if (server >= 0) {
+
+        CHECK(commc_async_write(ctx, client, "hello, loop", 12, complete, &sent) == 0 &&
+              commc_async_read(ctx, server, greeting, sizeof(greeting), complete, &received) == 0,
+              "greeting queued");
+        CHECK(run_until(ctx, &sent.done) && run_until(ctx, &received.done) &&
+              received.bytes == 12 && memcmp(greeting, "hello, loop", 12) == 0,
+              "greeting crosses the accepted connection");
+
+        release(ctx, server);
+
+    }
+
+    release(ctx, client);
+    release(ctx, listener);
+
+}
+
+/*
+
+         drain_t
+	       ---
+	       reads a socket until count bytes arrived,
+	       checking them against the file pattern.
+
+*/
+
+typedef struct {
+    commc_async_context_t* ctx;
+    int                    handle;
+    unsigned char          buffer[8192];
+    size_t                 total;
+    size_t                 count;
+    int                    corrupt;
+    int                    done;
+} drain_t;
+
+static void drain_read(const commc_async_result_t* result) {
+
+    drain_t* drain = (drain_t*)result->user_data;
+    size_t   i;
+
+    if (result->error_code != 0 || result->bytes_transferred == 0) {
+
+        drain->done = 1;
+        return;
+
+    }
+
+    for (i = 0; i < result->bytes_transferred; i++) {
+
+        if (drain->buffer[i] != pattern_byte(drain->total + i)) {
+
+            drain->corrupt = 1;
+
+        }
+
+    }
+
+    drain->total += result->bytes_transferred;
+
+    if (drain->total >= drain->count ||
+        commc_async_read(drain->ctx, drain->handle, drain->buffer, sizeof(drain->buffer),
+                         drain_read, drain) != 0) {
+
+        drain->done = 1;
+
+    }
+
+}
+
+/*
+
+         test_sendfile()
+	       ---
+	       sends the file written by test_file_offsets()
+	       into a socketpair while the other end drains it.
+
+*/
+
+static void test_sendfile(commc_async_context_t* ctx) {
+
+    completion_t sent;
+    drain_t      drain;
+    int          ends[2];
+    int          handle;
+
+    memset(&sent, 0, sizeof(sent));
+    memset(&drain, 0, sizeof(drain));
+
+    handle = open(TEST_FILE_PATH, O_RDONLY);
+
+    if (handle < 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0) {
+
+        CHECK(0, "sendfile setup");
+
+        release(ctx, handle);
+        return;
+
+    }
+
+    set_nonblocking(ends[0]);
+    set_nonblocking(ends[1]);
+
+    drain.ctx    = ctx;
+    drain.handle = ends[1];
+    drain.count  = TEST_FILE_SIZE;
+
+    CHECK(commc_async_read(ctx, ends[1], drain.buffer, sizeof(drain.buffer),
+                           drain_read, &drain) == 0, "drain queued");
+    CHECK(commc_async_sendfile(ctx, ends[0], handle, 0, TEST_FILE_SIZE,
+                               complete, &sent) == 0, "sendfile queued");
+
+    CHECK(run_until(ctx, &sent.done) && sent.error == 0 && sent.bytes == TEST_FILE_SIZE,
+          "sendfile sends the whole file");
+    CHECK(run_until(ctx, &drain.done) && drain.total == TEST_FILE_SIZE, "every byte arrives");
+    CHECK(!drain.corrupt, "bytes arrive as stored");
+
+    release(ctx, ends[0]);
+    release(ctx, ends[1]);
+    release(ctx, handle);
+
+}
+
+/*
+
+         test_cancel()
+	       ---
+	       a read nobody will satisfy completes with
+	       ECANCELED once cancelled.
+
+*/
+
+static void test_cancel(commc_async_context_t* ctx) {
+
+    completion_t cancelled;
+    char         buffer[16];
+    int          ends[2];
+
+    memset(&cancelled, 0, sizeof(cancelled));
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0) {
+
+        CHECK(0, "socketpair");
+        return;
+
+    }
+
+    set_nonblocking(ends[0]);
+    set_nonblocking(ends[1]);
+
+    CHECK(commc_async_read(ctx, ends[1], buffer, sizeof(buffer), complete, &cancelled) == 0,
+          "read queued");
+
+    commc_async_poll(ctx, 0);
+
+    CHECK(!cancelled.done, "read waits for data");
+    CHECK(commc_async_cancel(ctx, ends[1]) == 0, "cancel accepted");
+    CHECK(run_until(ctx, &cancelled.done) && cancelled.error == ECANCELED,
+          "read completes with ECANCELED");
+    CHECK(commc_async_get_pending_count(ctx) == 0, "nothing left pending");
+
+    release(ctx, ends[0]);
+    release(ctx, ends[1]);
+
+}
+
+/*
+
+         test_backend()
+	       ---
+	       every case on one backend. returns the
+	       ping-pong rate, or -1 if the backend fell back.
+
+*/
+
+static double test_backend(commc_async_backend_t backend, const char* name) {
+
+    commc_async_context_t* ctx;
+    double                 rate;
+
+    ctx = commc_async_context_create_with_backend(256, 100, backend);
+
+    if (!ctx) {
+
+        CHECK(0, "context created");
+        return -1.0;
+
+    }
+
+    if (commc_async_get_backend(ctx) != backend) {
+
+        printf("%s unavailable on this kernel; skipped\n", name);
+        commc_async_context_destroy(ctx);
+        return -1.0;
+
+    }
+
+    printf("%s: ping-pong...\n", name);
+    rate = test_pingpong(ctx);
+
+    printf("%s: file offsets...\n", name);
+    test_file_offsets(ctx);
+
+    printf("%s: accept and connect...\n", name);
+    test_accept_connect(ctx);
+
+    printf("%s: sendfile...\n", name);
+    test_sendfile(ctx);
+
+    printf("%s: cancel...\n", name);
+    test_cancel(ctx);
+
+    commc_async_context_destroy(ctx);
+    remove(TEST_FILE_PATH);
+
+    return rate;
+
+}
+
+#endif
+
+/*
+	==================================
+             --- MAIN ---
+	==================================
+*/
+
+int main(void) {
+
+#ifdef __linux__
+    double epoll_rate;
+    double uring_rate;
+#endif
+
+    printf("--- ASYNC BACKEND TESTS ---\n");
+
+#ifndef __linux__
+    printf("SKIPPED: epoll and io_uring are linux backends\n");
+    return 0;
+#else
+    epoll_rate = test_backend(COMMC_ASYNC_BACKEND_EPOLL, "epoll");
+    uring_rate = test_backend(COMMC_ASYNC_BACKEND_IO_URING, "io_uring");
+
+    if (epoll_rate >= 0.0) {
+
+        printf("epoll:    %.0f round trips/s\n", epoll_rate);
+
+    }
+
+    if (uring_rate >= 0.0) {
+
+        printf("io_uring: %.0f round trips/s\n", uring_rate);
+
+    }
+
+    if (failures > 0) {
+
+        printf("%d ASYNC BACKEND CHECKS FAILED\n", failures);
+        return 1;
+
+    }
+
+    printf("ALL ASYNC BACKEND TESTS PASSED\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,651 @@
+/*
+   ===================================
+   T E S T _ B U F R E A D E R . C
+   BUFFERED SOCKET READER TESTS
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    drives commc_bufreader over a socketpair whose
+	    writer sends a known stream in pieces of one to
+	    seven bytes, so lines, delimiters and exact reads
+	    all straddle receives. the reader starts with a
+	    16-byte buffer so compaction and growth run too.
+
+	    every case runs once over a raw descriptor and once
+	    over a commc_socket_t wrapping the same kind of
+	    descriptor. a last case times reading HTTP-style
+	    header lines through the reader against one recv()
+	    per byte; the numbers are printed, not checked.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L    /* CLOCK_GETTIME, NANOSLEEP, PTHREADS */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+#include "commc/bufreader.h"
+#include "commc/socket.h"
+#include "commc/error.h"
+
+#define TEST_INITIAL_SIZE     16
+#define TEST_MAX_SIZE         1024
+#define TEST_BLOB_SIZE        5000         /* WELL PAST THE BUFFER: READ DIRECTLY */
+#define TEST_BENCH_LINES      20000
+
+static int failures = 0;
+
+#define CHECK(condition, message)                                       \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            printf("  FAILED: %s (line %d)\n", (message), __LINE__);    \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+#ifndef _WIN32
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         now_ms()
+	       ---
+	       monotonic milliseconds.
+
+*/
+
+static double now_ms(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+
+}
+
+/*
+
+         writer_t
+	       ---
+	       a stream to send, the piece size pattern and
+	       the descriptor it goes out on. the writer
+	       closes its end when done.
+
+*/
+
+typedef struct {
+    int         fd;
+    const char* data;
+    size_t      length;
+    int         pieces;       /* SEND IN 1..7-BYTE PIECES */
+} writer_t;
+
+/*
+
+         write_stream()
+	       ---
+	       writer thread: sends the stream, pausing
+	       briefly between pieces so the reader sees them
+	       one receive at a time.
+
+*/
+
+static void* write_stream(void* arg) {
+
+    writer_t*       writer = (writer_t*)arg;
+    struct timespec delay;
+    size_t          sent   = 0;
+    size_t          piece;
+    ssize_t         n;
+    unsigned        step   = 0;
+
+    delay.tv_sec  = 0;
+    delay.tv_nsec = 20000L;
+
+    while (sent < writer->length) {
+
+        piece = writer->pieces ? 1 + (step++ * 5) % 7 : writer->length - sent;
+
+        if (piece > writer->length - sent) {
+
+            piece = writer->length - sent;
+
+        }
+
+        n = send(writer->fd, writer->data + sent, piece, 0);
+
+        if (n <= 0) {
+
+            break;
+
+        }
+
+        sent += (size_t)n;
+
+        if (writer->pieces && step % 16 == 0) {
+
+            nanosleep(&delay, NULL);
+
+        }
+
+    }
+
+    close(writer->fd);
+
+    return NULL;
+
+}
+
+/*
+
+         session_t
+	       ---
+	       a reader on one end of a socketpair with a
+	       writer thread on the other.
+
+*/
+
+typedef struct {
+    commc_bufreader_t* reader;
+    commc_socket_t     socket;       /* USED WHEN WRAPPED */
+    writer_t           writer;
+    pthread_t          thread;
+    int                fd;
+} session_t;
+
+/*
+
+         session_open()
+	       ---
+	       starts sending data and creates a reader over
+	       the other end, wrapped in a commc_socket_t when
+	       wrapped is set.
+
+*/
+
+static int session_open(session_t* session, const char* data, size_t length,
+                        int pieces, int wrapped, size_t max_size) {
+
+    int pair[2];
+
+    memset(session, 0, sizeof(*session));
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+
+        return 0;
+
+    }
+
+    session->fd            = pair[0];
+    session->writer.fd     = pair[1];
+    session->writer.data   = data;
+    session->writer.length = length;
+    session->writer.pieces = pieces;
+
+    if (wrapped) {
+
+        session->socket.handle                  = pair[0];
+        session->socket.type                    = COMMC_SOCKET_TYPE_TCP;
+        session->socket.state                   = COMMC_SOCKET_STATE_CONNECTED;
+        session->socket.options.receive_timeout = 5;
+
+        if (commc_bufreader_create(&session->reader, &session->socket,
+                                   TEST_INITIAL_SIZE, max_size) != COMMC_SUCCESS) {
+
+            session->reader = NULL;
+
+        }
+
+    } else if (commc_bufreader_create_fd(&session->reader, pair[0],
+                                         TEST_INITIAL_SIZE, max_size) != COMMC_SUCCESS) {
+
+        session->reader = NULL;
+
+    }
+
+    if (pthread_create(&session->thread, NULL, write_stream, &session->writer) != 0) {
+
+        close(pair[1]);
+        pair[1] = -1;
+
+    }
+
+    if (!session->reader || pair[1] < 0) {
+
+        return 0;
+
+    }
+
+    return 1;
+
+}
+
+/*
+
+         session_close()
+	       ---
+	       frees the reader, drains what the writer still
+	       sends and joins it.
+
+*/
+
+static void session_close(session_t* session) {
+
+    char scratch[256];
+
+    commc_bufreader_destroy(session->reader);
+
+    while (recv(session->fd, scratch, sizeof(scratch), 0) > 0) {
+
+        /* let a writer blocked on a full pair finish */
+
+    }
+
+    pthread_join(session->thread, NULL);
+    close(session->fd);
+
+}
+
+/*
+
+         line_is()
+	       ---
+	       whether the next line reads as expected.
+
+*/
+
+static int line_is(commc_bufreader_t* reader, const char* expected) {
+
+    char*  line;
+    size_t length;
+
+    if (commc_bufreader_read_line(reader, &line, &length) != COMMC_SUCCESS) {
+
+        return 0;
+
+    }
+
+    return length == strlen(expected) && strcmp(line, expected) == 0;
+
+}
+
+/*
+	==================================
+             --- TESTS ---
+	==================================
+*/
+
+/*
+
+         test_lines()
+	       ---
+	       LF and CRLF lines, an empty line, a line longer
+	       than the first buffer, and a last line without
+	       LF, then end of stream.
+
+*/
+
+static void test_lines(int wrapped) {
+
+    static const char stream[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\n"
+        "\r\n"
+        "a header line well past the sixteen bytes the buffer starts with\r\n"
+        "tail";
+
+    session_t session;
+    char*     line;
+    size_t    length;
+
+    if (!session_open(&session, stream, sizeof(stream) - 1, 1, wrapped, TEST_MAX_SIZE)) {
+
+        CHECK(0, "session opened");
+        return;
+
+    }
+
+    CHECK(line_is(session.reader, "HTTP/1.1 200 OK"), "CRLF line");
+    CHECK(line_is(session.reader, "Content-Type: text/plain"), "LF line");
+    CHECK(line_is(session.reader, ""), "empty line");
+    CHECK(line_is(session.reader, "a header line well past the sixteen bytes the buffer starts with"),
+          "line grows the buffer");
+    CHECK(line_is(session.reader, "tail"), "last line without LF");
+    CHECK(commc_bufreader_read_line(session.reader, &line, &length) == COMMC_ERROR_CONNECTION_CLOSED,
+          "end of stream after the last line");
+
+    session_close(&session);
+
+}
+
+/*
+
+         test_until_and_exact()
+	       ---
+	       a header block cut at a split four-byte
+	       delimiter, then a body read exactly: part from
+	       the buffer, the rest straight from the socket.
+
+*/
+
+static void test_until_and_exact(int wrapped) {
+
+    static const char head[] = "GET / HTTP/1.1\r\nHost: x\r\n\r\n";
+    char*             stream;
+    char*             body;
+    const char*       data;
+    size_t            length;
+    size_t            i;
+    session_t         session;
+    size_t            total = sizeof(head) - 1 + TEST_BLOB_SIZE;
+
+    stream = (char*)malloc(total);
+    body   = (char*)malloc(TEST_BLOB_SIZE);
+
+    if (!stream || !body) {
+
+        CHECK(0, "buffers allocated");
+        free(stream);
+        free(body);
+        return;
+
+    }
+
+    memcpy(stream, head, sizeof(head) - 1);
+
+    for (i = 0; i < TEST_BLOB_SIZE; i++) {
+
+        stream[sizeof(head) - 1 + i] = (char)(i * 31 + 7);
+
+    }
+
+    if (!session_open(&session, stream, total, 1, wrapped, TEST_MAX_SIZE)) {
+
+        CHECK(0, "session opened");
+        free(stream);
+        free(body);
+        return;
+
+    }
+
+    CHECK(commc_bufreader_read_until(session.reader, "\r\n\r\n", 4, &data, &length) == COMMC_SUCCESS,
+          "delimiter found across receives");
+    CHECK(length == sizeof(head) - 1 && memcmp(data, head, length) == 0,
+          "block runs through the delimiter");
+
+    CHECK(commc_bufreader_read_exact(session.reader, body, TEST_BLOB_SIZE) == COMMC_SUCCESS,
+          "body read exactly");
+    CHECK(memcmp(body, stream + sizeof(head) - 1, TEST_BLOB_SIZE) == 0, "body bytes intact");
+
+    CHECK(commc_bufreader_read_exact(session.reader, body, 1) == COMMC_ERROR_CONNECTION_CLOSED,
+          "read_exact past the end fails");
+
+    session_close(&session);
+    free(stream);
+    free(body);
+
+}
+
+/*
+
+         test_peek_and_consume()
+	       ---
+	       peek leaves bytes in place; data/consume parse
+	       in place; a plain read hands out what is
+	       buffered.
+
+*/
+
+static void test_peek_and_consume(int wrapped) {
+
+    static const char stream[] = "0123456789abcdefghijXYZ\n";
+
+    session_t   session;
+    const char* data;
+    char        copy[8];
+    size_t      got;
+
+    if (!session_open(&session, stream, sizeof(stream) - 1, 1, wrapped, TEST_MAX_SIZE)) {
+
+        CHECK(0, "session opened");
+        return;
+
+    }
+
+    CHECK(commc_bufreader_peek(session.reader, 10, &data) == COMMC_SUCCESS, "peek ten bytes");
+    CHECK(memcmp(data, "0123456789", 10) == 0, "peeked bytes");
+    CHECK(commc_bufreader_peek(session.reader, 20, &data) == COMMC_SUCCESS, "peek twenty bytes");
+    CHECK(memcmp(data, "0123456789abcdefghij", 20) == 0, "peek did not consume");
+
+    CHECK(commc_bufreader_data(session.reader, &data) >= 20, "data sees the peeked bytes");
+    commc_bufreader_consume(session.reader, 10);
+
+    CHECK(commc_bufreader_read(session.reader, copy, 4, &got) == COMMC_SUCCESS && got == 4,
+          "read from the buffer");
+    CHECK(memcmp(copy, "abcd", 4) == 0, "read follows consume");
+
+    CHECK(line_is(session.reader, "efghijXYZ"), "line after partial reads");
+
+    session_close(&session);
+
+}
+
+/*
+
+         test_limits()
+	       ---
+	       a line past max_size and a delimiter that never
+	       arrives are refused rather than buffered.
+
+*/
+
+static void test_limits(int wrapped) {
+
+    static char stream[300];
+
+    session_t   session;
+    const char* data;
+    char*       line;
+    size_t      length;
+
+    memset(stream, 'x', sizeof(stream));
+
+    if (!session_open(&session, stream, sizeof(stream), 0, wrapped, 128)) {
+
+        CHECK(0, "session opened");
+        return;
+
+    }
+
+    CHECK(commc_bufreader_read_line(session.reader, &line, &length) == COMMC_ERROR_BUFFER_TOO_SMALL,
+          "line past max_size refused");
+
+    session_close(&session);
+
+    if (!session_open(&session, stream, 100, 1, wrapped, 128)) {
+
+        CHECK(0, "session opened");
+        return;
+
+    }
+
+    CHECK(commc_bufreader_read_until(session.reader, "\r\n", 2, &data, &length) == COMMC_ERROR_CONNECTION_CLOSED,
+          "missing delimiter at end of stream is an error");
+
+    session_close(&session);
+
+}
+
+/*
+
+         test_bench()
+	       ---
+	       header lines through the reader against one
+	       recv() per byte, as the clients did before.
+
+*/
+
+static void test_bench(void) {
+
+    static const char header[] = "X-Benchmark-Header: some ordinary header value\r\n";
+
+    char*      stream;
+    session_t  session;
+    size_t     line_size = sizeof(header) - 1;
+    size_t     total     = line_size * TEST_BENCH_LINES;
+    size_t     i;
+    int        lines     = 0;
+    double     start;
+    double     buffered;
+    double     bytewise;
+    char       ch;
+
+    stream = (char*)malloc(total);
+
+    if (!stream) {
+
+        CHECK(0, "stream allocated");
+        return;
+
+    }
+
+    for (i = 0; i < TEST_BENCH_LINES; i++) {
+
+        memcpy(stream + i * line_size, header, line_size);
+
+    }
+
+    if (!session_open(&session, stream, total, 0, 0, 0)) {
+
+        CHECK(0, "session opened");
+        free(stream);
+        return;
+
+    }
+
+    start = now_ms();
+
+    while (line_is(session.reader, "X-Benchmark-Header: some ordinary header value")) {
+
+        lines++;
+
+    }
+
+    buffered = now_ms() - start;
+
+    CHECK(lines == TEST_BENCH_LINES, "every benchmark line read");
+
+    session_close(&session);
+
+    if (!session_open(&session, stream, total, 0, 0, 0)) {
+
+        CHECK(0, "session opened");
+        free(stream);
+        return;
+
+    }
+
+    start = now_ms();
+    lines = 0;
+
+    while (recv(session.fd, &ch, 1, 0) == 1) {
+
+        if (ch == '\n') {
+
+            lines++;
+
+        }
+
+    }
+
+    bytewise = now_ms() - start;
+
+    CHECK(lines == TEST_BENCH_LINES, "every bytewise line read");
+
+    session_close(&session);
+    free(stream);
+
+    printf("  %d lines (%lu bytes): reader %.1f ms, recv per byte %.1f ms (%lu calls)\n",
+           TEST_BENCH_LINES, (unsigned long)total, buffered, bytewise, (unsigned long)total);
+
+}
+
+#endif
+
+/*
+	==================================
+             --- MAIN ---
+	==================================
+*/
+
+int main(void) {
+
+#ifndef _WIN32
+    int wrapped;
+#endif
+
+    printf("--- BUFFERED READER TESTS ---\n");
+
+#ifdef _WIN32
+    printf("SKIPPED: the test needs socketpair() and POSIX threads\n");
+    return 0;
+#else
+    for (wrapped = 0; wrapped < 2; wrapped++) {
+
+        printf("%s:\n", wrapped ? "commc_socket_t" : "raw descriptor");
+
+        printf("lines split across receives...\n");
+        test_lines(wrapped);
+
+        printf("delimited block and exact body...\n");
+        test_until_and_exact(wrapped);
+
+        printf("peek, data and consume...\n");
+        test_peek_and_consume(wrapped);
+
+        printf("size and delimiter limits...\n");
+        test_limits(wrapped);
+
+    }
+
+    printf("reader against recv per byte...\n");
+    test_bench();
+
+    if (failures > 0) {
+
+        printf("%d BUFFERED READER CHECKS FAILED\n", failures);
+        return 1;
+
+    }
+
+    printf("ALL BUFFERED READER TESTS PASSED\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,867 @@
+/*
+   ===================================
+   T E S T _ F T P _ S E G M E N T E D . C
+   SEGMENTED FTP DOWNLOAD TESTS
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    drives commc_ftp_download_segmented() against a
+	    small FTP responder on a loopback port, run on its
+	    own threads. the responder serves one in-memory file
+	    and can refuse or cut short the range at a given
+	    offset, and counts what it sent.
+
+	    covers an uneven last range, a range that resumes
+	    after a dropped data connection, and a range that
+	    fails for good stopping its siblings. downloads are
+	    compared byte for byte with the served file.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L    /* NANOSLEEP, PTHREADS */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#include "commc/ftp.h"
+#include "commc/error.h"
+
+#define TEST_MEGABYTE    1048576
+#define TEST_FILE_SIZE   (4 * TEST_MEGABYTE + 3)      /* LAST OF 4 RANGES IS 3 BYTES LONGER */
+#define TEST_LOCAL_PATH  "test_ftp_segmented.tmp"
+#define TEST_MAX_RETRS   64
+
+static int failures = 0;
+
+#define CHECK(condition, message)                                       \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            printf("  FAILED: %s (line %d)\n", (message), __LINE__);    \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+#ifndef _WIN32
+
+/*
+	==================================
+             --- RESPONDER ---
+	==================================
+*/
+
+/*
+
+         responder_t
+	       ---
+	       the loopback server: what it serves, how it
+	       misbehaves and what it saw. everything below
+	       the lock is guarded by it.
+
+*/
+
+typedef struct {
+    int             listener;
+    int             port;
+    pthread_t       acceptor;
+    unsigned char*  file;
+    size_t          size;
+    pthread_mutex_t lock;
+    size_t          fail_offset;     /* RETR FROM HERE ANSWERS 550, 0 FOR NONE */
+    size_t          drop_offset;     /* FIRST RETR FROM HERE IS CUT SHORT, 0 FOR NONE */
+    int             throttle;        /* SEND 8 KB PER 10 MS */
+    int             active;          /* CONTROL CONNECTIONS BEING SERVED */
+    size_t          rests[TEST_MAX_RETRS];
+    int             retrs;           /* RETRS THAT SENT DATA */
+    size_t          sent;            /* DATA BYTES SENT, REFUSED RANGE EXCLUDED */
+} responder_t;
+
+static responder_t responder;
+
+/*
+
+         pause_ms()
+	       ---
+	       sleeps for ms milliseconds.
+
+*/
+
+static void pause_ms(long ms) {
+
+    struct timespec delay;
+
+    delay.tv_sec  = ms / 1000;
+    delay.tv_nsec = (ms % 1000) * 1000000L;
+
+    nanosleep(&delay, NULL);
+
+}
+
+/*
+
+         reply()
+	       ---
+	       sends one reply line with its CRLF.
+
+*/
+
+static int reply(int control, const char* line) {
+
+    char   buffer[256];
+    size_t length = strlen(line);
+
+    memcpy(buffer, line, length);
+    buffer[length++] = '\r';
+    buffer[length++] = '\n';
+
+    return send(control, buffer, length, 0) == (ssize_t)length;
+
+}
+
+/*
+
+         read_command()
+	       ---
+	       reads one command line, without its CRLF. 0
+	       once the client hung up.
+
+*/
+
+static int read_command(int control, char* line, size_t size) {
+
+    size_t length = 0;
+    char   c;
+
+    while (recv(control, &c, 1, 0) == 1) {
+
+        if (c == '\n') {
+
+            if (length > 0 && line[length - 1] == '\r') {
+
+                length--;
+
+            }
+
+            line[length] = '\0';
+            return 1;
+
+        }
+
+        if (length + 1 < size) {
+
+            line[length++] = c;
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+/*
+
+         open_passive()
+	       ---
+	       listens on a fresh loopback port and names it
+	       in a 227 reply. -1 on failure.
+
+*/
+
+static int open_passive(int control) {
+
+    struct sockaddr_in address;
+    socklen_t          length = sizeof(address);
+    char               line[128];
+    int                passive;
+    int                port;
+
+    passive = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (passive < 0 ||
+        bind(passive, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(passive, 1) != 0 ||
+        getsockname(passive, (struct sockaddr*)&address, &length) != 0) {
+
+        if (passive >= 0) {
+
+            close(passive);
+
+        }
+
+        return -1;
+
+    }
+
+    port = ntohs(address.sin_port);
+
+    sprintf(line, "227 Entering Passive Mode (127,0,0,1,%d,%d)", port >> 8, port & 255);
+    reply(control, line);
+
+    return passive;
+
+}
+
+/*
+
+         serve_retrieve()
+	       ---
+	       answers RETR from offset: refuses it, sends the
+	       rest of the file, or for a dropped range only a
+	       third of a range before closing.
+
+*/
+
+static void serve_retrieve(int control, int passive, size_t offset) {
+
+    size_t length;
+    size_t sent = 0;
+    size_t piece;
+    int    data;
+    int    refuse;
+    int    drop;
+    int    throttle;
+
+    pthread_mutex_lock(&responder.lock);
+
+    refuse   = responder.fail_offset != 0 && offset == responder.fail_offset;
+    drop     = responder.drop_offset != 0 && offset == responder.drop_offset;
+    throttle = responder.throttle;
+
+    if (drop) {
+
+        responder.drop_offset = 0;
+
+    }
+
+    if (!refuse && responder.retrs < TEST_MAX_RETRS) {
+
+        responder.rests[responder.retrs++] = offset;
+
+    }
+
+    pthread_mutex_unlock(&responder.lock);
+
+    if (refuse || passive < 0 || offset >= responder.size) {
+
+        reply(control, "550 Range unavailable");
+        return;
+
+    }
+
+    reply(control, "150 Opening data connection");
+
+    data = accept(passive, NULL, NULL);
+
+    if (data < 0) {
+
+        reply(control, "425 No data connection");
+        return;
+
+    }
+
+    length = responder.size - offset;
+
+    if (drop && length > TEST_MEGABYTE / 3) {
+
+        length = TEST_MEGABYTE / 3;
+
+    }
+
+    while (sent < length) {
+
+        piece = length - sent < 8192 ? length - sent : 8192;
+
+        if (send(data, responder.file + offset + sent, piece, 0) != (ssize_t)piece) {
+
+            break;
+
+        }
+
+        sent += piece;
+
+        pthread_mutex_lock(&responder.lock);
+        responder.sent += piece;
+        pthread_mutex_unlock(&responder.lock);
+
+        if (throttle) {
+
+            pause_ms(10);
+
+        }
+
+    }
+
+    close(data);
+
+    reply(control, sent == responder.size - offset ? "226 Transfer complete" : "426 Connection closed");
+
+}
+
+/*
+
+         serve_control()
+	       ---
+	       thread serving one control connection: USER,
+	       PASS, TYPE, SIZE, PASV, REST, RETR and QUIT.
+
+*/
+
+static void* serve_control(void* arg) {
+
+    int    control = (int)(long)arg;
+    int    passive = -1;
+    size_t offset  = 0;
+    char   line[512];
+    char   answer[64];
+
+    reply(control, "220 Test responder");
+
+    while (read_command(control, line, sizeof(line))) {
+
+        if (strncmp(line, "USER", 4) == 0) {
+
+            reply(control, "331 Password required");
+
+        } else if (strncmp(line, "PASS", 4) == 0) {
+
+            reply(control, "230 Logged in");
+
+        } else if (strncmp(line, "TYPE", 4) == 0) {
+
+            reply(control, "200 Type set");
+
+        } else if (strncmp(line, "SIZE", 4) == 0) {
+
+            sprintf(answer, "213 %lu", (unsigned long)responder.size);
+            reply(control, answer);
+
+        } else if (strncmp(line, "PASV", 4) == 0) {
+
+            if (passive >= 0) {
+
+                close(passive);
+
+            }
+
+            passive = open_passive(control);
+
+        } else if (strncmp(line, "REST", 4) == 0) {
+
+            offset = (size_t)strtoul(line + 5, NULL, 10);
+            reply(control, "350 Restarting");
+
+        } else if (strncmp(line, "RETR", 4) == 0) {
+
+            serve_retrieve(control, passive, offset);
+
+            close(passive);
+            passive = -1;
+            offset  = 0;
+
+        } else if (strncmp(line, "QUIT", 4) == 0) {
+
+            reply(control, "221 Bye");
+            break;
+
+        } else {
+
+            reply(control, "502 Not implemented");
+
+        }
+
+    }
+
+    if (passive >= 0) {
+
+        close(passive);
+
+    }
+
+    close(control);
+
+    pthread_mutex_lock(&responder.lock);
+    responder.active--;
+    pthread_mutex_unlock(&responder.lock);
+
+    return NULL;
+
+}
+
+/*
+
+         accept_controls()
+	       ---
+	       acceptor thread; runs until the listener is
+	       shut down.
+
+*/
+
+static void* accept_controls(void* arg) {
+
+    pthread_t thread;
+    int       control;
+
+    (void)arg;
+
+    while ((control = accept(responder.listener, NULL, NULL)) >= 0) {
+
+        pthread_mutex_lock(&responder.lock);
+        responder.active++;
+        pthread_mutex_unlock(&responder.lock);
+
+        if (pthread_create(&thread, NULL, serve_control, (void*)(long)control) != 0) {
+
+            close(control);
+
+            pthread_mutex_lock(&responder.lock);
+            responder.active--;
+            pthread_mutex_unlock(&responder.lock);
+
+            continue;
+
+        }
+
+        pthread_detach(thread);
+
+    }
+
+    return NULL;
+
+}
+
+/*
+
+         responder_start()
+	       ---
+	       fills the served file with a pattern that has
+	       no period of a range's length and starts
+	       listening.
+
+*/
+
+static int responder_start(void) {
+
+    struct sockaddr_in address;
+    socklen_t          length = sizeof(address);
+    size_t             i;
+
+    memset(&responder, 0, sizeof(responder));
+
+    responder.size = TEST_FILE_SIZE;
+    responder.file = (unsigned char*)malloc(responder.size);
+
+    if (!responder.file) {
+
+        return 0;
+
+    }
+
+    for (i = 0; i < responder.size; i++) {
+
+        responder.file[i] = (unsigned char)((i * 7 + i / 251) & 0xFF);
+
+    }
+
+    pthread_mutex_init(&responder.lock, NULL);
+
+    responder.listener = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (responder.listener < 0 ||
+        bind(responder.listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(responder.listener, 32) != 0 ||
+        getsockname(responder.listener, (struct sockaddr*)&address, &length) != 0) {
+
+        return 0;
+
+    }
+
+    responder.port = ntohs(address.sin_port);
+
+    return pthread_create(&responder.acceptor, NULL, accept_controls, NULL) == 0;
+
+}
+
+/*
+
+         responder_reset()
+	       ---
+	       clears the counters and sets how the next
+	       download is served.
+
+*/
+
+static void responder_reset(size_t fail_offset, size_t drop_offset, int throttle) {
+
+    pthread_mutex_lock(&responder.lock);
+
+    responder.fail_offset = fail_offset;
+    responder.drop_offset = drop_offset;
+    responder.throttle    = throttle;
+    responder.retrs       = 0;
+    responder.sent        = 0;
+
+    pthread_mutex_unlock(&responder.lock);
+
+}
+
+/*
+
+         responder_settle()
+	       ---
+	       waits up to five seconds for every control
+	       connection to be closed, so the counters are
+	       final.
+
+*/
+
+static int responder_settle(void) {
+
+    int waited;
+    int active = 1;
+
+    for (waited = 0; waited < 500 && active; waited++) {
+
+        pthread_mutex_lock(&responder.lock);
+        active = responder.active;
+        pthread_mutex_unlock(&responder.lock);
+
+        if (active) {
+
+            pause_ms(10);
+
+        }
+
+    }
+
+    return !active;
+
+}
+
+/*
+
+         responder_stop()
+	       ---
+	       stops accepting and frees the served file.
+
+*/
+
+static void responder_stop(void) {
+
+    shutdown(responder.listener, SHUT_RDWR);
+    close(responder.listener);
+    pthread_join(responder.acceptor, NULL);
+
+    responder_settle();
+
+    pthread_mutex_destroy(&responder.lock);
+    free(responder.file);
+
+}
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         download()
+	       ---
+	       logs in to the responder and runs one
+	       segmented download into TEST_LOCAL_PATH.
+
+*/
+
+static commc_error_t download(int segments) {
+
+    commc_ftp_client_t* client;
+    commc_error_t       result;
+
+    result = commc_ftp_client_create(&client);
+
+    if (result != COMMC_SUCCESS) {
+
+        return result;
+
+    }
+
+    result = commc_ftp_connect(client, "127.0.0.1", responder.port);
+
+    if (result == COMMC_SUCCESS) {
+
+        result = commc_ftp_authenticate(client, "test", "test");
+
+    }
+
+    if (result == COMMC_SUCCESS) {
+
+        result = commc_ftp_download_segmented(client, "served.bin", TEST_LOCAL_PATH, segments);
+
+    }
+
+    commc_ftp_disconnect(client);
+    commc_ftp_client_destroy(client);
+
+    return result;
+
+}
+
+/*
+
+         matches_served()
+	       ---
+	       true when TEST_LOCAL_PATH holds exactly the
+	       served file.
+
+*/
+
+static int matches_served(void) {
+
+    unsigned char buffer[65536];
+    size_t        total = 0;
+    size_t        got;
+    int           same  = 1;
+    FILE*         file  = fopen(TEST_LOCAL_PATH, "rb");
+
+    if (!file) {
+
+        return 0;
+
+    }
+
+    while (same && (got = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+
+        same   = total + got <= responder.size &&
+                 memcmp(buffer, responder.file + total, got) == 0;
+        total += got;
+
+    }
+
+    fclose(file);
+
+    return same && total == responder.size;
+
+}
+
+/*
+
+         saw_rest()
+	       ---
+	       true when a RETR that sent data started at
+	       offset.
+
+*/
+
+static int saw_rest(size_t offset) {
+
+    int i;
+
+    for (i = 0; i < responder.retrs; i++) {
+
+        if (responder.rests[i] == offset) {
+
+            return 1;
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+/*
+	==================================
+             --- TESTS ---
+	==================================
+*/
+
+/*
+
+         test_uneven_ranges()
+	       ---
+	       four ranges of a size that does not divide by
+	       four: the last one carries the remainder and
+	       the file comes back byte for byte.
+
+*/
+
+static void test_uneven_ranges(void) {
+
+    commc_error_t result;
+
+    printf("uneven last range...\n");
+
+    responder_reset(0, 0, 0);
+
+    result = download(4);
+
+    CHECK(result == COMMC_SUCCESS, "download succeeds");
+    CHECK(responder_settle(), "every session was closed");
+    CHECK(responder.retrs == 4, "one RETR per range");
+    CHECK(saw_rest(0) && saw_rest(TEST_MEGABYTE) &&
+          saw_rest(2 * TEST_MEGABYTE) && saw_rest(3 * TEST_MEGABYTE), "ranges start a quarter apart");
+    CHECK(matches_served(), "file is byte-exact");
+
+    remove(TEST_LOCAL_PATH);
+
+}
+
+/*
+
+         test_resumed_range()
+	       ---
+	       the second range's data connection is cut
+	       after a third; the range resumes from where it
+	       stopped and the file still comes back whole.
+
+*/
+
+static void test_resumed_range(void) {
+
+    commc_error_t result;
+    int           i;
+    int           resumed = 0;
+
+    printf("resumed range...\n");
+
+    responder_reset(0, TEST_MEGABYTE, 0);
+
+    result = download(4);
+
+    CHECK(result == COMMC_SUCCESS, "download succeeds after a drop");
+    CHECK(responder_settle(), "every session was closed");
+
+    for (i = 0; i < responder.retrs; i++) {
+
+        if (responder.rests[i] > TEST_MEGABYTE && responder.rests[i] < 2 * TEST_MEGABYTE) {
+
+            resumed = 1;
+
+        }
+
+    }
+
+    CHECK(resumed, "dropped range resumes inside itself");
+    CHECK(matches_served(), "file is byte-exact");
+
+    remove(TEST_LOCAL_PATH);
+
+}
+
+/*
+
+         test_failed_range()
+	       ---
+	       the third range is refused every time. the
+	       download fails, leaves no file, and the other
+	       ranges, served slowly, stop well before their
+	       three megabytes are through.
+
+*/
+
+static void test_failed_range(void) {
+
+    commc_error_t result;
+    FILE*         file;
+
+    printf("failed range stops its siblings...\n");
+
+    responder_reset(2 * TEST_MEGABYTE, 0, 1);
+
+    result = download(4);
+
+    CHECK(result != COMMC_SUCCESS, "download fails");
+    CHECK(responder_settle(), "every session was closed");
+    CHECK(responder.sent < 2 * TEST_MEGABYTE, "siblings stopped early");
+
+    file = fopen(TEST_LOCAL_PATH, "rb");
+
+    CHECK(file == NULL, "partial file is removed");
+
+    if (file) {
+
+        fclose(file);
+        remove(TEST_LOCAL_PATH);
+
+    }
+
+}
+
+#endif
+
+/*
+	==================================
+             --- MAIN ---
+	==================================
+*/
+
+int main(void) {
+
+    printf("--- SEGMENTED FTP DOWNLOAD TESTS ---\n");
+
+#ifdef _WIN32
+    printf("SKIPPED: the loopback responder needs POSIX threads and sockets\n");
+    return 0;
+#else
+    /* A stopped range closes its data connection under the sender */
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!responder_start()) {
+
+        printf("FAILED: could not start the loopback responder\n");
+        return 1;
+
+    }
+
+    test_uneven_ranges();
+    test_resumed_range();
+    test_failed_range();
+
+    responder_stop();
+
+    if (failures > 0) {
+
+        printf("%d SEGMENTED FTP CHECKS FAILED\n", failures);
+        return 1;
+
+    }
+
+    printf("ALL SEGMENTED FTP TESTS PASSED\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,788 @@
+/*
+   ===================================
+   T E S T _ H T T P _ K E E P A L I V E . C
+   HTTP CLIENT CONNECTION REUSE TESTS
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    runs commc_http_client against a loopback HTTP/1.1
+	    server on threads that counts the connections it
+	    accepts. requests with Content-Length and chunked
+	    responses must share one connection; a response
+	    with "Connection: close", a body read to end of
+	    stream, a connection the server dropped while it
+	    was parked and a client with keep-alive off must
+	    each cost a new one.
+
+	    a last case times many small requests with and
+	    without keep-alive; the rates are printed, not
+	    checked.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L    /* CLOCK_GETTIME, NANOSLEEP, PTHREADS */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#include "commc/http.h"
+#include "commc/error.h"
+
+#define TEST_REQUESTS         200
+#define TEST_BENCH_REQUESTS   2000
+#define TEST_HEAD_SIZE        4096
+
+static int failures = 0;
+
+#define CHECK(condition, message)                                       \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            printf("  FAILED: %s (line %d)\n", (message), __LINE__);    \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+#ifndef _WIN32
+
+/*
+	==================================
+             --- SERVER ---
+	==================================
+*/
+
+/*
+
+         server_t
+	       ---
+	       the loopback server and what it saw.
+	       everything below the lock is guarded by it.
+
+*/
+
+typedef struct {
+    int             listener;
+    int             port;
+    pthread_t       acceptor;
+    pthread_mutex_t lock;
+    int             accepted;        /* CONNECTIONS ACCEPTED */
+    int             active;          /* CONNECTIONS BEING SERVED */
+    int             requests;        /* REQUESTS ANSWERED */
+    int             asked_close;     /* REQUESTS THAT SENT "Connection: close" */
+} server_t;
+
+static server_t server;
+
+/*
+
+         pause_ms()
+	       ---
+	       sleeps for ms milliseconds.
+
+*/
+
+static void pause_ms(long ms) {
+
+    struct timespec delay;
+
+    delay.tv_sec  = ms / 1000;
+    delay.tv_nsec = (ms % 1000) * 1000000L;
+
+    nanosleep(&delay, NULL);
+
+}
+
+/*
+
+         send_all()
+	       ---
+	       sends text in full.
+
+*/
+
+static int send_all(int fd, const char* text) {
+
+    size_t  length = strlen(text);
+    size_t  sent   = 0;
+    ssize_t n;
+
+    while (sent < length) {
+
+        n = send(fd, text + sent, length - sent, 0);
+
+        if (n <= 0) {
+
+            return 0;
+
+        }
+
+        sent += (size_t)n;
+
+    }
+
+    return 1;
+
+}
+
+/*
+
+         read_head()
+	       ---
+	       reads one request head through its blank line.
+	       the requests here have no body. returns 0 at
+	       end of stream.
+
+*/
+
+static int read_head(int fd, char* head, size_t size) {
+
+    size_t  length = 0;
+    ssize_t n;
+
+    while (length + 1 < size) {
+
+        n = recv(fd, head + length, 1, 0);
+
+        if (n <= 0) {
+
+            return 0;
+
+        }
+
+        length++;
+        head[length] = '\0';
+
+        if (length >= 4 && memcmp(head + length - 4, "\r\n\r\n", 4) == 0) {
+
+            return 1;
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+/*
+
+         serve_connection()
+	       ---
+	       answers requests on one connection by path:
+
+	       /small    Content-Length body "hello"
+	       /chunked  the same body in two chunks
+	       /close    "Connection: close", then closes
+	       /drop     a kept-alive answer, then closes
+	       /eof      a body delimited by closing
+
+*/
+
+static void* serve_connection(void* arg) {
+
+    int   fd = (int)(long)arg;
+    char  head[TEST_HEAD_SIZE];
+    int   keep;
+
+    for (;;) {
+
+        if (!read_head(fd, head, sizeof(head))) {
+
+            break;
+
+        }
+
+        keep = strstr(head, "Connection: close") == NULL;
+
+        pthread_mutex_lock(&server.lock);
+        server.requests++;
+
+        if (!keep) {
+
+            server.asked_close++;
+
+        }
+
+        pthread_mutex_unlock(&server.lock);
+
+        if (strncmp(head, "GET /chunked ", 13) == 0) {
+
+            send_all(fd, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                         "3;part=1\r\nhel\r\n2\r\nlo\r\n0\r\nX-Trailer: yes\r\n\r\n");
+
+        } else if (strncmp(head, "GET /close ", 11) == 0) {
+
+            send_all(fd, "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 5\r\n\r\nhello");
+            keep = 0;
+
+        } else if (strncmp(head, "GET /drop ", 10) == 0) {
+
+            send_all(fd, "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello");
+            keep = 0;
+
+        } else if (strncmp(head, "GET /eof ", 9) == 0) {
+
+            send_all(fd, "HTTP/1.1 200 OK\r\n\r\nhello");
+            keep = 0;
+
+        } else {
+
+            send_all(fd, "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello");
+
+        }
+
+        if (!keep) {
+
+            break;
+
+        }
+
+    }
+
+    close(fd);
+
+    pthread_mutex_lock(&server.lock);
+    server.active--;
+    pthread_mutex_unlock(&server.lock);
+
+    return NULL;
+
+}
+
+/*
+
+         accept_connections()
+	       ---
+	       acceptor thread; runs until the listener is
+	       shut down.
+
+*/
+
+static void* accept_connections(void* arg) {
+
+    pthread_t thread;
+    int       fd;
+
+    (void)arg;
+
+    while ((fd = accept(server.listener, NULL, NULL)) >= 0) {
+
+        pthread_mutex_lock(&server.lock);
+        server.accepted++;
+        server.active++;
+        pthread_mutex_unlock(&server.lock);
+
+        if (pthread_create(&thread, NULL, serve_connection, (void*)(long)fd) != 0) {
+
+            close(fd);
+
+            pthread_mutex_lock(&server.lock);
+            server.active--;
+            pthread_mutex_unlock(&server.lock);
+
+            continue;
+
+        }
+
+        pthread_detach(thread);
+
+    }
+
+    return NULL;
+
+}
+
+/*
+
+         server_start()
+	       ---
+	       listens on an ephemeral loopback port.
+
+*/
+
+static int server_start(void) {
+
+    struct sockaddr_in address;
+    socklen_t          length = sizeof(address);
+
+    memset(&server, 0, sizeof(server));
+
+    pthread_mutex_init(&server.lock, NULL);
+
+    server.listener = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (server.listener < 0 ||
+        bind(server.listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(server.listener, 128) != 0 ||
+        getsockname(server.listener, (struct sockaddr*)&address, &length) != 0) {
+
+        return 0;
+
+    }
+
+    server.port = ntohs(address.sin_port);
+
+    return pthread_create(&server.acceptor, NULL, accept_connections, NULL) == 0;
+
+}
+
+/*
+
+         server_settle()
+	       ---
+	       waits up to five seconds for every connection
+	       to be closed, so the counters are final.
+
+*/
+
+static int server_settle(void) {
+
+    int waited;
+    int active = 1;
+
+    for (waited = 0; waited < 500 && active; waited++) {
+
+        pthread_mutex_lock(&server.lock);
+        active = server.active;
+        pthread_mutex_unlock(&server.lock);
+
+        if (active) {
+
+            pause_ms(10);
+
+        }
+
+    }
+
+    return !active;
+
+}
+
+/*
+
+         server_reset()
+	       ---
+	       clears the counters once the last client's
+	       connections are gone.
+
+*/
+
+static void server_reset(void) {
+
+    server_settle();
+
+    pthread_mutex_lock(&server.lock);
+
+    server.accepted    = 0;
+    server.requests    = 0;
+    server.asked_close = 0;
+
+    pthread_mutex_unlock(&server.lock);
+
+}
+
+/*
+
+         server_accepted()
+	       ---
+	       connections accepted since the last reset.
+
+*/
+
+static int server_accepted(void) {
+
+    int accepted;
+
+    pthread_mutex_lock(&server.lock);
+    accepted = server.accepted;
+    pthread_mutex_unlock(&server.lock);
+
+    return accepted;
+
+}
+
+/*
+
+         server_stop()
+	       ---
+	       stops accepting and waits for the connections.
+
+*/
+
+static void server_stop(void) {
+
+    shutdown(server.listener, SHUT_RDWR);
+    close(server.listener);
+    pthread_join(server.acceptor, NULL);
+
+    server_settle();
+
+    pthread_mutex_destroy(&server.lock);
+
+}
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         now_ms()
+	       ---
+	       monotonic milliseconds.
+
+*/
+
+static double now_ms(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+
+}
+
+/*
+
+         get()
+	       ---
+	       one GET of path; whether it answered 200 with
+	       "hello".
+
+*/
+
+static int get(commc_http_client_t* client, const char* path) {
+
+    commc_http_request_t*  request  = NULL;
+    commc_http_response_t* response = NULL;
+    char                   url[128];
+    int                    ok       = 0;
+
+    sprintf(url, "http://127.0.0.1:%d%s", server.port, path);
+
+    if (commc_http_request_create(&request) == COMMC_SUCCESS &&
+        commc_http_response_create(&response) == COMMC_SUCCESS &&
+        commc_http_request_set_url(request, url) == COMMC_SUCCESS &&
+        commc_http_client_execute(client, request, response) == COMMC_SUCCESS) {
+
+        ok = response->status_code == 200 && response->body_length == 5 &&
+             memcmp(response->body, "hello", 5) == 0;
+
+    }
+
+    commc_http_response_destroy(response);
+    commc_http_request_destroy(request);
+
+    return ok;
+
+}
+
+/*
+
+         get_many()
+	       ---
+	       count GETs of path; how many succeeded.
+
+*/
+
+static int get_many(commc_http_client_t* client, const char* path, int count) {
+
+    int ok = 0;
+    int i;
+
+    for (i = 0; i < count; i++) {
+
+        ok += get(client, path);
+
+    }
+
+    return ok;
+
+}
+
+/*
+	==================================
+             --- TESTS ---
+	==================================
+*/
+
+/*
+
+         test_reuse()
+	       ---
+	       Content-Length and chunked responses, in any
+	       mix, leave the connection ready for the next
+	       request.
+
+*/
+
+static void test_reuse(void) {
+
+    commc_http_client_t* client = NULL;
+    int                  i;
+    int                  ok     = 0;
+
+    server_reset();
+
+    if (commc_http_client_create(&client) != COMMC_SUCCESS) {
+
+        CHECK(0, "client created");
+        return;
+
+    }
+
+    CHECK(get_many(client, "/small", TEST_REQUESTS) == TEST_REQUESTS, "every sized GET succeeds");
+    CHECK(server_accepted() == 1, "sized responses share one connection");
+
+    for (i = 0; i < TEST_REQUESTS; i++) {
+
+        ok += get(client, i % 2 ? "/chunked" : "/small");
+
+    }
+
+    CHECK(ok == TEST_REQUESTS, "every mixed GET succeeds");
+    CHECK(server_accepted() == 1, "chunked responses keep the connection");
+
+    commc_http_client_destroy(client);
+
+    server_settle();
+
+    CHECK(server.asked_close == 0, "no request asked to close");
+
+}
+
+/*
+
+         test_not_reusable()
+	       ---
+	       responses that end the connection cost the
+	       next request a new one.
+
+*/
+
+static void test_not_reusable(void) {
+
+    commc_http_client_t* client = NULL;
+
+    server_reset();
+
+    if (commc_http_client_create(&client) != COMMC_SUCCESS) {
+
+        CHECK(0, "client created");
+        return;
+
+    }
+
+    CHECK(get(client, "/small"), "first GET");
+    CHECK(get(client, "/close"), "GET answered with Connection: close");
+    CHECK(get(client, "/small"), "GET after Connection: close");
+    CHECK(server_accepted() == 2, "Connection: close is honoured");
+
+    CHECK(get(client, "/eof"), "GET with a body read to end of stream");
+    CHECK(get(client, "/small"), "GET after a close-delimited body");
+    CHECK(server_accepted() == 3, "close-delimited body ends the connection");
+
+    commc_http_client_destroy(client);
+
+}
+
+/*
+
+         test_stale_retry()
+	       ---
+	       the server closes a connection the client has
+	       parked; the next GET fails on it and is retried
+	       once on a new connection.
+
+*/
+
+static void test_stale_retry(void) {
+
+    commc_http_client_t* client = NULL;
+
+    server_reset();
+
+    if (commc_http_client_create(&client) != COMMC_SUCCESS) {
+
+        CHECK(0, "client created");
+        return;
+
+    }
+
+    CHECK(get(client, "/drop"), "GET whose connection the server then drops");
+
+    pause_ms(50);
+
+    CHECK(get(client, "/small"), "GET over the dropped connection is retried");
+    CHECK(get(client, "/small"), "GET after the retry");
+    CHECK(server_accepted() == 2, "retry opened one connection and kept it");
+
+    commc_http_client_destroy(client);
+
+}
+
+/*
+
+         test_disabled()
+	       ---
+	       with keep-alive off every request asks to
+	       close and gets its own connection.
+
+*/
+
+static void test_disabled(void) {
+
+    commc_http_client_t* client = NULL;
+
+    server_reset();
+
+    if (commc_http_client_create(&client) != COMMC_SUCCESS ||
+        commc_http_client_set_keep_alive(client, 0) != COMMC_SUCCESS) {
+
+        CHECK(0, "client created");
+        commc_http_client_destroy(client);
+        return;
+
+    }
+
+    CHECK(get_many(client, "/small", 20) == 20, "every GET succeeds");
+    CHECK(server_accepted() == 20, "one connection per request");
+
+    commc_http_client_destroy(client);
+
+    server_settle();
+
+    CHECK(server.asked_close == 20, "every request sends Connection: close");
+
+}
+
+/*
+
+         bench()
+	       ---
+	       requests per second for TEST_BENCH_REQUESTS
+	       small GETs.
+
+*/
+
+static double bench(int keep_alive) {
+
+    commc_http_client_t* client = NULL;
+    double               start;
+    double               elapsed;
+    int                  ok;
+
+    server_reset();
+
+    if (commc_http_client_create(&client) != COMMC_SUCCESS ||
+        commc_http_client_set_keep_alive(client, keep_alive) != COMMC_SUCCESS) {
+
+        CHECK(0, "client created");
+        commc_http_client_destroy(client);
+        return 0.0;
+
+    }
+
+    start   = now_ms();
+    ok      = get_many(client, "/small", TEST_BENCH_REQUESTS);
+    elapsed = now_ms() - start;
+
+    CHECK(ok == TEST_BENCH_REQUESTS, "every benchmark GET succeeds");
+
+    printf("  keep-alive %s: %d connections\n", keep_alive ? "on" : "off", server_accepted());
+
+    commc_http_client_destroy(client);
+
+    return elapsed > 0.0 ? ok * 1000.0 / elapsed : 0.0;
+
+}
+
+#endif
+
+/*
+	==================================
+             --- MAIN ---
+	==================================
+*/
+
+int main(void) {
+
+#ifndef _WIN32
+    double kept;
+    double fresh;
+#endif
+
+    printf("--- HTTP KEEP-ALIVE TESTS ---\n");
+
+#ifdef _WIN32
+    printf("SKIPPED: the test server needs POSIX threads\n");
+    return 0;
+#else
+    if (!server_start()) {
+
+        printf("FAILED: could not start the loopback server\n");
+        return 1;
+
+    }
+
+    printf("reuse across response framings...\n");
+    test_reuse();
+
+    printf("responses that end the connection...\n");
+    test_not_reusable();
+
+    printf("retry on a dropped idle connection...\n");
+    test_stale_retry();
+
+    printf("keep-alive disabled...\n");
+    test_disabled();
+
+    printf("small requests with and without reuse...\n");
+    kept  = bench(1);
+    fresh = bench(0);
+
+    printf("  %d GETs: %.0f/s kept alive, %.0f/s with a connection each\n",
+           TEST_BENCH_REQUESTS, kept, fresh);
+
+    server_stop();
+
+    if (failures > 0) {
+
+        printf("%d HTTP KEEP-ALIVE CHECKS FAILED\n", failures);
+        return 1;
+
+    }
+
+    printf("ALL HTTP KEEP-ALIVE TESTS PASSED\n");
+    return 0;
+#endif
+}
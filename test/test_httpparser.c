@@ -0,0 +1,588 @@
+/*
+   ===================================
+   T E S T _ H T T P P A R S E R . C
+   HTTP/1.X HEAD PARSER TESTS
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    checks commc_http_parser on whole request and
+	    response heads, then feeds the same heads one
+	    growing prefix at a time and cut in two at every
+	    offset: each must block until the blank line and
+	    then parse exactly as the whole head did, with
+	    every view pointing into the caller's buffer.
+
+	    malformed heads must fail, also when they arrive
+	    in pieces. a last case parses a realistic browser
+	    request and a realistic response over and over and
+	    prints the throughput; it is not checked.
+
+	    build httpparser.c with COMMC_HTTP_PARSER_NO_SSE2
+	    as well to cover the word-wide scanner.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "commc/httpparser.h"
+#include "commc/error.h"
+
+#define TEST_BENCH_ROUNDS     200000
+
+static int failures = 0;
+
+#define CHECK(condition, message)                                       \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            printf("  FAILED: %s (line %d)\n", (message), __LINE__);    \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+/*
+	==================================
+             --- HEADS ---
+	==================================
+*/
+
+/*
+
+         request_lines / response_lines
+	       ---
+	       a browser-like request and a response with bare
+	       LF line ends. C89 caps string literals well below
+	       the request's size, so the heads are joined at
+	       start-up.
+
+*/
+
+static const char* const request_lines[] = {
+    "GET /search?q=commc&lang=en HTTP/1.1\r\n",
+    "Host: www.example.com\r\n",
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+    "(KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n",
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+    "image/avif,image/webp,*/*;q=0.8\r\n",
+    "Accept-Language: en-US,en;q=0.9\r\n",
+    "Accept-Encoding: gzip, deflate, br\r\n",
+    "Cookie: session=8f2c1a9e47b3d6e0; theme=dark; tracking=off; "
+    "consent=2025-01-01T00:00:00Z\r\n",
+    "Referer: https://www.example.com/\r\n",
+    "Empty:\r\n",
+    "Padded: \t  value with\ttab inside \t \r\n",
+    "Connection: keep-alive\r\n",
+    "\r\n",
+    NULL
+};
+
+static const char* const response_lines[] = {
+    "HTTP/1.0 404 Not  Found\tHere\n",
+    "Content-Type: text/html; charset=utf-8\n",
+    "Content-Length: 1234\n",
+    "Cache-Control: private, max-age=0, no-cache, no-store, must-revalidate\n",
+    "\n",
+    NULL
+};
+
+static char   request_head[1024];
+static size_t request_length;
+static char   response_head[512];
+static size_t response_length;
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         join_lines()
+	       ---
+	       concatenates lines into head and returns the
+	       length.
+
+*/
+
+static size_t join_lines(const char* const* lines, char* head) {
+
+    size_t length = 0;
+
+    while (*lines) {
+
+        strcpy(head + length, *lines);
+        length += strlen(*lines);
+        lines++;
+
+    }
+
+    return length;
+
+}
+
+/*
+
+         inside()
+	       ---
+	       whether a view lies within the buffer.
+
+*/
+
+static int inside(const char* view, size_t length, const char* buffer, size_t size) {
+
+    return view >= buffer && view + length <= buffer + size;
+
+}
+
+/*
+
+         check_request()
+	       ---
+	       the parts of request_head, parsed out of buffer.
+
+*/
+
+static int check_request(const commc_http_parser_t* parser, const char* buffer) {
+
+    const commc_http_header_view_t* header;
+    size_t                          i;
+    int                             ok = 1;
+
+    ok &= parser->head_length == request_length;
+    ok &= commc_http_parser_view_equals(parser->method, parser->method_length, "GET");
+    ok &= parser->target_length == 23 && memcmp(parser->target, "/search?q=commc&lang=en", 23) == 0;
+    ok &= parser->minor_version == 1;
+    ok &= parser->header_count == 10;
+
+    for (i = 0; i < parser->header_count; i++) {
+
+        ok &= inside(parser->headers[i].name, parser->headers[i].name_length,
+                     buffer, parser->head_length);
+        ok &= inside(parser->headers[i].value, parser->headers[i].value_length,
+                     buffer, parser->head_length);
+
+    }
+
+    ok &= inside(parser->method, parser->method_length, buffer, parser->head_length);
+    ok &= inside(parser->target, parser->target_length, buffer, parser->head_length);
+
+    header = commc_http_parser_find_header(parser, "HOST");
+    ok &= header && commc_http_parser_view_equals(header->value, header->value_length, "www.example.com");
+
+    header = commc_http_parser_find_header(parser, "empty");
+    ok &= header && header->value_length == 0;
+
+    header = commc_http_parser_find_header(parser, "padded");
+    ok &= header && header->value_length == 21 &&
+          memcmp(header->value, "value with\ttab inside", 21) == 0;
+
+    header = commc_http_parser_find_header(parser, "user-agent");
+    ok &= header && header->value_length == 97;
+
+    ok &= commc_http_parser_find_header(parser, "Content-Length") == NULL;
+
+    return ok;
+
+}
+
+/*
+
+         check_response()
+	       ---
+	       the parts of response_head.
+
+*/
+
+static int check_response(const commc_http_parser_t* parser) {
+
+    const commc_http_header_view_t* header;
+    int                             ok = 1;
+
+    ok &= parser->head_length == response_length;
+    ok &= parser->minor_version == 0;
+    ok &= parser->status_code == 404;
+    ok &= parser->reason_length == 15 && memcmp(parser->reason, "Not  Found\tHere", 15) == 0;
+    ok &= parser->header_count == 3;
+
+    header = commc_http_parser_find_header(parser, "content-length");
+    ok &= header && header->value_length == 4 && memcmp(header->value, "1234", 4) == 0;
+
+    return ok;
+
+}
+
+/*
+
+         check_head()
+	       ---
+	       check_request() or check_response() by type.
+
+*/
+
+static int check_head(const commc_http_parser_t* parser, const char* buffer) {
+
+    return parser->type == COMMC_HTTP_PARSER_REQUEST ?
+           check_request(parser, buffer) : check_response(parser);
+
+}
+
+/*
+
+         copy_of()
+	       ---
+	       a heap copy of exactly length bytes, so ASan
+	       sees any read past what was passed.
+
+*/
+
+static char* copy_of(const char* head, size_t length) {
+
+    char* copy = (char*)malloc(length);
+
+    if (copy) {
+
+        memcpy(copy, head, length);
+
+    }
+
+    return copy;
+
+}
+
+/*
+	==================================
+             --- TESTS ---
+	==================================
+*/
+
+/*
+
+         test_whole()
+	       ---
+	       each head in one call, with body bytes after it
+	       that the parser must leave alone.
+
+*/
+
+static void test_whole(void) {
+
+    commc_http_parser_t parser;
+    char                buffer[2048];
+    size_t              length;
+
+    length = request_length;
+    memcpy(buffer, request_head, length);
+    memcpy(buffer + length, "BODY", 4);
+
+    commc_http_parser_init(&parser, COMMC_HTTP_PARSER_REQUEST);
+
+    CHECK(commc_http_parser_execute(&parser, buffer, length + 4) == COMMC_SUCCESS, "request parsed");
+    CHECK(check_request(&parser, buffer), "request parts");
+
+    length = response_length;
+    memcpy(buffer, response_head, length);
+    memcpy(buffer + length, "BODY", 4);
+
+    commc_http_parser_init(&parser, COMMC_HTTP_PARSER_RESPONSE);
+
+    CHECK(commc_http_parser_execute(&parser, buffer, length + 4) == COMMC_SUCCESS, "response parsed");
+    CHECK(check_response(&parser), "response parts with bare LF");
+
+}
+
+/*
+
+         test_growing()
+	       ---
+	       one parser sees every prefix of the head in
+	       turn, as a reader appending a byte per receive
+	       would hand it over.
+
+*/
+
+static void test_growing(commc_http_parser_type_t type, const char* head, size_t length) {
+
+    commc_http_parser_t parser;
+    char*               buffer = copy_of(head, length);
+    commc_error_t       result = COMMC_ERROR_WOULD_BLOCK;
+    size_t              seen;
+    int                 blocked = 1;
+
+    if (!buffer) {
+
+        CHECK(0, "buffer allocated");
+        return;
+
+    }
+
+    commc_http_parser_init(&parser, type);
+
+    for (seen = 0; seen < length; seen++) {
+
+        result = commc_http_parser_execute(&parser, buffer, seen);
+
+        if (result != COMMC_ERROR_WOULD_BLOCK) {
+
+            blocked = 0;
+
+        }
+
+    }
+
+    CHECK(blocked, "every short prefix blocks");
+
+    result = commc_http_parser_execute(&parser, buffer, length);
+
+    CHECK(result == COMMC_SUCCESS, "full head parses after the prefixes");
+    CHECK(result == COMMC_SUCCESS && check_head(&parser, buffer), "parts match the whole parse");
+
+    free(buffer);
+
+}
+
+/*
+
+         test_split()
+	       ---
+	       a fresh parser per offset: the head cut in two
+	       there, first part then all of it.
+
+*/
+
+static void test_split(commc_http_parser_type_t type, const char* head, size_t length) {
+
+    commc_http_parser_t parser;
+    char*               buffer = copy_of(head, length);
+    size_t              cut;
+    int                 blocked = 1;
+    int                 matched = 1;
+
+    if (!buffer) {
+
+        CHECK(0, "buffer allocated");
+        return;
+
+    }
+
+    for (cut = 1; cut < length; cut++) {
+
+        commc_http_parser_init(&parser, type);
+
+        if (commc_http_parser_execute(&parser, buffer, cut) != COMMC_ERROR_WOULD_BLOCK) {
+
+            blocked = 0;
+
+        }
+
+        if (commc_http_parser_execute(&parser, buffer, length) != COMMC_SUCCESS ||
+            !check_head(&parser, buffer)) {
+
+            matched = 0;
+
+        }
+
+    }
+
+    CHECK(blocked, "the first part blocks at every cut");
+    CHECK(matched, "the rest completes the head at every cut");
+
+    free(buffer);
+
+}
+
+/*
+
+         expect_error()
+	       ---
+	       head must fail with expected, whole and again
+	       when it arrives a byte at a time.
+
+*/
+
+static int expect_error(commc_http_parser_type_t type, const char* head, commc_error_t expected) {
+
+    commc_http_parser_t parser;
+    size_t              length = strlen(head);
+    size_t              seen;
+    commc_error_t       result = COMMC_SUCCESS;
+
+    commc_http_parser_init(&parser, type);
+
+    if (commc_http_parser_execute(&parser, head, length) != expected) {
+
+        return 0;
+
+    }
+
+    commc_http_parser_init(&parser, type);
+
+    for (seen = 1; seen <= length; seen++) {
+
+        result = commc_http_parser_execute(&parser, head, seen);
+
+        if (result != COMMC_ERROR_WOULD_BLOCK) {
+
+            break;
+
+        }
+
+    }
+
+    return result == expected;
+
+}
+
+/*
+
+         test_malformed()
+	       ---
+	       bad start lines, bad fields and too many
+	       fields.
+
+*/
+
+static void test_malformed(void) {
+
+    char   many[4096];
+    size_t length;
+    int    i;
+
+    CHECK(expect_error(COMMC_HTTP_PARSER_REQUEST, "GET / HTTP/2.0\r\n\r\n", COMMC_FORMAT_ERROR),
+          "unsupported version");
+    CHECK(expect_error(COMMC_HTTP_PARSER_REQUEST, "GET  / HTTP/1.1\r\n\r\n", COMMC_FORMAT_ERROR),
+          "empty target");
+    CHECK(expect_error(COMMC_HTTP_PARSER_REQUEST, "GET / HTTP/1.1\r\nHost : x\r\n\r\n", COMMC_FORMAT_ERROR),
+          "space before the colon");
+    CHECK(expect_error(COMMC_HTTP_PARSER_REQUEST, "GET / HTTP/1.1\r\nA: b\r\n  folded\r\n\r\n", COMMC_FORMAT_ERROR),
+          "folded header line");
+    CHECK(expect_error(COMMC_HTTP_PARSER_REQUEST, "GET / HTTP/1.1\r\nA: b\001c\r\n\r\n", COMMC_FORMAT_ERROR),
+          "control character in a value");
+    CHECK(expect_error(COMMC_HTTP_PARSER_REQUEST, "GET / HTTP/1.1\rX\r\n\r\n", COMMC_FORMAT_ERROR),
+          "bare CR");
+    CHECK(expect_error(COMMC_HTTP_PARSER_RESPONSE, "HTTP/1.1 2x0 OK\r\n\r\n", COMMC_FORMAT_ERROR),
+          "non-digit status");
+    CHECK(expect_error(COMMC_HTTP_PARSER_RESPONSE, "HTTP/1.1 200OK\r\n\r\n", COMMC_FORMAT_ERROR),
+          "reason without a space");
+
+    strcpy(many, "GET / HTTP/1.1\r\n");
+    length = strlen(many);
+
+    for (i = 0; i <= COMMC_HTTP_PARSER_MAX_HEADERS; i++) {
+
+        length += (size_t)sprintf(many + length, "X-%d: v\r\n", i);
+
+    }
+
+    strcpy(many + length, "\r\n");
+
+    CHECK(expect_error(COMMC_HTTP_PARSER_REQUEST, many, COMMC_ERROR_BUFFER_TOO_SMALL),
+          "one field too many");
+
+}
+
+/*
+
+         bench()
+	       ---
+	       parses head rounds times and returns GB/s.
+
+*/
+
+static double bench(commc_http_parser_type_t type, const char* head, size_t length, long rounds) {
+
+    commc_http_parser_t parser;
+    char*               buffer = copy_of(head, length);
+    clock_t             start;
+    double              seconds;
+    long                ok     = 0;
+    long                i;
+
+    if (!buffer) {
+
+        CHECK(0, "buffer allocated");
+        return 0.0;
+
+    }
+
+    start = clock();
+
+    for (i = 0; i < rounds; i++) {
+
+        commc_http_parser_init(&parser, type);
+
+        if (commc_http_parser_execute(&parser, buffer, length) == COMMC_SUCCESS) {
+
+            ok += (long)parser.header_count;
+
+        }
+
+    }
+
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    CHECK(ok == rounds * (long)parser.header_count, "every benchmark parse succeeds");
+
+    free(buffer);
+
+    return seconds > 0.0 ? (double)length * (double)rounds / seconds / 1e9 : 0.0;
+
+}
+
+/*
+	==================================
+             --- MAIN ---
+	==================================
+*/
+
+int main(void) {
+
+    printf("--- HTTP PARSER TESTS ---\n");
+
+    request_length  = join_lines(request_lines, request_head);
+    response_length = join_lines(response_lines, response_head);
+
+    printf("whole heads...\n");
+    test_whole();
+
+    printf("growing prefixes...\n");
+    test_growing(COMMC_HTTP_PARSER_REQUEST, request_head, request_length);
+    test_growing(COMMC_HTTP_PARSER_RESPONSE, response_head, response_length);
+
+    printf("split at every offset...\n");
+    test_split(COMMC_HTTP_PARSER_REQUEST, request_head, request_length);
+    test_split(COMMC_HTTP_PARSER_RESPONSE, response_head, response_length);
+
+    printf("malformed heads...\n");
+    test_malformed();
+
+    printf("throughput...\n");
+    printf("  request (%lu bytes): %.2f GB/s\n", (unsigned long)(request_length),
+           bench(COMMC_HTTP_PARSER_REQUEST, request_head, request_length, TEST_BENCH_ROUNDS));
+    printf("  response (%lu bytes): %.2f GB/s\n", (unsigned long)(response_length),
+           bench(COMMC_HTTP_PARSER_RESPONSE, response_head, response_length, TEST_BENCH_ROUNDS));
+
+    if (failures > 0) {
+
+        printf("%d HTTP PARSER CHECKS FAILED\n", failures);
+        return 1;
+
+    }
+
+    printf("ALL HTTP PARSER TESTS PASSED\n");
+    return 0;
+
+}
@@ -0,0 +1,1184 @@
+/*
+   ===================================
+   T E S T _ H T T P S E R V E R . C
+   EMBEDDED HTTP SERVER TESTS
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    runs commc_http_server on a loopback port with its
+	    context's loop on a thread of its own, and talks to
+	    it over plain blocking sockets: routes and queries,
+	    keep-alive, pipelined requests answered in order,
+	    Content-Length and chunked bodies split across
+	    sends, the 404/413/431/500 answers, HTTP/1.0
+	    closing, and files sent with sendfile through
+	    respond_file() and serve_directory().
+
+	    a last case is a small load generator: client
+	    threads on kept-alive connections send requests
+	    back to back and the requests per second and
+	    latency percentiles are printed, not checked.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L    /* CLOCK_GETTIME, NANOSLEEP, PTHREADS */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#include "commc/httpserver.h"
+#include "commc/async.h"
+#include "commc/error.h"
+
+#define TEST_MAX_HEAD         1024
+#define TEST_MAX_BODY         4096
+#define TEST_KEEPALIVE_ROUNDS 100
+#define TEST_PIPELINED        10
+#define TEST_FILE_NAME        "test_httpserver.tmp"
+#define TEST_FILE_SIZE        200003
+#define TEST_LOAD_CLIENTS     4
+#define TEST_LOAD_REQUESTS    2500         /* PER CLIENT */
+#define TEST_CLIENT_BUFFER    8192
+
+static int failures = 0;
+
+#define CHECK(condition, message)                                       \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            printf("  FAILED: %s (line %d)\n", (message), __LINE__);    \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+#ifndef _WIN32
+
+/*
+	==================================
+             --- SERVER ---
+	==================================
+*/
+
+/*
+
+         loop_t
+	       ---
+	       the server, its context and the thread running
+	       the context's loop.
+
+*/
+
+typedef struct {
+    commc_async_context_t* ctx;
+    commc_http_server_t*   server;
+    pthread_t              thread;
+    int                    port;
+} loop_t;
+
+static loop_t loop;
+
+/*
+
+         run_loop()
+	       ---
+	       loop thread: runs the context until stopped.
+
+*/
+
+static void* run_loop(void* arg) {
+
+    commc_async_run((commc_async_context_t*)arg);
+
+    return NULL;
+
+}
+
+/*
+
+         answer_hello()
+	       ---
+	       GET /hello: a fixed text body.
+
+*/
+
+static void answer_hello(commc_http_server_request_t* request, void* user_data) {
+
+    (void)user_data;
+
+    commc_http_server_respond(request, 200, "text/plain", "hello", 5);
+
+}
+
+/*
+
+         answer_path()
+	       ---
+	       GET under /p/: echoes the path, so pipelined
+	       answers can be told apart.
+
+*/
+
+static void answer_path(commc_http_server_request_t* request, void* user_data) {
+
+    (void)user_data;
+
+    commc_http_server_respond(request, 200, "text/plain", request->path, request->path_length);
+
+}
+
+/*
+
+         answer_query()
+	       ---
+	       /query: echoes the query string.
+
+*/
+
+static void answer_query(commc_http_server_request_t* request, void* user_data) {
+
+    (void)user_data;
+
+    commc_http_server_respond(request, 200, "text/plain", request->query, request->query_length);
+
+}
+
+/*
+
+         answer_echo()
+	       ---
+	       POST /echo: echoes the body, with a header of
+	       its own.
+
+*/
+
+static void answer_echo(commc_http_server_request_t* request, void* user_data) {
+
+    (void)user_data;
+
+    commc_http_server_add_header(request, "X-Echo", "yes");
+    commc_http_server_respond(request, 200, "application/octet-stream",
+                              request->body, request->body_length);
+
+}
+
+/*
+
+         answer_file()
+	       ---
+	       GET /file: the test file through sendfile.
+
+*/
+
+static void answer_file(commc_http_server_request_t* request, void* user_data) {
+
+    (void)user_data;
+
+    if (commc_http_server_respond_file(request, 200, NULL, TEST_FILE_NAME) != COMMC_SUCCESS) {
+
+        commc_http_server_respond(request, 500, NULL, NULL, 0);
+
+    }
+
+}
+
+/*
+
+         answer_nothing()
+	       ---
+	       /silent: returns without responding.
+
+*/
+
+static void answer_nothing(commc_http_server_request_t* request, void* user_data) {
+
+    (void)request;
+    (void)user_data;
+
+}
+
+/*
+
+         loop_start()
+	       ---
+	       creates the server with small limits, adds the
+	       routes, listens and starts the loop thread.
+
+*/
+
+static int loop_start(void) {
+
+    commc_http_server_config_t config;
+
+    memset(&loop, 0, sizeof(loop));
+
+    commc_http_server_config_init(&config);
+
+    config.max_head = TEST_MAX_HEAD;
+    config.max_body = TEST_MAX_BODY;
+
+    loop.ctx = commc_async_context_create(256, 100);
+
+    if (!loop.ctx ||
+        commc_http_server_create(&loop.server, loop.ctx, &config) != COMMC_SUCCESS) {
+
+        return 0;
+
+    }
+
+    if (commc_http_server_route(loop.server, "GET", "/hello", answer_hello, NULL) != COMMC_SUCCESS ||
+        commc_http_server_route(loop.server, "GET", "/p/*", answer_path, NULL) != COMMC_SUCCESS ||
+        commc_http_server_route(loop.server, "GET", "/query", answer_query, NULL) != COMMC_SUCCESS ||
+        commc_http_server_route(loop.server, "POST", "/echo", answer_echo, NULL) != COMMC_SUCCESS ||
+        commc_http_server_route(loop.server, "GET", "/file", answer_file, NULL) != COMMC_SUCCESS ||
+        commc_http_server_route(loop.server, NULL, "/silent", answer_nothing, NULL) != COMMC_SUCCESS ||
+        commc_http_server_serve_directory(loop.server, "/static/", ".") != COMMC_SUCCESS ||
+        commc_http_server_listen(loop.server, "127.0.0.1", 0) != COMMC_SUCCESS) {
+
+        return 0;
+
+    }
+
+    loop.port = commc_http_server_get_port(loop.server);
+
+    return pthread_create(&loop.thread, NULL, run_loop, loop.ctx) == 0;
+
+}
+
+/*
+
+         loop_stop()
+	       ---
+	       stops the loop, then destroys the server from
+	       outside its callbacks.
+
+*/
+
+static void loop_stop(void) {
+
+    commc_async_stop(loop.ctx);
+    pthread_join(loop.thread, NULL);
+
+    commc_http_server_destroy(loop.server);
+    commc_async_context_destroy(loop.ctx);
+
+}
+
+/*
+	==================================
+             --- CLIENT ---
+	==================================
+*/
+
+/*
+
+         client_t
+	       ---
+	       a blocking connection and the bytes received
+	       past the last response read.
+
+*/
+
+typedef struct {
+    int    fd;
+    char   buffer[TEST_CLIENT_BUFFER];
+    size_t length;
+} client_t;
+
+/*
+
+         client_open()
+	       ---
+	       connects to the server.
+
+*/
+
+static int client_open(client_t* client) {
+
+    struct sockaddr_in address;
+
+    client->length = 0;
+    client->fd     = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port        = htons((unsigned short)loop.port);
+
+    return client->fd >= 0 &&
+           connect(client->fd, (struct sockaddr*)&address, sizeof(address)) == 0;
+
+}
+
+/*
+
+         client_close()
+	       ---
+	       closes the connection.
+
+*/
+
+static void client_close(client_t* client) {
+
+    if (client->fd >= 0) {
+
+        close(client->fd);
+        client->fd = -1;
+
+    }
+
+}
+
+/*
+
+         client_send()
+	       ---
+	       sends length bytes of data in full.
+
+*/
+
+static int client_send(client_t* client, const char* data, size_t length) {
+
+    size_t  sent = 0;
+    ssize_t n;
+
+    while (sent < length) {
+
+        n = send(client->fd, data + sent, length - sent, 0);
+
+        if (n <= 0) {
+
+            return 0;
+
+        }
+
+        sent += (size_t)n;
+
+    }
+
+    return 1;
+
+}
+
+/*
+
+         send_text()
+	       ---
+	       client_send() for a NUL-terminated string.
+
+*/
+
+static int send_text(client_t* client, const char* text) {
+
+    return client_send(client, text, strlen(text));
+
+}
+
+/*
+
+         client_fill()
+	       ---
+	       receives more into the buffer; 0 at end of
+	       stream or when it is full.
+
+*/
+
+static int client_fill(client_t* client) {
+
+    ssize_t n;
+
+    if (client->length == sizeof(client->buffer)) {
+
+        return 0;
+
+    }
+
+    n = recv(client->fd, client->buffer + client->length,
+             sizeof(client->buffer) - client->length, 0);
+
+    if (n <= 0) {
+
+        return 0;
+
+    }
+
+    client->length += (size_t)n;
+
+    return 1;
+
+}
+
+/*
+
+         client_closed()
+	       ---
+	       whether the server closed the connection with
+	       nothing more to read.
+
+*/
+
+static int client_closed(client_t* client) {
+
+    return client->length == 0 && !client_fill(client);
+
+}
+
+/*
+
+         find_header()
+	       ---
+	       the value of header name in head (which ends in
+	       a blank line), or NULL. name is lower case.
+
+*/
+
+static const char* find_header(const char* head, size_t length, const char* name) {
+
+    size_t      name_length = strlen(name);
+    const char* line        = head;
+    const char* end         = head + length;
+    size_t      i;
+
+    while (line < end) {
+
+        for (i = 0; i < name_length && line + i < end; i++) {
+
+            char c = line[i];
+
+            if (c >= 'A' && c <= 'Z') {
+
+                c = (char)(c - 'A' + 'a');
+
+            }
+
+            if (c != name[i]) {
+
+                break;
+
+            }
+
+        }
+
+        if (i == name_length && line + i < end && line[i] == ':') {
+
+            line += i + 1;
+
+            while (*line == ' ') {
+
+                line++;
+
+            }
+
+            return line;
+
+        }
+
+        while (line < end && *line != '\n') {
+
+            line++;
+
+        }
+
+        line++;
+
+    }
+
+    return NULL;
+
+}
+
+/*
+
+         client_response()
+	       ---
+	       reads one response framed by Content-Length.
+	       the body (up to capacity bytes are kept) and
+	       header go to the caller; returns the status, or
+	       0 if the connection ended first.
+
+*/
+
+static int client_response(client_t* client, char* body, size_t capacity,
+                           size_t* body_length, char* head_copy, size_t head_capacity) {
+
+    char*       head_end = NULL;
+    const char* value;
+    size_t      head_length;
+    size_t      content_length;
+    size_t      taken;
+    size_t      got      = 0;
+    int         status;
+
+    for (;;) {
+
+        if (client->length >= 4) {
+
+            size_t i;
+
+            for (i = 0; i + 3 < client->length; i++) {
+
+                if (memcmp(client->buffer + i, "\r\n\r\n", 4) == 0) {
+
+                    head_end = client->buffer + i + 4;
+                    break;
+
+                }
+
+            }
+
+        }
+
+        if (head_end || !client_fill(client)) {
+
+            break;
+
+        }
+
+    }
+
+    if (!head_end || client->length < 12 || memcmp(client->buffer, "HTTP/1.", 7) != 0) {
+
+        return 0;
+
+    }
+
+    head_length = (size_t)(head_end - client->buffer);
+    status      = atoi(client->buffer + 9);
+    value       = find_header(client->buffer, head_length, "content-length");
+
+    content_length = value ? (size_t)strtoul(value, NULL, 10) : 0;
+
+    if (head_copy && head_capacity > 0) {
+
+        taken = head_length < head_capacity - 1 ? head_length : head_capacity - 1;
+        memcpy(head_copy, client->buffer, taken);
+        head_copy[taken] = '\0';
+
+    }
+
+    /* the body: what is buffered first, then straight from the socket */
+
+    memmove(client->buffer, head_end, client->length - head_length);
+    client->length -= head_length;
+
+    while (got < content_length) {
+
+        if (client->length == 0 && !client_fill(client)) {
+
+            return 0;
+
+        }
+
+        taken = content_length - got < client->length ? content_length - got : client->length;
+
+        if (body && got < capacity) {
+
+            memcpy(body + got, client->buffer, got + taken <= capacity ? taken : capacity - got);
+
+        }
+
+        memmove(client->buffer, client->buffer + taken, client->length - taken);
+        client->length -= taken;
+        got            += taken;
+
+    }
+
+    if (body_length) {
+
+        *body_length = content_length;
+
+    }
+
+    return status;
+
+}
+
+/*
+
+         exchange()
+	       ---
+	       sends request and reads one response into body,
+	       NUL-terminated. returns the status.
+
+*/
+
+static int exchange(client_t* client, const char* request, char* body, size_t capacity) {
+
+    size_t length = 0;
+    int    status;
+
+    if (!send_text(client, request)) {
+
+        return 0;
+
+    }
+
+    status = client_response(client, body, capacity - 1, &length, NULL, 0);
+
+    body[length < capacity - 1 ? length : capacity - 1] = '\0';
+
+    return status;
+
+}
+
+/*
+
+         now_us()
+	       ---
+	       monotonic microseconds.
+
+*/
+
+static double now_us(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec * 1000000.0 + (double)now.tv_nsec / 1000.0;
+
+}
+
+/*
+
+         pause_ms()
+	       ---
+	       sleeps for ms milliseconds.
+
+*/
+
+static void pause_ms(long ms) {
+
+    struct timespec delay;
+
+    delay.tv_sec  = ms / 1000;
+    delay.tv_nsec = (ms % 1000) * 1000000L;
+
+    nanosleep(&delay, NULL);
+
+}
+
+/*
+	==================================
+             --- TESTS ---
+	==================================
+*/
+
+/*
+
+         test_routes()
+	       ---
+	       routes, queries, unknown paths and handlers
+	       that forget to respond.
+
+*/
+
+static void test_routes(void) {
+
+    client_t client;
+    char     body[256];
+
+    if (!client_open(&client)) {
+
+        CHECK(0, "client connected");
+        client_close(&client);
+        return;
+
+    }
+
+    CHECK(exchange(&client, "GET /hello HTTP/1.1\r\nHost: t\r\n\r\n", body, sizeof(body)) == 200 &&
+          strcmp(body, "hello") == 0, "exact route");
+    CHECK(exchange(&client, "GET /p/a/b HTTP/1.1\r\nHost: t\r\n\r\n", body, sizeof(body)) == 200 &&
+          strcmp(body, "/p/a/b") == 0, "prefix route");
+    CHECK(exchange(&client, "GET /query?x=1&y=2 HTTP/1.1\r\nHost: t\r\n\r\n", body, sizeof(body)) == 200 &&
+          strcmp(body, "x=1&y=2") == 0, "query split from the path");
+    CHECK(exchange(&client, "GET /missing HTTP/1.1\r\nHost: t\r\n\r\n", body, sizeof(body)) == 404,
+          "unknown path is 404");
+    CHECK(exchange(&client, "POST /hello HTTP/1.1\r\nHost: t\r\nContent-Length: 0\r\n\r\n",
+                   body, sizeof(body)) == 404, "route matches the method");
+    CHECK(exchange(&client, "GET /silent HTTP/1.1\r\nHost: t\r\n\r\n", body, sizeof(body)) == 500,
+          "unanswered request is 500");
+    CHECK(exchange(&client, "GET /hello HTTP/1.1\r\nHost: t\r\n\r\n", body, sizeof(body)) == 200,
+          "connection still usable");
+
+    client_close(&client);
+
+}
+
+/*
+
+         test_keepalive_and_pipelining()
+	       ---
+	       many requests on one connection, then a batch
+	       sent at once and answered in order.
+
+*/
+
+static void test_keepalive_and_pipelining(void) {
+
+    client_t client;
+    char     batch[TEST_PIPELINED * 64];
+    char     body[64];
+    char     expected[16];
+    size_t   length = 0;
+    size_t   body_length;
+    int      ok     = 0;
+    int      i;
+
+    if (!client_open(&client)) {
+
+        CHECK(0, "client connected");
+        client_close(&client);
+        return;
+
+    }
+
+    for (i = 0; i < TEST_KEEPALIVE_ROUNDS; i++) {
+
+        ok += exchange(&client, "GET /hello HTTP/1.1\r\nHost: t\r\n\r\n", body, sizeof(body)) == 200;
+
+    }
+
+    CHECK(ok == TEST_KEEPALIVE_ROUNDS, "every request on one connection answered");
+
+    for (i = 0; i < TEST_PIPELINED; i++) {
+
+        length += (size_t)sprintf(batch + length, "GET /p/%d HTTP/1.1\r\nHost: t\r\n\r\n", i);
+
+    }
+
+    CHECK(client_send(&client, batch, length), "pipelined batch sent");
+
+    ok = 0;
+
+    for (i = 0; i < TEST_PIPELINED; i++) {
+
+        sprintf(expected, "/p/%d", i);
+
+        if (client_response(&client, body, sizeof(body), &body_length, NULL, 0) == 200 &&
+            body_length == strlen(expected) && memcmp(body, expected, body_length) == 0) {
+
+            ok++;
+
+        }
+
+    }
+
+    CHECK(ok == TEST_PIPELINED, "pipelined requests answered in order");
+
+    client_close(&client);
+
+}
+
+/*
+
+         test_bodies()
+	       ---
+	       Content-Length and chunked bodies arriving in
+	       several sends.
+
+*/
+
+static void test_bodies(void) {
+
+    static const char head[]    = "POST /echo HTTP/1.1\r\nHost: t\r\nContent-Length: 11\r\n\r\n";
+    static const char chunked[] = "POST /echo HTTP/1.1\r\nHost: t\r\nTransfer-Encoding: chunked\r\n\r\n";
+
+    client_t client;
+    char     body[64];
+    char     response_head[512];
+    size_t   body_length = 0;
+    int      status;
+
+    if (!client_open(&client)) {
+
+        CHECK(0, "client connected");
+        client_close(&client);
+        return;
+
+    }
+
+    client_send(&client, head, sizeof(head) - 1 - 10);
+    pause_ms(20);
+    client_send(&client, head + sizeof(head) - 1 - 10, 10);
+    send_text(&client, "hello");
+    pause_ms(20);
+    send_text(&client, " world");
+
+    status = client_response(&client, body, sizeof(body), &body_length,
+                             response_head, sizeof(response_head));
+
+    CHECK(status == 200 && body_length == 11 && memcmp(body, "hello world", 11) == 0,
+          "split Content-Length body echoed");
+    CHECK(find_header(response_head, strlen(response_head), "x-echo") != NULL,
+          "handler header sent");
+
+    client_send(&client, chunked, sizeof(chunked) - 1);
+    send_text(&client, "5;ext=1\r\nhel");
+    pause_ms(20);
+    send_text(&client, "lo\r\n6\r\n worl");
+    pause_ms(20);
+    send_text(&client, "d\r\n0\r\nX-Trailer: 1\r\n\r\n");
+
+    status = client_response(&client, body, sizeof(body), &body_length, NULL, 0);
+
+    CHECK(status == 200 && body_length == 11 && memcmp(body, "hello world", 11) == 0,
+          "split chunked body joined");
+
+    client_close(&client);
+
+}
+
+/*
+
+         test_limits()
+	       ---
+	       oversized heads and bodies are refused and the
+	       connection closed; HTTP/1.0 closes after one
+	       answer.
+
+*/
+
+static void test_limits(void) {
+
+    client_t client;
+    char     request[TEST_MAX_HEAD * 2 + 128];
+    char     body[128];
+    size_t   length;
+
+    if (client_open(&client)) {
+
+        length = (size_t)sprintf(request, "GET /hello HTTP/1.1\r\nHost: t\r\nX-Big: ");
+        memset(request + length, 'a', TEST_MAX_HEAD * 2);
+        length += TEST_MAX_HEAD * 2;
+        memcpy(request + length, "\r\n\r\n", 5);
+
+        CHECK(exchange(&client, request, body, sizeof(body)) == 431, "oversized head is 431");
+        CHECK(client_closed(&client), "connection closed after 431");
+
+    }
+
+    client_close(&client);
+
+    if (client_open(&client)) {
+
+        sprintf(request, "POST /echo HTTP/1.1\r\nHost: t\r\nContent-Length: %d\r\n\r\n", TEST_MAX_BODY + 1);
+
+        CHECK(exchange(&client, request, body, sizeof(body)) == 413, "oversized body is 413");
+        CHECK(client_closed(&client), "connection closed after 413");
+
+    }
+
+    client_close(&client);
+
+    if (client_open(&client)) {
+
+        CHECK(exchange(&client, "GET /hello HTTP/1.0\r\n\r\n", body, sizeof(body)) == 200,
+              "HTTP/1.0 answered");
+        CHECK(client_closed(&client), "HTTP/1.0 without keep-alive closes");
+
+    }
+
+    client_close(&client);
+
+}
+
+/*
+
+         test_files()
+	       ---
+	       a file larger than any socket buffer, by route
+	       and from a served directory; ".." refused.
+
+*/
+
+static void test_files(void) {
+
+    FILE*    file;
+    char*    expected;
+    char*    body;
+    client_t client;
+    size_t   body_length = 0;
+    size_t   i;
+
+    expected = (char*)malloc(TEST_FILE_SIZE);
+    body     = (char*)malloc(TEST_FILE_SIZE);
+    file     = fopen(TEST_FILE_NAME, "wb");
+
+    if (!expected || !body || !file) {
+
+        CHECK(0, "test file prepared");
+        free(expected);
+        free(body);
+
+        if (file) {
+
+            fclose(file);
+
+        }
+
+        return;
+
+    }
+
+    for (i = 0; i < TEST_FILE_SIZE; i++) {
+
+        expected[i] = (char)(i * 13 + i / 257);
+
+    }
+
+    fwrite(expected, 1, TEST_FILE_SIZE, file);
+    fclose(file);
+
+    if (client_open(&client)) {
+
+        send_text(&client, "GET /file HTTP/1.1\r\nHost: t\r\n\r\n");
+
+        CHECK(client_response(&client, body, TEST_FILE_SIZE, &body_length, NULL, 0) == 200 &&
+              body_length == TEST_FILE_SIZE && memcmp(body, expected, TEST_FILE_SIZE) == 0,
+              "respond_file sends the whole file");
+
+        send_text(&client, "GET /static/" TEST_FILE_NAME " HTTP/1.1\r\nHost: t\r\n\r\n");
+
+        CHECK(client_response(&client, body, TEST_FILE_SIZE, &body_length, NULL, 0) == 200 &&
+              body_length == TEST_FILE_SIZE && memcmp(body, expected, TEST_FILE_SIZE) == 0,
+              "served directory sends the file");
+
+        CHECK(exchange(&client, "GET /static/../" TEST_FILE_NAME " HTTP/1.1\r\nHost: t\r\n\r\n",
+                       body, 64) == 404, "'..' is refused");
+
+        CHECK(exchange(&client, "GET /hello HTTP/1.1\r\nHost: t\r\n\r\n", body, 64) == 200,
+              "connection usable after files");
+
+    }
+
+    client_close(&client);
+
+    remove(TEST_FILE_NAME);
+    free(expected);
+    free(body);
+
+}
+
+/*
+	==================================
+             --- LOAD ---
+	==================================
+*/
+
+/*
+
+         load_t
+	       ---
+	       one load client's latencies in microseconds.
+
+*/
+
+typedef struct {
+    double latencies[TEST_LOAD_REQUESTS];
+    int    completed;
+} load_t;
+
+static load_t loads[TEST_LOAD_CLIENTS];
+
+/*
+
+         load_client()
+	       ---
+	       load thread: requests back to back on one
+	       kept-alive connection.
+
+*/
+
+static void* load_client(void* arg) {
+
+    load_t*  load = (load_t*)arg;
+    client_t client;
+    char     body[64];
+    double   start;
+    int      i;
+
+    if (!client_open(&client)) {
+
+        client_close(&client);
+        return NULL;
+
+    }
+
+    for (i = 0; i < TEST_LOAD_REQUESTS; i++) {
+
+        start = now_us();
+
+        if (exchange(&client, "GET /hello HTTP/1.1\r\nHost: t\r\n\r\n", body, sizeof(body)) != 200) {
+
+            break;
+
+        }
+
+        load->latencies[load->completed++] = now_us() - start;
+
+    }
+
+    client_close(&client);
+
+    return NULL;
+
+}
+
+/*
+
+         compare_doubles()
+	       ---
+	       qsort order for latencies.
+
+*/
+
+static int compare_doubles(const void* a, const void* b) {
+
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+
+    return x < y ? -1 : x > y;
+
+}
+
+/*
+
+         test_load()
+	       ---
+	       requests per second and latency percentiles
+	       across the load clients.
+
+*/
+
+static void test_load(void) {
+
+    static double all[TEST_LOAD_CLIENTS * TEST_LOAD_REQUESTS];
+    pthread_t     threads[TEST_LOAD_CLIENTS];
+    size_t        count = 0;
+    double        start;
+    double        elapsed;
+    int           i;
+    int           j;
+
+    memset(loads, 0, sizeof(loads));
+
+    start = now_us();
+
+    for (i = 0; i < TEST_LOAD_CLIENTS; i++) {
+
+        pthread_create(&threads[i], NULL, load_client, &loads[i]);
+
+    }
+
+    for (i = 0; i < TEST_LOAD_CLIENTS; i++) {
+
+        pthread_join(threads[i], NULL);
+
+        for (j = 0; j < loads[i].completed; j++) {
+
+            all[count++] = loads[i].latencies[j];
+
+        }
+
+    }
+
+    elapsed = now_us() - start;
+
+    CHECK(count == (size_t)TEST_LOAD_CLIENTS * TEST_LOAD_REQUESTS, "every load request answered");
+
+    if (count == 0) {
+
+        return;
+
+    }
+
+    qsort(all, count, sizeof(double), compare_doubles);
+
+    printf("  %lu requests over %d connections: %.0f requests/s\n",
+           (unsigned long)count, TEST_LOAD_CLIENTS, count * 1000000.0 / elapsed);
+    printf("  latency us: p50 %.0f, p90 %.0f, p99 %.0f, max %.0f\n",
+           all[count / 2], all[count * 9 / 10], all[count * 99 / 100], all[count - 1]);
+
+}
+
+#endif
+
+/*
+	==================================
+             --- MAIN ---
+	==================================
+*/
+
+int main(void) {
+
+    printf("--- HTTP SERVER TESTS ---\n");
+
+#ifdef _WIN32
+    printf("SKIPPED: the test clients need POSIX threads\n");
+    return 0;
+#else
+    /* a peer reset during sendfile must not end the process */
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!loop_start()) {
+
+        printf("FAILED: could not start the server\n");
+        return 1;
+
+    }
+
+    printf("routes...\n");
+    test_routes();
+
+    printf("keep-alive and pipelining...\n");
+    test_keepalive_and_pipelining();
+
+    printf("split bodies...\n");
+    test_bodies();
+
+    printf("limits and HTTP/1.0...\n");
+    test_limits();
+
+    printf("files...\n");
+    test_files();
+
+    printf("load...\n");
+    test_load();
+
+    loop_stop();
+
+    if (failures > 0) {
+
+        printf("%d HTTP SERVER CHECKS FAILED\n", failures);
+        return 1;
+
+    }
+
+    printf("ALL HTTP SERVER TESTS PASSED\n");
+    return 0;
+#endif
+}
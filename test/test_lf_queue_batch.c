@@ -0,0 +1,510 @@
+/*
+   ===================================
+   T E S T _ L F _ Q U E U E _ B A T C H . C
+   LOCK-FREE QUEUE BATCH TESTS
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    checks commc_lf_queue_enqueue_batch() and
+	    commc_lf_queue_dequeue_batch(): order within and
+	    across batches, partial and empty dequeues, and
+	    that producers and consumers racing with batches
+	    lose, duplicate or reorder nothing, under every
+	    reclamation scheme.
+
+	    ends by timing single against batch operations
+	    on one thread. the figures are printed, not
+	    checked, so a slow machine cannot fail the test.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L    /* PTHREADS */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "commc/lockfreequeue.h"
+#include "commc/error.h"
+
+#define TEST_PRODUCERS       4
+#define TEST_CONSUMERS       4
+#define TEST_PER_PRODUCER    20000
+#define TEST_BATCH           32
+#define TEST_TIMED_ITEMS     1000000
+
+static int failures = 0;
+
+#define CHECK(condition, message)                                       \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            printf("  FAILED: %s (line %d)\n", (message), __LINE__);    \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+/*
+
+    items are tagged pointers: producer in the high bits, its
+    sequence number in the low ones, offset by one so no item
+    is NULL.
+
+*/
+
+#define TEST_ITEM(producer, sequence) \
+    ((void*)(size_t)(((size_t)(producer) << 24) + (size_t)(sequence) + 1))
+#define TEST_PRODUCER_OF(item)  (((size_t)(item) - 1) >> 24)
+#define TEST_SEQUENCE_OF(item)  (((size_t)(item) - 1) & 0xFFFFFF)
+
+/*
+	==================================
+             --- ORDER ---
+	==================================
+*/
+
+/*
+
+         test_batch_order()
+	       ---
+	       batches and single operations interleave in
+	       FIFO order; a dequeue takes what is there up
+	       to its limit and fails on an empty queue.
+
+*/
+
+static void test_batch_order(commc_lf_queue_reclaim_t reclaim) {
+
+    commc_lf_queue_t* queue = commc_lf_queue_create_with_reclaim(4, reclaim);
+    void*             items[100];
+    void*             out[100];
+    void*             single;
+    size_t            dequeued;
+    size_t            taken = 0;
+    size_t            i;
+    int               ordered = 1;
+
+    CHECK(queue != NULL, "queue created");
+
+    if (!queue) {
+
+        return;
+
+    }
+
+    for (i = 0; i < 100; i++) {
+
+        items[i] = TEST_ITEM(0, i);
+
+    }
+
+    CHECK(commc_lf_queue_enqueue_batch(queue, items, 60) == COMMC_SUCCESS, "first batch");
+    CHECK(commc_lf_queue_enqueue(queue, items[60]) == COMMC_SUCCESS, "single between batches");
+    CHECK(commc_lf_queue_enqueue_batch(queue, items + 61, 39) == COMMC_SUCCESS, "second batch");
+    CHECK(commc_lf_queue_size(queue) == 100, "size counts whole batches");
+
+    CHECK(commc_lf_queue_dequeue(queue, &single) == COMMC_SUCCESS && single == items[0],
+          "single dequeue takes the head");
+
+    taken = 1;
+
+    while (commc_lf_queue_dequeue_batch(queue, out, 7, &dequeued) == COMMC_SUCCESS) {
+
+        CHECK(dequeued >= 1 && dequeued <= 7, "dequeue stays within its limit");
+
+        for (i = 0; i < dequeued; i++) {
+
+            if (taken >= 100 || out[i] != items[taken]) {
+
+                ordered = 0;
+
+            }
+
+            taken++;
+
+        }
+
+    }
+
+    CHECK(ordered, "elements come out in the order they went in");
+    CHECK(taken == 100, "every element comes out");
+    CHECK(commc_lf_queue_is_empty(queue), "queue ends empty");
+    CHECK(commc_lf_queue_dequeue_batch(queue, out, 7, &dequeued) == COMMC_FAILURE && dequeued == 0,
+          "empty queue fails the dequeue");
+    CHECK(commc_lf_queue_enqueue_batch(queue, items, 0) == COMMC_SUCCESS &&
+          commc_lf_queue_is_empty(queue), "empty batch is a no-op");
+
+    commc_lf_queue_destroy(queue);
+
+}
+
+#ifndef _WIN32
+
+/*
+	==================================
+             --- CONTENTION ---
+	==================================
+*/
+
+/*
+
+         contention_t
+	       ---
+	       state shared by the racing producers and
+	       consumers. each consumer owns one row of seen
+	       and one last sequence per producer.
+
+*/
+
+typedef struct {
+    commc_lf_queue_t* queue;
+    int               producers_done;     /* GUARDED BY lock */
+    size_t            consumed;           /* GUARDED BY lock */
+    pthread_mutex_t   lock;
+    unsigned char*    seen;               /* ONE FLAG PER ITEM */
+    int               reordered;          /* GUARDED BY lock */
+    int               duplicated;         /* GUARDED BY lock */
+} contention_t;
+
+typedef struct {
+    contention_t* shared;
+    int           index;
+} worker_t;
+
+/*
+
+         produce()
+	       ---
+	       enqueues this producer's sequence in batches of
+	       varying size.
+
+*/
+
+static void* produce(void* arg) {
+
+    worker_t* worker = (worker_t*)arg;
+    void*     items[TEST_BATCH];
+    size_t    next = 0;
+    size_t    count;
+    size_t    i;
+
+    while (next < TEST_PER_PRODUCER) {
+
+        count = 1 + next % TEST_BATCH;
+
+        if (count > TEST_PER_PRODUCER - next) {
+
+            count = TEST_PER_PRODUCER - next;
+
+        }
+
+        for (i = 0; i < count; i++) {
+
+            items[i] = TEST_ITEM(worker->index, next + i);
+
+        }
+
+        if (commc_lf_queue_enqueue_batch(worker->shared->queue, items, count) == COMMC_SUCCESS) {
+
+            next += count;
+
+        }
+
+    }
+
+    pthread_mutex_lock(&worker->shared->lock);
+    worker->shared->producers_done++;
+    pthread_mutex_unlock(&worker->shared->lock);
+
+    commc_lf_queue_thread_offline(worker->shared->queue);
+
+    return NULL;
+
+}
+
+/*
+
+         consume()
+	       ---
+	       dequeues in batches until every producer is
+	       done and the queue is drained, checking that
+	       each producer's items arrive in order and
+	       only once.
+
+*/
+
+static void* consume(void* arg) {
+
+    worker_t*     worker = (worker_t*)arg;
+    contention_t* shared = worker->shared;
+    void*         items[TEST_BATCH];
+    size_t        last[TEST_PRODUCERS];
+    size_t        dequeued;
+    size_t        producer;
+    size_t        sequence;
+    size_t        i;
+    int           done;
+
+    for (i = 0; i < TEST_PRODUCERS; i++) {
+
+        last[i] = (size_t)-1;
+
+    }
+
+    for (;;) {
+
+        pthread_mutex_lock(&shared->lock);
+        done = shared->producers_done == TEST_PRODUCERS;
+        pthread_mutex_unlock(&shared->lock);
+
+        if (commc_lf_queue_dequeue_batch(shared->queue, items, TEST_BATCH, &dequeued) != COMMC_SUCCESS) {
+
+            if (done) {
+
+                break;
+
+            }
+
+            continue;
+
+        }
+
+        pthread_mutex_lock(&shared->lock);
+
+        for (i = 0; i < dequeued; i++) {
+
+            producer = TEST_PRODUCER_OF(items[i]);
+            sequence = TEST_SEQUENCE_OF(items[i]);
+
+            if (producer >= TEST_PRODUCERS || sequence >= TEST_PER_PRODUCER ||
+                shared->seen[producer * TEST_PER_PRODUCER + sequence]) {
+
+                shared->duplicated = 1;
+                continue;
+
+            }
+
+            /* one consumer sees a producer's items in that producer's order */
+
+            if (last[producer] != (size_t)-1 && sequence <= last[producer]) {
+
+                shared->reordered = 1;
+
+            }
+
+            last[producer] = sequence;
+            shared->seen[producer * TEST_PER_PRODUCER + sequence] = 1;
+            shared->consumed++;
+
+        }
+
+        pthread_mutex_unlock(&shared->lock);
+
+    }
+
+    commc_lf_queue_thread_offline(shared->queue);
+
+    return NULL;
+
+}
+
+/*
+
+         test_batch_contention()
+	       ---
+	       producers and consumers race on one queue with
+	       batches; every item comes out exactly once.
+
+*/
+
+static void test_batch_contention(commc_lf_queue_reclaim_t reclaim) {
+
+    contention_t shared;
+    worker_t     producers[TEST_PRODUCERS];
+    worker_t     consumers[TEST_CONSUMERS];
+    pthread_t    threads[TEST_PRODUCERS + TEST_CONSUMERS];
+    int          i;
+
+    memset(&shared, 0, sizeof(shared));
+
+    shared.queue = commc_lf_queue_create_with_reclaim(TEST_PRODUCERS + TEST_CONSUMERS + 1, reclaim);
+    shared.seen  = (unsigned char*)calloc(TEST_PRODUCERS * TEST_PER_PRODUCER, 1);
+
+    CHECK(shared.queue != NULL && shared.seen != NULL, "contention setup");
+
+    if (!shared.queue || !shared.seen) {
+
+        commc_lf_queue_destroy(shared.queue);
+        free(shared.seen);
+        return;
+
+    }
+
+    pthread_mutex_init(&shared.lock, NULL);
+
+    for (i = 0; i < TEST_CONSUMERS; i++) {
+
+        consumers[i].shared = &shared;
+        consumers[i].index  = i;
+        pthread_create(&threads[TEST_PRODUCERS + i], NULL, consume, &consumers[i]);
+
+    }
+
+    for (i = 0; i < TEST_PRODUCERS; i++) {
+
+        producers[i].shared = &shared;
+        producers[i].index  = i;
+        pthread_create(&threads[i], NULL, produce, &producers[i]);
+
+    }
+
+    for (i = 0; i < TEST_PRODUCERS + TEST_CONSUMERS; i++) {
+
+        pthread_join(threads[i], NULL);
+
+    }
+
+    CHECK(!shared.duplicated, "no item comes out twice");
+    CHECK(!shared.reordered, "each producer's items keep their order");
+    CHECK(shared.consumed == (size_t)TEST_PRODUCERS * TEST_PER_PRODUCER, "no item is lost");
+    CHECK(commc_lf_queue_is_empty(shared.queue), "queue ends empty");
+
+    pthread_mutex_destroy(&shared.lock);
+    commc_lf_queue_destroy(shared.queue);
+    free(shared.seen);
+
+}
+
+#endif
+
+/*
+	==================================
+             --- THROUGHPUT ---
+	==================================
+*/
+
+/*
+
+         time_queue()
+	       ---
+	       pushes TEST_TIMED_ITEMS through the queue in
+	       batches of batch (1 for the single calls) and
+	       returns the operations per second.
+
+*/
+
+static double time_queue(size_t batch) {
+
+    commc_lf_queue_t* queue = commc_lf_queue_create(2);
+    void*             items[TEST_BATCH];
+    void*             single;
+    size_t            dequeued;
+    size_t            done;
+    size_t            i;
+    clock_t           start;
+    double            seconds;
+
+    if (!queue) {
+
+        return 0.0;
+
+    }
+
+    for (i = 0; i < TEST_BATCH; i++) {
+
+        items[i] = TEST_ITEM(0, i);
+
+    }
+
+    start = clock();
+
+    for (done = 0; done < TEST_TIMED_ITEMS; done += batch) {
+
+        if (batch == 1) {
+
+            commc_lf_queue_enqueue(queue, items[0]);
+            commc_lf_queue_dequeue(queue, &single);
+
+        } else {
+
+            commc_lf_queue_enqueue_batch(queue, items, batch);
+            commc_lf_queue_dequeue_batch(queue, items, batch, &dequeued);
+
+        }
+
+    }
+
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    commc_lf_queue_destroy(queue);
+
+    return seconds > 0.0 ? 2.0 * TEST_TIMED_ITEMS / seconds : 0.0;
+
+}
+
+/*
+	==================================
+             --- MAIN ---
+	==================================
+*/
+
+int main(void) {
+
+    commc_lf_queue_reclaim_t schemes[3];
+    const char*              names[3];
+    double                   single;
+    double                   batched;
+    int                      i;
+
+    schemes[0] = COMMC_LF_QUEUE_RECLAIM_HAZARD;  names[0] = "hazard";
+    schemes[1] = COMMC_LF_QUEUE_RECLAIM_EBR;     names[1] = "ebr";
+    schemes[2] = COMMC_LF_QUEUE_RECLAIM_QSBR;    names[2] = "qsbr";
+
+    printf("--- LOCK-FREE QUEUE BATCH TESTS ---\n");
+
+    for (i = 0; i < 3; i++) {
+
+        printf("batch order (%s)...\n", names[i]);
+        test_batch_order(schemes[i]);
+
+#ifndef _WIN32
+        printf("batch contention (%s)...\n", names[i]);
+        test_batch_contention(schemes[i]);
+#endif
+
+    }
+
+    single  = time_queue(1);
+    batched = time_queue(TEST_BATCH);
+
+    printf("throughput: single %.0f ops/s, batch of %d %.0f ops/s\n",
+           single, TEST_BATCH, batched);
+
+    if (failures > 0) {
+
+        printf("%d LOCK-FREE QUEUE BATCH CHECKS FAILED\n", failures);
+        return 1;
+
+    }
+
+    printf("ALL LOCK-FREE QUEUE BATCH TESTS PASSED\n");
+    return 0;
+
+}
@@ -0,0 +1,887 @@
+/*
+   ===================================
+   T E S T _ R E A C T O R _ S C A L I N G . C
+   MULTI-REACTOR RUNTIME TESTS
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    exercises commc_reactor: hooks run once on each
+	    loop's own thread, tasks posted from several threads
+	    reach the right loop in each poster's order, a stop
+	    from another thread wakes loops blocked in a long
+	    wait, and an echo server on per-loop listeners
+	    answers many client connections byte for byte.
+
+	    the echo run is timed with one loop and with four,
+	    and the round trips per second printed, not
+	    checked: on a machine with one processor more loops
+	    cannot be faster.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L    /* CLOCK_GETTIME, NANOSLEEP, PTHREADS */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#include "commc/reactor.h"
+#include "commc/async.h"
+#include "commc/atomic.h"
+#include "commc/error.h"
+
+#define TEST_LOOPS            4
+#define TEST_POSTERS          4
+#define TEST_POSTS            5000        /* PER POSTER AND LOOP */
+#define TEST_CLIENTS          8
+#define TEST_CONNECTIONS      4           /* PER CLIENT THREAD */
+#define TEST_PINGS            500         /* PER CONNECTION */
+#define TEST_PING_SIZE        64
+
+static int failures = 0;
+
+#define CHECK(condition, message)                                       \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            printf("  FAILED: %s (line %d)\n", (message), __LINE__);    \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+#ifndef _WIN32
+
+/*
+	==================================
+             --- HELPERS ---
+	==================================
+*/
+
+/*
+
+         now_ms()
+	       ---
+	       monotonic milliseconds.
+
+*/
+
+static double now_ms(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+
+}
+
+/*
+
+         pause_ms()
+	       ---
+	       sleeps for ms milliseconds.
+
+*/
+
+static void pause_ms(long ms) {
+
+    struct timespec delay;
+
+    delay.tv_sec  = ms / 1000;
+    delay.tv_nsec = (ms % 1000) * 1000000L;
+
+    nanosleep(&delay, NULL);
+
+}
+
+/*
+
+         make_reactor()
+	       ---
+	       an unpinned reactor of loops loops, so the test
+	       runs the same on any number of processors.
+
+*/
+
+static commc_reactor_t* make_reactor(size_t loops,
+                                     commc_reactor_loop_fn on_start,
+                                     commc_reactor_loop_fn on_stop,
+                                     void* user_data) {
+
+    commc_reactor_config_t config;
+
+    commc_reactor_config_init(&config);
+
+    config.loop_count  = loops;
+    config.pin_threads = 0;
+    config.on_start    = on_start;
+    config.on_stop     = on_stop;
+    config.user_data   = user_data;
+
+    return commc_reactor_create(&config);
+
+}
+
+/*
+	==================================
+             --- HOOKS ---
+	==================================
+*/
+
+typedef struct {
+    volatile unsigned long started[TEST_LOOPS];
+    volatile unsigned long stopped[TEST_LOOPS];
+    volatile unsigned long misplaced;
+} hooks_t;
+
+static void hook_start(commc_reactor_t* reactor, size_t index,
+                       commc_async_context_t* ctx, void* user_data) {
+
+    hooks_t* hooks = (hooks_t*)user_data;
+
+    if (commc_reactor_current_loop(reactor) != (int)index ||
+        commc_reactor_context(reactor, index) != ctx) {
+
+        COMMC_ATOMIC_INC(&hooks->misplaced);
+
+    }
+
+    COMMC_ATOMIC_INC(&hooks->started[index]);
+
+}
+
+static void hook_stop(commc_reactor_t* reactor, size_t index,
+                      commc_async_context_t* ctx, void* user_data) {
+
+    hooks_t* hooks = (hooks_t*)user_data;
+
+    (void)ctx;
+
+    if (commc_reactor_current_loop(reactor) != (int)index) {
+
+        COMMC_ATOMIC_INC(&hooks->misplaced);
+
+    }
+
+    COMMC_ATOMIC_INC(&hooks->stopped[index]);
+
+}
+
+/*
+
+         test_hooks_and_stop()
+	       ---
+	       loops waiting with a 100 s poll timeout are
+	       woken by a stop from this thread; each hook
+	       runs once, on its own loop.
+
+*/
+
+static void test_hooks_and_stop(void) {
+
+    hooks_t          hooks;
+    commc_reactor_t* reactor;
+    double           start;
+    size_t           i;
+    int              once = 1;
+
+    memset((void*)&hooks, 0, sizeof(hooks));
+
+    reactor = make_reactor(TEST_LOOPS, hook_start, hook_stop, &hooks);
+
+    CHECK(reactor != NULL, "reactor created");
+
+    if (!reactor) {
+
+        return;
+
+    }
+
+    CHECK(commc_reactor_loop_count(reactor) == TEST_LOOPS, "loop count");
+    CHECK(commc_reactor_current_loop(reactor) == -1, "main thread is not a loop");
+
+    for (i = 0; i < TEST_LOOPS; i++) {
+
+        commc_async_set_timeout(commc_reactor_context(reactor, i), 100000);
+
+    }
+
+    CHECK(commc_reactor_start(reactor) == COMMC_SUCCESS, "reactor started");
+    CHECK(commc_reactor_start(reactor) == COMMC_ERROR_INVALID_STATE, "second start refused");
+
+    pause_ms(100);
+
+    start = now_ms();
+
+    commc_reactor_stop(reactor);
+    commc_reactor_join(reactor);
+
+    CHECK(now_ms() - start < 2000.0, "stop wakes loops blocked in a long wait");
+
+    for (i = 0; i < TEST_LOOPS; i++) {
+
+        if (hooks.started[i] != 1 || hooks.stopped[i] != 1) {
+
+            once = 0;
+
+        }
+
+    }
+
+    CHECK(once, "each hook runs once per loop");
+    CHECK(hooks.misplaced == 0, "hooks run on their own loop");
+
+    commc_reactor_destroy(reactor);
+
+}
+
+/*
+	==================================
+             --- POSTING ---
+	==================================
+*/
+
+/*
+
+         posting_t
+	       ---
+	       the next sequence number expected from each
+	       poster on each loop. a loop only touches its
+	       own row.
+
+*/
+
+typedef struct {
+    commc_reactor_t*       reactor;
+    unsigned long          expected[TEST_LOOPS][TEST_POSTERS];
+    volatile unsigned long run;
+    volatile unsigned long misplaced;
+    volatile unsigned long reordered;
+    volatile unsigned long failed;
+} posting_t;
+
+typedef struct {
+    posting_t* posting;
+    size_t     loop;
+    size_t     poster;
+    unsigned long sequence;
+} post_t;
+
+typedef struct {
+    posting_t* posting;
+    size_t     poster;
+} poster_t;
+
+/*
+
+         posted()
+	       ---
+	       runs on the target loop: checks it is the right
+	       one and that this poster's tasks arrive in
+	       order.
+
+*/
+
+static void posted(void* arg) {
+
+    post_t*    post    = (post_t*)arg;
+    posting_t* posting = post->posting;
+
+    if (commc_reactor_current_loop(posting->reactor) != (int)post->loop) {
+
+        COMMC_ATOMIC_INC(&posting->misplaced);
+
+    }
+
+    if (posting->expected[post->loop][post->poster] != post->sequence) {
+
+        COMMC_ATOMIC_INC(&posting->reordered);
+
+    }
+
+    posting->expected[post->loop][post->poster] = post->sequence + 1;
+
+    COMMC_ATOMIC_INC(&posting->run);
+    free(post);
+
+}
+
+/*
+
+         post_all()
+	       ---
+	       poster thread: TEST_POSTS numbered tasks to
+	       every loop, interleaved.
+
+*/
+
+static void* post_all(void* arg) {
+
+    poster_t*     poster = (poster_t*)arg;
+    post_t*       post;
+    unsigned long sequence;
+    size_t        loop;
+
+    for (sequence = 0; sequence < TEST_POSTS; sequence++) {
+
+        for (loop = 0; loop < TEST_LOOPS; loop++) {
+
+            post = (post_t*)malloc(sizeof(post_t));
+
+            if (!post) {
+
+                COMMC_ATOMIC_INC(&poster->posting->failed);
+                continue;
+
+            }
+
+            post->posting  = poster->posting;
+            post->loop     = loop;
+            post->poster   = poster->poster;
+            post->sequence = sequence;
+
+            if (commc_reactor_post(poster->posting->reactor, loop, posted, post) != COMMC_SUCCESS) {
+
+                free(post);
+                COMMC_ATOMIC_INC(&poster->posting->failed);
+
+            }
+
+        }
+
+    }
+
+    return NULL;
+
+}
+
+/*
+
+         test_cross_loop_posting()
+	       ---
+	       several threads post to every loop at once;
+	       every task runs once, on its loop, in its
+	       poster's order.
+
+*/
+
+static void test_cross_loop_posting(void) {
+
+    static posting_t posting;
+    poster_t         posters[TEST_POSTERS];
+    pthread_t        threads[TEST_POSTERS];
+    unsigned long    total = (unsigned long)TEST_POSTERS * TEST_POSTS * TEST_LOOPS;
+    double           start;
+    double           elapsed;
+    int              waited;
+    size_t           i;
+
+    memset((void*)&posting, 0, sizeof(posting));
+
+    posting.reactor = make_reactor(TEST_LOOPS, NULL, NULL, NULL);
+
+    CHECK(posting.reactor != NULL, "reactor created");
+
+    if (!posting.reactor || commc_reactor_start(posting.reactor) != COMMC_SUCCESS) {
+
+        CHECK(0, "reactor started");
+        commc_reactor_destroy(posting.reactor);
+        return;
+
+    }
+
+    start = now_ms();
+
+    for (i = 0; i < TEST_POSTERS; i++) {
+
+        posters[i].posting = &posting;
+        posters[i].poster  = i;
+        pthread_create(&threads[i], NULL, post_all, &posters[i]);
+
+    }
+
+    for (i = 0; i < TEST_POSTERS; i++) {
+
+        pthread_join(threads[i], NULL);
+
+    }
+
+    for (waited = 0; waited < 1000 && COMMC_ATOMIC_LOAD_ACQUIRE(&posting.run) < total; waited++) {
+
+        pause_ms(10);
+
+    }
+
+    elapsed = now_ms() - start;
+
+    commc_reactor_stop(posting.reactor);
+    commc_reactor_join(posting.reactor);
+
+    CHECK(posting.failed == 0, "every post is accepted");
+    CHECK(posting.run == total, "every posted task runs");
+    CHECK(posting.misplaced == 0, "tasks run on the loop they were posted to");
+    CHECK(posting.reordered == 0, "each poster's tasks run in order");
+
+    printf("  %lu posts in %.0f ms\n", total, elapsed);
+
+    commc_reactor_destroy(posting.reactor);
+
+}
+
+/*
+	==================================
+             --- ECHO ---
+	==================================
+*/
+
+/*
+
+         echo_server_t / echo_connection_t
+	       ---
+	       per-loop echo server: each accepted connection
+	       reads what arrives and writes it back. the
+	       server counts connections per loop and the ones
+	       still open.
+
+*/
+
+typedef struct {
+    volatile unsigned long accepted[TEST_LOOPS];
+    volatile unsigned long open;
+} echo_server_t;
+
+typedef struct {
+    echo_server_t*         server;
+    commc_async_context_t* ctx;
+    int                    handle;
+    char                   buffer[4096];
+    size_t                 length;
+    size_t                 written;
+} echo_connection_t;
+
+static void echo_read(const commc_async_result_t* result);
+
+/*
+
+         echo_close()
+	       ---
+	       drops a connection from its loop and frees it.
+
+*/
+
+static void echo_close(echo_connection_t* connection) {
+
+    commc_async_remove_handle(connection->ctx, connection->handle);
+    close(connection->handle);
+
+    COMMC_ATOMIC_DEC(&connection->server->open);
+    free(connection);
+
+}
+
+/*
+
+         echo_wrote()
+	       ---
+	       sends what is left of the echo, then reads the
+	       next message.
+
+*/
+
+static void echo_wrote(const commc_async_result_t* result) {
+
+    echo_connection_t* connection = (echo_connection_t*)result->user_data;
+    int                queued;
+
+    if (result->error_code != 0) {
+
+        echo_close(connection);
+        return;
+
+    }
+
+    connection->written += result->bytes_transferred;
+
+    if (connection->written < connection->length) {
+
+        queued = commc_async_write(connection->ctx, connection->handle,
+                                   connection->buffer + connection->written,
+                                   connection->length - connection->written,
+                                   echo_wrote, connection);
+
+    } else {
+
+        queued = commc_async_read(connection->ctx, connection->handle,
+                                  connection->buffer, sizeof(connection->buffer),
+                                  echo_read, connection);
+
+    }
+
+    if (queued != 0) {
+
+        echo_close(connection);
+
+    }
+
+}
+
+/*
+
+         echo_read()
+	       ---
+	       writes back whatever arrived; closes on end of
+	       stream.
+
+*/
+
+static void echo_read(const commc_async_result_t* result) {
+
+    echo_connection_t* connection = (echo_connection_t*)result->user_data;
+
+    if (result->error_code != 0 || result->bytes_transferred == 0) {
+
+        echo_close(connection);
+        return;
+
+    }
+
+    connection->length  = result->bytes_transferred;
+    connection->written = 0;
+
+    if (commc_async_write(connection->ctx, connection->handle, connection->buffer,
+                          connection->length, echo_wrote, connection) != 0) {
+
+        echo_close(connection);
+
+    }
+
+}
+
+/*
+
+         echo_accept()
+	       ---
+	       on_accept hook: starts echoing on the loop that
+	       accepted.
+
+*/
+
+static void echo_accept(commc_reactor_t* reactor, size_t index,
+                        commc_async_context_t* ctx, int handle, void* user_data) {
+
+    echo_server_t*     server = (echo_server_t*)user_data;
+    echo_connection_t* connection;
+
+    (void)reactor;
+
+    connection = (echo_connection_t*)malloc(sizeof(echo_connection_t));
+
+    if (!connection) {
+
+        close(handle);
+        return;
+
+    }
+
+    connection->server = server;
+    connection->ctx    = ctx;
+    connection->handle = handle;
+
+    COMMC_ATOMIC_INC(&server->accepted[index]);
+    COMMC_ATOMIC_INC(&server->open);
+
+    if (commc_async_read(ctx, handle, connection->buffer, sizeof(connection->buffer),
+                         echo_read, connection) != 0) {
+
+        echo_close(connection);
+
+    }
+
+}
+
+/*
+
+         echo_client_t
+	       ---
+	       one client thread's connections and outcome.
+
+*/
+
+typedef struct {
+    int                    port;
+    int                    index;
+    volatile unsigned long corrupt;
+    volatile unsigned long failed;
+    volatile unsigned long trips;
+} echo_client_t;
+
+/*
+
+         echo_client()
+	       ---
+	       client thread: opens its connections, then
+	       sends pings round-robin over them with blocking
+	       I/O and checks each echo.
+
+*/
+
+static void* echo_client(void* arg) {
+
+    echo_client_t*     client = (echo_client_t*)arg;
+    struct sockaddr_in address;
+    int                sockets[TEST_CONNECTIONS];
+    char               ping[TEST_PING_SIZE];
+    char               pong[TEST_PING_SIZE];
+    size_t             got;
+    ssize_t            n;
+    int                ping_index;
+    int                i;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port        = htons((unsigned short)client->port);
+
+    for (i = 0; i < TEST_CONNECTIONS; i++) {
+
+        sockets[i] = socket(AF_INET, SOCK_STREAM, 0);
+
+        if (sockets[i] < 0 ||
+            connect(sockets[i], (struct sockaddr*)&address, sizeof(address)) != 0) {
+
+            client->failed++;
+
+        }
+
+    }
+
+    for (ping_index = 0; ping_index < TEST_PINGS && !client->failed; ping_index++) {
+
+        for (i = 0; i < TEST_CONNECTIONS; i++) {
+
+            memset(ping, 'A' + (client->index + i + ping_index) % 26, sizeof(ping));
+
+            if (send(sockets[i], ping, sizeof(ping), 0) != (ssize_t)sizeof(ping)) {
+
+                client->failed++;
+                break;
+
+            }
+
+            for (got = 0; got < sizeof(pong); got += (size_t)n) {
+
+                n = recv(sockets[i], pong + got, sizeof(pong) - got, 0);
+
+                if (n <= 0) {
+
+                    break;
+
+                }
+
+            }
+
+            if (got < sizeof(pong)) {
+
+                client->failed++;
+                break;
+
+            }
+
+            if (memcmp(ping, pong, sizeof(ping)) != 0) {
+
+                client->corrupt++;
+
+            }
+
+            client->trips++;
+
+        }
+
+    }
+
+    for (i = 0; i < TEST_CONNECTIONS; i++) {
+
+        if (sockets[i] >= 0) {
+
+            close(sockets[i]);
+
+        }
+
+    }
+
+    return NULL;
+
+}
+
+/*
+
+         run_echo()
+	       ---
+	       echo server on loops loops, TEST_CLIENTS client
+	       threads against it. returns round trips per
+	       second.
+
+*/
+
+static double run_echo(size_t loops) {
+
+    static echo_server_t server;
+    echo_client_t        clients[TEST_CLIENTS];
+    pthread_t            threads[TEST_CLIENTS];
+    commc_reactor_t*     reactor;
+    struct sockaddr_in   address;
+    socklen_t            length = sizeof(address);
+    unsigned long        trips  = 0;
+    unsigned long        spread = 0;
+    double               start;
+    double               elapsed;
+    int                  listener;
+    int                  waited;
+    int                  port;
+    int                  i;
+
+    memset((void*)&server, 0, sizeof(server));
+
+    reactor = make_reactor(loops, NULL, NULL, NULL);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (!reactor ||
+        commc_reactor_listen(reactor, &address, sizeof(address), 0,
+                             echo_accept, &server, &listener) != COMMC_SUCCESS ||
+        getsockname(listener, (struct sockaddr*)&address, &length) != 0 ||
+        commc_reactor_start(reactor) != COMMC_SUCCESS) {
+
+        CHECK(0, "echo server started");
+        commc_reactor_destroy(reactor);
+        return 0.0;
+
+    }
+
+    port  = ntohs(address.sin_port);
+    start = now_ms();
+
+    for (i = 0; i < TEST_CLIENTS; i++) {
+
+        memset((void*)&clients[i], 0, sizeof(clients[i]));
+        clients[i].port  = port;
+        clients[i].index = i;
+        pthread_create(&threads[i], NULL, echo_client, &clients[i]);
+
+    }
+
+    for (i = 0; i < TEST_CLIENTS; i++) {
+
+        pthread_join(threads[i], NULL);
+
+        CHECK(clients[i].failed == 0, "client connections hold");
+        CHECK(clients[i].corrupt == 0, "every echo matches its ping");
+
+        trips += clients[i].trips;
+
+    }
+
+    elapsed = now_ms() - start;
+
+    /* the loops still have to see every end of stream */
+
+    for (waited = 0; waited < 500 && COMMC_ATOMIC_LOAD_ACQUIRE(&server.open) > 0; waited++) {
+
+        pause_ms(10);
+
+    }
+
+    commc_reactor_stop(reactor);
+    commc_reactor_join(reactor);
+
+    CHECK(trips == (unsigned long)TEST_CLIENTS * TEST_CONNECTIONS * TEST_PINGS,
+          "every round trip completes");
+    CHECK(server.open == 0, "every connection is closed by its loop");
+
+    printf("  %lu loop(s): connections per loop", (unsigned long)loops);
+
+    for (i = 0; i < (int)loops; i++) {
+
+        printf(" %lu", server.accepted[i]);
+        spread += server.accepted[i];
+
+    }
+
+    printf("\n");
+
+    CHECK(spread == (unsigned long)TEST_CLIENTS * TEST_CONNECTIONS, "every connection is accepted once");
+
+    commc_reactor_destroy(reactor);
+
+    return elapsed > 0.0 ? trips * 1000.0 / elapsed : 0.0;
+
+}
+
+#endif
+
+/*
+	==================================
+             --- MAIN ---
+	==================================
+*/
+
+int main(void) {
+
+#ifndef _WIN32
+    double one;
+    double four;
+#endif
+
+    printf("--- MULTI-REACTOR TESTS ---\n");
+
+#ifdef _WIN32
+    printf("SKIPPED: the test clients need POSIX threads and sockets\n");
+    return 0;
+#else
+    printf("hooks and foreign-thread stop...\n");
+    test_hooks_and_stop();
+
+    printf("cross-loop posting...\n");
+    test_cross_loop_posting();
+
+    printf("echo scaling...\n");
+    one  = run_echo(1);
+    four = run_echo(TEST_LOOPS);
+
+    printf("echo: 1 loop %.0f round trips/s, %d loops %.0f round trips/s\n",
+           one, TEST_LOOPS, four);
+
+    if (failures > 0) {
+
+        printf("%d MULTI-REACTOR CHECKS FAILED\n", failures);
+        return 1;
+
+    }
+
+    printf("ALL MULTI-REACTOR TESTS PASSED\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,481 @@
+/*
+   ===================================
+   T E S T _ T H R E A D P O O L _ S T E A L . C
+   WORK-STEALING THREAD POOL TESTS
+   ELASTIC SOFTWORKS 2025
+   ===================================
+*/
+
+/*
+
+	                  --- ABOUT ---
+
+	    puts the Chase-Lev deques of commc_threadpool under
+	    contention: one worker floods its own deque far
+	    past its initial capacity while the others steal
+	    from the top, and every task must run exactly once.
+
+	    also covers nested fork/join, parallel_for coverage
+	    with an uneven grain, and destroy() draining tasks
+	    submitted from outside the pool. how many tasks
+	    were stolen is printed, not checked: on a machine
+	    with one processor the owner may finish first.
+
+*/
+
+/*
+	==================================
+             --- SETUP ---
+	==================================
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commc/threadpool.h"
+#include "commc/atomic.h"
+#include "commc/error.h"
+
+#define TEST_WORKERS       4
+#define TEST_FLOOD_TASKS   20000     /* WELL PAST COMMC_THREADPOOL_DEQUE_CAPACITY */
+#define TEST_FLOOD_ROUNDS  10
+#define TEST_RANGE_SIZE    100003
+#define TEST_DRAIN_TASKS   10000
+
+static int failures = 0;
+
+#define CHECK(condition, message)                                       \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            printf("  FAILED: %s (line %d)\n", (message), __LINE__);    \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+/*
+	==================================
+             --- FLOOD ---
+	==================================
+*/
+
+/*
+
+         flood_t
+	       ---
+	       one round of the flood: a run count per task
+	       and the worker that spawned them.
+
+*/
+
+typedef struct {
+    commc_threadpool_t*      pool;
+    commc_threadpool_group_t group;
+    volatile unsigned long   runs[TEST_FLOOD_TASKS];
+    volatile unsigned long   stolen;
+    volatile unsigned long   done;        /* SET ONCE THE SPAWNER JOINED */
+    int                      owner;
+} flood_t;
+
+typedef struct {
+    flood_t* flood;
+    size_t   index;
+} flood_task_t;
+
+static flood_task_t flood_tasks[TEST_FLOOD_TASKS];
+
+/*
+
+         flood_one()
+	       ---
+	       a small task: counts its run and whether it
+	       ran away from the worker that spawned it.
+
+*/
+
+static void flood_one(void* arg) {
+
+    flood_task_t*          task  = (flood_task_t*)arg;
+    volatile unsigned long spin  = 0;
+    int                    i;
+
+    for (i = 0; i < 200; i++) {
+
+        spin += (unsigned long)i;
+
+    }
+
+    COMMC_ATOMIC_INC(&task->flood->runs[task->index]);
+
+    if (commc_threadpool_current_worker(task->flood->pool) != task->flood->owner) {
+
+        COMMC_ATOMIC_INC(&task->flood->stolen);
+
+    }
+
+}
+
+/*
+
+         flood_spawner()
+	       ---
+	       runs on one worker and pushes every task onto
+	       that worker's own deque, growing it while the
+	       others steal, then joins them there.
+
+*/
+
+static void flood_spawner(void* arg) {
+
+    flood_t* flood = (flood_t*)arg;
+    size_t   i;
+
+    flood->owner = commc_threadpool_current_worker(flood->pool);
+
+    for (i = 0; i < TEST_FLOOD_TASKS; i++) {
+
+        flood_tasks[i].flood = flood;
+        flood_tasks[i].index = i;
+
+        if (commc_threadpool_group_spawn(&flood->group, flood_one, &flood_tasks[i]) != COMMC_SUCCESS) {
+
+            flood_one(&flood_tasks[i]);
+
+        }
+
+    }
+
+    commc_threadpool_group_wait(&flood->group);
+    COMMC_ATOMIC_STORE_RELEASE(&flood->done, 1UL);
+
+}
+
+/*
+
+         test_steal_contention()
+	       ---
+	       floods one deque round after round; every task
+	       runs exactly once.
+
+*/
+
+static void test_steal_contention(commc_threadpool_t* pool) {
+
+    static flood_t           flood;
+    unsigned long            stolen = 0;
+    int                      round;
+    int                      exact  = 1;
+    size_t                   i;
+
+    for (round = 0; round < TEST_FLOOD_ROUNDS; round++) {
+
+        memset((void*)&flood, 0, sizeof(flood));
+        flood.pool = pool;
+        commc_threadpool_group_init(&flood.group, pool);
+
+        /* a waiting group would let this thread run the spawner; it must be a worker */
+
+        CHECK(commc_threadpool_submit(pool, flood_spawner, &flood) == COMMC_SUCCESS,
+              "spawner queued");
+
+        while (!COMMC_ATOMIC_LOAD_ACQUIRE(&flood.done)) {
+
+            /* spin; the workers do the rest */
+
+        }
+
+        for (i = 0; i < TEST_FLOOD_TASKS; i++) {
+
+            if (flood.runs[i] != 1) {
+
+                exact = 0;
+
+            }
+
+        }
+
+        CHECK(flood.owner >= 0, "spawner ran on a worker");
+
+        stolen += flood.stolen;
+
+    }
+
+    CHECK(exact, "every flooded task runs exactly once");
+
+    printf("  %lu of %lu tasks stolen\n", stolen,
+           (unsigned long)TEST_FLOOD_TASKS * TEST_FLOOD_ROUNDS);
+
+}
+
+/*
+	==================================
+             --- FORK/JOIN ---
+	==================================
+*/
+
+typedef struct {
+    commc_threadpool_t* pool;
+    int                 n;
+    unsigned long       result;
+} fib_t;
+
+/*
+
+         fib_task()
+	       ---
+	       naive fibonacci with one fork per call and a
+	       group per level.
+
+*/
+
+static void fib_task(void* arg) {
+
+    fib_t*                   fib = (fib_t*)arg;
+    fib_t                    left;
+    fib_t                    right;
+    commc_threadpool_group_t group;
+
+    if (fib->n < 2) {
+
+        fib->result = (unsigned long)fib->n;
+        return;
+
+    }
+
+    left.pool  = fib->pool;
+    left.n     = fib->n - 1;
+    right.pool = fib->pool;
+    right.n    = fib->n - 2;
+
+    commc_threadpool_group_init(&group, fib->pool);
+
+    if (commc_threadpool_group_spawn(&group, fib_task, &left) != COMMC_SUCCESS) {
+
+        fib_task(&left);
+
+    }
+
+    fib_task(&right);
+    commc_threadpool_group_wait(&group);
+
+    fib->result = left.result + right.result;
+
+}
+
+/*
+
+         test_nested_fork_join()
+	       ---
+	       fib(22) through nested groups.
+
+*/
+
+static void test_nested_fork_join(commc_threadpool_t* pool) {
+
+    fib_t fib;
+
+    fib.pool   = pool;
+    fib.n      = 22;
+    fib.result = 0;
+
+    fib_task(&fib);
+
+    CHECK(fib.result == 17711, "fib(22) through nested groups");
+
+}
+
+/*
+	==================================
+             --- PARALLEL FOR ---
+	==================================
+*/
+
+/*
+
+         mark_range()
+	       ---
+	       counts each index of its piece.
+
+*/
+
+static void mark_range(void* arg, size_t begin, size_t end) {
+
+    volatile unsigned long* hits = (volatile unsigned long*)arg;
+    size_t                  i;
+
+    for (i = begin; i < end; i++) {
+
+        COMMC_ATOMIC_INC(&hits[i]);
+
+    }
+
+}
+
+/*
+
+         test_parallel_for()
+	       ---
+	       a prime-sized range with an odd grain and the
+	       default grain: every index exactly once.
+
+*/
+
+static void test_parallel_for(commc_threadpool_t* pool) {
+
+    volatile unsigned long* hits;
+    size_t                  grains[2];
+    size_t                  g;
+    size_t                  i;
+    int                     exact;
+
+    hits = (volatile unsigned long*)malloc(TEST_RANGE_SIZE * sizeof(unsigned long));
+
+    CHECK(hits != NULL, "range allocated");
+
+    if (!hits) {
+
+        return;
+
+    }
+
+    grains[0] = 37;
+    grains[1] = 0;
+
+    for (g = 0; g < 2; g++) {
+
+        memset((void*)hits, 0, TEST_RANGE_SIZE * sizeof(unsigned long));
+
+        CHECK(commc_threadpool_parallel_for(pool, 0, TEST_RANGE_SIZE, grains[g],
+                                            mark_range, (void*)hits) == COMMC_SUCCESS,
+              "parallel_for succeeds");
+
+        exact = 1;
+
+        for (i = 0; i < TEST_RANGE_SIZE; i++) {
+
+            if (hits[i] != 1) {
+
+                exact = 0;
+
+            }
+
+        }
+
+        CHECK(exact, "every index runs exactly once");
+
+    }
+
+    free((void*)hits);
+
+}
+
+/*
+	==================================
+             --- DRAIN ---
+	==================================
+*/
+
+/*
+
+         count_task()
+	       ---
+	       counts one run.
+
+*/
+
+static void count_task(void* arg) {
+
+    COMMC_ATOMIC_INC((volatile unsigned long*)arg);
+
+}
+
+/*
+
+         test_destroy_drains()
+	       ---
+	       tasks submitted from outside all run before
+	       destroy() returns.
+
+*/
+
+static void test_destroy_drains(void) {
+
+    commc_threadpool_t*    pool = commc_threadpool_create(TEST_WORKERS);
+    volatile unsigned long count = 0;
+    int                    queued = 0;
+    int                    i;
+
+    CHECK(pool != NULL, "pool created");
+
+    if (!pool) {
+
+        return;
+
+    }
+
+    for (i = 0; i < TEST_DRAIN_TASKS; i++) {
+
+        if (commc_threadpool_submit(pool, count_task, (void*)&count) == COMMC_SUCCESS) {
+
+            queued++;
+
+        }
+
+    }
+
+    commc_threadpool_destroy(pool);
+
+    CHECK(queued == TEST_DRAIN_TASKS, "every submit is accepted");
+    CHECK(count == (unsigned long)queued, "destroy runs every queued task");
+
+}
+
+/*
+	==================================
+             --- MAIN ---
+	==================================
+*/
+
+int main(void) {
+
+    commc_threadpool_t* pool;
+
+    printf("--- WORK-STEALING THREAD POOL TESTS ---\n");
+
+    pool = commc_threadpool_create(TEST_WORKERS);
+
+    if (!pool) {
+
+        printf("FAILED: could not create the pool\n");
+        return 1;
+
+    }
+
+    CHECK(commc_threadpool_worker_count(pool) == TEST_WORKERS, "worker count");
+    CHECK(commc_threadpool_current_worker(pool) == -1, "main thread is not a worker");
+
+    printf("steal under contention...\n");
+    test_steal_contention(pool);
+
+    printf("nested fork/join...\n");
+    test_nested_fork_join(pool);
+
+    printf("parallel_for coverage...\n");
+    test_parallel_for(pool);
+
+    commc_threadpool_destroy(pool);
+
+    printf("destroy drains submissions...\n");
+    test_destroy_drains();
+
+    if (failures > 0) {
+
+        printf("%d THREAD POOL CHECKS FAILED\n", failures);
+        return 1;
+
+    }
+
+    printf("ALL THREAD POOL TESTS PASSED\n");
+    return 0;
+
+}